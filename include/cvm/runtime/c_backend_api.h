@@ -0,0 +1,189 @@
+//
+// Created by WangJingYu on 2021/7/16.
+//
+
+/*!
+ * \file cvm/runtime/c_backend_api.h
+ * \brief CVM runtime backend API.
+ *
+ *  The functions defined in this header are intended to be
+ *  used by compiled cvm operators, usually user do not need to use these
+ *  function directly.
+ */
+#ifndef CVM_INCLUDE_CVM_RUNTIME_C_BACKEND_API_H_
+#define CVM_INCLUDE_CVM_RUNTIME_C_BACKEND_API_H_
+
+#include <cvm/runtime/c_runtime_api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Backend function to allocate temporal workspace.
+ *
+ * \note The result allocate spaced is ensured to be aligned to kTempAllocaAlignment.
+ *
+ * \param nbytes The size of the space requested.
+ * \param device_type The device type which the space will be allocated.
+ * \param device_id The device id which the space will be allocated.
+ * \param dtype_code_hint The type code of the array elements. Only used in
+ * certain backends such as OpenGL.
+ * \param dtype_bits_hint The type bits of the array elements. Only used in
+ * certain backends such as OpenGL.
+ * \param out The allocated space, stack-like release order is fastest.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMBackendAllocWorkspace(int device_type, int device_id, uint64_t nbytes,
+                                     int dtype_code_hint, int dtype_bits_hint, void** out);
+
+/*!
+ * \brief Backend function to free temporal workspace.
+ *
+ * \param ptr The result allocated space pointer.
+ * \param device_type The device type which the space will be allocated.
+ * \param device_id The device id which the space will be allocated.
+ * \return 0 when no error is thrown, -1 when failure happens
+ *
+ * \sa CVMBackendAllocWorkspace
+ */
+CVM_DLL int CVMBackendFreeWorkspace(int device_type, int device_id, void* ptr);
+
+/*!
+ * \brief Environment for CVM parallel task.
+ */
+typedef struct {
+  /*!
+   * \brief Auxiliary used for synchronization
+   */
+  void* sync_handle;
+  /*! \brief total amount of task */
+  int32_t num_task;
+} CVMParallelGroupEnv;
+
+/*!
+ * \brief The callback function to execute a parallel lambda
+ * \param task_id the task id of the function.
+ * \param penv The parallel environment backs the execution.
+ * \param cdata The supporting closure data.
+ */
+typedef int (*FCVMParallelLambda)(int task_id, CVMParallelGroupEnv* penv, void* cdata);
+
+/*!
+ * \brief Backend function for running parallel jobs.
+ *
+ *  Every task id in [0, penv->num_task) is executed exactly once and all tasks
+ *  of a launch run concurrently on distinct threads of the runtime pool.
+ *  A launch from inside a parallel region runs inline with num_task = 1.
+ *
+ * \param flambda The parallel function to be launched.
+ * \param cdata The closure data.
+ * \param num_task Number of tasks to launch, 0 uses every thread of the pool,
+ *  larger values are clamped to the pool size.
+ *
+ * \return 0 when no error is thrown, -1 when failure happens
+ */
+CVM_DLL int CVMBackendParallelLaunch(FCVMParallelLambda flambda, void* cdata, int num_task);
+
+/*!
+ * \brief BSP barrier between parallel threads.
+ *
+ *  Every task of the launch must call the barrier the same number of times,
+ *  the call returns once all of them arrived.
+ *
+ * \param task_id the task id of the function.
+ * \param penv The parallel environment backs the execution.
+ * \return 0 when no error is thrown, -1 when failure happens
+ */
+CVM_DLL int CVMBackendParallelBarrier(int task_id, CVMParallelGroupEnv* penv);
+
+/*!
+ * \brief The callback function combining a partial result into an accumulator.
+ * \param acc The accumulator, updated in place.
+ * \param value The partial result to be combined.
+ * \param cdata The supporting closure data.
+ */
+typedef void (*FCVMParallelCombine)(void* acc, const void* value, void* cdata);
+
+/*!
+ * \brief All-reduce the partial results of the tasks of a parallel launch.
+ *
+ *  Every task stores its value into its own cache line padded slot, then all
+ *  tasks synchronize and each combines the slots in task id order, so the
+ *  result is identical on every task and from run to run, also for floating
+ *  point sums. Like the barrier, every task must take part in the call.
+ *
+ * \param task_id the task id of the function.
+ * \param penv The parallel environment backs the execution.
+ * \param value The partial result of this task.
+ * \param nbytes The size of the partial result, at most 64 bytes.
+ * \param fcombine The combine function.
+ * \param cdata The closure data given to fcombine.
+ * \param result The combined result, nbytes large, may alias value.
+ * \return 0 when no error is thrown, -1 when failure happens
+ */
+CVM_DLL int CVMBackendParallelReduce(int task_id, CVMParallelGroupEnv* penv, const void* value,
+                                     int nbytes, FCVMParallelCombine fcombine, void* cdata,
+                                     void* result);
+
+/*!
+ * \brief The signature of the functions a shared library exports to a module.
+ *
+ * \param args The values of the arguments.
+ * \param type_codes The type codes of the arguments.
+ * \param num_args Number of arguments.
+ * \param out_ret_value The return value, its type code goes to out_ret_tcode.
+ * \param out_ret_tcode The type code of the return value, kCVMNullptr when there is none.
+ * \param resource_handle Reserved, NULL.
+ * \return 0 when success, nonzero when failure happens, the message set by
+ *  CVMAPISetLastError.
+ */
+typedef int (*CVMBackendPackedCFunc)(CVMValue* args, int* type_codes, int num_args,
+                                     CVMValue* out_ret_value, int* out_ret_tcode,
+                                     void* resource_handle);
+
+/*!
+ * \brief Backend function to get a function from the environment of a module: the
+ *  modules it imports first, then the global registry.
+ *
+ * \param mod_node The module, the value of the __cvm_module_ctx symbol of the library.
+ * \param func_name The name of the function.
+ * \param out The function, owned by the module and valid as long as it, do not free it.
+ * \return 0 when no error is thrown, -1 when failure happens
+ */
+CVM_DLL int CVMBackendGetFuncFromEnv(void* mod_node, const char* func_name,
+                                     CVMFunctionHandle* out);
+
+/*!
+ * \brief Backend function to register a symbol of the system library.
+ *
+ *  Statically linked code registers its CVMBackendPackedCFunc functions, typically from
+ *  a static initializer, and Module::SystemLib() serves them without loading anything.
+ *
+ * \param name The name of the symbol.
+ * \param ptr The address of the symbol.
+ * \return 0 when no error is thrown, -1 when failure happens
+ */
+CVM_DLL int CVMBackendRegisterSystemLibSymbol(const char* name, void* ptr);
+
+/*! \brief An entry of a table of symbols of the system library. */
+typedef struct {
+  const char* name;
+  void* ptr;
+} CVMSystemLibEntry;
+
+/*!
+ * \brief Backend function to register a prebuilt table of symbols of the system library
+ *  at once, with a single lock and a single growth of the symbol map.
+ *
+ * \param entries The symbols.
+ * \param num_entries Number of symbols.
+ * \return 0 when no error is thrown, -1 when failure happens
+ */
+CVM_DLL int CVMBackendRegisterSystemLibTable(const CVMSystemLibEntry* entries, int num_entries);
+
+#ifdef __cplusplus
+}  // CVM_EXTERN_C
+#endif
+
+#endif  // CVM_INCLUDE_CVM_RUNTIME_C_BACKEND_API_H_
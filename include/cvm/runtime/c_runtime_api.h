@@ -81,6 +81,7 @@ typedef void* CVMRetValueHandle;
 
 typedef void* CVMStreamHandle;
 typedef void* CVMObjectHandle;
+typedef void* CVMModuleHandle;
 
 CVM_DLL void CVMAPISetLastError(const char* msg);
 
@@ -154,6 +155,153 @@ CVM_DLL int CVMObjectTypeKey2Index(const char* type_key, unsigned* out_tindex);
 
 CVM_DLL int CVMObjectFree(CVMObjectHandle obj);
 
+/*!
+ * \brief Copy array data from one place to another.
+ *  Either array may be strided, they must have the same shape and data type.
+ * \param from The array to be copied from.
+ * \param to The target space.
+ * \param stream The stream where the copy happens, can be NULL.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMArrayCopyFromTo(CVMArrayHandle from, CVMArrayHandle to, CVMStreamHandle stream);
+
+/*!
+ * \brief Copy array data from CPU byte array.
+ * \param handle The array handle.
+ * \param data the data pointer
+ * \param nbytes The number of bytes to copy.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMArrayCopyFromBytes(CVMArrayHandle handle, void* data, size_t nbytes);
+
+/*!
+ * \brief Copy array data to CPU byte array.
+ * \param handle The array handle.
+ * \param data the data pointer
+ * \param nbytes The number of bytes to copy.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMArrayCopyToBytes(CVMArrayHandle handle, void* data, size_t nbytes);
+
+/*!
+ * \brief Create a new runtime stream.
+ *
+ * \param device_type The device type.
+ * \param device_id The device id.
+ * \param out The new stream handle.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMStreamCreate(int device_type, int device_id, CVMStreamHandle* out);
+
+/*!
+ * \brief Free a created stream handle.
+ *
+ * \param device_type The device type.
+ * \param device_id The device id.
+ * \param stream The stream to be freed.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMStreamFree(int device_type, int device_id, CVMStreamHandle stream);
+
+/*!
+ * \brief Set the runtime stream of current thread to be stream.
+ *  The subsequent calls to the same device_type
+ *  will use the setted stream handle.
+ *  The specific type of stream is runtime device dependent.
+ *
+ * \param device_type The device type.
+ * \param device_id The device id.
+ * \param handle The stream handle.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMSetStream(int device_type, int device_id, CVMStreamHandle handle);
+
+/*!
+ * \brief Wait until all computations on stream completes.
+ *
+ * \param device_type The device type.
+ * \param device_id The device id.
+ * \param stream The stream to be synchronized.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMSynchronize(int device_type, int device_id, CVMStreamHandle stream);
+
+/*!
+ * \brief Synchronize two streams of execution.
+ *
+ * \param device_type The device type.
+ * \param device_id The device id.
+ * \param src The source stream to synchronize.
+ * \param dst The destination stream to synchronize.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMStreamStreamSynchronize(int device_type, int device_id, CVMStreamHandle src,
+                                       CVMStreamHandle dst);
+
+/*!
+ * \brief Allocate a data space on device.
+ * \param dev The device to perform operation.
+ * \param nbytes The number of bytes in memory.
+ * \param alignment The alignment of the memory.
+ * \param type_hint The type of elements.
+ * \param out_data The allocated device pointer.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMDeviceAllocDataSpace(DLDevice dev, size_t nbytes, size_t alignment,
+                                    DLDataType type_hint, void** out_data);
+
+/*!
+ * \brief Free a data space on device.
+ * \param dev The device to perform operation.
+ * \param ptr The data space.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMDeviceFreeDataSpace(DLDevice dev, void* ptr);
+
+/*!
+ * \brief Copy data from one place to another.
+ * \param from The source tensor.
+ * \param to The target tensor.
+ * \param stream Optional stream object.
+ * \return 0 when success, nonzero when failure happens.
+ */
+CVM_DLL int CVMDeviceCopyDataFromTo(DLTensor* from, DLTensor* to, CVMStreamHandle stream);
+
+/*!
+ * \brief Load a module from a file.
+ * \param file_name The name of the file.
+ * \param format The format of the file, by its extension when empty.
+ * \param out The module, freed by CVMModFree.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMModLoadFromFile(const char* file_name, const char* format, CVMModuleHandle* out);
+
+/*!
+ * \brief Import a module into another one.
+ * \param mod The importing module.
+ * \param dep The imported module.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMModImport(CVMModuleHandle mod, CVMModuleHandle dep);
+
+/*!
+ * \brief Get a function of a module.
+ * \param mod The module.
+ * \param func_name The name of the function.
+ * \param query_imports Whether to also look into the imported modules.
+ * \param out The function, NULL when there is none, freed by CVMFuncFree.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMModGetFunction(CVMModuleHandle mod, const char* func_name, int query_imports,
+                              CVMFunctionHandle* out);
+
+/*!
+ * \brief Free a module, it lives on while imported or while one of its functions is alive.
+ * \param mod The module.
+ * \return 0 when success, nonzero when failure happens
+ */
+CVM_DLL int CVMModFree(CVMModuleHandle mod);
+
 #ifdef __cplusplus
 }
 #endif
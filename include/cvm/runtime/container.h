@@ -26,7 +26,10 @@
 #include <experimental/string_view>
 #endif
 
+#include <algorithm>
+#include <cstring>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -736,6 +739,10 @@ class String : public ObjectRef {
     return memncmp(data(), other.data(), size(), other.size());
   }
 
+  int compare(const char* other) const {
+    return memncmp(data(), other, size(), std::strlen(other));
+  }
+
   const char* c_str() const { return get()->data; }
 
   size_t size() const {
@@ -810,6 +817,52 @@ inline String& String::operator=(std::string other) {
 
 inline String& String::operator=(const char* other) { return operator=(std::string(other)); }
 
+inline int String::memncmp(const char* lhs, const char* rhs, size_t lhs_count, size_t rhs_count) {
+  if (lhs == rhs && lhs_count == rhs_count) return 0;
+
+  for (size_t i = 0; i < lhs_count && i < rhs_count; ++i) {
+    if (lhs[i] < rhs[i]) return -1;
+    if (lhs[i] > rhs[i]) return 1;
+  }
+  if (lhs_count < rhs_count) {
+    return -1;
+  } else if (lhs_count > rhs_count) {
+    return 1;
+  } else {
+    return 0;
+  }
+}
+
+inline bool operator==(const String& lhs, const String& rhs) { return lhs.compare(rhs) == 0; }
+inline bool operator!=(const String& lhs, const String& rhs) { return lhs.compare(rhs) != 0; }
+inline bool operator==(const String& lhs, const std::string& rhs) { return lhs.compare(rhs) == 0; }
+inline bool operator!=(const String& lhs, const std::string& rhs) { return lhs.compare(rhs) != 0; }
+inline bool operator==(const String& lhs, const char* rhs) { return lhs.compare(rhs) == 0; }
+inline bool operator!=(const String& lhs, const char* rhs) { return lhs.compare(rhs) != 0; }
+inline bool operator<(const String& lhs, const String& rhs) { return lhs.compare(rhs) < 0; }
+
+inline std::ostream& operator<<(std::ostream& out, const String& input) {
+  out.write(input.data(), input.size());
+  return out;
+}
+
+inline size_t ObjectHash::operator()(const ObjectRef& a) const {
+  if (const auto* str = a.as<StringObj>()) {
+    return String::HashBytes(str->data, str->size);
+  }
+  return std::hash<const Object*>()(a.get());
+}
+
+inline bool ObjectEqual::operator()(const ObjectRef& a, const ObjectRef& b) const {
+  if (a.same_as(b)) return true;
+  if (const auto* str_a = a.as<StringObj>()) {
+    if (const auto* str_b = b.as<StringObj>()) {
+      return str_a->size == str_b->size && std::memcmp(str_a->data, str_b->data, str_a->size) == 0;
+    }
+  }
+  return false;
+}
+
 struct NullOptType {};
 
 /*!
@@ -909,6 +962,300 @@ class Optional : public ObjectRef {
   static constexpr bool _type_is_nullable = true;
 };
 
+/*! \brief map node content */
+class MapNode : public Object {
+ public:
+  /*! \brief The corresponding container type, keys are hashed by ObjectHash. */
+  using ContainerType = std::unordered_map<ObjectRef, ObjectRef, ObjectHash, ObjectEqual>;
+
+  /*! \brief the data content */
+  ContainerType data;
+
+  static constexpr const uint32_t _type_index = TypeIndex::kRuntimeMap;
+  static constexpr const char* _type_key = "Map";
+  CVM_DECLARE_FINAL_OBJECT_INFO(MapNode, Object);
+};
+
+/*!
+ * \brief Map container of ObjectRef->ObjectRef.
+ *
+ *  Map implements copy on write semantics, which means map is mutable
+ *  but copy will happen when array is referenced in more than two places.
+ *
+ *  operator[] only provide const access, use Set to mutate the content.
+ *
+ * \tparam K The key ObjectRef type.
+ * \tparam V The value ObjectRef type.
+ */
+template <typename K, typename V,
+          typename = typename std::enable_if<std::is_base_of<ObjectRef, K>::value>::type,
+          typename = typename std::enable_if<std::is_base_of<ObjectRef, V>::value>::type>
+class Map : public ObjectRef {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  /*! \brief default constructor */
+  Map() { data_ = make_object<MapNode>(); }
+  /*!
+   * \brief constructor from pointer
+   * \param n the container pointer
+   */
+  explicit Map(ObjectPtr<Object> n) : ObjectRef(n) {}
+  /*!
+   * \brief constructor from iterator
+   * \param begin begin of iterator
+   * \param end end of iterator
+   * \tparam IterType The type of iterator
+   */
+  template <typename IterType>
+  Map(IterType begin, IterType end) {
+    Assign(begin, end);
+  }
+  /*!
+   * \brief constructor from initializer list
+   * \param init The initalizer list
+   */
+  Map(std::initializer_list<std::pair<K, V>> init) {  // NOLINT
+    Assign(init.begin(), init.end());
+  }
+  /*!
+   * \brief constructor from unordered_map
+   * \param init The unordered_map
+   */
+  template <typename Hash, typename Equal>
+  Map(const std::unordered_map<K, V, Hash, Equal>& init) {  // NOLINT
+    Assign(init.begin(), init.end());
+  }
+  /*!
+   * \brief reset the map to content from iterator.
+   * \param begin begin of iterator
+   * \param end end of iterator
+   * \tparam IterType The type of iterator
+   */
+  template <typename IterType>
+  void Assign(IterType begin, IterType end) {
+    ObjectPtr<MapNode> n = make_object<MapNode>();
+    for (IterType i = begin; i != end; ++i) {
+      n->data.emplace(std::make_pair(i->first, i->second));
+    }
+    data_ = std::move(n);
+  }
+  /*!
+   * \brief Read element from map.
+   * \param key The key
+   * \return the corresonding element.
+   */
+  const V operator[](const K& key) const { return this->at(key); }
+  /*!
+   * \brief Read element from map.
+   * \param key The key
+   * \return the corresonding element.
+   */
+  const V at(const K& key) const {
+    const MapNode* n = GetMapNode();
+    auto it = n->data.find(key);
+    ICHECK(it != n->data.end()) << "IndexError: key is not in Map";
+    return DowncastNoCheck<V>(it->second);
+  }
+  /*! \return The size of the map */
+  size_t size() const {
+    const MapNode* n = GetMapNode();
+    return n == nullptr ? 0 : n->data.size();
+  }
+  /*! \return The number of elements of the key */
+  size_t count(const K& key) const {
+    const MapNode* n = GetMapNode();
+    return n == nullptr ? 0 : n->data.count(key);
+  }
+  /*! \return whether map is empty */
+  bool empty() const { return size() == 0; }
+  /*!
+   * \brief set the Map.
+   * \param key The index key.
+   * \param value The value to be setted.
+   */
+  void Set(const K& key, const V& value) { CopyOnWrite()->data[key] = value; }
+  /*!
+   * \brief copy on write semantics
+   *  Do nothing if current handle is the unique copy of the map.
+   *  Otherwise make a new copy of the map to ensure the current handle
+   *  hold a unique copy.
+   *
+   * \return Handle to the internal node container(which guarantees to be unique)
+   */
+  MapNode* CopyOnWrite() {
+    if (data_.get() == nullptr) {
+      data_ = make_object<MapNode>();
+    } else if (!data_.unique()) {
+      ObjectPtr<MapNode> n = make_object<MapNode>();
+      n->data = GetMapNode()->data;
+      data_ = std::move(n);
+    }
+    return static_cast<MapNode*>(data_.get());
+  }
+
+  /*! \brief specify container node */
+  using ContainerType = MapNode;
+
+  struct ValueConverter {
+    using ResultType = std::pair<K, V>;
+    static std::pair<K, V> convert(const std::pair<ObjectRef, ObjectRef>& n) {
+      return std::make_pair(DowncastNoCheck<K>(n.first), DowncastNoCheck<V>(n.second));
+    }
+  };
+
+  using iterator = IterAdapter<ValueConverter, MapNode::ContainerType::const_iterator>;
+
+  /*! \return begin iterator */
+  iterator begin() const { return iterator(GetMapNode()->data.begin()); }
+  /*! \return end iterator */
+  iterator end() const { return iterator(GetMapNode()->data.end()); }
+  /*! \return find the key and returns the associated iterator */
+  iterator find(const K& key) const { return iterator(GetMapNode()->data.find(key)); }
+
+ private:
+  /*! \return The underlying MapNode */
+  const MapNode* GetMapNode() const { return static_cast<const MapNode*>(data_.get()); }
+};
+
+/*! \brief An object representing a shape tuple. */
+class ShapeTupleObj : public Object {
+ public:
+  /*! \brief The type of shape index element. */
+  using index_type = int64_t;
+  /*! \brief The pointer to shape tuple data. */
+  index_type* data;
+  /*! \brief Lenght of the shape tuple. */
+  uint64_t size;
+
+  static constexpr const uint32_t _type_index = TypeIndex::kRuntimeShapeTuple;
+  static constexpr const char* _type_key = "runtime.ShapeTuple";
+  CVM_DECLARE_FINAL_OBJECT_INFO(ShapeTupleObj, Object);
+
+ private:
+  /*! \brief ShapeTuple object which is moved from std::vector container. */
+  class FromStd;
+
+  friend class ShapeTuple;
+};
+
+/*! \brief An object representing shape tuple moved from std::vector. */
+class ShapeTupleObj::FromStd : public ShapeTupleObj {
+ public:
+  /*! \brief The type of shape index element. */
+  using index_type = ShapeTupleObj::index_type;
+  /*!
+   * \brief Construct a new FromStd object
+   *
+   * \param other The moved/copied std::vector object
+   *
+   * \note If user passes const reference, it will trigger copy. If it's rvalue,
+   * it will be moved into other.
+   */
+  explicit FromStd(std::vector<index_type> other) : data_container{std::move(other)} {}
+
+ private:
+  /*! \brief Container that holds the memory. */
+  std::vector<index_type> data_container;
+
+  friend class ShapeTuple;
+};
+
+/*!
+ * \brief Reference to shape tuple objects.
+ */
+class ShapeTuple : public ObjectRef {
+ public:
+  /*! \brief The type of shape index element. */
+  using index_type = ShapeTupleObj::index_type;
+
+  /*!
+   * \brief Construct an empty shape tuple.
+   */
+  ShapeTuple() : ShapeTuple(std::vector<index_type>()) {}
+
+  /*!
+   * \brief Constructor from iterator
+   * \param begin begin of iterator
+   * \param end end of iterator
+   * \tparam IterType The type of iterator
+   */
+  template <typename IterType>
+  ShapeTuple(IterType begin, IterType end) : ShapeTuple(std::vector<index_type>(begin, end)) {}
+
+  /*!
+   * \brief constructor from initializer list
+   * \param shape The initializer list
+   */
+  ShapeTuple(std::initializer_list<index_type> shape) : ShapeTuple(shape.begin(), shape.end()) {}
+
+  /*!
+   * \brief Construct a new ShapeTuple object
+   *
+   * \param shape The moved/copied std::vector object
+   *
+   * \note If user passes const reference, it will trigger copy. If it's rvalue,
+   * it will be moved into other.
+   */
+  ShapeTuple(std::vector<index_type> shape);  // NOLINT(*)
+
+  /*!
+   * \brief Return the data pointer
+   *
+   * \return const index_type* data pointer
+   */
+  const index_type* data() const { return get()->data; }
+
+  /*!
+   * \brief Return the size of the shape tuple
+   *
+   * \return size_t shape tuple size
+   */
+  size_t size() const { return get()->size; }
+
+  /*!
+   * \brief Immutably read i-th element from the shape tuple.
+   * \param idx The index
+   * \return the i-th element.
+   */
+  index_type operator[](size_t idx) const {
+    ICHECK(idx < this->size()) << "IndexError: indexing " << idx << " on an array of size "
+                               << this->size();
+    return this->data()[idx];
+  }
+
+  /*!
+   * \brief Immutably read i-th element from the shape tuple.
+   * \param idx The index
+   * \return the i-th element.
+   */
+  index_type at(size_t idx) const { return this->operator[](idx); }
+
+  /*! \return Whether shape tuple is empty */
+  bool empty() const { return size() == 0; }
+
+  /*! \return The first element of the shape tuple */
+  index_type front() const { return this->at(0); }
+
+  /*! \return The last element of the shape tuple */
+  index_type back() const { return this->at(this->size() - 1); }
+
+  /*! \return begin iterator */
+  const index_type* begin() const { return get()->data; }
+
+  /*! \return end iterator */
+  const index_type* end() const { return (get()->data + size()); }
+
+  CVM_DEFINE_NOTNULLABLE_OBJECT_REF_METHOD(ShapeTuple, ObjectRef, ShapeTupleObj);
+};
+
+inline ShapeTuple::ShapeTuple(std::vector<index_type> shape) {
+  auto ptr = make_object<ShapeTupleObj::FromStd>(std::move(shape));
+  ptr->size = ptr->data_container.size();
+  ptr->data = ptr->data_container.data();
+  data_ = std::move(ptr);
+}
+
 class ClosureObj : public  Object {
  public:
   static constexpr const uint32_t _type_index = TypeIndex::kRuntimeClosure;
@@ -921,6 +1268,102 @@ class Closure : public ObjectRef {
   CVM_DEFINE_OBJECT_REF_METHOD(Closure, ObjectRef, ClosureObj);
 };
 
+/*!
+ * \brief An algebraic data type value: the tag of its constructor and its fields, stored
+ *  after the object in the same allocation.
+ */
+class ADTObj : public Object, public InplaceArrayBase<ADTObj, ObjectRef> {
+ public:
+  /*! \brief The tag of the constructor, 0 for a tuple. */
+  int32_t tag;
+  /*! \brief The number of fields. */
+  uint32_t size{0};
+
+  static constexpr const uint32_t _type_index = TypeIndex::kRuntimeADT;
+  static constexpr const char* _type_key = "runtime.ADT";
+  CVM_DECLARE_FINAL_OBJECT_INFO(ADTObj, Object);
+
+ private:
+  /*! \return The number of fields, used by InplaceArrayBase. */
+  size_t GetSize() const { return size; }
+
+  /*!
+   * \brief Construct the fields in place, size counts the constructed ones so that a
+   *  throwing copy destroys only those.
+   */
+  template <typename Iterator>
+  void Init(Iterator begin, Iterator end) {
+    size_t num_fields = std::distance(begin, end);
+    this->size = 0;
+    for (size_t i = 0; i < num_fields; ++i, ++begin) {
+      InplaceArrayBase::EmplaceInit(i, *begin);
+      ++this->size;
+    }
+  }
+
+  friend class ADT;
+  friend InplaceArrayBase<ADTObj, ObjectRef>;
+};
+
+/*! \brief Reference to algebraic data type objects. */
+class ADT : public ObjectRef {
+ public:
+  /*!
+   * \brief Construct an ADT from a tag and the fields in [begin, end), in one allocation.
+   * \param tag The tag of the constructor.
+   * \param begin The beginning of the fields.
+   * \param end The end of the fields.
+   */
+  template <typename Iterator>
+  ADT(int32_t tag, Iterator begin, Iterator end) {
+    size_t num_fields = std::distance(begin, end);
+    ObjectPtr<ADTObj> ptr = make_inplace_array_object<ADTObj, ObjectRef>(num_fields);
+    ptr->tag = tag;
+    ptr->Init(begin, end);
+    data_ = std::move(ptr);
+  }
+
+  ADT(int32_t tag, const std::vector<ObjectRef>& fields)
+      : ADT(tag, fields.begin(), fields.end()) {}
+
+  ADT(int32_t tag, std::initializer_list<ObjectRef> fields)
+      : ADT(tag, fields.begin(), fields.end()) {}
+
+  /*!
+   * \brief Access a field, bounds checked.
+   * \param idx The index of the field.
+   * \return The field.
+   */
+  const ObjectRef& operator[](size_t idx) const { return get()->operator[](idx); }
+
+  /*! \return The tag of the constructor. */
+  int32_t tag() const { return get()->tag; }
+
+  /*! \return The number of fields. */
+  size_t size() const { return get()->size; }
+
+  /*! \return The first field, the fields are contiguous. */
+  const ObjectRef* begin() const { return static_cast<const ObjectRef*>(get()->AddressOf(0)); }
+
+  /*! \return The end of the fields. */
+  const ObjectRef* end() const { return begin() + size(); }
+
+  /*!
+   * \brief Construct a tuple, an ADT of tag 0.
+   * \param fields The fields of the tuple.
+   * \return The tuple.
+   */
+  template <typename... Args>
+  static ADT Tuple(Args&&... fields) {
+    return ADT(0, {ObjectRef(std::forward<Args>(fields))...});
+  }
+
+  CVM_DEFINE_OBJECT_REF_METHOD(ADT, ObjectRef, ADTObj);
+};
+
+/*! \brief A tuple is an ADT of tag 0, made by ADT::Tuple. */
+using Tuple = ADT;
+
 
 
 }  // namespace runtime
@@ -0,0 +1,213 @@
+//
+// Created by WangJingYu on 2021/7/16.
+//
+
+#ifndef CVM_INCLUDE_CVM_RUNTIME_DEVICE_API_H_
+#define CVM_INCLUDE_CVM_RUNTIME_DEVICE_API_H_
+
+#include <cvm/runtime/c_runtime_api.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/packed_func.h>
+
+#include <string>
+
+namespace cvm {
+namespace runtime {
+
+/*!
+ * \brief the query type into GetAttr
+ */
+enum DeviceAttrKind : int {
+  kExist = 0,
+  kMaxThreadsPerBlock = 1,
+  kWarpSize = 2,
+  kDeviceName = 3,
+  kMaxClockRate = 4,
+  kMultiProcessorCount = 5,
+};
+
+/*! \brief Number of bytes each allocation of workspace must align to */
+constexpr int kTempAllocaAlignment = 64;
+
+/*! \brief Maximum size that can be allocated on stack */
+constexpr int kMaxStackAlloca = 1024;
+
+/*!
+ * \brief CVM Runtime Device API, abstracts the device
+ *  specific interface for memory management.
+ */
+class CVM_DLL DeviceAPI {
+ public:
+  /*! \brief virtual destructor */
+  virtual ~DeviceAPI() {}
+  /*!
+   * \brief Set the environment device id to device
+   * \param dev The device to be set.
+   */
+  virtual void SetDevice(Device dev) = 0;
+  /*!
+   * \brief Get attribute of specified device.
+   * \param dev The device device
+   * \param kind The result kind
+   * \param rv The return value.
+   * \sa DeviceAttrKind
+   */
+  virtual void GetAttr(Device dev, DeviceAttrKind kind, CVMRetValue* rv) = 0;
+  /*!
+   * \brief Allocate a data space on device.
+   * \param dev The device device to perform operation.
+   * \param nbytes The number of bytes in memory.
+   * \param alignment The alignment of the memory.
+   * \param type_hint The type of elements. Only needed by certain backends such
+   * as OpenGL, as nbytes & alignment are sufficient for most backends.
+   * \return The allocated device pointer.
+   */
+  virtual void* AllocDataSpace(Device dev, size_t nbytes, size_t alignment,
+                               DLDataType type_hint) = 0;
+  /*!
+   * \brief Allocate a data space on device with shape and dtype.
+   * \param dev The device to perform the operation.
+   * \param ndim The number of dimensions of allocated tensor.
+   * \param shape The shape of allocated tensor.
+   * \param dtype The type of elements.
+   * \return The allocated device pointer.
+   */
+  virtual void* AllocDataSpace(Device dev, int ndim, const int64_t* shape, DLDataType dtype);
+  /*!
+   * \brief Free a data space on device.
+   * \param dev The device device to perform operation.
+   * \param ptr The data space.
+   */
+  virtual void FreeDataSpace(Device dev, void* ptr) = 0;
+  /*!
+   * \brief copy data from one place to another
+   * \note This API is designed to support special memory with shape dependent layout.
+   *       We pass in DLTensor* with shape information to support these cases.
+   * \param from The source array.
+   * \param to The target array.
+   * \param stream Optional stream object, the copy is ordered after the
+   *  work already queued on it.
+   */
+  virtual void CopyDataFromTo(DLTensor* from, DLTensor* to, CVMStreamHandle stream);
+  /*!
+   * \brief Create a new stream of execution.
+   *
+   * \param dev The device of allocation.
+   */
+  virtual CVMStreamHandle CreateStream(Device dev);
+  /*!
+   * \brief Free a stream of execution
+   *
+   * \param dev The device of the stream
+   * \param stream The pointer to be freed.
+   */
+  virtual void FreeStream(Device dev, CVMStreamHandle stream);
+  /*!
+   * \brief Synchronize the stream
+   * \param dev The device to perform operation.
+   * \param stream The stream to be sync.
+   */
+  virtual void StreamSync(Device dev, CVMStreamHandle stream) = 0;
+  /*!
+   * \brief Set the stream
+   * \param dev The device to set stream.
+   * \param stream The stream to be set.
+   */
+  virtual void SetStream(Device /*dev*/, CVMStreamHandle /*stream*/) {}
+  /*!
+   * \brief Synchronize 2 streams of execution.
+   *
+   * An event is created in event_src stream that the second then
+   * stream waits on.  Neither event_src or event_dst need to be of
+   * the same device ID as the device, but they must be of the same
+   * device type.
+   *
+   * \param dev The device of the streams.
+   * \param event_src The source stream to synchronize.
+   * \param event_dst The destination stream to synchronize.
+   */
+  virtual void SyncStreamFromTo(Device dev, CVMStreamHandle event_src,
+                                CVMStreamHandle event_dst);
+  /*!
+   * \brief Allocate temporal workspace for backend execution.
+   *
+   *  \note We have the following assumption about backend temporal
+   *   workspace allocation, and backend will optimize for such assumption:
+   *
+   *  - Only a few allocation will happen, and space will be released after use.
+   *  - The release order is usually in reverse order of allocate (stack style).
+   *  - Repeative pattern of same allocations over different runs.
+   *  - Workspace should not overlap between different threads(i.e. be threadlocal)
+   *
+   * \param dev The device of allocation.
+   * \param nbytes The size to be allocated.
+   * \param type_hint The type of elements. Only needed by certain backends such
+   * as OpenGL, as nbytes is sufficient for most backends.
+   */
+  virtual void* AllocWorkspace(Device dev, size_t nbytes, DLDataType type_hint = {});
+  /*!
+   * \brief Free temporal workspace in backend execution.
+   *
+   * \param dev The device of allocation.
+   * \param ptr The pointer to be freed.
+   */
+  virtual void FreeWorkspace(Device dev, void* ptr);
+
+  /*!
+   * \brief Get device API based on device.
+   * \param dev The device
+   * \param allow_missing Whether allow missing
+   * \return The corresponding device API.
+   */
+  static DeviceAPI* Get(Device dev, bool allow_missing = false);
+
+ protected:
+  /*!
+   * \brief copy data from one place to another
+   * \param from The source array.
+   * \param from_offset The byte offeset in the from.
+   * \param to The target array.
+   * \param to_offset The byte offset in the to.
+   * \param num_bytes The size of the memory in bytes
+   * \param dev_from The source device
+   * \param dev_to The target device
+   * \param type_hint The type of elements, only neded by certain backends.
+   *                  can be useful for cross device endian converison.
+   * \param stream Optional stream object.
+   */
+  virtual void CopyDataFromTo(const void* from, size_t from_offset, void* to, size_t to_offset,
+                              size_t num_bytes, Device dev_from, Device dev_to,
+                              DLDataType type_hint, CVMStreamHandle stream);
+};
+
+/*!
+ * \brief The name of Device API factory.
+ * \param type The device type.
+ * \return the device name.
+ */
+inline const char* DeviceName(int type) {
+  switch (type) {
+    case kDLCPU:
+      return "cpu";
+    case kDLCUDA:
+      return "cuda";
+    case kDLCUDAHost:
+      return "cuda_host";
+    case kDLOpenCL:
+      return "opencl";
+    case kDLVulkan:
+      return "vulkan";
+    case kDLMetal:
+      return "metal";
+    case kDLROCM:
+      return "rocm";
+    default:
+      LOG(FATAL) << "unknown type =" << type;
+      return "Unknown";
+  }
+}
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_INCLUDE_CVM_RUNTIME_DEVICE_API_H_
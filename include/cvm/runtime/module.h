@@ -0,0 +1,165 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file cvm/runtime/module.h
+ * \brief Runtime container of the functions of a library or an executor.
+ */
+#ifndef CVM_INCLUDE_CVM_RUNTIME_MODULE_H_
+#define CVM_INCLUDE_CVM_RUNTIME_MODULE_H_
+
+#include <cvm/runtime/c_runtime_api.h>
+#include <cvm/runtime/object.h>
+#include <cvm/runtime/packed_func.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+class ModuleNode;
+
+/*! \brief Reference to a module, see ModuleNode. */
+class Module : public ObjectRef {
+ public:
+  Module() = default;
+  explicit Module(ObjectPtr<Object> n) : ObjectRef(n) {}
+
+  /*!
+   * \brief Get a function of the module, see ModuleNode::GetFunction.
+   * \param name The name of the function.
+   * \param query_imports Whether to also look into the imported modules.
+   * \return The function, nullptr when there is none.
+   */
+  inline PackedFunc GetFunction(const std::string& name, bool query_imports = false);
+
+  /*! \brief Import another module into this module, see ModuleNode::Import. */
+  inline void Import(Module other);
+
+  /*! \return The module node, mutable: lookups fill the cache of the module. */
+  inline ModuleNode* operator->() const;
+
+  /*!
+   * \brief Load a module from a file.
+   * \param file_name The name of the file.
+   * \param format The format of the file, by its extension when empty: "so", "dll" and
+   *  "dylib" are shared libraries exporting CVMBackendPackedCFunc functions.
+   * \return The module, throws an Error when the file cannot be loaded.
+   */
+  CVM_DLL static Module LoadFromFile(const std::string& file_name, const std::string& format = "");
+
+  /*!
+   * \return The module of the system library: the functions registered by
+   *  CVMBackendRegisterSystemLibSymbol, typically by statically linked code.
+   */
+  CVM_DLL static Module SystemLib();
+
+  using ContainerType = ModuleNode;
+};
+
+/*!
+ * \brief Base class of the modules: a library of functions, an executor, ...
+ *
+ *  A subclass implements GetFunction(name, sptr_to_self). Lookups by name go through a
+ *  per module cache: after the first lookup of a name, misses included, finding its
+ *  function is a hash probe.
+ */
+class CVM_DLL ModuleNode : public Object {
+ public:
+  virtual ~ModuleNode() = default;
+
+  /*! \return The kind of the module, e.g. "library". */
+  virtual const char* type_key() const = 0;
+
+  /*!
+   * \brief Get a function of the module itself.
+   * \param name The name of the function.
+   * \param sptr_to_self The pointer to this module for the function to keep it alive, null
+   *  for the functions held by the cache of the module.
+   * \return The function, nullptr when there is none.
+   */
+  virtual PackedFunc GetFunction(const std::string& name,
+                                 const ObjectPtr<Object>& sptr_to_self) = 0;
+
+  /*!
+   * \brief Get a function, memoized, the returned function keeps the module alive.
+   * \param name The name of the function.
+   * \param query_imports Whether to look into the imported modules when the module
+   *  itself has no function of the name.
+   * \return The function, nullptr when there is none.
+   */
+  PackedFunc GetFunction(const std::string& name, bool query_imports = false);
+
+  /*!
+   * \brief Get a function from the cache, filling it on the first lookup of the name.
+   * \param name The name of the function.
+   * \param query_imports Whether to look into the imported modules.
+   * \return The function, valid as long as the module, nullptr when there is none.
+   */
+  const PackedFunc* GetFunctionCached(const std::string& name, bool query_imports = false);
+
+  /*!
+   * \brief Get a function for the code of this module: the imported modules first, then
+   *  the global registry. Memoized like GetFunctionCached.
+   * \param name The name of the function.
+   * \return The function, throws an Error when there is none.
+   */
+  const PackedFunc* GetFuncFromEnv(const std::string& name);
+
+  /*!
+   * \brief Import another module, its functions become visible to lookups querying the
+   *  imports and to the code of this module. Throws an Error on an import cycle. Imports
+   *  set up the module, they are not meant to run concurrently with lookups.
+   */
+  void Import(Module other);
+
+  /*! \return The imported modules. */
+  const std::vector<Module>& imports() const { return imports_; }
+
+  static constexpr const uint32_t _type_index = TypeIndex::kRuntimeModule;
+  static constexpr const char* _type_key = "runtime.Module";
+  CVM_DECLARE_BASE_OBJECT_INFO(ModuleNode, Object);
+
+ protected:
+  std::vector<Module> imports_;
+
+ private:
+  /*! \brief The lookups cached, by the kind of lookup. */
+  enum CacheKind { kSelf = 0, kWithImports, kEnv, kNumCacheKinds };
+
+  /*! \return The cached function, filled by lookup on a miss of the cache. */
+  template <typename FLookup>
+  const PackedFunc* Cached(CacheKind kind, const std::string& name, FLookup lookup);
+  /*! \return Whether other is this module or is imported by it, directly or not. */
+  bool Reaches(const ModuleNode* other) const;
+
+  std::mutex mutex_;
+  /*! \brief The functions by name, empty for the names without one. */
+  std::unordered_map<std::string, std::unique_ptr<PackedFunc>> cache_[kNumCacheKinds];
+};
+
+/*! \brief The names of the symbols of a shared library the loader looks for. */
+namespace symbol {
+/*! \brief A void* set by the loader to the module, for CVMBackendGetFuncFromEnv. */
+constexpr const char* cvm_module_ctx = "__cvm_module_ctx";
+}  // namespace symbol
+
+inline PackedFunc Module::GetFunction(const std::string& name, bool query_imports) {
+  return (*this)->GetFunction(name, query_imports);
+}
+
+inline void Module::Import(Module other) { (*this)->Import(std::move(other)); }
+
+inline ModuleNode* Module::operator->() const {
+  return static_cast<ModuleNode*>(get_mutable());
+}
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_INCLUDE_CVM_RUNTIME_MODULE_H_
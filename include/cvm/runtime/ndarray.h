@@ -5,13 +5,21 @@
 #ifndef CVM_INCLUDE_CVM_RUNTIME_NDARRAY_H_
 #define CVM_INCLUDE_CVM_RUNTIME_NDARRAY_H_
 
+#include <cvm/runtime/c_runtime_api.h>
 #include <cvm/runtime/container.h>
+#include <cvm/runtime/data_type.h>
+
+#include <utility>
+#include <vector>
 
 namespace cvm {
 namespace runtime {
 
 typedef DLDevice Device;
 
+/*! \brief Number of bytes each allocation must align to */
+constexpr int kAllocAlignment = 64;
+
 /*!
  * \brief Managed NDArray.
  *  The array is backed by reference counted blocks.
@@ -32,21 +40,259 @@ class NDArray : public ObjectRef {
    */
   explicit NDArray(ObjectPtr<Object> data) : ObjectRef(data) {}
 
+  /*! \brief reset the content of NDArray to be nullptr */
+  inline void reset();
+  /*!
+   * \return the reference counter
+   * \note this number is approximate in multi-threaded setting.
+   */
+  inline int use_count() const;
+  /*! \return Pointer to content of DLTensor */
+  inline const DLTensor* operator->() const;
+  /*! \return Whether the tensor is contiguous */
+  inline bool IsContiguous() const;
+  /*! \return The shape of the array */
+  inline const std::vector<int64_t>& Shape() const;
+  /*! \return The data type of the array */
+  inline runtime::DataType DataType() const;
+  /*!
+   * \brief Copy data content from another array.
+   * \param other The source array to be copied from.
+   * \note The copy may happen asynchronously if it involves a GPU context.
+   *       CVMSynchronize is necessary.
+   */
+  inline void CopyFrom(const DLTensor* other);
+  inline void CopyFrom(const NDArray& other);
+  /*!
+   * \brief Copy data content from a byte buffer.
+   * \param data The source bytes to be copied from.
+   * \param nbytes The size of the buffer in bytes
+   *        Must be equal to the size of the NDArray.
+   */
+  CVM_DLL void CopyFromBytes(const void* data, size_t nbytes);
+  /*!
+   * \brief Copy data content into another array.
+   * \param other The source array to be copied from.
+   */
+  inline void CopyTo(DLTensor* other) const;
+  inline void CopyTo(const NDArray& other) const;
+  /*!
+   * \brief Copy data content into a byte buffer.
+   * \param data The destination buffer.
+   * \param nbytes The size of the buffer in bytes
+   *        Must be equal to the size of the NDArray.
+   */
+  CVM_DLL void CopyToBytes(void* data, size_t nbytes) const;
+  /*!
+   * \brief Copy the data to another device, the result is always compact.
+   * \param dev The target device.
+   * \return The array under another device.
+   */
+  CVM_DLL NDArray CopyTo(const Device& dev) const;
+  /*!
+   * \brief Create a NDArray that shares the data memory with the current one.
+   * \param shape The shape of the new array.
+   * \param dtype The data type of the new array.
+   * \param relative_byte_offset The offset of the view from the start of the current one.
+   * \note The view must fit within the memory of the current one.
+   */
+  CVM_DLL NDArray CreateView(std::vector<int64_t> shape, DLDataType dtype,
+                             uint64_t relative_byte_offset = 0);
+  /*!
+   * \brief Create an empty NDArray.
+   * \param shape The shape of the new array.
+   * \param dtype The data type of the new array.
+   * \param device The device of the array.
+   * \return The created Array
+   */
   CVM_DLL static NDArray Empty(std::vector<int64_t> shape, DLDataType dtype, Device device);
+  /*!
+   * \brief Function to copy data from one array to another.
+   *  Either array may be strided, the copy is parallel for large tensors.
+   * \param from The source array.
+   * \param to The target array.
+   * \param stream The stream used in copy.
+   */
+  CVM_DLL static void CopyFromTo(const DLTensor* from, DLTensor* to,
+                                 CVMStreamHandle stream = nullptr);
 
   inline static ObjectPtr<Object> FFIDataFromHandle(CVMArrayHandle handle);
 
   inline static void FFIDecRef(CVMArrayHandle handle);
 
   inline static CVMArrayHandle FFIGetHandle(const ObjectRef& nd);
+
+ protected:
+  friend class CVMPODValue_;
+  friend class CVMRetValue;
+  friend class CVMArgsSetter;
+  /*!
+   * \brief Get mutable internal container pointer.
+   * \return a mutable container pointer.
+   */
+  inline Container* get_mutable() const;
+
+  // internal namespace
+  struct Internal;
 };
 
-class NDArray::ContainerBase {};
+/*!
+ * \brief The container base structure
+ *        contains all the fields except for the Object header.
+ *
+ * \note We explicitly declare this structure in order to pass
+ *       PackedFunc argument using ContainerBase*.
+ */
+class NDArray::ContainerBase {
+ public:
+  /*!
+   * \brief The corresponding dl_tensor field.
+   * \note it is important that the first field is DLTensor
+   *  So that this data structure is DLTensor compatible.
+   *  The head ptr of this struct can be viewed as DLTensor*.
+   */
+  DLTensor dl_tensor;
+
+  /*!
+   * \brief additional context, reserved for recycling
+   * \note We can attach additional content here
+   *  which the current container depend on
+   *  (e.g. reference to original memory when creating views).
+   */
+  void* manager_ctx{nullptr};
+
+ protected:
+  /*!
+   * \brief The shape container,
+   *  can be used for shape data.
+   */
+  std::vector<int64_t> shape_;
+};
 
+/*!
+ * \brief Object container class that backs NDArray.
+ * \note do not use this function directly, use NDArray.
+ */
 class NDArray::Container : public Object, public NDArray::ContainerBase {
+ public:
+  /*! \brief default constructor */
+  Container() {
+    // Initialize the type index.
+    type_index_ = Container::RuntimeTypeIndex();
+    dl_tensor.data = nullptr;
+    dl_tensor.ndim = 0;
+    dl_tensor.shape = nullptr;
+    dl_tensor.strides = nullptr;
+    dl_tensor.byte_offset = 0;
+  }
+
+  Container(void* data, std::vector<int64_t> shape, DLDataType dtype, Device dev) {
+    // Initialize the type index.
+    type_index_ = Container::RuntimeTypeIndex();
+    dl_tensor.data = data;
+    shape_ = std::move(shape);
+    dl_tensor.ndim = static_cast<int>(shape_.size());
+    dl_tensor.shape = shape_.data();
+    dl_tensor.dtype = dtype;
+    dl_tensor.strides = nullptr;
+    dl_tensor.byte_offset = 0;
+    dl_tensor.device = dev;
+  }
+  /*!
+   * \brief Set the deleter field.
+   * \param deleter The deleter.
+   */
+  void SetDeleter(FDeleter deleter) { deleter_ = deleter; }
+
+  // Expose DecRef and IncRef as public function
+  // NOTE: they are only for developer purposes only.
+  using Object::DecRef;
+  using Object::IncRef;
+
+  // Information for object protocol.
+  static constexpr const uint32_t _type_index = TypeIndex::kRuntimeNDArray;
+  static constexpr const uint32_t _type_child_slots = 0;
+  static constexpr const uint32_t _type_child_slots_can_overflow = true;
+  static constexpr const char* _type_key = "runtime.NDArray";
+  CVM_DECLARE_BASE_OBJECT_INFO(NDArray::Container, Object);
+
+ protected:
   friend class NDArray;
 };
 
+/*!
+ * \brief return the size of data the DLTensor hold, in term of number of bytes
+ *
+ *  \param arr the input DLTensor
+ *  \return number of  bytes of data in the DLTensor.
+ */
+inline size_t GetDataSize(const DLTensor& arr) {
+  size_t size = 1;
+  for (int i = 0; i < arr.ndim; ++i) {
+    size *= static_cast<size_t>(arr.shape[i]);
+  }
+  size *= (arr.dtype.bits * arr.dtype.lanes + 7) / 8;
+  return size;
+}
+
+/*!
+ * \brief check if a DLTensor is contiguous.
+ * \param arr The input DLTensor.
+ * \return The check result.
+ */
+inline bool IsContiguous(const DLTensor& arr) {
+  if (arr.strides == nullptr) return true;
+  int64_t expected_stride = 1;
+  for (int32_t i = arr.ndim; i != 0; --i) {
+    int32_t k = i - 1;
+    if (arr.strides[k] != expected_stride) return false;
+    expected_stride *= arr.shape[k];
+  }
+  return true;
+}
+
+inline void NDArray::reset() { data_.reset(); }
+
+inline int NDArray::use_count() const { return data_.use_count(); }
+
+inline const DLTensor* NDArray::operator->() const { return &(get_mutable()->dl_tensor); }
+
+inline bool NDArray::IsContiguous() const {
+  return ::cvm::runtime::IsContiguous(get_mutable()->dl_tensor);
+}
+
+inline const std::vector<int64_t>& NDArray::Shape() const { return get_mutable()->shape_; }
+
+inline runtime::DataType NDArray::DataType() const {
+  return runtime::DataType(get_mutable()->dl_tensor.dtype);
+}
+
+inline void NDArray::CopyFrom(const DLTensor* other) {
+  ICHECK(data_ != nullptr);
+  CopyFromTo(other, &(get_mutable()->dl_tensor));
+}
+
+inline void NDArray::CopyFrom(const NDArray& other) {
+  ICHECK(data_ != nullptr);
+  ICHECK(other.data_ != nullptr);
+  CopyFromTo(&(other.get_mutable()->dl_tensor), &(get_mutable()->dl_tensor));
+}
+
+inline void NDArray::CopyTo(DLTensor* other) const {
+  ICHECK(data_ != nullptr);
+  CopyFromTo(&(get_mutable()->dl_tensor), other);
+}
+
+inline void NDArray::CopyTo(const NDArray& other) const {
+  ICHECK(data_ != nullptr);
+  ICHECK(other.data_ != nullptr);
+  CopyFromTo(&(get_mutable()->dl_tensor), &(other.get_mutable()->dl_tensor));
+}
+
+inline NDArray::Container* NDArray::get_mutable() const {
+  return static_cast<NDArray::Container*>(data_.get());
+}
+
 inline ObjectPtr<Object> NDArray::FFIDataFromHandle(CVMArrayHandle handle) {
   return GetObjectPtr<Object>(
       static_cast<NDArray::Container*>(reinterpret_cast<NDArray::ContainerBase*>(handle)));
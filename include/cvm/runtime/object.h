@@ -36,6 +36,8 @@ struct TypeIndex {
     // static assignments that may subject to change.
     kRuntimeClosure,
     kRuntimeADT,
+    /*! \brief runtime::ShapeTuple. */
+    kRuntimeShapeTuple,
     kStaticIndexEnd,
     /*! \brief Type index is allocated during runtime. */
     kDynamic = kStaticIndexEnd
@@ -205,7 +207,7 @@ class ObjectPtr {
    * \return reference to self.
    */
   ObjectPtr<T>& operator=(const ObjectPtr<T>& other) {
-    ObjectPtr(other).swap(this);
+    ObjectPtr(other).swap(*this);
     return *this;
   }
   /*!
@@ -270,6 +272,7 @@ class ObjectPtr {
   template <typename>
   friend class ObjAllocatorBase;
   friend class CVMRetValue;
+  friend class CVMArgsSetter;
   friend class CVMMovableArgValue_;
   template <typename RelayRefType, typename ObjType>
   friend RelayRefType GetRef(const ObjType* ptr);
@@ -373,6 +376,7 @@ class ObjectRef {
   }
 
   friend class CVMRetValue;
+  friend class CVMArgsSetter;
 };
 
 #define CVM_DECLARE_BASE_OBJECT_INFO(TypeName, ParentType)                                     \
@@ -124,11 +124,57 @@ inline const char* ArgTypeCode2Str(int type_code);
 #define CVM_CHECK_TYPE_CODE(CODE, T) \
   ICHECK_EQ(CODE, T) << "expected " << ArgTypeCode2Str(T) << " but got " << ArgTypeCode2Str(CODE)
 
+/*!
+ * \brief Type traits for runtime type check during FFI conversion.
+ * \tparam T the type to be checked.
+ */
 template <typename T>
-struct ObjectTypeChecker {};
+struct ObjectTypeChecker {
+  static bool Check(const Object* ptr) {
+    using ContainerType = typename T::ContainerType;
+    if (ptr == nullptr) return T::_type_is_nullable;
+    return ptr->IsInstance<ContainerType>();
+  }
+  static std::string TypeName() {
+    using ContainerType = typename T::ContainerType;
+    return ContainerType::_type_key;
+  }
+};
 
+// Additional overloads for PackedFunc checking.
 template <typename T>
-struct ObjectTypeChecker<Array<T>> {};
+struct ObjectTypeChecker<Array<T>> {
+  static bool Check(const Object* ptr) {
+    if (ptr == nullptr) return true;
+    if (!ptr->IsInstance<ArrayNode>()) return false;
+    const ArrayNode* n = static_cast<const ArrayNode*>(ptr);
+    for (const ObjectRef& p : *n) {
+      if (!ObjectTypeChecker<T>::Check(p.get())) {
+        return false;
+      }
+    }
+    return true;
+  }
+  static std::string TypeName() { return "Array[" + ObjectTypeChecker<T>::TypeName() + "]"; }
+};
+
+template <typename K, typename V>
+struct ObjectTypeChecker<Map<K, V>> {
+  static bool Check(const Object* ptr) {
+    if (ptr == nullptr) return true;
+    if (!ptr->IsInstance<MapNode>()) return false;
+    const MapNode* n = static_cast<const MapNode*>(ptr);
+    for (const auto& kv : n->data) {
+      if (!ObjectTypeChecker<K>::Check(kv.first.get())) return false;
+      if (!ObjectTypeChecker<V>::Check(kv.second.get())) return false;
+    }
+    return true;
+  }
+  static std::string TypeName() {
+    return "Map[" + ObjectTypeChecker<K>::TypeName() + ", " + ObjectTypeChecker<V>::TypeName() +
+           ']';
+  }
+};
 
 class CVMPODValue_ {
  public:
@@ -176,7 +222,11 @@ class CVMPODValue_ {
   operator NDArray() const {  // NOLINT
     if (type_code_ == kCVMNullptr) return NDArray(ObjectPtr<Object>(nullptr));
     CVM_CHECK_TYPE_CODE(type_code_, kCVMNDArrayHandle);
-    return NDArray();
+    return NDArray(NDArray::FFIDataFromHandle(static_cast<CVMArrayHandle>(value_.v_handle)));
+  }
+  operator Device() const {  // NOLINT
+    CVM_CHECK_TYPE_CODE(type_code_, kDLDevice);
+    return value_.v_device;
   }
 
   template <typename T>
@@ -216,6 +266,7 @@ class CVMArgValue : public CVMPODValue_ {
   using CVMPODValue_::operator void*;
   using CVMPODValue_::operator DLTensor*;
   using CVMPODValue_::operator NDArray;
+  using CVMPODValue_::operator Device;
 
   operator std::string() const {  // NOLINT
     if (type_code_ == kCVMDataType) {
@@ -261,7 +312,7 @@ class CVMMovableArgValue_ : public CVMPODValue_ {
   using CVMPODValue_::operator void*;
   using CVMPODValue_::operator DLTensor*;
   using CVMPODValue_::operator NDArray;
-  //  using CVMPODValue_::operator Device ;
+  using CVMPODValue_::operator Device;
 
   operator std::string() const { return AsArgValue().operator std::string(); }  // NOLINT
   operator PackedFunc() const { return AsArgValue().operator PackedFunc(); }    // NOLINT
@@ -289,7 +340,7 @@ class CVMMovableArgValueWithContext_ {
 
   template <typename T>
   operator T() const {
-    // TODO:
+    return value_;  // implicit conversion happens here.
   }
 
  private:
@@ -316,6 +367,7 @@ class CVMRetValue : public CVMPODValue_ {
   using CVMPODValue_::operator void*;
   using CVMPODValue_::operator DLTensor*;
   using CVMPODValue_::operator NDArray;
+  using CVMPODValue_::operator Device;
 
   CVMRetValue(const CVMRetValue& other) : CVMPODValue_() { this->Assign(other); }  // NOLINT
 
@@ -564,6 +616,25 @@ struct PackedFuncValueConverter {
   static TObjectRef From(const CVMRetValue& val) { return val.AsObjectRef<TObjectRef>(); }
 };
 
+template <>
+struct PackedFuncValueConverter<String> {
+  static String From(const CVMArgValue& val) {
+    if (val.IsObjectRef<String>()) {
+      return val.AsObjectRef<String>();
+    } else {
+      return String(val.operator std::string());
+    }
+  }
+
+  static String From(const CVMRetValue& val) {
+    if (val.IsObjectRef<String>()) {
+      return val.AsObjectRef<String>();
+    } else {
+      return String(val.operator std::string());
+    }
+  }
+};
+
 namespace detail {
 template <bool stop, std::size_t I, typename F>
 struct for_each_dispatcher {
@@ -603,7 +674,17 @@ struct func_signature_helper<R (T::*)(Args...) const> {
 
 template <typename T>
 struct function_signature {
-  using FType = typename func_signature_helper<decltype(&T::operator())>::type;
+  using FType = typename func_signature_helper<decltype(&T::operator())>::FType;
+};
+
+template <typename R, typename... Args>
+struct function_signature<R(Args...)> {
+  using FType = R(Args...);
+};
+
+template <typename R, typename... Args>
+struct function_signature<R (*)(Args...)> {
+  using FType = R(Args...);
 };
 
 template <typename R, typename... Args>
@@ -688,7 +769,7 @@ class CVMArgsSetter {
   }
   template <typename FType>
   CVM_ALWAYS_INLINE void operator()(size_t i, const TypedPackedFunc<FType>& value) const {
-    // TODO
+    operator()(i, value.packed());
   }
   void operator()(size_t i, const CVMRetValue& value) const {
     if (value.type_code() == kCVMStr) {
@@ -703,13 +784,13 @@ class CVMArgsSetter {
   template <typename TObjectRef,
             typename = typename std::enable_if<std::is_base_of<ObjectRef, TObjectRef>::value>::type>
   CVM_ALWAYS_INLINE void operator()(size_t i, const TObjectRef& value) const {
-    this->template SetObjectRef(i, value);
+    this->SetObjectRef(i, value);
   }
   template <typename TObjectRef,
             typename = typename std::enable_if<std::is_base_of<
                 ObjectRef, typename std::remove_reference<TObjectRef>::type>::value>::type>
   CVM_ALWAYS_INLINE void operator()(size_t i, TObjectRef&& value) const {
-    this->template SetObjectRef(i, std::forward<TObjectRef>(value));
+    this->SetObjectRef(i, std::forward<TObjectRef>(value));
   }
 
  private:
@@ -858,13 +939,20 @@ inline void TypedPackedFunc<R(Args...)>::AssignTypedLambda(FLambda flambda) {
 template <typename TObjectRef, typename>
 inline bool CVMPODValue_::IsObjectRef() const {
   using ContainerType = typename TObjectRef::ContainerType;
+  // NOTE: the following code can be optimized by constant folding.
   if (std::is_base_of<NDArray::ContainerType, ContainerType>::value) {
     return type_code_ == kCVMNDArrayHandle &&
            CVMArrayHandleToObjectHandle(static_cast<CVMArrayHandle>(value_.v_handle))
                ->IsInstance<ContainerType>();
   }
-  // TODO
-  // TODO
+  // NOTE: we don't pass NDArray as RValue ref.
+  if (type_code_ == kCVMObjectRValueRefArg) {
+    return ObjectTypeChecker<TObjectRef>::Check(*static_cast<Object**>(value_.v_handle));
+  }
+  return (std::is_base_of<ContainerType, NDArray::ContainerType>::value &&
+          type_code_ == kCVMNDArrayHandle) ||
+         (type_code_ == kCVMObjectHandle &&
+          ObjectTypeChecker<TObjectRef>::Check(static_cast<Object*>(value_.v_handle)));
 }
 
 template <typename TObjectRef>
@@ -878,7 +966,83 @@ inline TObjectRef CVMPODValue_::AsObjectRef() const {
         << "Expect a not null value of " << ContainerType::_type_key;
     return TObjectRef(ObjectPtr<Object>(nullptr));
   }
-  // TODO
+  // NOTE: the following code can be optimized by constant folding.
+  if (std::is_base_of<NDArray::ContainerType, ContainerType>::value) {
+    // Casting to a sub-class of NDArray
+    CVM_CHECK_TYPE_CODE(type_code_, kCVMNDArrayHandle);
+    ObjectPtr<Object> data =
+        NDArray::FFIDataFromHandle(static_cast<CVMArrayHandle>(value_.v_handle));
+    ICHECK(data->IsInstance<ContainerType>())
+        << "Expected " << ContainerType::_type_key << " but got " << data->GetTypeKey();
+    return TObjectRef(data);
+  }
+  if (type_code_ == kCVMObjectHandle) {
+    // normal object type check.
+    Object* ptr = static_cast<Object*>(value_.v_handle);
+    ICHECK(ObjectTypeChecker<TObjectRef>::Check(ptr))
+        << "Expected " << ObjectTypeChecker<TObjectRef>::TypeName() << " but got "
+        << ptr->GetTypeKey();
+    return TObjectRef(GetObjectPtr<Object>(ptr));
+  } else if (type_code_ == kCVMObjectRValueRefArg) {
+    Object* ptr = *static_cast<Object**>(value_.v_handle);
+    ICHECK(ObjectTypeChecker<TObjectRef>::Check(ptr))
+        << "Expected " << ObjectTypeChecker<TObjectRef>::TypeName() << " but got "
+        << ptr->GetTypeKey();
+    return TObjectRef(GetObjectPtr<Object>(ptr));
+  } else if (std::is_base_of<ContainerType, NDArray::ContainerType>::value &&
+             type_code_ == kCVMNDArrayHandle) {
+    // Casting to a base class that NDArray can sub-class
+    ObjectPtr<Object> data =
+        NDArray::FFIDataFromHandle(static_cast<CVMArrayHandle>(value_.v_handle));
+    return TObjectRef(data);
+  } else {
+    CVM_CHECK_TYPE_CODE(type_code_, kCVMObjectHandle);
+    return TObjectRef(ObjectPtr<Object>(nullptr));
+  }
+}
+
+template <typename TObjectRef, typename>
+inline CVMRetValue& CVMRetValue::operator=(TObjectRef other) {
+  using ContainerType = typename TObjectRef::ContainerType;
+  const Object* ptr = other.get();
+  if (ptr != nullptr) {
+    if (std::is_base_of<NDArray::ContainerType, ContainerType>::value ||
+        (std::is_base_of<ContainerType, NDArray::ContainerType>::value &&
+         ptr->IsInstance<NDArray::ContainerType>())) {
+      return operator=(NDArray(std::move(other.data_)));
+    }
+    SwitchToObject(kCVMObjectHandle, std::move(other.data_));
+  } else {
+    SwitchToPOD(kCVMNullptr);
+  }
+  return *this;
+}
+
+template <typename T, typename>
+inline CVMRetValue::operator T() const {
+  return PackedFuncValueConverter<T>::From(*this);
+}
+
+template <typename TObjectRef>
+inline void CVMArgsSetter::SetObjectRef(size_t i, TObjectRef&& value) const {
+  using ContainerType = typename std::remove_reference<TObjectRef>::type::ContainerType;
+  if (value.defined()) {
+    Object* ptr = value.data_.data_;
+    if (std::is_base_of<NDArray::ContainerType, ContainerType>::value ||
+        (std::is_base_of<ContainerType, NDArray::ContainerType>::value &&
+         ptr->IsInstance<NDArray::ContainerType>())) {
+      values_[i].v_handle = NDArray::FFIGetHandle(value);
+      type_codes_[i] = kCVMNDArrayHandle;
+    } else if (std::is_rvalue_reference<decltype(value)>::value) {
+      values_[i].v_handle = const_cast<Object**>(&(value.data_.data_));
+      type_codes_[i] = kCVMObjectRValueRefArg;
+    } else {
+      values_[i].v_handle = value.data_.data_;
+      type_codes_[i] = kCVMObjectHandle;
+    }
+  } else {
+    type_codes_[i] = kCVMNullptr;
+  }
 }
 
 template <typename T, typename>
@@ -41,6 +41,7 @@ class Registry {
   template <typename FLambda>
   Registry& set_body_typed(FLambda f) {
     using FType = typename detail::function_signature<FLambda>::FType;
+    return set_body(TypedPackedFunc<FType>(std::move(f), name_).packed());
   }
   /*!
    * \brief Set the body of the function to be the passed method pointer.
@@ -118,6 +119,19 @@ class Registry {
   PackedFunc func_;
 };
 
+#define CVM_FUNC_REG_VAR_DEF static CVM_ATTRIBUTE_UNUSED ::cvm::runtime::Registry& __mk_##CVM
+
+/*!
+ * \brief Register a function globally.
+ * \code
+ *   CVM_REGISTER_GLOBAL("MyPrint")
+ *   .set_body([](CVMArgs args, CVMRetValue* rv) {
+ *   });
+ * \endcode
+ */
+#define CVM_REGISTER_GLOBAL(OpName) \
+  CVM_STR_CONCAT(CVM_FUNC_REG_VAR_DEF, __COUNTER__) = ::cvm::runtime::Registry::Register(OpName)
+
 }  // namespace runtime
 }  // namespace cvm
 
@@ -0,0 +1,52 @@
+//
+// Created by WangJingYu on 2021/7/14.
+//
+
+#ifndef CVM_INCLUDE_CVM_RUNTIME_THREADING_BACKEND_H_
+#define CVM_INCLUDE_CVM_RUNTIME_THREADING_BACKEND_H_
+
+#include <cvm/runtime/c_runtime_api.h>
+
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+namespace threading {
+
+/*!
+ * \brief Get the maximum number of threads the runtime should use.
+ *
+ *  The value is read from CVM_NUM_THREADS, then OMP_NUM_THREADS, and falls back
+ *  to the number of hardware threads when neither is set.
+ *
+ * \return The number of threads, at least 1.
+ */
+CVM_DLL int MaxConcurrency();
+
+/*!
+ * \return The number of threads of the runtime thread pool, the calling thread included.
+ */
+CVM_DLL int NumThreads();
+
+/*!
+ * \return The CPUs the process is allowed to run on.
+ */
+CVM_DLL std::vector<unsigned> GetAvailableCPUs();
+
+/*!
+ * \brief Bind the calling thread to a set of CPUs.
+ * \param cpus The CPUs, the thread is left unbound when empty.
+ * \return Whether the affinity has been applied.
+ */
+CVM_DLL bool SetCurrentThreadAffinity(const std::vector<unsigned>& cpus);
+
+/*!
+ * \brief Yield the rest of the time slice of the calling thread to the other runnable ones.
+ */
+CVM_DLL void Yield();
+
+}  // namespace threading
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_INCLUDE_CVM_RUNTIME_THREADING_BACKEND_H_
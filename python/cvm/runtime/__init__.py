@@ -1 +1,3 @@
 from .packed_func import PackedFunc
+from .container import ADT, tuple_object
+from .module import Module, load_module, system_lib
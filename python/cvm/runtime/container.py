@@ -0,0 +1,64 @@
+"""Runtime container structures."""
+from cvm._ffi import register_object, get_global_func
+from .object import Object
+
+_ADT = get_global_func("runtime.ADT")
+_Tuple = get_global_func("runtime.Tuple")
+_GetADTTag = get_global_func("runtime.GetADTTag")
+_GetADTSize = get_global_func("runtime.GetADTSize")
+_GetADTFields = get_global_func("runtime.GetADTFields")
+
+
+@register_object("runtime.ADT")
+class ADT(Object):
+    """Algebraic data type: the tag of its constructor and its fields.
+
+    Indexing returns the field object itself, nothing is copied.
+
+    Parameters
+    ----------
+    tag : int
+        The tag of the constructor, 0 for a tuple.
+
+    fields : list[Object] or tuple[Object]
+        The fields of the ADT.
+    """
+
+    def __init__(self, tag, fields):
+        for f in fields:
+            assert isinstance(f, Object), f"Expect an object, got {type(f)}"
+        self.__init_handle_by_constructor__(_ADT, tag, *fields)
+
+    @property
+    def tag(self):
+        return _GetADTTag(self)
+
+    def __getitem__(self, idx):
+        size = len(self)
+        if isinstance(idx, slice):
+            return [self[i] for i in range(*idx.indices(size))]
+        if idx < -size or idx >= size:
+            raise IndexError(f"ADT index {idx} out of range {size}")
+        return _GetADTFields(self, idx + size if idx < 0 else idx)
+
+    def __len__(self):
+        return _GetADTSize(self)
+
+
+def tuple_object(fields=None):
+    """Create an ADT object of tag 0 from the fields.
+
+    Parameters
+    ----------
+    fields : list[Object] or tuple[Object]
+        The fields of the tuple.
+
+    Returns
+    -------
+    ret : ADT
+        The tuple.
+    """
+    fields = fields if fields else []
+    for f in fields:
+        assert isinstance(f, Object), f"Expect an object, got {type(f)}"
+    return _Tuple(*fields)
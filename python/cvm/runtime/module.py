@@ -0,0 +1,90 @@
+"""Runtime modules: libraries of functions and executors."""
+from cvm._ffi import register_object, get_global_func
+from .object import Object
+
+_ModuleGetFunction = get_global_func("runtime.ModuleGetFunction")
+_ModuleImport = get_global_func("runtime.ModuleImport")
+_ModuleLoadFromFile = get_global_func("runtime.ModuleLoadFromFile")
+_ModuleGetTypeKey = get_global_func("runtime.ModuleGetTypeKey")
+_ModuleNumImports = get_global_func("runtime.ModuleNumImports")
+_ModuleGetImport = get_global_func("runtime.ModuleGetImport")
+_SystemLib = get_global_func("runtime.SystemLib")
+
+
+@register_object("runtime.Module")
+class Module(Object):
+    """A module: a loaded library, the system library or an executor.
+
+    The lookups of a module are memoized, looking up a name again is a hash probe.
+    """
+
+    @property
+    def type_key(self):
+        """The kind of the module, e.g. "library"."""
+        return _ModuleGetTypeKey(self)
+
+    @property
+    def imported_modules(self):
+        """The modules imported by this module."""
+        return [_ModuleGetImport(self, i) for i in range(_ModuleNumImports(self))]
+
+    def get_function(self, name, query_imports=False):
+        """Get a function of the module.
+
+        Parameters
+        ----------
+        name : str
+            The name of the function.
+
+        query_imports : bool
+            Whether to also look into the imported modules.
+
+        Returns
+        -------
+        f : PackedFunc
+            The function, it keeps the module alive.
+        """
+        f = _ModuleGetFunction(self, name, query_imports)
+        if f is None:
+            raise AttributeError(f"Module has no function {name}")
+        return f
+
+    def import_module(self, module):
+        """Import another module, an import cycle raises an error."""
+        _ModuleImport(self, module)
+
+    def __getitem__(self, name):
+        if not isinstance(name, str):
+            raise ValueError("Can only take string as function name")
+        return self.get_function(name)
+
+
+def load_module(path, fmt=""):
+    """Load a module from a file.
+
+    Parameters
+    ----------
+    path : str
+        The path of the file, a shared library exporting CVMBackendPackedCFunc functions.
+
+    fmt : str
+        The format of the file, deduced from its extension when empty.
+
+    Returns
+    -------
+    module : Module
+        The loaded module.
+    """
+    return _ModuleLoadFromFile(path, fmt)
+
+
+def system_lib():
+    """Get the module of the system library: the functions of statically linked code
+    registered by CVMBackendRegisterSystemLibSymbol.
+
+    Returns
+    -------
+    module : Module
+        The system library, a singleton.
+    """
+    return _SystemLib()
@@ -0,0 +1,26 @@
+import cvm
+from cvm.runtime import ADT, tuple_object
+
+
+def test_adt():
+    a = tuple_object([cvm.get_global_func("runtime.String")("a")])
+    b = tuple_object([a, a])
+    assert isinstance(b, ADT)
+    assert b.tag == 0
+    assert len(b) == 2
+    # indexing returns the field itself, not a copy.
+    assert b[0].handle.value == a.handle.value
+    assert len(b[-1]) == 1
+    assert len(b[0:1]) == 1
+
+    c = ADT(3, [a, b])
+    assert c.tag == 3
+    assert len(c[1]) == 2
+    try:
+        c[2]
+        assert False
+    except IndexError:
+        pass
+
+
+test_adt()
@@ -0,0 +1,95 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include "alloc_counter.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+
+#if defined(CVM_ALLOC_HOOK) && defined(__GLIBC__)
+#define CVM_ALLOC_HOOK_ACTIVE 1
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace {
+
+/*! \brief The allocations of the thread, initial-exec to never allocate on access. */
+__thread int64_t thread_allocs __attribute__((tls_model("initial-exec"))) = 0;
+
+}  // namespace
+
+extern "C" {
+
+void* malloc(size_t size) {
+  ++thread_allocs;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+  ++thread_allocs;
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  ++thread_allocs;
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  ++thread_allocs;
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  ++thread_allocs;
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+  if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+  ++thread_allocs;
+  void* ptr = __libc_memalign(alignment, size);
+  if (ptr == nullptr) return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+
+}  // extern "C"
+#endif
+
+namespace cvm {
+namespace runtime {
+
+int64_t ThreadAllocationCount() {
+#ifdef CVM_ALLOC_HOOK_ACTIVE
+  return thread_allocs;
+#else
+  return 0;
+#endif
+}
+
+bool AllocationHookEnabled() {
+#ifdef CVM_ALLOC_HOOK_ACTIVE
+  // an allocation of the library counts unless the malloc of libc was bound first.
+  static const bool enabled = []() {
+    void* (*volatile alloc)(size_t) = std::malloc;
+    int64_t before = thread_allocs;
+    void* ptr = alloc(16);
+    std::free(ptr);
+    return thread_allocs != before;
+  }();
+  return enabled;
+#else
+  return false;
+#endif
+}
+
+}  // namespace runtime
+}  // namespace cvm
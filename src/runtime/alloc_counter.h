@@ -0,0 +1,45 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file alloc_counter.h
+ * \brief Counts the heap allocations of a thread, to check code meant to run without.
+ *
+ *  Built with CVM_ALLOC_HOOK, which the USE_ALLOC_HOOK option of CMake defines, off by
+ *  default, the library replaces malloc, calloc, realloc and the aligned allocations of
+ *  glibc by forwarders counting the calls of every thread. operator new goes through
+ *  malloc and is counted too. The replacement only takes effect when the library is
+ *  linked at load time or loaded with RTLD_GLOBAL, AllocationHookEnabled tells whether
+ *  it does.
+ */
+#ifndef CVM_SRC_RUNTIME_ALLOC_COUNTER_H_
+#define CVM_SRC_RUNTIME_ALLOC_COUNTER_H_
+
+#include <cstdint>
+
+namespace cvm {
+namespace runtime {
+
+/*! \return Whether the allocations are counted, false in release builds. */
+bool AllocationHookEnabled();
+
+/*! \return The heap allocations of the calling thread so far, 0 when not counted. */
+int64_t ThreadAllocationCount();
+
+/*! \brief Counts the heap allocations of the calling thread from its construction on. */
+class AllocationCounter {
+ public:
+  AllocationCounter() : start_(ThreadAllocationCount()) {}
+
+  /*! \return The allocations since the construction. */
+  int64_t count() const { return ThreadAllocationCount() - start_; }
+
+ private:
+  int64_t start_;
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_ALLOC_COUNTER_H_
@@ -0,0 +1,352 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include "auto_tuner.h"
+
+#include <cvm/runtime/logging.h>
+#include <cvm/runtime/registry.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace cvm {
+namespace runtime {
+
+std::string ConfigToString(const TuningConfig& config) {
+  std::string str;
+  for (const auto& kv : config) {
+    if (!str.empty()) str += ',';
+    str += kv.first + '=' + std::to_string(kv.second);
+  }
+  return str;
+}
+
+TuningConfig ParseConfig(const std::string& str) {
+  TuningConfig config;
+  std::istringstream is(str);
+  std::string item;
+  while (std::getline(is, item, ',')) {
+    size_t eq = item.find('=');
+    size_t end = 0;
+    int64_t value = 0;
+    try {
+      if (eq != std::string::npos) value = std::stoll(item.substr(eq + 1), &end);
+    } catch (const std::exception&) {
+      end = 0;
+    }
+    if (eq == 0 || eq == std::string::npos || end == 0 || eq + 1 + end != item.size() ||
+        !config.emplace(item.substr(0, eq), value).second) {
+      throw Error("ParseConfig: malformed knob \"" + item + "\" in \"" + str + "\"");
+    }
+  }
+  return config;
+}
+
+void ConfigSpace::Define(const std::string& name, std::vector<int64_t> values) {
+  if (values.empty()) throw Error("ConfigSpace: knob " + name + " has no value");
+  for (const Knob& knob : knobs_) {
+    if (knob.name == name) throw Error("ConfigSpace: knob " + name + " is defined twice");
+  }
+  knobs_.push_back(Knob{name, std::move(values)});
+}
+
+int64_t ConfigSpace::size() const {
+  int64_t size = 1;
+  for (const Knob& knob : knobs_) size *= static_cast<int64_t>(knob.values.size());
+  return size;
+}
+
+TuningConfig ConfigSpace::Get(int64_t index) const {
+  ICHECK(index >= 0 && index < size());
+  TuningConfig config;
+  for (const Knob& knob : knobs_) {
+    int64_t radix = static_cast<int64_t>(knob.values.size());
+    config[knob.name] = knob.values[index % radix];
+    index /= radix;
+  }
+  return config;
+}
+
+int64_t ConfigSpace::IndexOf(const TuningConfig& config) const {
+  if (config.size() != knobs_.size()) return -1;
+  int64_t index = 0, stride = 1;
+  for (const Knob& knob : knobs_) {
+    auto it = config.find(knob.name);
+    if (it == config.end()) return -1;
+    auto pos = std::find(knob.values.begin(), knob.values.end(), it->second);
+    if (pos == knob.values.end()) return -1;
+    index += (pos - knob.values.begin()) * stride;
+    stride *= static_cast<int64_t>(knob.values.size());
+  }
+  return index;
+}
+
+int64_t ConfigSpace::Neighbor(int64_t index, std::mt19937_64* rng) const {
+  std::vector<int> movable;
+  for (size_t i = 0; i < knobs_.size(); ++i) {
+    if (knobs_[i].values.size() > 1) movable.push_back(static_cast<int>(i));
+  }
+  if (movable.empty()) return index;
+  int knob = movable[(*rng)() % movable.size()];
+  int64_t stride = 1;
+  for (int i = 0; i < knob; ++i) stride *= static_cast<int64_t>(knobs_[i].values.size());
+  const int64_t radix = static_cast<int64_t>(knobs_[knob].values.size());
+  const int64_t digit = index / stride % radix;
+  // one step up or down, the other way at the ends.
+  int64_t step = (*rng)() % 2 == 0 ? 1 : -1;
+  if (digit + step < 0 || digit + step >= radix) step = -step;
+  return index + step * stride;
+}
+
+double RobustMean(std::vector<double> samples, double outlier_mads, int* num_kept) {
+  ICHECK(!samples.empty());
+  auto median = [](std::vector<double> values) {
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    double upper = values[mid];
+    if (values.size() % 2 != 0) return upper;
+    return (*std::max_element(values.begin(), values.begin() + mid) + upper) / 2;
+  };
+  const double center = median(samples);
+  std::vector<double> deviations;
+  for (double s : samples) deviations.push_back(std::abs(s - center));
+  const double mad = median(deviations);
+  double sum = 0;
+  int kept = 0;
+  for (double s : samples) {
+    if (mad > 0 && std::abs(s - center) > outlier_mads * mad) continue;
+    sum += s;
+    ++kept;
+  }
+  if (num_kept != nullptr) *num_kept = kept;
+  return sum / kept;
+}
+
+LocalRunner::LocalRunner(MeasureOptions options) : options_(options) {
+  if (options_.warmup < 0 || options_.repeat < 1 || options_.number < 1) {
+    throw Error("LocalRunner: expect warmup >= 0, repeat >= 1 and number >= 1");
+  }
+}
+
+MeasureResult LocalRunner::Measure(const std::function<void()>& func) const {
+  using Clock = std::chrono::steady_clock;
+  MeasureResult result;
+  auto run = [&](int number) {
+    Clock::time_point begin = Clock::now();
+    for (int i = 0; i < number; ++i) func();
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+  };
+  try {
+    for (int i = 0; i < options_.warmup; ++i) func();
+    int number = options_.number;
+    if (options_.min_repeat_ms > 0) {
+      // grow the runs of a sample until it lasts min_repeat_ms, as the timer is coarse.
+      for (double ms = run(number) * 1e3; ms < options_.min_repeat_ms; ms = run(number) * 1e3) {
+        double scale = ms > 0 ? options_.min_repeat_ms / ms * 1.2 : 10.0;
+        number = static_cast<int>(std::min(number * std::max(scale, 2.0), 1e9));
+      }
+    }
+    std::vector<double> samples;
+    for (int r = 0; r < options_.repeat; ++r) samples.push_back(run(number) / number);
+    result.seconds = RobustMean(samples, options_.outlier_mads, &result.num_samples);
+  } catch (const std::exception& e) {
+    result.error = e.what();
+    result.seconds = std::numeric_limits<double>::infinity();
+  }
+  return result;
+}
+
+const TuningRecord* TuningLog::Best(const std::string& op, const std::string& workload) const {
+  const TuningRecord* best = nullptr;
+  for (const TuningRecord& record : records_) {
+    if (record.op != op || record.workload != workload) continue;
+    if (best == nullptr || record.seconds < best->seconds) best = &record;
+  }
+  return best;
+}
+
+void TuningLog::Save(const std::string& file_name) const {
+  std::ofstream fs(file_name);
+  if (!fs) throw Error("TuningLog: cannot open " + file_name + " for writing");
+  fs.precision(6);
+  for (const TuningRecord& r : records_) {
+    fs << r.op << '\t' << r.workload << '\t' << ConfigToString(r.config) << '\t'
+       << std::scientific << r.seconds << '\n';
+  }
+  if (!fs) throw Error("TuningLog: failed to write " + file_name);
+}
+
+TuningLog TuningLog::Load(const std::string& file_name) {
+  std::ifstream fs(file_name);
+  if (!fs) throw Error("TuningLog: cannot open " + file_name);
+  TuningLog log;
+  std::string line;
+  for (int line_no = 1; std::getline(fs, line); ++line_no) {
+    if (line.empty() || line[0] == '#') continue;
+    std::vector<std::string> fields;
+    std::istringstream is(line);
+    for (std::string field; std::getline(is, field, '\t');) fields.push_back(field);
+    TuningRecord record;
+    bool ok = fields.size() == 4;
+    if (ok) {
+      try {
+        size_t end = 0;
+        record.seconds = std::stod(fields[3], &end);
+        ok = end == fields[3].size() && record.seconds >= 0;
+        record.config = ParseConfig(fields[2]);
+      } catch (const std::exception&) {
+        ok = false;
+      }
+    }
+    if (!ok) {
+      throw Error("TuningLog: malformed record at " + file_name + ":" + std::to_string(line_no));
+    }
+    record.op = fields[0];
+    record.workload = fields[1];
+    log.Add(std::move(record));
+  }
+  return log;
+}
+
+TuningRecord Tuner::Tune(int num_trials, const Runner& runner, TuningLog* log) {
+  TuningRecord best{task_.op, task_.workload, {}, std::numeric_limits<double>::infinity()};
+  std::string last_error;
+  for (int trial = 0; trial < num_trials;) {
+    int64_t index = Next();
+    if (index < 0) break;
+    visited_.insert(index);
+    TuningConfig config = task_.space.Get(index);
+    std::function<void()> func = task_.instantiate(config);
+    if (func == nullptr) {
+      Update(index, std::numeric_limits<double>::infinity());
+      continue;
+    }
+    ++trial;
+    MeasureResult result = runner.Measure(func);
+    Update(index, result.seconds);
+    if (!result.ok()) {
+      last_error = result.error;
+      continue;
+    }
+    TuningRecord record{task_.op, task_.workload, std::move(config), result.seconds};
+    if (record.seconds < best.seconds) best = record;
+    if (log != nullptr) log->Add(std::move(record));
+  }
+  if (!std::isfinite(best.seconds)) {
+    throw Error("Tuner: no config of " + task_.op + " " + task_.workload + " ran" +
+                (last_error.empty() ? "" : ", last error: " + last_error));
+  }
+  return best;
+}
+
+int64_t Tuner::RandomUnvisited(std::mt19937_64* rng) const {
+  const int64_t size = task_.space.size();
+  if (static_cast<int64_t>(visited_.size()) >= size) return -1;
+  // the next unvisited config after a random one, the draws stay cheap in a small space.
+  int64_t index = static_cast<int64_t>((*rng)() % static_cast<uint64_t>(size));
+  while (visited_.count(index) != 0) index = (index + 1) % size;
+  return index;
+}
+
+int64_t GridSearchTuner::Next() {
+  while (next_ < task_.space.size() && visited_.count(next_) != 0) ++next_;
+  return next_ < task_.space.size() ? next_++ : -1;
+}
+
+int64_t RandomTuner::Next() { return RandomUnvisited(&rng_); }
+
+int64_t SimulatedAnnealingTuner::Next() {
+  if (current_ >= 0) {
+    for (int attempt = 0; attempt < 16; ++attempt) {
+      int64_t index = task_.space.Neighbor(current_, &rng_);
+      if (visited_.count(index) == 0) return index;
+    }
+  }
+  // the neighbors have all been measured, restart the walk anywhere.
+  return RandomUnvisited(&rng_);
+}
+
+void SimulatedAnnealingTuner::Update(int64_t index, double seconds) {
+  bool accept = current_ < 0 || seconds < current_seconds_;
+  if (!accept && std::isfinite(seconds)) {
+    double slowdown = seconds / current_seconds_ - 1;
+    accept = std::uniform_real_distribution<double>(0, 1)(rng_) <
+             std::exp(-slowdown / std::max(temperature_, 1e-9));
+  }
+  if (accept) {
+    current_ = index;
+    current_seconds_ = seconds;
+  }
+  temperature_ *= cooling_;
+}
+
+DispatchContext* DispatchContext::Global() {
+  static DispatchContext* context = []() {
+    DispatchContext* context = new DispatchContext();
+    const char* file_name = std::getenv("CVM_TUNING_LOG");
+    if (file_name != nullptr && file_name[0] != '\0') context->Apply(TuningLog::Load(file_name));
+    return context;
+  }();
+  return context;
+}
+
+void DispatchContext::Apply(const TuningLog& log) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::pair<std::string, std::string>, TuningRecord> applied;
+    for (const TuningRecord& record : log.records()) {
+      auto key = std::make_pair(record.op, record.workload);
+      auto it = applied.find(key);
+      if (it == applied.end() || record.seconds < it->second.seconds) applied[key] = record;
+    }
+    for (auto& kv : applied) best_[kv.first] = std::move(kv.second);
+  }
+  Notify();
+}
+
+void DispatchContext::Reset() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    best_.clear();
+  }
+  Notify();
+}
+
+bool DispatchContext::Lookup(const std::string& op, const std::string& workload,
+                             TuningConfig* config) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = best_.find(std::make_pair(op, workload));
+  if (it == best_.end()) return false;
+  *config = it->second.config;
+  return true;
+}
+
+void DispatchContext::OnChange(std::function<void()> callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  callbacks_.push_back(std::move(callback));
+}
+
+void DispatchContext::Notify() {
+  std::vector<std::function<void()>> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callbacks = callbacks_;
+  }
+  for (const auto& callback : callbacks) callback();
+}
+
+CVM_REGISTER_GLOBAL("runtime.ApplyTuningLog").set_body_typed([](std::string file_name) {
+  DispatchContext::Global()->Apply(TuningLog::Load(file_name));
+});
+
+CVM_REGISTER_GLOBAL("runtime.ResetTuning").set_body_typed([]() {
+  DispatchContext::Global()->Reset();
+});
+
+}  // namespace runtime
+}  // namespace cvm
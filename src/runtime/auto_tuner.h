@@ -0,0 +1,298 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file auto_tuner.h
+ * \brief Search of the knobs of the kernels, measured in process, as the AutoTVM of
+ *  docs/Design.md.
+ *
+ *  A kernel declares a TuningTask for a workload: a ConfigSpace of knobs (tile sizes,
+ *  splits, algorithms) and how to run the kernel with a config. A Tuner proposes configs,
+ *  by grid, random or simulated annealing search, a LocalRunner measures them and the
+ *  records go to a TuningLog, a text file of one record per line:
+ *
+ * \code
+ *  gemm	avx2/256x256x256/nn	kc=256,mc=96,nc=1024,threads=1	1.25e-03
+ * \endcode
+ *
+ *  The DispatchContext holds the best config of every workload of the logs applied to it,
+ *  the kernels select it over their defaults for the workloads it has. A log named by
+ *  CVM_TUNING_LOG is applied at the first dispatch.
+ */
+#ifndef CVM_SRC_RUNTIME_AUTO_TUNER_H_
+#define CVM_SRC_RUNTIME_AUTO_TUNER_H_
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief A configuration, the value of every knob by name. */
+using TuningConfig = std::map<std::string, int64_t>;
+
+/*! \return The config as "kc=256,mc=96". */
+std::string ConfigToString(const TuningConfig& config);
+
+/*! \return The config of ConfigToString, throws an Error when malformed. */
+TuningConfig ParseConfig(const std::string& str);
+
+/*! \brief A tunable parameter and the values it may take. */
+struct Knob {
+  std::string name;
+  /*! \brief The values, in the order the neighbors of simulated annealing follow. */
+  std::vector<int64_t> values;
+};
+
+/*!
+ * \brief The configs of a task, every combination of the values of its knobs. A config is
+ *  numbered in mixed radix, the first knob varying fastest.
+ */
+class ConfigSpace {
+ public:
+  /*! \brief Declare a knob, throws an Error for no value or a name declared before. */
+  void Define(const std::string& name, std::vector<int64_t> values);
+
+  /*! \return The number of configs. */
+  int64_t size() const;
+
+  const std::vector<Knob>& knobs() const { return knobs_; }
+
+  /*! \return The config of an index in [0, size()). */
+  TuningConfig Get(int64_t index) const;
+
+  /*! \return The index of a config, -1 when it is not in the space. */
+  int64_t IndexOf(const TuningConfig& config) const;
+
+  /*! \return A config one step away from index on one knob, index when there is none. */
+  int64_t Neighbor(int64_t index, std::mt19937_64* rng) const;
+
+ private:
+  std::vector<Knob> knobs_;
+};
+
+/*! \brief A kernel and the workload it is tuned for. */
+struct TuningTask {
+  /*! \brief The op, "gemm" or "conv2d". */
+  std::string op;
+  /*! \brief The name of the workload in the logs, with the shapes and the SIMD level. */
+  std::string workload;
+  ConfigSpace space;
+  /*! \brief The floating point operations of one run. */
+  double flops{0};
+  /*! \brief The kernel with a config, null when the config does not apply to the workload. */
+  std::function<std::function<void()>(const TuningConfig&)> instantiate;
+};
+
+/*! \brief How the runner measures a kernel. */
+struct MeasureOptions {
+  /*! \brief The runs before the measurement, to warm the caches and the thread pool. */
+  int warmup{1};
+  /*! \brief The samples measured. */
+  int repeat{10};
+  /*! \brief The runs of a sample. */
+  int number{1};
+  /*! \brief The shortest sample, number grows until a sample lasts that long. */
+  double min_repeat_ms{0};
+  /*!
+   * \brief The samples further from the median than this many median absolute deviations
+   *  are outliers, preempted or migrated runs.
+   */
+  double outlier_mads{3.0};
+};
+
+/*! \brief The measurement of a config. */
+struct MeasureResult {
+  /*! \brief The mean seconds of a run over the samples kept, infinity on errors. */
+  double seconds{std::numeric_limits<double>::infinity()};
+  /*! \brief The samples kept. */
+  int num_samples{0};
+  /*! \brief The message of the Error of the kernel, empty when it ran. */
+  std::string error;
+
+  bool ok() const { return error.empty(); }
+};
+
+/*!
+ * \return The mean of the samples within outlier_mads median absolute deviations of the
+ *  median, all the samples when they do not deviate.
+ * \param num_kept The samples kept, when not null.
+ */
+double RobustMean(std::vector<double> samples, double outlier_mads, int* num_kept = nullptr);
+
+/*! \brief Measures the kernels of the tuners. */
+class Runner {
+ public:
+  virtual ~Runner() = default;
+
+  /*! \brief Measure a kernel, an Error it throws is reported in the result. */
+  virtual MeasureResult Measure(const std::function<void()>& func) const = 0;
+};
+
+/*! \brief Measures kernels on the calling thread, in process. */
+class LocalRunner : public Runner {
+ public:
+  explicit LocalRunner(MeasureOptions options = MeasureOptions());
+
+  MeasureResult Measure(const std::function<void()>& func) const final;
+
+  const MeasureOptions& options() const { return options_; }
+
+ private:
+  MeasureOptions options_;
+};
+
+/*! \brief A measured config. */
+struct TuningRecord {
+  std::string op;
+  std::string workload;
+  TuningConfig config;
+  double seconds;
+};
+
+/*! \brief The records of tuning sessions. */
+class TuningLog {
+ public:
+  void Add(TuningRecord record) { records_.push_back(std::move(record)); }
+
+  const std::vector<TuningRecord>& records() const { return records_; }
+
+  /*! \return The fastest record of a workload, null when there is none. */
+  const TuningRecord* Best(const std::string& op, const std::string& workload) const;
+
+  /*! \brief Write the records to a file, throws an Error when it cannot be written. */
+  void Save(const std::string& file_name) const;
+
+  /*! \return The records of a file, throws an Error when it is missing or malformed. */
+  static TuningLog Load(const std::string& file_name);
+
+ private:
+  std::vector<TuningRecord> records_;
+};
+
+/*! \brief The search of the configs of a task. */
+class Tuner {
+ public:
+  explicit Tuner(TuningTask task) : task_(std::move(task)) {}
+  virtual ~Tuner() = default;
+
+  /*!
+   * \brief Measure up to num_trials configs, each one once, configs that do not apply to
+   *  the workload are skipped without a trial.
+   * \param log The log the records are added to, when not null.
+   * \return The fastest record, throws an Error when no config ran.
+   */
+  TuningRecord Tune(int num_trials, const Runner& runner, TuningLog* log = nullptr);
+
+  const TuningTask& task() const { return task_; }
+
+ protected:
+  /*! \return The index of the next config to measure, -1 when the search is over. */
+  virtual int64_t Next() = 0;
+
+  /*! \brief The seconds of a config, infinity when it failed or does not apply. */
+  virtual void Update(int64_t /*index*/, double /*seconds*/) {}
+
+  /*! \return A config not measured yet, -1 when they all have been. */
+  int64_t RandomUnvisited(std::mt19937_64* rng) const;
+
+  TuningTask task_;
+  /*! \brief The configs proposed so far. */
+  std::unordered_set<int64_t> visited_;
+};
+
+/*! \brief Every config in order. */
+class GridSearchTuner : public Tuner {
+ public:
+  explicit GridSearchTuner(TuningTask task) : Tuner(std::move(task)) {}
+
+ protected:
+  int64_t Next() final;
+
+ private:
+  int64_t next_{0};
+};
+
+/*! \brief Configs drawn uniformly without repetition. */
+class RandomTuner : public Tuner {
+ public:
+  explicit RandomTuner(TuningTask task, uint64_t seed = 0) : Tuner(std::move(task)), rng_(seed) {}
+
+ protected:
+  int64_t Next() final;
+
+ private:
+  std::mt19937_64 rng_;
+};
+
+/*!
+ * \brief A walk over neighboring configs on the measured times: a faster neighbor is
+ *  always taken, a slower one with a probability of exp(-slowdown / temperature), the
+ *  temperature cooling at every trial.
+ */
+class SimulatedAnnealingTuner : public Tuner {
+ public:
+  /*!
+   * \param temperature The initial temperature, in relative slowdown.
+   * \param cooling The factor of the temperature after every trial.
+   */
+  explicit SimulatedAnnealingTuner(TuningTask task, uint64_t seed = 0, double temperature = 0.5,
+                                   double cooling = 0.95)
+      : Tuner(std::move(task)), rng_(seed), temperature_(temperature), cooling_(cooling) {}
+
+ protected:
+  int64_t Next() final;
+  void Update(int64_t index, double seconds) final;
+
+ private:
+  std::mt19937_64 rng_;
+  double temperature_;
+  double cooling_;
+  /*! \brief The config of the walk and its seconds, -1 before the first trial. */
+  int64_t current_{-1};
+  double current_seconds_{std::numeric_limits<double>::infinity()};
+};
+
+/*! \brief The tuned configs the kernels dispatch with. */
+class DispatchContext {
+ public:
+  /*! \return The context of the process, with the log of CVM_TUNING_LOG applied. */
+  static DispatchContext* Global();
+
+  /*! \brief Use the best record of every workload of a log, replacing the configs applied. */
+  void Apply(const TuningLog& log);
+
+  /*! \brief Drop the tuned configs, the kernels run their defaults again. */
+  void Reset();
+
+  /*! \return Whether a config is tuned for a workload of an op, stored into config. */
+  bool Lookup(const std::string& op, const std::string& workload, TuningConfig* config) const;
+
+  /*!
+   * \brief Call callback after every change, for the kernels to drop the selections they
+   *  memoized. It runs without the lock of the context.
+   */
+  void OnChange(std::function<void()> callback);
+
+ private:
+  void Notify();
+
+  mutable std::mutex mutex_;
+  /*! \brief The best record by op and workload. */
+  std::map<std::pair<std::string, std::string>, TuningRecord> best_;
+  std::vector<std::function<void()>> callbacks_;
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_AUTO_TUNER_H_
@@ -0,0 +1,312 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include "batching_server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <numeric>
+#include <string>
+#include <utility>
+
+namespace cvm {
+namespace runtime {
+
+namespace {
+
+/*! \brief The weight of the last run in the moving average of the run time. */
+constexpr double kRunTimeSmoothing = 0.2;
+
+/*! \brief The buckets of the queueing delay histogram, the last one up to 2^31 us. */
+constexpr int kNumDelayBuckets = 32;
+
+size_t SampleBytes(const SampleSpec& spec) {
+  size_t n = (spec.dtype.bits * spec.dtype.lanes + 7) / 8;
+  for (int64_t d : spec.shape) n *= static_cast<size_t>(d);
+  return n;
+}
+
+std::vector<int64_t> BatchShape(int batch_size, const std::vector<int64_t>& sample) {
+  std::vector<int64_t> shape{batch_size};
+  shape.insert(shape.end(), sample.begin(), sample.end());
+  return shape;
+}
+
+bool SameDataType(DLDataType a, DLDataType b) {
+  return a.code == b.code && a.bits == b.bits && a.lanes == b.lanes;
+}
+
+/*! \brief Check a sample of a request against the spec of its input. */
+void CheckSample(const NDArray& x, const SampleSpec& spec, size_t index) {
+  std::string what = "BatchingServer: input " + std::to_string(index);
+  if (!x.defined()) throw Error(what + " is null");
+  if (x->device.device_type != kDLCPU) throw Error(what + " is not on the CPU");
+  if (!SameDataType(x->dtype, spec.dtype)) throw Error(what + " has the wrong dtype");
+  if (!x.IsContiguous()) throw Error(what + " is not contiguous");
+  const std::vector<int64_t>& shape = x.Shape();
+  // the sample may keep a batch axis of 1.
+  size_t skip = shape.size() == spec.shape.size() + 1 && shape[0] == 1 ? 1 : 0;
+  if (!std::equal(shape.begin() + skip, shape.end(), spec.shape.begin(), spec.shape.end())) {
+    throw Error(what + " does not have the shape of a sample");
+  }
+}
+
+double Microseconds(BatchingServer::Clock::duration d) {
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+}  // namespace
+
+double BatchingMetrics::QueueDelayQuantileUs(double q) const {
+  int64_t total = std::accumulate(queue_delay_histogram.begin(), queue_delay_histogram.end(),
+                                  static_cast<int64_t>(0));
+  if (total == 0) return 0;
+  int64_t rank = static_cast<int64_t>(std::ceil(q * total));
+  int64_t seen = 0;
+  for (size_t i = 0; i < queue_delay_histogram.size(); ++i) {
+    seen += queue_delay_histogram[i];
+    if (seen >= rank) return std::ldexp(1.0, static_cast<int>(i));
+  }
+  return max_queue_delay_us;
+}
+
+BatchingServer::BatchingServer(PackedFunc model, std::vector<SampleSpec> inputs,
+                               std::vector<SampleSpec> outputs, BatchingOptions options)
+    : model_(std::move(model)),
+      input_specs_(std::move(inputs)),
+      output_specs_(std::move(outputs)),
+      options_(std::move(options)) {
+  if (model_ == nullptr) throw Error("BatchingServer: the model is null");
+  if (input_specs_.empty() || output_specs_.empty()) {
+    throw Error("BatchingServer: the model needs inputs and outputs");
+  }
+  std::vector<int>& buckets = options_.batch_buckets;
+  if (!buckets.empty()) {
+    for (size_t i = 0; i < buckets.size(); ++i) {
+      if (buckets[i] < 1 || (i > 0 && buckets[i] <= buckets[i - 1])) {
+        throw Error("BatchingServer: the batch buckets must be positive and ascending");
+      }
+    }
+    options_.max_batch_size = buckets.back();
+  }
+  if (options_.max_batch_size < 1) throw Error("BatchingServer: max_batch_size must be >= 1");
+  if (options_.max_wait_us < 0) throw Error("BatchingServer: max_wait_us must be >= 0");
+  for (const SampleSpec& spec : input_specs_) input_bytes_.push_back(SampleBytes(spec));
+  for (const SampleSpec& spec : output_specs_) output_bytes_.push_back(SampleBytes(spec));
+
+  int max = options_.max_batch_size;
+  run_time_us_.assign(max + 1, 0.0);
+  buffers_.resize(max + 1);
+  metrics_.batch_size_histogram.assign(max + 1, 0);
+  metrics_.queue_delay_histogram.assign(kNumDelayBuckets, 0);
+  scheduler_ = std::thread([this]() { this->SchedulerLoop(); });
+}
+
+BatchingServer::~BatchingServer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  scheduler_.join();
+}
+
+std::future<std::vector<NDArray>> BatchingServer::Submit(std::vector<NDArray> inputs,
+                                                         Clock::time_point deadline) {
+  if (inputs.size() != input_specs_.size()) {
+    throw Error("BatchingServer: expect " + std::to_string(input_specs_.size()) +
+                " inputs, got " + std::to_string(inputs.size()));
+  }
+  for (size_t i = 0; i < inputs.size(); ++i) CheckSample(inputs[i], input_specs_[i], i);
+  Request request;
+  request.inputs = std::move(inputs);
+  request.submitted = Clock::now();
+  request.deadline = deadline;
+  std::future<std::vector<NDArray>> future = request.promise.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) throw Error("BatchingServer: the server is stopping");
+    queue_.push_back(std::move(request));
+  }
+  cv_.notify_one();
+  return future;
+}
+
+BatchingMetrics BatchingServer::Metrics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return metrics_;
+}
+
+void BatchingServer::SchedulerLoop() {
+  std::vector<Request> batch;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    if (queue_.empty()) {
+      if (stop_) break;
+      cv_.wait(lock);
+      continue;
+    }
+    // a stopping server runs what is queued without waiting for more.
+    if (!stop_ && static_cast<int>(queue_.size()) < options_.max_batch_size) {
+      Clock::time_point dispatch = DispatchTime();
+      if (Clock::now() < dispatch) {
+        cv_.wait_until(lock, dispatch);
+        continue;
+      }
+    }
+    TakeBatch(&batch);
+    lock.unlock();
+    RunBatch(&batch);
+    batch.clear();
+    lock.lock();
+  }
+}
+
+BatchingServer::Clock::time_point BatchingServer::DispatchTime() const {
+  // the queue stays in submission order, the front is the oldest request.
+  Clock::time_point t = queue_.front().submitted + std::chrono::microseconds(options_.max_wait_us);
+  if (options_.deadline_aware) {
+    Clock::time_point earliest = Clock::time_point::max();
+    for (const Request& r : queue_) earliest = std::min(earliest, r.deadline);
+    if (earliest != Clock::time_point::max()) {
+      int n = std::min(static_cast<int>(queue_.size()), options_.max_batch_size);
+      auto run_time = std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double, std::micro>(run_time_us_[PaddedSize(n)]));
+      t = std::min(t, earliest - run_time);
+    }
+  }
+  return t;
+}
+
+void BatchingServer::TakeBatch(std::vector<Request>* batch) {
+  size_t size = queue_.size();
+  size_t n = std::min(size, static_cast<size_t>(options_.max_batch_size));
+  if (!options_.deadline_aware || n == size) {
+    for (size_t i = 0; i < n; ++i) {
+      batch->push_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    return;
+  }
+  // the earliest deadlines first, the rest keeps its submission order.
+  std::vector<size_t> order(size);
+  std::iota(order.begin(), order.end(), 0);
+  std::partial_sort(order.begin(), order.begin() + n, order.end(), [this](size_t a, size_t b) {
+    return queue_[a].deadline < queue_[b].deadline ||
+           (queue_[a].deadline == queue_[b].deadline && a < b);
+  });
+  std::vector<bool> taken(size, false);
+  for (size_t i = 0; i < n; ++i) {
+    batch->push_back(std::move(queue_[order[i]]));
+    taken[order[i]] = true;
+  }
+  std::deque<Request> rest;
+  for (size_t i = 0; i < size; ++i) {
+    if (!taken[i]) rest.push_back(std::move(queue_[i]));
+  }
+  queue_.swap(rest);
+}
+
+int BatchingServer::PaddedSize(int n) const {
+  const std::vector<int>& buckets = options_.batch_buckets;
+  if (buckets.empty()) return n;
+  return *std::lower_bound(buckets.begin(), buckets.end(), n);
+}
+
+BatchingServer::BatchBuffers& BatchingServer::Buffers(int batch_size) {
+  BatchBuffers& buf = buffers_[batch_size];
+  if (!buf.inputs.empty()) return buf;
+  Device cpu{kDLCPU, 0};
+  for (const SampleSpec& spec : input_specs_) {
+    buf.inputs.push_back(NDArray::Empty(BatchShape(batch_size, spec.shape), spec.dtype, cpu));
+  }
+  for (const SampleSpec& spec : output_specs_) {
+    buf.outputs.push_back(NDArray::Empty(BatchShape(batch_size, spec.shape), spec.dtype, cpu));
+  }
+  size_t num_args = buf.inputs.size() + buf.outputs.size();
+  buf.values.resize(num_args);
+  buf.type_codes.resize(num_args);
+  CVMArgsSetter setter(buf.values.data(), buf.type_codes.data());
+  for (size_t i = 0; i < buf.inputs.size(); ++i) setter(i, buf.inputs[i]);
+  for (size_t i = 0; i < buf.outputs.size(); ++i) setter(buf.inputs.size() + i, buf.outputs[i]);
+  return buf;
+}
+
+void BatchingServer::RunBatch(std::vector<Request>* batch) {
+  Clock::time_point start = Clock::now();
+  int n = static_cast<int>(batch->size());
+  int padded = PaddedSize(n);
+  std::exception_ptr error;
+  try {
+    BatchBuffers& buf = Buffers(padded);
+    for (size_t i = 0; i < input_specs_.size(); ++i) {
+      char* rows = static_cast<char*>(buf.inputs[i]->data);
+      size_t bytes = input_bytes_[i];
+      for (int r = 0; r < n; ++r) {
+        const DLTensor* x = (*batch)[r].inputs[i].operator->();
+        std::memcpy(rows + r * bytes, static_cast<const char*>(x->data) + x->byte_offset, bytes);
+      }
+      std::memset(rows + n * bytes, 0, (padded - n) * bytes);
+    }
+    CVMRetValue rv;
+    model_.CallPacked(CVMArgs(buf.values.data(), buf.type_codes.data(),
+                              static_cast<int>(buf.values.size())),
+                      &rv);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  Clock::time_point end = Clock::now();
+
+  std::vector<std::vector<NDArray>> results(n);
+  if (error == nullptr) {
+    BatchBuffers& buf = buffers_[padded];
+    Device cpu{kDLCPU, 0};
+    for (int r = 0; r < n; ++r) {
+      for (size_t i = 0; i < output_specs_.size(); ++i) {
+        const SampleSpec& spec = output_specs_[i];
+        NDArray y = NDArray::Empty(spec.shape, spec.dtype, cpu);
+        std::memcpy(y->data, static_cast<const char*>(buf.outputs[i]->data) + r * output_bytes_[i],
+                    output_bytes_[i]);
+        results[r].push_back(std::move(y));
+      }
+    }
+  }
+  Clock::time_point done = Clock::now();
+
+  {
+    // the metrics cover a batch before its futures are ready.
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics_.num_requests += n;
+    metrics_.num_batches += 1;
+    metrics_.batch_size_histogram[n] += 1;
+    metrics_.num_padding_rows += padded - n;
+    for (const Request& r : *batch) {
+      double delay = Microseconds(start - r.submitted);
+      int bucket = delay < 1 ? 0 : std::min(static_cast<int>(std::log2(delay)) + 1,
+                                            kNumDelayBuckets - 1);
+      metrics_.queue_delay_histogram[bucket] += 1;
+      total_queue_delay_us_ += delay;
+      metrics_.max_queue_delay_us = std::max(metrics_.max_queue_delay_us, delay);
+      if (done > r.deadline) metrics_.num_deadline_misses += 1;
+    }
+    metrics_.mean_queue_delay_us = total_queue_delay_us_ / metrics_.num_requests;
+    if (error == nullptr) {
+      double& avg = run_time_us_[padded];
+      double t = Microseconds(end - start);
+      avg = avg == 0 ? t : (1 - kRunTimeSmoothing) * avg + kRunTimeSmoothing * t;
+    }
+  }
+  for (int r = 0; r < n; ++r) {
+    if (error != nullptr) {
+      (*batch)[r].promise.set_exception(error);
+    } else {
+      (*batch)[r].promise.set_value(std::move(results[r]));
+    }
+  }
+}
+
+}  // namespace runtime
+}  // namespace cvm
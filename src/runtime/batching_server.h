@@ -0,0 +1,182 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file batching_server.h
+ * \brief Dynamic batching of concurrent single sample requests to one model function.
+ *
+ *  The model is a PackedFunc in the destination passing style of the kernels:
+ *
+ * \code
+ *  model(input_0, ..., input_m, output_0, ..., output_n)
+ * \endcode
+ *
+ *  where every tensor has the batch axis first. A request is one sample of every input,
+ *  without the batch axis (or with a batch axis of 1), and receives one sample of every
+ *  output. The server copies the samples of the requests of a batch into the rows of
+ *  batch tensors, runs the model once and copies the rows of the outputs back.
+ */
+#ifndef CVM_SRC_RUNTIME_BATCHING_SERVER_H_
+#define CVM_SRC_RUNTIME_BATCHING_SERVER_H_
+
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/packed_func.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief The shape of one sample, without the batch axis, and the dtype of a tensor. */
+struct SampleSpec {
+  std::vector<int64_t> shape;
+  DLDataType dtype{kDLFloat, 32, 1};
+};
+
+/*! \brief How the server forms batches. */
+struct BatchingOptions {
+  /*! \brief The most requests of a batch. */
+  int max_batch_size{8};
+  /*! \brief The longest a request waits for more requests to join its batch. */
+  int64_t max_wait_us{1000};
+  /*!
+   * \brief Deadline aware batching: a batch is also dispatched when waiting longer would
+   *  make the earliest deadline of its requests miss, given the run time measured for
+   *  the batch size, and the earliest deadlines are served first.
+   */
+  bool deadline_aware{false};
+  /*!
+   * \brief The batch sizes the model runs with, ascending, empty for any size up to
+   *  max_batch_size. A batch is padded with zero rows up to the next bucket, the last
+   *  bucket is then the max batch size.
+   */
+  std::vector<int> batch_buckets;
+};
+
+/*! \brief A snapshot of the metrics of a server. */
+struct BatchingMetrics {
+  int64_t num_requests{0};
+  int64_t num_batches{0};
+  /*! \brief The requests whose outputs were ready after their deadline. */
+  int64_t num_deadline_misses{0};
+  /*! \brief The batches by number of requests, from 0 to max_batch_size. */
+  std::vector<int64_t> batch_size_histogram;
+  /*! \brief The rows of padding run by the bucket policy. */
+  int64_t num_padding_rows{0};
+  /*!
+   * \brief The requests by queueing delay, from submission to the start of the run of
+   *  their batch: bucket i counts the delays in [2^(i-1), 2^i) microseconds, bucket 0
+   *  the delays under one microsecond.
+   */
+  std::vector<int64_t> queue_delay_histogram;
+  double mean_queue_delay_us{0};
+  double max_queue_delay_us{0};
+
+  /*! \return The mean number of requests of a batch. */
+  double MeanBatchSize() const {
+    return num_batches == 0 ? 0 : static_cast<double>(num_requests) / num_batches;
+  }
+  /*! \return An upper bound of the q quantile of the queueing delay, in microseconds. */
+  double QueueDelayQuantileUs(double q) const;
+};
+
+/*!
+ * \brief Coalesces concurrent requests into batches of a model function.
+ *
+ *  A scheduler thread waits for requests, dispatches a batch when it is full, when its
+ *  oldest request waited max_wait_us or, deadline aware, when its earliest deadline
+ *  requires, and runs the model on it. The batch tensors of every batch size are
+ *  allocated once and reused. A request completes its future with the output samples,
+ *  or with the Error thrown by the model for its batch.
+ */
+class BatchingServer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /*!
+   * \brief Start a server, throws an Error for malformed options.
+   * \param model The model function, see batching_server.h.
+   * \param inputs The samples of the inputs of a request.
+   * \param outputs The samples of the outputs of a request.
+   * \param options The batching policy.
+   */
+  BatchingServer(PackedFunc model, std::vector<SampleSpec> inputs,
+                 std::vector<SampleSpec> outputs, BatchingOptions options = BatchingOptions());
+
+  /*! \brief Run the queued requests, then stop the scheduler. */
+  ~BatchingServer();
+
+  BatchingServer(const BatchingServer&) = delete;
+  BatchingServer& operator=(const BatchingServer&) = delete;
+
+  /*!
+   * \brief Submit a request, throws an Error when the samples do not match the inputs.
+   * \param inputs One CPU sample of every input.
+   * \param deadline When the outputs are wanted, Clock::time_point::max() for none.
+   * \return The future of one sample of every output.
+   */
+  std::future<std::vector<NDArray>> Submit(
+      std::vector<NDArray> inputs, Clock::time_point deadline = Clock::time_point::max());
+
+  /*! \return A snapshot of the metrics. */
+  BatchingMetrics Metrics() const;
+
+ private:
+  struct Request {
+    std::vector<NDArray> inputs;
+    Clock::time_point submitted;
+    Clock::time_point deadline;
+    std::promise<std::vector<NDArray>> promise;
+  };
+
+  /*! \brief The tensors of one batch size. */
+  struct BatchBuffers {
+    std::vector<NDArray> inputs;
+    std::vector<NDArray> outputs;
+    std::vector<CVMValue> values;
+    std::vector<int> type_codes;
+  };
+
+  void SchedulerLoop();
+  /*! \return When the queued requests should run, queue_ is not empty. */
+  Clock::time_point DispatchTime() const;
+  /*! \brief Take the requests of the next batch from the queue. */
+  void TakeBatch(std::vector<Request>* batch);
+  void RunBatch(std::vector<Request>* batch);
+  /*! \return The batch size the model runs n requests with. */
+  int PaddedSize(int n) const;
+  BatchBuffers& Buffers(int batch_size);
+
+  PackedFunc model_;
+  std::vector<SampleSpec> input_specs_;
+  std::vector<SampleSpec> output_specs_;
+  std::vector<size_t> input_bytes_;
+  std::vector<size_t> output_bytes_;
+  BatchingOptions options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request> queue_;
+  bool stop_{false};
+  /*! \brief The moving average of the run time by batch size, in microseconds. */
+  std::vector<double> run_time_us_;
+  BatchingMetrics metrics_;
+  double total_queue_delay_us_{0};
+
+  /*! \brief The buffers by batch size, touched by the scheduler thread only. */
+  std::vector<BatchBuffers> buffers_;
+  std::thread scheduler_;
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_BATCHING_SERVER_H_
@@ -2,12 +2,18 @@
 // Created by WangJingYu on 2021/7/6.
 //
 
+#include <cvm/runtime/c_backend_api.h>
 #include <cvm/runtime/c_runtime_api.h>
+#include <cvm/runtime/device_api.h>
+#include <cvm/runtime/module.h>
 #include <cvm/runtime/packed_func.h>
 #include <cvm/runtime/registry.h>
 #include <cvm/runtime/thread_local.h>
 
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <mutex>
 
 #include "runtime_base.h"
 
@@ -46,6 +52,98 @@ uint8_t ParseCustomDataType(const std::string& s, const char** scan) {
   return GetCustomTypeCode(type_name);
 }
 
+class DeviceAPIManager {
+ public:
+  static const int kMaxDeviceAPI = 32;
+  // Get API
+  static DeviceAPI* Get(const Device& dev) { return Get(dev.device_type); }
+  static DeviceAPI* Get(int dev_type, bool allow_missing = false) {
+    return Global()->GetAPI(dev_type, allow_missing);
+  }
+
+ private:
+  std::array<DeviceAPI*, kMaxDeviceAPI> api_;
+  std::mutex mutex_;
+  // constructor
+  DeviceAPIManager() { std::fill(api_.begin(), api_.end(), nullptr); }
+  // Global static variable.
+  static DeviceAPIManager* Global() {
+    static DeviceAPIManager* inst = new DeviceAPIManager();
+    return inst;
+  }
+  // Get or initialize API.
+  DeviceAPI* GetAPI(int type, bool allow_missing) {
+    ICHECK(type >= 0 && type < kMaxDeviceAPI) << "Invalid device type " << type;
+    if (api_[type] != nullptr) return api_[type];
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (api_[type] != nullptr) return api_[type];
+    api_[type] = GetAPI(DeviceName(type), allow_missing);
+    return api_[type];
+  }
+  DeviceAPI* GetAPI(const std::string name, bool allow_missing) {
+    std::string factory = "device_api." + name;
+    auto* f = Registry::Get(factory);
+    if (f == nullptr) {
+      ICHECK(allow_missing) << "Device API " << name << " is not enabled.";
+      return nullptr;
+    }
+    void* ptr = (*f)();
+    return static_cast<DeviceAPI*>(ptr);
+  }
+};
+
+DeviceAPI* DeviceAPI::Get(Device dev, bool allow_missing) {
+  return DeviceAPIManager::Get(static_cast<int>(dev.device_type), allow_missing);
+}
+
+void* DeviceAPI::AllocDataSpace(Device dev, int ndim, const int64_t* shape, DLDataType dtype) {
+  size_t size = 1;
+  for (int i = 0; i < ndim; ++i) {
+    size *= static_cast<size_t>(shape[i]);
+  }
+  size *= (dtype.bits * dtype.lanes + 7) / 8;
+  size_t alignment = std::max<size_t>((dtype.bits / 8) * dtype.lanes, kAllocAlignment);
+  return AllocDataSpace(dev, size, alignment, dtype);
+}
+
+void DeviceAPI::CopyDataFromTo(DLTensor* from, DLTensor* to, CVMStreamHandle stream) {
+  // by default, we can always redirect to the flat memory copy operation.
+  size_t nbytes = GetDataSize(*from);
+  ICHECK_EQ(nbytes, GetDataSize(*to));
+
+  ICHECK(IsContiguous(*from) && IsContiguous(*to))
+      << "CopyDataFromTo only support contiguous array for now";
+  CopyDataFromTo(from->data, from->byte_offset, to->data, to->byte_offset, nbytes, from->device,
+                 to->device, from->dtype, stream);
+}
+
+void DeviceAPI::CopyDataFromTo(const void* /*from*/, size_t /*from_offset*/, void* /*to*/,
+                               size_t /*to_offset*/, size_t /*num_bytes*/, Device /*dev_from*/,
+                               Device /*dev_to*/, DLDataType /*type_hint*/,
+                               CVMStreamHandle /*stream*/) {
+  LOG(FATAL) << "Device does not support CopyDataFromTo.";
+}
+
+void* DeviceAPI::AllocWorkspace(Device dev, size_t size, DLDataType type_hint) {
+  return AllocDataSpace(dev, size, kTempAllocaAlignment, type_hint);
+}
+
+void DeviceAPI::FreeWorkspace(Device dev, void* ptr) { FreeDataSpace(dev, ptr); }
+
+CVMStreamHandle DeviceAPI::CreateStream(Device /*dev*/) {
+  LOG(FATAL) << "Device does not support stream api.";
+  return nullptr;
+}
+
+void DeviceAPI::FreeStream(Device /*dev*/, CVMStreamHandle /*stream*/) {
+  LOG(FATAL) << "Device does not support stream api.";
+}
+
+void DeviceAPI::SyncStreamFromTo(Device /*dev*/, CVMStreamHandle /*event_src*/,
+                                 CVMStreamHandle /*event_dst*/) {
+  LOG(FATAL) << "Device does not support stream api.";
+}
+
 std::string NormalizeError(std::string err_msg) {
   int line_number = 0;
   std::istringstream is(err_msg);
@@ -185,9 +283,7 @@ CVM_DLL int CVMFuncFree(CVMFunctionHandle func) {
 
 void CVMAPISetLastError(const char* msg) { CVMAPIRuntimeStore::Get()->last_error = msg; }
 
-const char* CVMGetLastError() {
-  return "GetLastError";  // TODO
-}
+const char* CVMGetLastError() { return CVMAPIRuntimeStore::Get()->last_error.c_str(); }
 
 int CVMFuncCall(CVMFunctionHandle func, CVMValue* arg_values, int* type_codes, int num_args,
                 CVMValue* ret_val, int* ret_type_code) {
@@ -254,7 +350,141 @@ int CVMFuncCreateFromCFunc(CVMPackedCFunc func, void* resource_handle, CVMPacked
   API_END();
 }
 
+namespace {
+
+/*! \return The module of a handle, a new reference. */
+Module ModuleFromHandle(CVMModuleHandle mod) {
+  ICHECK(mod != nullptr) << "null module handle";
+  return Module(GetObjectPtr<Object>(static_cast<Object*>(mod)));
+}
+
+}  // namespace
+
+int CVMModLoadFromFile(const char* file_name, const char* format, CVMModuleHandle* out) {
+  API_BEGIN();
+  CVMRetValue rv;
+  rv = Module::LoadFromFile(file_name, format != nullptr ? format : "");
+  CVMValue value;
+  int type_code;
+  rv.MoveToCHost(&value, &type_code);
+  *out = value.v_handle;
+  API_END();
+}
+
+int CVMModImport(CVMModuleHandle mod, CVMModuleHandle dep) {
+  API_BEGIN();
+  ModuleFromHandle(mod).Import(ModuleFromHandle(dep));
+  API_END();
+}
+
+int CVMModGetFunction(CVMModuleHandle mod, const char* func_name, int query_imports,
+                      CVMFunctionHandle* out) {
+  API_BEGIN();
+  PackedFunc f = ModuleFromHandle(mod).GetFunction(func_name, query_imports != 0);
+  *out = f != nullptr ? new PackedFunc(std::move(f)) : nullptr;
+  API_END();
+}
+
+int CVMModFree(CVMModuleHandle mod) {
+  API_BEGIN();
+  CVMValue value;
+  value.v_handle = mod;
+  // the returned value takes over the reference of the handle and releases it.
+  CVMRetValue::MoveFromCHost(value, kCVMModuleHandle);
+  API_END();
+}
+
 int CVMAPIHandleException(const std::exception& e) {
   CVMAPISetLastError(NormalizeError(e.what()).c_str());
   return -1;
-}
\ No newline at end of file
+}
+
+int CVMBackendAllocWorkspace(int device_type, int device_id, uint64_t size, int dtype_code_hint,
+                             int dtype_bits_hint, void** out) {
+  API_BEGIN();
+  Device dev;
+  dev.device_type = static_cast<DLDeviceType>(device_type);
+  dev.device_id = device_id;
+
+  DLDataType type_hint;
+  type_hint.code = static_cast<decltype(type_hint.code)>(dtype_code_hint);
+  type_hint.bits = static_cast<decltype(type_hint.bits)>(dtype_bits_hint);
+  type_hint.lanes = 1;
+
+  *out = DeviceAPIManager::Get(dev)->AllocWorkspace(dev, static_cast<size_t>(size), type_hint);
+  API_END();
+}
+
+int CVMBackendFreeWorkspace(int device_type, int device_id, void* ptr) {
+  API_BEGIN();
+  Device dev;
+  dev.device_type = static_cast<DLDeviceType>(device_type);
+  dev.device_id = device_id;
+  DeviceAPIManager::Get(dev)->FreeWorkspace(dev, ptr);
+  API_END();
+}
+
+int CVMStreamCreate(int device_type, int device_id, CVMStreamHandle* out) {
+  API_BEGIN();
+  Device dev;
+  dev.device_type = static_cast<DLDeviceType>(device_type);
+  dev.device_id = device_id;
+  *out = DeviceAPIManager::Get(dev)->CreateStream(dev);
+  API_END();
+}
+
+int CVMStreamFree(int device_type, int device_id, CVMStreamHandle stream) {
+  API_BEGIN();
+  Device dev;
+  dev.device_type = static_cast<DLDeviceType>(device_type);
+  dev.device_id = device_id;
+  DeviceAPIManager::Get(dev)->FreeStream(dev, stream);
+  API_END();
+}
+
+int CVMSetStream(int device_type, int device_id, CVMStreamHandle stream) {
+  API_BEGIN();
+  Device dev;
+  dev.device_type = static_cast<DLDeviceType>(device_type);
+  dev.device_id = device_id;
+  DeviceAPIManager::Get(dev)->SetStream(dev, stream);
+  API_END();
+}
+
+int CVMSynchronize(int device_type, int device_id, CVMStreamHandle stream) {
+  API_BEGIN();
+  Device dev;
+  dev.device_type = static_cast<DLDeviceType>(device_type);
+  dev.device_id = device_id;
+  DeviceAPIManager::Get(dev)->StreamSync(dev, stream);
+  API_END();
+}
+
+int CVMStreamStreamSynchronize(int device_type, int device_id, CVMStreamHandle src,
+                               CVMStreamHandle dst) {
+  API_BEGIN();
+  Device dev;
+  dev.device_type = static_cast<DLDeviceType>(device_type);
+  dev.device_id = device_id;
+  DeviceAPIManager::Get(dev)->SyncStreamFromTo(dev, src, dst);
+  API_END();
+}
+
+int CVMDeviceAllocDataSpace(DLDevice dev, size_t nbytes, size_t alignment, DLDataType type_hint,
+                            void** out_data) {
+  API_BEGIN();
+  out_data[0] = DeviceAPIManager::Get(dev)->AllocDataSpace(dev, nbytes, alignment, type_hint);
+  API_END();
+}
+
+int CVMDeviceFreeDataSpace(DLDevice dev, void* ptr) {
+  API_BEGIN();
+  DeviceAPIManager::Get(dev)->FreeDataSpace(dev, ptr);
+  API_END();
+}
+
+int CVMDeviceCopyDataFromTo(DLTensor* from, DLTensor* to, CVMStreamHandle stream) {
+  API_BEGIN();
+  NDArray::CopyFromTo(from, to, stream);
+  API_END();
+}
@@ -0,0 +1,81 @@
+//
+// Created by WangJingYu on 2021/7/6.
+//
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/registry.h>
+
+namespace cvm {
+namespace runtime {
+
+CVM_REGISTER_OBJECT_TYPE(ArrayNode);
+CVM_REGISTER_OBJECT_TYPE(StringObj);
+CVM_REGISTER_OBJECT_TYPE(MapNode);
+CVM_REGISTER_OBJECT_TYPE(ShapeTupleObj);
+CVM_REGISTER_OBJECT_TYPE(ClosureObj);
+CVM_REGISTER_OBJECT_TYPE(ADTObj);
+
+CVM_REGISTER_GLOBAL("runtime.String").set_body_typed([](std::string str) {
+  return String(std::move(str));
+});
+
+CVM_REGISTER_GLOBAL("runtime.GetFFIString").set_body_typed([](String str) {
+  return std::string(str);
+});
+
+CVM_REGISTER_GLOBAL("runtime.MapSize").set_body([](CVMArgs args, CVMRetValue* ret) {
+  ICHECK_EQ(args[0].type_code(), kCVMObjectHandle);
+  Object* ptr = static_cast<Object*>(args[0].value().v_handle);
+  ICHECK(ptr->IsInstance<MapNode>());
+  *ret = static_cast<int64_t>(static_cast<const MapNode*>(ptr)->data.size());
+});
+
+CVM_REGISTER_GLOBAL("runtime.ShapeTuple").set_body([](CVMArgs args, CVMRetValue* rv) {
+  std::vector<ShapeTuple::index_type> shape;
+  for (int i = 0; i < args.size(); ++i) {
+    shape.push_back(args[i]);
+  }
+  *rv = ShapeTuple(shape);
+});
+
+CVM_REGISTER_GLOBAL("runtime.GetShapeTupleSize").set_body_typed([](ShapeTuple shape) {
+  return static_cast<int64_t>(shape.size());
+});
+
+CVM_REGISTER_GLOBAL("runtime.GetShapeTupleElem").set_body_typed([](ShapeTuple shape, int idx) {
+  ICHECK_LT(static_cast<size_t>(idx), shape.size());
+  return shape[idx];
+});
+
+CVM_REGISTER_GLOBAL("runtime.ADT").set_body([](CVMArgs args, CVMRetValue* rv) {
+  int32_t tag = args[0];
+  std::vector<ObjectRef> fields;
+  for (int i = 1; i < args.size(); ++i) {
+    fields.push_back(args[i]);
+  }
+  *rv = ADT(tag, fields);
+});
+
+CVM_REGISTER_GLOBAL("runtime.Tuple").set_body([](CVMArgs args, CVMRetValue* rv) {
+  std::vector<ObjectRef> fields;
+  for (int i = 0; i < args.size(); ++i) {
+    fields.push_back(args[i]);
+  }
+  *rv = ADT(0, fields);
+});
+
+CVM_REGISTER_GLOBAL("runtime.GetADTTag").set_body_typed([](ADT adt) {
+  return static_cast<int64_t>(adt.tag());
+});
+
+CVM_REGISTER_GLOBAL("runtime.GetADTSize").set_body_typed([](ADT adt) {
+  return static_cast<int64_t>(adt.size());
+});
+
+CVM_REGISTER_GLOBAL("runtime.GetADTFields").set_body_typed([](ADT adt, int idx) {
+  ICHECK_LT(static_cast<size_t>(idx), adt.size());
+  return adt[idx];
+});
+
+}  // namespace runtime
+}  // namespace cvm
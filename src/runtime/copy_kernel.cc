@@ -0,0 +1,374 @@
+//
+// Created by WangJingYu on 2021/7/14.
+//
+
+#include "copy_kernel.h"
+
+#include <cvm/runtime/logging.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../support/parallel_for.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief Edge length of the square tiles used by the transposing copy. */
+constexpr int64_t kCopyTileSize = 32;
+
+namespace {
+
+/*! \brief memcpy that bypasses the cache for the destination. */
+void StreamingMemCopy(char* dst, const char* src, size_t nbytes) {
+#if defined(__SSE2__)
+  size_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+  head = std::min(head, nbytes);
+  std::memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  nbytes -= head;
+  size_t body = nbytes & ~static_cast<size_t>(63);
+  for (size_t i = 0; i < body; i += 64) {
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+    __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+    __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), v0);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16), v1);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32), v2);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48), v3);
+  }
+  _mm_sfence();
+  std::memcpy(dst + body, src + body, nbytes - body);
+#else
+  std::memcpy(dst, src, nbytes);
+#endif
+}
+
+/*! \brief Number of threads worth using for a copy of nbytes. */
+int CopyConcurrency(size_t nbytes) {
+  size_t max_threads = nbytes / kParallelCopyMinBytes;
+  return static_cast<int>(
+      std::max<size_t>(1, std::min<size_t>(threading::NumThreads(), max_threads)));
+}
+
+/*! \brief Copy n elements of type T between two strided rows. */
+template <typename T>
+void StridedRowCopy(char* dst, const char* src, int64_t n, int64_t dst_stride,
+                    int64_t src_stride) {
+  T* d = reinterpret_cast<T*>(dst);
+  const T* s = reinterpret_cast<const T*>(src);
+  for (int64_t i = 0; i < n; ++i) {
+    d[i * dst_stride] = s[i * src_stride];
+  }
+}
+
+/*!
+ * \brief Copy a rows x cols tile whose source is unit-stride along rows and
+ *  whose destination is unit-stride along cols.
+ */
+template <typename T>
+void TransposeTile(char* dst, const char* src, int64_t rows, int64_t cols, int64_t dst_row_stride,
+                   int64_t src_col_stride) {
+  T* d = reinterpret_cast<T*>(dst);
+  const T* s = reinterpret_cast<const T*>(src);
+  for (int64_t c = 0; c < cols; ++c) {
+    for (int64_t r = 0; r < rows; ++r) {
+      d[r * dst_row_stride + c] = s[r + c * src_col_stride];
+    }
+  }
+}
+
+/*! \brief Generic fallback of TransposeTile for element sizes without a native type. */
+void TransposeTileBytes(char* dst, const char* src, int64_t rows, int64_t cols,
+                        int64_t dst_row_stride, int64_t src_col_stride, size_t elem_bytes) {
+  for (int64_t c = 0; c < cols; ++c) {
+    for (int64_t r = 0; r < rows; ++r) {
+      std::memcpy(dst + (r * dst_row_stride + c) * elem_bytes,
+                  src + (r + c * src_col_stride) * elem_bytes, elem_bytes);
+    }
+  }
+}
+
+/*! \brief A copy problem after normalization, strides are in elements. */
+struct CopyLayout {
+  std::vector<int64_t> shape;
+  std::vector<int64_t> src_strides;
+  std::vector<int64_t> dst_strides;
+  size_t elem_bytes;
+  int64_t num_elems;
+};
+
+std::vector<int64_t> GetStrides(const DLTensor* t) {
+  std::vector<int64_t> strides(t->ndim);
+  if (t->strides != nullptr) {
+    std::copy(t->strides, t->strides + t->ndim, strides.begin());
+  } else {
+    int64_t stride = 1;
+    for (int i = t->ndim - 1; i >= 0; --i) {
+      strides[i] = stride;
+      stride *= t->shape[i];
+    }
+  }
+  return strides;
+}
+
+/*!
+ * \brief Drop unit dimensions and merge neighbouring dimensions that are
+ *  contiguous with each other in both tensors.
+ */
+CopyLayout NormalizeLayout(const DLTensor* from, const DLTensor* to) {
+  std::vector<int64_t> src_strides = GetStrides(from);
+  std::vector<int64_t> dst_strides = GetStrides(to);
+  CopyLayout layout;
+  layout.elem_bytes = (from->dtype.bits * from->dtype.lanes + 7) / 8;
+  layout.num_elems = 1;
+  for (int i = 0; i < from->ndim; ++i) {
+    int64_t extent = from->shape[i];
+    layout.num_elems *= extent;
+    if (extent == 1) continue;
+    if (!layout.shape.empty() &&
+        layout.src_strides.back() == src_strides[i] * extent &&
+        layout.dst_strides.back() == dst_strides[i] * extent) {
+      layout.shape.back() *= extent;
+      layout.src_strides.back() = src_strides[i];
+      layout.dst_strides.back() = dst_strides[i];
+    } else {
+      layout.shape.push_back(extent);
+      layout.src_strides.push_back(src_strides[i]);
+      layout.dst_strides.push_back(dst_strides[i]);
+    }
+  }
+  return layout;
+}
+
+/*!
+ * \brief Visit the flattened indices [begin, end) of an index space,
+ *  calling f(src_offset, dst_offset) with element offsets.
+ */
+template <typename F>
+void ForEachIndex(const std::vector<int64_t>& shape, const std::vector<int64_t>& src_strides,
+                  const std::vector<int64_t>& dst_strides, int64_t begin, int64_t end, F f) {
+  int ndim = static_cast<int>(shape.size());
+  std::vector<int64_t> index(ndim);
+  int64_t src_offset = 0, dst_offset = 0;
+  int64_t rest = begin;
+  for (int i = ndim - 1; i >= 0; --i) {
+    index[i] = rest % shape[i];
+    rest /= shape[i];
+    src_offset += index[i] * src_strides[i];
+    dst_offset += index[i] * dst_strides[i];
+  }
+  for (int64_t n = begin; n < end; ++n) {
+    f(src_offset, dst_offset);
+    for (int i = ndim - 1; i >= 0; --i) {
+      src_offset += src_strides[i];
+      dst_offset += dst_strides[i];
+      if (++index[i] < shape[i]) break;
+      src_offset -= src_strides[i] * shape[i];
+      dst_offset -= dst_strides[i] * shape[i];
+      index[i] = 0;
+    }
+  }
+}
+
+/*! \brief Run f over [0, n) in contiguous blocks, one block per thread. */
+template <typename F>
+void ParallelBlocks(int64_t n, int num_threads, F f) {
+  num_threads = static_cast<int>(std::min<int64_t>(num_threads, n));
+  if (num_threads <= 1) {
+    f(0, n);
+    return;
+  }
+  int64_t step = (n + num_threads - 1) / num_threads;
+  support::parallel_for(0, n, step, [&](int64_t begin, int64_t end) { f(begin, end); });
+}
+
+/*!
+ * \brief Copy where the innermost dimension of the destination is unit-stride but
+ *  the source is unit-stride along dimension k, in tiles of kCopyTileSize.
+ */
+void TransposeCopy(char* dst, const char* src, const CopyLayout& layout, int k) {
+  int last = static_cast<int>(layout.shape.size()) - 1;
+  // the batch dimensions are every dimension except k and the innermost one.
+  std::vector<int64_t> batch_shape, batch_src, batch_dst;
+  for (int i = 0; i < last; ++i) {
+    if (i == k) continue;
+    batch_shape.push_back(layout.shape[i]);
+    batch_src.push_back(layout.src_strides[i]);
+    batch_dst.push_back(layout.dst_strides[i]);
+  }
+  int64_t num_batch = 1;
+  for (int64_t extent : batch_shape) num_batch *= extent;
+  int64_t rows = layout.shape[k];
+  int64_t cols = layout.shape[last];
+  int64_t num_row_tiles = (rows + kCopyTileSize - 1) / kCopyTileSize;
+  int64_t dst_row_stride = layout.dst_strides[k];
+  int64_t src_col_stride = layout.src_strides[last];
+  size_t elem_bytes = layout.elem_bytes;
+
+  auto copy_tile = [&](char* d, const char* s, int64_t nrow, int64_t ncol) {
+    switch (elem_bytes) {
+      case 1:
+        TransposeTile<uint8_t>(d, s, nrow, ncol, dst_row_stride, src_col_stride);
+        break;
+      case 2:
+        TransposeTile<uint16_t>(d, s, nrow, ncol, dst_row_stride, src_col_stride);
+        break;
+      case 4:
+        TransposeTile<uint32_t>(d, s, nrow, ncol, dst_row_stride, src_col_stride);
+        break;
+      case 8:
+        TransposeTile<uint64_t>(d, s, nrow, ncol, dst_row_stride, src_col_stride);
+        break;
+      default:
+        TransposeTileBytes(d, s, nrow, ncol, dst_row_stride, src_col_stride, elem_bytes);
+    }
+  };
+  // one work item is a strip of kCopyTileSize rows of one batch.
+  ParallelBlocks(num_batch * num_row_tiles, CopyConcurrency(layout.num_elems * elem_bytes),
+                 [&](int64_t begin, int64_t end) {
+                   for (int64_t item = begin; item < end; ++item) {
+                     int64_t batch = item / num_row_tiles;
+                     int64_t row0 = (item % num_row_tiles) * kCopyTileSize;
+                     int64_t nrow = std::min(kCopyTileSize, rows - row0);
+                     int64_t src_offset = row0 * layout.src_strides[k];
+                     int64_t dst_offset = row0 * dst_row_stride;
+                     for (int i = static_cast<int>(batch_shape.size()) - 1; i >= 0; --i) {
+                       int64_t idx = batch % batch_shape[i];
+                       batch /= batch_shape[i];
+                       src_offset += idx * batch_src[i];
+                       dst_offset += idx * batch_dst[i];
+                     }
+                     for (int64_t col0 = 0; col0 < cols; col0 += kCopyTileSize) {
+                       int64_t ncol = std::min(kCopyTileSize, cols - col0);
+                       copy_tile(dst + (dst_offset + col0) * elem_bytes,
+                                 src + (src_offset + col0 * src_col_stride) * elem_bytes, nrow,
+                                 ncol);
+                     }
+                   }
+                 });
+}
+
+/*! \brief Copy row by row, rows are unit-stride or strided along the innermost dimension. */
+void RowCopy(char* dst, const char* src, const CopyLayout& layout) {
+  int last = static_cast<int>(layout.shape.size()) - 1;
+  std::vector<int64_t> outer_shape(layout.shape.begin(), layout.shape.begin() + last);
+  std::vector<int64_t> outer_src(layout.src_strides.begin(), layout.src_strides.begin() + last);
+  std::vector<int64_t> outer_dst(layout.dst_strides.begin(), layout.dst_strides.begin() + last);
+  int64_t num_rows = 1;
+  for (int64_t extent : outer_shape) num_rows *= extent;
+  int64_t n = layout.shape[last];
+  int64_t src_stride = layout.src_strides[last];
+  int64_t dst_stride = layout.dst_strides[last];
+  size_t elem_bytes = layout.elem_bytes;
+
+  auto copy_row = [&](int64_t src_offset, int64_t dst_offset) {
+    char* d = dst + dst_offset * elem_bytes;
+    const char* s = src + src_offset * elem_bytes;
+    if (src_stride == 1 && dst_stride == 1) {
+      std::memcpy(d, s, n * elem_bytes);
+      return;
+    }
+    switch (elem_bytes) {
+      case 1:
+        StridedRowCopy<uint8_t>(d, s, n, dst_stride, src_stride);
+        break;
+      case 2:
+        StridedRowCopy<uint16_t>(d, s, n, dst_stride, src_stride);
+        break;
+      case 4:
+        StridedRowCopy<uint32_t>(d, s, n, dst_stride, src_stride);
+        break;
+      case 8:
+        StridedRowCopy<uint64_t>(d, s, n, dst_stride, src_stride);
+        break;
+      default:
+        for (int64_t i = 0; i < n; ++i) {
+          std::memcpy(d + i * dst_stride * elem_bytes, s + i * src_stride * elem_bytes,
+                      elem_bytes);
+        }
+    }
+  };
+  ParallelBlocks(num_rows, CopyConcurrency(layout.num_elems * elem_bytes),
+                 [&](int64_t begin, int64_t end) {
+                   ForEachIndex(outer_shape, outer_src, outer_dst, begin, end, copy_row);
+                 });
+}
+
+}  // namespace
+
+void ParallelMemCopy(void* dst, const void* src, size_t nbytes) {
+  char* d = static_cast<char*>(dst);
+  const char* s = static_cast<const char*>(src);
+  int num_threads = CopyConcurrency(nbytes);
+  if (num_threads == 1) {
+    // libc already switches to non-temporal stores for a single large copy.
+    std::memcpy(d, s, nbytes);
+    return;
+  }
+  // per thread chunks may fall below the libc threshold, stream them explicitly.
+  bool non_temporal = nbytes >= kNonTemporalCopyMinBytes;
+  // page aligned chunks so threads never write to the same cache line.
+  constexpr size_t kPage = 4096;
+  size_t chunk = ((nbytes + num_threads - 1) / num_threads + kPage - 1) / kPage * kPage;
+  support::parallel_for(
+      0, num_threads,
+      [&](int64_t i) {
+        size_t begin = static_cast<size_t>(i) * chunk;
+        if (begin >= nbytes) return;
+        size_t n = std::min(chunk, nbytes - begin);
+        if (non_temporal) {
+          StreamingMemCopy(d + begin, s + begin, n);
+        } else {
+          std::memcpy(d + begin, s + begin, n);
+        }
+      },
+      num_threads);
+}
+
+void CopyStridedTensor(const DLTensor* from, DLTensor* to) {
+  ICHECK_EQ(from->ndim, to->ndim) << "CopyStridedTensor: ndim mismatch";
+  for (int i = 0; i < from->ndim; ++i) {
+    ICHECK_EQ(from->shape[i], to->shape[i]) << "CopyStridedTensor: shape mismatch at dim " << i;
+  }
+  ICHECK(from->dtype.code == to->dtype.code && from->dtype.bits == to->dtype.bits &&
+         from->dtype.lanes == to->dtype.lanes)
+      << "CopyStridedTensor: dtype mismatch";
+  ICHECK_EQ(from->dtype.bits * from->dtype.lanes % 8, 0)
+      << "CopyStridedTensor: sub-byte types must be contiguous";
+
+  CopyLayout layout = NormalizeLayout(from, to);
+  if (layout.num_elems == 0) return;
+  const char* src = static_cast<const char*>(from->data) + from->byte_offset;
+  char* dst = static_cast<char*>(to->data) + to->byte_offset;
+  if (layout.shape.empty()) {
+    std::memcpy(dst, src, layout.elem_bytes);
+    return;
+  }
+  int last = static_cast<int>(layout.shape.size()) - 1;
+  if (last == 0 && layout.src_strides[0] == 1 && layout.dst_strides[0] == 1) {
+    ParallelMemCopy(dst, src, layout.num_elems * layout.elem_bytes);
+    return;
+  }
+  if (layout.dst_strides[last] == 1 && layout.src_strides[last] != 1) {
+    for (int k = last - 1; k >= 0; --k) {
+      if (layout.src_strides[k] == 1) {
+        TransposeCopy(dst, src, layout, k);
+        return;
+      }
+    }
+  }
+  RowCopy(dst, src, layout);
+}
+
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,48 @@
+//
+// Created by WangJingYu on 2021/7/14.
+//
+
+#ifndef CVM_SRC_RUNTIME_COPY_KERNEL_H_
+#define CVM_SRC_RUNTIME_COPY_KERNEL_H_
+
+#include <dlpack/dlpack.h>
+
+#include <cstddef>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief Minimum number of bytes handed to each thread of a parallel copy. */
+constexpr size_t kParallelCopyMinBytes = 1UL << 20;
+/*!
+ * \brief Copies of at least this many bytes use non-temporal stores,
+ *  the destination would not stay in cache anyway.
+ */
+constexpr size_t kNonTemporalCopyMinBytes = 16UL << 20;
+
+/*!
+ * \brief Copy a contiguous host buffer, in parallel chunks for large sizes.
+ * \param dst The destination buffer.
+ * \param src The source buffer, must not overlap with dst.
+ * \param nbytes Number of bytes to copy.
+ */
+void ParallelMemCopy(void* dst, const void* src, size_t nbytes);
+
+/*!
+ * \brief Copy between two host tensors of the same shape and dtype,
+ *  either of which may be strided.
+ *
+ *  Dimensions that are contiguous in both tensors are merged first. When both
+ *  innermost dimensions are unit-stride whole rows are copied, when only the
+ *  source is unit-stride along another dimension (e.g. a transposed view) the
+ *  copy walks cache sized tiles so both reads and writes stay sequential.
+ *
+ * \param from The source tensor.
+ * \param to The destination tensor.
+ */
+void CopyStridedTensor(const DLTensor* from, DLTensor* to);
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_COPY_KERNEL_H_
@@ -0,0 +1,204 @@
+//
+// Created by WangJingYu on 2021/7/16.
+//
+
+#include <cvm/runtime/device_api.h>
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/thread_local.h>
+
+#include <cstring>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "copy_kernel.h"
+#include "cpu_stream.h"
+#include "host_allocator.h"
+#include "workspace_pool.h"
+
+namespace cvm {
+namespace runtime {
+
+CPUStream::CPUStream() { worker_ = std::thread([this]() { Run(); }); }
+
+CPUStream::~CPUStream() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+    stop_ = true;
+  }
+  task_cv_.notify_one();
+  worker_.join();
+}
+
+void CPUStream::Enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(task));
+  }
+  task_cv_.notify_one();
+}
+
+void CPUStream::Sync() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+  if (error_ != nullptr) {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void CPUStream::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    task_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) return;
+    std::function<void()> task = std::move(queue_.front());
+    queue_.pop_front();
+    busy_ = true;
+    lock.unlock();
+    try {
+      task();
+    } catch (...) {
+      lock.lock();
+      if (error_ == nullptr) error_ = std::current_exception();
+      lock.unlock();
+    }
+    lock.lock();
+    busy_ = false;
+    if (queue_.empty()) idle_cv_.notify_all();
+  }
+}
+
+void CPUStreamEnqueue(CVMStreamHandle stream, std::function<void()> task) {
+  if (stream == nullptr) {
+    task();
+  } else {
+    static_cast<CPUStream*>(stream)->Enqueue(std::move(task));
+  }
+}
+
+namespace {
+
+/*! \brief A DLTensor that owns its shape and strides, so it can outlive the caller. */
+struct OwnedTensor {
+  explicit OwnedTensor(const DLTensor* t)
+      : tensor(*t),
+        shape(t->shape, t->shape + t->ndim),
+        strides(t->strides == nullptr ? 0 : t->ndim) {
+    if (t->strides != nullptr) std::copy(t->strides, t->strides + t->ndim, strides.begin());
+    tensor.shape = shape.data();
+    tensor.strides = t->strides == nullptr ? nullptr : strides.data();
+  }
+  DLTensor tensor;
+  std::vector<int64_t> shape;
+  std::vector<int64_t> strides;
+};
+
+void CopyTensor(const DLTensor* from, DLTensor* to) {
+  if (IsContiguous(*from) && IsContiguous(*to)) {
+    ParallelMemCopy(static_cast<char*>(to->data) + to->byte_offset,
+                    static_cast<const char*>(from->data) + from->byte_offset, GetDataSize(*from));
+  } else {
+    CopyStridedTensor(from, to);
+  }
+}
+
+}  // namespace
+
+class CPUDeviceAPI final : public DeviceAPI {
+ public:
+  void SetDevice(Device /*dev*/) final {}
+  void GetAttr(Device /*dev*/, DeviceAttrKind kind, CVMRetValue* rv) final {
+    if (kind == kExist) {
+      *rv = 1;
+    }
+  }
+  void* AllocDataSpace(Device dev, size_t nbytes, size_t alignment,
+                       DLDataType /*type_hint*/) final {
+    return HostAllocDataSpace(dev, nbytes, alignment);
+  }
+
+  void FreeDataSpace(Device /*dev*/, void* ptr) final { HostFreeDataSpace(ptr); }
+
+  void CopyDataFromTo(DLTensor* from, DLTensor* to, CVMStreamHandle stream) final {
+    ICHECK_EQ(GetDataSize(*from), GetDataSize(*to)) << "CopyDataFromTo: size mismatch";
+    if (GetDataSize(*from) == 0) return;
+    if (stream == nullptr) {
+      CopyTensor(from, to);
+      return;
+    }
+    auto src = std::make_shared<OwnedTensor>(from);
+    auto dst = std::make_shared<OwnedTensor>(to);
+    CPUStreamEnqueue(stream, [src, dst]() { CopyTensor(&src->tensor, &dst->tensor); });
+  }
+
+  CVMStreamHandle CreateStream(Device /*dev*/) final { return new CPUStream(); }
+
+  void FreeStream(Device /*dev*/, CVMStreamHandle stream) final {
+    delete static_cast<CPUStream*>(stream);
+  }
+
+  void StreamSync(Device /*dev*/, CVMStreamHandle stream) final {
+    if (stream != nullptr) static_cast<CPUStream*>(stream)->Sync();
+  }
+
+  void SyncStreamFromTo(Device dev, CVMStreamHandle event_src, CVMStreamHandle event_dst) final {
+    if (event_src == nullptr || event_src == event_dst) return;
+    if (event_dst == nullptr) {
+      StreamSync(dev, event_src);
+      return;
+    }
+    // an event recorded on the source that the destination waits on.
+    auto event = std::make_shared<std::promise<void>>();
+    std::shared_future<void> done = event->get_future().share();
+    CPUStreamEnqueue(event_src, [event]() { event->set_value(); });
+    CPUStreamEnqueue(event_dst, [done]() { done.wait(); });
+  }
+
+  void* AllocWorkspace(Device dev, size_t size, DLDataType type_hint) final;
+  void FreeWorkspace(Device dev, void* data) final;
+
+  static CPUDeviceAPI* Global() {
+    // NOTE: explicitly use new to avoid exit-time destruction of global state
+    // Global state will be recycled by OS as the process exits.
+    static auto* inst = new CPUDeviceAPI();
+    return inst;
+  }
+
+ protected:
+  void CopyDataFromTo(const void* from, size_t from_offset, void* to, size_t to_offset, size_t size,
+                      Device /*dev_from*/, Device /*dev_to*/, DLDataType /*type_hint*/,
+                      CVMStreamHandle stream) final {
+    const char* src = static_cast<const char*>(from) + from_offset;
+    char* dst = static_cast<char*>(to) + to_offset;
+    CPUStreamEnqueue(stream, [src, dst, size]() { ParallelMemCopy(dst, src, size); });
+  }
+};
+
+struct CPUWorkspacePool : public WorkspacePool {
+  CPUWorkspacePool() : WorkspacePool(kDLCPU, CPUDeviceAPI::Global()) {}
+};
+
+void* CPUDeviceAPI::AllocWorkspace(Device dev, size_t size, DLDataType /*type_hint*/) {
+  return ThreadLocalStore<CPUWorkspacePool>::Get()->AllocWorkspace(dev, size);
+}
+
+void CPUDeviceAPI::FreeWorkspace(Device dev, void* data) {
+  ThreadLocalStore<CPUWorkspacePool>::Get()->FreeWorkspace(dev, data);
+}
+
+CVM_REGISTER_GLOBAL("device_api.cpu").set_body([](CVMArgs /*args*/, CVMRetValue* rv) {
+  DeviceAPI* ptr = CPUDeviceAPI::Global();
+  *rv = static_cast<void*>(ptr);
+});
+
+CVM_REGISTER_GLOBAL("runtime.CPUStreamEnqueue").set_body([](CVMArgs args, CVMRetValue* /*rv*/) {
+  CVMStreamHandle stream = args[0];
+  PackedFunc task = args[1];
+  CPUStreamEnqueue(stream, [task]() { task(); });
+});
+
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,64 @@
+//
+// Created by WangJingYu on 2021/7/16.
+//
+
+#ifndef CVM_SRC_RUNTIME_CPU_STREAM_H_
+#define CVM_SRC_RUNTIME_CPU_STREAM_H_
+
+#include <cvm/runtime/c_runtime_api.h>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace cvm {
+namespace runtime {
+
+/*!
+ * \brief An ordered queue of host tasks executed by a dedicated worker thread.
+ *
+ *  Tasks run one at a time in submission order, asynchronously to the thread
+ *  that enqueued them. The first exception thrown by a task is rethrown by Sync.
+ */
+class CPUStream {
+ public:
+  CPUStream();
+  /*! \brief Waits for the queued tasks and stops the worker. */
+  ~CPUStream();
+  CPUStream(const CPUStream&) = delete;
+  CPUStream& operator=(const CPUStream&) = delete;
+  /*!
+   * \brief Append a task to the stream.
+   * \param task The task.
+   */
+  void Enqueue(std::function<void()> task);
+  /*! \brief Block until every task enqueued so far has finished. */
+  void Sync();
+
+ private:
+  void Run();
+
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::function<void()>> queue_;
+  bool busy_{false};
+  bool stop_{false};
+  std::exception_ptr error_;
+  std::thread worker_;
+};
+
+/*!
+ * \brief Enqueue a task on a CPU stream handle, a null stream runs it inline.
+ * \param stream The stream created by the CPU DeviceAPI.
+ * \param task The task.
+ */
+void CPUStreamEnqueue(CVMStreamHandle stream, std::function<void()> task);
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_CPU_STREAM_H_
@@ -0,0 +1,43 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/registry.h>
+#include <dlfcn.h>
+
+#include <string>
+
+#include "library_module.h"
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief A shared library opened by dlopen. */
+class DSOLibrary final : public Library {
+ public:
+  explicit DSOLibrary(const std::string& file_name) {
+    // local symbols: the libraries of different modules may export the same names.
+    handle_ = dlopen(file_name.c_str(), RTLD_LAZY | RTLD_LOCAL);
+    if (handle_ == nullptr) {
+      const char* msg = dlerror();
+      throw Error("failed to load " + file_name + ": " + (msg != nullptr ? msg : ""));
+    }
+  }
+
+  ~DSOLibrary() {
+    if (handle_ != nullptr) dlclose(handle_);
+  }
+
+  void* GetSymbol(const char* name) final { return dlsym(handle_, name); }
+
+ private:
+  void* handle_{nullptr};
+};
+
+CVM_REGISTER_GLOBAL("runtime.module.loadfile_so")
+    .set_body_typed([](std::string file_name, std::string /*format*/) {
+      return CreateModuleFromLibrary(make_object<DSOLibrary>(file_name));
+    });
+
+}  // namespace runtime
+}  // namespace cvm
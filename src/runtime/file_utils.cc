@@ -0,0 +1,419 @@
+//
+// Created by WangJingYu on 2021/7/12.
+//
+
+#include "file_utils.h"
+
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#include "../support/parallel_for.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CVM_CRC32C_HARDWARE 1
+#else
+#define CVM_CRC32C_HARDWARE 0
+#endif
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief Size of the fixed header in front of the index. */
+constexpr uint64_t kParamsHeaderSize = 32;
+/*! \brief Size of the smallest index entry, with an empty name and no dimension. */
+constexpr uint64_t kParamsMinEntrySize = sizeof(uint64_t) + sizeof(DLDataType) + sizeof(int32_t) +
+                                         2 * sizeof(uint64_t) + sizeof(uint32_t);
+/*! \brief Size of a single read request issued to the file system. */
+constexpr uint64_t kParamsReadChunk = 64UL << 20;
+/*! \brief Minimum number of bytes each reader thread should receive. */
+constexpr uint64_t kParamsMinBytesPerThread = 4UL << 20;
+
+namespace {
+
+struct CRC32CTable {
+  uint32_t data[256];
+
+  CRC32CTable() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int k = 0; k < 8; ++k) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78U : crc >> 1;
+      }
+      data[i] = crc;
+    }
+  }
+};
+
+uint32_t CRC32CSoftware(const uint8_t* data, size_t size, uint32_t crc) {
+  static CRC32CTable table;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table.data[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if CVM_CRC32C_HARDWARE
+__attribute__((target("sse4.2"))) uint32_t CRC32CHardware(const uint8_t* data, size_t size,
+                                                          uint32_t crc) {
+  uint64_t crc64 = crc;
+  for (; size >= 8; size -= 8, data += 8) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+  for (; size != 0; --size, ++data) {
+    crc = _mm_crc32_u8(crc, *data);
+  }
+  return crc;
+}
+#endif
+
+/*! \brief Append the raw bytes of a POD value to the buffer. */
+template <typename T>
+void WritePOD(std::string* buf, const T& value) {
+  buf->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/*! \brief Bounds-checked reader over the serialized index. */
+class IndexReader {
+ public:
+  IndexReader(const char* begin, const char* end) : ptr_(begin), end_(end) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    Read(&value, sizeof(T));
+    return value;
+  }
+
+  void Read(void* dst, size_t size) {
+    if (static_cast<size_t>(end_ - ptr_) < size) {
+      throw Error("params file index is truncated");
+    }
+    std::memcpy(dst, ptr_, size);
+    ptr_ += size;
+  }
+
+  /*! \return The bytes left to read. */
+  size_t remaining() const { return static_cast<size_t>(end_ - ptr_); }
+
+ private:
+  const char* ptr_;
+  const char* end_;
+};
+
+inline uint64_t AlignUp(uint64_t value, uint64_t align) {
+  return (value + align - 1) / align * align;
+}
+
+inline const char* DataPtr(const NDArray& arr) {
+  return static_cast<const char*>(arr->data) + arr->byte_offset;
+}
+
+/*! \return Whether the shape and the dtype of an entry make up its nbytes, without overflow. */
+bool MatchesSize(const ParamsFileEntry& e) {
+  for (int64_t extent : e.shape) {
+    if (extent < 0) return false;
+    if (extent == 0) return e.nbytes == 0;
+  }
+  uint64_t size = (static_cast<uint64_t>(e.dtype.bits) * e.dtype.lanes + 7) / 8;
+  for (int64_t extent : e.shape) {
+    if (size > e.nbytes / static_cast<uint64_t>(extent)) return false;
+    size *= static_cast<uint64_t>(extent);
+  }
+  return size == e.nbytes;
+}
+
+}  // namespace
+
+uint32_t CRC32C(const void* data, size_t size, uint32_t crc) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+#if CVM_CRC32C_HARDWARE
+  static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+  if (has_sse42) return ~CRC32CHardware(bytes, size, crc);
+#endif
+  return ~CRC32CSoftware(bytes, size, crc);
+}
+
+void SaveParams(const std::string& file_name, const Map<String, NDArray>& params,
+                bool checksum) {
+  // Sort by name so that the file content does not depend on hash order.
+  std::vector<std::pair<String, NDArray>> items(params.begin(), params.end());
+  std::sort(items.begin(), items.end(),
+            [](const std::pair<String, NDArray>& a, const std::pair<String, NDArray>& b) {
+              return a.first < b.first;
+            });
+  for (const auto& kv : items) {
+    const NDArray& arr = kv.second;
+    ICHECK(arr.defined()) << "SaveParams: param " << kv.first << " is undefined";
+    ICHECK_EQ(arr->device.device_type, kDLCPU) << "SaveParams only supports CPU arrays";
+    ICHECK(arr.IsContiguous()) << "SaveParams only supports contiguous arrays";
+  }
+
+  // Size of the index, required to place the first payload.
+  uint64_t index_size = 0;
+  for (const auto& kv : items) {
+    index_size += sizeof(uint64_t) + kv.first.size() + sizeof(DLDataType) + sizeof(int32_t) +
+                  sizeof(int64_t) * kv.second->ndim + 2 * sizeof(uint64_t) + sizeof(uint32_t);
+  }
+  uint64_t data_begin = AlignUp(kParamsHeaderSize + index_size, kParamsAlignment);
+
+  std::string head;
+  head.reserve(data_begin);
+  WritePOD(&head, kCVMParamsMagic);
+  WritePOD(&head, kCVMParamsVersion);
+  WritePOD(&head, checksum ? kParamsFlagChecksum : 0U);
+  WritePOD(&head, static_cast<uint64_t>(items.size()));
+  WritePOD(&head, data_begin);
+
+  uint64_t offset = data_begin;
+  for (const auto& kv : items) {
+    const NDArray& arr = kv.second;
+    uint64_t nbytes = GetDataSize(*arr.operator->());
+    WritePOD(&head, static_cast<uint64_t>(kv.first.size()));
+    head.append(kv.first.data(), kv.first.size());
+    WritePOD(&head, arr->dtype);
+    WritePOD(&head, static_cast<int32_t>(arr->ndim));
+    for (int i = 0; i < arr->ndim; ++i) {
+      WritePOD(&head, static_cast<int64_t>(arr->shape[i]));
+    }
+    WritePOD(&head, offset);
+    WritePOD(&head, nbytes);
+    WritePOD(&head, checksum ? CRC32C(DataPtr(arr), nbytes) : 0U);
+    offset = AlignUp(offset + nbytes, kParamsAlignment);
+  }
+  ICHECK_EQ(head.size(), kParamsHeaderSize + index_size);
+  head.resize(data_begin, '\0');
+
+  std::ofstream fs(file_name, std::ios::out | std::ios::binary);
+  if (!fs) throw Error("SaveParams: cannot open " + file_name + " for writing");
+  fs.write(head.data(), head.size());
+  static const char kPadding[kParamsAlignment] = {0};
+  for (const auto& kv : items) {
+    uint64_t nbytes = GetDataSize(*kv.second.operator->());
+    fs.write(DataPtr(kv.second), nbytes);
+    fs.write(kPadding, AlignUp(nbytes, kParamsAlignment) - nbytes);
+  }
+  if (!fs) throw Error("SaveParams: failed to write " + file_name);
+}
+
+ParamsFileReader::ParamsFileReader(const std::string& file_name) : file_name_(file_name) {
+  fd_ = open(file_name.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    throw Error("LoadParams: cannot open " + file_name + ": " + std::strerror(errno));
+  }
+  struct stat st;
+  ICHECK_EQ(fstat(fd_, &st), 0);
+  file_size_ = static_cast<uint64_t>(st.st_size);
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  char header[kParamsHeaderSize];
+  ReadAt(0, header, kParamsHeaderSize);
+  IndexReader reader(header, header + kParamsHeaderSize);
+  uint64_t magic = reader.Read<uint64_t>();
+  if (magic == __builtin_bswap64(kCVMParamsMagic)) {
+    throw Error("LoadParams: " + file_name + " was written on a host of the other byte order");
+  }
+  if (magic != kCVMParamsMagic) {
+    throw Error("LoadParams: " + file_name + " is not a params file");
+  }
+  uint32_t version = reader.Read<uint32_t>();
+  if (version > kCVMParamsVersion) {
+    throw Error("LoadParams: unsupported params file version " + std::to_string(version));
+  }
+  flags_ = reader.Read<uint32_t>();
+  uint64_t num_tensors = reader.Read<uint64_t>();
+  uint64_t data_begin = reader.Read<uint64_t>();
+  if (data_begin < kParamsHeaderSize || data_begin > file_size_) {
+    throw Error("LoadParams: corrupted header in " + file_name);
+  }
+
+  std::string index(data_begin - kParamsHeaderSize, '\0');
+  ReadAt(kParamsHeaderSize, &index[0], index.size());
+  reader = IndexReader(index.data(), index.data() + index.size());
+  // the sizes are checked against the bytes read before anything is allocated from them.
+  if (num_tensors > index.size() / kParamsMinEntrySize) {
+    throw Error("LoadParams: corrupted header in " + file_name);
+  }
+  entries_.resize(num_tensors);
+  for (uint64_t i = 0; i < num_tensors; ++i) {
+    ParamsFileEntry& e = entries_[i];
+    uint64_t name_len = reader.Read<uint64_t>();
+    if (name_len > reader.remaining()) {
+      throw Error("LoadParams: corrupted index in " + file_name);
+    }
+    e.name.resize(name_len);
+    reader.Read(&e.name[0], e.name.size());
+    e.dtype = reader.Read<DLDataType>();
+    int32_t ndim = reader.Read<int32_t>();
+    if (ndim < 0 || static_cast<uint64_t>(ndim) > reader.remaining() / sizeof(int64_t)) {
+      throw Error("LoadParams: corrupted index in " + file_name);
+    }
+    e.shape.resize(ndim);
+    reader.Read(e.shape.data(), sizeof(int64_t) * ndim);
+    e.offset = reader.Read<uint64_t>();
+    e.nbytes = reader.Read<uint64_t>();
+    e.checksum = reader.Read<uint32_t>();
+    if (e.offset < data_begin || e.offset > file_size_ || e.nbytes > file_size_ - e.offset) {
+      throw Error("LoadParams: tensor " + e.name + " is out of the bounds of " + file_name);
+    }
+    if (!MatchesSize(e)) {
+      throw Error("LoadParams: corrupted shape of tensor " + e.name + " in " + file_name);
+    }
+    name2index_[e.name] = i;
+  }
+}
+
+ParamsFileReader::~ParamsFileReader() {
+  if (fd_ >= 0) close(fd_);
+}
+
+void ParamsFileReader::ReadAt(uint64_t offset, void* dst, uint64_t nbytes) const {
+  char* ptr = static_cast<char*>(dst);
+  while (nbytes != 0) {
+    size_t request = static_cast<size_t>(std::min(nbytes, kParamsReadChunk));
+    ssize_t n = pread(fd_, ptr, request, static_cast<off_t>(offset));
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw Error("LoadParams: failed to read " + file_name_ + ": " + std::strerror(errno));
+    }
+    if (n == 0) throw Error("LoadParams: unexpected end of " + file_name_);
+    ptr += n;
+    offset += static_cast<uint64_t>(n);
+    nbytes -= static_cast<uint64_t>(n);
+  }
+}
+
+void ParamsFileReader::Verify(const ParamsFileEntry& entry, const void* data) const {
+  if (CRC32C(data, entry.nbytes) != entry.checksum) {
+    throw Error("LoadParams: checksum mismatch for tensor " + entry.name + " in " + file_name_);
+  }
+}
+
+NDArray ParamsFileReader::Load(const std::string& name, bool verify) const {
+  auto it = name2index_.find(name);
+  if (it == name2index_.end()) {
+    throw Error("LoadParams: cannot find tensor " + name + " in " + file_name_);
+  }
+  const ParamsFileEntry& e = entries_[it->second];
+  NDArray arr = NDArray::Empty(e.shape, e.dtype, {kDLCPU, 0});
+  ICHECK_EQ(GetDataSize(*arr.operator->()), e.nbytes) << "size mismatch for tensor " << e.name;
+  ReadAt(e.offset, arr->data, e.nbytes);
+  if (verify && has_checksum()) Verify(e, arr->data);
+  return arr;
+}
+
+Map<String, NDArray> ParamsFileReader::LoadAll(int num_threads, bool verify) const {
+  std::vector<NDArray> arrays;
+  arrays.reserve(entries_.size());
+  uint64_t total_bytes = 0;
+  for (const ParamsFileEntry& e : entries_) {
+    arrays.push_back(NDArray::Empty(e.shape, e.dtype, {kDLCPU, 0}));
+    ICHECK_EQ(GetDataSize(*arrays.back().operator->()), e.nbytes)
+        << "size mismatch for tensor " << e.name;
+    total_bytes += e.nbytes;
+  }
+
+  if (num_threads <= 0) {
+    num_threads = std::min(threading::NumThreads(), 8);
+  }
+  uint64_t max_workers = std::max<uint64_t>(1, total_bytes / kParamsMinBytesPerThread);
+  num_threads = static_cast<int>(std::max<uint64_t>(
+      1, std::min<uint64_t>(static_cast<uint64_t>(num_threads), max_workers)));
+
+  // Entries are stored in file order, so cutting the payload stream into
+  // equally sized pieces gives every worker one sequential region of the file.
+  struct Segment {
+    uint64_t offset;
+    char* dst;
+    uint64_t nbytes;
+  };
+  std::vector<std::vector<Segment>> plan(num_threads);
+  uint64_t per_worker = (total_bytes + num_threads - 1) / num_threads;
+  int worker = 0;
+  uint64_t assigned = 0;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const ParamsFileEntry& e = entries_[i];
+    char* dst = static_cast<char*>(arrays[i]->data);
+    uint64_t done = 0;
+    while (done < e.nbytes) {
+      if (assigned == per_worker && worker + 1 < num_threads) {
+        ++worker;
+        assigned = 0;
+      }
+      uint64_t n = std::min(e.nbytes - done, per_worker - assigned);
+      if (worker + 1 == num_threads) n = e.nbytes - done;
+      plan[worker].push_back({e.offset + done, dst + done, n});
+      done += n;
+      assigned += n;
+    }
+  }
+
+  support::parallel_for(
+      0, num_threads,
+      [&](int64_t worker_id) {
+        for (const Segment& seg : plan[worker_id]) {
+          ReadAt(seg.offset, seg.dst, seg.nbytes);
+        }
+      },
+      num_threads);
+
+  if (verify && has_checksum()) {
+    support::parallel_for(
+        0, static_cast<int64_t>(entries_.size()),
+        [&](int64_t i) { Verify(entries_[i], arrays[i]->data); }, num_threads);
+  }
+
+  Map<String, NDArray> ret;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    ret.Set(entries_[i].name, arrays[i]);
+  }
+  return ret;
+}
+
+Map<String, NDArray> LoadParams(const std::string& file_name, int num_threads) {
+  return ParamsFileReader(file_name).LoadAll(num_threads);
+}
+
+CVM_REGISTER_GLOBAL("runtime.SaveParams")
+    .set_body_typed([](std::string file_name, Map<String, NDArray> params, bool checksum) {
+      SaveParams(file_name, params, checksum);
+    });
+
+CVM_REGISTER_GLOBAL("runtime.LoadParams")
+    .set_body_typed([](std::string file_name, int num_threads) {
+      return LoadParams(file_name, num_threads);
+    });
+
+CVM_REGISTER_GLOBAL("runtime.LoadParamsLazy").set_body_typed([](std::string file_name) {
+  auto reader = std::make_shared<ParamsFileReader>(file_name);
+  return PackedFunc([reader](CVMArgs args, CVMRetValue* rv) {
+    *rv = reader->Load(args[0].operator std::string());
+  });
+});
+
+CVM_REGISTER_GLOBAL("runtime.SaveNDArray")
+    .set_body_typed([](std::string file_name, NDArray arr, bool checksum) {
+      SaveParams(file_name, Map<String, NDArray>({{String(""), arr}}), checksum);
+    });
+
+CVM_REGISTER_GLOBAL("runtime.LoadNDArray").set_body_typed([](std::string file_name) {
+  return ParamsFileReader(file_name).Load("");
+});
+
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,141 @@
+//
+// Created by WangJingYu on 2021/7/12.
+//
+
+#ifndef CVM_SRC_RUNTIME_FILE_UTILS_H_
+#define CVM_SRC_RUNTIME_FILE_UTILS_H_
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*!
+ * \brief Magic number for the params file format.
+ *
+ *  A params file is laid out as follows, the integers and the payloads in the byte order
+ *  of the host that wrote it:
+ *
+ * \code
+ *  header : magic(u64) version(u32) flags(u32) num_tensors(u64) data_begin(u64)
+ *  index  : num_tensors x entry
+ *  entry  : name_len(u64) name(char[name_len]) dtype(code u8, bits u8, lanes u16)
+ *           ndim(i32) shape(i64[ndim]) offset(u64) nbytes(u64) checksum(u32)
+ *  data   : tensor payloads, each starting at a kParamsAlignment aligned file offset
+ * \endcode
+ *
+ *  Because every payload is aligned, the data section can be mmap'd and viewed
+ *  directly without copying. The magic doubles as the byte order mark, a file of the
+ *  other byte order is rejected rather than swapped.
+ */
+constexpr uint64_t kCVMParamsMagic = 0xC7A3D5E1F0B20001UL;
+/*! \brief The current version of the params file format. */
+constexpr uint32_t kCVMParamsVersion = 1;
+/*! \brief Alignment of each tensor payload inside the params file. */
+constexpr uint64_t kParamsAlignment = 64;
+/*! \brief Flag bit: entries carry a CRC32C checksum of their payload. */
+constexpr uint32_t kParamsFlagChecksum = 1U;
+
+/*! \brief Index entry of one tensor in a params file. */
+struct ParamsFileEntry {
+  /*! \brief name of the tensor */
+  std::string name;
+  /*! \brief data type of the tensor */
+  DLDataType dtype;
+  /*! \brief shape of the tensor */
+  std::vector<int64_t> shape;
+  /*! \brief absolute file offset of the payload */
+  uint64_t offset;
+  /*! \brief size of the payload in bytes */
+  uint64_t nbytes;
+  /*! \brief CRC32C of the payload, zero when checksums are disabled */
+  uint32_t checksum;
+};
+
+/*!
+ * \brief Reader of a params file.
+ *
+ *  Only the header and the index are read on construction, so single tensors
+ *  can be loaded lazily by name. LoadAll streams the whole data section with
+ *  large sequential reads split across worker threads.
+ */
+class ParamsFileReader {
+ public:
+  /*!
+   * \brief Open a params file and read its index.
+   * \param file_name The name of the file.
+   */
+  explicit ParamsFileReader(const std::string& file_name);
+  ~ParamsFileReader();
+  ParamsFileReader(const ParamsFileReader&) = delete;
+  ParamsFileReader& operator=(const ParamsFileReader&) = delete;
+  /*! \return The index entries in file order. */
+  const std::vector<ParamsFileEntry>& entries() const { return entries_; }
+  /*! \return Whether the file carries per-tensor checksums. */
+  bool has_checksum() const { return (flags_ & kParamsFlagChecksum) != 0; }
+  /*! \return Whether the file contains a tensor called name. */
+  bool Contains(const std::string& name) const { return name2index_.count(name) != 0; }
+  /*!
+   * \brief Load a single tensor by name.
+   * \param name The name of the tensor.
+   * \param verify Whether to verify the checksum when the file carries one.
+   * \return The loaded array.
+   */
+  NDArray Load(const std::string& name, bool verify = true) const;
+  /*!
+   * \brief Load every tensor of the file.
+   * \param num_threads Number of reader threads, 0 picks a default.
+   * \param verify Whether to verify the checksums when the file carries them.
+   * \return The name to array map.
+   */
+  Map<String, NDArray> LoadAll(int num_threads = 0, bool verify = true) const;
+
+ private:
+  /*! \brief Read nbytes at offset into dst, with large sequential reads. */
+  void ReadAt(uint64_t offset, void* dst, uint64_t nbytes) const;
+  /*! \brief Check the checksum of a loaded entry. */
+  void Verify(const ParamsFileEntry& entry, const void* data) const;
+
+  std::string file_name_;
+  int fd_{-1};
+  uint32_t flags_{0};
+  uint64_t file_size_{0};
+  std::vector<ParamsFileEntry> entries_;
+  std::unordered_map<std::string, size_t> name2index_;
+};
+
+/*!
+ * \brief Compute the CRC32C(Castagnoli) checksum of a buffer.
+ * \param data The buffer.
+ * \param size Number of bytes.
+ * \param crc The running checksum to continue from.
+ * \return The checksum.
+ */
+uint32_t CRC32C(const void* data, size_t size, uint32_t crc = 0);
+
+/*!
+ * \brief Save params to a file.
+ * \param file_name The name of the file.
+ * \param params The parameters, every array must be a compact CPU tensor.
+ * \param checksum Whether to store a CRC32C checksum for each tensor.
+ */
+void SaveParams(const std::string& file_name, const Map<String, NDArray>& params,
+                bool checksum = false);
+
+/*!
+ * \brief Load params from a file.
+ * \param file_name The name of the file.
+ * \param num_threads Number of reader threads, 0 picks a default.
+ * \return The name to array map.
+ */
+Map<String, NDArray> LoadParams(const std::string& file_name, int num_threads = 0);
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_FILE_UTILS_H_
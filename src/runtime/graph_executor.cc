@@ -0,0 +1,513 @@
+//
+// Created by WangJingYu on 2021/7/27.
+//
+
+#include "graph_executor.h"
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/memory.h>
+#include <cvm/runtime/registry.h>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "../support/json.h"
+#include "memory_planner.h"
+#include "thread_pool.h"
+
+namespace cvm {
+namespace runtime {
+
+using support::JSONValue;
+
+namespace {
+
+/*! \brief The op of the graph inputs. */
+constexpr const char* kInputOp = "null";
+
+/*! \brief The parallelism from which kAuto runs the nodes concurrently. */
+constexpr double kMinInterOpParallelism = 1.5;
+
+/*! \brief The cost from which a node alone in the graph runs with all the threads. */
+constexpr double kIntraOpMinCost = 1 << 16;
+
+/*! \brief The heap order of the ready nodes, the highest priority on top. */
+struct ReadyOrder {
+  const double* priority;
+  bool operator()(int a, int b) const {
+    return priority[a] < priority[b] || (priority[a] == priority[b] && a > b);
+  }
+};
+
+bool SameDType(DLDataType a, DLDataType b) {
+  return a.code == b.code && a.bits == b.bits && a.lanes == b.lanes;
+}
+
+std::string NodeName(int index, const std::string& name) {
+  return "node " + std::to_string(index) + (name.empty() ? "" : " (" + name + ")");
+}
+
+void ArenaViewDeleter(Object* obj) {
+  auto* ptr = static_cast<NDArray::Container*>(obj);
+  static_cast<NDArray::Container*>(ptr->manager_ctx)->DecRef();
+  delete ptr;
+}
+
+/*!
+ * \brief A view of an arena at a byte offset. The kernels take CPU arrays without a
+ *  byte_offset, a CPU view points at its first byte instead.
+ */
+NDArray ArenaView(NDArray arena, size_t offset, std::vector<int64_t> shape,
+                  DLDataType dtype) {
+  if (arena->device.device_type != kDLCPU) {
+    return arena.CreateView(std::move(shape), dtype, offset);
+  }
+  auto* base = static_cast<NDArray::Container*>(const_cast<Object*>(arena.get()));
+  auto* view = new NDArray::Container(static_cast<char*>(arena->data) + offset,
+                                      std::move(shape), dtype, arena->device);
+  base->IncRef();
+  view->manager_ctx = base;
+  view->SetDeleter(ArenaViewDeleter);
+  return NDArray(GetObjectPtr<Object>(view));
+}
+
+}  // namespace
+
+struct GraphExecutor::Schedule {
+  std::mutex mutex;
+  std::condition_variable cv;
+  /*! \brief the unfinished inputs of every op call */
+  std::vector<int> pending;
+  /*! \brief the ready op calls, a heap in ReadyOrder */
+  std::vector<int> ready;
+  /*! \brief the op calls not finished and the ones running */
+  int remaining{0};
+  int in_flight{0};
+  /*! \brief set when the threads of the launch return */
+  bool phase_done{false};
+};
+
+GraphExecutor::GraphExecutor(const std::string& graph_json, Device dev, ExecutionPolicy policy)
+    : policy_(policy) {
+  JSONValue graph = JSONValue::Parse(graph_json);
+  const std::vector<JSONValue>& nodes = graph["nodes"].AsArray();
+  const int num_nodes = static_cast<int>(nodes.size());
+
+  // the op nodes for the planner, their inputs among the op nodes only.
+  std::vector<PlannerNode> planned;
+  std::vector<int> plan_index(num_nodes, -1);
+  std::vector<std::string> names(num_nodes);
+  std::vector<std::vector<int64_t>> shapes(num_nodes);
+  std::vector<DLDataType> dtypes(num_nodes);
+  std::vector<double> elems(num_nodes, 1.0);
+  // the elements read and written by each op node.
+  std::vector<double> costs;
+  for (int i = 0; i < num_nodes; ++i) {
+    const JSONValue& node = nodes[i];
+    const JSONValue* name = node.Find("name");
+    if (name != nullptr) names[i] = name->AsString();
+    const std::string& node_name = names[i];
+    for (const JSONValue& dim : node["shape"].AsArray()) {
+      if (dim.AsInt() < 0) {
+        throw Error("graph executor: negative extent in the shape of " + NodeName(i, node_name));
+      }
+      shapes[i].push_back(dim.AsInt());
+      elems[i] *= static_cast<double>(dim.AsInt());
+    }
+    const JSONValue* dtype = node.Find("dtype");
+    dtypes[i] = String2DLDataType(dtype != nullptr ? dtype->AsString() : "float32");
+
+    if (node["op"].AsString() == kInputOp) {
+      if (node_name.empty() || !input_index_.emplace(node_name, NumInputs()).second) {
+        throw Error("graph executor: the inputs need distinct names, " + NodeName(i, node_name));
+      }
+      input_nodes_.push_back(i);
+      continue;
+    }
+    PlannerNode pnode{shapes[i], dtypes[i], {}};
+    double cost = elems[i];
+    const JSONValue* inputs = node.Find("inputs");
+    if (inputs != nullptr) {
+      for (const JSONValue& input : inputs->AsArray()) {
+        if (input.AsInt() < 0 || input.AsInt() >= i) {
+          throw Error("graph executor: " + NodeName(i, node_name) + " reads node " +
+                      std::to_string(input.AsInt()) + ", nodes read earlier nodes only");
+        }
+        int src = plan_index[input.AsInt()];
+        if (src >= 0) pnode.inputs.push_back(src);
+        cost += elems[input.AsInt()];
+      }
+    }
+    costs.push_back(cost);
+    plan_index[i] = static_cast<int>(planned.size());
+    planned.push_back(std::move(pnode));
+  }
+
+  std::vector<int> planned_outputs;
+  for (const JSONValue& head : graph["heads"].AsArray()) {
+    if (head.AsInt() < 0 || head.AsInt() >= num_nodes) {
+      throw Error("graph executor: head " + std::to_string(head.AsInt()) + " is not a node");
+    }
+    output_nodes_.push_back(static_cast<int>(head.AsInt()));
+    if (plan_index[head.AsInt()] >= 0) planned_outputs.push_back(plan_index[head.AsInt()]);
+  }
+
+  std::vector<std::vector<int>> op_inputs(planned.size());
+  for (size_t op = 0; op < planned.size(); ++op) op_inputs[op] = planned[op].inputs;
+  InitSchedule(op_inputs, costs);
+  inter_op_ = policy == ExecutionPolicy::kInterOp ||
+              (policy == ExecutionPolicy::kAuto && parallelism_ >= kMinInterOpParallelism);
+  MemoryPlan plan = inter_op_ ? PlanConcurrentMemory(planned, planned_outputs)
+                              : PlanMemory(ComputeLifetimes(planned, planned_outputs));
+  arena_bytes_ = plan.arena_bytes;
+  NDArray arena = NDArray::Empty({static_cast<int64_t>(arena_bytes_)},
+                                  DLDataType{kDLUInt, 8, 1}, dev);
+  tensors_.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    tensors_[i] = plan_index[i] >= 0
+                      ? ArenaView(arena, plan.offsets[plan_index[i]], shapes[i], dtypes[i])
+                      : NDArray::Empty(shapes[i], dtypes[i], dev);
+  }
+
+  // every op is looked up once, whatever the number of its nodes.
+  std::unordered_map<std::string, PackedFunc> funcs;
+  auto push_arg = [this](auto&& value) {
+    arg_values_.emplace_back();
+    arg_type_codes_.push_back(kCVMNullptr);
+    CVMArgsSetter setter(arg_values_.data(), arg_type_codes_.data());
+    setter(arg_values_.size() - 1, std::forward<decltype(value)>(value));
+  };
+  for (int i = 0; i < num_nodes; ++i) {
+    if (plan_index[i] < 0) continue;
+    const JSONValue& node = nodes[i];
+    const std::string& op = node["op"].AsString();
+    auto it = funcs.find(op);
+    if (it == funcs.end()) {
+      const PackedFunc* f = Registry::Get(op);
+      if (f == nullptr) {
+        throw Error("graph executor: " + NodeName(i, names[i]) + " calls " + op +
+                    ", which is not registered");
+      }
+      it = funcs.emplace(op, *f).first;
+    }
+    OpCall call{it->second, static_cast<int>(arg_values_.size()), 0};
+
+    const JSONValue* inputs = node.Find("inputs");
+    if (inputs != nullptr) {
+      for (const JSONValue& input : inputs->AsArray()) push_arg(tensors_[input.AsInt()]);
+    }
+    push_arg(tensors_[i]);
+    const JSONValue* attrs = node.Find("attrs");
+    if (attrs != nullptr) {
+      for (const JSONValue& attr : attrs->AsArray()) {
+        switch (attr.type()) {
+          case JSONValue::kNull:
+            push_arg(nullptr);
+            break;
+          case JSONValue::kBool:
+            push_arg(attr.AsBool());
+            break;
+          case JSONValue::kNumber:
+            if (attr.IsInt()) {
+              push_arg(attr.AsInt());
+            } else {
+              push_arg(attr.AsNumber());
+            }
+            break;
+          case JSONValue::kString:
+            // an object handle, the callee takes a reference instead of building a String.
+            attr_objects_.push_back(String(attr.AsString()));
+            push_arg(attr_objects_.back());
+            break;
+          case JSONValue::kArray: {
+            std::vector<int64_t> dims;
+            for (const JSONValue& dim : attr.AsArray()) dims.push_back(dim.AsInt());
+            attr_objects_.push_back(ShapeTuple(std::move(dims)));
+            push_arg(attr_objects_.back());
+            break;
+          }
+          default:
+            throw Error("graph executor: objects are not supported as attrs of " +
+                        NodeName(i, names[i]));
+        }
+      }
+    }
+    call.num_args = static_cast<int>(arg_values_.size()) - call.begin;
+    op_calls_.push_back(std::move(call));
+  }
+}
+
+GraphExecutor::~GraphExecutor() = default;
+
+void GraphExecutor::InitSchedule(const std::vector<std::vector<int>>& op_inputs,
+                                 const std::vector<double>& costs) {
+  const int num_ops = static_cast<int>(op_inputs.size());
+  cost_ = costs;
+  num_deps_.assign(num_ops, 0);
+  succ_begin_.assign(num_ops + 1, 0);
+  for (int op = 0; op < num_ops; ++op) {
+    num_deps_[op] = static_cast<int>(op_inputs[op].size());
+    for (int src : op_inputs[op]) ++succ_begin_[src + 1];
+  }
+  for (int op = 0; op < num_ops; ++op) succ_begin_[op + 1] += succ_begin_[op];
+  succ_.resize(succ_begin_[num_ops]);
+  std::vector<int> fill(succ_begin_.begin(), succ_begin_.end() - 1);
+  for (int op = 0; op < num_ops; ++op) {
+    for (int src : op_inputs[op]) succ_[fill[src]++] = op;
+  }
+
+  // the nodes are in topological order, the successors come later.
+  priority_.assign(num_ops, 0.0);
+  double total = 0.0, critical = 0.0;
+  for (int op = num_ops - 1; op >= 0; --op) {
+    double tail = 0.0;
+    for (int i = succ_begin_[op]; i < succ_begin_[op + 1]; ++i) {
+      tail = std::max(tail, priority_[succ_[i]]);
+    }
+    priority_[op] = cost_[op] + tail;
+    total += cost_[op];
+    critical = std::max(critical, priority_[op]);
+  }
+  parallelism_ = critical > 0.0 ? total / critical : 1.0;
+
+  schedule_.reset(new Schedule());
+  schedule_->pending.resize(num_ops);
+  schedule_->ready.reserve(num_ops);
+}
+
+void GraphExecutor::Run() {
+  const int num_threads = ThreadPool::Global()->NumThreads();
+  if (!inter_op_ || num_threads == 1 || ThreadPool::InParallelRegion()) {
+    for (int op = 0; op < NumOpNodes(); ++op) CallOp(op);
+    return;
+  }
+  // no more threads than the graph is wide.
+  int width = std::max(2, static_cast<int>(std::ceil(parallelism_)));
+  RunInterOp(std::min(num_threads, width));
+}
+
+void GraphExecutor::RunInterOp(int num_threads) {
+  Schedule& s = *schedule_;
+  const ReadyOrder order{priority_.data()};
+  std::copy(num_deps_.begin(), num_deps_.end(), s.pending.begin());
+  s.ready.clear();
+  for (int op = 0; op < NumOpNodes(); ++op) {
+    if (num_deps_[op] == 0) s.ready.push_back(op);
+  }
+  std::make_heap(s.ready.begin(), s.ready.end(), order);
+  s.remaining = NumOpNodes();
+  s.in_flight = 0;
+  while (s.remaining > 0) {
+    if (RunsAlone()) {
+      // nothing else can run, the kernel of the node takes all the threads.
+      int op = s.ready[0];
+      s.ready.clear();
+      CallOp(op);
+      Finish(op);
+      continue;
+    }
+    s.phase_done = false;
+    ThreadPool::Global()->Launch(InterOpTask, this, num_threads);
+  }
+}
+
+int GraphExecutor::InterOpTask(int /*task_id*/, CVMParallelGroupEnv* /*penv*/, void* cdata) {
+  static_cast<GraphExecutor*>(cdata)->RunReadyNodes();
+  return 0;
+}
+
+void GraphExecutor::RunReadyNodes() {
+  Schedule& s = *schedule_;
+  const ReadyOrder order{priority_.data()};
+  std::unique_lock<std::mutex> lock(s.mutex);
+  while (true) {
+    while (!s.phase_done && s.ready.empty()) s.cv.wait(lock);
+    if (s.phase_done) return;
+    std::pop_heap(s.ready.begin(), s.ready.end(), order);
+    int op = s.ready.back();
+    s.ready.pop_back();
+    ++s.in_flight;
+    lock.unlock();
+    try {
+      CallOp(op);
+    } catch (...) {
+      // the other threads return once their nodes finished, the launch rethrows.
+      lock.lock();
+      s.phase_done = true;
+      s.cv.notify_all();
+      throw;
+    }
+    lock.lock();
+    --s.in_flight;
+    size_t num_ready = s.ready.size();
+    Finish(op);
+    if (s.remaining == 0 || RunsAlone()) {
+      s.phase_done = true;
+      s.cv.notify_all();
+      return;
+    }
+    // this thread takes one of the nodes made ready, the others wake a thread each.
+    for (size_t i = num_ready + 1; i < s.ready.size(); ++i) s.cv.notify_one();
+  }
+}
+
+void GraphExecutor::Finish(int op) {
+  Schedule& s = *schedule_;
+  const ReadyOrder order{priority_.data()};
+  --s.remaining;
+  for (int i = succ_begin_[op]; i < succ_begin_[op + 1]; ++i) {
+    if (--s.pending[succ_[i]] == 0) {
+      s.ready.push_back(succ_[i]);
+      std::push_heap(s.ready.begin(), s.ready.end(), order);
+    }
+  }
+}
+
+bool GraphExecutor::RunsAlone() const {
+  const Schedule& s = *schedule_;
+  return policy_ == ExecutionPolicy::kAuto && s.in_flight == 0 && s.ready.size() == 1 &&
+         cost_[s.ready[0]] >= kIntraOpMinCost;
+}
+
+int GraphExecutor::CheckInputIndex(int index) const {
+  if (index < 0 || index >= NumInputs()) {
+    throw Error("graph executor: input " + std::to_string(index) + " out of range [0, " +
+                std::to_string(NumInputs()) + ")");
+  }
+  return input_nodes_[index];
+}
+
+void GraphExecutor::SetInput(int index, const NDArray& data) {
+  NDArray input = tensors_[CheckInputIndex(index)];
+  if (!data.defined() || data.Shape() != input.Shape() || !SameDType(data->dtype, input->dtype)) {
+    throw Error("graph executor: input " + std::to_string(index) + " expects a " +
+                DLDataType2String(input->dtype) + " tensor of the shape of the graph");
+  }
+  input.CopyFrom(data);
+}
+
+void GraphExecutor::BindInput(int index, const NDArray& buffer) {
+  BindNode(CheckInputIndex(index), buffer, "input " + std::to_string(index));
+}
+
+void GraphExecutor::BindOutput(int index, const NDArray& buffer) {
+  int node = output_nodes_[CheckOutputIndex(index)];
+  if (std::find(input_nodes_.begin(), input_nodes_.end(), node) != input_nodes_.end()) {
+    throw Error("graph executor: output " + std::to_string(index) +
+                " is an input of the graph, bind the input instead");
+  }
+  BindNode(node, buffer, "output " + std::to_string(index));
+}
+
+void GraphExecutor::BindNode(int node, const NDArray& buffer, const std::string& what) {
+  const NDArray& tensor = tensors_[node];
+  if (!buffer.defined() || buffer.Shape() != tensor.Shape() ||
+      !SameDType(buffer->dtype, tensor->dtype)) {
+    throw Error("graph executor: " + what + " expects a " + DLDataType2String(tensor->dtype) +
+                " tensor of the shape of the graph");
+  }
+  if (buffer->device.device_type != tensor->device.device_type ||
+      buffer->device.device_id != tensor->device.device_id) {
+    throw Error("graph executor: " + what + " is bound to a tensor of another device");
+  }
+  // the kernels take CPU arrays without a byte_offset, see ArenaView.
+  if (!buffer.IsContiguous() ||
+      (buffer->device.device_type == kDLCPU && buffer->byte_offset != 0)) {
+    throw Error("graph executor: " + what + " is bound to a strided or offset tensor");
+  }
+  void* old_handle = NDArray::FFIGetHandle(tensor);
+  void* new_handle = NDArray::FFIGetHandle(buffer);
+  for (size_t i = 0; i < arg_values_.size(); ++i) {
+    if (arg_type_codes_[i] == kCVMNDArrayHandle && arg_values_[i].v_handle == old_handle) {
+      arg_values_[i].v_handle = new_handle;
+    }
+  }
+  tensors_[node] = buffer;
+}
+
+NDArray GraphExecutor::GetInput(int index) const { return tensors_[CheckInputIndex(index)]; }
+
+int GraphExecutor::CheckOutputIndex(int index) const {
+  if (index < 0 || index >= NumOutputs()) {
+    throw Error("graph executor: output " + std::to_string(index) + " out of range [0, " +
+                std::to_string(NumOutputs()) + ")");
+  }
+  return index;
+}
+
+NDArray GraphExecutor::GetOutput(int index) const {
+  return tensors_[output_nodes_[CheckOutputIndex(index)]];
+}
+
+int GraphExecutor::GetInputIndex(const std::string& name) const {
+  auto it = input_index_.find(name);
+  return it != input_index_.end() ? it->second : -1;
+}
+
+PackedFunc GraphExecutor::GetFunction(const std::string& name,
+                                      const ObjectPtr<Object>& sptr_to_self) {
+  if (name == "run") {
+    return PackedFunc([sptr_to_self, this](CVMArgs /*args*/, CVMRetValue* /*rv*/) { this->Run(); });
+  } else if (name == "set_input") {
+    return PackedFunc([sptr_to_self, this](CVMArgs args, CVMRetValue* /*rv*/) {
+      int index = -1;
+      if (args[0].type_code() == kDLInt) {
+        index = args[0];
+      } else {
+        std::string input_name = args[0];
+        index = this->GetInputIndex(input_name);
+        if (index < 0) throw Error("graph executor: no input named " + input_name);
+      }
+      this->SetInput(index, args[1]);
+    });
+  } else if (name == "get_input") {
+    return PackedFunc([sptr_to_self, this](CVMArgs args, CVMRetValue* rv) {
+      *rv = this->GetInput(args[0]);
+    });
+  } else if (name == "get_output") {
+    return PackedFunc([sptr_to_self, this](CVMArgs args, CVMRetValue* rv) {
+      *rv = this->GetOutput(args[0]);
+    });
+  } else if (name == "get_num_inputs") {
+    return PackedFunc(
+        [sptr_to_self, this](CVMArgs /*args*/, CVMRetValue* rv) { *rv = this->NumInputs(); });
+  } else if (name == "get_num_outputs") {
+    return PackedFunc(
+        [sptr_to_self, this](CVMArgs /*args*/, CVMRetValue* rv) { *rv = this->NumOutputs(); });
+  } else if (name == "get_input_index") {
+    return PackedFunc([sptr_to_self, this](CVMArgs args, CVMRetValue* rv) {
+      *rv = this->GetInputIndex(args[0].operator std::string());
+    });
+  }
+  return PackedFunc();
+}
+
+// (graph_json, device_type, device_id[, policy]), policy an ExecutionPolicy, kAuto by default.
+CVM_REGISTER_GLOBAL("runtime.GraphExecutorCreate").set_body([](CVMArgs args, CVMRetValue* rv) {
+  std::string graph_json = args[0];
+  Device dev{static_cast<DLDeviceType>(args[1].operator int()), args[2].operator int()};
+  ExecutionPolicy policy = ExecutionPolicy::kAuto;
+  if (args.size() > 3) {
+    int code = args[3];
+    if (code < 0 || code > static_cast<int>(ExecutionPolicy::kAuto)) {
+      throw Error("GraphExecutorCreate: unknown execution policy " + std::to_string(code));
+    }
+    policy = static_cast<ExecutionPolicy>(code);
+  }
+  *rv = Module(make_object<GraphExecutor>(graph_json, dev, policy));
+});
+
+CVM_REGISTER_GLOBAL("runtime.GraphExecutorGetFunction")
+    .set_body_typed([](Module executor, std::string name) {
+      if (dynamic_cast<GraphExecutor*>(executor.operator->()) == nullptr) {
+        throw Error("GraphExecutorGetFunction: expect a graph executor");
+      }
+      return executor.GetFunction(name);
+    });
+
+}  // namespace runtime
+}  // namespace cvm
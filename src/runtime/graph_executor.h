@@ -0,0 +1,211 @@
+//
+// Created by WangJingYu on 2021/7/27.
+//
+
+/*!
+ * \file graph_executor.h
+ * \brief An executor of graphs of registered PackedFuncs over preplanned tensors.
+ *
+ *  The graph is a JSON document:
+ *
+ * \code
+ *  {
+ *    "nodes": [
+ *      {"op": "null", "name": "x", "shape": [1, 64], "dtype": "float32"},
+ *      {"op": "kernel.relu", "name": "relu0", "inputs": [0], "shape": [1, 64]},
+ *      {"op": "kernel.sum", "name": "sum0", "inputs": [1], "shape": [1],
+ *       "attrs": [[1], false, false]}
+ *    ],
+ *    "heads": [2]
+ *  }
+ * \endcode
+ *
+ *  Nodes are in topological order and each produces one tensor of its shape and dtype
+ *  (float32 when omitted). A node with the op "null" is a graph input, any other op is
+ *  the name of a global PackedFunc called as op(inputs..., out, attrs...): the tensors of
+ *  the input nodes, the tensor of the node, then the attrs (numbers, bools, strings, null
+ *  and arrays of integers as ShapeTuples). heads are the nodes of the graph outputs.
+ *
+ *  Independent nodes can run concurrently on the thread pool, see ExecutionPolicy.
+ */
+#ifndef CVM_SRC_RUNTIME_GRAPH_EXECUTOR_H_
+#define CVM_SRC_RUNTIME_GRAPH_EXECUTOR_H_
+
+#include <cvm/runtime/c_backend_api.h>
+#include <cvm/runtime/module.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/object.h>
+#include <cvm/runtime/packed_func.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief How Run() spreads the nodes of a graph over the threads of the pool. */
+enum class ExecutionPolicy : int {
+  /*! \brief The nodes in order, every kernel parallel over all the threads. */
+  kSequential = 0,
+  /*! \brief Ready nodes run concurrently, one per thread, with single threaded kernels. */
+  kInterOp,
+  /*!
+   * \brief Inter-op on graphs with independent branches, sequential on the others. A
+   *  costly node alone on a narrow part of the graph runs with all the threads.
+   */
+  kAuto,
+};
+
+/*!
+ * \brief Runs a graph with everything but the kernels done at load.
+ *
+ *  Loading resolves every op to its PackedFunc, places the tensors of the op nodes in
+ *  one arena by the memory planner and packs the arguments of every call into flat
+ *  CVMValue and type code arrays. Run() is then a loop of CallPacked over them, without
+ *  allocations or name lookups of its own. Input tensors live outside the arena, an
+ *  input keeps its value over runs.
+ *
+ *  Inter-op runs count the unfinished inputs of every node and hand the ready nodes to
+ *  the threads of a pool launch, the node with the costliest path to the end of the
+ *  graph first. The cost of a node is the number of elements it reads and writes. The
+ *  arena is then planned for any order of the nodes, the kernels being deterministic
+ *  the results are the ones of a sequential run.
+ */
+class GraphExecutor : public ModuleNode {
+ public:
+  /*!
+   * \brief Load a graph, throws an Error when it is malformed or an op is not registered.
+   * \param graph_json The JSON document of the graph.
+   * \param dev The device of the tensors.
+   * \param policy How Run() uses the threads of the pool.
+   */
+  GraphExecutor(const std::string& graph_json, Device dev,
+                ExecutionPolicy policy = ExecutionPolicy::kAuto);
+
+  ~GraphExecutor();
+
+  /*!
+   * \brief Execute every op node once. A node throwing an Error ends the run, nodes
+   *  running concurrently finish first.
+   */
+  void Run();
+
+  /*! \brief Copy data into an input, data has the shape and the dtype of the input. */
+  void SetInput(int index, const NDArray& data);
+
+  /*!
+   * \brief Make the graph read an input from buffer instead of its own tensor, from
+   *  then on SetInput writes and GetInput returns the buffer.
+   * \param buffer A contiguous tensor of the shape and the dtype of the input, on the
+   *  device of the graph, kept alive by the executor.
+   */
+  void BindInput(int index, const NDArray& buffer);
+
+  /*!
+   * \brief Make the graph write an output into buffer instead of the arena, the nodes
+   *  reading the output read the buffer. GetOutput then returns the buffer.
+   * \param buffer As for BindInput.
+   */
+  void BindOutput(int index, const NDArray& buffer);
+
+  /*! \return The tensor of an input. */
+  NDArray GetInput(int index) const;
+
+  /*! \return The tensor of an output, valid until the next Run(). */
+  NDArray GetOutput(int index) const;
+
+  /*! \return The index of the input node of a name, -1 when there is none. */
+  int GetInputIndex(const std::string& name) const;
+
+  int NumInputs() const { return static_cast<int>(input_nodes_.size()); }
+  int NumOutputs() const { return static_cast<int>(output_nodes_.size()); }
+  int NumOpNodes() const { return static_cast<int>(op_calls_.size()); }
+  /*! \return The bytes of the arena shared by the tensors of the op nodes. */
+  size_t ArenaBytes() const { return arena_bytes_; }
+  /*! \return Whether Run() runs independent nodes concurrently when the pool has threads. */
+  bool UsesInterOp() const { return inter_op_; }
+  /*! \return The total cost of the op nodes over the cost of the critical path. */
+  double Parallelism() const { return parallelism_; }
+
+  /*!
+   * \brief Get a function of the executor: "run", "set_input" (by index or name),
+   *  "get_input", "get_output", "get_num_inputs", "get_num_outputs" and
+   *  "get_input_index".
+   * \param name The name of the function.
+   * \param sptr_to_self The pointer to this executor, kept alive by the function unless null.
+   * \return The function, nullptr for an unknown name.
+   */
+  PackedFunc GetFunction(const std::string& name, const ObjectPtr<Object>& sptr_to_self) final;
+
+  using ModuleNode::GetFunction;
+
+  const char* type_key() const final { return "GraphExecutor"; }
+
+ private:
+  /*! \brief A prepared call, its arguments are [begin, begin + num_args) of the arrays. */
+  struct OpCall {
+    PackedFunc func;
+    int begin;
+    int num_args;
+  };
+
+  /*! \brief The state of an inter-op run. */
+  struct Schedule;
+
+  int CheckInputIndex(int index) const;
+  int CheckOutputIndex(int index) const;
+  /*! \brief Replace the tensor of a node by buffer, in the arguments of the calls too. */
+  void BindNode(int node, const NDArray& buffer, const std::string& what);
+  void CallOp(int op) const {
+    const OpCall& call = op_calls_[op];
+    CVMRetValue rv;
+    call.func.CallPacked(CVMArgs(arg_values_.data() + call.begin,
+                                 arg_type_codes_.data() + call.begin, call.num_args),
+                         &rv);
+  }
+  /*! \brief Build the dependencies, the costs and the priorities of the op calls. */
+  void InitSchedule(const std::vector<std::vector<int>>& op_inputs,
+                    const std::vector<double>& costs);
+  void RunInterOp(int num_threads);
+  /*! \brief Run ready nodes until the phase of the schedule ends, on one thread. */
+  void RunReadyNodes();
+  /*! \brief Count a finished node, its successors without unfinished inputs become ready. */
+  void Finish(int op);
+  /*! \return Whether the single ready node should run alone with all the threads. */
+  bool RunsAlone() const;
+  static int InterOpTask(int task_id, CVMParallelGroupEnv* penv, void* cdata);
+
+  /*! \brief The tensor of every node, op nodes are views of the arena. */
+  std::vector<NDArray> tensors_;
+  /*! \brief The nodes of the inputs and the outputs. */
+  std::vector<int> input_nodes_;
+  std::vector<int> output_nodes_;
+  std::unordered_map<std::string, int> input_index_;
+  std::vector<OpCall> op_calls_;
+  /*! \brief The arguments of all calls, one after the other. */
+  std::vector<CVMValue> arg_values_;
+  std::vector<int> arg_type_codes_;
+  /*! \brief The string and shape attrs referenced by the arguments. */
+  std::vector<ObjectRef> attr_objects_;
+  size_t arena_bytes_{0};
+
+  ExecutionPolicy policy_;
+  bool inter_op_{false};
+  double parallelism_{1.0};
+  /*! \brief The successors of the op calls, those of op i from succ_[succ_begin_[i]] on. */
+  std::vector<int> succ_begin_;
+  std::vector<int> succ_;
+  /*! \brief The inputs of every op call produced by other op calls. */
+  std::vector<int> num_deps_;
+  std::vector<double> cost_;
+  /*! \brief The cost of the costliest path from the op call to the end of the graph. */
+  std::vector<double> priority_;
+  std::unique_ptr<Schedule> schedule_;
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_GRAPH_EXECUTOR_H_
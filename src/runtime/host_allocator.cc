@@ -0,0 +1,267 @@
+//
+// Created by WangJingYu on 2021/7/15.
+//
+
+#include "host_allocator.h"
+
+#include <cvm/runtime/registry.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+namespace {
+
+inline size_t RoundUp(size_t value, size_t align) { return (value + align - 1) / align * align; }
+
+/*! \brief Whether the kernel can back madvised regions with transparent huge pages. */
+bool TransparentHugePageAvailable() {
+  static bool available = []() {
+    std::ifstream fs("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string mode;
+    if (!fs || !std::getline(fs, mode)) return false;
+    return mode.find("[never]") == std::string::npos;
+  }();
+  return available;
+}
+
+/*! \brief An anonymous mapping of the process with its huge page usage. */
+struct MappingInfo {
+  uintptr_t begin;
+  uintptr_t end;
+  size_t anon_huge_bytes;
+};
+
+/*! \brief Read the mappings of the process from /proc/self/smaps. */
+std::vector<MappingInfo> ReadMappings() {
+  std::vector<MappingInfo> mappings;
+  std::ifstream fs("/proc/self/smaps");
+  std::string line;
+  while (std::getline(fs, line)) {
+    unsigned long begin, end, kb;  // NOLINT(*)
+    if (std::sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2 &&
+        line.find(':') > line.find(' ')) {
+      mappings.push_back({begin, end, 0});
+    } else if (!mappings.empty() && std::sscanf(line.c_str(), "AnonHugePages: %lu kB", &kb) == 1) {
+      mappings.back().anon_huge_bytes = kb << 10;
+    }
+  }
+  return mappings;
+}
+
+class HostAllocator {
+ public:
+  static HostAllocator* Global() {
+    static HostAllocator* inst = new HostAllocator();
+    return inst;
+  }
+
+  HugePageConfig GetConfig(int device_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = configs_.find(device_id);
+    return it != configs_.end() ? it->second : default_config_;
+  }
+
+  void SetConfig(int device_id, HugePageConfig config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    configs_[device_id] = config;
+  }
+
+  /*! \return A huge page aligned region, nullptr when the caller should use the heap. */
+  void* AllocHugePageRegion(size_t nbytes) {
+    ++num_huge_allocs_;
+    bytes_requested_ += nbytes;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (!TransparentHugePageAvailable()) {
+      ++num_fallbacks_;
+      return nullptr;
+    }
+    size_t length = RoundUp(nbytes, kHugePageSize);
+    // over-map by one huge page, then trim both ends to an aligned region.
+    size_t map_length = length + kHugePageSize;
+    void* map = mmap(nullptr, map_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                     0);
+    if (map == MAP_FAILED) {
+      ++num_fallbacks_;
+      return nullptr;
+    }
+    uintptr_t begin = reinterpret_cast<uintptr_t>(map);
+    uintptr_t aligned = RoundUp(begin, kHugePageSize);
+    if (aligned != begin) munmap(map, aligned - begin);
+    size_t tail = begin + map_length - (aligned + length);
+    if (tail != 0) munmap(reinterpret_cast<void*>(aligned + length), tail);
+    void* ptr = reinterpret_cast<void*>(aligned);
+    if (madvise(ptr, length, MADV_HUGEPAGE) == 0) {
+      bytes_advised_ += length;
+    } else {
+      // the region is still usable with normal pages.
+      ++num_fallbacks_;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_[ptr] = length;
+    return ptr;
+#else
+    ++num_fallbacks_;
+    return nullptr;
+#endif
+  }
+
+  /*! \return Whether ptr was a huge page region and has been released. */
+  bool FreeHugePageRegion(void* ptr) {
+    size_t length;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = regions_.find(ptr);
+      if (it == regions_.end()) return false;
+      length = it->second;
+      regions_.erase(it);
+    }
+#if defined(__linux__)
+    munmap(ptr, length);
+#endif
+    return true;
+  }
+
+  size_t BackedBytes(const void* ptr) {
+    size_t length;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = regions_.find(const_cast<void*>(ptr));
+      if (it == regions_.end()) return 0;
+      length = it->second;
+    }
+    return BackedBytes(ReadMappings(), reinterpret_cast<uintptr_t>(ptr), length);
+  }
+
+  HugePageStats GetStats() {
+    HugePageStats stats;
+    stats.num_huge_allocs = num_huge_allocs_.load();
+    stats.num_fallbacks = num_fallbacks_.load();
+    stats.bytes_requested = bytes_requested_.load();
+    stats.bytes_advised = bytes_advised_.load();
+    std::vector<std::pair<uintptr_t, size_t>> regions;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const auto& kv : regions_) {
+        regions.emplace_back(reinterpret_cast<uintptr_t>(kv.first), kv.second);
+      }
+    }
+    if (regions.empty()) return stats;
+    std::vector<MappingInfo> mappings = ReadMappings();
+    for (const auto& region : regions) {
+      stats.bytes_huge_backed += BackedBytes(mappings, region.first, region.second);
+    }
+    return stats;
+  }
+
+ private:
+  HostAllocator() {
+    const char* enabled = std::getenv("CVM_HUGE_PAGE");
+    default_config_.enabled = enabled != nullptr && std::atoi(enabled) != 0;
+    const char* threshold = std::getenv("CVM_HUGE_PAGE_THRESHOLD");
+    if (threshold != nullptr) {
+      default_config_.threshold = std::strtoull(threshold, nullptr, 10);
+    }
+  }
+
+  /*!
+   * \brief Huge page backed bytes of a region. The kernel may merge neighbouring
+   *  regions into one mapping, the mapping total is then split by overlap.
+   */
+  static size_t BackedBytes(const std::vector<MappingInfo>& mappings, uintptr_t begin,
+                            size_t length) {
+    uintptr_t end = begin + length;
+    size_t backed = 0;
+    for (const MappingInfo& m : mappings) {
+      if (m.end <= begin || m.begin >= end) continue;
+      size_t overlap = std::min(end, m.end) - std::max(begin, m.begin);
+      size_t mapping_length = m.end - m.begin;
+      backed += static_cast<size_t>(static_cast<double>(m.anon_huge_bytes) * overlap /
+                                    mapping_length);
+    }
+    return std::min(backed, length);
+  }
+
+  std::mutex mutex_;
+  HugePageConfig default_config_;
+  std::unordered_map<int, HugePageConfig> configs_;
+  std::unordered_map<void*, size_t> regions_;
+  std::atomic<uint64_t> num_huge_allocs_{0};
+  std::atomic<uint64_t> num_fallbacks_{0};
+  std::atomic<uint64_t> bytes_requested_{0};
+  std::atomic<uint64_t> bytes_advised_{0};
+};
+
+}  // namespace
+
+void SetHugePageConfig(int device_id, HugePageConfig config) {
+  HostAllocator::Global()->SetConfig(device_id, config);
+}
+
+HugePageConfig GetHugePageConfig(int device_id) {
+  return HostAllocator::Global()->GetConfig(device_id);
+}
+
+void* HostAllocDataSpace(Device dev, size_t nbytes, size_t alignment) {
+  ICHECK_EQ(dev.device_type, kDLCPU) << "HostAllocDataSpace only supports CPU memory";
+  ICHECK_LE(alignment, kHugePageSize);
+  HugePageConfig config = GetHugePageConfig(dev.device_id);
+  if (config.enabled && nbytes >= std::max(config.threshold, kHugePageSize)) {
+    void* ptr = HostAllocator::Global()->AllocHugePageRegion(nbytes);
+    if (ptr != nullptr) return ptr;
+  }
+  void* ptr = nullptr;
+  // posix_memalign rejects zero sized requests on some platforms.
+  int err = posix_memalign(&ptr, alignment, nbytes == 0 ? alignment : nbytes);
+  if (err != 0 || ptr == nullptr) {
+    throw Error("HostAllocDataSpace: failed to allocate " + std::to_string(nbytes) + " bytes");
+  }
+  return ptr;
+}
+
+void HostFreeDataSpace(void* ptr) {
+  // only huge page aligned pointers can be huge page regions.
+  if (reinterpret_cast<uintptr_t>(ptr) % kHugePageSize == 0 &&
+      HostAllocator::Global()->FreeHugePageRegion(ptr)) {
+    return;
+  }
+  free(ptr);
+}
+
+size_t HugePageBackedBytes(const void* ptr) { return HostAllocator::Global()->BackedBytes(ptr); }
+
+HugePageStats GetHugePageStats() { return HostAllocator::Global()->GetStats(); }
+
+CVM_REGISTER_GLOBAL("runtime.SetHugePage")
+    .set_body_typed([](int device_id, bool enabled, int64_t threshold) {
+      HugePageConfig config = GetHugePageConfig(device_id);
+      config.enabled = enabled;
+      if (threshold > 0) config.threshold = static_cast<size_t>(threshold);
+      SetHugePageConfig(device_id, config);
+    });
+
+CVM_REGISTER_GLOBAL("runtime.HugePageStats").set_body_typed([](String key) -> int64_t {
+  HugePageStats stats = GetHugePageStats();
+  if (key == "num_huge_allocs") return stats.num_huge_allocs;
+  if (key == "num_fallbacks") return stats.num_fallbacks;
+  if (key == "bytes_requested") return stats.bytes_requested;
+  if (key == "bytes_advised") return stats.bytes_advised;
+  if (key == "bytes_huge_backed") return stats.bytes_huge_backed;
+  throw Error("runtime.HugePageStats: unknown key " + std::string(key));
+});
+
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,96 @@
+//
+// Created by WangJingYu on 2021/7/15.
+//
+
+#ifndef CVM_SRC_RUNTIME_HOST_ALLOCATOR_H_
+#define CVM_SRC_RUNTIME_HOST_ALLOCATOR_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief Size of a transparent huge page. */
+constexpr size_t kHugePageSize = 2UL << 20;
+/*! \brief Default size from which allocations are placed in huge pages. */
+constexpr size_t kDefaultHugePageThreshold = 4UL << 20;
+
+/*!
+ * \brief Huge page configuration of one host device.
+ *
+ *  The defaults come from the environment:
+ *  CVM_HUGE_PAGE=1 enables the mode for every CPU device and
+ *  CVM_HUGE_PAGE_THRESHOLD sets the threshold in bytes.
+ */
+struct HugePageConfig {
+  /*! \brief Whether large allocations are placed in huge pages. */
+  bool enabled{false};
+  /*! \brief Allocations of at least this many bytes use huge pages, never below kHugePageSize. */
+  size_t threshold{kDefaultHugePageThreshold};
+};
+
+/*! \brief Counters of the host allocator, all in bytes unless noted. */
+struct HugePageStats {
+  /*! \brief Number of allocations that took the huge page path. */
+  uint64_t num_huge_allocs{0};
+  /*! \brief Number of huge page allocations that fell back to normal pages. */
+  uint64_t num_fallbacks{0};
+  /*! \brief Bytes requested through the huge page path. */
+  uint64_t bytes_requested{0};
+  /*! \brief Bytes of regions the kernel accepted MADV_HUGEPAGE for. */
+  uint64_t bytes_advised{0};
+  /*! \brief Bytes of live huge page regions that are actually backed by huge pages. */
+  uint64_t bytes_huge_backed{0};
+};
+
+/*!
+ * \brief Set the huge page configuration of a CPU device.
+ * \param device_id The CPU device id.
+ * \param config The configuration.
+ */
+void SetHugePageConfig(int device_id, HugePageConfig config);
+
+/*!
+ * \param device_id The CPU device id.
+ * \return The huge page configuration of the device.
+ */
+HugePageConfig GetHugePageConfig(int device_id);
+
+/*!
+ * \brief Allocate host memory for a CPU device.
+ *
+ *  Allocations at or above the device threshold are placed in kHugePageSize
+ *  aligned anonymous mappings advised with MADV_HUGEPAGE when the mode is on.
+ *  If transparent huge pages are unavailable the mapping is still used with
+ *  normal pages, if the mapping fails the allocation falls back to the heap.
+ *
+ * \param dev The device.
+ * \param nbytes Number of bytes.
+ * \param alignment The alignment, at most kHugePageSize.
+ * \return The allocated pointer, throws Error when out of memory.
+ */
+void* HostAllocDataSpace(Device dev, size_t nbytes, size_t alignment);
+
+/*!
+ * \brief Free memory allocated by HostAllocDataSpace.
+ * \param ptr The pointer.
+ */
+void HostFreeDataSpace(void* ptr);
+
+/*!
+ * \brief Number of bytes of an allocation that are currently huge page backed.
+ * \param ptr A pointer returned by HostAllocDataSpace.
+ * \return The number of bytes, 0 when the allocation is not a huge page region.
+ */
+size_t HugePageBackedBytes(const void* ptr);
+
+/*! \return The host allocator counters, bytes_huge_backed is computed on demand. */
+HugePageStats GetHugePageStats();
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_HOST_ALLOCATOR_H_
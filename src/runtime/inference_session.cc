@@ -0,0 +1,68 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include "inference_session.h"
+
+#include <string>
+#include <utility>
+
+#include "alloc_counter.h"
+
+namespace cvm {
+namespace runtime {
+
+namespace {
+
+/*! \brief Deletes a view of caller memory, the memory stays. */
+void BufferViewDeleter(Object* obj) { delete static_cast<NDArray::Container*>(obj); }
+
+}  // namespace
+
+InferenceSession::InferenceSession(Module executor) : module_(std::move(executor)) {
+  exec_ = module_.defined() ? dynamic_cast<GraphExecutor*>(module_.operator->()) : nullptr;
+  if (exec_ == nullptr) throw Error("InferenceSession: expect a graph executor");
+}
+
+void InferenceSession::BindInput(int index, const NDArray& buffer) {
+  exec_->BindInput(index, buffer);
+}
+
+void InferenceSession::BindInput(const std::string& name, const NDArray& buffer) {
+  int index = exec_->GetInputIndex(name);
+  if (index < 0) throw Error("InferenceSession: no input named " + name);
+  exec_->BindInput(index, buffer);
+}
+
+void InferenceSession::BindInput(int index, void* data) {
+  exec_->BindInput(index, BufferView(exec_->GetInput(index), data));
+}
+
+void InferenceSession::BindOutput(int index, const NDArray& buffer) {
+  exec_->BindOutput(index, buffer);
+}
+
+void InferenceSession::BindOutput(int index, void* data) {
+  exec_->BindOutput(index, BufferView(exec_->GetOutput(index), data));
+}
+
+void InferenceSession::Run() {
+  AllocationCounter counter;
+  exec_->Run();
+  int64_t num_allocs = counter.count();
+  // the first run may set up the workspaces and the threads of the kernels.
+  if (num_runs_++ > 0 && num_allocs != 0) {
+    throw Error("InferenceSession: the run allocated " + std::to_string(num_allocs) +
+                " times, an op of the graph allocates on every call");
+  }
+}
+
+NDArray InferenceSession::BufferView(const NDArray& like, void* data) {
+  if (data == nullptr) throw Error("InferenceSession: cannot bind a null buffer");
+  auto* view = new NDArray::Container(data, like.Shape(), like->dtype, like->device);
+  view->SetDeleter(BufferViewDeleter);
+  return NDArray(GetObjectPtr<Object>(view));
+}
+
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,72 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file inference_session.h
+ * \brief A graph executor bound to the buffers of its caller, for request paths that
+ *  must not allocate.
+ */
+#ifndef CVM_SRC_RUNTIME_INFERENCE_SESSION_H_
+#define CVM_SRC_RUNTIME_INFERENCE_SESSION_H_
+
+#include <cvm/runtime/module.h>
+#include <cvm/runtime/ndarray.h>
+
+#include <string>
+
+#include "graph_executor.h"
+
+namespace cvm {
+namespace runtime {
+
+/*!
+ * \brief Runs a graph over input and output buffers bound once.
+ *
+ *  The executor packs the arguments of every call at load, binding the buffers points
+ *  those arguments at the memory of the caller: Run() neither copies the inputs in nor
+ *  the outputs out, and goes through no CVMRetValue, String or NDArray of its own. Runs
+ *  after the first one, which may set up the workspaces and the threads of the kernels,
+ *  do not allocate. Builds with USE_ALLOC_HOOK count the allocations of the calling
+ *  thread, see alloc_counter.h, and Run() throws an Error when there are any.
+ *
+ *  The buffers are bound before the runs, not while one is in progress.
+ */
+class InferenceSession {
+ public:
+  /*! \param executor A graph executor, see runtime.GraphExecutorCreate. */
+  explicit InferenceSession(Module executor);
+
+  /*! \brief Bind an input to a tensor, see GraphExecutor::BindInput. */
+  void BindInput(int index, const NDArray& buffer);
+  void BindInput(const std::string& name, const NDArray& buffer);
+  /*!
+   * \brief Bind an input to memory of the caller, which must outlive the session.
+   * \param data The elements of the input, contiguous, on the device of the graph.
+   */
+  void BindInput(int index, void* data);
+
+  /*! \brief Bind an output to a tensor, see GraphExecutor::BindOutput. */
+  void BindOutput(int index, const NDArray& buffer);
+  /*! \brief Bind an output to memory of the caller, as for BindInput. */
+  void BindOutput(int index, void* data);
+
+  /*! \brief Run the graph, the results are in the bound outputs. */
+  void Run();
+
+  GraphExecutor* executor() const { return exec_; }
+  int64_t num_runs() const { return num_runs_; }
+
+ private:
+  /*! \return A tensor over data with the shape, the dtype and the device of like. */
+  static NDArray BufferView(const NDArray& like, void* data);
+
+  Module module_;
+  GraphExecutor* exec_;
+  int64_t num_runs_{0};
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_INFERENCE_SESSION_H_
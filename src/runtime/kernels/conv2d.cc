@@ -0,0 +1,802 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+#include "conv2d.h"
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../auto_tuner.h"
+#include "../op_strategy.h"
+#include "gemm.h"
+#include "kernel_utils.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const Conv2DKernels* GetConv2DKernels(SIMDLevel level) {
+#if CVM_KERNELS_X86
+  switch (level) {
+    case SIMDLevel::kAVX512:
+      return GetConv2DKernelsAVX512();
+    case SIMDLevel::kAVX2:
+      return GetConv2DKernelsAVX2();
+    case SIMDLevel::kSSE42:
+      return GetConv2DKernelsSSE42();
+    default:
+      break;
+  }
+#endif
+  return GetConv2DKernelsScalar();
+}
+
+namespace {
+
+/*! \brief Convolutions of fewer multiply-adds run on the calling thread. */
+constexpr int64_t kConv2DParallelMinFlops = 1 << 18;
+
+int64_t CeilDiv(int64_t a, int64_t b) { return (a + b - 1) / b; }
+
+int64_t MultiplyAdds(const Conv2DShape& s, const Conv2DParams& params) {
+  return s.batch * s.out_channels * s.out_h * s.out_w * s.in_channels / params.groups *
+         s.kernel_h * s.kernel_w;
+}
+
+/*! \brief Add bias[o] to the P values of each output channel, NCHW. */
+void AddBias(const Conv2DShape& s, const float* bias, float* out, bool parallel) {
+  const int64_t plane = s.out_h * s.out_w;
+  RunTasks(s.batch * s.out_channels, parallel, [&](int64_t task) {
+    float value = bias[task % s.out_channels];
+    float* dst = out + task * plane;
+    for (int64_t i = 0; i < plane; ++i) dst[i] += value;
+  });
+}
+
+/*!
+ * \brief Unroll the receptive fields of channels input channels of one image into a
+ *  (channels * KH * KW) x (OH * OW) matrix, zeros for the padding.
+ */
+void Im2col(const Conv2DShape& s, const Conv2DParams& params, const float* data,
+            int64_t channels, float* col, bool parallel) {
+  const int64_t rows = channels * s.kernel_h * s.kernel_w;
+  const int64_t plane = s.out_h * s.out_w;
+  RunTasks(rows, parallel, [&](int64_t row) {
+    const int64_t c = row / (s.kernel_h * s.kernel_w);
+    const int64_t r = row / s.kernel_w % s.kernel_h;
+    const int64_t q = row % s.kernel_w;
+    const float* src = data + c * s.in_h * s.in_w;
+    float* dst = col + row * plane;
+    for (int64_t oh = 0; oh < s.out_h; ++oh, dst += s.out_w) {
+      const int64_t ih = oh * params.stride_h - params.pad_top + r * params.dilation_h;
+      if (ih < 0 || ih >= s.in_h) {
+        std::fill(dst, dst + s.out_w, 0.0f);
+        continue;
+      }
+      const float* line = src + ih * s.in_w;
+      const int64_t iw0 = q * params.dilation_w - params.pad_left;
+      // the outputs whose input column lies inside the row: [ow_begin, ow_end).
+      const int64_t ow_begin =
+          std::min(s.out_w, std::max<int64_t>(0, CeilDiv(-iw0, params.stride_w)));
+      const int64_t ow_end =
+          std::max(ow_begin, std::min(s.out_w, CeilDiv(s.in_w - iw0, params.stride_w)));
+      std::fill(dst, dst + ow_begin, 0.0f);
+      if (params.stride_w == 1) {
+        std::copy(line + iw0 + ow_begin, line + iw0 + ow_end, dst + ow_begin);
+      } else {
+        for (int64_t ow = ow_begin; ow < ow_end; ++ow) dst[ow] = line[iw0 + ow * params.stride_w];
+      }
+      std::fill(dst + ow_end, dst + s.out_w, 0.0f);
+    }
+  });
+}
+
+void Conv2DIm2col(const Conv2DShape& s, const Conv2DParams& params, const float* data,
+                  const float* weight, const float* bias, float* out, bool parallel) {
+  const int64_t groups = params.groups;
+  const int64_t group_in = s.in_channels / groups, group_out = s.out_channels / groups;
+  const int64_t depth = group_in * s.kernel_h * s.kernel_w;
+  const int64_t plane = s.out_h * s.out_w;
+  // a 1x1 stride 1 convolution without padding is a GEMM on the input itself.
+  const bool pointwise = s.kernel_h == 1 && s.kernel_w == 1 && params.stride_h == 1 &&
+                         params.stride_w == 1 && params.pad_top == 0 && params.pad_left == 0 &&
+                         params.pad_bottom == 0 && params.pad_right == 0;
+  KernelWorkspace workspace(pointwise ? 0 : depth * plane * sizeof(float));
+  float* col = workspace.As<float>();
+  for (int64_t n = 0; n < s.batch; ++n) {
+    for (int64_t g = 0; g < groups; ++g) {
+      const float* src = data + (n * s.in_channels + g * group_in) * s.in_h * s.in_w;
+      if (!pointwise) Im2col(s, params, src, group_in, col, parallel);
+      Sgemm(false, false, group_out, plane, depth, 1.0f, weight + g * group_out * depth, depth,
+            pointwise ? src : col, plane, 0.0f,
+            out + (n * s.out_channels + g * group_out) * plane, plane);
+    }
+  }
+  if (bias != nullptr) AddBias(s, bias, out, parallel);
+}
+
+/*! \return The input channel block of the direct convolution, the largest divisor up to 16. */
+int64_t InputBlock(int64_t channels) {
+  for (int64_t block = 16; block > 1; --block) {
+    if (channels % block == 0) return block;
+  }
+  return 1;
+}
+
+/*! \brief The blocked, padded input and the loops of the direct convolution. */
+struct DirectPlan {
+  int64_t in_block;
+  int64_t num_in_blocks;
+  int64_t num_out_blocks;
+  int64_t padded_h;
+  int64_t padded_w;
+};
+
+DirectPlan MakeDirectPlan(const Conv2DShape& s, const Conv2DParams& params, int64_t in_block) {
+  DirectPlan plan;
+  plan.in_block = in_block;
+  plan.num_in_blocks = s.in_channels / in_block;
+  plan.num_out_blocks = CeilDiv(s.out_channels, kConv2DOutBlock);
+  plan.padded_h = s.in_h + params.pad_top + params.pad_bottom;
+  plan.padded_w = s.in_w + params.pad_left + params.pad_right;
+  return plan;
+}
+
+/*!
+ * \brief Copy an input into the padded (N, C / c, Hp, Wp, c) layout.
+ * \param blocked Whether data is already NCHW[x]c, NCHW otherwise.
+ */
+void PadInput(const Conv2DShape& s, const Conv2DParams& params, const DirectPlan& plan,
+              const float* data, bool blocked, float* padded, bool parallel) {
+  const int64_t cb = plan.in_block;
+  const int64_t row = plan.padded_w * cb;
+  RunTasks(s.batch * plan.num_in_blocks * plan.padded_h, parallel, [&](int64_t task) {
+    const int64_t hp = task % plan.padded_h;
+    const int64_t nb = task / plan.padded_h;
+    float* dst = padded + task * row;
+    const int64_t ih = hp - params.pad_top;
+    if (ih < 0 || ih >= s.in_h) {
+      std::fill(dst, dst + row, 0.0f);
+      return;
+    }
+    std::fill(dst, dst + params.pad_left * cb, 0.0f);
+    std::fill(dst + (params.pad_left + s.in_w) * cb, dst + row, 0.0f);
+    dst += params.pad_left * cb;
+    if (blocked) {
+      const float* src = data + (nb * s.in_h + ih) * s.in_w * cb;
+      std::copy(src, src + s.in_w * cb, dst);
+      return;
+    }
+    const int64_t n = nb / plan.num_in_blocks, icb = nb % plan.num_in_blocks;
+    for (int64_t ci = 0; ci < cb; ++ci) {
+      const float* src = data + ((n * s.in_channels + icb * cb + ci) * s.in_h + ih) * s.in_w;
+      for (int64_t iw = 0; iw < s.in_w; ++iw) dst[iw * cb + ci] = src[iw];
+    }
+  });
+}
+
+/*! \brief OIHW weights into (O / 16, C / c, KH, KW, c, 16), zeros past O. */
+void BlockWeights(const Conv2DShape& s, const DirectPlan& plan, const float* weight,
+                  float* blocked) {
+  const int64_t cb = plan.in_block;
+  const int64_t taps = s.kernel_h * s.kernel_w;
+  const int64_t size = plan.num_out_blocks * s.in_channels * taps * kConv2DOutBlock;
+  std::fill(blocked, blocked + size, 0.0f);
+  for (int64_t o = 0; o < s.out_channels; ++o) {
+    const int64_t ob = o / kConv2DOutBlock, oi = o % kConv2DOutBlock;
+    for (int64_t c = 0; c < s.in_channels; ++c) {
+      const int64_t icb = c / cb, ci = c % cb;
+      for (int64_t t = 0; t < taps; ++t) {
+        blocked[(((ob * plan.num_in_blocks + icb) * taps + t) * cb + ci) * kConv2DOutBlock + oi] =
+            weight[(o * s.in_channels + c) * taps + t];
+      }
+    }
+  }
+}
+
+/*! \brief The direct convolution into the blocked output (N, O / 16, OH, OW, 16). */
+void RunDirect(const Conv2DShape& s, const Conv2DParams& params, const DirectPlan& plan,
+               const float* padded, const float* weight, const float* bias, float* out,
+               bool parallel) {
+  const Conv2DKernels* kernels = GetConv2DKernels(GetSIMDLevel());
+  Conv2DNCHWcTileArgs args;
+  args.num_in_blocks = plan.num_in_blocks;
+  args.in_block = plan.in_block;
+  args.kernel_h = s.kernel_h;
+  args.kernel_w = s.kernel_w;
+  args.stride_w = params.stride_w;
+  args.dilation_h = params.dilation_h;
+  args.dilation_w = params.dilation_w;
+  args.in_row_stride = plan.padded_w * plan.in_block;
+  args.in_block_stride = plan.padded_h * args.in_row_stride;
+  const int64_t weight_block = s.in_channels * s.kernel_h * s.kernel_w * kConv2DOutBlock;
+  // a task is one output row of one output block.
+  RunTasks(s.batch * plan.num_out_blocks * s.out_h, parallel, [&](int64_t task) {
+    const int64_t oh = task % s.out_h;
+    const int64_t ob = task / s.out_h % plan.num_out_blocks;
+    const int64_t n = task / s.out_h / plan.num_out_blocks;
+    Conv2DNCHWcTileArgs tile_args = args;
+    tile_args.bias = bias != nullptr ? bias + ob * kConv2DOutBlock : nullptr;
+    const float* in = padded + n * plan.num_in_blocks * args.in_block_stride +
+                      oh * params.stride_h * args.in_row_stride;
+    float* dst = out + task * s.out_w * kConv2DOutBlock;
+    for (int64_t ow = 0; ow < s.out_w; ow += kernels->ow_tile) {
+      kernels->nchwc_tile(tile_args, in + ow * params.stride_w * plan.in_block,
+                          weight + ob * weight_block, dst + ow * kConv2DOutBlock,
+                          static_cast<int>(std::min<int64_t>(kernels->ow_tile, s.out_w - ow)));
+    }
+  });
+}
+
+void Conv2DDirect(const Conv2DShape& s, const Conv2DParams& params, const DirectPlan& plan,
+                  const float* data, const float* weight, const float* bias, float* out,
+                  bool parallel) {
+  const int64_t out_channels = plan.num_out_blocks * kConv2DOutBlock;
+  // one image at a time, the blocked copies of a batch would not stay in cache.
+  Conv2DShape image = s;
+  image.batch = 1;
+  KernelWorkspace padded(s.in_channels * plan.padded_h * plan.padded_w * sizeof(float));
+  KernelWorkspace blocked_weight(out_channels * s.in_channels * s.kernel_h * s.kernel_w *
+                                 sizeof(float));
+  KernelWorkspace blocked_bias(bias != nullptr ? out_channels * sizeof(float) : 0);
+  KernelWorkspace blocked_out(out_channels * s.out_h * s.out_w * sizeof(float));
+  BlockWeights(s, plan, weight, blocked_weight.As<float>());
+  if (bias != nullptr) {
+    std::fill(blocked_bias.As<float>(), blocked_bias.As<float>() + out_channels, 0.0f);
+    std::copy(bias, bias + s.out_channels, blocked_bias.As<float>());
+  }
+  const int64_t plane = s.out_h * s.out_w;
+  for (int64_t n = 0; n < s.batch; ++n) {
+    PadInput(image, params, plan, data + n * s.in_channels * s.in_h * s.in_w, false,
+             padded.As<float>(), parallel);
+    RunDirect(image, params, plan, padded.As<float>(), blocked_weight.As<float>(),
+              blocked_bias.As<float>(), blocked_out.As<float>(), parallel);
+    // back to NCHW.
+    RunTasks(s.out_channels, parallel, [&](int64_t o) {
+      const float* src = blocked_out.As<float>() + o / kConv2DOutBlock * plane * kConv2DOutBlock +
+                         o % kConv2DOutBlock;
+      float* dst = out + (n * s.out_channels + o) * plane;
+      for (int64_t i = 0; i < plane; ++i) dst[i] = src[i * kConv2DOutBlock];
+    });
+  }
+}
+
+/*! \brief U = G g G^T of every 3x3 kernel, (16, O, C). */
+void WinogradWeights(const Conv2DShape& s, const float* weight, float* u) {
+  const int64_t count = s.out_channels * s.in_channels;
+  for (int64_t oc = 0; oc < count; ++oc) {
+    const float* g = weight + oc * 9;
+    float t[4][3];
+    for (int j = 0; j < 3; ++j) {
+      t[0][j] = g[j];
+      t[1][j] = 0.5f * (g[j] + g[3 + j] + g[6 + j]);
+      t[2][j] = 0.5f * (g[j] - g[3 + j] + g[6 + j]);
+      t[3][j] = g[6 + j];
+    }
+    for (int i = 0; i < 4; ++i) {
+      u[(i * 4 + 0) * count + oc] = t[i][0];
+      u[(i * 4 + 1) * count + oc] = 0.5f * (t[i][0] + t[i][1] + t[i][2]);
+      u[(i * 4 + 2) * count + oc] = 0.5f * (t[i][0] - t[i][1] + t[i][2]);
+      u[(i * 4 + 3) * count + oc] = t[i][2];
+    }
+  }
+}
+
+void Conv2DWinograd(const Conv2DShape& s, const Conv2DParams& params, const float* data,
+                    const float* weight, const float* bias, float* out, bool parallel) {
+  const int64_t C = s.in_channels, O = s.out_channels;
+  const int64_t tiles_h = CeilDiv(s.out_h, 2), tiles_w = CeilDiv(s.out_w, 2);
+  // rows of tiles over all images, a chunk is a range of them.
+  const int64_t num_rows = s.batch * tiles_h;
+  // the transformed tiles of a chunk and their products stay within the L2.
+  const int64_t chunk_tiles = std::max<int64_t>(
+      128, GetCacheSizes().l2 / (16 * (C + O) * static_cast<int64_t>(sizeof(float))));
+  const int64_t chunk_rows = std::min(num_rows, std::max<int64_t>(1, chunk_tiles / tiles_w));
+  const int64_t max_count = chunk_rows * tiles_w;
+
+  KernelWorkspace u_space(16 * O * C * sizeof(float));
+  KernelWorkspace v_space(16 * C * max_count * sizeof(float));
+  KernelWorkspace m_space(16 * O * max_count * sizeof(float));
+  float* u = u_space.As<float>();
+  float* v = v_space.As<float>();
+  float* m = m_space.As<float>();
+  WinogradWeights(s, weight, u);
+
+  // the 4 input rows of a row of tiles, zero padded, as wide as the tiles cover.
+  const int64_t line_w = tiles_w * 2 + 2;
+  for (int64_t row0 = 0; row0 < num_rows; row0 += chunk_rows) {
+    const int64_t rows = std::min(chunk_rows, num_rows - row0);
+    const int64_t count = rows * tiles_w;
+    const int64_t stride = C * count;
+    // V = B^T d B for every 4x4 input tile, (16, C, count).
+    RunTasks(C * rows, parallel, [&](int64_t task) {
+      const int64_t c = task / rows, row = task % rows;
+      const int64_t n = (row0 + row) / tiles_h;
+      const int64_t h0 = (row0 + row) % tiles_h * 2 - params.pad_top;
+      const float* src = data + (n * C + c) * s.in_h * s.in_w;
+      std::vector<float> lines(4 * line_w);
+      // b = B^T d, the column transform of the 4 rows for every column.
+      for (int i = 0; i < 4; ++i) {
+        float* line = lines.data() + i * line_w;
+        std::fill(line, line + line_w, 0.0f);
+        const int64_t ih = h0 + i;
+        if (ih < 0 || ih >= s.in_h) continue;
+        const int64_t begin = std::max<int64_t>(0, params.pad_left);
+        const int64_t end = std::min(line_w, s.in_w + params.pad_left);
+        std::copy(src + ih * s.in_w + begin - params.pad_left,
+                  src + ih * s.in_w + end - params.pad_left, line + begin);
+      }
+      std::vector<float> cols(4 * line_w);
+      const float* d0 = lines.data();
+      const float* d1 = d0 + line_w;
+      const float* d2 = d1 + line_w;
+      const float* d3 = d2 + line_w;
+      for (int64_t j = 0; j < line_w; ++j) {
+        cols[j] = d0[j] - d2[j];
+        cols[line_w + j] = d1[j] + d2[j];
+        cols[2 * line_w + j] = d2[j] - d1[j];
+        cols[3 * line_w + j] = d1[j] - d3[j];
+      }
+      float* dst = v + c * count + row * tiles_w;
+      for (int i = 0; i < 4; ++i) {
+        const float* b = cols.data() + i * line_w;
+        float* v0 = dst + (i * 4) * stride;
+        float* v1 = v0 + stride;
+        float* v2 = v1 + stride;
+        float* v3 = v2 + stride;
+        for (int64_t t = 0; t < tiles_w; ++t) {
+          const float* e = b + t * 2;
+          v0[t] = e[0] - e[2];
+          v1[t] = e[1] + e[2];
+          v2[t] = e[2] - e[1];
+          v3[t] = e[1] - e[3];
+        }
+      }
+    });
+    // M = U V for each of the 16 elements of the transform.
+    for (int64_t e = 0; e < 16; ++e) {
+      Sgemm(false, false, O, count, C, 1.0f, u + e * O * C, C, v + e * stride, count, 0.0f,
+            m + e * O * count, count);
+    }
+    // Y = A^T M A, the 2x2 outputs of every tile.
+    const int64_t out_stride = O * count;
+    RunTasks(O * rows, parallel, [&](int64_t task) {
+      const int64_t o = task / rows, row = task % rows;
+      const int64_t n = (row0 + row) / tiles_h;
+      const int64_t h0 = (row0 + row) % tiles_h * 2;
+      const float b = bias != nullptr ? bias[o] : 0.0f;
+      const float* src = m + o * count + row * tiles_w;
+      float* dst = out + ((n * O + o) * s.out_h + h0) * s.out_w;
+      const bool second_row = h0 + 1 < s.out_h;
+      for (int64_t t = 0; t < tiles_w; ++t) {
+        float a[2][4];
+        for (int j = 0; j < 4; ++j) {
+          float m0 = src[j * out_stride + t], m1 = src[(4 + j) * out_stride + t];
+          float m2 = src[(8 + j) * out_stride + t], m3 = src[(12 + j) * out_stride + t];
+          a[0][j] = m0 + m1 + m2;
+          a[1][j] = m1 - m2 - m3;
+        }
+        for (int i = 0; i < (second_row ? 2 : 1); ++i) {
+          float* y = dst + i * s.out_w + t * 2;
+          y[0] = a[i][0] + a[i][1] + a[i][2] + b;
+          if (t * 2 + 1 < s.out_w) y[1] = a[i][1] - a[i][2] - a[i][3] + b;
+        }
+      }
+    });
+  }
+}
+
+void CheckParams(const Conv2DParams& params) {
+  if (params.stride_h < 1 || params.stride_w < 1 || params.dilation_h < 1 ||
+      params.dilation_w < 1 || params.groups < 1) {
+    throw Error("conv2d: strides, dilations and groups must be positive");
+  }
+  if (params.pad_top < 0 || params.pad_left < 0 || params.pad_bottom < 0 ||
+      params.pad_right < 0) {
+    throw Error("conv2d: padding must not be negative");
+  }
+}
+
+void CheckFloat32(const NDArray& arr, const char* name) {
+  if (arr->dtype.code != kDLFloat || arr->dtype.bits != 32 || arr->dtype.lanes != 1) {
+    throw Error(std::string("conv2d: ") + name + " must be float32");
+  }
+}
+
+/*! \brief Fill the output extents. */
+void OutputExtents(Conv2DShape* s, const Conv2DParams& params) {
+  s->out_h = (s->in_h + params.pad_top + params.pad_bottom -
+              params.dilation_h * (s->kernel_h - 1) - 1) / params.stride_h + 1;
+  s->out_w = (s->in_w + params.pad_left + params.pad_right -
+              params.dilation_w * (s->kernel_w - 1) - 1) / params.stride_w + 1;
+  if (s->out_h <= 0 || s->out_w <= 0) throw Error("conv2d: the kernel exceeds the padded input");
+}
+
+/*! \brief Fill the output extents and check them against out. */
+void InferOutput(Conv2DShape* s, const Conv2DParams& params, const std::vector<int64_t>& expect,
+                 const NDArray& out) {
+  OutputExtents(s, params);
+  std::vector<int64_t> shape = expect;
+  for (int64_t& e : shape) {
+    if (e == -1) e = s->out_h;
+    if (e == -2) e = s->out_w;
+  }
+  if (out.Shape() != shape) {
+    throw Error("conv2d: out has shape " + ShapeToString(out.Shape()) + ", expect " +
+                ShapeToString(shape));
+  }
+}
+
+const float* BiasData(const NDArray& bias, int64_t channels) {
+  if (!bias.defined()) return nullptr;
+  CheckOperand(bias, "conv2d", "bias");
+  CheckFloat32(bias, "bias");
+  if (bias.Shape() != std::vector<int64_t>{channels}) {
+    throw Error("conv2d: bias has shape " + ShapeToString(bias.Shape()) + ", expect " +
+                ShapeToString({channels}));
+  }
+  return static_cast<const float*>(bias->data);
+}
+
+/*! \brief What the selection of a convolution depends on. */
+struct Conv2DWorkload {
+  Conv2DShape shape;
+  Conv2DParams params;
+};
+
+/*! \brief The algorithm of a convolution and the loops of the direct one. */
+struct Conv2DPlan {
+  Conv2DAlgorithm algorithm;
+  DirectPlan direct;
+};
+
+using Conv2DStrategy = OpStrategy<Conv2DWorkload, Conv2DPlan>;
+
+/*! \param in_block The input channel block of the direct loops, 0 for the default. */
+Conv2DPlan MakeConv2DPlan(Conv2DAlgorithm algorithm, const Conv2DShape& s,
+                          const Conv2DParams& params, int64_t in_block = 0) {
+  Conv2DPlan plan{algorithm, {}};
+  if (algorithm == Conv2DAlgorithm::kDirect) {
+    plan.direct = MakeDirectPlan(s, params, in_block != 0 ? in_block : InputBlock(s.in_channels));
+  }
+  return plan;
+}
+
+std::string WorkloadName(const Conv2DShape& s, const Conv2DParams& p) {
+  std::string name = SIMDLevelName(GetSIMDLevel());
+  for (int64_t v : {s.batch, s.in_channels, s.in_h, s.in_w, s.out_channels, s.kernel_h,
+                    s.kernel_w, p.stride_h, p.stride_w, p.pad_top, p.pad_left, p.pad_bottom,
+                    p.pad_right, p.dilation_h, p.dilation_w, p.groups}) {
+    name += (name.find('/') == std::string::npos ? "/" : ",") + std::to_string(v);
+  }
+  return name;
+}
+
+/*!
+ * \brief The plan of a tuning config, the knobs of Conv2DTuningTask. False when the config
+ *  does not apply to the convolution.
+ */
+bool TunedPlan(const Conv2DShape& s, const Conv2DParams& params, const TuningConfig& config,
+               Conv2DPlan* plan) {
+  auto algorithm = config.find("algorithm");
+  auto in_block = config.find("in_block");
+  if (algorithm == config.end() || in_block == config.end()) return false;
+  if (algorithm->second < static_cast<int>(Conv2DAlgorithm::kIm2col) ||
+      algorithm->second > static_cast<int>(Conv2DAlgorithm::kWinograd)) {
+    return false;
+  }
+  Conv2DAlgorithm algo = static_cast<Conv2DAlgorithm>(algorithm->second);
+  if (!Conv2DSupports(algo, s, params)) return false;
+  // the block only shapes the direct loops, one value stands for the other algorithms.
+  const int64_t block = in_block->second;
+  if (algo == Conv2DAlgorithm::kDirect ? block <= 0 || s.in_channels % block != 0
+                                       : block != InputBlock(s.in_channels)) {
+    return false;
+  }
+  *plan = MakeConv2DPlan(algo, s, params, block);
+  return true;
+}
+
+bool LookupTuned(const Conv2DWorkload& w, Conv2DPlan* plan) {
+  TuningConfig config;
+  return DispatchContext::Global()->Lookup("conv2d", WorkloadName(w.shape, w.params), &config) &&
+         TunedPlan(w.shape, w.params, config, plan);
+}
+
+/*! \brief The implementation of an algorithm, with its priority and condition. */
+Conv2DStrategy::Implementation Conv2DImplementation(
+    Conv2DAlgorithm algorithm, int priority, std::function<bool(const Conv2DWorkload&)> cond) {
+  return {Conv2DAlgorithmName(algorithm), priority, std::move(cond),
+          [algorithm](const Conv2DWorkload& w) {
+            return MakeConv2DPlan(algorithm, w.shape, w.params);
+          }};
+}
+
+Conv2DStrategy* GetConv2DStrategy() {
+  static Conv2DStrategy* strategy = []() {
+    std::vector<Conv2DStrategy::Implementation> impls = {
+        // a config tuned for the shape, see Conv2DTuningTask.
+        {"tuned", 4,
+         [](const Conv2DWorkload& w) {
+           Conv2DPlan plan;
+           return LookupTuned(w, &plan);
+         },
+         [](const Conv2DWorkload& w) {
+           Conv2DPlan plan;
+           LookupTuned(w, &plan);
+           return plan;
+         }},
+        // the transforms pay off with enough channels, the GEMMs want enough tiles.
+        Conv2DImplementation(Conv2DAlgorithm::kWinograd, 3,
+                             [](const Conv2DWorkload& w) {
+                               const Conv2DShape& s = w.shape;
+                               const int64_t tiles =
+                                   s.batch * CeilDiv(s.out_h, 2) * CeilDiv(s.out_w, 2);
+                               return Conv2DSupports(Conv2DAlgorithm::kWinograd, s, w.params) &&
+                                      s.in_channels >= 16 && s.out_channels >= 16 &&
+                                      tiles >= 256;
+                             }),
+        // the direct kernel wins where im2col unrolls few channels into a tall matrix.
+        Conv2DImplementation(Conv2DAlgorithm::kDirect, 2,
+                             [](const Conv2DWorkload& w) {
+                               const Conv2DShape& s = w.shape;
+                               return Conv2DSupports(Conv2DAlgorithm::kDirect, s, w.params) &&
+                                      s.in_channels < 16 && s.kernel_h * s.kernel_w > 1;
+                             }),
+        Conv2DImplementation(Conv2DAlgorithm::kIm2col, 1, nullptr)};
+    Conv2DStrategy* strategy = new Conv2DStrategy("conv2d", std::move(impls));
+    DispatchContext::Global()->OnChange([strategy]() { strategy->Clear(); });
+    return strategy;
+  }();
+  return strategy;
+}
+
+/*! \brief The extents and the attributes, the dtype and the layout are fixed. */
+DispatchKey Conv2DKey(const Conv2DShape& s, const Conv2DParams& params) {
+  DispatchKey key;
+  for (int64_t word : {s.batch, s.in_channels, s.in_h, s.in_w, s.out_channels, s.kernel_h,
+                       s.kernel_w, params.stride_h, params.stride_w, params.pad_top,
+                       params.pad_left, params.pad_bottom, params.pad_right, params.dilation_h,
+                       params.dilation_w, params.groups}) {
+    key.Add(word);
+  }
+  return key;
+}
+
+void RunConv2D(const Conv2DShape& s, const Conv2DParams& params, const Conv2DPlan& plan,
+               const float* data, const float* weight, const float* bias, float* out) {
+  const bool parallel =
+      MultiplyAdds(s, params) >= kConv2DParallelMinFlops && threading::NumThreads() > 1;
+  switch (plan.algorithm) {
+    case Conv2DAlgorithm::kDirect:
+      return Conv2DDirect(s, params, plan.direct, data, weight, bias, out, parallel);
+    case Conv2DAlgorithm::kWinograd:
+      return Conv2DWinograd(s, params, data, weight, bias, out, parallel);
+    default:
+      return Conv2DIm2col(s, params, data, weight, bias, out, parallel);
+  }
+}
+
+}  // namespace
+
+bool Conv2DSupports(Conv2DAlgorithm algorithm, const Conv2DShape& shape,
+                    const Conv2DParams& params) {
+  switch (algorithm) {
+    case Conv2DAlgorithm::kDirect:
+      return params.groups == 1;
+    case Conv2DAlgorithm::kWinograd:
+      return params.groups == 1 && shape.kernel_h == 3 && shape.kernel_w == 3 &&
+             params.stride_h == 1 && params.stride_w == 1 && params.dilation_h == 1 &&
+             params.dilation_w == 1;
+    default:
+      return true;
+  }
+}
+
+Conv2DAlgorithm SelectConv2DAlgorithm(const Conv2DShape& shape, const Conv2DParams& params) {
+  return GetConv2DStrategy()->Select(Conv2DWorkload{shape, params}).plan.algorithm;
+}
+
+std::string Conv2DWorkloadName(const Conv2DShape& shape, const Conv2DParams& params) {
+  return WorkloadName(shape, params);
+}
+
+TuningTask Conv2DTuningTask(Conv2DShape shape, const Conv2DParams& params) {
+  CheckParams(params);
+  if (shape.batch <= 0 || shape.in_channels % params.groups != 0 ||
+      shape.out_channels % params.groups != 0) {
+    throw Error("Conv2DTuningTask: the channels do not split in " +
+                std::to_string(params.groups) + " groups");
+  }
+  OutputExtents(&shape, params);
+  TuningTask task;
+  task.op = "conv2d";
+  task.workload = WorkloadName(shape, params);
+  task.flops = 2.0 * MultiplyAdds(shape, params);
+  std::vector<int64_t> algorithms;
+  for (Conv2DAlgorithm algorithm :
+       {Conv2DAlgorithm::kIm2col, Conv2DAlgorithm::kDirect, Conv2DAlgorithm::kWinograd}) {
+    if (Conv2DSupports(algorithm, shape, params)) {
+      algorithms.push_back(static_cast<int64_t>(algorithm));
+    }
+  }
+  task.space.Define("algorithm", algorithms);
+  std::vector<int64_t> blocks;
+  for (int64_t block = 1; block <= 16; ++block) {
+    if (shape.in_channels % block == 0) blocks.push_back(block);
+  }
+  task.space.Define("in_block", blocks);
+
+  const Conv2DShape& s = shape;
+  const int64_t data_size = s.batch * s.in_channels * s.in_h * s.in_w;
+  const int64_t weight_size = s.out_channels * s.in_channels / params.groups * s.kernel_h *
+                              s.kernel_w;
+  auto buffers = std::make_shared<std::vector<float>>(
+      data_size + weight_size + s.batch * s.out_channels * s.out_h * s.out_w);
+  for (size_t i = 0; i < buffers->size(); ++i) (*buffers)[i] = static_cast<float>(i % 13) - 6;
+  task.instantiate = [=](const TuningConfig& config) -> std::function<void()> {
+    Conv2DPlan plan;
+    if (!TunedPlan(s, params, config, &plan)) return nullptr;
+    return [=]() {
+      float* data = buffers->data();
+      RunConv2D(s, params, plan, data, data + data_size, nullptr, data + data_size + weight_size);
+    };
+  };
+  return task;
+}
+
+const char* Conv2DAlgorithmName(Conv2DAlgorithm algorithm) {
+  static const char* names[] = {"auto", "im2col", "direct", "winograd"};
+  return names[static_cast<int>(algorithm)];
+}
+
+void Conv2D(const NDArray& data, const NDArray& weight, const NDArray& bias, const NDArray& out,
+            const Conv2DParams& params, Conv2DAlgorithm algorithm) {
+  CheckOperand(data, "conv2d", "data");
+  CheckOperand(weight, "conv2d", "weight");
+  CheckOperand(out, "conv2d", "out");
+  CheckFloat32(data, "data");
+  CheckFloat32(weight, "weight");
+  CheckFloat32(out, "out");
+  CheckParams(params);
+  if (data->ndim != 4 || weight->ndim != 4) throw Error("conv2d: expect NCHW data, OIHW weight");
+  Conv2DShape s;
+  s.batch = data->shape[0];
+  s.in_channels = data->shape[1];
+  s.in_h = data->shape[2];
+  s.in_w = data->shape[3];
+  s.out_channels = weight->shape[0];
+  s.kernel_h = weight->shape[2];
+  s.kernel_w = weight->shape[3];
+  if (s.in_channels % params.groups != 0 || s.out_channels % params.groups != 0 ||
+      weight->shape[1] * params.groups != s.in_channels) {
+    throw Error("conv2d: data " + ShapeToString(data.Shape()) + " and weight " +
+                ShapeToString(weight.Shape()) + " mismatch for " +
+                std::to_string(params.groups) + " groups");
+  }
+  InferOutput(&s, params, {s.batch, s.out_channels, -1, -2}, out);
+  const float* pbias = BiasData(bias, s.out_channels);
+  Conv2DPlan plan;
+  if (algorithm == Conv2DAlgorithm::kAuto) {
+    plan = GetConv2DStrategy()->Dispatch(Conv2DKey(s, params), Conv2DWorkload{s, params}).plan;
+  } else if (Conv2DSupports(algorithm, s, params)) {
+    plan = MakeConv2DPlan(algorithm, s, params);
+  } else {
+    throw Error(std::string("conv2d: ") + Conv2DAlgorithmName(algorithm) +
+                " does not handle this convolution");
+  }
+  if (s.batch == 0) return;
+  RunConv2D(s, params, plan, static_cast<const float*>(data->data),
+            static_cast<const float*>(weight->data), pbias, static_cast<float*>(out->data));
+}
+
+void Conv2DNCHWc(const NDArray& data, const NDArray& weight, const NDArray& bias,
+                 const NDArray& out, const Conv2DParams& params) {
+  CheckOperand(data, "conv2d", "data");
+  CheckOperand(weight, "conv2d", "weight");
+  CheckOperand(out, "conv2d", "out");
+  CheckFloat32(data, "data");
+  CheckFloat32(weight, "weight");
+  CheckFloat32(out, "out");
+  CheckParams(params);
+  if (params.groups != 1) throw Error("conv2d: the NCHWc convolution has no groups");
+  if (data->ndim != 5 || weight->ndim != 6 || weight->shape[5] != kConv2DOutBlock ||
+      weight->shape[1] != data->shape[1] || weight->shape[4] != data->shape[4]) {
+    throw Error("conv2d: expect (N, C/c, H, W, c) data and (O/16, C/c, KH, KW, c, 16) weight, "
+                "got " + ShapeToString(data.Shape()) + " and " + ShapeToString(weight.Shape()));
+  }
+  Conv2DShape s;
+  s.batch = data->shape[0];
+  s.in_channels = data->shape[1] * data->shape[4];
+  s.in_h = data->shape[2];
+  s.in_w = data->shape[3];
+  s.out_channels = weight->shape[0] * kConv2DOutBlock;
+  s.kernel_h = weight->shape[2];
+  s.kernel_w = weight->shape[3];
+  InferOutput(&s, params, {s.batch, weight->shape[0], -1, -2, kConv2DOutBlock}, out);
+  const float* pbias = BiasData(bias, s.out_channels);
+  if (s.batch == 0) return;
+  const bool parallel =
+      MultiplyAdds(s, params) >= kConv2DParallelMinFlops && threading::NumThreads() > 1;
+
+  DirectPlan plan = MakeDirectPlan(s, params, data->shape[4]);
+  const float* padded = static_cast<const float*>(data->data);
+  const bool has_padding = params.pad_top != 0 || params.pad_left != 0 ||
+                           params.pad_bottom != 0 || params.pad_right != 0;
+  KernelWorkspace workspace(has_padding ? s.batch * s.in_channels * plan.padded_h *
+                                              plan.padded_w * sizeof(float)
+                                        : 0);
+  if (has_padding) {
+    PadInput(s, params, plan, padded, true, workspace.As<float>(), parallel);
+    padded = workspace.As<float>();
+  }
+  RunDirect(s, params, plan, padded, static_cast<const float*>(weight->data), pbias,
+            static_cast<float*>(out->data), parallel);
+}
+
+namespace {
+
+/*! \brief Read strides or dilations of 1 or 2 values. */
+void ParsePair(const ShapeTuple& values, const char* name, int64_t* h, int64_t* w) {
+  if (values.size() != 1 && values.size() != 2) {
+    throw Error(std::string("conv2d: ") + name + " takes 1 or 2 values");
+  }
+  *h = values[0];
+  *w = values[values.size() - 1];
+}
+
+/*! \brief Read padding of 1, 2 (h, w) or 4 (top, left, bottom, right) values. */
+Conv2DParams MakeParams(const ShapeTuple& strides, const ShapeTuple& padding,
+                        const ShapeTuple& dilation, int groups) {
+  Conv2DParams params;
+  ParsePair(strides, "strides", &params.stride_h, &params.stride_w);
+  ParsePair(dilation, "dilation", &params.dilation_h, &params.dilation_w);
+  if (padding.size() == 4) {
+    params.pad_top = padding[0];
+    params.pad_left = padding[1];
+    params.pad_bottom = padding[2];
+    params.pad_right = padding[3];
+  } else {
+    ParsePair(padding, "padding", &params.pad_top, &params.pad_left);
+    params.pad_bottom = params.pad_top;
+    params.pad_right = params.pad_left;
+  }
+  params.groups = groups;
+  return params;
+}
+
+Conv2DAlgorithm ParseAlgorithm(const std::string& name) {
+  for (int i = 0; i <= static_cast<int>(Conv2DAlgorithm::kWinograd); ++i) {
+    if (name == Conv2DAlgorithmName(static_cast<Conv2DAlgorithm>(i))) {
+      return static_cast<Conv2DAlgorithm>(i);
+    }
+  }
+  throw Error("conv2d: unknown algorithm " + name);
+}
+
+}  // namespace
+
+CVM_REGISTER_GLOBAL("kernel.conv2d")
+    .set_body_typed([](NDArray data, NDArray weight, NDArray bias, NDArray out,
+                       ShapeTuple strides, ShapeTuple padding, ShapeTuple dilation, int groups,
+                       String algorithm) {
+      Conv2D(data, weight, bias, out, MakeParams(strides, padding, dilation, groups),
+             ParseAlgorithm(algorithm));
+    });
+
+CVM_REGISTER_GLOBAL("kernel.conv2d_nchwc")
+    .set_body_typed([](NDArray data, NDArray weight, NDArray bias, NDArray out,
+                       ShapeTuple strides, ShapeTuple padding, ShapeTuple dilation) {
+      Conv2DNCHWc(data, weight, bias, out, MakeParams(strides, padding, dilation, 1));
+    });
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,117 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+/*!
+ * \file kernels/conv2d.h
+ * \brief 2-D convolution of float32 NCHW and NCHW[x]c tensors.
+ *
+ *  Three algorithms share the operator:
+ *   - im2col: the receptive fields are unrolled into a matrix and multiplied
+ *     with the weights by Sgemm, 1x1 stride 1 convolutions skip the unroll.
+ *     Handles every convolution, groups included.
+ *   - direct: a register blocked convolution over NCHW[x]c, the input in
+ *     channel blocks and the output in blocks of kConv2DOutBlock channels.
+ *   - winograd: F(2x2, 3x3), for 3x3 stride 1 convolutions. Tiles of 4x4
+ *     inputs are transformed, multiplied per transform element by 16 GEMMs
+ *     and transformed back into 2x2 outputs, 2.25x fewer multiplications.
+ *
+ *  kAuto picks one by priorities and conditions on the shape, see op_strategy.h, unless
+ *  a config is tuned for the shape, see Conv2DTuningTask. The selection and the blocking
+ *  of the direct loops are memoized per shape.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_CONV2D_H_
+#define CVM_SRC_RUNTIME_KERNELS_CONV2D_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <string>
+
+#include "../auto_tuner.h"
+#include "conv2d_kernels.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The attributes of a convolution. */
+struct Conv2DParams {
+  int64_t stride_h{1};
+  int64_t stride_w{1};
+  int64_t pad_top{0};
+  int64_t pad_left{0};
+  int64_t pad_bottom{0};
+  int64_t pad_right{0};
+  int64_t dilation_h{1};
+  int64_t dilation_w{1};
+  int64_t groups{1};
+};
+
+enum class Conv2DAlgorithm : int {
+  kAuto = 0,
+  kIm2col = 1,
+  kDirect = 2,
+  kWinograd = 3,
+};
+
+/*! \brief The shape of a convolution, NCHW data and OIHW weights. */
+struct Conv2DShape {
+  int64_t batch;
+  int64_t in_channels;
+  int64_t in_h;
+  int64_t in_w;
+  int64_t out_channels;
+  int64_t kernel_h;
+  int64_t kernel_w;
+  int64_t out_h;
+  int64_t out_w;
+};
+
+/*! \return Whether an algorithm handles a convolution. im2col handles all of them. */
+bool Conv2DSupports(Conv2DAlgorithm algorithm, const Conv2DShape& shape,
+                    const Conv2DParams& params);
+
+/*! \return The algorithm kAuto runs for a convolution, selected without the cache. */
+Conv2DAlgorithm SelectConv2DAlgorithm(const Conv2DShape& shape, const Conv2DParams& params);
+
+/*! \return The workload of a convolution in the tuning logs, with the SIMD level. */
+std::string Conv2DWorkloadName(const Conv2DShape& shape, const Conv2DParams& params);
+
+/*!
+ * \brief The tuning task of a convolution, its out_h and out_w are inferred. The knobs are
+ *  the algorithm and in_block, the input channel block of the direct loops.
+ */
+TuningTask Conv2DTuningTask(Conv2DShape shape, const Conv2DParams& params);
+
+/*! \return "auto", "im2col", "direct" or "winograd". */
+const char* Conv2DAlgorithmName(Conv2DAlgorithm algorithm);
+
+/*!
+ * \brief out = conv2d(data, weight) + bias.
+ * \param data The input, (N, C, H, W).
+ * \param weight The weights, (O, C / groups, KH, KW).
+ * \param bias The bias, (O), or undefined.
+ * \param out The output, (N, O, OH, OW).
+ * \param params The attributes.
+ * \param algorithm The algorithm, throws an Error when it does not handle the convolution.
+ */
+void Conv2D(const NDArray& data, const NDArray& weight, const NDArray& bias, const NDArray& out,
+            const Conv2DParams& params, Conv2DAlgorithm algorithm = Conv2DAlgorithm::kAuto);
+
+/*!
+ * \brief The direct convolution over blocked layouts, for graphs that keep activations
+ *  in NCHW[x]c between convolutions.
+ * \param data The input, (N, C / c, H, W, c).
+ * \param weight The weights, (O / 16, C / c, KH, KW, c, 16).
+ * \param bias The bias, (O / 16 * 16), or undefined.
+ * \param out The output, (N, O / 16, OH, OW, 16).
+ * \param params The attributes, groups must be 1.
+ */
+void Conv2DNCHWc(const NDArray& data, const NDArray& weight, const NDArray& bias,
+                 const NDArray& out, const Conv2DParams& params);
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_CONV2D_H_
@@ -0,0 +1,27 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+// Built with the avx2 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE avx2
+#include "conv2d_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const Conv2DKernels* GetConv2DKernelsAVX2() {
+  // 6 outputs x 2 vectors of accumulators.
+  static const Conv2DKernels kernels = avx2::MakeConv2DKernels<6>();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
@@ -0,0 +1,27 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+// Built with the avx512 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE avx512
+#include "conv2d_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const Conv2DKernels* GetConv2DKernelsAVX512() {
+  // 12 outputs x 1 vector of accumulators.
+  static const Conv2DKernels kernels = avx512::MakeConv2DKernels<12>();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
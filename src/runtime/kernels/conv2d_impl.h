@@ -0,0 +1,97 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+/*!
+ * \file kernels/conv2d_impl.h
+ * \brief The direct NCHW[x]c convolution template, instantiated once per instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_CONV2D_IMPL_H_
+#define CVM_SRC_RUNTIME_KERNELS_CONV2D_IMPL_H_
+
+#include <utility>
+
+#include "conv2d_kernels.h"
+#include "simd_vec.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+/*!
+ * \brief OW outputs of 16 channels in OW * 16 / lanes registers.
+ *  Every input value is broadcast once and multiplied with the weight
+ *  vectors of its input channel, the weights are loaded once for all the
+ *  outputs of the tile.
+ */
+template <int OW>
+void Conv2DNCHWcTile(const Conv2DNCHWcTileArgs& args, const float* in, const float* weight,
+                     float* out, int /*ow*/) {
+  using V = VecF32;
+  constexpr int L = V::kLanes;
+  constexpr int NV = kConv2DOutBlock / L;
+  V acc[OW][NV];
+#pragma GCC unroll 16
+  for (int t = 0; t < OW; ++t) {
+#pragma GCC unroll 16
+    for (int v = 0; v < NV; ++v) {
+      acc[t][v] = args.bias != nullptr ? V::Load(args.bias + v * L) : V::Set1(0.0f);
+    }
+  }
+  const int64_t cb = args.in_block;
+  const int64_t in_step = args.stride_w * cb;
+  for (int64_t icb = 0; icb < args.num_in_blocks; ++icb) {
+    for (int64_t r = 0; r < args.kernel_h; ++r) {
+      for (int64_t s = 0; s < args.kernel_w; ++s) {
+        const float* ip = in + icb * args.in_block_stride +
+                          r * args.dilation_h * args.in_row_stride + s * args.dilation_w * cb;
+        const float* wp = weight + ((icb * args.kernel_h + r) * args.kernel_w + s) * cb *
+                                       kConv2DOutBlock;
+        for (int64_t ci = 0; ci < cb; ++ci) {
+          V wv[NV];
+#pragma GCC unroll 16
+          for (int v = 0; v < NV; ++v) wv[v] = V::Load(wp + ci * kConv2DOutBlock + v * L);
+#pragma GCC unroll 16
+          for (int t = 0; t < OW; ++t) {
+            V x = V::Set1(ip[t * in_step + ci]);
+#pragma GCC unroll 16
+            for (int v = 0; v < NV; ++v) acc[t][v] = V::FMA(x, wv[v], acc[t][v]);
+          }
+        }
+      }
+    }
+  }
+#pragma GCC unroll 16
+  for (int t = 0; t < OW; ++t) {
+#pragma GCC unroll 16
+    for (int v = 0; v < NV; ++v) acc[t][v].Store(out + t * kConv2DOutBlock + v * L);
+  }
+}
+
+template <int... T>
+FConv2DNCHWcTile Conv2DNCHWcTileOfWidth(int ow, std::integer_sequence<int, T...>) {
+  static const FConv2DNCHWcTile tiles[] = {Conv2DNCHWcTile<T + 1>...};
+  return tiles[ow - 1];
+}
+
+/*! \brief The tile kernel, narrower tiles at the end of a row run their own instantiation. */
+template <int OW>
+void Conv2DNCHWcTileKernel(const Conv2DNCHWcTileArgs& args, const float* in,
+                           const float* weight, float* out, int ow) {
+  if (ow == OW) return Conv2DNCHWcTile<OW>(args, in, weight, out, ow);
+  Conv2DNCHWcTileOfWidth(ow, std::make_integer_sequence<int, OW - 1>())(args, in, weight, out,
+                                                                         ow);
+}
+
+template <int OW>
+Conv2DKernels MakeConv2DKernels() {
+  return Conv2DKernels{OW, Conv2DNCHWcTileKernel<OW>};
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_CONV2D_IMPL_H_
@@ -0,0 +1,72 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+/*!
+ * \file kernels/conv2d_kernels.h
+ * \brief The direct NCHW[x]c convolution micro-kernels, one per instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_CONV2D_KERNELS_H_
+#define CVM_SRC_RUNTIME_KERNELS_CONV2D_KERNELS_H_
+
+#include <cstdint>
+
+#include "simd.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The output channel block of the blocked layouts, NCHW16c. */
+constexpr int kConv2DOutBlock = 16;
+
+/*! \brief The geometry shared by the tiles of a direct NCHW[x]c convolution. */
+struct Conv2DNCHWcTileArgs {
+  /*! \brief input channel blocks and the channels of a block */
+  int64_t num_in_blocks;
+  int64_t in_block;
+  int64_t kernel_h;
+  int64_t kernel_w;
+  int64_t stride_w;
+  int64_t dilation_h;
+  int64_t dilation_w;
+  /*! \brief strides of the padded input, in floats */
+  int64_t in_block_stride;
+  int64_t in_row_stride;
+  /*! \brief kConv2DOutBlock values added to the outputs, or null */
+  const float* bias;
+};
+
+/*!
+ * \brief One tile of an output row, ow outputs of kConv2DOutBlock channels.
+ * \param args The geometry.
+ * \param in The padded input at the first input block, row and column of the tile.
+ * \param weight The weights of the output block, [in blocks][kh][kw][in_block][16].
+ * \param out The output, ow x 16 contiguous floats.
+ * \param ow The outputs of the tile, at most the ow_tile of the kernels.
+ */
+typedef void (*FConv2DNCHWcTile)(const Conv2DNCHWcTileArgs& args, const float* in,
+                                 const float* weight, float* out, int ow);
+
+/*! \brief The direct convolution kernel of one instruction set. */
+struct Conv2DKernels {
+  /*! \brief the widest tile, outputs held in registers */
+  int ow_tile;
+  FConv2DNCHWcTile nchwc_tile;
+};
+
+/*! \return The kernels of a level, the best compiled level not above it. */
+const Conv2DKernels* GetConv2DKernels(SIMDLevel level);
+
+const Conv2DKernels* GetConv2DKernelsScalar();
+#if CVM_KERNELS_X86
+const Conv2DKernels* GetConv2DKernelsSSE42();
+const Conv2DKernels* GetConv2DKernelsAVX2();
+const Conv2DKernels* GetConv2DKernelsAVX512();
+#endif
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_CONV2D_KERNELS_H_
@@ -0,0 +1,20 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+// Built with the default flags of the target, the fallback of every other level.
+#define CVM_SIMD_NAMESPACE scalar
+#include "conv2d_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const Conv2DKernels* GetConv2DKernelsScalar() {
+  static const Conv2DKernels kernels = scalar::MakeConv2DKernels<4>();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
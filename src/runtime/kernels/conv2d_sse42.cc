@@ -0,0 +1,27 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+// Built with the sse42 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE sse42
+#include "conv2d_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const Conv2DKernels* GetConv2DKernelsSSE42() {
+  // 3 outputs x 4 vectors of accumulators.
+  static const Conv2DKernels kernels = sse42::MakeConv2DKernels<3>();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
@@ -0,0 +1,500 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+#include "elementwise.h"
+
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include "../../support/parallel_for.h"
+#include "kernel_utils.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const ElementwiseKernels* GetElementwiseKernels(SIMDLevel level) {
+#if CVM_KERNELS_X86
+  switch (level) {
+    case SIMDLevel::kAVX512:
+      return GetElementwiseKernelsAVX512();
+    case SIMDLevel::kAVX2:
+      return GetElementwiseKernelsAVX2();
+    case SIMDLevel::kSSE42:
+      return GetElementwiseKernelsSSE42();
+    default:
+      break;
+  }
+#endif
+  return GetElementwiseKernelsScalar();
+}
+
+const HalfKernels* GetHalfKernels(SIMDLevel level) {
+#if CVM_KERNELS_X86
+  switch (level) {
+    case SIMDLevel::kAVX512:
+      return HasAVX512BF16() ? GetHalfKernelsAVX512BF16() : GetHalfKernelsAVX512();
+    case SIMDLevel::kAVX2:
+      return GetHalfKernelsAVX2();
+    case SIMDLevel::kSSE42:
+      return GetHalfKernelsSSE42();
+    default:
+      break;
+  }
+#endif
+  return GetHalfKernelsScalar();
+}
+
+HalfConverter GetHalfConverter(DLDataType dtype) {
+  HalfConverter conv;
+  if (dtype.bits != 16 || dtype.lanes != 1) return conv;
+  const HalfKernels* kernels = GetHalfKernels(GetSIMDLevel());
+  if (dtype.code == kDLFloat) {
+    conv.to_float = kernels->float16_to_float;
+    conv.from_float = kernels->float_to_float16;
+  } else if (dtype.code == kDLBfloat) {
+    conv.to_float = kernels->bfloat16_to_float;
+    conv.from_float = kernels->float_to_bfloat16;
+  }
+  return conv;
+}
+
+namespace {
+
+/*!
+ * \brief The iteration space of a broadcast binary operator.
+ *  Dims of extent 1 are dropped and dims contiguous in both operands merged,
+ *  so the innermost stride of an operand is 1, or 0 when it is broadcast.
+ */
+struct BroadcastPlan {
+  std::vector<int64_t> shape;
+  std::vector<int64_t> a_strides;
+  std::vector<int64_t> b_strides;
+  int64_t num_elems{1};
+};
+
+std::vector<int64_t> BroadcastStrides(const std::vector<int64_t>& shape,
+                                      const std::vector<int64_t>& out_shape) {
+  std::vector<int64_t> strides(out_shape.size(), 0);
+  int64_t stride = 1;
+  size_t offset = out_shape.size() - shape.size();
+  for (size_t i = shape.size(); i != 0; --i) {
+    if (shape[i - 1] != 1) strides[offset + i - 1] = stride;
+    stride *= shape[i - 1];
+  }
+  return strides;
+}
+
+BroadcastPlan MakeBroadcastPlan(const std::vector<int64_t>& a, const std::vector<int64_t>& b,
+                                const std::vector<int64_t>& out_shape) {
+  std::vector<int64_t> a_strides = BroadcastStrides(a, out_shape);
+  std::vector<int64_t> b_strides = BroadcastStrides(b, out_shape);
+  BroadcastPlan plan;
+  for (size_t i = 0; i < out_shape.size(); ++i) {
+    plan.num_elems *= out_shape[i];
+    if (out_shape[i] == 1) continue;
+    if (!plan.shape.empty() && a_strides[i] * out_shape[i] == plan.a_strides.back() &&
+        b_strides[i] * out_shape[i] == plan.b_strides.back()) {
+      plan.shape.back() *= out_shape[i];
+      plan.a_strides.back() = a_strides[i];
+      plan.b_strides.back() = b_strides[i];
+      continue;
+    }
+    plan.shape.push_back(out_shape[i]);
+    plan.a_strides.push_back(a_strides[i]);
+    plan.b_strides.push_back(b_strides[i]);
+  }
+  if (plan.shape.empty()) {
+    plan.shape = {1};
+    plan.a_strides = {1};
+    plan.b_strides = {1};
+  }
+  return plan;
+}
+
+/*!
+ * \brief Call f(a_offset, b_offset, out_offset, n) for the rows covering the output elements
+ *  [begin, end), offsets in elements.
+ */
+template <typename F>
+void ForEachRow(const BroadcastPlan& plan, int64_t begin, int64_t end, const F& f) {
+  int ndim = static_cast<int>(plan.shape.size());
+  int64_t inner = plan.shape[ndim - 1];
+  int64_t row = begin / inner;
+  int64_t col = begin % inner;
+  while (begin < end) {
+    int64_t a_offset = col * plan.a_strides[ndim - 1];
+    int64_t b_offset = col * plan.b_strides[ndim - 1];
+    int64_t rest = row;
+    for (int i = ndim - 2; i >= 0; --i) {
+      int64_t index = rest % plan.shape[i];
+      rest /= plan.shape[i];
+      a_offset += index * plan.a_strides[i];
+      b_offset += index * plan.b_strides[i];
+    }
+    int64_t n = std::min(inner - col, end - begin);
+    f(a_offset, b_offset, begin, n);
+    begin += n;
+    ++row;
+    col = 0;
+  }
+}
+
+/*! \brief Run f(begin, end) over [0, num_elems), on the thread pool for large outputs. */
+template <typename F>
+void ParallelElems(int64_t num_elems, const F& f) {
+  int num_threads = threading::NumThreads();
+  if (num_elems < kParallelElementwiseMinElems || num_threads == 1) {
+    f(0, num_elems);
+    return;
+  }
+  // a few chunks per thread, work stealing evens out the rest.
+  int64_t grain = std::max<int64_t>(kParallelElementwiseMinElems / 4,
+                                    (num_elems + 4 * num_threads - 1) / (4 * num_threads));
+  support::parallel_for(0, num_elems, grain, f);
+}
+
+/*! \brief Call f with a value of the C++ type of dtype. */
+template <typename F>
+void DispatchDType(DLDataType dtype, const char* op, const F& f) {
+  if (dtype.lanes == 1) {
+    switch (dtype.code) {
+      case kDLFloat:
+        if (dtype.bits == 32) return f(float());
+        if (dtype.bits == 64) return f(double());
+        break;
+      case kDLInt:
+        if (dtype.bits == 8) return f(int8_t());
+        if (dtype.bits == 16) return f(int16_t());
+        if (dtype.bits == 32) return f(int32_t());
+        if (dtype.bits == 64) return f(int64_t());
+        break;
+      case kDLUInt:
+        if (dtype.bits == 8) return f(uint8_t());
+        if (dtype.bits == 16) return f(uint16_t());
+        if (dtype.bits == 32) return f(uint32_t());
+        if (dtype.bits == 64) return f(uint64_t());
+        break;
+      default:
+        break;
+    }
+  }
+  std::ostringstream os;
+  os << op << ": unsupported data type " << dtype;
+  throw Error(os.str());
+}
+
+template <typename T>
+T ApplyBinary(BinaryOpKind op, T a, T b) {
+  switch (op) {
+    case kAdd:
+      return a + b;
+    case kSub:
+      return a - b;
+    case kMul:
+      return a * b;
+    case kDiv:
+      return a / b;
+    default:
+      return a > b ? a : b;
+  }
+}
+
+template <typename T>
+void GenericBinaryRow(BinaryOpKind op, const T* a, int64_t a_step, const T* b, int64_t b_step,
+                      T* out, int64_t n) {
+  if (std::is_integral<T>::value && op == kDiv) {
+    for (int64_t i = 0; i < n; ++i) {
+      if (b[i * b_step] == 0) throw Error("divide: integer division by zero");
+    }
+  }
+  switch (op) {
+    case kAdd:
+      for (int64_t i = 0; i < n; ++i) out[i] = a[i * a_step] + b[i * b_step];
+      break;
+    case kSub:
+      for (int64_t i = 0; i < n; ++i) out[i] = a[i * a_step] - b[i * b_step];
+      break;
+    case kMul:
+      for (int64_t i = 0; i < n; ++i) out[i] = a[i * a_step] * b[i * b_step];
+      break;
+    default:
+      for (int64_t i = 0; i < n; ++i) out[i] = ApplyBinary(op, a[i * a_step], b[i * b_step]);
+      break;
+  }
+}
+
+template <typename T>
+T ApplyUnary(UnaryOpKind op, T x) {
+  switch (op) {
+    case kRelu:
+      return x > T(0) ? x : T(0);
+    case kSigmoid:
+      return T(1) / (T(1) + std::exp(-x));
+    case kTanh:
+      return std::tanh(x);
+    case kGelu:
+      return x / T(2) * (T(1) + std::erf(x / std::sqrt(T(2))));
+    default:
+      return std::exp(x);
+  }
+}
+
+/*! \brief Elements of float16 and bfloat16 converted at once, the buffers live on the stack. */
+constexpr int64_t kHalfBlock = 256;
+
+/*! \brief A binary operator over 16-bit floats, the float32 kernel over converted blocks. */
+void HalfBinary(FBinaryRow frow, const HalfConverter& conv, const BroadcastPlan& plan,
+                const uint16_t* pa, const uint16_t* pb, uint16_t* pout) {
+  const int64_t a_step = plan.a_strides.back();
+  const int64_t b_step = plan.b_strides.back();
+  ParallelElems(plan.num_elems, [&](int64_t begin, int64_t end) {
+    ForEachRow(plan, begin, end, [&](int64_t a_offset, int64_t b_offset, int64_t offset,
+                                     int64_t n) {
+      float a[kHalfBlock], b[kHalfBlock], out[kHalfBlock];
+      for (int64_t i = 0; i < n; i += kHalfBlock) {
+        int64_t len = std::min(kHalfBlock, n - i);
+        // a broadcast operand is a single element.
+        conv.to_float(pa + a_offset + i * a_step, a, a_step == 0 ? 1 : len);
+        conv.to_float(pb + b_offset + i * b_step, b, b_step == 0 ? 1 : len);
+        frow(a, a_step, b, b_step, out, len);
+        conv.from_float(out, pout + offset + i, len);
+      }
+    });
+  });
+}
+
+/*! \brief Cast from or to 16-bit floats, through float32. */
+void HalfCast(const NDArray& x, const NDArray& out, int64_t num_elems) {
+  HalfConverter from = GetHalfConverter(x->dtype);
+  HalfConverter to = GetHalfConverter(out->dtype);
+  if (from.to_float != nullptr && to.from_float != nullptr) {
+    const uint16_t* px = static_cast<const uint16_t*>(x->data);
+    uint16_t* pout = static_cast<uint16_t*>(out->data);
+    ParallelElems(num_elems, [&](int64_t begin, int64_t end) {
+      float buf[kHalfBlock];
+      for (int64_t i = begin; i < end; i += kHalfBlock) {
+        int64_t len = std::min(kHalfBlock, end - i);
+        from.to_float(px + i, buf, len);
+        to.from_float(buf, pout + i, len);
+      }
+    });
+  } else if (from.to_float != nullptr) {
+    const uint16_t* px = static_cast<const uint16_t*>(x->data);
+    DispatchDType(out->dtype, "cast", [&](auto to_type) {
+      using To = decltype(to_type);
+      To* pout = static_cast<To*>(out->data);
+      ParallelElems(num_elems, [&](int64_t begin, int64_t end) {
+        if (std::is_same<To, float>::value) {
+          return from.to_float(px + begin, reinterpret_cast<float*>(pout + begin), end - begin);
+        }
+        float buf[kHalfBlock];
+        for (int64_t i = begin; i < end; i += kHalfBlock) {
+          int64_t len = std::min(kHalfBlock, end - i);
+          from.to_float(px + i, buf, len);
+          for (int64_t j = 0; j < len; ++j) pout[i + j] = static_cast<To>(buf[j]);
+        }
+      });
+    });
+  } else {
+    uint16_t* pout = static_cast<uint16_t*>(out->data);
+    DispatchDType(x->dtype, "cast", [&](auto from_type) {
+      using From = decltype(from_type);
+      const From* px = static_cast<const From*>(x->data);
+      ParallelElems(num_elems, [&](int64_t begin, int64_t end) {
+        if (std::is_same<From, float>::value) {
+          return to.from_float(reinterpret_cast<const float*>(px + begin), pout + begin,
+                               end - begin);
+        }
+        float buf[kHalfBlock];
+        for (int64_t i = begin; i < end; i += kHalfBlock) {
+          int64_t len = std::min(kHalfBlock, end - i);
+          for (int64_t j = 0; j < len; ++j) buf[j] = static_cast<float>(px[i + j]);
+          to.from_float(buf, pout + i, len);
+        }
+      });
+    });
+  }
+}
+
+const char* BinaryOpName(BinaryOpKind op) {
+  static const char* names[] = {"add", "subtract", "multiply", "divide", "maximum"};
+  return names[op];
+}
+
+const char* UnaryOpName(UnaryOpKind op) {
+  static const char* names[] = {"relu", "sigmoid", "tanh", "exp", "gelu"};
+  return names[op];
+}
+
+}  // namespace
+
+std::vector<int64_t> BroadcastShape(const std::vector<int64_t>& a, const std::vector<int64_t>& b) {
+  size_t ndim = std::max(a.size(), b.size());
+  std::vector<int64_t> shape(ndim);
+  for (size_t i = 0; i < ndim; ++i) {
+    int64_t ea = i < ndim - a.size() ? 1 : a[i - (ndim - a.size())];
+    int64_t eb = i < ndim - b.size() ? 1 : b[i - (ndim - b.size())];
+    if (ea != eb && ea != 1 && eb != 1) {
+      throw Error("Cannot broadcast shapes " + ShapeToString(a) + " and " + ShapeToString(b));
+    }
+    shape[i] = ea == 1 ? eb : ea;
+  }
+  return shape;
+}
+
+void BinaryElementwise(BinaryOpKind op, const NDArray& a, const NDArray& b, const NDArray& out) {
+  const char* name = BinaryOpName(op);
+  CheckOperand(a, name, "a");
+  CheckOperand(b, name, "b");
+  CheckOperand(out, name, "out");
+  CheckSameDType(a, b, name);
+  CheckSameDType(a, out, name);
+  std::vector<int64_t> out_shape = BroadcastShape(a.Shape(), b.Shape());
+  if (out.Shape() != out_shape) {
+    throw Error(std::string(name) + ": out has shape " + ShapeToString(out.Shape()) +
+                ", expect " + ShapeToString(out_shape));
+  }
+  BroadcastPlan plan = MakeBroadcastPlan(a.Shape(), b.Shape(), out_shape);
+  if (plan.num_elems == 0) return;
+  HalfConverter conv = GetHalfConverter(a->dtype);
+  if (conv.to_float != nullptr) {
+    return HalfBinary(GetElementwiseKernels(GetSIMDLevel())->binary[op], conv, plan,
+                      static_cast<const uint16_t*>(a->data), static_cast<const uint16_t*>(b->data),
+                      static_cast<uint16_t*>(out->data));
+  }
+
+  DispatchDType(a->dtype, name, [&](auto type) {
+    using T = decltype(type);
+    const T* pa = static_cast<const T*>(a->data);
+    const T* pb = static_cast<const T*>(b->data);
+    T* pout = static_cast<T*>(out->data);
+    int64_t a_step = plan.a_strides.back();
+    int64_t b_step = plan.b_strides.back();
+    FBinaryRow frow = GetElementwiseKernels(GetSIMDLevel())->binary[op];
+    ParallelElems(plan.num_elems, [&](int64_t begin, int64_t end) {
+      ForEachRow(plan, begin, end, [&](int64_t a_offset, int64_t b_offset, int64_t offset,
+                                       int64_t n) {
+        if (std::is_same<T, float>::value) {
+          frow(reinterpret_cast<const float*>(pa + a_offset), a_step,
+               reinterpret_cast<const float*>(pb + b_offset), b_step,
+               reinterpret_cast<float*>(pout + offset), n);
+        } else {
+          GenericBinaryRow(op, pa + a_offset, a_step, pb + b_offset, b_step, pout + offset, n);
+        }
+      });
+    });
+  });
+}
+
+void UnaryElementwise(UnaryOpKind op, const NDArray& x, const NDArray& out) {
+  const char* name = UnaryOpName(op);
+  CheckOperand(x, name, "x");
+  CheckOperand(out, name, "out");
+  CheckSameDType(x, out, name);
+  if (x.Shape() != out.Shape()) {
+    throw Error(std::string(name) + ": out has shape " + ShapeToString(out.Shape()) +
+                ", expect " + ShapeToString(x.Shape()));
+  }
+  if (op != kRelu && x->dtype.code != kDLFloat && x->dtype.code != kDLBfloat) {
+    throw Error(std::string(name) + ": expect a floating point input");
+  }
+  int64_t num_elems = NumElements(x.Shape());
+  HalfConverter conv = GetHalfConverter(x->dtype);
+  if (conv.to_float != nullptr) {
+    const uint16_t* px = static_cast<const uint16_t*>(x->data);
+    uint16_t* pout = static_cast<uint16_t*>(out->data);
+    FUnaryRow frow = GetElementwiseKernels(GetSIMDLevel())->unary[op];
+    return ParallelElems(num_elems, [&](int64_t begin, int64_t end) {
+      float buf[kHalfBlock];
+      for (int64_t i = begin; i < end; i += kHalfBlock) {
+        int64_t len = std::min(kHalfBlock, end - i);
+        conv.to_float(px + i, buf, len);
+        frow(buf, buf, len);
+        conv.from_float(buf, pout + i, len);
+      }
+    });
+  }
+
+  DispatchDType(x->dtype, name, [&](auto type) {
+    using T = decltype(type);
+    const T* px = static_cast<const T*>(x->data);
+    T* pout = static_cast<T*>(out->data);
+    FUnaryRow frow = GetElementwiseKernels(GetSIMDLevel())->unary[op];
+    ParallelElems(num_elems, [&](int64_t begin, int64_t end) {
+      if (std::is_same<T, float>::value) {
+        frow(reinterpret_cast<const float*>(px + begin), reinterpret_cast<float*>(pout + begin),
+             end - begin);
+      } else {
+        for (int64_t i = begin; i < end; ++i) pout[i] = ApplyUnary(op, px[i]);
+      }
+    });
+  });
+}
+
+void Cast(const NDArray& x, const NDArray& out) {
+  CheckOperand(x, "cast", "x");
+  CheckOperand(out, "cast", "out");
+  if (x.Shape() != out.Shape()) {
+    throw Error("cast: out has shape " + ShapeToString(out.Shape()) + ", expect " +
+                ShapeToString(x.Shape()));
+  }
+  int64_t num_elems = NumElements(x.Shape());
+  if (GetHalfConverter(x->dtype).to_float != nullptr ||
+      GetHalfConverter(out->dtype).to_float != nullptr) {
+    return HalfCast(x, out, num_elems);
+  }
+  const ElementwiseKernels* kernels = GetElementwiseKernels(GetSIMDLevel());
+
+  DispatchDType(x->dtype, "cast", [&](auto from_type) {
+    using From = decltype(from_type);
+    DispatchDType(out->dtype, "cast", [&](auto to_type) {
+      using To = decltype(to_type);
+      const From* px = static_cast<const From*>(x->data);
+      To* pout = static_cast<To*>(out->data);
+      ParallelElems(num_elems, [&](int64_t begin, int64_t end) {
+        if (std::is_same<From, float>::value && std::is_same<To, int32_t>::value) {
+          kernels->float_to_int32(reinterpret_cast<const float*>(px + begin),
+                                  reinterpret_cast<int32_t*>(pout + begin), end - begin);
+        } else if (std::is_same<From, int32_t>::value && std::is_same<To, float>::value) {
+          kernels->int32_to_float(reinterpret_cast<const int32_t*>(px + begin),
+                                  reinterpret_cast<float*>(pout + begin), end - begin);
+        } else {
+          for (int64_t i = begin; i < end; ++i) pout[i] = static_cast<To>(px[i]);
+        }
+      });
+    });
+  });
+}
+
+#define CVM_REGISTER_BINARY_KERNEL(Name, Op)                                        \
+  CVM_REGISTER_GLOBAL("kernel." Name)                                               \
+      .set_body_typed([](NDArray a, NDArray b, NDArray out) { BinaryElementwise(Op, a, b, out); })
+
+#define CVM_REGISTER_UNARY_KERNEL(Name, Op) \
+  CVM_REGISTER_GLOBAL("kernel." Name)       \
+      .set_body_typed([](NDArray x, NDArray out) { UnaryElementwise(Op, x, out); })
+
+CVM_REGISTER_BINARY_KERNEL("add", kAdd);
+CVM_REGISTER_BINARY_KERNEL("subtract", kSub);
+CVM_REGISTER_BINARY_KERNEL("multiply", kMul);
+CVM_REGISTER_BINARY_KERNEL("divide", kDiv);
+CVM_REGISTER_BINARY_KERNEL("maximum", kMax);
+CVM_REGISTER_UNARY_KERNEL("relu", kRelu);
+CVM_REGISTER_UNARY_KERNEL("sigmoid", kSigmoid);
+CVM_REGISTER_UNARY_KERNEL("tanh", kTanh);
+CVM_REGISTER_UNARY_KERNEL("exp", kExp);
+CVM_REGISTER_UNARY_KERNEL("gelu", kGelu);
+
+CVM_REGISTER_GLOBAL("kernel.cast").set_body_typed([](NDArray x, NDArray out) { Cast(x, out); });
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,65 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+/*!
+ * \file kernels/elementwise.h
+ * \brief Elementwise operators over NDArrays with NumPy broadcasting.
+ *
+ *  The operators write into a preallocated, contiguous output. float32 runs
+ *  the vectorized kernels of the SIMD level picked at run time, float16 and
+ *  bfloat16 run the same kernels over blocks converted to float32 and back,
+ *  the other data types run plain loops. Outputs of at least
+ *  kParallelElementwiseMinElems elements are split over the thread pool.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_H_
+#define CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <vector>
+
+#include "elementwise_kernels.h"
+#include "half_kernels.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The smallest output split over the thread pool, in elements. */
+constexpr int64_t kParallelElementwiseMinElems = 1 << 15;
+
+/*!
+ * \brief The shape two shapes broadcast to, NumPy rules.
+ *  Throws an Error when the shapes are incompatible.
+ */
+std::vector<int64_t> BroadcastShape(const std::vector<int64_t>& a, const std::vector<int64_t>& b);
+
+/*!
+ * \brief out = op(a, b) elementwise.
+ * \param op The operator.
+ * \param a The left operand.
+ * \param b The right operand, same data type as a.
+ * \param out The result, same data type, shape BroadcastShape(a, b), may be a or b when
+ *  that operand already has the output shape.
+ */
+void BinaryElementwise(BinaryOpKind op, const NDArray& a, const NDArray& b, const NDArray& out);
+
+/*!
+ * \brief out = op(x) elementwise, out has the data type and shape of x and may be x.
+ *  Relu takes any supported data type, the other operators floating point ones.
+ */
+void UnaryElementwise(UnaryOpKind op, const NDArray& x, const NDArray& out);
+
+/*!
+ * \brief Convert x to the data type of out, elementwise, with C++ conversion rules.
+ *  Float to integer conversions truncate toward zero. float16 and bfloat16 convert
+ *  through float32, rounding to nearest even.
+ */
+void Cast(const NDArray& x, const NDArray& out);
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_H_
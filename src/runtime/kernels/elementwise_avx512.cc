@@ -0,0 +1,26 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+// Built with the avx512 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE avx512
+#include "elementwise_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const ElementwiseKernels* GetElementwiseKernelsAVX512() {
+  static const ElementwiseKernels kernels = avx512::MakeElementwiseKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
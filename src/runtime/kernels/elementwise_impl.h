@@ -0,0 +1,145 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+/*!
+ * \file kernels/elementwise_impl.h
+ * \brief The templates behind ElementwiseKernels, instantiated once per instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_IMPL_H_
+#define CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_IMPL_H_
+
+#include "elementwise_kernels.h"
+#include "simd_math.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+struct AddOp {
+  template <typename V>
+  static V Apply(V a, V b) { return a + b; }
+};
+struct SubOp {
+  template <typename V>
+  static V Apply(V a, V b) { return a - b; }
+};
+struct MulOp {
+  template <typename V>
+  static V Apply(V a, V b) { return a * b; }
+};
+struct DivOp {
+  template <typename V>
+  static V Apply(V a, V b) { return a / b; }
+};
+struct MaxOp {
+  template <typename V>
+  static V Apply(V a, V b) { return V::Max(a, b); }
+};
+
+struct ReluOp {
+  template <typename V>
+  static V Apply(V x) { return V::Max(x, V::Set1(0.0f)); }
+};
+struct SigmoidOp {
+  template <typename V>
+  static V Apply(V x) { return Sigmoid(x); }
+};
+struct TanhOp {
+  template <typename V>
+  static V Apply(V x) { return Tanh(x); }
+};
+struct ExpOp {
+  template <typename V>
+  static V Apply(V x) { return Exp(x); }
+};
+struct GeluOp {
+  template <typename V>
+  static V Apply(V x) { return Gelu(x); }
+};
+
+template <typename Op>
+void BinaryRow(const float* a, int64_t a_step, const float* b, int64_t b_step, float* out,
+               int64_t n) {
+  using V = VecF32;
+  using S = ScalarF32;
+  constexpr int L = V::kLanes;
+  int64_t i = 0;
+  if (a_step != 0 && b_step != 0) {
+    for (; i + 2 * L <= n; i += 2 * L) {
+      V r0 = Op::Apply(V::Load(a + i), V::Load(b + i));
+      V r1 = Op::Apply(V::Load(a + i + L), V::Load(b + i + L));
+      r0.Store(out + i);
+      r1.Store(out + i + L);
+    }
+    for (; i + L <= n; i += L) Op::Apply(V::Load(a + i), V::Load(b + i)).Store(out + i);
+    for (; i < n; ++i) Op::Apply(S::Load(a + i), S::Load(b + i)).Store(out + i);
+  } else if (a_step == 0 && b_step != 0) {
+    V va = V::Set1(*a);
+    for (; i + L <= n; i += L) Op::Apply(va, V::Load(b + i)).Store(out + i);
+    for (; i < n; ++i) Op::Apply(S::Set1(*a), S::Load(b + i)).Store(out + i);
+  } else if (a_step != 0 && b_step == 0) {
+    V vb = V::Set1(*b);
+    for (; i + L <= n; i += L) Op::Apply(V::Load(a + i), vb).Store(out + i);
+    for (; i < n; ++i) Op::Apply(S::Load(a + i), S::Set1(*b)).Store(out + i);
+  } else {
+    float value = Op::Apply(S::Set1(*a), S::Set1(*b)).v;
+    for (; i < n; ++i) out[i] = value;
+  }
+}
+
+template <typename Op>
+void UnaryRow(const float* x, float* out, int64_t n) {
+  using V = VecF32;
+  using S = ScalarF32;
+  constexpr int L = V::kLanes;
+  int64_t i = 0;
+  for (; i + 2 * L <= n; i += 2 * L) {
+    // two independent chains hide the latency of the polynomials.
+    V r0 = Op::Apply(V::Load(x + i));
+    V r1 = Op::Apply(V::Load(x + i + L));
+    r0.Store(out + i);
+    r1.Store(out + i + L);
+  }
+  for (; i + L <= n; i += L) Op::Apply(V::Load(x + i)).Store(out + i);
+  for (; i < n; ++i) Op::Apply(S::Load(x + i)).Store(out + i);
+}
+
+inline void FloatToInt32(const float* x, int32_t* out, int64_t n) {
+  using V = VecF32;
+  int64_t i = 0;
+  for (; i + V::kLanes <= n; i += V::kLanes) V::Load(x + i).StoreI32(out + i);
+  for (; i < n; ++i) ScalarF32::Load(x + i).StoreI32(out + i);
+}
+
+inline void Int32ToFloat(const int32_t* x, float* out, int64_t n) {
+  using V = VecF32;
+  int64_t i = 0;
+  for (; i + V::kLanes <= n; i += V::kLanes) V::LoadI32(x + i).Store(out + i);
+  for (; i < n; ++i) ScalarF32::LoadI32(x + i).Store(out + i);
+}
+
+inline ElementwiseKernels MakeElementwiseKernels() {
+  ElementwiseKernels k;
+  k.binary[kAdd] = BinaryRow<AddOp>;
+  k.binary[kSub] = BinaryRow<SubOp>;
+  k.binary[kMul] = BinaryRow<MulOp>;
+  k.binary[kDiv] = BinaryRow<DivOp>;
+  k.binary[kMax] = BinaryRow<MaxOp>;
+  k.unary[kRelu] = UnaryRow<ReluOp>;
+  k.unary[kSigmoid] = UnaryRow<SigmoidOp>;
+  k.unary[kTanh] = UnaryRow<TanhOp>;
+  k.unary[kExp] = UnaryRow<ExpOp>;
+  k.unary[kGelu] = UnaryRow<GeluOp>;
+  k.float_to_int32 = FloatToInt32;
+  k.int32_to_float = Int32ToFloat;
+  return k;
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_IMPL_H_
@@ -0,0 +1,66 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+/*!
+ * \file kernels/elementwise_kernels.h
+ * \brief The float32 row kernels of the elementwise operators, one table per instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_KERNELS_H_
+#define CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_KERNELS_H_
+
+#include <cstdint>
+
+#include "simd.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The binary elementwise operators. */
+enum BinaryOpKind : int { kAdd = 0, kSub, kMul, kDiv, kMax, kNumBinaryOps };
+
+/*! \brief The unary elementwise operators. */
+enum UnaryOpKind : int {
+  kRelu = 0,
+  kSigmoid,
+  kTanh,
+  kExp,
+  /*! \brief x * Phi(x), the exact GELU with erf */
+  kGelu,
+  kNumUnaryOps
+};
+
+/*!
+ * \brief out[i] = op(a[i * a_step], b[i * b_step]) for i in [0, n).
+ *  A step is 1 for a contiguous row and 0 for a broadcast scalar.
+ */
+typedef void (*FBinaryRow)(const float* a, int64_t a_step, const float* b, int64_t b_step,
+                           float* out, int64_t n);
+
+/*! \brief out[i] = op(x[i]) for i in [0, n), out may be x. */
+typedef void (*FUnaryRow)(const float* x, float* out, int64_t n);
+
+/*! \brief The row kernels built for one instruction set. */
+struct ElementwiseKernels {
+  FBinaryRow binary[kNumBinaryOps];
+  FUnaryRow unary[kNumUnaryOps];
+  void (*float_to_int32)(const float* x, int32_t* out, int64_t n);
+  void (*int32_to_float)(const int32_t* x, float* out, int64_t n);
+};
+
+/*! \return The kernels of a level, the best compiled level not above it. */
+const ElementwiseKernels* GetElementwiseKernels(SIMDLevel level);
+
+const ElementwiseKernels* GetElementwiseKernelsScalar();
+#if CVM_KERNELS_X86
+const ElementwiseKernels* GetElementwiseKernelsSSE42();
+const ElementwiseKernels* GetElementwiseKernelsAVX2();
+const ElementwiseKernels* GetElementwiseKernelsAVX512();
+#endif
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_ELEMENTWISE_KERNELS_H_
@@ -0,0 +1,20 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+// Built with the default flags of the target, the fallback of every other level.
+#define CVM_SIMD_NAMESPACE scalar
+#include "elementwise_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const ElementwiseKernels* GetElementwiseKernelsScalar() {
+  static const ElementwiseKernels kernels = scalar::MakeElementwiseKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
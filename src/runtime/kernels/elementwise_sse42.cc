@@ -0,0 +1,26 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+// Built with the sse42 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE sse42
+#include "elementwise_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const ElementwiseKernels* GetElementwiseKernelsSSE42() {
+  static const ElementwiseKernels kernels = sse42::MakeElementwiseKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
@@ -0,0 +1,616 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+#include "gemm.h"
+
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../auto_tuner.h"
+#include "../op_strategy.h"
+#include "kernel_utils.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const GemmKernels* GetGemmKernels(SIMDLevel level) {
+#if CVM_KERNELS_X86
+  switch (level) {
+    case SIMDLevel::kAVX512:
+      return GetGemmKernelsAVX512();
+    case SIMDLevel::kAVX2:
+      return GetGemmKernelsAVX2();
+    case SIMDLevel::kSSE42:
+      return GetGemmKernelsSSE42();
+    default:
+      break;
+  }
+#endif
+  return GetGemmKernelsScalar();
+}
+
+namespace {
+
+/*! \brief Products of fewer rows skip the packing of B, it would be reused too few times. */
+constexpr int64_t kGemmSkinnyRows = 8;
+/*! \brief Products of fewer multiply-adds run on the calling thread. */
+constexpr int64_t kGemmParallelMinFlops = 1 << 18;
+
+constexpr int kNumSIMDLevels = static_cast<int>(SIMDLevel::kAVX512) + 1;
+
+/*! \return The storage of a data type, throws an Error for the unsupported ones. */
+GemmStorage GetGemmStorage(DLDataType dtype) {
+  if (dtype.lanes == 1 && dtype.code == kDLFloat && dtype.bits == 32) return GemmStorage::kFloat32;
+  if (dtype.lanes == 1 && dtype.code == kDLFloat && dtype.bits == 16) return GemmStorage::kFloat16;
+  if (dtype.lanes == 1 && dtype.code == kDLBfloat && dtype.bits == 16) {
+    return GemmStorage::kBFloat16;
+  }
+  throw Error("matmul: only float32, float16 and bfloat16 are supported");
+}
+
+int64_t RoundDown(int64_t value, int64_t factor) {
+  return std::max(value / factor * factor, factor);
+}
+
+GemmBlocking DefaultBlocking(const GemmKernels* kernels) {
+  const CacheSizes& caches = GetCacheSizes();
+  const int64_t elem = sizeof(float);
+  int64_t kc = std::min<int64_t>(std::max<int64_t>(caches.l1d / 2 / (kernels->nr * elem), 64), 512);
+  int64_t mc = std::min<int64_t>(caches.l2 / 2 / (kc * elem), 1024);
+  int64_t nc = std::min<int64_t>(caches.l3 / 2 / (kc * elem), 4096);
+  return {RoundDown(mc, kernels->mr), RoundDown(kc, 8), RoundDown(nc, kernels->nr)};
+}
+
+struct BlockingTable {
+  std::mutex mutex;
+  /*! \brief the blocking set for each level, zeros for the default */
+  GemmBlocking blocking[kNumSIMDLevels] = {};
+};
+
+BlockingTable* GetBlockingTable() {
+  static BlockingTable table;
+  return &table;
+}
+
+/*! \brief The blocking set for a level, zeros when there is none. */
+GemmBlocking SetBlocking(SIMDLevel level) {
+  BlockingTable* table = GetBlockingTable();
+  std::lock_guard<std::mutex> lock(table->mutex);
+  return table->blocking[static_cast<int>(level)];
+}
+
+/*! \brief Elements of a 16-bit operand widened at once, the buffers live on the stack. */
+constexpr int64_t kGemmWidenChunk = 256;
+
+/*! \brief A row major operand, float32 or 16-bit floats widened through the half kernels. */
+struct GemmOperand {
+  const void* data;
+  int64_t ld;
+  /*! \brief the conversion of 16-bit elements, null for float32 */
+  FHalfToFloat widen;
+
+  bool is_float() const { return widen == nullptr; }
+  const float* f32() const { return static_cast<const float*>(data); }
+
+  /*! \return The operand starting at row i, column j. */
+  GemmOperand At(int64_t i, int64_t j) const {
+    size_t elem = is_float() ? sizeof(float) : sizeof(uint16_t);
+    return {static_cast<const char*>(data) + (i * ld + j) * elem, ld, widen};
+  }
+
+  /*! \brief out = the n elements of row i from column j, as float32. */
+  void Read(int64_t i, int64_t j, int64_t n, float* out) const {
+    if (is_float()) {
+      std::copy(f32() + i * ld + j, f32() + i * ld + j + n, out);
+    } else {
+      widen(static_cast<const uint16_t*>(data) + i * ld + j, out, n);
+    }
+  }
+
+  /*! \brief Call f(offset, values, len) over n elements of row i, in widened chunks. */
+  template <typename F>
+  void ForEachChunk(int64_t i, int64_t n, const F& f) const {
+    float buf[kGemmWidenChunk];
+    for (int64_t p = 0; p < n; p += kGemmWidenChunk) {
+      int64_t len = std::min(kGemmWidenChunk, n - p);
+      Read(i, p, len, buf);
+      f(p, buf, len);
+    }
+  }
+};
+
+GemmOperand MakeOperand(const void* data, GemmStorage storage, int64_t ld) {
+  const HalfKernels* half = GetHalfKernels(GetSIMDLevel());
+  switch (storage) {
+    case GemmStorage::kFloat16:
+      return {data, ld, half->float16_to_float};
+    case GemmStorage::kBFloat16:
+      return {data, ld, half->bfloat16_to_float};
+    default:
+      return {data, ld, nullptr};
+  }
+}
+
+/*!
+ * \brief Pack an mc x kc block of op(A) into micro-panels of mr rows, stored column by
+ *  column. a starts at the first element of the block. The rows past mc of the last
+ *  panel are left unset, the micro-kernel does not read them.
+ */
+void PackA(bool trans, const GemmOperand& a, int64_t mc, int64_t kc, int mr, float* out) {
+  const int64_t lda = a.ld;
+  for (int64_t i0 = 0; i0 < mc; i0 += mr) {
+    int rows = static_cast<int>(std::min<int64_t>(mr, mc - i0));
+    if (!a.is_float()) {
+      if (trans) {
+        for (int64_t p = 0; p < kc; ++p) a.Read(p, i0, rows, out + p * mr);
+      } else {
+        for (int r = 0; r < rows; ++r) {
+          a.At(i0 + r, 0).ForEachChunk(0, kc, [&](int64_t p0, const float* src, int64_t len) {
+            for (int64_t p = 0; p < len; ++p) out[(p0 + p) * mr + r] = src[p];
+          });
+        }
+      }
+    } else if (trans) {
+      for (int64_t p = 0; p < kc; ++p) {
+        const float* src = a.f32() + p * lda + i0;
+        for (int r = 0; r < rows; ++r) out[p * mr + r] = src[r];
+      }
+    } else {
+      for (int r = 0; r < rows; ++r) {
+        const float* src = a.f32() + (i0 + r) * lda;
+        for (int64_t p = 0; p < kc; ++p) out[p * mr + r] = src[p];
+      }
+    }
+    out += kc * mr;
+  }
+}
+
+/*!
+ * \brief Pack a kc x cols panel of op(B), cols at most nr, into kc rows of nr values with
+ *  zeros past cols. b starts at the first element of the panel.
+ */
+void PackBPanel(bool trans, const GemmOperand& b, int64_t kc, int cols, int nr, float* out) {
+  if (trans) {
+    for (int j = 0; j < cols; ++j) {
+      if (b.is_float()) {
+        const float* src = b.f32() + j * b.ld;
+        for (int64_t p = 0; p < kc; ++p) out[p * nr + j] = src[p];
+      } else {
+        b.ForEachChunk(j, kc, [&](int64_t p0, const float* src, int64_t len) {
+          for (int64_t p = 0; p < len; ++p) out[(p0 + p) * nr + j] = src[p];
+        });
+      }
+    }
+    if (cols < nr) {
+      for (int64_t p = 0; p < kc; ++p) std::fill(out + p * nr + cols, out + (p + 1) * nr, 0.0f);
+    }
+  } else {
+    for (int64_t p = 0; p < kc; ++p) {
+      b.Read(p, 0, cols, out + p * nr);
+      std::fill(out + p * nr + cols, out + (p + 1) * nr, 0.0f);
+    }
+  }
+}
+
+/*! \brief C = beta * C, for the products without terms. */
+void ScaleC(int64_t m, int64_t n, float beta, float* c, int64_t ldc) {
+  for (int64_t i = 0; i < m; ++i) {
+    float* row = c + i * ldc;
+    if (beta == 0.0f) {
+      std::fill(row, row + n, 0.0f);
+    } else {
+      for (int64_t j = 0; j < n; ++j) row[j] *= beta;
+    }
+  }
+}
+
+/*! \brief The product of a few rows by a transposed B, dot products over the rows of B. */
+void SkinnyGemmTransB(const GemmKernels* kernels, bool trans_a, int64_t m, int64_t n, int64_t k,
+                      float alpha, const GemmOperand& a_op, const GemmOperand& b_op, float beta,
+                      float* c, int64_t ldc, bool parallel) {
+  // the dot products read the rows of A contiguously, in float32.
+  const bool copy_a = trans_a || !a_op.is_float();
+  KernelWorkspace rows(copy_a ? m * k * sizeof(float) : 0);
+  const float* a = a_op.f32();
+  int64_t lda = a_op.ld;
+  if (copy_a) {
+    float* dst = rows.As<float>();
+    if (trans_a) {
+      float column[kGemmSkinnyRows];
+      for (int64_t p = 0; p < k; ++p) {
+        a_op.Read(p, 0, m, column);
+        for (int64_t i = 0; i < m; ++i) dst[i * k + p] = column[i];
+      }
+    } else {
+      for (int64_t i = 0; i < m; ++i) a_op.Read(i, 0, k, dst + i * k);
+    }
+    a = dst;
+    lda = k;
+  }
+  // groups of 4 rows of B, each one read once from memory for all the rows of A.
+  int64_t num_groups = (n + 3) / 4;
+  int64_t grain = std::max<int64_t>(1, kGemmParallelMinFlops / (4 * m * k));
+  int64_t num_tasks = (num_groups + grain - 1) / grain;
+  RunTasks(num_tasks, parallel, [&](int64_t task) {
+    int64_t end = std::min(num_groups, (task + 1) * grain);
+    for (int64_t g = task * grain; g < end; ++g) {
+      int64_t j = g * 4;
+      int cols = static_cast<int>(std::min<int64_t>(4, n - j));
+      if (b_op.is_float()) {
+        for (int64_t i = 0; i < m; ++i) {
+          kernels->dot_kernel(k, a + i * lda, b_op.f32() + j * b_op.ld, b_op.ld,
+                              c + i * ldc + j, cols, alpha, beta);
+        }
+        continue;
+      }
+      // 16-bit rows are widened a slice of the depth at a time, the slices stay in L1.
+      float widened[4 * kGemmWidenChunk];
+      for (int64_t p = 0; p < k; p += kGemmWidenChunk) {
+        const int64_t len = std::min(kGemmWidenChunk, k - p);
+        for (int r = 0; r < cols; ++r) b_op.Read(j + r, p, len, widened + r * len);
+        for (int64_t i = 0; i < m; ++i) {
+          kernels->dot_kernel(len, a + i * lda + p, widened, len, c + i * ldc + j, cols, alpha,
+                              p == 0 ? beta : 1.0f);
+        }
+      }
+    }
+  });
+}
+
+/*! \brief The product of a few rows by B, the micro-kernels read B in place. */
+void SkinnyGemm(const GemmKernels* kernels, bool trans_a, int64_t m, int64_t n, int64_t k,
+                float alpha, const GemmOperand& a, const GemmOperand& b, float beta, float* c,
+                int64_t ldc, bool parallel) {
+  const int mr = kernels->mr, nr = kernels->nr;
+  int64_t num_row_panels = (m + mr - 1) / mr;
+  KernelWorkspace workspace(num_row_panels * mr * k * sizeof(float));
+  float* packed_a = workspace.As<float>();
+  PackA(trans_a, a, m, k, mr, packed_a);
+
+  int64_t num_panels = (n + nr - 1) / nr;
+  int64_t grain = std::max<int64_t>(1, kGemmParallelMinFlops / (m * k * nr));
+  int64_t num_tasks = (num_panels + grain - 1) / grain;
+  RunTasks(num_tasks, parallel, [&](int64_t task) {
+    int64_t end = std::min(num_panels, (task + 1) * grain);
+    for (int64_t jp = task * grain; jp < end; ++jp) {
+      int64_t j = jp * nr;
+      int cols = static_cast<int>(std::min<int64_t>(nr, n - j));
+      const float* panel = b.f32() + j;
+      int64_t panel_ld = b.ld;
+      // the last panel is narrower than the vectors of the micro-kernel, 16-bit ones are
+      // widened.
+      const bool pack = cols < nr || !b.is_float();
+      KernelWorkspace tail(pack ? k * nr * sizeof(float) : 0);
+      if (pack) {
+        PackBPanel(false, b.At(0, j), k, cols, nr, tail.As<float>());
+        panel = tail.As<float>();
+        panel_ld = nr;
+      }
+      for (int64_t i = 0; i < m; i += mr) {
+        int rows = static_cast<int>(std::min<int64_t>(mr, m - i));
+        kernels->micro_kernel(k, packed_a + i * k, panel, panel_ld, c + i * ldc + j, ldc,
+                              rows, cols, alpha, beta);
+      }
+    }
+  });
+}
+
+void PackedGemm(const GemmKernels* kernels, const GemmBlocking& blocking, bool trans_a,
+                bool trans_b, int64_t m, int64_t n, int64_t k, float alpha, const GemmOperand& a,
+                const GemmOperand& b, float beta, float* c, int64_t ldc, int num_threads) {
+  const int mr = kernels->mr, nr = kernels->nr;
+  const int64_t kc = std::min(blocking.kc, k);
+  const int64_t nc = std::min(blocking.nc, (n + nr - 1) / nr * nr);
+  // at least a block of rows per thread when there are enough rows, columns split the rest.
+  int64_t rows_per_thread = (m + num_threads - 1) / num_threads;
+  const int64_t mc = std::min(blocking.mc, (rows_per_thread + mr - 1) / mr * mr);
+  const int64_t num_row_blocks = (m + mc - 1) / mc;
+  const int64_t col_ways = (num_threads + num_row_blocks - 1) / num_row_blocks;
+  const bool parallel = num_threads > 1;
+
+  KernelWorkspace workspace(kc * nc * sizeof(float));
+  float* packed_b = workspace.As<float>();
+  for (int64_t jc = 0; jc < n; jc += nc) {
+    const int64_t nb = std::min(nc, n - jc);
+    const int64_t num_panels = (nb + nr - 1) / nr;
+    const int64_t panels_per_way = (num_panels + col_ways - 1) / col_ways;
+    for (int64_t pc = 0; pc < k; pc += kc) {
+      const int64_t kb = std::min(kc, k - pc);
+      // the later blocks of the depth accumulate into C.
+      const float beta_block = pc == 0 ? beta : 1.0f;
+      RunTasks(num_panels, parallel, [&](int64_t jp) {
+        int64_t j = jc + jp * nr;
+        PackBPanel(trans_b, trans_b ? b.At(j, pc) : b.At(pc, j), kb,
+                   static_cast<int>(std::min<int64_t>(nr, n - j)), nr, packed_b + jp * kb * nr);
+      });
+      RunTasks(num_row_blocks * col_ways, parallel, [&](int64_t task) {
+        const int64_t ic = task / col_ways * mc;
+        const int64_t mb = std::min(mc, m - ic);
+        const int64_t panel_begin = task % col_ways * panels_per_way;
+        const int64_t panel_end = std::min(num_panels, panel_begin + panels_per_way);
+        if (panel_begin >= panel_end) return;
+        KernelWorkspace block((mb + mr - 1) / mr * mr * kb * sizeof(float));
+        float* packed_a = block.As<float>();
+        PackA(trans_a, trans_a ? a.At(pc, ic) : a.At(ic, pc), mb, kb, mr, packed_a);
+        for (int64_t jp = panel_begin; jp < panel_end; ++jp) {
+          const int64_t j = jc + jp * nr;
+          const int cols = static_cast<int>(std::min<int64_t>(nr, n - j));
+          const float* panel = packed_b + jp * kb * nr;
+          for (int64_t ir = 0; ir < mb; ir += mr) {
+            kernels->micro_kernel(kb, packed_a + ir * kb, panel, nr,
+                                  c + (ic + ir) * ldc + j, ldc,
+                                  static_cast<int>(std::min<int64_t>(mr, mb - ir)), cols, alpha,
+                                  beta_block);
+          }
+        }
+      });
+    }
+  }
+}
+
+/*! \brief What the plan of a packed product depends on. */
+struct GemmWorkload {
+  SIMDLevel level;
+  int64_t m;
+  int64_t n;
+  int64_t k;
+  bool trans_a;
+  bool trans_b;
+};
+
+/*! \brief The blocking of a packed product and the ways it is split. */
+struct GemmPlan {
+  GemmBlocking blocking;
+  int num_threads;
+};
+
+using GemmStrategy = OpStrategy<GemmWorkload, GemmPlan>;
+
+int DefaultThreads(int64_t m, int64_t n, int64_t k) {
+  return m * n * k < kGemmParallelMinFlops ? 1 : threading::NumThreads();
+}
+
+std::string WorkloadName(const GemmWorkload& w) {
+  return std::string(SIMDLevelName(w.level)) + "/" + std::to_string(w.m) + "x" +
+         std::to_string(w.n) + "x" + std::to_string(w.k) + "/" + (w.trans_a ? "t" : "n") +
+         (w.trans_b ? "t" : "n");
+}
+
+/*! \brief The blocking rounded to the tile of the micro-kernel, as SetGemmBlocking does. */
+GemmBlocking RoundBlocking(const GemmKernels* kernels, GemmBlocking blocking) {
+  return {RoundDown(blocking.mc, kernels->mr), std::max<int64_t>(blocking.kc, 1),
+          RoundDown(blocking.nc, kernels->nr)};
+}
+
+/*! \brief The plan of a tuning config, the knobs of GemmTuningTask. */
+GemmPlan TunedPlan(const GemmWorkload& w, const TuningConfig& config) {
+  auto get = [&](const char* knob) {
+    auto it = config.find(knob);
+    return it != config.end() ? it->second : 0;
+  };
+  GemmBlocking blocking = RoundBlocking(GetGemmKernels(w.level),
+                                        {get("mc"), get("kc"), get("nc")});
+  int64_t threads = std::min<int64_t>(std::max<int64_t>(get("threads"), 1),
+                                      threading::NumThreads());
+  return {blocking, static_cast<int>(threads)};
+}
+
+/*! \brief The config tuned for a workload, with positive block sizes. */
+bool LookupTuned(const GemmWorkload& w, TuningConfig* config) {
+  if (!DispatchContext::Global()->Lookup("gemm", WorkloadName(w), config)) return false;
+  for (const char* knob : {"mc", "kc", "nc"}) {
+    auto it = config->find(knob);
+    if (it == config->end() || it->second <= 0) return false;
+  }
+  return true;
+}
+
+/*! \brief The plans of the packed products by shape, read without a lock. */
+GemmStrategy* GetGemmStrategy() {
+  static GemmStrategy* strategy = []() {
+    std::vector<GemmStrategy::Implementation> impls = {
+        // a config tuned for the shape, see GemmTuningTask.
+        {"tuned", 3,
+         [](const GemmWorkload& w) {
+           TuningConfig config;
+           return LookupTuned(w, &config);
+         },
+         [](const GemmWorkload& w) {
+           TuningConfig config;
+           LookupTuned(w, &config);
+           return TunedPlan(w, config);
+         }},
+        {"set", 2, [](const GemmWorkload& w) { return SetBlocking(w.level).kc != 0; },
+         [](const GemmWorkload& w) {
+           return GemmPlan{SetBlocking(w.level), DefaultThreads(w.m, w.n, w.k)};
+         }},
+        {"default", 1, nullptr, [](const GemmWorkload& w) {
+           return GemmPlan{DefaultBlocking(GetGemmKernels(w.level)),
+                           DefaultThreads(w.m, w.n, w.k)};
+         }}};
+    GemmStrategy* strategy = new GemmStrategy("gemm", std::move(impls));
+    DispatchContext::Global()->OnChange([strategy]() { strategy->Clear(); });
+    return strategy;
+  }();
+  return strategy;
+}
+
+GemmPlan GetGemmPlan(const GemmWorkload& w) {
+  DispatchKey key;
+  for (int64_t word : {static_cast<int64_t>(w.level), w.m, w.n, w.k,
+                       static_cast<int64_t>(w.trans_a), static_cast<int64_t>(w.trans_b)}) {
+    key.Add(word);
+  }
+  return GetGemmStrategy()->Dispatch(key, w).plan;
+}
+
+/*!
+ * \return The values of a block size knob: the candidates, the default and the smallest
+ *  value covering the extent, without the larger ones that block the same way.
+ */
+std::vector<int64_t> BlockValues(std::vector<int64_t> values, int64_t default_value,
+                                 int64_t extent) {
+  values.push_back(default_value);
+  std::sort(values.begin(), values.end());
+  values.erase(std::unique(values.begin(), values.end()), values.end());
+  auto cover = std::lower_bound(values.begin(), values.end(), extent);
+  if (cover != values.end()) values.erase(cover + 1, values.end());
+  return values;
+}
+
+}  // namespace
+
+GemmBlocking GetGemmBlocking(SIMDLevel level) {
+  GemmBlocking blocking = SetBlocking(level);
+  return blocking.kc != 0 ? blocking : DefaultBlocking(GetGemmKernels(level));
+}
+
+void SetGemmBlocking(SIMDLevel level, GemmBlocking blocking) {
+  const GemmKernels* kernels = GetGemmKernels(level);
+  if (blocking.mc < 0 || blocking.kc < 0 || blocking.nc < 0) {
+    throw Error("SetGemmBlocking: negative block size");
+  }
+  if (blocking.mc != 0 || blocking.kc != 0 || blocking.nc != 0) {
+    blocking = RoundBlocking(kernels, blocking);
+  }
+  BlockingTable* table = GetBlockingTable();
+  {
+    std::lock_guard<std::mutex> lock(table->mutex);
+    table->blocking[static_cast<int>(level)] = blocking;
+  }
+  // a dispatch still selecting from the old blocking inserts it before the clear.
+  GetGemmStrategy()->Clear();
+}
+
+void Sgemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k, float alpha,
+           const float* a, int64_t lda, const float* b, int64_t ldb, float beta, float* c,
+           int64_t ldc) {
+  MixedGemm(trans_a, trans_b, m, n, k, alpha, a, GemmStorage::kFloat32, lda, b,
+            GemmStorage::kFloat32, ldb, beta, c, ldc);
+}
+
+void MixedGemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k, float alpha,
+               const void* a, GemmStorage a_storage, int64_t lda, const void* b,
+               GemmStorage b_storage, int64_t ldb, float beta, float* c, int64_t ldc) {
+  if (m <= 0 || n <= 0) return;
+  if (k <= 0 || alpha == 0.0f) return ScaleC(m, n, beta, c, ldc);
+  SIMDLevel level = GetSIMDLevel();
+  const GemmKernels* kernels = GetGemmKernels(level);
+  GemmOperand a_op = MakeOperand(a, a_storage, lda);
+  GemmOperand b_op = MakeOperand(b, b_storage, ldb);
+  if (m < kGemmSkinnyRows) {
+    bool parallel = DefaultThreads(m, n, k) > 1;
+    if (trans_b) {
+      return SkinnyGemmTransB(kernels, trans_a, m, n, k, alpha, a_op, b_op, beta, c, ldc,
+                              parallel);
+    }
+    return SkinnyGemm(kernels, trans_a, m, n, k, alpha, a_op, b_op, beta, c, ldc, parallel);
+  }
+  GemmPlan plan = GetGemmPlan({level, m, n, k, trans_a, trans_b});
+  PackedGemm(kernels, plan.blocking, trans_a, trans_b, m, n, k, alpha, a_op, b_op, beta, c, ldc,
+             plan.num_threads);
+}
+
+void Matmul(const NDArray& a, const NDArray& b, const NDArray& out, bool trans_a, bool trans_b) {
+  CheckOperand(a, "matmul", "a");
+  CheckOperand(b, "matmul", "b");
+  CheckOperand(out, "matmul", "out");
+  CheckSameDType(a, b, "matmul");
+  GemmStorage storage = GetGemmStorage(a->dtype);
+  // 16-bit operands may produce a float32 output.
+  if (GetGemmStorage(out->dtype) != GemmStorage::kFloat32) CheckSameDType(a, out, "matmul");
+  if (a->ndim != 2 || b->ndim != 2 || out->ndim != 2) {
+    throw Error("matmul: expect 2-D operands");
+  }
+  int64_t m = trans_a ? a->shape[1] : a->shape[0];
+  int64_t k = trans_a ? a->shape[0] : a->shape[1];
+  int64_t kb = trans_b ? b->shape[1] : b->shape[0];
+  int64_t n = trans_b ? b->shape[0] : b->shape[1];
+  if (k != kb) {
+    throw Error("matmul: depths " + std::to_string(k) + " and " + std::to_string(kb) +
+                " mismatch, a " + ShapeToString(a.Shape()) + ", b " + ShapeToString(b.Shape()));
+  }
+  if (out->shape[0] != m || out->shape[1] != n) {
+    throw Error("matmul: out has shape " + ShapeToString(out.Shape()) + ", expect " +
+                ShapeToString({m, n}));
+  }
+  // a 16-bit output is accumulated in float32 and rounded once.
+  const bool narrow = GetGemmStorage(out->dtype) != GemmStorage::kFloat32;
+  KernelWorkspace workspace(narrow ? m * n * sizeof(float) : 0);
+  float* c = narrow ? workspace.As<float>() : static_cast<float*>(out->data);
+  MixedGemm(trans_a, trans_b, m, n, k, 1.0f, a->data, storage, a->shape[1], b->data, storage,
+            b->shape[1], 0.0f, c, n);
+  if (narrow) {
+    const HalfKernels* half = GetHalfKernels(GetSIMDLevel());
+    FFloatToHalf narrow_row =
+        storage == GemmStorage::kFloat16 ? half->float_to_float16 : half->float_to_bfloat16;
+    narrow_row(c, static_cast<uint16_t*>(out->data), m * n);
+  }
+}
+
+std::string GemmWorkloadName(int64_t m, int64_t n, int64_t k, bool trans_a, bool trans_b) {
+  return WorkloadName({GetSIMDLevel(), m, n, k, trans_a, trans_b});
+}
+
+TuningTask GemmTuningTask(int64_t m, int64_t n, int64_t k, bool trans_a, bool trans_b) {
+  if (m < kGemmSkinnyRows || n <= 0 || k <= 0) {
+    throw Error("GemmTuningTask: the products of fewer than " + std::to_string(kGemmSkinnyRows) +
+                " rows are not blocked");
+  }
+  const SIMDLevel level = GetSIMDLevel();
+  const GemmKernels* kernels = GetGemmKernels(level);
+  const GemmBlocking blocking = GetGemmBlocking(level);
+  TuningTask task;
+  task.op = "gemm";
+  task.workload = GemmWorkloadName(m, n, k, trans_a, trans_b);
+  task.flops = 2.0 * m * n * k;
+  const int64_t mr = kernels->mr, nr = kernels->nr;
+  task.space.Define("mc", BlockValues({2 * mr, 4 * mr, 8 * mr, 16 * mr, 32 * mr, 64 * mr},
+                                      blocking.mc, (m + mr - 1) / mr * mr));
+  task.space.Define("kc", BlockValues({32, 64, 128, 192, 256, 384, 512}, blocking.kc, k));
+  task.space.Define(
+      "nc", BlockValues({4 * nr, 8 * nr, 16 * nr, 32 * nr, 64 * nr, 128 * nr, 256 * nr},
+                        blocking.nc, (n + nr - 1) / nr * nr));
+  std::vector<int64_t> threads;
+  for (int t = 1; t < threading::NumThreads(); t *= 2) threads.push_back(t);
+  threads.push_back(threading::NumThreads());
+  task.space.Define("threads", threads);
+
+  // the operands live as long as the instantiated kernels.
+  auto buffers = std::make_shared<std::vector<float>>(m * k + k * n + m * n);
+  for (size_t i = 0; i < buffers->size(); ++i) (*buffers)[i] = static_cast<float>(i % 17) - 8;
+  task.instantiate = [=](const TuningConfig& config) -> std::function<void()> {
+    GemmPlan plan = TunedPlan({level, m, n, k, trans_a, trans_b}, config);
+    return [=]() {
+      float* a = buffers->data();
+      float* b = a + m * k;
+      float* c = b + k * n;
+      PackedGemm(kernels, plan.blocking, trans_a, trans_b, m, n, k, 1.0f,
+                 {a, trans_a ? m : k, nullptr}, {b, trans_b ? k : n, nullptr}, 0.0f, c, n,
+                 plan.num_threads);
+    };
+  };
+  return task;
+}
+
+CVM_REGISTER_GLOBAL("kernel.matmul")
+    .set_body_typed([](NDArray a, NDArray b, NDArray out, bool transpose_a, bool transpose_b) {
+      Matmul(a, b, out, transpose_a, transpose_b);
+    });
+
+// data (batch, in), weight (out, in), the layout of dense layers.
+CVM_REGISTER_GLOBAL("kernel.dense").set_body_typed([](NDArray data, NDArray weight, NDArray out) {
+  Matmul(data, weight, out, false, true);
+});
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
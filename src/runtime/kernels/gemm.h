@@ -0,0 +1,114 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+/*!
+ * \file kernels/gemm.h
+ * \brief Single precision matrix multiplication.
+ *
+ *  The layout follows GotoBLAS and BLIS: the columns of B are cut in blocks
+ *  of nc sized for the last level cache and the depth in blocks of kc. A
+ *  kc x nc block of B is packed into micro-panels of nr columns, shared by
+ *  all the threads, then every thread packs an mc x kc block of A, sized for
+ *  its L2, into micro-panels of mr rows and runs the register blocked
+ *  micro-kernel of the SIMD level over the tiles of its part of C.
+ *
+ *  Products of a few rows skip the packing of B: they read B in place when it
+ *  is not transposed and run dot products over the rows of B when it is.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_GEMM_H_
+#define CVM_SRC_RUNTIME_KERNELS_GEMM_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <string>
+
+#include "../auto_tuner.h"
+#include "gemm_kernels.h"
+#include "half_kernels.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The storage of a GEMM operand, the products accumulate in float32. */
+enum class GemmStorage : int { kFloat32 = 0, kFloat16, kBFloat16 };
+
+/*! \brief The cache blocking of the packed product, in elements. */
+struct GemmBlocking {
+  /*! \brief rows of the A block, a multiple of mr */
+  int64_t mc;
+  /*! \brief depth of the A and B blocks */
+  int64_t kc;
+  /*! \brief columns of the B block, a multiple of nr */
+  int64_t nc;
+};
+
+/*!
+ * \return The blocking of a level, of the products without a tuned config.
+ *  The default is derived from GetCacheSizes(): a kc x nr micro-panel of B
+ *  fills half of the L1, an mc x kc block of A half of the L2 and a kc x nc
+ *  block of B half of the L3.
+ */
+GemmBlocking GetGemmBlocking(SIMDLevel level);
+
+/*!
+ * \brief Replace the blocking of a level, the values are rounded to the tile of its
+ *  micro-kernel. A blocking of zeros restores the default.
+ */
+void SetGemmBlocking(SIMDLevel level, GemmBlocking blocking);
+
+/*! \return The workload of a float32 product in the tuning logs, with the SIMD level. */
+std::string GemmWorkloadName(int64_t m, int64_t n, int64_t k, bool trans_a = false,
+                             bool trans_b = false);
+
+/*!
+ * \brief The tuning task of a packed float32 product, of at least 8 rows. The knobs are
+ *  the blocking mc, kc and nc and threads, the ways the product is split. A config tuned
+ *  for the shape and the SIMD level is used over the blocking of the level.
+ */
+TuningTask GemmTuningTask(int64_t m, int64_t n, int64_t k, bool trans_a = false,
+                          bool trans_b = false);
+
+/*!
+ * \brief C = alpha * op(A) * op(B) + beta * C, row major, with the kernels of GetSIMDLevel().
+ * \param trans_a Whether op(A) is the transpose of A, A is k x m then.
+ * \param trans_b Whether op(B) is the transpose of B, B is n x k then.
+ * \param m The rows of C.
+ * \param n The columns of C.
+ * \param k The depth of the product.
+ * \param alpha The scale of the product.
+ * \param a The data of A.
+ * \param lda The row stride of A.
+ * \param b The data of B.
+ * \param ldb The row stride of B.
+ * \param beta The scale of C, C is not read when beta is 0.
+ * \param c The data of C.
+ * \param ldc The row stride of C.
+ */
+void Sgemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k, float alpha,
+           const float* a, int64_t lda, const float* b, int64_t ldb, float beta, float* c,
+           int64_t ldc);
+
+/*!
+ * \brief Sgemm with A and B stored as float32, float16 or bfloat16, raw 16-bit values.
+ *  The 16-bit operands are widened to float32 as they are packed, so they are read once
+ *  from memory at half the bandwidth, and the products accumulate in float32.
+ */
+void MixedGemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k, float alpha,
+               const void* a, GemmStorage a_storage, int64_t lda, const void* b,
+               GemmStorage b_storage, int64_t ldb, float beta, float* c, int64_t ldc);
+
+/*!
+ * \brief out = op(a) * op(b) for compact 2-D CPU arrays.
+ *  a and b are float32, float16 or bfloat16, out has their data type or float32.
+ *  Throws an Error when the operands do not match.
+ */
+void Matmul(const NDArray& a, const NDArray& b, const NDArray& out, bool trans_a = false,
+            bool trans_b = false);
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_GEMM_H_
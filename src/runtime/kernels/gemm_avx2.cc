@@ -0,0 +1,27 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+// Built with the avx2 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE avx2
+#include "gemm_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const GemmKernels* GetGemmKernelsAVX2() {
+  // 6 rows x 2 vectors of accumulators.
+  static const GemmKernels kernels = avx2::MakeGemmKernels<6, 2>();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
@@ -0,0 +1,135 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+/*!
+ * \file kernels/gemm_impl.h
+ * \brief The SGEMM kernel templates, instantiated once per instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_GEMM_IMPL_H_
+#define CVM_SRC_RUNTIME_KERNELS_GEMM_IMPL_H_
+
+#include <utility>
+
+#include "gemm_kernels.h"
+#include "simd_vec.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+/*!
+ * \brief The product of ROWS rows of an MR x (NV * lanes) tile, in ROWS * NV registers.
+ *  Each step of k broadcasts one value of A per row and multiplies it with the
+ *  NV vectors of the B row. The loops are fully unrolled so that the
+ *  accumulators stay in registers.
+ */
+template <int MR, int NV, int ROWS>
+void GemmTile(int64_t kc, const float* a, const float* b, int64_t ldb, float* c, int64_t ldc,
+              int /*m*/, int n, float alpha, float beta) {
+  using V = VecF32;
+  constexpr int L = V::kLanes;
+  constexpr int NR = NV * L;
+  V acc[ROWS][NV];
+#pragma GCC unroll 16
+  for (int i = 0; i < ROWS; ++i) {
+#pragma GCC unroll 4
+    for (int v = 0; v < NV; ++v) acc[i][v] = V::Set1(0.0f);
+  }
+  for (int64_t p = 0; p < kc; ++p) {
+    V bv[NV];
+#pragma GCC unroll 4
+    for (int v = 0; v < NV; ++v) bv[v] = V::Load(b + v * L);
+#pragma GCC unroll 16
+    for (int i = 0; i < ROWS; ++i) {
+      V av = V::Set1(a[i]);
+#pragma GCC unroll 4
+      for (int v = 0; v < NV; ++v) acc[i][v] = V::FMA(av, bv[v], acc[i][v]);
+    }
+    a += MR;
+    b += ldb;
+  }
+
+  V valpha = V::Set1(alpha);
+  V vbeta = V::Set1(beta);
+  if (n == NR) {
+#pragma GCC unroll 16
+    for (int i = 0; i < ROWS; ++i) {
+#pragma GCC unroll 4
+      for (int v = 0; v < NV; ++v) {
+        float* dst = c + i * ldc + v * L;
+        V r = acc[i][v] * valpha;
+        if (beta != 0.0f) r = V::FMA(V::Load(dst), vbeta, r);
+        r.Store(dst);
+      }
+    }
+    return;
+  }
+  // a partial tile: spill and copy the valid columns.
+  float tile[ROWS * NR];
+#pragma GCC unroll 16
+  for (int i = 0; i < ROWS; ++i) {
+#pragma GCC unroll 4
+    for (int v = 0; v < NV; ++v) (acc[i][v] * valpha).Store(tile + i * NR + v * L);
+  }
+  for (int i = 0; i < ROWS; ++i) {
+    float* dst = c + i * ldc;
+    if (beta != 0.0f) {
+      for (int j = 0; j < n; ++j) dst[j] = tile[i * NR + j] + beta * dst[j];
+    } else {
+      for (int j = 0; j < n; ++j) dst[j] = tile[i * NR + j];
+    }
+  }
+}
+
+template <int MR, int NV, int... R>
+FGemmMicroKernel GemmTileOfRows(int m, std::integer_sequence<int, R...>) {
+  static const FGemmMicroKernel tiles[] = {GemmTile<MR, NV, R + 1>...};
+  return tiles[m - 1];
+}
+
+/*! \brief The micro-kernel, the rows past m of a partial tile are not computed at all. */
+template <int MR, int NV>
+void GemmMicroKernel(int64_t kc, const float* a, const float* b, int64_t ldb, float* c,
+                     int64_t ldc, int m, int n, float alpha, float beta) {
+  if (m == MR) return GemmTile<MR, NV, MR>(kc, a, b, ldb, c, ldc, m, n, alpha, beta);
+  GemmTileOfRows<MR, NV>(m, std::make_integer_sequence<int, MR - 1>())(kc, a, b, ldb, c, ldc, m,
+                                                                        n, alpha, beta);
+}
+
+/*! \brief Four dot products at once, a is loaded once for the four rows of b. */
+inline void GemmDot(int64_t k, const float* a, const float* b, int64_t ldb, float* c, int n,
+                    float alpha, float beta) {
+  using V = VecF32;
+  constexpr int L = V::kLanes;
+  const float* rows[4];
+  for (int j = 0; j < 4; ++j) rows[j] = b + (j < n ? j : 0) * ldb;
+  V acc[4] = {V::Set1(0.0f), V::Set1(0.0f), V::Set1(0.0f), V::Set1(0.0f)};
+  int64_t p = 0;
+  for (; p + L <= k; p += L) {
+    V av = V::Load(a + p);
+#pragma GCC unroll 4
+    for (int j = 0; j < 4; ++j) acc[j] = V::FMA(av, V::Load(rows[j] + p), acc[j]);
+  }
+  for (int j = 0; j < n; ++j) {
+    float lanes[L];
+    acc[j].Store(lanes);
+    float sum = 0.0f;
+    for (int l = 0; l < L; ++l) sum += lanes[l];
+    for (int64_t q = p; q < k; ++q) sum += a[q] * rows[j][q];
+    c[j] = beta != 0.0f ? alpha * sum + beta * c[j] : alpha * sum;
+  }
+}
+
+template <int MR, int NV>
+GemmKernels MakeGemmKernels() {
+  return GemmKernels{MR, NV * VecF32::kLanes, GemmMicroKernel<MR, NV>, GemmDot};
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_GEMM_IMPL_H_
@@ -0,0 +1,66 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+/*!
+ * \file kernels/gemm_kernels.h
+ * \brief The register blocked SGEMM micro-kernels, one per instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_GEMM_KERNELS_H_
+#define CVM_SRC_RUNTIME_KERNELS_GEMM_KERNELS_H_
+
+#include <cstdint>
+
+#include "simd.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*!
+ * \brief C[0:m, 0:n] = alpha * A * B + beta * C for one mr x nr tile.
+ * \param kc The depth of the product.
+ * \param a The packed A micro-panel, kc columns of mr values.
+ * \param b The B micro-panel, kc rows of nr values.
+ * \param ldb The row stride of the B micro-panel, nr when it is packed.
+ * \param c The tile of C, row major.
+ * \param ldc The row stride of C.
+ * \param m The valid rows of the tile, at most mr.
+ * \param n The valid columns of the tile, at most nr.
+ * \param alpha The scale of the product.
+ * \param beta The scale of C, C is not read when beta is 0.
+ */
+typedef void (*FGemmMicroKernel)(int64_t kc, const float* a, const float* b, int64_t ldb,
+                                 float* c, int64_t ldc, int m, int n, float alpha, float beta);
+
+/*!
+ * \brief c[j] = alpha * dot(a, b + j * ldb) + beta * c[j] for j < n, n at most 4.
+ *  The kernel of the products of few rows by a transposed B, where packing B
+ *  would cost more than the product itself.
+ */
+typedef void (*FGemmDotKernel)(int64_t k, const float* a, const float* b, int64_t ldb, float* c,
+                               int n, float alpha, float beta);
+
+/*! \brief The kernels of one instruction set and the register tile of the micro-kernel. */
+struct GemmKernels {
+  int mr;
+  int nr;
+  FGemmMicroKernel micro_kernel;
+  FGemmDotKernel dot_kernel;
+};
+
+/*! \return The micro-kernel of a level, the best compiled level not above it. */
+const GemmKernels* GetGemmKernels(SIMDLevel level);
+
+const GemmKernels* GetGemmKernelsScalar();
+#if CVM_KERNELS_X86
+const GemmKernels* GetGemmKernelsSSE42();
+const GemmKernels* GetGemmKernelsAVX2();
+const GemmKernels* GetGemmKernelsAVX512();
+#endif
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_GEMM_KERNELS_H_
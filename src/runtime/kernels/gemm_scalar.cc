@@ -0,0 +1,20 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+// Built with the default flags of the target, the fallback of every other level.
+#define CVM_SIMD_NAMESPACE scalar
+#include "gemm_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const GemmKernels* GetGemmKernelsScalar() {
+  static const GemmKernels kernels = scalar::MakeGemmKernels<4, 4>();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
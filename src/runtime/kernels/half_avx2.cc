@@ -0,0 +1,26 @@
+//
+// Created by WangJingYu on 2021/7/23.
+//
+
+// Built with the avx2 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE avx2
+#include "half_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const HalfKernels* GetHalfKernelsAVX2() {
+  static const HalfKernels kernels = avx2::MakeHalfKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
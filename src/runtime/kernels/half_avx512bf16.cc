@@ -0,0 +1,26 @@
+//
+// Created by WangJingYu on 2021/7/23.
+//
+
+// Built with the avx512 flags plus BF16, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE avx512bf16
+#include "half_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const HalfKernels* GetHalfKernelsAVX512BF16() {
+  static const HalfKernels kernels = avx512bf16::MakeHalfKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
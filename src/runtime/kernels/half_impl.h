@@ -0,0 +1,211 @@
+//
+// Created by WangJingYu on 2021/7/23.
+//
+
+/*!
+ * \file kernels/half_impl.h
+ * \brief The conversions behind HalfKernels, instantiated once per instruction set.
+ *
+ *  float16 uses the F16C instructions from the avx2 level up and the scalar
+ *  code below it. bfloat16 is rounded with integer vector operations, or with
+ *  vcvtneps2bf16 when the source is built with AVX-512 BF16.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_HALF_IMPL_H_
+#define CVM_SRC_RUNTIME_KERNELS_HALF_IMPL_H_
+
+#ifndef CVM_SIMD_NAMESPACE
+#error "define CVM_SIMD_NAMESPACE before including half_impl.h"
+#endif
+
+#if defined(__SSE4_2__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include <cstring>
+
+#include "half_kernels.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+inline uint32_t FloatBits(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+inline float BitsToFloat(uint32_t bits) {
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+inline uint16_t FloatToFloat16(float x) {
+  uint32_t bits = FloatBits(x);
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t abs = bits & 0x7fffffff;
+  if (abs >= 0x7f800000) {
+    // keep the upper payload bits of a NaN and make it quiet.
+    return static_cast<uint16_t>(sign | (abs > 0x7f800000 ? 0x7e00 | ((abs >> 13) & 0x3ff)
+                                                            : 0x7c00));
+  }
+  // 65520 and above round to infinity.
+  if (abs >= 0x477ff000) return static_cast<uint16_t>(sign | 0x7c00);
+  if (abs < 0x38800000) {
+    // below 2^-14 the result is subnormal, adding 0.5 lets the FPU round the mantissa.
+    uint32_t rounded = FloatBits(BitsToFloat(abs) + 0.5f) - 0x3f000000;
+    return static_cast<uint16_t>(sign | rounded);
+  }
+  // rebias the exponent from 127 to 15 and round the 13 dropped bits to nearest even.
+  abs += 0xc8000fff + ((abs >> 13) & 1);
+  return static_cast<uint16_t>(sign | (abs >> 13));
+}
+
+inline float Float16ToFloat(uint16_t h) {
+  uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+  uint32_t exponent = (h >> 10) & 0x1f;
+  uint32_t mantissa = h & 0x3ff;
+  if (exponent == 0) {
+    float value = static_cast<float>(mantissa) * 5.9604644775390625e-8f;  // 2^-24
+    return BitsToFloat(sign | FloatBits(value));
+  }
+  if (exponent == 31) return BitsToFloat(sign | 0x7f800000 | (mantissa << 13));
+  return BitsToFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+inline uint16_t FloatToBFloat16(float x) {
+  uint32_t bits = FloatBits(x);
+  if ((bits & 0x7fffffff) > 0x7f800000) return static_cast<uint16_t>((bits >> 16) | 0x40);
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float BFloat16ToFloat(uint16_t h) { return BitsToFloat(static_cast<uint32_t>(h) << 16); }
+
+inline void FloatToFloat16Row(const float* x, uint16_t* out, int64_t n) {
+  int64_t i = 0;
+#if defined(__AVX512F__)
+  for (; i + 16 <= n; i += 16) {
+    __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+  }
+#elif defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+  }
+#endif
+  for (; i < n; ++i) out[i] = FloatToFloat16(x[i]);
+}
+
+inline void Float16ToFloatRow(const uint16_t* x, float* out, int64_t n) {
+  int64_t i = 0;
+#if defined(__AVX512F__)
+  for (; i + 16 <= n; i += 16) {
+    __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+    _mm512_storeu_ps(out + i, _mm512_cvtph_ps(h));
+  }
+#elif defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+  }
+#endif
+  for (; i < n; ++i) out[i] = Float16ToFloat(x[i]);
+}
+
+inline void FloatToBFloat16Row(const float* x, uint16_t* out, int64_t n) {
+  int64_t i = 0;
+#if defined(__AVX512BF16__)
+  for (; i + 16 <= n; i += 16) {
+    __m256bh h = _mm512_cvtneps_pbh(_mm512_loadu_ps(x + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), reinterpret_cast<__m256i&>(h));
+  }
+#elif defined(__AVX512F__)
+  const __m512i one = _mm512_set1_epi32(1), bias = _mm512_set1_epi32(0x7fff);
+  const __m512i quiet = _mm512_set1_epi32(0x400000);
+  for (; i + 16 <= n; i += 16) {
+    __m512 v = _mm512_loadu_ps(x + i);
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), one);
+    __m512i rounded = _mm512_add_epi32(bits, _mm512_add_epi32(lsb, bias));
+    __mmask16 nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    rounded = _mm512_mask_or_epi32(rounded, nan, bits, quiet);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm512_cvtepi32_epi16(_mm512_srli_epi32(rounded, 16)));
+  }
+#elif defined(__AVX2__)
+  const __m256i one = _mm256_set1_epi32(1), bias = _mm256_set1_epi32(0x7fff);
+  const __m256i quiet = _mm256_set1_epi32(0x400000);
+  auto round = [&](__m256 v) {
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), one);
+    __m256i rounded = _mm256_add_epi32(bits, _mm256_add_epi32(lsb, bias));
+    __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    rounded = _mm256_blendv_epi8(rounded, _mm256_or_si256(bits, quiet), nan);
+    return _mm256_srli_epi32(rounded, 16);
+  };
+  for (; i + 16 <= n; i += 16) {
+    // the pack works within 128-bit lanes, the permute puts the halves back in order.
+    __m256i packed = _mm256_packus_epi32(round(_mm256_loadu_ps(x + i)),
+                                         round(_mm256_loadu_ps(x + i + 8)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm256_permute4x64_epi64(packed, 0xd8));
+  }
+#elif defined(__SSE4_2__)
+  const __m128i one = _mm_set1_epi32(1), bias = _mm_set1_epi32(0x7fff);
+  const __m128i quiet = _mm_set1_epi32(0x400000);
+  auto round = [&](__m128 v) {
+    __m128i bits = _mm_castps_si128(v);
+    __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), one);
+    __m128i rounded = _mm_add_epi32(bits, _mm_add_epi32(lsb, bias));
+    __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(v, v));
+    rounded = _mm_blendv_epi8(rounded, _mm_or_si128(bits, quiet), nan);
+    return _mm_srli_epi32(rounded, 16);
+  };
+  for (; i + 8 <= n; i += 8) {
+    __m128i packed = _mm_packus_epi32(round(_mm_loadu_ps(x + i)), round(_mm_loadu_ps(x + i + 4)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+  }
+#endif
+  for (; i < n; ++i) out[i] = FloatToBFloat16(x[i]);
+}
+
+inline void BFloat16ToFloatRow(const uint16_t* x, float* out, int64_t n) {
+  int64_t i = 0;
+#if defined(__AVX512F__)
+  for (; i + 16 <= n; i += 16) {
+    __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+    _mm512_storeu_ps(out + i, _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16)));
+  }
+#elif defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+    _mm256_storeu_ps(out + i, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16)));
+  }
+#elif defined(__SSE4_2__)
+  for (; i + 4 <= n; i += 4) {
+    __m128i h = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(x + i));
+    _mm_storeu_ps(out + i, _mm_castsi128_ps(_mm_slli_epi32(_mm_cvtepu16_epi32(h), 16)));
+  }
+#endif
+  for (; i < n; ++i) out[i] = BFloat16ToFloat(x[i]);
+}
+
+inline HalfKernels MakeHalfKernels() {
+  HalfKernels k;
+  k.float_to_float16 = FloatToFloat16Row;
+  k.float16_to_float = Float16ToFloatRow;
+  k.float_to_bfloat16 = FloatToBFloat16Row;
+  k.bfloat16_to_float = BFloat16ToFloatRow;
+  return k;
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_HALF_IMPL_H_
@@ -0,0 +1,72 @@
+//
+// Created by WangJingYu on 2021/7/23.
+//
+
+/*!
+ * \file kernels/half_kernels.h
+ * \brief Bulk conversions between float32 and the 16-bit float formats, one table per
+ *  instruction set.
+ *
+ *  float16 is IEEE binary16 and bfloat16 the upper half of a float32, both are
+ *  stored as their raw 16 bits. Conversions from float32 round to nearest even,
+ *  NaNs stay quiet NaNs and values past the float16 range become infinities.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_HALF_KERNELS_H_
+#define CVM_SRC_RUNTIME_KERNELS_HALF_KERNELS_H_
+
+#include <dlpack/dlpack.h>
+
+#include <cstdint>
+
+#include "simd.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief out[i] = x[i] rounded to 16 bits, for i in [0, n). */
+typedef void (*FFloatToHalf)(const float* x, uint16_t* out, int64_t n);
+
+/*! \brief out[i] = x[i] widened to float32, for i in [0, n). */
+typedef void (*FHalfToFloat)(const uint16_t* x, float* out, int64_t n);
+
+/*! \brief The conversion kernels built for one instruction set. */
+struct HalfKernels {
+  FFloatToHalf float_to_float16;
+  FHalfToFloat float16_to_float;
+  FFloatToHalf float_to_bfloat16;
+  FHalfToFloat bfloat16_to_float;
+};
+
+/*!
+ * \return The kernels of a level, the best compiled level not above it.
+ *  The avx512 level converts to bfloat16 with AVX-512 BF16 when the CPU has it,
+ *  those instructions flush float32 subnormals to zero.
+ */
+const HalfKernels* GetHalfKernels(SIMDLevel level);
+
+/*! \brief The conversions of a 16-bit float data type. */
+struct HalfConverter {
+  FHalfToFloat to_float{nullptr};
+  FFloatToHalf from_float{nullptr};
+};
+
+/*!
+ * \return The conversions of dtype at the current SIMD level, null ones when it is not
+ *  float16 or bfloat16.
+ */
+HalfConverter GetHalfConverter(DLDataType dtype);
+
+const HalfKernels* GetHalfKernelsScalar();
+#if CVM_KERNELS_X86
+const HalfKernels* GetHalfKernelsSSE42();
+const HalfKernels* GetHalfKernelsAVX2();
+const HalfKernels* GetHalfKernelsAVX512();
+const HalfKernels* GetHalfKernelsAVX512BF16();
+#endif
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_HALF_KERNELS_H_
@@ -0,0 +1,20 @@
+//
+// Created by WangJingYu on 2021/7/23.
+//
+
+// Built with the default flags of the target, the fallback of every other level.
+#define CVM_SIMD_NAMESPACE scalar
+#include "half_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const HalfKernels* GetHalfKernelsScalar() {
+  static const HalfKernels kernels = scalar::MakeHalfKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,61 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+#include "kernel_utils.h"
+
+#include <cvm/runtime/device_api.h>
+
+#include <sstream>
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+void CheckOperand(const NDArray& arr, const char* op, const char* name) {
+  if (!arr.defined()) throw Error(std::string(op) + ": " + name + " is not defined");
+  if (arr->device.device_type != kDLCPU) {
+    throw Error(std::string(op) + ": " + name + " must be on the CPU");
+  }
+  if (!arr.IsContiguous() || arr->byte_offset != 0) {
+    throw Error(std::string(op) + ": " + name + " must be compact");
+  }
+}
+
+void CheckSameDType(const NDArray& a, const NDArray& b, const char* op) {
+  if (a.DataType() != b.DataType()) {
+    std::ostringstream os;
+    os << op << ": data types " << a->dtype << " and " << b->dtype << " mismatch";
+    throw Error(os.str());
+  }
+}
+
+int64_t NumElements(const std::vector<int64_t>& shape) {
+  int64_t num_elems = 1;
+  for (int64_t extent : shape) num_elems *= extent;
+  return num_elems;
+}
+
+std::string ShapeToString(const std::vector<int64_t>& shape) {
+  std::ostringstream os;
+  os << '(';
+  for (size_t i = 0; i < shape.size(); ++i) os << (i == 0 ? "" : ", ") << shape[i];
+  os << ')';
+  return os.str();
+}
+
+KernelWorkspace::KernelWorkspace(size_t nbytes) {
+  if (nbytes == 0) return;
+  Device dev{kDLCPU, 0};
+  data_ = DeviceAPI::Get(dev)->AllocWorkspace(dev, nbytes);
+}
+
+KernelWorkspace::~KernelWorkspace() {
+  if (data_ == nullptr) return;
+  Device dev{kDLCPU, 0};
+  DeviceAPI::Get(dev)->FreeWorkspace(dev, data_);
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
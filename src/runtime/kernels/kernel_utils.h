@@ -0,0 +1,69 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+/*!
+ * \file kernels/kernel_utils.h
+ * \brief Operand checks and scratch memory shared by the NDArray kernels.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_KERNEL_UTILS_H_
+#define CVM_SRC_RUNTIME_KERNELS_KERNEL_UTILS_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <string>
+#include <vector>
+
+#include "../../support/parallel_for.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief Throw an Error unless arr is a defined, compact CPU array. */
+void CheckOperand(const NDArray& arr, const char* op, const char* name);
+
+/*! \brief Throw an Error unless a and b have the same data type. */
+void CheckSameDType(const NDArray& a, const NDArray& b, const char* op);
+
+/*! \return The product of the extents. */
+int64_t NumElements(const std::vector<int64_t>& shape);
+
+/*! \return The shape as "(2, 3)". */
+std::string ShapeToString(const std::vector<int64_t>& shape);
+
+/*! \brief A CPU workspace of the calling thread, freed at the end of the scope. */
+class KernelWorkspace {
+ public:
+  /*! \brief Allocate nbytes, no allocation for 0. */
+  explicit KernelWorkspace(size_t nbytes);
+  ~KernelWorkspace();
+  KernelWorkspace(const KernelWorkspace&) = delete;
+  KernelWorkspace& operator=(const KernelWorkspace&) = delete;
+
+  template <typename T>
+  T* As() const {
+    return static_cast<T*>(data_);
+  }
+
+ private:
+  void* data_{nullptr};
+};
+
+/*! \brief Run f(task) for task in [0, num_tasks), on the thread pool when parallel. */
+template <typename F>
+void RunTasks(int64_t num_tasks, bool parallel, const F& f) {
+  if (!parallel || num_tasks == 1) {
+    for (int64_t task = 0; task < num_tasks; ++task) f(task);
+    return;
+  }
+  support::parallel_for(0, num_tasks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t task = begin; task < end; ++task) f(task);
+  });
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_KERNEL_UTILS_H_
@@ -0,0 +1,413 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+#include "layout.h"
+
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "../copy_kernel.h"
+#include "kernel_utils.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const LayoutKernels* GetLayoutKernels(SIMDLevel level) {
+#if CVM_KERNELS_X86
+  switch (level) {
+    case SIMDLevel::kAVX512:
+      return GetLayoutKernelsAVX512();
+    case SIMDLevel::kAVX2:
+      return GetLayoutKernelsAVX2();
+    case SIMDLevel::kSSE42:
+      return GetLayoutKernelsSSE42();
+    default:
+      break;
+  }
+#endif
+  return GetLayoutKernelsScalar();
+}
+
+Layout::Layout(const std::string& name) : name_(name) {
+  int64_t factor = 0;
+  bool has_factor = false;
+  for (char ch : name) {
+    if (ch >= '0' && ch <= '9') {
+      factor = factor * 10 + (ch - '0');
+      has_factor = true;
+      if (factor > (int64_t(1) << 40)) throw Error("layout: the factor is too large in " + name);
+      continue;
+    }
+    bool sub = ch >= 'a' && ch <= 'z';
+    if (!IsPrimal(ch) && !sub) {
+      throw Error("layout: invalid axis '" + std::string(1, ch) + "' in " + name);
+    }
+    if (axes_.find(ch) != std::string::npos) {
+      throw Error("layout: axis " + std::string(1, ch) + " appears twice in " + name);
+    }
+    if (sub && factor <= 0) {
+      throw Error("layout: the split axis " + std::string(1, ch) + " needs a positive factor in " +
+                  name);
+    }
+    if (!sub && has_factor) {
+      throw Error("layout: the primal axis " + std::string(1, ch) + " takes no factor in " + name);
+    }
+    axes_.push_back(ch);
+    factors_.push_back(factor);
+    factor = 0;
+    has_factor = false;
+  }
+  if (has_factor) throw Error("layout: a factor must precede a split axis in " + name);
+  for (char ch : axes_) {
+    if (!IsPrimal(ch) && IndexOf(ch - 'a' + 'A') < 0) {
+      throw Error("layout: the split axis " + std::string(1, ch) + " has no primal axis in " +
+                  name);
+    }
+  }
+}
+
+int Layout::IndexOf(char axis) const {
+  size_t pos = axes_.find(axis);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+
+int64_t Layout::FactorOf(char primal) const {
+  int index = IndexOf(primal - 'A' + 'a');
+  return index < 0 ? 0 : factors_[index];
+}
+
+std::string Layout::PrimalAxes() const {
+  std::string primal;
+  for (char ch : axes_) {
+    if (IsPrimal(ch)) primal.push_back(ch);
+  }
+  return primal;
+}
+
+bool LayoutConvertible(const Layout& src, const Layout& dst) {
+  std::string a = src.PrimalAxes(), b = dst.PrimalAxes();
+  std::sort(a.begin(), a.end());
+  std::sort(b.begin(), b.end());
+  return a == b;
+}
+
+namespace {
+
+/*! \brief The rows of a transposing copy handled by one task, and the columns of a tile. */
+constexpr int64_t kLayoutTile = 32;
+
+/*! \brief The smallest transform split over the thread pool, in bytes. */
+constexpr int64_t kParallelLayoutMinBytes = 1 << 20;
+
+/*! \brief The extent of every primal axis, padded to the factor when it is split. */
+std::vector<int64_t> PrimalExtents(const std::vector<int64_t>& shape, const Layout& layout,
+                                   const char* what) {
+  if (shape.size() != layout.ndim()) {
+    throw Error(std::string("layout_transform: ") + what + " has shape " +
+                ShapeToString(shape) + ", which does not fit " + layout.name());
+  }
+  std::vector<int64_t> extents(26, 1);
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (Layout::IsPrimal(layout[i])) {
+      extents[layout[i] - 'A'] *= shape[i];
+    } else if (shape[i] != layout.factor(i)) {
+      throw Error(std::string("layout_transform: ") + what + " has shape " +
+                  ShapeToString(shape) + ", which does not fit " + layout.name());
+    } else {
+      extents[layout[i] - 'a'] *= shape[i];
+    }
+  }
+  return extents;
+}
+
+void CheckConvertible(const Layout& src, const Layout& dst) {
+  if (!LayoutConvertible(src, dst)) {
+    throw Error("layout_transform: " + src.name() + " does not convert to " + dst.name());
+  }
+}
+
+/*! \brief A dimension of the permutation a transform reduces to, strides in elements. */
+struct PermutedDim {
+  int64_t extent;
+  int64_t src_stride;
+  int64_t dst_stride;
+};
+
+/*!
+ * \brief The transform as a copy from a strided view of the input, in the order of
+ *  the output, or nothing when it is not a permutation.
+ *
+ *  Every primal axis is cut into at most three pieces, the outer part and the
+ *  parts of the two factors, so that both layouts are a reshape of the pieces.
+ */
+bool PermutationOf(const Layout& src, const Layout& dst, const std::vector<int64_t>& extents,
+                   std::vector<PermutedDim>* dims) {
+  // the pieces of every primal axis, outermost first.
+  std::vector<std::vector<int64_t>> pieces(26);
+  for (size_t i = 0; i < src.ndim(); ++i) {
+    char axis = src[i];
+    if (!Layout::IsPrimal(axis)) continue;
+    int64_t fs = src.FactorOf(axis), fd = dst.FactorOf(axis);
+    int64_t big = std::max(fs, fd), small = std::min(fs, fd);
+    int64_t extent = extents[axis - 'A'];
+    if (small == 0) small = big;
+    if (big == 0) {
+      pieces[axis - 'A'] = {extent};
+    } else if (big % small != 0 || extent % big != 0) {
+      return false;
+    } else if (big == small) {
+      pieces[axis - 'A'] = {extent / big, big};
+    } else {
+      pieces[axis - 'A'] = {extent / big, big / small, small};
+    }
+  }
+  // the pieces a layout axis covers: the inner ones of the factor for a split axis,
+  // the remaining outer ones for its primal axis.
+  auto covers = [&](const Layout& layout, size_t i, size_t* begin, size_t* end) {
+    char primal = Layout::IsPrimal(layout[i]) ? layout[i] : layout[i] - 'a' + 'A';
+    const std::vector<int64_t>& p = pieces[primal - 'A'];
+    int64_t factor = layout.FactorOf(primal);
+    size_t split = p.size();
+    for (int64_t inner = 1; inner < factor;) inner *= p[--split];
+    *begin = Layout::IsPrimal(layout[i]) ? 0 : split;
+    *end = Layout::IsPrimal(layout[i]) ? split : p.size();
+  };
+  std::vector<std::vector<int64_t>> src_strides(26);
+  for (int a = 0; a < 26; ++a) src_strides[a].resize(pieces[a].size());
+  int64_t stride = 1;
+  for (size_t i = src.ndim(); i-- > 0;) {
+    size_t begin, end;
+    covers(src, i, &begin, &end);
+    char primal = Layout::IsPrimal(src[i]) ? src[i] : src[i] - 'a' + 'A';
+    for (size_t j = end; j-- > begin;) {
+      src_strides[primal - 'A'][j] = stride;
+      stride *= pieces[primal - 'A'][j];
+    }
+  }
+  dims->clear();
+  for (size_t i = 0; i < dst.ndim(); ++i) {
+    size_t begin, end;
+    covers(dst, i, &begin, &end);
+    char primal = Layout::IsPrimal(dst[i]) ? dst[i] : dst[i] - 'a' + 'A';
+    for (size_t j = begin; j < end; ++j) {
+      dims->push_back({pieces[primal - 'A'][j], src_strides[primal - 'A'][j], 0});
+    }
+  }
+  stride = 1;
+  for (size_t i = dims->size(); i-- > 0;) {
+    (*dims)[i].dst_stride = stride;
+    stride *= (*dims)[i].extent;
+  }
+  // drop the unit dimensions, merge the ones contiguous in both tensors.
+  std::vector<PermutedDim> merged;
+  for (const PermutedDim& d : *dims) {
+    if (d.extent == 1) continue;
+    if (!merged.empty() && merged.back().src_stride == d.src_stride * d.extent &&
+        merged.back().dst_stride == d.dst_stride * d.extent) {
+      merged.back() = {merged.back().extent * d.extent, d.src_stride, d.dst_stride};
+    } else {
+      merged.push_back(d);
+    }
+  }
+  dims->swap(merged);
+  return true;
+}
+
+/*!
+ * \brief A permutation of 4-byte elements whose innermost output dimension is strided in
+ *  the input while dimension k is not: tiles of the (k, innermost) planes are transposed.
+ */
+void TransposePermutation(const uint32_t* src, uint32_t* dst, const std::vector<PermutedDim>& dims,
+                          size_t k, bool parallel) {
+  const LayoutKernels* kernels = GetLayoutKernels(GetSIMDLevel());
+  const size_t last = dims.size() - 1;
+  std::vector<PermutedDim> batch;
+  for (size_t i = 0; i < last; ++i) {
+    if (i != k) batch.push_back(dims[i]);
+  }
+  int64_t num_batch = 1;
+  for (const PermutedDim& d : batch) num_batch *= d.extent;
+  const int64_t rows = dims[k].extent, cols = dims[last].extent;
+  const int64_t lds = dims[last].src_stride, ldd = dims[k].dst_stride;
+  const int64_t num_strips = (rows + kLayoutTile - 1) / kLayoutTile;
+  RunTasks(num_batch * num_strips, parallel, [&](int64_t task) {
+    int64_t b = task / num_strips, r0 = task % num_strips * kLayoutTile;
+    int64_t src_offset = r0 * dims[k].src_stride, dst_offset = r0 * ldd;
+    for (size_t i = batch.size(); i-- > 0;) {
+      int64_t index = b % batch[i].extent;
+      b /= batch[i].extent;
+      src_offset += index * batch[i].src_stride;
+      dst_offset += index * batch[i].dst_stride;
+    }
+    const int64_t nrow = std::min(kLayoutTile, rows - r0);
+    for (int64_t c0 = 0; c0 < cols; c0 += kLayoutTile) {
+      kernels->transpose32(src + src_offset + c0 * lds, lds, dst + dst_offset + c0, ldd, nrow,
+                           std::min(kLayoutTile, cols - c0));
+    }
+  });
+}
+
+template <typename T>
+void MoveElement(char* dst, const char* src, size_t) {
+  *reinterpret_cast<T*>(dst) = *reinterpret_cast<const T*>(src);
+}
+
+void MoveBytes(char* dst, const char* src, size_t nbytes) { std::memcpy(dst, src, nbytes); }
+
+/*!
+ * \brief The transforms that are no permutation, element by element: every output
+ *  element finds its primal coordinates, zero past the extents of the input.
+ */
+void GatherTransform(const char* src, char* dst, size_t elem_bytes, const Layout& src_layout,
+                     const std::vector<int64_t>& src_shape, const Layout& dst_layout,
+                     const std::vector<int64_t>& dst_shape, const std::vector<int64_t>& extents,
+                     bool parallel) {
+  std::vector<int64_t> src_strides(src_shape.size());
+  int64_t stride = 1;
+  for (size_t i = src_shape.size(); i-- > 0;) {
+    src_strides[i] = stride;
+    stride *= src_shape[i];
+  }
+  std::string primal = dst_layout.PrimalAxes();
+  void (*move)(char*, const char*, size_t) = elem_bytes == 1   ? MoveElement<uint8_t>
+                                             : elem_bytes == 2 ? MoveElement<uint16_t>
+                                             : elem_bytes == 4 ? MoveElement<uint32_t>
+                                             : elem_bytes == 8 ? MoveElement<uint64_t>
+                                                               : MoveBytes;
+  const size_t ndim = dst_shape.size();
+  const int64_t inner = ndim == 0 ? 1 : dst_shape[ndim - 1];
+  const int64_t num_rows = inner == 0 ? 0 : NumElements(dst_shape) / inner;
+  RunTasks(num_rows, parallel, [&](int64_t row) {
+    // a layout has at most 52 axes.
+    int64_t index[52];
+    int64_t rest = row;
+    for (size_t i = ndim == 0 ? 0 : ndim - 1; i-- > 0;) {
+      index[i] = rest % dst_shape[i];
+      rest /= dst_shape[i];
+    }
+    char* out = dst + row * inner * elem_bytes;
+    for (int64_t x = 0; x < inner; ++x, out += elem_bytes) {
+      if (ndim != 0) index[ndim - 1] = x;
+      int64_t coords[26];
+      for (char axis : primal) coords[axis - 'A'] = 0;
+      for (size_t i = 0; i < ndim; ++i) {
+        char axis = dst_layout[i];
+        if (Layout::IsPrimal(axis)) {
+          int64_t factor = dst_layout.FactorOf(axis);
+          coords[axis - 'A'] += index[i] * std::max<int64_t>(factor, 1);
+        } else {
+          coords[axis - 'a'] += index[i];
+        }
+      }
+      int64_t offset = 0;
+      bool inside = true;
+      for (size_t i = 0; i < src_layout.ndim() && inside; ++i) {
+        char axis = src_layout[i];
+        int64_t coord = coords[Layout::IsPrimal(axis) ? axis - 'A' : axis - 'a'];
+        if (Layout::IsPrimal(axis)) {
+          inside = coord < extents[axis - 'A'];
+          int64_t factor = src_layout.FactorOf(axis);
+          offset += (factor == 0 ? coord : coord / factor) * src_strides[i];
+        } else {
+          offset += coord % src_layout.factor(i) * src_strides[i];
+        }
+      }
+      if (inside) {
+        move(out, src + offset * elem_bytes, elem_bytes);
+      } else {
+        std::memset(out, 0, elem_bytes);
+      }
+    }
+  });
+}
+
+}  // namespace
+
+std::vector<int64_t> LayoutTransformShape(const std::vector<int64_t>& src_shape,
+                                          const Layout& src, const Layout& dst) {
+  CheckConvertible(src, dst);
+  std::vector<int64_t> extents = PrimalExtents(src_shape, src, "x");
+  std::vector<int64_t> shape(dst.ndim());
+  for (size_t i = 0; i < dst.ndim(); ++i) {
+    if (Layout::IsPrimal(dst[i])) {
+      int64_t factor = std::max<int64_t>(1, dst.FactorOf(dst[i]));
+      shape[i] = (extents[dst[i] - 'A'] + factor - 1) / factor;
+    } else {
+      shape[i] = dst.factor(i);
+    }
+  }
+  return shape;
+}
+
+void LayoutTransform(const NDArray& x, const Layout& src, const Layout& dst, const NDArray& out) {
+  CheckOperand(x, "layout_transform", "x");
+  CheckOperand(out, "layout_transform", "out");
+  CheckSameDType(x, out, "layout_transform");
+  if (x->dtype.bits * x->dtype.lanes % 8 != 0) {
+    throw Error("layout_transform: the elements must be whole bytes");
+  }
+  const std::vector<int64_t> expected = LayoutTransformShape(x.Shape(), src, dst);
+  const std::vector<int64_t> out_shape = out.Shape();
+  bool fits = out_shape.size() == expected.size();
+  for (size_t i = 0; fits && i < expected.size(); ++i) {
+    // an axis split in src alone may drop its padding.
+    int64_t padding = Layout::IsPrimal(dst[i]) && dst.FactorOf(dst[i]) == 0
+                          ? std::max<int64_t>(src.FactorOf(dst[i]) - 1, 0)
+                          : 0;
+    fits = out_shape[i] <= expected[i] && out_shape[i] >= expected[i] - padding;
+  }
+  if (!fits) {
+    throw Error("layout_transform: out has shape " + ShapeToString(out_shape) + ", expect " +
+                ShapeToString(expected) + " for " + src.name() + " to " + dst.name());
+  }
+  std::vector<int64_t> src_extents = PrimalExtents(x.Shape(), src, "x");
+  std::vector<int64_t> dst_extents = PrimalExtents(out_shape, dst, "out");
+  const size_t elem_bytes = x->dtype.bits * x->dtype.lanes / 8;
+  const int64_t num_elems = NumElements(out_shape);
+  if (num_elems == 0) return;
+  const bool parallel = threading::NumThreads() > 1 &&
+                        num_elems * static_cast<int64_t>(elem_bytes) >= kParallelLayoutMinBytes;
+  const char* px = static_cast<const char*>(x->data) + x->byte_offset;
+  char* po = static_cast<char*>(out->data) + out->byte_offset;
+
+  std::vector<PermutedDim> dims;
+  if (src_extents != dst_extents || !PermutationOf(src, dst, src_extents, &dims)) {
+    std::vector<int64_t> extents(26);
+    for (int a = 0; a < 26; ++a) extents[a] = std::min(src_extents[a], dst_extents[a]);
+    GatherTransform(px, po, elem_bytes, src, x.Shape(), dst, out_shape, extents, parallel);
+    return;
+  }
+  if (elem_bytes == 4 && !dims.empty() && dims.back().src_stride != 1) {
+    for (size_t k = dims.size() - 1; k-- > 0;) {
+      if (dims[k].src_stride == 1) {
+        TransposePermutation(reinterpret_cast<const uint32_t*>(px),
+                             reinterpret_cast<uint32_t*>(po), dims, k, parallel);
+        return;
+      }
+    }
+  }
+  std::vector<int64_t> shape, src_strides;
+  for (const PermutedDim& d : dims) {
+    shape.push_back(d.extent);
+    src_strides.push_back(d.src_stride);
+  }
+  DLTensor from{x->data, x->device, static_cast<int>(shape.size()), x->dtype, shape.data(),
+                src_strides.data(), x->byte_offset};
+  DLTensor to{out->data, out->device, static_cast<int>(shape.size()), out->dtype, shape.data(),
+              nullptr, out->byte_offset};
+  CopyStridedTensor(&from, &to);
+}
+
+CVM_REGISTER_GLOBAL("kernel.layout_transform")
+    .set_body_typed([](NDArray x, NDArray out, String src, String dst) {
+      LayoutTransform(x, Layout(src), Layout(dst), out);
+    });
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,97 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+/*!
+ * \file kernels/layout.h
+ * \brief Data layouts of tensors and the conversions between them.
+ *
+ *  A layout names the axes of a tensor from the outermost to the innermost.
+ *  Upper case letters are primal axes, a lower case letter is the inner part of
+ *  the primal axis of the same letter, split by the factor written before it:
+ *  "NCHW16c" is NCHW with the channels in blocks of 16, the shape
+ *  (N, C / 16, H, W, 16).
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_LAYOUT_H_
+#define CVM_SRC_RUNTIME_KERNELS_LAYOUT_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <string>
+#include <vector>
+
+#include "layout_kernels.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief A parsed layout string such as "NCHW" or "NCHW16c". */
+class Layout {
+ public:
+  /*! \brief The undefined layout. */
+  Layout() = default;
+  /*!
+   * \brief Parse a layout, throws an Error when it is malformed.
+   *  Every primal axis appears once, a split axis needs a positive factor and
+   *  its primal axis, and a primal axis is split at most once.
+   */
+  explicit Layout(const std::string& name);
+
+  bool defined() const { return !axes_.empty(); }
+  const std::string& name() const { return name_; }
+  size_t ndim() const { return axes_.size(); }
+  /*! \return The letter of the i-th axis. */
+  char operator[](size_t i) const { return axes_[i]; }
+  /*! \return The factor of the i-th axis, 0 for a primal axis. */
+  int64_t factor(size_t i) const { return factors_[i]; }
+  /*! \return The position of an axis, -1 when the layout has no such axis. */
+  int IndexOf(char axis) const;
+  /*! \return The factor the primal axis is split by, 0 when it is not split. */
+  int64_t FactorOf(char primal) const;
+  /*! \return The primal axes in the order of the layout, "NCHW" for "NCHW16c". */
+  std::string PrimalAxes() const;
+
+  bool operator==(const Layout& other) const { return name_ == other.name_; }
+  bool operator!=(const Layout& other) const { return name_ != other.name_; }
+
+  static bool IsPrimal(char axis) { return axis >= 'A' && axis <= 'Z'; }
+
+ private:
+  std::string name_;
+  std::string axes_;
+  std::vector<int64_t> factors_;
+};
+
+/*! \return Whether the tensors of one layout convert to the other, same primal axes. */
+bool LayoutConvertible(const Layout& src, const Layout& dst);
+
+/*!
+ * \brief The shape of a tensor of shape src_shape in layout src after the conversion to dst.
+ *  A split primal axis is padded up to a multiple of its factor. Throws an Error when
+ *  the layouts do not convert or the shape does not fit src.
+ */
+std::vector<int64_t> LayoutTransformShape(const std::vector<int64_t>& src_shape,
+                                          const Layout& src, const Layout& dst);
+
+/*!
+ * \brief Convert x from layout src to layout dst.
+ * \param x The input, compact, any data type of whole bytes.
+ * \param src The layout of x.
+ * \param dst The layout of out.
+ * \param out The result, same data type, shape LayoutTransformShape(x, src, dst). A primal
+ *  axis split in src and not in dst may also be shorter, by less than the factor, which
+ *  drops the padding.
+ *
+ *  When the primal extents agree and the factors divide each other the conversion is a
+ *  permutation: 4-byte elements are transposed in cache sized tiles by the register
+ *  transposes of the SIMD level, over the thread pool, the other ones copied row by row.
+ *  Padding goes through an element by element loop that writes zeros past the input.
+ */
+void LayoutTransform(const NDArray& x, const Layout& src, const Layout& dst, const NDArray& out);
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_LAYOUT_H_
@@ -0,0 +1,26 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+// Built with the avx2 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE avx2
+#include "layout_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const LayoutKernels* GetLayoutKernelsAVX2() {
+  static const LayoutKernels kernels = avx2::MakeLayoutKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
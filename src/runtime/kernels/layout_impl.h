@@ -0,0 +1,106 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+/*!
+ * \file kernels/layout_impl.h
+ * \brief The templates behind LayoutKernels, instantiated once per instruction set.
+ *
+ *  A transpose walks the matrix in square blocks held in registers: the rows of
+ *  a block are loaded from the source, shuffled and stored as the rows of the
+ *  destination block. The edges fall back to element copies. The AVX-512 build
+ *  keeps the 8x8 blocks of AVX2, a transpose is bound by memory either way.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_LAYOUT_IMPL_H_
+#define CVM_SRC_RUNTIME_KERNELS_LAYOUT_IMPL_H_
+
+#include "layout_kernels.h"
+#include "simd_vec.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+#if defined(__AVX2__)
+
+constexpr int64_t kTransposeBlock = 8;
+
+inline void TransposeBlock(const uint32_t* src, int64_t lds, uint32_t* dst, int64_t ldd) {
+  const float* s = reinterpret_cast<const float*>(src);
+  float* d = reinterpret_cast<float*>(dst);
+  __m256 r0 = _mm256_loadu_ps(s), r1 = _mm256_loadu_ps(s + lds);
+  __m256 r2 = _mm256_loadu_ps(s + 2 * lds), r3 = _mm256_loadu_ps(s + 3 * lds);
+  __m256 r4 = _mm256_loadu_ps(s + 4 * lds), r5 = _mm256_loadu_ps(s + 5 * lds);
+  __m256 r6 = _mm256_loadu_ps(s + 6 * lds), r7 = _mm256_loadu_ps(s + 7 * lds);
+  // interleave pairs of rows, then pairs of pairs, then swap the 128-bit halves.
+  __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+  __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+  __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+  __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+  __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+  __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+  __m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44), u5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+  __m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44), u7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+  _mm256_storeu_ps(d, _mm256_permute2f128_ps(u0, u4, 0x20));
+  _mm256_storeu_ps(d + ldd, _mm256_permute2f128_ps(u1, u5, 0x20));
+  _mm256_storeu_ps(d + 2 * ldd, _mm256_permute2f128_ps(u2, u6, 0x20));
+  _mm256_storeu_ps(d + 3 * ldd, _mm256_permute2f128_ps(u3, u7, 0x20));
+  _mm256_storeu_ps(d + 4 * ldd, _mm256_permute2f128_ps(u0, u4, 0x31));
+  _mm256_storeu_ps(d + 5 * ldd, _mm256_permute2f128_ps(u1, u5, 0x31));
+  _mm256_storeu_ps(d + 6 * ldd, _mm256_permute2f128_ps(u2, u6, 0x31));
+  _mm256_storeu_ps(d + 7 * ldd, _mm256_permute2f128_ps(u3, u7, 0x31));
+}
+
+#elif defined(__SSE4_2__)
+
+constexpr int64_t kTransposeBlock = 4;
+
+inline void TransposeBlock(const uint32_t* src, int64_t lds, uint32_t* dst, int64_t ldd) {
+  const float* s = reinterpret_cast<const float*>(src);
+  float* d = reinterpret_cast<float*>(dst);
+  __m128 r0 = _mm_loadu_ps(s), r1 = _mm_loadu_ps(s + lds);
+  __m128 r2 = _mm_loadu_ps(s + 2 * lds), r3 = _mm_loadu_ps(s + 3 * lds);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_storeu_ps(d, r0);
+  _mm_storeu_ps(d + ldd, r1);
+  _mm_storeu_ps(d + 2 * ldd, r2);
+  _mm_storeu_ps(d + 3 * ldd, r3);
+}
+
+#else
+
+constexpr int64_t kTransposeBlock = 1;
+
+inline void TransposeBlock(const uint32_t* src, int64_t, uint32_t* dst, int64_t) { *dst = *src; }
+
+#endif
+
+inline void Transpose32(const uint32_t* src, int64_t lds, uint32_t* dst, int64_t ldd,
+                        int64_t rows, int64_t cols) {
+  constexpr int64_t B = kTransposeBlock;
+  const int64_t full_rows = rows / B * B, full_cols = cols / B * B;
+  for (int64_t c = 0; c < full_cols; c += B) {
+    for (int64_t r = 0; r < full_rows; r += B) {
+      TransposeBlock(src + c * lds + r, lds, dst + r * ldd + c, ldd);
+    }
+  }
+  for (int64_t r = 0; r < rows; ++r) {
+    for (int64_t c = r < full_rows ? full_cols : 0; c < cols; ++c) {
+      dst[r * ldd + c] = src[c * lds + r];
+    }
+  }
+}
+
+inline LayoutKernels MakeLayoutKernels() {
+  LayoutKernels k;
+  k.transpose32 = Transpose32;
+  return k;
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_LAYOUT_IMPL_H_
@@ -0,0 +1,47 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+/*!
+ * \file kernels/layout_kernels.h
+ * \brief The transposes behind the layout transforms, one table per instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_LAYOUT_KERNELS_H_
+#define CVM_SRC_RUNTIME_KERNELS_LAYOUT_KERNELS_H_
+
+#include <cstdint>
+
+#include "simd.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*!
+ * \brief dst[r * ldd + c] = src[c * lds + r] for r in [0, rows), c in [0, cols).
+ *  The elements are 4 bytes, moved as their bits.
+ */
+typedef void (*FTranspose32)(const uint32_t* src, int64_t lds, uint32_t* dst, int64_t ldd,
+                             int64_t rows, int64_t cols);
+
+/*! \brief The layout kernels built for one instruction set. */
+struct LayoutKernels {
+  /*! \brief register transposes of 4x4 (sse42) or 8x8 (avx2, avx512) blocks */
+  FTranspose32 transpose32;
+};
+
+/*! \return The kernels of a level, the best compiled level not above it. */
+const LayoutKernels* GetLayoutKernels(SIMDLevel level);
+
+const LayoutKernels* GetLayoutKernelsScalar();
+#if CVM_KERNELS_X86
+const LayoutKernels* GetLayoutKernelsSSE42();
+const LayoutKernels* GetLayoutKernelsAVX2();
+const LayoutKernels* GetLayoutKernelsAVX512();
+#endif
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_LAYOUT_KERNELS_H_
@@ -0,0 +1,20 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+// Built with the default flags of the target, the fallback of every other level.
+#define CVM_SIMD_NAMESPACE scalar
+#include "layout_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const LayoutKernels* GetLayoutKernelsScalar() {
+  static const LayoutKernels kernels = scalar::MakeLayoutKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,155 @@
+//
+// Created by WangJingYu on 2021/7/26.
+//
+
+#include "normalization.h"
+
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "half_kernels.h"
+#include "kernel_utils.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const NormalizationKernels* GetNormalizationKernels(SIMDLevel level) {
+#if CVM_KERNELS_X86
+  switch (level) {
+    case SIMDLevel::kAVX512:
+      return GetNormalizationKernelsAVX512();
+    case SIMDLevel::kAVX2:
+      return GetNormalizationKernelsAVX2();
+    case SIMDLevel::kSSE42:
+      return GetNormalizationKernelsSSE42();
+    default:
+      break;
+  }
+#endif
+  return GetNormalizationKernelsScalar();
+}
+
+namespace {
+
+/*! \brief The elements of the rows of one task, a few rows of a transformer layer. */
+constexpr int64_t kNormalizationTaskElems = 1 << 13;
+
+bool IsFloat32(DLDataType dtype) {
+  return dtype.code == kDLFloat && dtype.bits == 32 && dtype.lanes == 1;
+}
+
+/*!
+ * \brief Check x and out of a row operator, out has the data type and shape of x.
+ * \return The extent of the last axis.
+ */
+int64_t CheckRowOperands(const NDArray& x, const NDArray& out, const char* op) {
+  CheckOperand(x, op, "x");
+  CheckOperand(out, op, "out");
+  CheckSameDType(x, out, op);
+  if (!IsFloat32(x->dtype) && GetHalfConverter(x->dtype).to_float == nullptr) {
+    throw Error(std::string(op) + ": expect a float32, float16 or bfloat16 input");
+  }
+  if (x->ndim == 0) throw Error(std::string(op) + ": expect at least one dimension");
+  if (x.Shape() != out.Shape()) {
+    throw Error(std::string(op) + ": out has shape " + ShapeToString(out.Shape()) +
+                ", expect " + ShapeToString(x.Shape()));
+  }
+  return x->shape[x->ndim - 1];
+}
+
+/*!
+ * \brief Call f(in, out) for the rows of n elements of x and out, float32 pointers.
+ *  16-bit rows go through a float32 buffer of the task, in and out are the same then.
+ */
+template <typename F>
+void ForEachRow(const NDArray& x, const NDArray& out, int64_t n, const F& f) {
+  const int64_t rows = NumElements(x.Shape()) / n;
+  const int64_t rows_per_task = std::max<int64_t>(1, kNormalizationTaskElems / n);
+  const int64_t num_tasks = (rows + rows_per_task - 1) / rows_per_task;
+  const bool parallel =
+      threading::NumThreads() > 1 && rows * n >= kParallelNormalizationMinElems;
+  HalfConverter conv = GetHalfConverter(x->dtype);
+  RunTasks(num_tasks, parallel, [&](int64_t task) {
+    const int64_t begin = task * rows_per_task;
+    const int64_t end = std::min(rows, begin + rows_per_task);
+    if (conv.to_float == nullptr) {
+      const float* px = static_cast<const float*>(x->data);
+      float* po = static_cast<float*>(out->data);
+      for (int64_t r = begin; r < end; ++r) f(px + r * n, po + r * n);
+      return;
+    }
+    const uint16_t* px = static_cast<const uint16_t*>(x->data);
+    uint16_t* po = static_cast<uint16_t*>(out->data);
+    KernelWorkspace buf(n * sizeof(float));
+    float* row = buf.As<float>();
+    for (int64_t r = begin; r < end; ++r) {
+      conv.to_float(px + r * n, row, n);
+      f(row, row);
+      conv.from_float(row, po + r * n, n);
+    }
+  });
+}
+
+}  // namespace
+
+void Softmax(const NDArray& x, const NDArray& out) {
+  const int64_t n = CheckRowOperands(x, out, "softmax");
+  if (n == 0 || NumElements(x.Shape()) == 0) return;
+  FSoftmaxRow frow = GetNormalizationKernels(GetSIMDLevel())->softmax;
+  ForEachRow(x, out, n, [&](const float* in, float* res) { frow(in, res, n); });
+}
+
+void LayerNorm(const NDArray& x, const NDArray& gamma, const NDArray& beta, double eps,
+               const NDArray& out) {
+  const int64_t n = CheckRowOperands(x, out, "layer_norm");
+  CheckOperand(gamma, "layer_norm", "gamma");
+  CheckOperand(beta, "layer_norm", "beta");
+  CheckSameDType(gamma, beta, "layer_norm");
+  const std::vector<int64_t> param_shape{n};
+  if (gamma.Shape() != param_shape || beta.Shape() != param_shape) {
+    throw Error("layer_norm: gamma and beta have shapes " + ShapeToString(gamma.Shape()) +
+                " and " + ShapeToString(beta.Shape()) + ", expect " +
+                ShapeToString(param_shape));
+  }
+  const bool param_float32 = IsFloat32(gamma->dtype);
+  if (!param_float32 && (gamma->dtype.code != x->dtype.code ||
+                         gamma->dtype.bits != x->dtype.bits || gamma->dtype.lanes != 1)) {
+    throw Error("layer_norm: gamma and beta should be float32 or of the data type of x");
+  }
+  if (n == 0 || NumElements(x.Shape()) == 0) return;
+
+  // 16-bit parameters are widened once for all the rows.
+  KernelWorkspace params(param_float32 ? 0 : 2 * n * sizeof(float));
+  const float* pgamma = static_cast<const float*>(gamma->data);
+  const float* pbeta = static_cast<const float*>(beta->data);
+  if (!param_float32) {
+    HalfConverter conv = GetHalfConverter(gamma->dtype);
+    float* widened = params.As<float>();
+    conv.to_float(static_cast<const uint16_t*>(gamma->data), widened, n);
+    conv.to_float(static_cast<const uint16_t*>(beta->data), widened + n, n);
+    pgamma = widened;
+    pbeta = widened + n;
+  }
+  FLayerNormRow frow = GetNormalizationKernels(GetSIMDLevel())->layer_norm;
+  const float feps = static_cast<float>(eps);
+  ForEachRow(x, out, n,
+             [&](const float* in, float* res) { frow(in, pgamma, pbeta, feps, res, n); });
+}
+
+CVM_REGISTER_GLOBAL("kernel.softmax").set_body_typed([](NDArray x, NDArray out) {
+  Softmax(x, out);
+});
+
+CVM_REGISTER_GLOBAL("kernel.layer_norm")
+    .set_body_typed([](NDArray x, NDArray gamma, NDArray beta, NDArray out, double eps) {
+      LayerNorm(x, gamma, beta, eps, out);
+    });
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,56 @@
+//
+// Created by WangJingYu on 2021/7/26.
+//
+
+/*!
+ * \file kernels/normalization.h
+ * \brief Softmax and layer normalization over the last axis, the normalizations of
+ *  transformer models.
+ *
+ *  Each one runs as a fused row kernel: a row is read twice, once for its statistics and
+ *  once to write the result, instead of the five to eight passes over the whole tensor of
+ *  the equivalent elementwise and reduction operators. float32 rows run the kernels of the
+ *  SIMD level picked at run time, float16 and bfloat16 rows are converted to float32 and
+ *  back around them. Inputs of at least kParallelNormalizationMinElems elements are split
+ *  over the thread pool by rows.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_H_
+#define CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include "normalization_kernels.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The smallest input split over the thread pool, in elements. */
+constexpr int64_t kParallelNormalizationMinElems = 1 << 15;
+
+/*!
+ * \brief out = e^x / sum(e^x) over the last axis.
+ * \param x The input, float32, float16 or bfloat16, at least one dimension.
+ * \param out The result, same data type and shape as x, may be x.
+ *  A NaN in a row makes the whole row NaN.
+ */
+void Softmax(const NDArray& x, const NDArray& out);
+
+/*!
+ * \brief out = (x - mean) / sqrt(var + eps) * gamma + beta, the mean and the biased
+ *  variance taken over the last axis.
+ * \param x The input, float32, float16 or bfloat16, at least one dimension.
+ * \param gamma The scale, shape (n,) for a last axis of extent n, float32 or the data
+ *  type of x.
+ * \param beta The shift, same shape and data type as gamma.
+ * \param eps Added to the variance.
+ * \param out The result, same data type and shape as x, may be x.
+ */
+void LayerNorm(const NDArray& x, const NDArray& gamma, const NDArray& beta, double eps,
+               const NDArray& out);
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_H_
@@ -0,0 +1,182 @@
+//
+// Created by WangJingYu on 2021/7/26.
+//
+
+/*!
+ * \file kernels/normalization_impl.h
+ * \brief The templates behind NormalizationKernels, instantiated once per instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_IMPL_H_
+#define CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_IMPL_H_
+
+#include <cfloat>
+
+#include "normalization_kernels.h"
+#include "simd_math.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+/*! \brief The vectors of a softmax chunk at least, the chunk is in L1 for its second read. */
+constexpr int64_t kSoftmaxChunkVecs = 8;
+
+/*! \brief The most chunks of a softmax row, longer rows take longer chunks. */
+constexpr int64_t kSoftmaxMaxChunks = 64;
+
+inline void SoftmaxRow(const float* x, float* out, int64_t n) {
+  using V = VecF32;
+  using S = ScalarF32;
+  constexpr int L = V::kLanes;
+  const int64_t nv = n / L * L;
+  const int64_t chunk = ScalarMax(kSoftmaxChunkVecs, (nv / L + kSoftmaxMaxChunks - 1) /
+                                                         kSoftmaxMaxChunks) * L;
+  // per lane: the running maximum m and the sum s of e^(x - m). The chunks write
+  // e^(x - m) with m as of the chunk, the second pass rescales them to the final one.
+  float chunk_max[kSoftmaxMaxChunks * L];
+  V m = V::Set1(-FLT_MAX);
+  V s = V::Set1(0.0f);
+  for (int64_t i = 0, c = 0; i < nv; i += chunk, ++c) {
+    const int64_t end = ScalarMin(i + chunk, nv);
+    V cmax = V::Load(x + i);
+    for (int64_t j = i + L; j < end; j += L) cmax = V::Max(cmax, V::Load(x + j));
+    V m_new = V::Max(m, cmax);
+    V s0 = s * Exp(m - m_new);
+    V s1 = V::Set1(0.0f);
+    int64_t j = i;
+    // a NaN of x reaches the sum through Exp, whatever the maximum made of it.
+    for (; j + 2 * L <= end; j += 2 * L) {
+      V e0 = Exp(V::Load(x + j) - m_new);
+      V e1 = Exp(V::Load(x + j + L) - m_new);
+      e0.Store(out + j);
+      e1.Store(out + j + L);
+      s0 = s0 + e0;
+      s1 = s1 + e1;
+    }
+    if (j < end) {
+      V e0 = Exp(V::Load(x + j) - m_new);
+      e0.Store(out + j);
+      s0 = s0 + e0;
+    }
+    m_new.Store(chunk_max + c * L);
+    s = s0 + s1;
+    m = m_new;
+  }
+  float row_max = x[0];
+  float row_sum = 0.0f;
+  if (nv != 0) {
+    row_max = V::ReduceMax(m);
+    // the lane sums rescaled to the maximum of the row.
+    row_sum = V::ReduceAdd(s * Exp(m - V::Set1(row_max)));
+  }
+  for (int64_t i = nv; i < n; ++i) {
+    if (x[i] > row_max) {
+      row_sum = row_sum * Exp(S::Set1(row_max - x[i])).v;
+      row_max = x[i];
+    }
+    row_sum += Exp(S::Set1(x[i] - row_max)).v;
+  }
+
+  const V vmax = V::Set1(row_max);
+  const V vinv = V::Set1(1.0f / row_sum);
+  for (int64_t i = 0, c = 0; i < nv; i += chunk, ++c) {
+    const int64_t end = ScalarMin(i + chunk, nv);
+    const V scale = Exp(V::Load(chunk_max + c * L) - vmax) * vinv;
+    int64_t j = i;
+    for (; j + 2 * L <= end; j += 2 * L) {
+      (V::Load(out + j) * scale).Store(out + j);
+      (V::Load(out + j + L) * scale).Store(out + j + L);
+    }
+    if (j < end) (V::Load(out + j) * scale).Store(out + j);
+  }
+  for (int64_t i = nv; i < n; ++i) {
+    (Exp(S::Load(x + i) - S::Set1(row_max)) * S::Set1(1.0f / row_sum)).Store(out + i);
+  }
+}
+
+/*! \brief The count, the mean and the sum of squared deviations of some values. */
+struct WelfordStat {
+  float count{0.0f};
+  float mean{0.0f};
+  float m2{0.0f};
+
+  void Add(float x) {
+    count += 1.0f;
+    float delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+  }
+};
+
+inline void LayerNormRow(const float* x, const float* gamma, const float* beta, float eps,
+                         float* out, int64_t n) {
+  using V = VecF32;
+  constexpr int L = V::kLanes;
+  // the statistics of x - x[0], the updates stay as precise for rows far from 0.
+  const float shift = x[0];
+  const V vshift = V::Set1(shift);
+  // two chains of lane statistics over the even and the odd vectors hide the latencies.
+  V mean0 = V::Set1(0.0f), m2_0 = V::Set1(0.0f);
+  V mean1 = V::Set1(0.0f), m2_1 = V::Set1(0.0f);
+  int64_t i = 0;
+  float count = 0.0f;
+  for (; i + 2 * L <= n; i += 2 * L) {
+    count += 1.0f;
+    V r = V::Set1(1.0f / count);
+    V x0 = V::Load(x + i) - vshift;
+    V x1 = V::Load(x + i + L) - vshift;
+    V d0 = x0 - mean0;
+    V d1 = x1 - mean1;
+    mean0 = V::FMA(d0, r, mean0);
+    mean1 = V::FMA(d1, r, mean1);
+    m2_0 = V::FMA(d0, x0 - mean0, m2_0);
+    m2_1 = V::FMA(d1, x1 - mean1, m2_1);
+  }
+  WelfordStat stat;
+  if (count > 0.0f) {
+    // every lane of both chains has count values: the mean is the mean of their means and
+    // m2 adds count times the squared deviations of the means.
+    V mean = (mean0 + mean1) * V::Set1(0.5f);
+    V m2 = m2_0 + m2_1 + (mean0 - mean) * (mean0 - mean) * V::Set1(count) +
+           (mean1 - mean) * (mean1 - mean) * V::Set1(count);
+    stat.count = 2.0f * L * count;
+    stat.mean = V::ReduceAdd(mean) / L;
+    V dev = mean - V::Set1(stat.mean);
+    stat.m2 = V::ReduceAdd(V::FMA(dev * dev, V::Set1(2.0f * count), m2));
+  }
+  for (int64_t j = i; j < n; ++j) stat.Add(x[j] - shift);
+
+  // the builtin rather than std::sqrt, which is an inline function of <cmath>.
+  const float rstd = 1.0f / __builtin_sqrtf(stat.m2 / stat.count + eps);
+  // x - shift - mean before the scaling, folding them in one FMA would lose the digits of
+  // rows far from 0.
+  const V vmean = V::Set1(stat.mean);
+  const V vrstd = V::Set1(rstd);
+  int64_t j = 0;
+  for (; j + 2 * L <= n; j += 2 * L) {
+    V y0 = ((V::Load(x + j) - vshift) - vmean) * vrstd;
+    V y1 = ((V::Load(x + j + L) - vshift) - vmean) * vrstd;
+    V::FMA(y0, V::Load(gamma + j), V::Load(beta + j)).Store(out + j);
+    V::FMA(y1, V::Load(gamma + j + L), V::Load(beta + j + L)).Store(out + j + L);
+  }
+  for (; j + L <= n; j += L) {
+    V y = ((V::Load(x + j) - vshift) - vmean) * vrstd;
+    V::FMA(y, V::Load(gamma + j), V::Load(beta + j)).Store(out + j);
+  }
+  for (; j < n; ++j) out[j] = ((x[j] - shift) - stat.mean) * rstd * gamma[j] + beta[j];
+}
+
+inline NormalizationKernels MakeNormalizationKernels() {
+  NormalizationKernels k;
+  k.softmax = SoftmaxRow;
+  k.layer_norm = LayerNormRow;
+  return k;
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_IMPL_H_
@@ -0,0 +1,57 @@
+//
+// Created by WangJingYu on 2021/7/26.
+//
+
+/*!
+ * \file kernels/normalization_kernels.h
+ * \brief The float32 row kernels of softmax and layer normalization, one table per
+ *  instruction set.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_KERNELS_H_
+#define CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_KERNELS_H_
+
+#include <cstdint>
+
+#include "simd.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*!
+ * \brief out = softmax(x[0, n)), n > 0, out may be x.
+ *  The first pass keeps the running maximum and the sum of the exponentials rescaled to
+ *  it, the online softmax, and writes the exponentials of each chunk of the row relative
+ *  to the maximum so far. The second pass scales every chunk to the final maximum and sum.
+ */
+typedef void (*FSoftmaxRow)(const float* x, float* out, int64_t n);
+
+/*!
+ * \brief out = (x - mean) / sqrt(var + eps) * gamma + beta over x[0, n), n > 0, out may be x.
+ *  The first pass computes the mean and the variance with Welford's updates, the second
+ *  one normalizes.
+ */
+typedef void (*FLayerNormRow)(const float* x, const float* gamma, const float* beta, float eps,
+                              float* out, int64_t n);
+
+/*! \brief The row kernels built for one instruction set. */
+struct NormalizationKernels {
+  FSoftmaxRow softmax;
+  FLayerNormRow layer_norm;
+};
+
+/*! \return The kernels of a level, the best compiled level not above it. */
+const NormalizationKernels* GetNormalizationKernels(SIMDLevel level);
+
+const NormalizationKernels* GetNormalizationKernelsScalar();
+#if CVM_KERNELS_X86
+const NormalizationKernels* GetNormalizationKernelsSSE42();
+const NormalizationKernels* GetNormalizationKernelsAVX2();
+const NormalizationKernels* GetNormalizationKernelsAVX512();
+#endif
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_NORMALIZATION_KERNELS_H_
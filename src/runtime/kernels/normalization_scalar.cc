@@ -0,0 +1,20 @@
+//
+// Created by WangJingYu on 2021/7/26.
+//
+
+// Built with the default flags of the target, the fallback of every other level.
+#define CVM_SIMD_NAMESPACE scalar
+#include "normalization_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const NormalizationKernels* GetNormalizationKernelsScalar() {
+  static const NormalizationKernels kernels = scalar::MakeNormalizationKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
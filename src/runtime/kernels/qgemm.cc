@@ -0,0 +1,217 @@
+//
+// Created by WangJingYu on 2021/7/21.
+//
+
+#include "qgemm.h"
+
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "kernel_utils.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const QGemmKernels* GetQGemmKernels(SIMDLevel level) {
+#if CVM_KERNELS_X86
+  if (level == SIMDLevel::kAVX512 && HasAVX512VNNI()) return GetQGemmKernelsAVX512VNNI();
+  if (level >= SIMDLevel::kAVX2) return GetQGemmKernelsAVX2();
+#endif
+  return GetQGemmKernelsScalar();
+}
+
+namespace {
+
+/*! \brief Products of fewer multiply-adds run on the calling thread. */
+constexpr int64_t kQGemmParallelMinOps = 1 << 20;
+
+/*! \brief Pack the m x k rows of A into micro-panels of mr rows, kg x mr x 4 bytes. */
+void PackA(const QGemmKernels* kernels, const int8_t* a, int64_t lda, int64_t m, int64_t k,
+           int8_t* out) {
+  const int mr = kernels->mr;
+  const int64_t kg = (k + 3) / 4;
+  // a ^ 0x80 is the uint8 a + 128.
+  const int8_t flip = kernels->shift_a ? static_cast<int8_t>(0x80) : 0;
+  for (int64_t i0 = 0; i0 < m; i0 += mr) {
+    int rows = static_cast<int>(std::min<int64_t>(mr, m - i0));
+    for (int r = 0; r < rows; ++r) {
+      const int8_t* src = a + (i0 + r) * lda;
+      for (int64_t p = 0; p < k; ++p) out[(p / 4 * mr + r) * 4 + p % 4] = src[p] ^ flip;
+      for (int64_t p = k; p < kg * 4; ++p) out[(p / 4 * mr + r) * 4 + p % 4] = 0;
+    }
+    out += kg * mr * 4;
+  }
+}
+
+void QGemmImpl(int64_t m, const int8_t* a, int64_t lda, const QGemmPackedB& b,
+               const QGemmParams& params, void* c, int64_t ldc, bool int8_out) {
+  if (m <= 0 || b.n() <= 0) return;
+  if (int8_out && params.scale == nullptr) throw Error("QGemm: int8 output needs the scales");
+  const QGemmKernels* kernels = b.kernels();
+  const int mr = kernels->mr, nr = kernels->nr;
+  const int64_t n = b.n(), k = b.k(), kg = (k + 3) / 4;
+  const int64_t num_row_panels = (m + mr - 1) / mr;
+  const int64_t num_col_panels = (n + nr - 1) / nr;
+
+  // bias and zero point corrections per column, padded to the last panel.
+  KernelWorkspace offsets(num_col_panels * nr * sizeof(int32_t));
+  int32_t* offset = offsets.As<int32_t>();
+  const int32_t a_shift = params.a_zero_point + (kernels->shift_a ? 128 : 0);
+  for (int64_t j = 0; j < num_col_panels * nr; ++j) {
+    offset[j] = j < n ? (params.bias != nullptr ? params.bias[j] : 0) - a_shift * b.col_sums()[j]
+                      : 0;
+  }
+  int32_t lower;
+  if (int8_out) {
+    lower = params.relu ? std::max(params.c_zero_point, -128) : -128;
+  } else {
+    lower = params.relu ? 0 : std::numeric_limits<int32_t>::min();
+  }
+  const size_t elem_bytes = int8_out ? sizeof(int8_t) : sizeof(int32_t);
+
+  KernelWorkspace workspace(num_row_panels * kg * mr * 4);
+  int8_t* packed_a = workspace.As<int8_t>();
+  PackA(kernels, a, lda, m, k, packed_a);
+
+  // each task covers a range of row panels by a range of column panels.
+  const bool parallel = m * n * k >= kQGemmParallelMinOps && threading::NumThreads() > 1;
+  const int64_t num_threads = parallel ? threading::NumThreads() : 1;
+  const int64_t row_ways = std::min(num_row_panels, num_threads);
+  const int64_t col_ways = std::min(num_col_panels, (4 * num_threads + row_ways - 1) / row_ways);
+  const int64_t rows_per_way = (num_row_panels + row_ways - 1) / row_ways;
+  const int64_t cols_per_way = (num_col_panels + col_ways - 1) / col_ways;
+  RunTasks(row_ways * col_ways, parallel, [&](int64_t task) {
+    const int64_t ip_begin = task / col_ways * rows_per_way;
+    const int64_t ip_end = std::min(num_row_panels, ip_begin + rows_per_way);
+    const int64_t jp_begin = task % col_ways * cols_per_way;
+    const int64_t jp_end = std::min(num_col_panels, jp_begin + cols_per_way);
+    for (int64_t jp = jp_begin; jp < jp_end; ++jp) {
+      const int64_t j = jp * nr;
+      const int8_t* panel = b.data() + jp * kg * nr * 4;
+      for (int64_t ip = ip_begin; ip < ip_end; ++ip) {
+        const int64_t i = ip * mr;
+        QGemmTileOutput out{offset + j,
+                            int8_out ? params.scale + j : nullptr,
+                            params.c_zero_point,
+                            lower,
+                            static_cast<char*>(c) + (i * ldc + j) * elem_bytes,
+                            ldc};
+        kernels->micro_kernel(kg, packed_a + ip * kg * mr * 4, panel, out,
+                              static_cast<int>(std::min<int64_t>(mr, m - i)),
+                              static_cast<int>(std::min<int64_t>(nr, n - j)));
+      }
+    }
+  });
+}
+
+void CheckDType(const NDArray& arr, DLDataType dtype, const char* name) {
+  if (arr->dtype.code != dtype.code || arr->dtype.bits != dtype.bits || arr->dtype.lanes != 1) {
+    std::ostringstream os;
+    os << "quantized_dense: " << name << " must be " << dtype << ", got " << arr->dtype;
+    throw Error(os.str());
+  }
+}
+
+}  // namespace
+
+QGemmPackedB::QGemmPackedB(const int8_t* b, int64_t ldb, int64_t n, int64_t k, bool transposed,
+                           SIMDLevel level)
+    : kernels_(GetQGemmKernels(level)), n_(n), k_(k) {
+  auto at = [&](int64_t p, int64_t j) { return transposed ? b[p * ldb + j] : b[j * ldb + p]; };
+  if (kernels_->symmetric_b) {
+    bool symmetric = true;
+    for (int64_t j = 0; j < n && symmetric; ++j) {
+      for (int64_t p = 0; p < k; ++p) symmetric &= at(p, j) != -128;
+    }
+    if (!symmetric) kernels_ = GetQGemmKernelsScalar();
+  }
+  const int nr = kernels_->nr;
+  const int64_t kg = (k + 3) / 4;
+  const int64_t num_panels = (n + nr - 1) / nr;
+  data_.assign(num_panels * kg * nr * 4, 0);
+  col_sums_.assign(n, 0);
+  for (int64_t j = 0; j < n; ++j) {
+    int8_t* panel = data_.data() + j / nr * kg * nr * 4;
+    int64_t col = j % nr;
+    for (int64_t p = 0; p < k; ++p) {
+      int8_t value = at(p, j);
+      panel[(p / 4 * nr + col) * 4 + p % 4] = value;
+      col_sums_[j] += value;
+    }
+  }
+}
+
+void QGemm(int64_t m, const int8_t* a, int64_t lda, const QGemmPackedB& b,
+           const QGemmParams& params, int8_t* c, int64_t ldc) {
+  QGemmImpl(m, a, lda, b, params, c, ldc, true);
+}
+
+void QGemm(int64_t m, const int8_t* a, int64_t lda, const QGemmPackedB& b,
+           const QGemmParams& params, int32_t* c, int64_t ldc) {
+  QGemmImpl(m, a, lda, b, params, c, ldc, false);
+}
+
+void QuantizedDense(const NDArray& data, const NDArray& weight, const NDArray& bias,
+                    const NDArray& scale, const NDArray& out, int32_t data_zero_point,
+                    int32_t out_zero_point, bool relu) {
+  const DLDataType i8{kDLInt, 8, 1}, i32{kDLInt, 32, 1}, f32{kDLFloat, 32, 1};
+  CheckOperand(data, "quantized_dense", "data");
+  CheckOperand(weight, "quantized_dense", "weight");
+  CheckOperand(out, "quantized_dense", "out");
+  CheckDType(data, i8, "data");
+  CheckDType(weight, i8, "weight");
+  CheckDType(out, scale.defined() ? i8 : i32, "out");
+  if (data->ndim != 2 || weight->ndim != 2 || weight->shape[1] != data->shape[1]) {
+    throw Error("quantized_dense: data " + ShapeToString(data.Shape()) + " and weight " +
+                ShapeToString(weight.Shape()) + " mismatch");
+  }
+  const int64_t m = data->shape[0], k = data->shape[1], n = weight->shape[0];
+  if (out.Shape() != std::vector<int64_t>{m, n}) {
+    throw Error("quantized_dense: out has shape " + ShapeToString(out.Shape()) + ", expect " +
+                ShapeToString({m, n}));
+  }
+  QGemmParams params;
+  params.a_zero_point = data_zero_point;
+  params.c_zero_point = out_zero_point;
+  params.relu = relu;
+  for (const NDArray* arr : {&bias, &scale}) {
+    if (!arr->defined()) continue;
+    const char* name = arr == &bias ? "bias" : "scale";
+    CheckOperand(*arr, "quantized_dense", name);
+    CheckDType(*arr, arr == &bias ? i32 : f32, name);
+    if (arr->Shape() != std::vector<int64_t>{n}) {
+      throw Error(std::string("quantized_dense: ") + name + " has shape " +
+                  ShapeToString(arr->Shape()) + ", expect " + ShapeToString({n}));
+    }
+  }
+  if (bias.defined()) params.bias = static_cast<const int32_t*>(bias->data);
+  if (data_zero_point < -128 || data_zero_point > 127 || out_zero_point < -128 ||
+      out_zero_point > 127) {
+    throw Error("quantized_dense: zero points must lie in [-128, 127]");
+  }
+
+  QGemmPackedB packed(static_cast<const int8_t*>(weight->data), k, n, k);
+  const int8_t* pdata = static_cast<const int8_t*>(data->data);
+  if (scale.defined()) {
+    params.scale = static_cast<const float*>(scale->data);
+    QGemm(m, pdata, k, packed, params, static_cast<int8_t*>(out->data), n);
+  } else {
+    QGemm(m, pdata, k, packed, params, static_cast<int32_t*>(out->data), n);
+  }
+}
+
+CVM_REGISTER_GLOBAL("kernel.quantized_dense")
+    .set_body_typed([](NDArray data, NDArray weight, NDArray bias, NDArray scale, NDArray out,
+                       int data_zero_point, int out_zero_point, bool relu) {
+      QuantizedDense(data, weight, bias, scale, out, data_zero_point, out_zero_point, relu);
+    });
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
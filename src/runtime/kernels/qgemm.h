@@ -0,0 +1,111 @@
+//
+// Created by WangJingYu on 2021/7/21.
+//
+
+/*!
+ * \file kernels/qgemm.h
+ * \brief Quantized int8 matrix multiplication with requantization.
+ *
+ *  The weights of a quantized dense layer are packed once, with the column
+ *  sums the zero point corrections need. A product then packs the rows of
+ *  A, runs the int8 micro-kernel of the weights over the tiles of C on the
+ *  thread pool and applies bias, per channel requantization and ReLU to the
+ *  int32 accumulators before they leave the registers.
+ *
+ *  Values follow the affine scheme real = scale * (q - zero_point), with
+ *  symmetric per channel weights. The accumulation is exact for every int8
+ *  input on every level.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_QGEMM_H_
+#define CVM_SRC_RUNTIME_KERNELS_QGEMM_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <vector>
+
+#include "qgemm_kernels.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The quantization of an int8 product C = A * B. */
+struct QGemmParams {
+  /*! \brief the zero point of A, subtracted from every value of A */
+  int32_t a_zero_point{0};
+  /*! \brief n values added to the int32 accumulators, or null */
+  const int32_t* bias{nullptr};
+  /*!
+   * \brief n multipliers from the accumulators to the int8 output,
+   *  a_scale * b_scale[j] / c_scale, required for int8 output
+   */
+  const float* scale{nullptr};
+  /*! \brief the zero point of the int8 output */
+  int32_t c_zero_point{0};
+  /*! \brief clamp the output at the zero point, at 0 for int32 output */
+  bool relu{false};
+};
+
+/*! \brief An int8 B matrix packed for the kernels of one SIMD level. */
+class QGemmPackedB {
+ public:
+  /*!
+   * \brief Pack B.
+   * \param b The data of B, n x k, the layout of dense weights, or k x n when transposed.
+   * \param ldb The row stride of b.
+   * \param n The columns of the product.
+   * \param k The depth of the product.
+   * \param transposed Whether b is stored k x n.
+   * \param level The level of the kernels to pack for. Weights holding -128 are packed
+   *  for the scalar kernel when the kernel of the level needs symmetric weights.
+   */
+  QGemmPackedB(const int8_t* b, int64_t ldb, int64_t n, int64_t k, bool transposed = false,
+               SIMDLevel level = GetSIMDLevel());
+
+  int64_t n() const { return n_; }
+  int64_t k() const { return k_; }
+  const QGemmKernels* kernels() const { return kernels_; }
+  /*! \brief The micro-panels, kg x nr x 4 bytes each. */
+  const int8_t* data() const { return data_.data(); }
+  /*! \brief The sums over the depth of each column. */
+  const std::vector<int32_t>& col_sums() const { return col_sums_; }
+
+ private:
+  const QGemmKernels* kernels_;
+  int64_t n_;
+  int64_t k_;
+  std::vector<int8_t> data_;
+  std::vector<int32_t> col_sums_;
+};
+
+/*!
+ * \brief C = requantize(A * B), A is m x k int8 with row stride lda, C is m x n int8.
+ *  params.scale is required.
+ */
+void QGemm(int64_t m, const int8_t* a, int64_t lda, const QGemmPackedB& b,
+           const QGemmParams& params, int8_t* c, int64_t ldc);
+
+/*! \brief C = A * B + bias, int32, params.scale and params.c_zero_point are ignored. */
+void QGemm(int64_t m, const int8_t* a, int64_t lda, const QGemmPackedB& b,
+           const QGemmParams& params, int32_t* c, int64_t ldc);
+
+/*!
+ * \brief A quantized dense layer over NDArrays, weights packed per call.
+ * \param data The int8 input, (batch, in).
+ * \param weight The int8 weights, (out, in), symmetric.
+ * \param bias The int32 bias, (out), or undefined.
+ * \param scale The float32 requantization multipliers, (out), or undefined for int32 output.
+ * \param out The result, (batch, out), int8 with a scale, int32 without.
+ * \param data_zero_point The zero point of data.
+ * \param out_zero_point The zero point of an int8 out.
+ * \param relu Whether to clamp the output at its zero point.
+ */
+void QuantizedDense(const NDArray& data, const NDArray& weight, const NDArray& bias,
+                    const NDArray& scale, const NDArray& out, int32_t data_zero_point,
+                    int32_t out_zero_point, bool relu);
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_QGEMM_H_
@@ -0,0 +1,129 @@
+//
+// Created by WangJingYu on 2021/7/21.
+//
+
+// Built with the avx2 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#include <immintrin.h>
+
+#include <cstring>
+#include <utility>
+
+#define CVM_SIMD_NAMESPACE avx2
+#include "qgemm_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace avx2 {
+
+constexpr int kQGemmMR = 4;
+constexpr int kQGemmNR = 16;
+
+/*!
+ * \brief ROWS rows of a 4 x 16 tile in 2 * ROWS registers of 8 int32.
+ *  vpmaddubsw multiplies unsigned by signed bytes and adds pairs with int16
+ *  saturation. |a| times b with the sign of a keeps every product within
+ *  128 * 127, so the pairs never saturate, then vpmaddwd adds the pairs to
+ *  int32 lanes.
+ */
+template <int ROWS>
+void QGemmTile(int64_t kg, const int8_t* a, const int8_t* b, const QGemmTileOutput& out, int m,
+               int n) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  __m256i acc[ROWS][2];
+#pragma GCC unroll 4
+  for (int i = 0; i < ROWS; ++i) acc[i][0] = acc[i][1] = _mm256_setzero_si256();
+  for (int64_t g = 0; g < kg; ++g) {
+    __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 32));
+#pragma GCC unroll 4
+    for (int i = 0; i < ROWS; ++i) {
+      int32_t a4;
+      memcpy(&a4, a + i * 4, sizeof(a4));
+      __m256i av = _mm256_set1_epi32(a4);
+      __m256i ua = _mm256_abs_epi8(av);
+      __m256i p0 = _mm256_maddubs_epi16(ua, _mm256_sign_epi8(b0, av));
+      __m256i p1 = _mm256_maddubs_epi16(ua, _mm256_sign_epi8(b1, av));
+      acc[i][0] = _mm256_add_epi32(acc[i][0], _mm256_madd_epi16(p0, ones));
+      acc[i][1] = _mm256_add_epi32(acc[i][1], _mm256_madd_epi16(p1, ones));
+    }
+    a += kQGemmMR * 4;
+    b += kQGemmNR * 4;
+  }
+
+  if (n < kQGemmNR) {
+    alignas(32) int32_t tile[ROWS][kQGemmNR];
+    for (int i = 0; i < ROWS; ++i) {
+      _mm256_store_si256(reinterpret_cast<__m256i*>(tile[i]), acc[i][0]);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(tile[i] + 8), acc[i][1]);
+    }
+    return QGemmStoreTile(&tile[0][0], kQGemmNR, out, m, n);
+  }
+  const __m256i offset0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out.offset));
+  const __m256i offset1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out.offset + 8));
+  const __m256i lower = _mm256_set1_epi32(out.lower);
+  if (out.scale == nullptr) {
+#pragma GCC unroll 4
+    for (int i = 0; i < ROWS; ++i) {
+      auto* dst = static_cast<int32_t*>(out.c) + i * out.ldc;
+      __m256i v0 = _mm256_max_epi32(_mm256_add_epi32(acc[i][0], offset0), lower);
+      __m256i v1 = _mm256_max_epi32(_mm256_add_epi32(acc[i][1], offset1), lower);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v0);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 8), v1);
+    }
+    return;
+  }
+  const __m256 scale0 = _mm256_loadu_ps(out.scale);
+  const __m256 scale1 = _mm256_loadu_ps(out.scale + 8);
+  const __m256 low = _mm256_set1_ps(-kQGemmScaledBound);
+  const __m256 high = _mm256_set1_ps(kQGemmScaledBound);
+  const __m256i zero_point = _mm256_set1_epi32(out.zero_point);
+  const __m256i upper = _mm256_set1_epi32(127);
+  auto requantize = [&](__m256i v, __m256i offset, __m256 scale) {
+    __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(v, offset)), scale);
+    f = _mm256_min_ps(_mm256_max_ps(f, low), high);
+    __m256i q = _mm256_add_epi32(_mm256_cvtps_epi32(f), zero_point);
+    return _mm256_min_epi32(_mm256_max_epi32(q, lower), upper);
+  };
+#pragma GCC unroll 4
+  for (int i = 0; i < ROWS; ++i) {
+    __m256i q0 = requantize(acc[i][0], offset0, scale0);
+    __m256i q1 = requantize(acc[i][1], offset1, scale1);
+    // packs works within 128-bit lanes, restore the order of the columns.
+    __m256i w = _mm256_permute4x64_epi64(_mm256_packs_epi32(q0, q1), 0xD8);
+    __m128i bytes = _mm_packs_epi16(_mm256_castsi256_si128(w), _mm256_extracti128_si256(w, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<int8_t*>(out.c) + i * out.ldc),
+                     bytes);
+  }
+}
+
+template <int... R>
+void QGemmMicroKernel(int64_t kg, const int8_t* a, const int8_t* b, const QGemmTileOutput& out,
+                      int m, int n, std::integer_sequence<int, R...>) {
+  static const FQGemmMicroKernel tiles[] = {QGemmTile<R + 1>...};
+  tiles[m - 1](kg, a, b, out, m, n);
+}
+
+void QGemmMicroKernel(int64_t kg, const int8_t* a, const int8_t* b, const QGemmTileOutput& out,
+                      int m, int n) {
+  if (m == kQGemmMR) return QGemmTile<kQGemmMR>(kg, a, b, out, m, n);
+  QGemmMicroKernel(kg, a, b, out, m, n, std::make_integer_sequence<int, kQGemmMR - 1>());
+}
+
+}  // namespace avx2
+
+const QGemmKernels* GetQGemmKernelsAVX2() {
+  static const QGemmKernels kernels{avx2::kQGemmMR, avx2::kQGemmNR, false, true,
+                                    avx2::QGemmMicroKernel};
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
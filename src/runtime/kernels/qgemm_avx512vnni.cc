@@ -0,0 +1,119 @@
+//
+// Created by WangJingYu on 2021/7/21.
+//
+
+// Built with the avx512 flags plus VNNI, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#include <immintrin.h>
+
+#include <cstring>
+#include <utility>
+
+#define CVM_SIMD_NAMESPACE avx512vnni
+#include "qgemm_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace avx512vnni {
+
+constexpr int kQGemmMR = 12;
+constexpr int kQGemmNR = 32;
+
+/*!
+ * \brief ROWS rows of a 12 x 32 tile in 2 * ROWS registers of 16 int32.
+ *  vpdpbusd adds the 4 products of unsigned by signed bytes of each lane to
+ *  the int32 accumulator without saturation, the packed A holds a + 128.
+ *  Partial tiles are written with masks.
+ */
+template <int ROWS>
+void QGemmTile(int64_t kg, const int8_t* a, const int8_t* b, const QGemmTileOutput& out, int /*m*/,
+               int n) {
+  __m512i acc[ROWS][2];
+#pragma GCC unroll 12
+  for (int i = 0; i < ROWS; ++i) acc[i][0] = acc[i][1] = _mm512_setzero_si512();
+  for (int64_t g = 0; g < kg; ++g) {
+    __m512i b0 = _mm512_loadu_si512(b);
+    __m512i b1 = _mm512_loadu_si512(b + 64);
+#pragma GCC unroll 12
+    for (int i = 0; i < ROWS; ++i) {
+      int32_t a4;
+      memcpy(&a4, a + i * 4, sizeof(a4));
+      __m512i av = _mm512_set1_epi32(a4);
+      acc[i][0] = _mm512_dpbusd_epi32(acc[i][0], av, b0);
+      acc[i][1] = _mm512_dpbusd_epi32(acc[i][1], av, b1);
+    }
+    a += kQGemmMR * 4;
+    b += kQGemmNR * 4;
+  }
+
+  // the offsets are padded to the full tile, the scales are not.
+  auto mask = [](int cols) {
+    if (cols >= 16) return __mmask16(0xFFFF);
+    return static_cast<__mmask16>((1U << ScalarMax(cols, 0)) - 1);
+  };
+  const __mmask16 mask0 = mask(n);
+  const __mmask16 mask1 = mask(n - 16);
+  const __m512i offset0 = _mm512_loadu_si512(out.offset);
+  const __m512i offset1 = _mm512_loadu_si512(out.offset + 16);
+  const __m512i lower = _mm512_set1_epi32(out.lower);
+  if (out.scale == nullptr) {
+#pragma GCC unroll 12
+    for (int i = 0; i < ROWS; ++i) {
+      auto* dst = static_cast<int32_t*>(out.c) + i * out.ldc;
+      __m512i v0 = _mm512_max_epi32(_mm512_add_epi32(acc[i][0], offset0), lower);
+      __m512i v1 = _mm512_max_epi32(_mm512_add_epi32(acc[i][1], offset1), lower);
+      _mm512_mask_storeu_epi32(dst, mask0, v0);
+      _mm512_mask_storeu_epi32(dst + 16, mask1, v1);
+    }
+    return;
+  }
+  const __m512 scale0 = _mm512_maskz_loadu_ps(mask0, out.scale);
+  const __m512 scale1 = _mm512_maskz_loadu_ps(mask1, out.scale + 16);
+  const __m512 low = _mm512_set1_ps(-kQGemmScaledBound);
+  const __m512 high = _mm512_set1_ps(kQGemmScaledBound);
+  const __m512i zero_point = _mm512_set1_epi32(out.zero_point);
+  const __m512i upper = _mm512_set1_epi32(127);
+  auto requantize = [&](__m512i v, __m512i offset, __m512 scale) {
+    __m512 f = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_add_epi32(v, offset)), scale);
+    f = _mm512_min_ps(_mm512_max_ps(f, low), high);
+    __m512i q = _mm512_add_epi32(_mm512_cvtps_epi32(f), zero_point);
+    return _mm512_cvtepi32_epi8(_mm512_min_epi32(_mm512_max_epi32(q, lower), upper));
+  };
+#pragma GCC unroll 12
+  for (int i = 0; i < ROWS; ++i) {
+    int8_t* dst = static_cast<int8_t*>(out.c) + i * out.ldc;
+    _mm_mask_storeu_epi8(dst, mask0, requantize(acc[i][0], offset0, scale0));
+    _mm_mask_storeu_epi8(dst + 16, mask1, requantize(acc[i][1], offset1, scale1));
+  }
+}
+
+template <int... R>
+void QGemmMicroKernel(int64_t kg, const int8_t* a, const int8_t* b, const QGemmTileOutput& out,
+                      int m, int n, std::integer_sequence<int, R...>) {
+  static const FQGemmMicroKernel tiles[] = {QGemmTile<R + 1>...};
+  tiles[m - 1](kg, a, b, out, m, n);
+}
+
+void QGemmMicroKernel(int64_t kg, const int8_t* a, const int8_t* b, const QGemmTileOutput& out,
+                      int m, int n) {
+  if (m == kQGemmMR) return QGemmTile<kQGemmMR>(kg, a, b, out, m, n);
+  QGemmMicroKernel(kg, a, b, out, m, n, std::make_integer_sequence<int, kQGemmMR - 1>());
+}
+
+}  // namespace avx512vnni
+
+const QGemmKernels* GetQGemmKernelsAVX512VNNI() {
+  static const QGemmKernels kernels{avx512vnni::kQGemmMR, avx512vnni::kQGemmNR, true, false,
+                                    avx512vnni::QGemmMicroKernel};
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
@@ -0,0 +1,53 @@
+//
+// Created by WangJingYu on 2021/7/21.
+//
+
+/*!
+ * \file kernels/qgemm_impl.h
+ * \brief The scalar epilogue of the int8 micro-kernels, also the partial tiles of the
+ *  vector ones. Included by the per instruction set sources, see simd_vec.h.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_QGEMM_IMPL_H_
+#define CVM_SRC_RUNTIME_KERNELS_QGEMM_IMPL_H_
+
+#ifndef CVM_SIMD_NAMESPACE
+#error "define CVM_SIMD_NAMESPACE before including qgemm_impl.h"
+#endif
+
+#include "qgemm_kernels.h"
+#include "simd_vec.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+/*! \brief Bounds of the scaled values, far enough for every int8 output to clamp the same. */
+constexpr float kQGemmScaledBound = 512.0f;
+
+/*! \brief Write an m x n tile of accumulators with row stride ld through the epilogue. */
+inline void QGemmStoreTile(const int32_t* acc, int ld, const QGemmTileOutput& out, int m,
+                           int n) {
+  for (int i = 0; i < m; ++i) {
+    for (int j = 0; j < n; ++j) {
+      int32_t v = acc[i * ld + j] + out.offset[j];
+      if (out.scale == nullptr) {
+        static_cast<int32_t*>(out.c)[i * out.ldc + j] = ScalarMax(v, out.lower);
+        continue;
+      }
+      float f = static_cast<float>(v) * out.scale[j];
+      f = ScalarMin(ScalarMax(f, -kQGemmScaledBound), kQGemmScaledBound);
+      // the builtin rather than std::nearbyint, which is an inline function of <cmath>.
+      int32_t q = static_cast<int32_t>(__builtin_nearbyintf(f)) + out.zero_point;
+      q = ScalarMin(ScalarMax(q, out.lower), 127);
+      static_cast<int8_t*>(out.c)[i * out.ldc + j] = static_cast<int8_t>(q);
+    }
+  }
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_QGEMM_IMPL_H_
@@ -0,0 +1,88 @@
+//
+// Created by WangJingYu on 2021/7/21.
+//
+
+/*!
+ * \file kernels/qgemm_kernels.h
+ * \brief The int8 GEMM micro-kernels, one per instruction set.
+ *
+ *  The kernels multiply int8 by int8 with exact int32 accumulation. Packed
+ *  panels hold the depth in groups of 4 values, the operand of one 32-bit
+ *  lane of vpmaddubsw + vpmaddwd or of vpdpbusd: A as kg x mr x 4 and B as
+ *  kg x nr x 4 bytes, with zeros past the depth.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_QGEMM_KERNELS_H_
+#define CVM_SRC_RUNTIME_KERNELS_QGEMM_KERNELS_H_
+
+#include <cstdint>
+
+#include "simd.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*!
+ * \brief The epilogue of a tile, the accumulator acc of column j becomes
+ *  - int8: clamp(round(float(acc + offset[j]) * scale[j]) + zero_point, lower, 127)
+ *  - int32: max(acc + offset[j], lower), when scale is null.
+ *  round() rounds half to even.
+ */
+struct QGemmTileOutput {
+  /*! \brief nr values, padded past the last column */
+  const int32_t* offset;
+  /*! \brief n values, or null for int32 output */
+  const float* scale;
+  int32_t zero_point;
+  int32_t lower;
+  /*! \brief the tile of C, row major */
+  void* c;
+  int64_t ldc;
+};
+
+/*!
+ * \brief C[0:m, 0:n] = epilogue(A * B) for one mr x nr tile.
+ * \param kg The depth of the product in groups of 4.
+ * \param a The packed A micro-panel.
+ * \param b The packed B micro-panel.
+ * \param out The epilogue and the destination.
+ * \param m The valid rows of the tile, at most mr.
+ * \param n The valid columns of the tile, at most nr.
+ */
+typedef void (*FQGemmMicroKernel)(int64_t kg, const int8_t* a, const int8_t* b,
+                                  const QGemmTileOutput& out, int m, int n);
+
+/*! \brief The micro-kernel of one instruction set and the packing it expects. */
+struct QGemmKernels {
+  int mr;
+  int nr;
+  /*!
+   * \brief Whether the packed A holds a + 128 as uint8, the unsigned operand of vpdpbusd.
+   *  The offsets of the epilogue compensate with 128 times the column sums of B.
+   */
+  bool shift_a;
+  /*!
+   * \brief Whether B must lie in [-127, 127]. The vpmaddubsw kernel multiplies |a| by
+   *  b with the sign of a, -128 has no negation in int8.
+   */
+  bool symmetric_b;
+  FQGemmMicroKernel micro_kernel;
+};
+
+/*!
+ * \return The kernel of a level: the scalar reference up to sse4.2, vpmaddubsw at avx2,
+ *  vpdpbusd at avx512 when the CPU has VNNI and vpmaddubsw otherwise.
+ */
+const QGemmKernels* GetQGemmKernels(SIMDLevel level);
+
+const QGemmKernels* GetQGemmKernelsScalar();
+#if CVM_KERNELS_X86
+const QGemmKernels* GetQGemmKernelsAVX2();
+const QGemmKernels* GetQGemmKernelsAVX512VNNI();
+#endif
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_QGEMM_KERNELS_H_
@@ -0,0 +1,42 @@
+//
+// Created by WangJingYu on 2021/7/21.
+//
+
+// The reference of the int8 kernels, built with the default flags of the target.
+#define CVM_SIMD_NAMESPACE scalar
+#include "qgemm_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace scalar {
+
+constexpr int kQGemmMR = 4;
+constexpr int kQGemmNR = 8;
+
+void QGemmMicroKernel(int64_t kg, const int8_t* a, const int8_t* b, const QGemmTileOutput& out,
+                      int m, int n) {
+  int32_t acc[kQGemmMR][kQGemmNR] = {};
+  for (int64_t g = 0; g < kg; ++g) {
+    for (int i = 0; i < m; ++i) {
+      for (int j = 0; j < kQGemmNR; ++j) {
+        for (int q = 0; q < 4; ++q) acc[i][j] += int32_t(a[i * 4 + q]) * int32_t(b[j * 4 + q]);
+      }
+    }
+    a += kQGemmMR * 4;
+    b += kQGemmNR * 4;
+  }
+  QGemmStoreTile(&acc[0][0], kQGemmNR, out, m, n);
+}
+
+}  // namespace scalar
+
+const QGemmKernels* GetQGemmKernelsScalar() {
+  static const QGemmKernels kernels{scalar::kQGemmMR, scalar::kQGemmNR, false, false,
+                                    scalar::QGemmMicroKernel};
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,370 @@
+//
+// Created by WangJingYu on 2021/7/24.
+//
+
+#include "reduce.h"
+
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "kernel_utils.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const ReduceKernels* GetReduceKernels(SIMDLevel level) {
+#if CVM_KERNELS_X86
+  switch (level) {
+    case SIMDLevel::kAVX512:
+      return GetReduceKernelsAVX512();
+    case SIMDLevel::kAVX2:
+      return GetReduceKernelsAVX2();
+    case SIMDLevel::kSSE42:
+      return GetReduceKernelsSSE42();
+    default:
+      break;
+  }
+#endif
+  return GetReduceKernelsScalar();
+}
+
+namespace {
+
+/*! \brief The accumulators of a column task, 4KB, in L1 while the rows stream by. */
+constexpr int64_t kColumnBlock = 1024;
+
+/*! \brief The most parts the reduced axis of a column pass is split into. */
+constexpr int64_t kMaxColumnSplits = 64;
+
+/*! \brief A reduction over the middle axis of an (outer, extent, inner) view. */
+struct ReducePass {
+  int64_t outer;
+  int64_t extent;
+  int64_t inner;
+};
+
+std::vector<bool> ReducedAxes(size_t ndim, const std::vector<int64_t>& axes) {
+  std::vector<bool> reduced(ndim, axes.empty());
+  for (int64_t axis : axes) {
+    int64_t index = axis < 0 ? axis + static_cast<int64_t>(ndim) : axis;
+    if (index < 0 || index >= static_cast<int64_t>(ndim)) {
+      throw Error("reduce: axis " + std::to_string(axis) + " is out of range for " +
+                  std::to_string(ndim) + " dimensions");
+    }
+    if (reduced[index]) throw Error("reduce: axis " + std::to_string(axis) + " is given twice");
+    reduced[index] = true;
+  }
+  return reduced;
+}
+
+/*!
+ * \brief The passes of a reduction, innermost first.
+ *  Extent 1 axes are dropped and adjacent axes merged when they are all reduced or all
+ *  kept, a pass reduces one group of merged axes.
+ */
+std::vector<ReducePass> PlanPasses(const std::vector<int64_t>& shape,
+                                   const std::vector<bool>& reduced) {
+  std::vector<std::pair<int64_t, bool>> groups;
+  for (size_t d = 0; d < shape.size(); ++d) {
+    if (shape[d] == 1) continue;
+    if (!groups.empty() && groups.back().second == reduced[d]) {
+      groups.back().first *= shape[d];
+    } else {
+      groups.emplace_back(shape[d], reduced[d]);
+    }
+  }
+  std::vector<ReducePass> passes;
+  int64_t inner = 1;
+  for (size_t g = groups.size(); g-- > 0;) {
+    if (!groups[g].second) {
+      inner *= groups[g].first;
+      continue;
+    }
+    int64_t outer = 1;
+    for (size_t j = 0; j < g; ++j) outer *= groups[j].first;
+    passes.push_back({outer, groups[g].first, inner});
+  }
+  return passes;
+}
+
+/*!
+ * \brief Call f(row, chunk) for the chunks of kReduceChunk values of every row, short
+ *  rows are grouped so that a task still covers about kReduceChunk values.
+ */
+template <typename F>
+void ForEachRowChunk(int64_t outer, int64_t extent, int64_t num_chunks, bool parallel,
+                     const F& f) {
+  const int64_t per_task = num_chunks == 1 ? std::max<int64_t>(1, kReduceChunk / extent) : 1;
+  const int64_t num_items = outer * num_chunks;
+  RunTasks((num_items + per_task - 1) / per_task, parallel, [&](int64_t task) {
+    int64_t end = std::min(num_items, (task + 1) * per_task);
+    for (int64_t item = task * per_task; item < end; ++item) {
+      f(item / num_chunks, item % num_chunks);
+    }
+  });
+}
+
+/*! \brief dst[o] = op(src[o, :]), the chunks of long rows combined in order. */
+void RowPass(const ReduceKernels* k, ReduceAccumKind kind, bool kahan, const float* src,
+             float* dst, const ReducePass& p, bool parallel) {
+  FReduceRow row = (kahan ? k->row_kahan : k->row)[kind];
+  const int64_t num_chunks = (p.extent + kReduceChunk - 1) / kReduceChunk;
+  KernelWorkspace partials(num_chunks > 1 ? p.outer * num_chunks * sizeof(float) : 0);
+  float* part = num_chunks > 1 ? partials.As<float>() : dst;
+  ForEachRowChunk(p.outer, p.extent, num_chunks, parallel, [&](int64_t o, int64_t chunk) {
+    int64_t begin = chunk * kReduceChunk;
+    part[o * num_chunks + chunk] =
+        row(src + o * p.extent + begin, std::min(kReduceChunk, p.extent - begin));
+  });
+  if (num_chunks == 1) return;
+  FReduceRow combine = (kahan ? k->row_kahan : k->row)[kind == kAccumSumSquares ? kAccumSum : kind];
+  for (int64_t o = 0; o < p.outer; ++o) dst[o] = combine(part + o * num_chunks, num_chunks);
+}
+
+/*!
+ * \brief dst[o, i] = op(src[o, :, i]), blocks of kColumnBlock accumulators.
+ *  When there are few outputs the reduced axis is split too, a split depends on the
+ *  shape only and the splits are combined in order.
+ */
+void ColumnPass(const ReduceKernels* k, ReduceAccumKind kind, bool kahan, const float* src,
+                float* dst, const ReducePass& p, bool parallel) {
+  FReduceColumn column = (kahan ? k->column_kahan : k->column)[kind];
+  const bool extremum = kind == kAccumMax || kind == kAccumMin;
+  const bool compensated = kahan && !extremum;
+  const int64_t plane = p.outer * p.inner;
+  int64_t num_splits = 1;
+  if (plane < kReduceChunk) {
+    num_splits = std::max<int64_t>(
+        1, std::min({kMaxColumnSplits, p.extent, plane * p.extent / kReduceChunk}));
+  }
+  const int64_t rows_per_split = (p.extent + num_splits - 1) / num_splits;
+  num_splits = (p.extent + rows_per_split - 1) / rows_per_split;
+  KernelWorkspace partials(num_splits > 1 ? num_splits * plane * sizeof(float) : 0);
+  float* part = num_splits > 1 ? partials.As<float>() : dst;
+
+  const int64_t num_blocks = (p.inner + kColumnBlock - 1) / kColumnBlock;
+  RunTasks(num_splits * p.outer * num_blocks, parallel, [&](int64_t task) {
+    const int64_t block = task % num_blocks, o = task / num_blocks % p.outer;
+    const int64_t split = task / num_blocks / p.outer;
+    const int64_t i0 = block * kColumnBlock, len = std::min(kColumnBlock, p.inner - i0);
+    int64_t r = split * rows_per_split;
+    const int64_t r_end = std::min(p.extent, r + rows_per_split);
+    const float* x = src + o * p.extent * p.inner + i0;
+    float* acc = part + split * plane + o * p.inner + i0;
+    float comp[kColumnBlock];
+    std::fill(comp, comp + len, 0.0f);
+    if (extremum) {
+      std::copy(x + r * p.inner, x + r * p.inner + len, acc);
+      ++r;
+    } else {
+      std::fill(acc, acc + len, 0.0f);
+    }
+    for (; r < r_end; ++r) column(x + r * p.inner, acc, comp, len);
+    if (compensated) {
+      for (int64_t i = 0; i < len; ++i) acc[i] -= comp[i];
+    }
+  });
+  if (num_splits == 1) return;
+  FReduceColumn combine =
+      (kahan ? k->column_kahan : k->column)[kind == kAccumSumSquares ? kAccumSum : kind];
+  KernelWorkspace comp(compensated ? plane * sizeof(float) : 0);
+  if (compensated) std::fill(comp.As<float>(), comp.As<float>() + plane, 0.0f);
+  std::copy(part, part + plane, dst);
+  for (int64_t s = 1; s < num_splits; ++s) combine(part + s * plane, dst, comp.As<float>(), plane);
+  if (compensated) {
+    for (int64_t i = 0; i < plane; ++i) dst[i] -= comp.As<float>()[i];
+  }
+}
+
+/*! \brief Whether the value at a comes before the value at b as the result of argmax. */
+inline bool ArgMaxBefore(float a, float b) { return b == b && (a > b || a != a); }
+
+/*! \brief dst[o, i] = argmax(src[o, :, i]) */
+void ArgMaxPass(const ReduceKernels* k, const float* src, int64_t* dst, const ReducePass& p,
+                bool parallel) {
+  if (p.inner == 1) {
+    const int64_t num_chunks = (p.extent + kReduceChunk - 1) / kReduceChunk;
+    KernelWorkspace partials(num_chunks > 1 ? p.outer * num_chunks * sizeof(int64_t) : 0);
+    int64_t* part = num_chunks > 1 ? partials.As<int64_t>() : dst;
+    ForEachRowChunk(p.outer, p.extent, num_chunks, parallel, [&](int64_t o, int64_t chunk) {
+      int64_t begin = chunk * kReduceChunk, len = std::min(kReduceChunk, p.extent - begin);
+      part[o * num_chunks + chunk] = begin + k->row_argmax(src + o * p.extent + begin, len);
+    });
+    if (num_chunks == 1) return;
+    for (int64_t o = 0; o < p.outer; ++o) {
+      const float* x = src + o * p.extent;
+      int64_t best = part[o * num_chunks];
+      for (int64_t chunk = 1; chunk < num_chunks; ++chunk) {
+        int64_t index = part[o * num_chunks + chunk];
+        if (ArgMaxBefore(x[index], x[best])) best = index;
+      }
+      dst[o] = best;
+    }
+    return;
+  }
+  const int64_t num_blocks = (p.inner + kColumnBlock - 1) / kColumnBlock;
+  RunTasks(p.outer * num_blocks, parallel, [&](int64_t task) {
+    const int64_t o = task / num_blocks, i0 = task % num_blocks * kColumnBlock;
+    const int64_t len = std::min(kColumnBlock, p.inner - i0);
+    const float* x = src + o * p.extent * p.inner + i0;
+    int64_t* index = dst + o * p.inner + i0;
+    float best[kColumnBlock];
+    std::copy(x, x + len, best);
+    std::fill(index, index + len, 0);
+    for (int64_t r = 1; r < p.extent; ++r) {
+      const float* row = x + r * p.inner;
+      for (int64_t i = 0; i < len; ++i) {
+        if (ArgMaxBefore(row[i], best[i])) {
+          best[i] = row[i];
+          index[i] = r;
+        }
+      }
+    }
+  });
+}
+
+bool IsFloat32(DLDataType dtype) {
+  return dtype.code == kDLFloat && dtype.bits == 32 && dtype.lanes == 1;
+}
+
+}  // namespace
+
+const char* ReduceOpName(ReduceOpKind op) {
+  static const char* names[kNumReduceOps] = {"sum", "mean", "max", "min", "argmax", "norm"};
+  if (op < 0 || op >= kNumReduceOps) throw Error("reduce: unknown reduction");
+  return names[op];
+}
+
+std::vector<int64_t> ReduceShape(const std::vector<int64_t>& shape,
+                                 const std::vector<int64_t>& axes, bool keepdims) {
+  std::vector<bool> reduced = ReducedAxes(shape.size(), axes);
+  std::vector<int64_t> out;
+  for (size_t d = 0; d < shape.size(); ++d) {
+    if (!reduced[d]) {
+      out.push_back(shape[d]);
+    } else if (keepdims) {
+      out.push_back(1);
+    }
+  }
+  return out;
+}
+
+void Reduce(ReduceOpKind op, const NDArray& x, const std::vector<int64_t>& axes, bool keepdims,
+            const NDArray& out, SumMethod method) {
+  const std::string name = ReduceOpName(op);
+  CheckOperand(x, name.c_str(), "x");
+  CheckOperand(out, name.c_str(), "out");
+  if (!IsFloat32(x->dtype)) throw Error(name + ": x must be float32");
+  if (op == kReduceArgMax) {
+    if (out->dtype.code != kDLInt || out->dtype.bits != 64 || out->dtype.lanes != 1) {
+      throw Error(name + ": out must be int64");
+    }
+    if (axes.size() > 1) throw Error(name + ": takes one axis or all of them");
+  } else if (!IsFloat32(out->dtype)) {
+    throw Error(name + ": out must be float32");
+  }
+  const std::vector<int64_t> shape = x.Shape();
+  const std::vector<int64_t> out_shape = ReduceShape(shape, axes, keepdims);
+  if (out.Shape() != out_shape) {
+    throw Error(name + ": out has shape " + ShapeToString(out.Shape()) + ", expect " +
+                ShapeToString(out_shape));
+  }
+  const int64_t num_elems = NumElements(shape), num_out = NumElements(out_shape);
+  if (num_out == 0) return;
+  if (num_elems == 0) {
+    if (op != kReduceSum && op != kReduceMean && op != kReduceNorm2) {
+      throw Error(name + ": the reduction has no element");
+    }
+    float* po = static_cast<float*>(out->data);
+    std::fill(po, po + num_out, op == kReduceMean ? NAN : 0.0f);
+    return;
+  }
+
+  const ReduceKernels* kernels = GetReduceKernels(GetSIMDLevel());
+  const bool threads = threading::NumThreads() > 1;
+  const float* px = static_cast<const float*>(x->data);
+  if (op == kReduceArgMax) {
+    ReducePass p{1, num_elems, 1};
+    if (!axes.empty()) {
+      const size_t axis = axes[0] < 0 ? axes[0] + shape.size() : axes[0];
+      for (size_t d = 0; d < axis; ++d) p.outer *= shape[d];
+      p.extent = shape[axis];
+      p.inner = num_elems / p.outer / p.extent;
+    }
+    ArgMaxPass(kernels, px, static_cast<int64_t*>(out->data), p,
+               threads && num_elems >= kParallelReduceMinElems);
+    return;
+  }
+
+  std::vector<ReducePass> passes = PlanPasses(shape, ReducedAxes(shape.size(), axes));
+  // nothing to reduce, every value still goes through the kernels.
+  if (passes.empty()) passes.push_back({num_elems, 1, 1});
+  ReduceAccumKind kind = op == kReduceMax     ? kAccumMax
+                         : op == kReduceMin   ? kAccumMin
+                         : op == kReduceNorm2 ? kAccumSumSquares
+                                              : kAccumSum;
+  const bool kahan = method == SumMethod::kKahan;
+  // the intermediate results alternate between two buffers, the last pass writes out.
+  auto result_bytes = [&](size_t i) {
+    return i + 1 < passes.size() ? passes[i].outer * passes[i].inner * sizeof(float) : 0;
+  };
+  KernelWorkspace even(result_bytes(0)), odd(result_bytes(1));
+  float* po = static_cast<float*>(out->data);
+  const float* src = px;
+  for (size_t i = 0; i < passes.size(); ++i) {
+    const ReducePass& p = passes[i];
+    float* dst = i + 1 == passes.size() ? po : (i % 2 == 0 ? even : odd).As<float>();
+    bool parallel = threads && p.outer * p.extent * p.inner >= kParallelReduceMinElems;
+    if (p.inner == 1) {
+      RowPass(kernels, kind, kahan, src, dst, p, parallel);
+    } else {
+      ColumnPass(kernels, kind, kahan, src, dst, p, parallel);
+    }
+    // the squares are summed by the first pass, the later ones sum the partial sums.
+    if (kind == kAccumSumSquares) kind = kAccumSum;
+    src = dst;
+  }
+  if (op == kReduceMean) {
+    const float count = static_cast<float>(num_elems / num_out);
+    for (int64_t i = 0; i < num_out; ++i) po[i] /= count;
+  } else if (op == kReduceNorm2) {
+    for (int64_t i = 0; i < num_out; ++i) po[i] = std::sqrt(po[i]);
+  }
+}
+
+namespace {
+
+std::vector<int64_t> ToAxes(const ShapeTuple& axes) {
+  return std::vector<int64_t>(axes.begin(), axes.end());
+}
+
+}  // namespace
+
+#define CVM_REGISTER_SUM_KERNEL(Name, Op)                                                    \
+  CVM_REGISTER_GLOBAL("kernel." Name)                                                        \
+      .set_body_typed([](NDArray x, NDArray out, ShapeTuple axes, bool keepdims, bool kahan) { \
+        Reduce(Op, x, ToAxes(axes), keepdims, out,                                           \
+               kahan ? SumMethod::kKahan : SumMethod::kPairwise);                            \
+      })
+
+#define CVM_REGISTER_REDUCE_KERNEL(Name, Op)                                     \
+  CVM_REGISTER_GLOBAL("kernel." Name)                                            \
+      .set_body_typed([](NDArray x, NDArray out, ShapeTuple axes, bool keepdims) { \
+        Reduce(Op, x, ToAxes(axes), keepdims, out);                              \
+      })
+
+CVM_REGISTER_SUM_KERNEL("sum", kReduceSum);
+CVM_REGISTER_SUM_KERNEL("mean", kReduceMean);
+CVM_REGISTER_SUM_KERNEL("norm", kReduceNorm2);
+CVM_REGISTER_REDUCE_KERNEL("max", kReduceMax);
+CVM_REGISTER_REDUCE_KERNEL("min", kReduceMin);
+CVM_REGISTER_REDUCE_KERNEL("argmax", kReduceArgMax);
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
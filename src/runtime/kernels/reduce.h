@@ -0,0 +1,93 @@
+//
+// Created by WangJingYu on 2021/7/24.
+//
+
+/*!
+ * \file kernels/reduce.h
+ * \brief Reductions of float32 NDArrays over any set of axes.
+ *
+ *  Adjacent axes that are all reduced or all kept are merged first, then every
+ *  group of reduced axes takes one pass over an (outer, reduced, inner) view:
+ *   - inner extent 1: the rows are reduced by the vector kernels and their
+ *     horizontal steps, long rows in fixed chunks of kReduceChunk values.
+ *   - otherwise: rows of the inner extent are folded into blocks of
+ *     accumulators, the rows of the reduced axis streaming through the cache.
+ *
+ *  Where the work is split only depends on the shape, never on the number of
+ *  threads, and the partial results are combined in a fixed order: the same
+ *  input gives the same bits on one thread or on many.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_REDUCE_H_
+#define CVM_SRC_RUNTIME_KERNELS_REDUCE_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <vector>
+
+#include "reduce_kernels.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The longest run of a row reduced by one task, in elements. */
+constexpr int64_t kReduceChunk = 1 << 14;
+
+/*! \brief The smallest input split over the thread pool, in elements. */
+constexpr int64_t kParallelReduceMinElems = 1 << 15;
+
+enum ReduceOpKind : int {
+  kReduceSum = 0,
+  kReduceMean,
+  /*! \brief NaN when one of the values is NaN, like the other extrema */
+  kReduceMax,
+  kReduceMin,
+  /*! \brief the index of the first maximum, or of the first NaN, int64 */
+  kReduceArgMax,
+  /*! \brief the L2 norm, sqrt of the sum of squares */
+  kReduceNorm2,
+  kNumReduceOps
+};
+
+/*! \brief How the sums of sum, mean and norm accumulate. */
+enum class SumMethod : int {
+  /*! \brief blocks summed in the vector lanes, the blocks summed pairwise */
+  kPairwise = 0,
+  /*! \brief Kahan compensated sums, about 4x the additions, the error barely grows with n */
+  kKahan = 1,
+};
+
+/*! \return "sum", "mean", "max", "min", "argmax" or "norm". */
+const char* ReduceOpName(ReduceOpKind op);
+
+/*!
+ * \brief The shape of a reduction, NumPy rules.
+ * \param shape The input shape.
+ * \param axes The reduced axes, negative ones count from the end, empty for all of them.
+ * \param keepdims Keep the reduced axes with extent 1.
+ *  Throws an Error for an axis out of range or given twice.
+ */
+std::vector<int64_t> ReduceShape(const std::vector<int64_t>& shape,
+                                 const std::vector<int64_t>& axes, bool keepdims);
+
+/*!
+ * \brief out = op(x) over axes.
+ * \param op The reduction.
+ * \param x The input, float32.
+ * \param axes The reduced axes as in ReduceShape, argmax takes one axis or all of them,
+ *  the index into the flattened input in the latter case.
+ * \param keepdims Keep the reduced axes with extent 1.
+ * \param out The result of shape ReduceShape(x, axes, keepdims), float32, int64 for argmax.
+ * \param method The summation of sum, mean and norm.
+ *
+ *  Reducing no element gives 0 for sum and norm and NaN for mean, it is an Error
+ *  for the other reductions.
+ */
+void Reduce(ReduceOpKind op, const NDArray& x, const std::vector<int64_t>& axes, bool keepdims,
+            const NDArray& out, SumMethod method = SumMethod::kPairwise);
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_REDUCE_H_
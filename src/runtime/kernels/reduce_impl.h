@@ -0,0 +1,232 @@
+//
+// Created by WangJingYu on 2021/7/24.
+//
+
+/*!
+ * \file kernels/reduce_impl.h
+ * \brief The templates behind ReduceKernels, instantiated once per instruction set.
+ *
+ *  x86 max and min return their second operand when one of them is NaN, the
+ *  extrema fold a value in with Max(acc, x) and then keep acc once it is NaN,
+ *  so a NaN anywhere ends up in the result, as in NumPy.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_REDUCE_IMPL_H_
+#define CVM_SRC_RUNTIME_KERNELS_REDUCE_IMPL_H_
+
+#include "reduce_kernels.h"
+#include "simd_vec.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+struct IdentityMap {
+  template <typename V>
+  static V Apply(V x) { return x; }
+};
+struct SquareMap {
+  template <typename V>
+  static V Apply(V x) { return x * x; }
+};
+struct MaxFold {
+  template <typename V>
+  static V Apply(V acc, V x) { return V::SelectNaN(acc, acc, V::Max(acc, x)); }
+};
+struct MinFold {
+  template <typename V>
+  static V Apply(V acc, V x) { return V::SelectNaN(acc, acc, V::Min(acc, x)); }
+};
+
+/*! \brief The sum of a few values, in the order of a balanced tree. */
+inline float PairwiseLanes(float* lanes, int n) {
+  for (int width = n / 2; width > 0; width /= 2) {
+    for (int i = 0; i < width; ++i) lanes[i] += lanes[i + width];
+  }
+  return lanes[0];
+}
+
+/*! \brief s + c accumulates x with Kahan's compensation. */
+inline void KahanAdd(float x, float* s, float* c) {
+  float y = x - *c;
+  float t = *s + y;
+  *c = (t - *s) - y;
+  *s = t;
+}
+
+/*! \brief The lane sums of Map(x) over n values, n a multiple of the lanes, pairwise. */
+template <typename Map>
+VecF32 PairwiseLaneSums(const float* x, int64_t n) {
+  using V = VecF32;
+  constexpr int L = V::kLanes;
+  // a leaf adds 16 values into every lane of the four accumulators.
+  constexpr int64_t kLeaf = 64 * L;
+  if (n > kLeaf) {
+    int64_t half = ScalarMax(kLeaf, n / 2 / kLeaf * kLeaf);
+    return PairwiseLaneSums<Map>(x, half) + PairwiseLaneSums<Map>(x + half, n - half);
+  }
+  // named accumulators, an array of them would live on the stack without unrolling.
+  V a0 = V::Set1(0.0f), a1 = a0, a2 = a0, a3 = a0;
+  int64_t i = 0;
+  for (; i + 4 * L <= n; i += 4 * L) {
+    a0 = a0 + Map::Apply(V::Load(x + i));
+    a1 = a1 + Map::Apply(V::Load(x + i + L));
+    a2 = a2 + Map::Apply(V::Load(x + i + 2 * L));
+    a3 = a3 + Map::Apply(V::Load(x + i + 3 * L));
+  }
+  for (; i < n; i += L) a0 = a0 + Map::Apply(V::Load(x + i));
+  return (a0 + a1) + (a2 + a3);
+}
+
+/*!
+ * \brief Pairwise summation, the error grows with log(n) instead of n.
+ *  The blocks are summed in the vector lanes, the lanes only at the end.
+ */
+template <typename Map>
+float PairwiseSum(const float* x, int64_t n) {
+  constexpr int L = VecF32::kLanes;
+  const int64_t body = n / L * L;
+  float lanes[L];
+  (body > 0 ? PairwiseLaneSums<Map>(x, body) : VecF32::Set1(0.0f)).Store(lanes);
+  float sum = PairwiseLanes(lanes, L);
+  for (int64_t i = body; i < n; ++i) sum += Map::Apply(ScalarF32::Load(x + i)).v;
+  return sum;
+}
+
+/*! \brief Kahan summation in every lane of two accumulators, then over the lanes. */
+template <typename Map>
+float KahanSum(const float* x, int64_t n) {
+  using V = VecF32;
+  constexpr int L = V::kLanes;
+  V s0 = V::Set1(0.0f), s1 = s0, c0 = s0, c1 = s0;
+  int64_t i = 0;
+  for (; i + 2 * L <= n; i += 2 * L) {
+    V y0 = Map::Apply(V::Load(x + i)) - c0;
+    V y1 = Map::Apply(V::Load(x + i + L)) - c1;
+    V t0 = s0 + y0, t1 = s1 + y1;
+    c0 = (t0 - s0) - y0;
+    c1 = (t1 - s1) - y1;
+    s0 = t0;
+    s1 = t1;
+  }
+  float s = 0.0f, c = 0.0f;
+  float lanes[4][L];
+  s0.Store(lanes[0]);
+  s1.Store(lanes[1]);
+  c0.Store(lanes[2]);
+  c1.Store(lanes[3]);
+  for (int j = 0; j < 4; ++j) {
+    for (int l = 0; l < L; ++l) KahanAdd(j < 2 ? lanes[j][l] : -lanes[j][l], &s, &c);
+  }
+  for (; i < n; ++i) KahanAdd(Map::Apply(ScalarF32::Load(x + i)).v, &s, &c);
+  return s - c;
+}
+
+template <typename Fold>
+float ExtremumRow(const float* x, int64_t n) {
+  using V = VecF32;
+  using S = ScalarF32;
+  constexpr int L = V::kLanes;
+  V a0 = V::Set1(x[0]), a1 = a0, a2 = a0, a3 = a0;
+  int64_t i = 0;
+  for (; i + 4 * L <= n; i += 4 * L) {
+    a0 = Fold::Apply(a0, V::Load(x + i));
+    a1 = Fold::Apply(a1, V::Load(x + i + L));
+    a2 = Fold::Apply(a2, V::Load(x + i + 2 * L));
+    a3 = Fold::Apply(a3, V::Load(x + i + 3 * L));
+  }
+  for (; i + L <= n; i += L) a0 = Fold::Apply(a0, V::Load(x + i));
+  float lanes[L];
+  Fold::Apply(Fold::Apply(a0, a1), Fold::Apply(a2, a3)).Store(lanes);
+  S result = S::Set1(lanes[0]);
+  for (int l = 1; l < L; ++l) result = Fold::Apply(result, S::Set1(lanes[l]));
+  for (; i < n; ++i) result = Fold::Apply(result, S::Load(x + i));
+  return result.v;
+}
+
+/*! \brief The first block holding the maximum, then the first index of it in the block. */
+inline int64_t ArgMaxRow(const float* x, int64_t n) {
+  constexpr int64_t kBlock = 2048;
+  float best = x[0];
+  int64_t best_block = 0;
+  for (int64_t b = 0; b < n; b += kBlock) {
+    float value = ExtremumRow<MaxFold>(x + b, ScalarMin(kBlock, n - b));
+    if (value != value) {
+      best = value;
+      best_block = b;
+      break;
+    }
+    if (value > best) {
+      best = value;
+      best_block = b;
+    }
+  }
+  const int64_t end = ScalarMin(n, best_block + kBlock);
+  for (int64_t i = best_block; i < end; ++i) {
+    if (x[i] == best || (best != best && x[i] != x[i])) return i;
+  }
+  return best_block;
+}
+
+template <typename Map>
+void ColumnSum(const float* x, float* acc, float*, int64_t n) {
+  using V = VecF32;
+  constexpr int L = V::kLanes;
+  int64_t i = 0;
+  for (; i + L <= n; i += L) (V::Load(acc + i) + Map::Apply(V::Load(x + i))).Store(acc + i);
+  for (; i < n; ++i) acc[i] += Map::Apply(ScalarF32::Load(x + i)).v;
+}
+
+template <typename Map>
+void ColumnKahanSum(const float* x, float* acc, float* comp, int64_t n) {
+  using V = VecF32;
+  constexpr int L = V::kLanes;
+  int64_t i = 0;
+  for (; i + L <= n; i += L) {
+    V s = V::Load(acc + i), c = V::Load(comp + i);
+    V y = Map::Apply(V::Load(x + i)) - c;
+    V t = s + y;
+    ((t - s) - y).Store(comp + i);
+    t.Store(acc + i);
+  }
+  for (; i < n; ++i) KahanAdd(Map::Apply(ScalarF32::Load(x + i)).v, acc + i, comp + i);
+}
+
+template <typename Fold>
+void ColumnExtremum(const float* x, float* acc, float*, int64_t n) {
+  using V = VecF32;
+  using S = ScalarF32;
+  constexpr int L = V::kLanes;
+  int64_t i = 0;
+  for (; i + L <= n; i += L) Fold::Apply(V::Load(acc + i), V::Load(x + i)).Store(acc + i);
+  for (; i < n; ++i) Fold::Apply(S::Load(acc + i), S::Load(x + i)).Store(acc + i);
+}
+
+inline ReduceKernels MakeReduceKernels() {
+  ReduceKernels k;
+  k.row[kAccumSum] = PairwiseSum<IdentityMap>;
+  k.row[kAccumSumSquares] = PairwiseSum<SquareMap>;
+  k.row[kAccumMax] = ExtremumRow<MaxFold>;
+  k.row[kAccumMin] = ExtremumRow<MinFold>;
+  k.row_kahan[kAccumSum] = KahanSum<IdentityMap>;
+  k.row_kahan[kAccumSumSquares] = KahanSum<SquareMap>;
+  k.row_kahan[kAccumMax] = ExtremumRow<MaxFold>;
+  k.row_kahan[kAccumMin] = ExtremumRow<MinFold>;
+  k.column[kAccumSum] = ColumnSum<IdentityMap>;
+  k.column[kAccumSumSquares] = ColumnSum<SquareMap>;
+  k.column[kAccumMax] = ColumnExtremum<MaxFold>;
+  k.column[kAccumMin] = ColumnExtremum<MinFold>;
+  k.column_kahan[kAccumSum] = ColumnKahanSum<IdentityMap>;
+  k.column_kahan[kAccumSumSquares] = ColumnKahanSum<SquareMap>;
+  k.column_kahan[kAccumMax] = ColumnExtremum<MaxFold>;
+  k.column_kahan[kAccumMin] = ColumnExtremum<MinFold>;
+  k.row_argmax = ArgMaxRow;
+  return k;
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_REDUCE_IMPL_H_
@@ -0,0 +1,70 @@
+//
+// Created by WangJingYu on 2021/7/24.
+//
+
+/*!
+ * \file kernels/reduce_kernels.h
+ * \brief The float32 kernels of the reductions, one table per instruction set.
+ *
+ *  A row kernel reduces n contiguous values to one, with horizontal operations
+ *  at the end. A column kernel folds a row of n values into n accumulators,
+ *  the reduction of the rows of a matrix to one row.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_REDUCE_KERNELS_H_
+#define CVM_SRC_RUNTIME_KERNELS_REDUCE_KERNELS_H_
+
+#include <cstdint>
+
+#include "simd.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief What a reduction kernel accumulates. */
+enum ReduceAccumKind : int {
+  kAccumSum = 0,
+  kAccumSumSquares,
+  /*! \brief the maximum, NaN as soon as one value is NaN */
+  kAccumMax,
+  /*! \brief the minimum, NaN as soon as one value is NaN */
+  kAccumMin,
+  kNumAccumKinds
+};
+
+/*! \return The reduction of x[0, n), n > 0 for the maximum and the minimum. */
+typedef float (*FReduceRow)(const float* x, int64_t n);
+
+/*!
+ * \brief acc[i] = acc[i] op x[i] for i in [0, n).
+ *  The compensated sums keep the running error in comp, the value is acc - comp.
+ */
+typedef void (*FReduceColumn)(const float* x, float* acc, float* comp, int64_t n);
+
+/*! \brief The reduction kernels built for one instruction set. */
+struct ReduceKernels {
+  /*! \brief pairwise sums, blocks summed in the vector lanes then combined pairwise */
+  FReduceRow row[kNumAccumKinds];
+  /*! \brief Kahan compensated sums, the extrema are the same as in row */
+  FReduceRow row_kahan[kNumAccumKinds];
+  FReduceColumn column[kNumAccumKinds];
+  FReduceColumn column_kahan[kNumAccumKinds];
+  /*! \brief the index of the first maximum or of the first NaN of x[0, n), n > 0 */
+  int64_t (*row_argmax)(const float* x, int64_t n);
+};
+
+/*! \return The kernels of a level, the best compiled level not above it. */
+const ReduceKernels* GetReduceKernels(SIMDLevel level);
+
+const ReduceKernels* GetReduceKernelsScalar();
+#if CVM_KERNELS_X86
+const ReduceKernels* GetReduceKernelsSSE42();
+const ReduceKernels* GetReduceKernelsAVX2();
+const ReduceKernels* GetReduceKernelsAVX512();
+#endif
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_REDUCE_KERNELS_H_
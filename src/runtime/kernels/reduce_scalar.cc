@@ -0,0 +1,20 @@
+//
+// Created by WangJingYu on 2021/7/24.
+//
+
+// Built with the default flags of the target, the fallback of every other level.
+#define CVM_SIMD_NAMESPACE scalar
+#include "reduce_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const ReduceKernels* GetReduceKernelsScalar() {
+  static const ReduceKernels kernels = scalar::MakeReduceKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
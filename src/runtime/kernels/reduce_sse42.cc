@@ -0,0 +1,26 @@
+//
+// Created by WangJingYu on 2021/7/24.
+//
+
+// Built with the sse42 flags, see simd_vec.h for what may be included here.
+#include "simd.h"
+
+#if CVM_KERNELS_X86
+
+#define CVM_SIMD_NAMESPACE sse42
+#include "reduce_impl.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+const ReduceKernels* GetReduceKernelsSSE42() {
+  static const ReduceKernels kernels = sse42::MakeReduceKernels();
+  return &kernels;
+}
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_KERNELS_X86
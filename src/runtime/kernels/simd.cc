@@ -0,0 +1,182 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+#include "simd.h"
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/logging.h>
+#include <cvm/runtime/registry.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#if CVM_KERNELS_X86 && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+namespace {
+
+#if CVM_KERNELS_X86 && defined(__GNUC__)
+/*! \return The register state enabled by the OS, XCR0. */
+uint64_t ReadXCR0() {
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+}
+#endif
+
+bool ParseSIMDLevel(const std::string& name, SIMDLevel* level) {
+  for (int i = 0; i <= static_cast<int>(SIMDLevel::kAVX512); ++i) {
+    if (name == SIMDLevelName(static_cast<SIMDLevel>(i))) {
+      *level = static_cast<SIMDLevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::atomic<int>& CurrentLevel() {
+  static std::atomic<int> level([]() {
+    SIMDLevel detected = DetectSIMDLevel();
+    SIMDLevel requested;
+    const char* env = getenv("CVM_SIMD_LEVEL");
+    if (env != nullptr && ParseSIMDLevel(env, &requested) && requested < detected) {
+      return static_cast<int>(requested);
+    }
+    return static_cast<int>(detected);
+  }());
+  return level;
+}
+
+}  // namespace
+
+SIMDLevel DetectSIMDLevel() {
+#if CVM_KERNELS_X86 && defined(__GNUC__)
+  static const SIMDLevel detected = []() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return SIMDLevel::kScalar;
+    bool sse42 = (ecx & bit_SSE4_2) != 0;
+    bool osxsave = (ecx & bit_OSXSAVE) != 0;
+    bool fma = (ecx & bit_FMA) != 0;
+    bool f16c = (ecx & bit_F16C) != 0;
+    if (!sse42) return SIMDLevel::kScalar;
+    if (!osxsave) return SIMDLevel::kSSE42;
+    uint64_t xcr0 = ReadXCR0();
+    // XMM and YMM state, then opmask and ZMM state.
+    bool os_avx = (xcr0 & 0x6) == 0x6;
+    bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+    if (!os_avx || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return SIMDLevel::kSSE42;
+    bool avx2 = (ebx & bit_AVX2) != 0 && fma && f16c;
+    bool avx512 = (ebx & bit_AVX512F) && (ebx & bit_AVX512BW) && (ebx & bit_AVX512DQ) &&
+                  (ebx & bit_AVX512VL);
+    if (avx2 && avx512 && os_avx512) return SIMDLevel::kAVX512;
+    return avx2 ? SIMDLevel::kAVX2 : SIMDLevel::kSSE42;
+  }();
+  return detected;
+#else
+  return SIMDLevel::kScalar;
+#endif
+}
+
+bool HasAVX512VNNI() {
+#if CVM_KERNELS_X86 && defined(__GNUC__)
+  static const bool vnni = []() {
+    unsigned eax, ebx, ecx, edx;
+    if (DetectSIMDLevel() < SIMDLevel::kAVX512) return false;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    // CPUID.(EAX=7, ECX=0):ECX.AVX512_VNNI[bit 11]
+    return (ecx & (1U << 11)) != 0;
+  }();
+  return vnni;
+#else
+  return false;
+#endif
+}
+
+bool HasAVX512BF16() {
+#if CVM_KERNELS_X86 && defined(__GNUC__)
+  static const bool bf16 = []() {
+    unsigned eax, ebx, ecx, edx;
+    if (DetectSIMDLevel() < SIMDLevel::kAVX512) return false;
+    if (!__get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx)) return false;
+    // CPUID.(EAX=7, ECX=1):EAX.AVX512_BF16[bit 5]
+    return (eax & (1U << 5)) != 0;
+  }();
+  return bf16;
+#else
+  return false;
+#endif
+}
+
+SIMDLevel GetSIMDLevel() {
+  return static_cast<SIMDLevel>(CurrentLevel().load(std::memory_order_relaxed));
+}
+
+SIMDLevel SetSIMDLevel(SIMDLevel level) {
+  if (level > DetectSIMDLevel()) level = DetectSIMDLevel();
+  CurrentLevel().store(static_cast<int>(level));
+  return level;
+}
+
+const char* SIMDLevelName(SIMDLevel level) {
+  switch (level) {
+    case SIMDLevel::kSSE42:
+      return "sse4.2";
+    case SIMDLevel::kAVX2:
+      return "avx2";
+    case SIMDLevel::kAVX512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+const CacheSizes& GetCacheSizes() {
+  static const CacheSizes sizes = []() {
+    // conservative defaults when the OS does not tell.
+    CacheSizes s{32 << 10, 1 << 20, 8 << 20};
+#if defined(__linux__) && defined(_SC_LEVEL1_DCACHE_SIZE)
+    long l1d = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l1d > 0) s.l1d = l1d;
+    if (l2 > 0) s.l2 = l2;
+    s.l3 = l3 > 0 ? l3 : s.l2;
+#endif
+    auto override = [](const char* name, int64_t* value) {
+      const char* env = getenv(name);
+      if (env != nullptr && atoll(env) > 0) *value = atoll(env);
+    };
+    override("CVM_L1D_CACHE_SIZE", &s.l1d);
+    override("CVM_L2_CACHE_SIZE", &s.l2);
+    override("CVM_L3_CACHE_SIZE", &s.l3);
+    return s;
+  }();
+  return sizes;
+}
+
+CVM_REGISTER_GLOBAL("kernel.GetSIMDLevel").set_body_typed([]() {
+  return String(SIMDLevelName(GetSIMDLevel()));
+});
+
+CVM_REGISTER_GLOBAL("kernel.SetSIMDLevel").set_body_typed([](std::string name) {
+  SIMDLevel level;
+  if (!ParseSIMDLevel(name, &level)) {
+    throw Error("Unknown SIMD level " + name + ", expect scalar, sse4.2, avx2 or avx512");
+  }
+  return String(SIMDLevelName(SetSIMDLevel(level)));
+});
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
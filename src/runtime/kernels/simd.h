@@ -0,0 +1,88 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+/*!
+ * \file kernels/simd.h
+ * \brief Runtime detection of the SIMD instruction sets the CPU kernels are built for.
+ *
+ *  Every vectorized kernel is compiled once per instruction set, in a source
+ *  file named after it (elementwise_avx2.cc, ...) that gets the matching
+ *  compiler flags. The level picked at run time selects which build is used.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_SIMD_H_
+#define CVM_SRC_RUNTIME_KERNELS_SIMD_H_
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CVM_KERNELS_X86 1
+#else
+#define CVM_KERNELS_X86 0
+#endif
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+
+/*! \brief The instruction sets kernels are specialized for, ordered by capability. */
+enum class SIMDLevel : int {
+  /*! \brief portable C++, the compiler default for the target */
+  kScalar = 0,
+  /*! \brief 128-bit SSE up to SSE4.2 */
+  kSSE42 = 1,
+  /*! \brief 256-bit AVX2 with FMA and F16C */
+  kAVX2 = 2,
+  /*! \brief 512-bit AVX-512 F, BW, DQ and VL */
+  kAVX512 = 3,
+};
+
+/*! \return The best level supported by the CPU and the operating system. */
+SIMDLevel DetectSIMDLevel();
+
+/*!
+ * \return The level kernels dispatch to.
+ *  Defaults to DetectSIMDLevel(), lowered by CVM_SIMD_LEVEL=scalar|sse4.2|avx2|avx512.
+ */
+SIMDLevel GetSIMDLevel();
+
+/*!
+ * \brief Change the level kernels dispatch to, levels above DetectSIMDLevel() are clamped.
+ * \return The level in effect.
+ */
+SIMDLevel SetSIMDLevel(SIMDLevel level);
+
+/*!
+ * \return Whether the CPU has the AVX-512 VNNI int8 dot products.
+ *  They are not a level of their own, the int8 kernels use them at the avx512 level.
+ */
+bool HasAVX512VNNI();
+
+/*!
+ * \return Whether the CPU has the AVX-512 BF16 conversions and dot products.
+ *  Like VNNI, they are used at the avx512 level.
+ */
+bool HasAVX512BF16();
+
+/*! \return The name of a level, as accepted by CVM_SIMD_LEVEL. */
+const char* SIMDLevelName(SIMDLevel level);
+
+/*! \brief Sizes in bytes of the data caches seen by one core. */
+struct CacheSizes {
+  int64_t l1d;
+  int64_t l2;
+  /*! \brief the last level cache, shared by the cores */
+  int64_t l3;
+};
+
+/*!
+ * \return The cache sizes, read once from the OS.
+ *  CVM_L1D_CACHE_SIZE, CVM_L2_CACHE_SIZE and CVM_L3_CACHE_SIZE override them.
+ */
+const CacheSizes& GetCacheSizes();
+
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_SIMD_H_
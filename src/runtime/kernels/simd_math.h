@@ -0,0 +1,105 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+/*!
+ * \file kernels/simd_math.h
+ * \brief Transcendental functions over the vectors of simd_vec.h.
+ *
+ *  The polynomials follow Cephes expf and tanhf, the results are within
+ *  2 ulp of the libm ones for float inputs, identical for every lane width.
+ *  Erf is the rational approximation of Eigen, within 5e-7 of erf.
+ *  NaN inputs give NaN results.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_SIMD_MATH_H_
+#define CVM_SRC_RUNTIME_KERNELS_SIMD_MATH_H_
+
+#include "simd_vec.h"
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+/*! \return e^x, 0 below -87.3 and +inf above 88.7. */
+template <typename V>
+inline V Exp(V x) {
+  // x second: Max and Min return the second operand when one is NaN.
+  x = V::Min(V::Set1(88.7228391f), V::Max(V::Set1(-87.3365447f), x));
+  // x = n * ln2 + r, |r| <= ln2 / 2, ln2 split in two parts to keep r exact.
+  V n = V::Round(x * V::Set1(1.44269504088896341f));
+  V r = V::FMA(n, V::Set1(-0.693359375f), x);
+  r = V::FMA(n, V::Set1(2.12194440e-4f), r);
+  V p = V::Set1(1.9875691500e-4f);
+  p = V::FMA(p, r, V::Set1(1.3981999507e-3f));
+  p = V::FMA(p, r, V::Set1(8.3334519073e-3f));
+  p = V::FMA(p, r, V::Set1(4.1665795894e-2f));
+  p = V::FMA(p, r, V::Set1(1.6666665459e-1f));
+  p = V::FMA(p, r, V::Set1(5.0000001201e-1f));
+  p = V::FMA(p, r * r, r + V::Set1(1.0f));
+  // 2^128 overflows the exponent, scale by 2^(n-1) twice at the top of the range.
+  V half = V::Pow2(n - V::Set1(1.0f));
+  return p * half * V::Set1(2.0f);
+}
+
+/*! \return 1 / (1 + e^-x) */
+template <typename V>
+inline V Sigmoid(V x) {
+  V one = V::Set1(1.0f);
+  return one / (one + Exp(V::Set1(0.0f) - x));
+}
+
+/*! \return tanh(x), a polynomial close to 0 and 1 - 2 / (e^2|x| + 1) elsewhere. */
+template <typename V>
+inline V Tanh(V x) {
+  V ax = V::Abs(x);
+  V z = x * x;
+  V p = V::Set1(-5.70498872745e-3f);
+  p = V::FMA(p, z, V::Set1(2.06390887954e-2f));
+  p = V::FMA(p, z, V::Set1(-5.37397155531e-2f));
+  p = V::FMA(p, z, V::Set1(1.33314422036e-1f));
+  p = V::FMA(p, z, V::Set1(-3.33332819422e-1f));
+  V small = V::FMA(p * z, x, x);
+  V one = V::Set1(1.0f);
+  V large = one - V::Set1(2.0f) / (Exp(ax + ax) + one);
+  // restore the sign of x.
+  large = V::SelectLess(x, V::Set1(0.0f), V::Set1(0.0f) - large, large);
+  return V::SelectLess(ax, V::Set1(0.625f), small, large);
+}
+
+/*! \return erf(x), x * P(x^2) / Q(x^2) over x clamped to [-4, 4], erf(4) rounds to 1. */
+template <typename V>
+inline V Erf(V x) {
+  x = V::Min(V::Set1(4.0f), V::Max(V::Set1(-4.0f), x));
+  V z = x * x;
+  V p = V::Set1(-2.72614225801306e-10f);
+  p = V::FMA(p, z, V::Set1(2.77068142495902e-08f));
+  p = V::FMA(p, z, V::Set1(-2.10102402082508e-06f));
+  p = V::FMA(p, z, V::Set1(-5.69250639462346e-05f));
+  p = V::FMA(p, z, V::Set1(-7.34990630326855e-04f));
+  p = V::FMA(p, z, V::Set1(-2.95459980854025e-03f));
+  p = V::FMA(p, z, V::Set1(-1.60960333262415e-02f));
+  V q = V::Set1(-1.45660718464996e-05f);
+  q = V::FMA(q, z, V::Set1(-2.13374055278905e-04f));
+  q = V::FMA(q, z, V::Set1(-1.68282697438203e-03f));
+  q = V::FMA(q, z, V::Set1(-7.37332916720468e-03f));
+  q = V::FMA(q, z, V::Set1(-1.42647390514189e-02f));
+  return x * p / q;
+}
+
+/*!
+ * \return x * Phi(x) = x / 2 * (1 + erf(x / sqrt(2))), the exact GELU.
+ *  1 + erf cancels for negative x, the error is within 3e-7 |x| there.
+ */
+template <typename V>
+inline V Gelu(V x) {
+  V half_x = x * V::Set1(0.5f);
+  return V::FMA(half_x, Erf(x * V::Set1(0.707106781186547524f)), half_x);
+}
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_SIMD_MATH_H_
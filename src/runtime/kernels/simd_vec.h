@@ -0,0 +1,244 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+/*!
+ * \file kernels/simd_vec.h
+ * \brief Thin wrappers of the float vector registers of one instruction set.
+ *
+ *  The header is meant for the per instruction set kernel sources: a source
+ *  defines CVM_SIMD_NAMESPACE before including it and is compiled with the
+ *  flags of its instruction set. VecF32 then wraps the widest register these
+ *  flags enable, and everything lands in its own namespace, so that the same
+ *  templates built with different flags never collide at link time.
+ *
+ *  Such a source should only include headers that do not define functions
+ *  shared with the rest of the library, an inline function compiled with
+ *  AVX-512 must not be the copy the linker keeps for every caller.
+ */
+#ifndef CVM_SRC_RUNTIME_KERNELS_SIMD_VEC_H_
+#define CVM_SRC_RUNTIME_KERNELS_SIMD_VEC_H_
+
+#ifndef CVM_SIMD_NAMESPACE
+#error "define CVM_SIMD_NAMESPACE before including simd_vec.h"
+#endif
+
+#if defined(__SSE4_2__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+
+namespace cvm {
+namespace runtime {
+namespace kernels {
+namespace CVM_SIMD_NAMESPACE {
+
+/*!
+ * \brief The min and the max of two scalars. std::min and std::max would leave weak
+ *  copies compiled with the flags of the source outside its namespace.
+ */
+template <typename T>
+inline T ScalarMin(T a, T b) {
+  return b < a ? b : a;
+}
+
+template <typename T>
+inline T ScalarMax(T a, T b) {
+  return a < b ? b : a;
+}
+
+/*! \brief A single float, handles the loop tails and targets without vector registers. */
+struct ScalarF32 {
+  static constexpr int kLanes = 1;
+  float v;
+
+  static ScalarF32 Load(const float* p) { return {*p}; }
+  static ScalarF32 Set1(float x) { return {x}; }
+  void Store(float* p) const { *p = v; }
+  static ScalarF32 LoadI32(const int32_t* p) { return {static_cast<float>(*p)}; }
+  void StoreI32(int32_t* p) const { *p = static_cast<int32_t>(v); }
+
+  friend ScalarF32 operator+(ScalarF32 a, ScalarF32 b) { return {a.v + b.v}; }
+  friend ScalarF32 operator-(ScalarF32 a, ScalarF32 b) { return {a.v - b.v}; }
+  friend ScalarF32 operator*(ScalarF32 a, ScalarF32 b) { return {a.v * b.v}; }
+  friend ScalarF32 operator/(ScalarF32 a, ScalarF32 b) { return {a.v / b.v}; }
+  static ScalarF32 Max(ScalarF32 a, ScalarF32 b) { return {a.v > b.v ? a.v : b.v}; }
+  static ScalarF32 Min(ScalarF32 a, ScalarF32 b) { return {a.v < b.v ? a.v : b.v}; }
+  /*! \return a * b + c */
+  static ScalarF32 FMA(ScalarF32 a, ScalarF32 b, ScalarF32 c) { return {a.v * b.v + c.v}; }
+  static ScalarF32 Abs(ScalarF32 a) { return {a.v < 0 ? -a.v : a.v}; }
+  /*! \brief Round to the nearest integer, ties to even, |a| < 2^22. */
+  static ScalarF32 Round(ScalarF32 a) {
+    const float magic = 12582912.0f;  // 1.5 * 2^23
+    return {(a.v + magic) - magic};
+  }
+  /*! \return 2^n for an integral n in [-126, 127]. */
+  static ScalarF32 Pow2(ScalarF32 n) {
+    int32_t bits = (static_cast<int32_t>(n.v) + 127) << 23;
+    float r;
+    memcpy(&r, &bits, sizeof(r));
+    return {r};
+  }
+  /*! \return a < b ? x : y, per lane. */
+  static ScalarF32 SelectLess(ScalarF32 a, ScalarF32 b, ScalarF32 x, ScalarF32 y) {
+    return a.v < b.v ? x : y;
+  }
+  /*! \return a is NaN ? x : y, per lane. */
+  static ScalarF32 SelectNaN(ScalarF32 a, ScalarF32 x, ScalarF32 y) { return a.v != a.v ? x : y; }
+  /*! \return The sum of the lanes, as a balanced tree. */
+  static float ReduceAdd(ScalarF32 a) { return a.v; }
+  /*! \return The maximum of the lanes, a NaN lane may be dropped. */
+  static float ReduceMax(ScalarF32 a) { return a.v; }
+};
+
+#if defined(__AVX512F__)
+
+struct VecF32 {
+  static constexpr int kLanes = 16;
+  __m512 v;
+
+  static VecF32 Load(const float* p) { return {_mm512_loadu_ps(p)}; }
+  static VecF32 Set1(float x) { return {_mm512_set1_ps(x)}; }
+  void Store(float* p) const { _mm512_storeu_ps(p, v); }
+  static VecF32 LoadI32(const int32_t* p) {
+    return {_mm512_cvtepi32_ps(_mm512_loadu_si512(p))};
+  }
+  void StoreI32(int32_t* p) const { _mm512_storeu_si512(p, _mm512_cvttps_epi32(v)); }
+
+  friend VecF32 operator+(VecF32 a, VecF32 b) { return {_mm512_add_ps(a.v, b.v)}; }
+  friend VecF32 operator-(VecF32 a, VecF32 b) { return {_mm512_sub_ps(a.v, b.v)}; }
+  friend VecF32 operator*(VecF32 a, VecF32 b) { return {_mm512_mul_ps(a.v, b.v)}; }
+  friend VecF32 operator/(VecF32 a, VecF32 b) { return {_mm512_div_ps(a.v, b.v)}; }
+  static VecF32 Max(VecF32 a, VecF32 b) { return {_mm512_max_ps(a.v, b.v)}; }
+  static VecF32 Min(VecF32 a, VecF32 b) { return {_mm512_min_ps(a.v, b.v)}; }
+  static VecF32 FMA(VecF32 a, VecF32 b, VecF32 c) { return {_mm512_fmadd_ps(a.v, b.v, c.v)}; }
+  static VecF32 Abs(VecF32 a) { return {_mm512_abs_ps(a.v)}; }
+  static VecF32 Round(VecF32 a) {
+    return {_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+  }
+  static VecF32 Pow2(VecF32 n) {
+    __m512i bits = _mm512_add_epi32(_mm512_cvtps_epi32(n.v), _mm512_set1_epi32(127));
+    return {_mm512_castsi512_ps(_mm512_slli_epi32(bits, 23))};
+  }
+  static VecF32 SelectLess(VecF32 a, VecF32 b, VecF32 x, VecF32 y) {
+    return {_mm512_mask_blend_ps(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ), y.v, x.v)};
+  }
+  static VecF32 SelectNaN(VecF32 a, VecF32 x, VecF32 y) {
+    return {_mm512_mask_blend_ps(_mm512_cmp_ps_mask(a.v, a.v, _CMP_UNORD_Q), y.v, x.v)};
+  }
+  static float ReduceAdd(VecF32 a) { return _mm512_reduce_add_ps(a.v); }
+  static float ReduceMax(VecF32 a) { return _mm512_reduce_max_ps(a.v); }
+};
+
+#elif defined(__AVX2__)
+
+struct VecF32 {
+  static constexpr int kLanes = 8;
+  __m256 v;
+
+  static VecF32 Load(const float* p) { return {_mm256_loadu_ps(p)}; }
+  static VecF32 Set1(float x) { return {_mm256_set1_ps(x)}; }
+  void Store(float* p) const { _mm256_storeu_ps(p, v); }
+  static VecF32 LoadI32(const int32_t* p) {
+    return {_mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)))};
+  }
+  void StoreI32(int32_t* p) const {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_cvttps_epi32(v));
+  }
+
+  friend VecF32 operator+(VecF32 a, VecF32 b) { return {_mm256_add_ps(a.v, b.v)}; }
+  friend VecF32 operator-(VecF32 a, VecF32 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+  friend VecF32 operator*(VecF32 a, VecF32 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+  friend VecF32 operator/(VecF32 a, VecF32 b) { return {_mm256_div_ps(a.v, b.v)}; }
+  static VecF32 Max(VecF32 a, VecF32 b) { return {_mm256_max_ps(a.v, b.v)}; }
+  static VecF32 Min(VecF32 a, VecF32 b) { return {_mm256_min_ps(a.v, b.v)}; }
+  static VecF32 FMA(VecF32 a, VecF32 b, VecF32 c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+  static VecF32 Abs(VecF32 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+  static VecF32 Round(VecF32 a) {
+    return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+  }
+  static VecF32 Pow2(VecF32 n) {
+    __m256i bits = _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127));
+    return {_mm256_castsi256_ps(_mm256_slli_epi32(bits, 23))};
+  }
+  static VecF32 SelectLess(VecF32 a, VecF32 b, VecF32 x, VecF32 y) {
+    return {_mm256_blendv_ps(y.v, x.v, _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ))};
+  }
+  static VecF32 SelectNaN(VecF32 a, VecF32 x, VecF32 y) {
+    return {_mm256_blendv_ps(y.v, x.v, _mm256_cmp_ps(a.v, a.v, _CMP_UNORD_Q))};
+  }
+  static float ReduceAdd(VecF32 a) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    return _mm_cvtss_f32(_mm_add_ss(s, _mm_movehdup_ps(s)));
+  }
+  static float ReduceMax(VecF32 a) {
+    __m128 s = _mm_max_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+    s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+    return _mm_cvtss_f32(_mm_max_ss(s, _mm_movehdup_ps(s)));
+  }
+};
+
+#elif defined(__SSE4_2__)
+
+struct VecF32 {
+  static constexpr int kLanes = 4;
+  __m128 v;
+
+  static VecF32 Load(const float* p) { return {_mm_loadu_ps(p)}; }
+  static VecF32 Set1(float x) { return {_mm_set1_ps(x)}; }
+  void Store(float* p) const { _mm_storeu_ps(p, v); }
+  static VecF32 LoadI32(const int32_t* p) {
+    return {_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)))};
+  }
+  void StoreI32(int32_t* p) const {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(v));
+  }
+
+  friend VecF32 operator+(VecF32 a, VecF32 b) { return {_mm_add_ps(a.v, b.v)}; }
+  friend VecF32 operator-(VecF32 a, VecF32 b) { return {_mm_sub_ps(a.v, b.v)}; }
+  friend VecF32 operator*(VecF32 a, VecF32 b) { return {_mm_mul_ps(a.v, b.v)}; }
+  friend VecF32 operator/(VecF32 a, VecF32 b) { return {_mm_div_ps(a.v, b.v)}; }
+  static VecF32 Max(VecF32 a, VecF32 b) { return {_mm_max_ps(a.v, b.v)}; }
+  static VecF32 Min(VecF32 a, VecF32 b) { return {_mm_min_ps(a.v, b.v)}; }
+  static VecF32 FMA(VecF32 a, VecF32 b, VecF32 c) {
+    return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)};
+  }
+  static VecF32 Abs(VecF32 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+  static VecF32 Round(VecF32 a) {
+    return {_mm_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+  }
+  static VecF32 Pow2(VecF32 n) {
+    __m128i bits = _mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127));
+    return {_mm_castsi128_ps(_mm_slli_epi32(bits, 23))};
+  }
+  static VecF32 SelectLess(VecF32 a, VecF32 b, VecF32 x, VecF32 y) {
+    return {_mm_blendv_ps(y.v, x.v, _mm_cmplt_ps(a.v, b.v))};
+  }
+  static VecF32 SelectNaN(VecF32 a, VecF32 x, VecF32 y) {
+    return {_mm_blendv_ps(y.v, x.v, _mm_cmpunord_ps(a.v, a.v))};
+  }
+  static float ReduceAdd(VecF32 a) {
+    __m128 s = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+    return _mm_cvtss_f32(_mm_add_ss(s, _mm_movehdup_ps(s)));
+  }
+  static float ReduceMax(VecF32 a) {
+    __m128 s = _mm_max_ps(a.v, _mm_movehl_ps(a.v, a.v));
+    return _mm_cvtss_f32(_mm_max_ss(s, _mm_movehdup_ps(s)));
+  }
+};
+
+#else
+
+using VecF32 = ScalarF32;
+
+#endif
+
+}  // namespace CVM_SIMD_NAMESPACE
+}  // namespace kernels
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_KERNELS_SIMD_VEC_H_
@@ -0,0 +1,59 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+#include "layout_pass.h"
+
+#include <cvm/runtime/logging.h>
+
+#include <map>
+#include <utility>
+
+#include "kernels/layout.h"
+
+namespace cvm {
+namespace runtime {
+
+std::vector<LayoutNode> InsertLayoutTransforms(const std::vector<LayoutNode>& nodes,
+                                               std::vector<int>* node_map) {
+  std::vector<LayoutNode> result;
+  node_map->assign(nodes.size(), -1);
+  // the transform of a producer, in the result, into a layout.
+  std::map<std::pair<int, std::string>, int> transforms;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    LayoutNode node = nodes[i];
+    ICHECK(node.input_layouts.empty() || node.input_layouts.size() == node.inputs.size())
+        << "node " << i << " has " << node.input_layouts.size() << " input layouts for "
+        << node.inputs.size() << " inputs";
+    std::string first_layout;
+    for (size_t j = 0; j < node.inputs.size(); ++j) {
+      int input = node.inputs[j];
+      ICHECK(input >= 0 && static_cast<size_t>(input) < i)
+          << "node " << i << " reads node " << input << ", which does not come before it";
+      int producer = (*node_map)[input];
+      const std::string have = result[producer].layout;
+      const std::string want = node.input_layouts.empty() ? "" : node.input_layouts[j];
+      if (!want.empty() && !have.empty() && want != have) {
+        if (!kernels::LayoutConvertible(kernels::Layout(have), kernels::Layout(want))) {
+          throw Error("layout pass: node " + std::to_string(i) + " reads " + want +
+                      " from a producer of " + have);
+        }
+        auto it = transforms.find({producer, want});
+        if (it == transforms.end()) {
+          result.push_back({kLayoutTransformOp, {producer}, {have}, want});
+          it = transforms.emplace(std::make_pair(producer, want), result.size() - 1).first;
+        }
+        producer = it->second;
+      }
+      node.inputs[j] = producer;
+      if (j == 0) first_layout = want.empty() ? have : want;
+    }
+    if (node.layout.empty()) node.layout = first_layout;
+    (*node_map)[i] = static_cast<int>(result.size());
+    result.push_back(std::move(node));
+  }
+  return result;
+}
+
+}  // namespace runtime
+}  // namespace cvm
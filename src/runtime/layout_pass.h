@@ -0,0 +1,54 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+/*!
+ * \file layout_pass.h
+ * \brief The pass that converts tensors between the layouts their producers write and
+ *  the layouts their consumers read.
+ */
+#ifndef CVM_SRC_RUNTIME_LAYOUT_PASS_H_
+#define CVM_SRC_RUNTIME_LAYOUT_PASS_H_
+
+#include <string>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief The op name of the inserted transforms. */
+constexpr const char* kLayoutTransformOp = "kernel.layout_transform";
+
+/*! \brief A node of the dataflow graph given to the pass, each node produces one tensor. */
+struct LayoutNode {
+  /*! \brief registered name of the op, empty for a graph input */
+  std::string op;
+  /*! \brief indices of the nodes whose tensors this node reads */
+  std::vector<int> inputs;
+  /*! \brief the layout the op reads each input in, empty when any layout does */
+  std::vector<std::string> input_layouts;
+  /*! \brief the layout of the produced tensor, empty for the layout of the first input */
+  std::string layout;
+};
+
+/*!
+ * \brief Insert a transform wherever a consumer reads an input in another layout than
+ *  the one of its producer.
+ *
+ *  A transform node has the op kLayoutTransformOp, reads its producer in the producer's
+ *  layout and writes the consumer's. Consumers reading one producer in the same layout
+ *  share its transform. Unknown (empty) layouts never cause a transform. Throws an Error
+ *  when two layouts do not convert.
+ *
+ * \param nodes The nodes in topological order.
+ * \param node_map Set to the index of every node of nodes in the result.
+ * \return The nodes with the transforms, in topological order, every layout filled in
+ *  where it is known.
+ */
+std::vector<LayoutNode> InsertLayoutTransforms(const std::vector<LayoutNode>& nodes,
+                                               std::vector<int>* node_map);
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_LAYOUT_PASS_H_
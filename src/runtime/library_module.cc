@@ -0,0 +1,68 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include "library_module.h"
+
+#include <cvm/runtime/registry.h>
+
+#include <string>
+#include <utility>
+
+#include "runtime_base.h"
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief The module of a library, see CreateModuleFromLibrary. */
+class LibraryModuleNode final : public ModuleNode {
+ public:
+  explicit LibraryModuleNode(ObjectPtr<Library> lib) : lib_(std::move(lib)) {}
+
+  const char* type_key() const final { return "library"; }
+
+  PackedFunc GetFunction(const std::string& name,
+                         const ObjectPtr<Object>& /*sptr_to_self*/) final {
+    auto faddr = reinterpret_cast<CVMBackendPackedCFunc>(lib_->GetSymbol(name.c_str()));
+    if (faddr == nullptr) return PackedFunc();
+    return WrapPackedFunc(faddr, lib_);
+  }
+
+  using ModuleNode::GetFunction;
+
+ private:
+  ObjectPtr<Library> lib_;
+};
+
+PackedFunc WrapPackedFunc(CVMBackendPackedCFunc faddr, const ObjectPtr<Object>& lib) {
+  // the function holds the library rather than the module: the functions cached by the
+  // module then make no reference cycle, and the code stays loaded while one is alive.
+  return PackedFunc([faddr, lib](CVMArgs args, CVMRetValue* rv) {
+    CVMValue ret_value;
+    int ret_type_code = kCVMNullptr;
+    int ret = (*faddr)(const_cast<CVMValue*>(args.values), const_cast<int*>(args.type_codes),
+                       args.num_args, &ret_value, &ret_type_code, nullptr);
+    if (ret != 0) throw Error(CVMGetLastError());
+    if (ret_type_code != kCVMNullptr) {
+      *rv = CVMRetValue::MoveFromCHost(ret_value, ret_type_code);
+    }
+  });
+}
+
+Module CreateModuleFromLibrary(ObjectPtr<Library> lib) {
+  auto node = make_object<LibraryModuleNode>(lib);
+  void** ctx = reinterpret_cast<void**>(lib->GetSymbol(symbol::cvm_module_ctx));
+  if (ctx != nullptr) *ctx = static_cast<ModuleNode*>(node.get());
+  return Module(node);
+}
+
+}  // namespace runtime
+}  // namespace cvm
+
+using namespace cvm::runtime;
+
+int CVMBackendGetFuncFromEnv(void* mod_node, const char* func_name, CVMFunctionHandle* out) {
+  API_BEGIN();
+  *out = const_cast<PackedFunc*>(static_cast<ModuleNode*>(mod_node)->GetFuncFromEnv(func_name));
+  API_END();
+}
@@ -0,0 +1,50 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file library_module.h
+ * \brief Modules of the functions exported by a library of symbols.
+ */
+#ifndef CVM_SRC_RUNTIME_LIBRARY_MODULE_H_
+#define CVM_SRC_RUNTIME_LIBRARY_MODULE_H_
+
+#include <cvm/runtime/c_backend_api.h>
+#include <cvm/runtime/module.h>
+#include <cvm/runtime/object.h>
+
+#include <string>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief A library of symbols: a shared library, the system library, ... */
+class Library : public Object {
+ public:
+  virtual ~Library() = default;
+
+  /*! \return The address of a symbol, nullptr when there is none. */
+  virtual void* GetSymbol(const char* name) = 0;
+
+  static constexpr const char* _type_key = "runtime.Library";
+  CVM_DECLARE_BASE_OBJECT_INFO(Library, Object);
+};
+
+/*!
+ * \brief Wrap a CVMBackendPackedCFunc into a PackedFunc.
+ * \param faddr The function.
+ * \param lib The library of the function, kept alive by the PackedFunc.
+ */
+PackedFunc WrapPackedFunc(CVMBackendPackedCFunc faddr, const ObjectPtr<Object>& lib);
+
+/*!
+ * \brief Create the module of the functions of a library, a function is the
+ *  CVMBackendPackedCFunc of its name. The __cvm_module_ctx symbol of the library, when
+ *  it has one, is set to the module.
+ */
+Module CreateModuleFromLibrary(ObjectPtr<Library> lib);
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_LIBRARY_MODULE_H_
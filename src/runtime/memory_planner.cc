@@ -0,0 +1,217 @@
+//
+// Created by WangJingYu on 2021/7/17.
+//
+
+#include "memory_planner.h"
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/registry.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace cvm {
+namespace runtime {
+
+namespace {
+
+inline size_t RoundUp(size_t value, size_t align) { return (value + align - 1) / align * align; }
+
+inline bool Overlap(const TensorLifetime& a, const TensorLifetime& b) {
+  return a.first_use <= b.last_use && b.first_use <= a.last_use;
+}
+
+/*!
+ * \brief Place tensors in the given order, each into the smallest gap left between the
+ *  already placed tensors it conflicts with (best fit), at the end when none fits.
+ */
+template <typename FConflict>
+void PlaceTensors(const std::vector<size_t>& sizes, const std::vector<size_t>& order,
+                  const FConflict& conflict, MemoryPlan* plan) {
+  // placed tensors, kept sorted by offset.
+  std::vector<size_t> placed;
+  for (size_t id : order) {
+    size_t best_offset = 0;
+    size_t best_gap = SIZE_MAX;
+    size_t prev_end = 0;
+    for (size_t other : placed) {
+      if (!conflict(id, other)) continue;
+      size_t offset = plan->offsets[other];
+      if (offset > prev_end) {
+        size_t gap = offset - prev_end;
+        if (gap >= sizes[id] && gap < best_gap) {
+          best_gap = gap;
+          best_offset = prev_end;
+        }
+      }
+      prev_end = std::max(prev_end, offset + sizes[other]);
+    }
+    if (best_gap == SIZE_MAX) best_offset = prev_end;
+    plan->offsets[id] = best_offset;
+    plan->arena_bytes = std::max(plan->arena_bytes, best_offset + sizes[id]);
+    auto pos = std::upper_bound(placed.begin(), placed.end(), best_offset,
+                                [&](size_t offset, size_t t) { return offset < plan->offsets[t]; });
+    placed.insert(pos, id);
+  }
+}
+
+}  // namespace
+
+std::vector<TensorLifetime> ComputeLifetimes(const std::vector<PlannerNode>& nodes,
+                                             const std::vector<int>& outputs) {
+  std::vector<TensorLifetime> lifetimes(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const PlannerNode& node = nodes[i];
+    size_t nbytes = (node.dtype.bits * node.dtype.lanes + 7) / 8;
+    for (int64_t extent : node.shape) nbytes *= static_cast<size_t>(extent);
+    lifetimes[i].nbytes = nbytes;
+    lifetimes[i].first_use = static_cast<int64_t>(i);
+    lifetimes[i].last_use = static_cast<int64_t>(i);
+    for (int input : node.inputs) {
+      ICHECK(input >= 0 && static_cast<size_t>(input) < i)
+          << "PlanMemory: nodes must be in topological order, node " << i << " reads " << input;
+      lifetimes[input].last_use = static_cast<int64_t>(i);
+    }
+  }
+  for (int output : outputs) {
+    ICHECK(output >= 0 && static_cast<size_t>(output) < nodes.size());
+    lifetimes[output].last_use = static_cast<int64_t>(nodes.size());
+  }
+  return lifetimes;
+}
+
+namespace {
+
+/*! \brief A plan with the naive statistics of the tensors, sizes set to their rounded sizes. */
+MemoryPlan InitPlan(const std::vector<TensorLifetime>& tensors, size_t alignment,
+                    std::vector<size_t>* sizes) {
+  MemoryPlan plan;
+  size_t num_tensors = tensors.size();
+  plan.offsets.resize(num_tensors, 0);
+  plan.num_naive_allocs = num_tensors;
+
+  sizes->resize(num_tensors);
+  for (size_t i = 0; i < num_tensors; ++i) {
+    (*sizes)[i] = RoundUp(std::max<size_t>(tensors[i].nbytes, 1), alignment);
+    plan.naive_bytes += (*sizes)[i];
+  }
+
+  // peak of the naive scheme: sweep over the steps.
+  std::vector<std::pair<int64_t, int64_t>> events;
+  for (size_t i = 0; i < num_tensors; ++i) {
+    events.emplace_back(tensors[i].first_use, static_cast<int64_t>((*sizes)[i]));
+    events.emplace_back(tensors[i].last_use + 1, -static_cast<int64_t>((*sizes)[i]));
+  }
+  std::sort(events.begin(), events.end());
+  int64_t live = 0;
+  for (const auto& e : events) {
+    live += e.second;
+    plan.naive_peak_bytes = std::max(plan.naive_peak_bytes, static_cast<size_t>(live));
+  }
+  return plan;
+}
+
+/*! \return The tensors largest first, then by their first use. */
+std::vector<size_t> PlacementOrder(const std::vector<TensorLifetime>& tensors,
+                                   const std::vector<size_t>& sizes) {
+  std::vector<size_t> order(tensors.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (sizes[a] != sizes[b]) return sizes[a] > sizes[b];
+    return tensors[a].first_use < tensors[b].first_use;
+  });
+  return order;
+}
+
+}  // namespace
+
+MemoryPlan PlanMemory(const std::vector<TensorLifetime>& tensors, size_t alignment) {
+  std::vector<size_t> sizes;
+  MemoryPlan plan = InitPlan(tensors, alignment, &sizes);
+  PlaceTensors(sizes, PlacementOrder(tensors, sizes),
+               [&](size_t a, size_t b) { return Overlap(tensors[a], tensors[b]); }, &plan);
+  return plan;
+}
+
+MemoryPlan PlanConcurrentMemory(const std::vector<PlannerNode>& nodes,
+                                const std::vector<int>& outputs, size_t alignment) {
+  std::vector<TensorLifetime> tensors = ComputeLifetimes(nodes, outputs);
+  const size_t num_nodes = nodes.size();
+  std::vector<std::vector<int>> readers(num_nodes);
+  for (size_t i = 0; i < num_nodes; ++i) {
+    for (int input : nodes[i].inputs) readers[input].push_back(static_cast<int>(i));
+  }
+  std::vector<bool> is_output(num_nodes, false);
+  for (int output : outputs) is_output[output] = true;
+
+  // descendants[i]: the bit set of the nodes that run after node i in every order.
+  const size_t words = (num_nodes + 63) / 64;
+  std::vector<uint64_t> descendants(num_nodes * words, 0);
+  for (size_t i = num_nodes; i-- > 0;) {
+    uint64_t* di = &descendants[i * words];
+    for (int r : readers[i]) {
+      const uint64_t* dr = &descendants[r * words];
+      for (size_t w = 0; w < words; ++w) di[w] |= dr[w];
+      di[r / 64] |= uint64_t(1) << (r % 64);
+    }
+  }
+  auto runs_after = [&](size_t node, size_t before) {
+    return (descendants[before * words + node / 64] >> (node % 64)) & 1;
+  };
+  // the tensor of a is dead before b produces its tensor: b runs after all the readers of
+  // a, or after a itself when nothing reads it.
+  auto dead_before = [&](size_t a, size_t b) {
+    if (is_output[a]) return false;
+    if (readers[a].empty()) return runs_after(b, a) != 0;
+    for (int r : readers[a]) {
+      if (static_cast<size_t>(r) == b || !runs_after(b, r)) return false;
+    }
+    return true;
+  };
+
+  std::vector<size_t> sizes;
+  MemoryPlan plan = InitPlan(tensors, alignment, &sizes);
+  PlaceTensors(sizes, PlacementOrder(tensors, sizes),
+               [&](size_t a, size_t b) { return !dead_before(a, b) && !dead_before(b, a); },
+               &plan);
+  return plan;
+}
+
+std::vector<NDArray> AllocatePlannedTensors(const MemoryPlan& plan,
+                                            const std::vector<PlannerNode>& nodes, Device dev) {
+  ICHECK_EQ(plan.offsets.size(), nodes.size());
+  NDArray arena = NDArray::Empty({static_cast<int64_t>(plan.arena_bytes)}, DLDataType{kDLUInt, 8, 1},
+                                 dev);
+  std::vector<NDArray> tensors;
+  tensors.reserve(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    tensors.push_back(arena.CreateView(nodes[i].shape, nodes[i].dtype, plan.offsets[i]));
+  }
+  return tensors;
+}
+
+// Node i is described by shapes[i], dtypes[i] and inputs[i], outputs lists the graph outputs.
+// Returns [offsets, (arena_bytes, naive_bytes, naive_peak_bytes, num_naive_allocs)].
+CVM_REGISTER_GLOBAL("runtime.PlanMemory")
+    .set_body_typed([](Array<ShapeTuple> shapes, Array<String> dtypes, Array<ShapeTuple> inputs,
+                       ShapeTuple outputs) {
+      ICHECK_EQ(shapes.size(), dtypes.size());
+      ICHECK_EQ(shapes.size(), inputs.size());
+      std::vector<PlannerNode> nodes(shapes.size());
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        nodes[i].shape.assign(shapes[i].begin(), shapes[i].end());
+        nodes[i].dtype = String2DLDataType(dtypes[i]);
+        nodes[i].inputs.assign(inputs[i].begin(), inputs[i].end());
+      }
+      MemoryPlan plan =
+          PlanMemory(ComputeLifetimes(nodes, std::vector<int>(outputs.begin(), outputs.end())));
+      std::vector<int64_t> offsets(plan.offsets.begin(), plan.offsets.end());
+      ShapeTuple stats{static_cast<int64_t>(plan.arena_bytes),
+                       static_cast<int64_t>(plan.naive_bytes),
+                       static_cast<int64_t>(plan.naive_peak_bytes),
+                       static_cast<int64_t>(plan.num_naive_allocs)};
+      return Array<ShapeTuple>{ShapeTuple(offsets), stats};
+    });
+
+}  // namespace runtime
+}  // namespace cvm
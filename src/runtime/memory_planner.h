@@ -0,0 +1,102 @@
+//
+// Created by WangJingYu on 2021/7/17.
+//
+
+#ifndef CVM_SRC_RUNTIME_MEMORY_PLANNER_H_
+#define CVM_SRC_RUNTIME_MEMORY_PLANNER_H_
+
+#include <cvm/runtime/ndarray.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief A node of the dataflow graph given to the planner, each node produces one tensor. */
+struct PlannerNode {
+  /*! \brief shape of the produced tensor */
+  std::vector<int64_t> shape;
+  /*! \brief data type of the produced tensor */
+  DLDataType dtype;
+  /*! \brief indices of the nodes whose tensors this node reads */
+  std::vector<int> inputs;
+};
+
+/*! \brief A tensor to be placed in the arena and the steps during which it is alive. */
+struct TensorLifetime {
+  /*! \brief size of the tensor in bytes */
+  size_t nbytes;
+  /*! \brief the step that produces the tensor */
+  int64_t first_use;
+  /*! \brief the last step that reads the tensor, inclusive */
+  int64_t last_use;
+};
+
+/*! \brief Storage assignment of a set of tensors inside one arena. */
+struct MemoryPlan {
+  /*! \brief byte offset of each tensor inside the arena */
+  std::vector<size_t> offsets;
+  /*! \brief size of the arena in bytes */
+  size_t arena_bytes{0};
+  /*! \brief bytes needed when every tensor is allocated separately and kept alive */
+  size_t naive_bytes{0};
+  /*! \brief peak bytes when every tensor is allocated separately and freed after its last use */
+  size_t naive_peak_bytes{0};
+  /*! \brief number of allocations of the naive scheme, the plan needs one */
+  size_t num_naive_allocs{0};
+};
+
+/*!
+ * \brief Derive the lifetime of every node's tensor.
+ * \param nodes The nodes in topological order, node i runs at step i.
+ * \param outputs The nodes whose tensors must stay alive until the end.
+ * \return The lifetimes, indexed by node.
+ */
+std::vector<TensorLifetime> ComputeLifetimes(const std::vector<PlannerNode>& nodes,
+                                             const std::vector<int>& outputs);
+
+/*!
+ * \brief Assign arena offsets to tensors so that tensors alive at the same step never overlap.
+ *
+ *  Tensors are placed largest first, each into the smallest gap left between the
+ *  already placed tensors it is alive together with (greedy by size, best fit).
+ *
+ * \param tensors The tensors.
+ * \param alignment The alignment of every offset.
+ * \return The plan.
+ */
+MemoryPlan PlanMemory(const std::vector<TensorLifetime>& tensors,
+                      size_t alignment = kAllocAlignment);
+
+/*!
+ * \brief Plan the tensors of nodes that may run concurrently, in any order their
+ *  dependencies allow.
+ *
+ *  The tensor of a node shares memory with the tensor of a later node only when that
+ *  node depends on every reader of the first one, the steps of ComputeLifetimes do not
+ *  order independent nodes. Outputs stay alive until the end.
+ *
+ * \param nodes The nodes in topological order.
+ * \param outputs The nodes whose tensors must stay alive until the end.
+ * \param alignment The alignment of every offset.
+ * \return The plan, the naive statistics are the ones of the sequential order.
+ */
+MemoryPlan PlanConcurrentMemory(const std::vector<PlannerNode>& nodes,
+                                const std::vector<int>& outputs,
+                                size_t alignment = kAllocAlignment);
+
+/*!
+ * \brief Allocate the arena of a plan and create a view for every node.
+ * \param plan The plan computed for the nodes.
+ * \param nodes The nodes.
+ * \param dev The device of the arena.
+ * \return The views, indexed by node.
+ */
+std::vector<NDArray> AllocatePlannedTensors(const MemoryPlan& plan,
+                                            const std::vector<PlannerNode>& nodes, Device dev);
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_MEMORY_PLANNER_H_
@@ -0,0 +1,137 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/module.h>
+#include <cvm/runtime/registry.h>
+
+#include <string>
+#include <utility>
+
+namespace cvm {
+namespace runtime {
+
+template <typename FLookup>
+const PackedFunc* ModuleNode::Cached(CacheKind kind, const std::string& name, FLookup lookup) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_[kind].find(name);
+    if (it != cache_[kind].end()) return it->second.get();
+  }
+  // the lookup runs unlocked, it may query the imports or create the function.
+  PackedFunc f = lookup();
+  std::unique_ptr<PackedFunc> entry(f != nullptr ? new PackedFunc(std::move(f)) : nullptr);
+  std::lock_guard<std::mutex> lock(mutex_);
+  // a concurrent lookup of the name may have filled the entry first, keep its function.
+  return cache_[kind].emplace(name, std::move(entry)).first->second.get();
+}
+
+PackedFunc ModuleNode::GetFunction(const std::string& name, bool query_imports) {
+  const PackedFunc* f = GetFunctionCached(name, query_imports);
+  if (f == nullptr) return PackedFunc();
+  ObjectPtr<Object> self = GetObjectPtr<Object>(this);
+  return PackedFunc([self, f](CVMArgs args, CVMRetValue* rv) { f->CallPacked(args, rv); });
+}
+
+const PackedFunc* ModuleNode::GetFunctionCached(const std::string& name, bool query_imports) {
+  const PackedFunc* f =
+      Cached(kSelf, name, [this, &name]() { return GetFunction(name, ObjectPtr<Object>()); });
+  if (f != nullptr || !query_imports) return f;
+  return Cached(kWithImports, name, [this, &name]() {
+    for (Module& m : imports_) {
+      const PackedFunc* g = m->GetFunctionCached(name, true);
+      if (g != nullptr) return *g;
+    }
+    return PackedFunc();
+  });
+}
+
+const PackedFunc* ModuleNode::GetFuncFromEnv(const std::string& name) {
+  const PackedFunc* f = Cached(kEnv, name, [this, &name]() {
+    for (Module& m : imports_) {
+      const PackedFunc* g = m->GetFunctionCached(name, true);
+      if (g != nullptr) return *g;
+    }
+    const PackedFunc* g = Registry::Get(name);
+    return g != nullptr ? *g : PackedFunc();
+  });
+  if (f == nullptr) {
+    throw Error("cannot find function " + name + " in the imported modules or the registry");
+  }
+  return f;
+}
+
+bool ModuleNode::Reaches(const ModuleNode* other) const {
+  if (this == other) return true;
+  for (const Module& m : imports_) {
+    if (m->Reaches(other)) return true;
+  }
+  return false;
+}
+
+void ModuleNode::Import(Module other) {
+  if (!other.defined()) throw Error("Import: the imported module is null");
+  if (other->Reaches(this)) {
+    throw Error(std::string("Import: importing the ") + other->type_key() +
+                " module into the " + type_key() + " module makes an import cycle");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  imports_.push_back(std::move(other));
+  // the misses may now resolve, the functions handed out stay valid.
+  for (CacheKind kind : {kWithImports, kEnv}) {
+    for (auto it = cache_[kind].begin(); it != cache_[kind].end();) {
+      it = it->second == nullptr ? cache_[kind].erase(it) : std::next(it);
+    }
+  }
+}
+
+Module Module::LoadFromFile(const std::string& file_name, const std::string& format) {
+  std::string fmt = format;
+  if (fmt.empty()) {
+    size_t pos = file_name.find_last_of('.');
+    if (pos == std::string::npos || file_name.find('/', pos) != std::string::npos) {
+      throw Error("LoadFromFile: cannot deduce the format of " + file_name);
+    }
+    fmt = file_name.substr(pos + 1);
+  }
+  if (fmt == "dll" || fmt == "dylib") fmt = "so";
+  const PackedFunc* loader = Registry::Get("runtime.module.loadfile_" + fmt);
+  if (loader == nullptr) {
+    throw Error("LoadFromFile: no loader of the format " + fmt + " for " + file_name);
+  }
+  return (*loader)(file_name, fmt);
+}
+
+CVM_REGISTER_OBJECT_TYPE(ModuleNode);
+
+CVM_REGISTER_GLOBAL("runtime.ModuleGetFunction")
+    .set_body_typed([](Module mod, std::string name, bool query_imports) {
+      return mod.GetFunction(name, query_imports);
+    });
+
+CVM_REGISTER_GLOBAL("runtime.ModuleImport").set_body_typed([](Module mod, Module other) {
+  mod.Import(other);
+});
+
+CVM_REGISTER_GLOBAL("runtime.ModuleLoadFromFile")
+    .set_body_typed([](std::string file_name, std::string format) {
+      return Module::LoadFromFile(file_name, format);
+    });
+
+CVM_REGISTER_GLOBAL("runtime.ModuleGetTypeKey").set_body_typed([](Module mod) {
+  return std::string(mod->type_key());
+});
+
+CVM_REGISTER_GLOBAL("runtime.ModuleNumImports").set_body_typed([](Module mod) {
+  return static_cast<int>(mod->imports().size());
+});
+
+CVM_REGISTER_GLOBAL("runtime.ModuleGetImport").set_body_typed([](Module mod, int index) {
+  if (index < 0 || static_cast<size_t>(index) >= mod->imports().size()) {
+    throw Error("ModuleGetImport: index " + std::to_string(index) + " out of range");
+  }
+  return mod->imports()[index];
+});
+
+}  // namespace runtime
+}  // namespace cvm
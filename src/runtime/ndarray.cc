@@ -2,17 +2,174 @@
 // Created by WangJingYu on 2021/7/6.
 //
 
+#include <cvm/runtime/device_api.h>
 #include <cvm/runtime/ndarray.h>
 
+#include "runtime_base.h"
+
 namespace cvm {
 namespace runtime {
 
+inline void VerifyDataType(DLDataType dtype) {
+  ICHECK_GE(dtype.lanes, 1);
+  if (dtype.code == kDLFloat) {
+    ICHECK_EQ(dtype.bits % 8, 0);
+  } else {
+    // allow uint1 as a special flag for bool.
+    if (dtype.bits == 1 && dtype.code == kDLUInt) return;
+    // allow int1/uint4/int4
+    else if (dtype.bits == 1 && dtype.code == kDLInt)
+      return;
+    else if (dtype.bits == 4 && dtype.code == kDLUInt)
+      return;
+    else if (dtype.bits == 4 && dtype.code == kDLInt)
+      return;
+    else
+      ICHECK_EQ(dtype.bits % 8, 0);
+  }
+  ICHECK_EQ(dtype.bits & (dtype.bits - 1), 0);
+}
+
+void ArrayCopyFromBytes(DLTensor* handle, const void* data, size_t nbytes) {
+  size_t arr_size = GetDataSize(*handle);
+  ICHECK_EQ(arr_size, nbytes) << "ArrayCopyFromBytes: size mismatch";
+  ICHECK(IsContiguous(*handle)) << "ArrayCopyFromBytes only support contiguous array for now";
+
+  DLTensor from;
+  from.data = const_cast<void*>(data);
+  from.device = Device{kDLCPU, 0};
+  from.ndim = handle->ndim;
+  from.dtype = handle->dtype;
+  from.shape = handle->shape;
+  from.strides = nullptr;
+  from.byte_offset = 0;
+  DeviceAPI::Get(handle->device)->CopyDataFromTo(&from, handle, nullptr);
+  // Synchronize in case data become unavailable later.
+  DeviceAPI::Get(handle->device)->StreamSync(handle->device, nullptr);
+}
+
+void ArrayCopyToBytes(const DLTensor* handle, void* data, size_t nbytes) {
+  size_t arr_size = GetDataSize(*handle);
+  ICHECK_EQ(arr_size, nbytes) << "ArrayCopyToBytes: size mismatch";
+  ICHECK(IsContiguous(*handle)) << "ArrayCopyToBytes only support contiguous array for now";
+
+  DLTensor to;
+  to.data = const_cast<void*>(data);
+  to.device = Device{kDLCPU, 0};
+  to.ndim = handle->ndim;
+  to.dtype = handle->dtype;
+  to.shape = handle->shape;
+  to.strides = nullptr;
+  to.byte_offset = 0;
+
+  DeviceAPI::Get(handle->device)->CopyDataFromTo(const_cast<DLTensor*>(handle), &to, nullptr);
+  // Synchronize in case data become unavailable later.
+  DeviceAPI::Get(handle->device)->StreamSync(handle->device, nullptr);
+}
+
+struct NDArray::Internal {
+  // Default deleter for the container
+  static void DefaultDeleter(Object* ptr_obj) {
+    auto* ptr = static_cast<NDArray::Container*>(ptr_obj);
+    if (ptr->manager_ctx != nullptr) {
+      static_cast<NDArray::Container*>(ptr->manager_ctx)->DecRef();
+    } else if (ptr->dl_tensor.data != nullptr) {
+      DeviceAPI::Get(ptr->dl_tensor.device)
+          ->FreeDataSpace(ptr->dl_tensor.device, ptr->dl_tensor.data);
+    }
+    delete ptr;
+  }
+  // Local create function which allocates tensor metadata
+  // but does not allocate space for the data.
+  static NDArray Create(std::vector<int64_t> shape, DLDataType dtype, Device dev) {
+    VerifyDataType(dtype);
+    NDArray::Container* data = new NDArray::Container(nullptr, std::move(shape), dtype, dev);
+    data->SetDeleter(DefaultDeleter);
+    return NDArray(GetObjectPtr<Object>(data));
+  }
+};
+
+NDArray NDArray::CreateView(std::vector<int64_t> shape, DLDataType dtype,
+                            uint64_t relative_byte_offset) {
+  ICHECK(data_ != nullptr);
+  ICHECK(get_mutable()->dl_tensor.strides == nullptr) << "Can only create view for compact tensor";
+  NDArray ret = Internal::Create(std::move(shape), dtype, get_mutable()->dl_tensor.device);
+  ret.get_mutable()->dl_tensor.byte_offset =
+      this->get_mutable()->dl_tensor.byte_offset + relative_byte_offset;
+  size_t curr_size = GetDataSize(this->get_mutable()->dl_tensor);
+  size_t view_size = GetDataSize(ret.get_mutable()->dl_tensor);
+  ICHECK_LE(relative_byte_offset + view_size, curr_size)
+      << "Tries to create a view that has bigger memory than current one";
+  // increase ref count
+  get_mutable()->IncRef();
+  ret.get_mutable()->manager_ctx = get_mutable();
+  ret.get_mutable()->dl_tensor.data = get_mutable()->dl_tensor.data;
+  return ret;
+}
+
 NDArray NDArray::Empty(std::vector<int64_t> shape, DLDataType dtype, Device device) {
-  NDArray ret;
+  NDArray ret = Internal::Create(std::move(shape), dtype, device);
+  DLTensor* tensor = &(ret.get_mutable()->dl_tensor);
+  tensor->data =
+      DeviceAPI::Get(device)->AllocDataSpace(device, tensor->ndim, tensor->shape, tensor->dtype);
+  return ret;
+}
+
+void NDArray::CopyFromBytes(const void* data, size_t nbytes) {
+  ICHECK(data_ != nullptr);
+  ArrayCopyFromBytes(&get_mutable()->dl_tensor, data, nbytes);
+}
+
+void NDArray::CopyToBytes(void* data, size_t nbytes) const {
+  ICHECK(data_ != nullptr);
+  ArrayCopyToBytes(&get_mutable()->dl_tensor, data, nbytes);
+}
+
+NDArray NDArray::CopyTo(const Device& dev) const {
+  ICHECK(data_ != nullptr);
+  const DLTensor* dptr = operator->();
+  NDArray ret = Empty(std::vector<int64_t>(dptr->shape, dptr->shape + dptr->ndim), dptr->dtype, dev);
+  this->CopyTo(ret);
   return ret;
 }
 
+void NDArray::CopyFromTo(const DLTensor* from, DLTensor* to, CVMStreamHandle stream) {
+  size_t from_size = GetDataSize(*from);
+  size_t to_size = GetDataSize(*to);
+  ICHECK_EQ(from_size, to_size) << "CVMArrayCopyFromTo: The size must exactly match";
+
+  ICHECK(from->device.device_type == to->device.device_type ||
+         from->device.device_type == kDLCPU || to->device.device_type == kDLCPU)
+      << "Can not copy across different device types directly";
+
+  // Use the device that is *not* a cpu device to get the correct device
+  // api manager.
+  Device dev = from->device.device_type != kDLCPU ? from->device : to->device;
+
+  DeviceAPI::Get(dev)->CopyDataFromTo(const_cast<DLTensor*>(from), to, stream);
+}
 
+CVM_REGISTER_OBJECT_TYPE(NDArray::Container);
 
 }  // namespace runtime
-}  // namespace cvm
\ No newline at end of file
+}  // namespace cvm
+
+using namespace cvm::runtime;
+
+int CVMArrayCopyFromTo(CVMArrayHandle from, CVMArrayHandle to, CVMStreamHandle stream) {
+  API_BEGIN();
+  NDArray::CopyFromTo(from, to, stream);
+  API_END();
+}
+
+int CVMArrayCopyFromBytes(CVMArrayHandle handle, void* data, size_t nbytes) {
+  API_BEGIN();
+  ArrayCopyFromBytes(handle, data, nbytes);
+  API_END();
+}
+
+int CVMArrayCopyToBytes(CVMArrayHandle handle, void* data, size_t nbytes) {
+  API_BEGIN();
+  ArrayCopyToBytes(handle, data, nbytes);
+  API_END();
+}
@@ -0,0 +1,314 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file op_strategy.h
+ * \brief Selection of the implementation of an op by conditions and priorities, memoized
+ *  per workload.
+ *
+ *  As the OpStrategy of docs/RelyIR.md, an op has implementations with a priority and a
+ *  specialized condition on the workload, a null condition applying to every workload.
+ *  The applicable implementation of the highest priority runs, with the plan it made for
+ *  the workload: the algorithm, the blocking parameters and whatever else only depends
+ *  on the shapes, the dtypes and the layouts.
+ *
+ *  Requests repeat the same few workloads, the selection and the plan are memoized by a
+ *  DispatchKey of the workload. The cache is an open addressing table of immutable
+ *  entries: a lookup reads it without a lock or an allocation, the first dispatch of a
+ *  key inserts it under a mutex. The tables and the entries a grow or a Clear replaced
+ *  are freed once no lookup is running, a lookup counting itself in while it reads.
+ */
+#ifndef CVM_SRC_RUNTIME_OP_STRATEGY_H_
+#define CVM_SRC_RUNTIME_OP_STRATEGY_H_
+
+#include <cvm/runtime/c_runtime_api.h>
+#include <cvm/runtime/logging.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*!
+ * \brief The words of a workload the selection depends on: its shapes, dtypes, layouts
+ *  and attributes. Two workloads of equal keys must get the same implementation and plan.
+ */
+class DispatchKey {
+ public:
+  /*! \brief The words kept inline, a longer key is not cached. */
+  static constexpr int kMaxWords = 32;
+
+  void Add(int64_t word) {
+    if (size_ < kMaxWords) words_[size_] = word;
+    ++size_;
+  }
+
+  void Add(DLDataType dtype) {
+    Add((static_cast<int64_t>(dtype.code) << 32) | (static_cast<int64_t>(dtype.bits) << 16) |
+        dtype.lanes);
+  }
+
+  /*! \brief Add the rank, the extents and the dtype of a tensor. */
+  void Add(const DLTensor& tensor) {
+    Add(static_cast<int64_t>(tensor.ndim));
+    for (int i = 0; i < tensor.ndim; ++i) Add(tensor.shape[i]);
+    Add(tensor.dtype);
+  }
+
+  bool overflowed() const { return size_ > kMaxWords; }
+
+  uint64_t Hash() const {
+    // two multiply-xor lanes over the even and the odd words, then a final mix.
+    const int n = words();
+    uint64_t a = static_cast<uint64_t>(size_), b = 0x9e3779b97f4a7c15ULL;
+    int i = 0;
+    for (; i + 1 < n; i += 2) {
+      a = (a ^ static_cast<uint64_t>(words_[i])) * 0xbf58476d1ce4e5b9ULL;
+      b = (b ^ static_cast<uint64_t>(words_[i + 1])) * 0x94d049bb133111ebULL;
+    }
+    if (i < n) a = (a ^ static_cast<uint64_t>(words_[i])) * 0xbf58476d1ce4e5b9ULL;
+    uint64_t h = a ^ (b >> 29) ^ (b << 7);
+    h = (h ^ (h >> 32)) * 0xd6e8feb86659fd93ULL;
+    return h ^ (h >> 32);
+  }
+
+  bool operator==(const DispatchKey& other) const {
+    // a loop rather than std::equal, which compiles to a call of memcmp for the few words.
+    if (size_ != other.size_) return false;
+    for (int i = 0, n = words(); i < n; ++i) {
+      if (words_[i] != other.words_[i]) return false;
+    }
+    return true;
+  }
+
+ private:
+  /*! \brief The words stored, not std::min which would bind kMaxWords to a reference. */
+  int words() const { return size_ < kMaxWords ? size_ : kMaxWords; }
+
+  int size_{0};
+  int64_t words_[kMaxWords];
+};
+
+/*! \brief An implementation of an op. */
+template <typename Workload, typename Plan>
+struct OpImplementation {
+  std::string name;
+  /*! \brief Among the applicable implementations the highest priority is selected. */
+  int priority;
+  /*! \brief The specialized condition, null when the implementation applies everywhere. */
+  std::function<bool(const Workload&)> condition;
+  /*! \brief Make the plan of a workload. */
+  std::function<Plan(const Workload&)> make_plan;
+};
+
+/*!
+ * \brief The implementations of an op and the cache of their selection.
+ * \tparam Workload What the conditions and the plans are computed from.
+ * \tparam Plan The precomputed plan, copied out of the cache by every dispatch.
+ */
+template <typename Workload, typename Plan>
+class OpStrategy {
+ public:
+  using Implementation = OpImplementation<Workload, Plan>;
+
+  /*! \brief The selected implementation of a workload and its plan. */
+  struct Selection {
+    const Implementation* impl;
+    Plan plan;
+  };
+
+  /*!
+   * \param op The name of the op, for the errors.
+   * \param impls The implementations, ties of priority go to the first one.
+   * \param max_entries The workloads cached, others are selected on every dispatch.
+   */
+  OpStrategy(std::string op, std::vector<Implementation> impls, size_t max_entries = 4096)
+      : op_(std::move(op)), impls_(std::move(impls)), max_entries_(max_entries) {
+    Publish(NewTable(kInitialCapacity));
+  }
+
+  OpStrategy(const OpStrategy&) = delete;
+  OpStrategy& operator=(const OpStrategy&) = delete;
+
+  /*! \return The selection of a workload, without the cache. Throws when none applies. */
+  Selection Select(const Workload& workload) const {
+    const Implementation* best = nullptr;
+    for (const Implementation& impl : impls_) {
+      if (best != nullptr && impl.priority <= best->priority) continue;
+      if (impl.condition == nullptr || impl.condition(workload)) best = &impl;
+    }
+    if (best == nullptr) throw Error(op_ + ": no implementation applies to the workload");
+    return Selection{best, best->make_plan(workload)};
+  }
+
+  /*!
+   * \return The selection of a workload, from the cache once its key has been seen.
+   * \param key The key of the workload.
+   */
+  Selection Dispatch(const DispatchKey& key, const Workload& workload) {
+    if (key.overflowed()) return Select(workload);
+    const uint64_t hash = key.Hash();
+    {
+      ReadGuard guard(this);
+      const Entry* entry = Find(table_.load(std::memory_order_seq_cst), key, hash);
+      if (entry != nullptr) return entry->selection;
+    }
+    return Insert(key, hash, workload);
+  }
+
+  /*!
+   * \brief Drop the cached selections, when what the plans depend on changed. The
+   *  entries are freed once the lookups running concurrently are done with them.
+   */
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Publish(NewTable(kInitialCapacity));
+    for (std::unique_ptr<Entry>& entry : entries_) retired_entries_.push_back(std::move(entry));
+    entries_.clear();
+    size_ = 0;
+    Reclaim();
+  }
+
+  /*! \return The workloads cached. */
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  const std::string& op() const { return op_; }
+
+ private:
+  static constexpr size_t kInitialCapacity = 64;
+
+  struct Entry {
+    DispatchKey key;
+    uint64_t hash;
+    Selection selection;
+  };
+
+  /*! \brief A table of capacity mask + 1 slots, never filled past half. */
+  struct Table {
+    size_t mask;
+    std::unique_ptr<std::atomic<const Entry*>[]> slots;
+  };
+
+  static const Entry* Find(const Table* table, const DispatchKey& key, uint64_t hash) {
+    for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+      const Entry* entry = table->slots[i].load(std::memory_order_acquire);
+      if (entry == nullptr) return nullptr;
+      if (entry->hash == hash && entry->key == key) return entry;
+    }
+  }
+
+  /*! \brief Counts a lookup in the readers_ while it reads the table and its entries. */
+  class ReadGuard {
+   public:
+    explicit ReadGuard(OpStrategy* strategy) : strategy_(strategy) {
+      strategy_->readers_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    ~ReadGuard() {
+      // the last reader out frees what the writers could not, unless one of them is busy.
+      if (strategy_->readers_.fetch_sub(1, std::memory_order_seq_cst) != 1) return;
+      if (!strategy_->has_retired_.load(std::memory_order_relaxed)) return;
+      std::unique_lock<std::mutex> lock(strategy_->mutex_, std::try_to_lock);
+      if (lock.owns_lock()) strategy_->Reclaim();
+    }
+
+   private:
+    OpStrategy* strategy_;
+  };
+
+  static void Place(Table* table, const Entry* entry) {
+    size_t i = entry->hash & table->mask;
+    while (table->slots[i].load(std::memory_order_relaxed) != nullptr) i = (i + 1) & table->mask;
+    table->slots[i].store(entry, std::memory_order_release);
+  }
+
+  static std::unique_ptr<Table> NewTable(size_t capacity) {
+    std::unique_ptr<Table> table(new Table{capacity - 1, nullptr});
+    table->slots.reset(new std::atomic<const Entry*>[capacity]);
+    for (size_t i = 0; i < capacity; ++i) table->slots[i].store(nullptr, std::memory_order_relaxed);
+    return table;
+  }
+
+  /*! \brief Replace the table of the lookups, the old one is retired. Holds mutex_. */
+  void Publish(std::unique_ptr<Table> table) {
+    table_.store(table.get(), std::memory_order_seq_cst);
+    if (current_ != nullptr) {
+      retired_tables_.push_back(std::move(current_));
+      has_retired_.store(true, std::memory_order_relaxed);
+    }
+    current_ = std::move(table);
+  }
+
+  /*!
+   * \brief Free the retired tables and entries when no lookup is running. Holds mutex_.
+   *  A lookup counted in after the check loads the table published before the retirement,
+   *  the counter and table_ being sequentially consistent.
+   */
+  void Reclaim() {
+    if (!has_retired_.load(std::memory_order_relaxed)) return;
+    if (readers_.load(std::memory_order_seq_cst) != 0) return;
+    retired_tables_.clear();
+    retired_entries_.clear();
+    has_retired_.store(false, std::memory_order_relaxed);
+  }
+
+  Selection Insert(const DispatchKey& key, uint64_t hash, const Workload& workload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Table* table = current_.get();
+    // another thread may have inserted the key meanwhile.
+    const Entry* found = Find(table, key, hash);
+    if (found != nullptr) return found->selection;
+    if (size_ >= max_entries_) return Select(workload);
+    entries_.emplace_back(new Entry{key, hash, Select(workload)});
+    const Entry* entry = entries_.back().get();
+    if (2 * (size_ + 1) > table->mask + 1) {
+      // readers of the old table finish on it, it is retired rather than freed.
+      std::unique_ptr<Table> grown = NewTable(2 * (table->mask + 1));
+      for (size_t i = 0; i <= table->mask; ++i) {
+        const Entry* e = table->slots[i].load(std::memory_order_relaxed);
+        if (e != nullptr) Place(grown.get(), e);
+      }
+      Place(grown.get(), entry);
+      Publish(std::move(grown));
+      Reclaim();
+    } else {
+      Place(table, entry);
+    }
+    ++size_;
+    return entry->selection;
+  }
+
+  const std::string op_;
+  const std::vector<Implementation> impls_;
+  const size_t max_entries_;
+  /*! \brief The table of the lookups. */
+  std::atomic<Table*> table_{nullptr};
+  /*! \brief The lookups running. */
+  std::atomic<int> readers_{0};
+  /*! \brief Whether there are retired tables or entries, a hint for the readers. */
+  std::atomic<bool> has_retired_{false};
+  /*! \brief Serializes the writers, the fields below belong to them. */
+  mutable std::mutex mutex_;
+  size_t size_{0};
+  std::unique_ptr<Table> current_;
+  std::vector<std::unique_ptr<Entry>> entries_;
+  /*! \brief Replaced but maybe still read by a lookup. */
+  std::vector<std::unique_ptr<Table>> retired_tables_;
+  std::vector<std::unique_ptr<Entry>> retired_entries_;
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_OP_STRATEGY_H_
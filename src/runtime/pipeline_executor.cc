@@ -0,0 +1,261 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include "pipeline_executor.h"
+
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+#include "ring_buffer.h"
+
+namespace cvm {
+namespace runtime {
+
+namespace {
+
+/*! \brief The buckets of the latency histogram, the last one up to 2^31 us. */
+constexpr int kNumLatencyBuckets = 32;
+
+int64_t Nanoseconds(PipelineExecutor::Clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+}  // namespace
+
+/*! \brief A queue between stages, see BlockingQueue. */
+class PipelineExecutor::Queue {
+ public:
+  virtual ~Queue() = default;
+  virtual bool Push(Item&& item) = 0;
+  virtual bool TryPush(Item&& item) = 0;
+  virtual bool Pop(Item* out) = 0;
+  virtual bool TryPop(Item* out) = 0;
+  virtual void Close() = 0;
+};
+
+template <typename Ring>
+class PipelineExecutor::RingQueue final : public PipelineExecutor::Queue,
+                                          public CacheLineAligned {
+ public:
+  explicit RingQueue(size_t capacity) : queue_(capacity) {}
+  bool Push(Item&& item) final { return queue_.Push(std::move(item)); }
+  bool TryPush(Item&& item) final { return queue_.TryPush(std::move(item)); }
+  bool Pop(Item* out) final { return queue_.Pop(out); }
+  bool TryPop(Item* out) final { return queue_.TryPop(out); }
+  void Close() final { queue_.Close(); }
+
+ private:
+  BlockingQueue<Item, Ring> queue_;
+};
+
+double PipelineStats::LatencyQuantileUs(double q) const {
+  int64_t total = std::accumulate(latency_histogram.begin(), latency_histogram.end(),
+                                  static_cast<int64_t>(0));
+  if (total == 0) return 0;
+  int64_t rank = static_cast<int64_t>(std::ceil(q * total));
+  int64_t seen = 0;
+  for (size_t i = 0; i < latency_histogram.size(); ++i) {
+    seen += latency_histogram[i];
+    if (seen >= rank) return std::ldexp(1.0, static_cast<int>(i));
+  }
+  return std::ldexp(1.0, static_cast<int>(latency_histogram.size()));
+}
+
+PipelineExecutor::PipelineExecutor(std::vector<StageConfig> stages, size_t output_capacity)
+    : stages_(std::move(stages)) {
+  if (stages_.empty()) throw Error("PipelineExecutor: the pipeline has no stage");
+  for (const StageConfig& stage : stages_) {
+    if (stage.func == nullptr) throw Error("PipelineExecutor: stage " + stage.name + " is null");
+    if (stage.num_threads < 1) {
+      throw Error("PipelineExecutor: stage " + stage.name + " needs a thread");
+    }
+  }
+  size_t n = stages_.size();
+  for (size_t i = 0; i <= n; ++i) {
+    // the input and the output of the pipeline have any number of outside threads.
+    bool single_producer = i > 0 && stages_[i - 1].num_threads == 1;
+    bool single_consumer = i < n && stages_[i].num_threads == 1;
+    size_t capacity = i < n ? stages_[i].queue_capacity : output_capacity;
+    if (single_producer && single_consumer) {
+      queues_.emplace_back(new RingQueue<SPSCRing<Item>>(capacity));
+    } else {
+      queues_.emplace_back(new RingQueue<MPMCRing<Item>>(capacity));
+    }
+  }
+  counters_.reset(new StageCounters[n]);
+  latency_histogram_.assign(kNumLatencyBuckets, 0);
+  start_ = Clock::now();
+  for (size_t s = 0; s < n; ++s) {
+    counters_[s].running.store(stages_[s].num_threads);
+    for (int t = 0; t < stages_[s].num_threads; ++t) {
+      threads_.emplace_back([this, s, t]() { this->StageLoop(static_cast<int>(s), t); });
+    }
+  }
+}
+
+PipelineExecutor::~PipelineExecutor() {
+  try {
+    Drain();
+  } catch (...) {
+    // the error of a failed stage, of any type, has been thrown by Push or Pop already, or
+    // is dropped.
+  }
+}
+
+void PipelineExecutor::Push(ObjectRef item) {
+  RethrowIfFailed();
+  if (drained_.load()) throw Error("PipelineExecutor: push after Drain");
+  if (!queues_.front()->Push(Item{std::move(item), Clock::now()})) {
+    RethrowIfFailed();
+    throw Error("PipelineExecutor: push after Drain");
+  }
+}
+
+bool PipelineExecutor::TryPush(ObjectRef item) {
+  RethrowIfFailed();
+  if (drained_.load()) throw Error("PipelineExecutor: push after Drain");
+  if (queues_.front()->TryPush(Item{std::move(item), Clock::now()})) return true;
+  // a closed queue is not full, the pipeline failed or has been drained meanwhile.
+  RethrowIfFailed();
+  if (drained_.load()) throw Error("PipelineExecutor: push after Drain");
+  return false;
+}
+
+bool PipelineExecutor::Pop(ObjectRef* out) {
+  RethrowIfFailed();
+  Item item;
+  if (!queues_.back()->Pop(&item)) {
+    RethrowIfFailed();
+    return false;
+  }
+  RecordOutput(item);
+  *out = std::move(item.value);
+  return true;
+}
+
+bool PipelineExecutor::TryPop(ObjectRef* out) {
+  RethrowIfFailed();
+  Item item;
+  if (!queues_.back()->TryPop(&item)) return false;
+  RecordOutput(item);
+  *out = std::move(item.value);
+  return true;
+}
+
+void PipelineExecutor::Drain(std::vector<ObjectRef>* rest) {
+  drained_.store(true);
+  queues_.front()->Close();
+  // the stages may be blocked on a full output, pop until the last stage closes it.
+  Item item;
+  while (queues_.back()->Pop(&item)) {
+    RecordOutput(item);
+    if (rest != nullptr) rest->push_back(std::move(item.value));
+  }
+  for (std::thread& t : threads_) {
+    if (t.joinable()) t.join();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!joined_) {
+      joined_ = true;
+      end_ = Clock::now();
+    }
+  }
+  RethrowIfFailed();
+}
+
+PipelineStats PipelineExecutor::Stats() const {
+  PipelineStats stats;
+  Clock::time_point end;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.num_outputs = num_outputs_;
+    stats.latency_histogram = latency_histogram_;
+    end = joined_ ? end_ : Clock::now();
+  }
+  double wall = std::chrono::duration<double>(end - start_).count();
+  for (size_t s = 0; s < stages_.size(); ++s) {
+    const StageCounters& c = counters_[s];
+    StageStats st;
+    st.name = stages_[s].name;
+    st.num_items = c.num_items.load();
+    st.busy_seconds = c.busy_ns.load() * 1e-9;
+    st.starved_seconds = c.starved_ns.load() * 1e-9;
+    st.blocked_seconds = c.blocked_ns.load() * 1e-9;
+    st.utilization = wall > 0 ? st.busy_seconds / (wall * stages_[s].num_threads) : 0;
+    stats.stages.push_back(std::move(st));
+  }
+  return stats;
+}
+
+void PipelineExecutor::StageLoop(int stage, int thread) {
+  const StageConfig& config = stages_[stage];
+  if (!config.cpus.empty()) {
+    threading::SetCurrentThreadAffinity({config.cpus[thread % config.cpus.size()]});
+  }
+  Queue* in = queues_[stage].get();
+  Queue* out = queues_[stage + 1].get();
+  StageCounters& counters = counters_[stage];
+  Item item;
+  while (!failed_.load(std::memory_order_relaxed)) {
+    Clock::time_point t0 = Clock::now();
+    if (!in->Pop(&item)) break;
+    Clock::time_point t1 = Clock::now();
+    counters.starved_ns.fetch_add(Nanoseconds(t1 - t0), std::memory_order_relaxed);
+    bool dropped = false;
+    try {
+      CVMRetValue rv = config.func(item.value);
+      dropped = rv.type_code() == kCVMNullptr;
+      if (!dropped) item.value = rv.operator ObjectRef();
+    } catch (...) {
+      Fail(std::current_exception());
+      break;
+    }
+    Clock::time_point t2 = Clock::now();
+    counters.busy_ns.fetch_add(Nanoseconds(t2 - t1), std::memory_order_relaxed);
+    counters.num_items.fetch_add(1, std::memory_order_relaxed);
+    if (dropped) {
+      item.value = ObjectRef();
+      continue;
+    }
+    if (!out->Push(std::move(item))) break;
+    counters.blocked_ns.fetch_add(Nanoseconds(Clock::now() - t2), std::memory_order_relaxed);
+  }
+  if (counters.running.fetch_sub(1) == 1) out->Close();
+}
+
+void PipelineExecutor::Fail(std::exception_ptr error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_ == nullptr) error_ = error;
+  }
+  failed_.store(true);
+  for (auto& queue : queues_) queue->Close();
+}
+
+void PipelineExecutor::RethrowIfFailed() const {
+  if (!failed_.load()) return;
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    error = error_;
+  }
+  std::rethrow_exception(error);
+}
+
+void PipelineExecutor::RecordOutput(const Item& item) {
+  double latency = std::chrono::duration<double, std::micro>(Clock::now() - item.pushed).count();
+  int bucket = latency < 1 ? 0 : std::min(static_cast<int>(std::log2(latency)) + 1,
+                                          kNumLatencyBuckets - 1);
+  std::lock_guard<std::mutex> lock(mutex_);
+  num_outputs_ += 1;
+  latency_histogram_[bucket] += 1;
+}
+
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,176 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file pipeline_executor.h
+ * \brief Runs a chain of stages concurrently, each on its own group of threads.
+ *
+ *  A stage is a PackedFunc from an object to an object, typically an NDArray batch to the
+ *  next one. Stages are connected by bounded queues over lock-free rings: a single
+ *  producer single consumer ring between two single threaded stages, a multi producer
+ *  multi consumer ring otherwise. In steady state every stage works on its own item, the
+ *  throughput is the one of the slowest stage rather than of the sum of the stages.
+ */
+#ifndef CVM_SRC_RUNTIME_PIPELINE_EXECUTOR_H_
+#define CVM_SRC_RUNTIME_PIPELINE_EXECUTOR_H_
+
+#include <cvm/runtime/object.h>
+#include <cvm/runtime/packed_func.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief A stage of a pipeline. */
+struct StageConfig {
+  std::string name;
+  /*! \brief The function of the stage, a null result drops the item. */
+  PackedFunc func;
+  /*! \brief The threads of the stage, more than one may reorder the items. */
+  int num_threads{1};
+  /*!
+   * \brief The CPUs of the threads: thread i is bound to cpus[i % cpus.size()], the
+   *  threads are left unbound when empty.
+   */
+  std::vector<unsigned> cpus;
+  /*! \brief The capacity of the input queue of the stage, rounded up to a power of two. */
+  size_t queue_capacity{16};
+};
+
+/*! \brief The counters of a stage. */
+struct StageStats {
+  std::string name;
+  int64_t num_items{0};
+  /*! \brief The seconds spent in the function of the stage, over all its threads. */
+  double busy_seconds{0};
+  /*! \brief The seconds spent waiting for an input. */
+  double starved_seconds{0};
+  /*! \brief The seconds spent waiting for room in the next queue, the backpressure. */
+  double blocked_seconds{0};
+  /*! \brief The share of the wall time its threads were busy, from 0 to 1. */
+  double utilization{0};
+};
+
+/*! \brief The counters of a pipeline. */
+struct PipelineStats {
+  std::vector<StageStats> stages;
+  /*! \brief The items popped from the output. */
+  int64_t num_outputs{0};
+  /*!
+   * \brief The outputs by latency from Push to Pop: bucket i counts the latencies in
+   *  [2^(i-1), 2^i) microseconds, bucket 0 the latencies under one microsecond.
+   */
+  std::vector<int64_t> latency_histogram;
+
+  /*! \return An upper bound of the q quantile of the latency, in microseconds. */
+  double LatencyQuantileUs(double q) const;
+};
+
+/*!
+ * \brief Runs the stages of a pipeline on their threads.
+ *
+ *  Push blocks while the first queue is full and every stage blocks while its next queue
+ *  is full, so a slow stage holds back the ones before it instead of letting the queues
+ *  grow. Drain closes the input: the stages finish the items in flight and exit, and the
+ *  output closes after the last item. When a stage throws, the pipeline stops, the
+ *  queued items are dropped and Push and Pop rethrow the Error.
+ */
+class PipelineExecutor {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /*!
+   * \brief Start the threads of the stages, throws an Error for malformed stages.
+   * \param stages The stages, in order.
+   * \param output_capacity The capacity of the output queue.
+   */
+  explicit PipelineExecutor(std::vector<StageConfig> stages, size_t output_capacity = 16);
+
+  /*! \brief Drain the pipeline, dropping the remaining outputs. */
+  ~PipelineExecutor();
+
+  PipelineExecutor(const PipelineExecutor&) = delete;
+  PipelineExecutor& operator=(const PipelineExecutor&) = delete;
+
+  /*! \brief Push an item, waits while the first queue is full, throws after Drain. */
+  void Push(ObjectRef item);
+
+  /*! \return Whether the item has been pushed, false when the first queue is full. */
+  bool TryPush(ObjectRef item);
+
+  /*!
+   * \brief Pop an output, waits until there is one.
+   * \return Whether an output has been popped, false once drained.
+   */
+  bool Pop(ObjectRef* out);
+
+  /*! \return Whether an output has been popped, false when there is none yet. */
+  bool TryPop(ObjectRef* out);
+
+  /*!
+   * \brief Close the input and wait for the stages to finish the items in flight.
+   * \param rest The outputs not popped yet, appended in order, dropped when null.
+   */
+  void Drain(std::vector<ObjectRef>* rest = nullptr);
+
+  /*! \return A snapshot of the counters. */
+  PipelineStats Stats() const;
+
+ private:
+  /*! \brief An item in flight, with the time it was pushed. */
+  struct Item {
+    ObjectRef value;
+    Clock::time_point pushed;
+  };
+
+  class Queue;
+  template <typename Ring>
+  class RingQueue;
+
+  /*! \brief The counters of a stage, updated by its threads. */
+  struct StageCounters {
+    std::atomic<int64_t> num_items{0};
+    std::atomic<int64_t> busy_ns{0};
+    std::atomic<int64_t> starved_ns{0};
+    std::atomic<int64_t> blocked_ns{0};
+    /*! \brief The threads still running, the last one closes the next queue. */
+    std::atomic<int> running{0};
+  };
+
+  void StageLoop(int stage, int thread);
+  /*! \brief Record the first error and close every queue. */
+  void Fail(std::exception_ptr error);
+  void RethrowIfFailed() const;
+  void RecordOutput(const Item& item);
+
+  std::vector<StageConfig> stages_;
+  /*! \brief queues_[i] is the input of stage i, the last one the output of the pipeline. */
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::unique_ptr<StageCounters[]> counters_;
+  std::vector<std::thread> threads_;
+  Clock::time_point start_;
+  std::atomic<bool> drained_{false};
+
+  mutable std::mutex mutex_;
+  std::exception_ptr error_;
+  std::atomic<bool> failed_{false};
+  int64_t num_outputs_{0};
+  std::vector<int64_t> latency_histogram_;
+  /*! \brief When the threads finished, for the utilization of a drained pipeline. */
+  Clock::time_point end_;
+  bool joined_{false};
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_PIPELINE_EXECUTOR_H_
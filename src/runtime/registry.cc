@@ -69,11 +69,6 @@ std::vector<std::string> Registry::ListNames() {
   return keys;
 }
 
-#define CVM_FUNC_REG_VAR_DEF static CVM_ATTRIBUTE_UNUSED ::cvm::runtime::Registry& __mk_##CVM
-
-#define CVM_REGISTER_GLOBAL(OpName) \
-  CVM_STR_CONCAT(CVM_FUNC_REG_VAR_DEF, __COUNTER__) = ::cvm::runtime::Registry::Register(OpName)
-
 }  // namespace runtime
 }  // namespace cvm
 
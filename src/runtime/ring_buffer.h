@@ -0,0 +1,311 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file ring_buffer.h
+ * \brief Bounded lock-free ring buffers and a blocking queue built on them.
+ */
+#ifndef CVM_SRC_RUNTIME_RING_BUFFER_H_
+#define CVM_SRC_RUNTIME_RING_BUFFER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief The size of a cache line, the indices of the rings live on their own lines. */
+constexpr size_t kCacheLineSize = 64;
+
+/*!
+ * \brief A base giving a class of cache line aligned members a heap allocation of that
+ *  alignment, which operator new only guarantees from C++17 on.
+ */
+struct CacheLineAligned {
+  static void* operator new(size_t size) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, kCacheLineSize, size) != 0) throw std::bad_alloc();
+    return ptr;
+  }
+
+  static void operator delete(void* ptr) { free(ptr); }
+};
+
+/*! \return The smallest power of two not below n, at least 2. */
+inline size_t RingCapacity(size_t n) {
+  size_t c = 2;
+  while (c < n) c <<= 1;
+  return c;
+}
+
+/*!
+ * \brief A single producer single consumer ring.
+ *
+ *  The producer owns the tail and the consumer the head, each keeps a cached copy of the
+ *  index of the other side and reloads it only when the ring looks full or empty, so a
+ *  push or a pop in steady state touches no line written by the other side.
+ */
+template <typename T>
+class SPSCRing : public CacheLineAligned {
+ public:
+  /*! \param capacity The slots, rounded up to a power of two. */
+  explicit SPSCRing(size_t capacity)
+      : mask_(RingCapacity(capacity) - 1), slots_(new T[mask_ + 1]) {}
+
+  size_t capacity() const { return mask_ + 1; }
+
+  /*! \return Whether the value has been pushed, false when the ring is full. */
+  bool TryPush(T&& value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_) return false;
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*! \return Whether a value has been popped, false when the ring is empty. */
+  bool TryPop(T* out) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) return false;
+    }
+    *out = std::move(slots_[head & mask_]);
+    // the moved from slot releases its value now rather than when overwritten.
+    slots_[head & mask_] = T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  const size_t mask_;
+  std::unique_ptr<T[]> slots_;
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  size_t cached_tail_{0};
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  size_t cached_head_{0};
+};
+
+/*!
+ * \brief A multi producer multi consumer ring.
+ *
+ *  Every slot carries a sequence number telling whether it is free for the push of a
+ *  lap or full for its pop, producers and consumers claim slots by a compare and swap
+ *  of the tail and the head (D. Vyukov's bounded queue).
+ */
+template <typename T>
+class MPMCRing : public CacheLineAligned {
+ public:
+  /*! \param capacity The slots, rounded up to a power of two. */
+  explicit MPMCRing(size_t capacity)
+      : mask_(RingCapacity(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  /*! \return Whether the value has been pushed, false when the ring is full. */
+  bool TryPush(T&& value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[pos & mask_];
+      size_t seq = cell.seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /*! \return Whether a value has been popped, false when the ring is empty. */
+  bool TryPop(T* out) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[pos & mask_];
+      size_t seq = cell.seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          *out = std::move(cell.value);
+          cell.value = T();
+          cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+};
+
+/*!
+ * \brief Parks threads until a condition another thread makes true, without a lock on
+ *  the path of the notifier when nobody waits.
+ *
+ *  A waiter calls PrepareWait, checks its condition again and then either CancelWait or
+ *  Wait, the notifier makes the condition true before calling Notify.
+ */
+class EventCount {
+ public:
+  uint64_t PrepareWait() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_seq_cst);
+  }
+
+  void CancelWait() { waiters_.fetch_sub(1, std::memory_order_seq_cst); }
+
+  void Wait(uint64_t epoch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this, epoch]() { return epoch_.load(std::memory_order_relaxed) != epoch; });
+    waiters_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  void Notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) == 0) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      epoch_.fetch_add(1, std::memory_order_relaxed);
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  std::atomic<int> waiters_{0};
+  std::atomic<uint64_t> epoch_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+/*!
+ * \brief A bounded blocking queue over a ring: a push waits while the queue is full,
+ *  which is the backpressure of a pipeline, a pop waits while it is empty. Once closed
+ *  pushes fail and pops return the remaining values, then fail.
+ *
+ *  A blocked thread spins a little, yields, then parks on an EventCount. The pushes in
+ *  progress are counted, a pop after the close waits for them so that the value of a
+ *  push which checked the queue open before the close is not left behind.
+ */
+template <typename T, typename Ring>
+class BlockingQueue : public CacheLineAligned {
+ public:
+  explicit BlockingQueue(size_t capacity) : ring_(capacity) {}
+
+  size_t capacity() const { return ring_.capacity(); }
+
+  /*! \return Whether the value has been pushed, false when the queue is full or closed. */
+  bool TryPush(T&& value) {
+    pushers_.fetch_add(1, std::memory_order_seq_cst);
+    bool pushed = !closed() && PushOnce(std::move(value));
+    pushers_.fetch_sub(1, std::memory_order_seq_cst);
+    return pushed;
+  }
+
+  bool TryPop(T* out) {
+    if (!ring_.TryPop(out)) return false;
+    not_full_.Notify();
+    return true;
+  }
+
+  /*! \return Whether the value has been pushed, false when the queue is closed. */
+  bool Push(T&& value) {
+    pushers_.fetch_add(1, std::memory_order_seq_cst);
+    bool pushed =
+        !closed() && Block(&not_full_, [&]() { return this->PushOnce(std::move(value)); });
+    pushers_.fetch_sub(1, std::memory_order_seq_cst);
+    return pushed;
+  }
+
+  /*! \return Whether a value has been popped, false when the queue is closed and empty. */
+  bool Pop(T* out) {
+    if (Block(&not_empty_, [&]() { return this->TryPop(out); })) return true;
+    // the values pushed before the close, the pushes in progress finish first.
+    while (pushers_.load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+    return TryPop(out);
+  }
+
+  void Close() {
+    closed_.store(true, std::memory_order_seq_cst);
+    not_empty_.Notify();
+    not_full_.Notify();
+  }
+
+  /*! \brief Sequentially consistent with pushers_, see Pop. */
+  bool closed() const { return closed_.load(std::memory_order_seq_cst); }
+
+ private:
+  /*! \brief The yields of a blocked thread before it parks. */
+  static constexpr int kYieldCount = 16;
+
+  bool PushOnce(T&& value) {
+    if (!ring_.TryPush(std::move(value))) return false;
+    not_empty_.Notify();
+    return true;
+  }
+
+  template <typename FTry>
+  bool Block(EventCount* event, FTry try_once) {
+    for (int i = 0; i < kYieldCount; ++i) {
+      if (try_once()) return true;
+      if (closed()) return false;
+      std::this_thread::yield();
+    }
+    while (true) {
+      uint64_t epoch = event->PrepareWait();
+      if (try_once()) {
+        event->CancelWait();
+        return true;
+      }
+      if (closed()) {
+        event->CancelWait();
+        return false;
+      }
+      event->Wait(epoch);
+    }
+  }
+
+  Ring ring_;
+  std::atomic<bool> closed_{false};
+  /*! \brief The pushes in progress. */
+  std::atomic<int> pushers_{0};
+  EventCount not_empty_;
+  EventCount not_full_;
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_RING_BUFFER_H_
@@ -0,0 +1,81 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/registry.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "library_module.h"
+#include "runtime_base.h"
+
+namespace cvm {
+namespace runtime {
+
+/*!
+ * \brief The symbols registered by statically linked code.
+ *
+ *  Registering a symbol is an insertion into a hash map, a table of symbols is inserted
+ *  at once, so the system library is ready without opening or relocating anything.
+ */
+class SystemLibrary final : public Library {
+ public:
+  void* GetSymbol(const char* name) final {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = symbols_.find(name);
+    return it != symbols_.end() ? it->second : nullptr;
+  }
+
+  void Register(const CVMSystemLibEntry* entries, int num_entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    symbols_.reserve(symbols_.size() + num_entries);
+    for (int i = 0; i < num_entries; ++i) {
+      if (entries[i].name == nullptr || entries[i].ptr == nullptr) {
+        throw Error("system library: a symbol needs a name and an address");
+      }
+      auto it = symbols_.emplace(entries[i].name, entries[i].ptr).first;
+      if (it->second != entries[i].ptr) {
+        throw Error(std::string("system library: symbol ") + entries[i].name +
+                    " registered twice with different addresses");
+      }
+    }
+  }
+
+  static SystemLibrary* Global() {
+    // not made by make_object, so never deleted: static initializers and destructors of
+    // other libraries may still use it.
+    static SystemLibrary* inst = new SystemLibrary();
+    return inst;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, void*> symbols_;
+};
+
+Module Module::SystemLib() {
+  static Module mod = CreateModuleFromLibrary(GetObjectPtr<Library>(SystemLibrary::Global()));
+  return mod;
+}
+
+CVM_REGISTER_GLOBAL("runtime.SystemLib").set_body_typed([]() { return Module::SystemLib(); });
+
+}  // namespace runtime
+}  // namespace cvm
+
+using namespace cvm::runtime;
+
+int CVMBackendRegisterSystemLibSymbol(const char* name, void* ptr) {
+  API_BEGIN();
+  CVMSystemLibEntry entry{name, ptr};
+  SystemLibrary::Global()->Register(&entry, 1);
+  API_END();
+}
+
+int CVMBackendRegisterSystemLibTable(const CVMSystemLibEntry* entries, int num_entries) {
+  API_BEGIN();
+  SystemLibrary::Global()->Register(entries, num_entries);
+  API_END();
+}
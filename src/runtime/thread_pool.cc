@@ -0,0 +1,471 @@
+//
+// Created by WangJingYu on 2021/7/18.
+//
+
+#include "thread_pool.h"
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/logging.h>
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "runtime_base.h"
+
+namespace cvm {
+namespace runtime {
+
+namespace {
+
+/*! \brief default number of spin iterations of an idle worker before it parks */
+constexpr int kDefaultSpinCount = 20000;
+constexpr size_t kCacheLineSize = 64;
+
+inline void CPUPause() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+/*! \brief Pause a bit and hand the core over from time to time, iter counts the calls. */
+inline void Backoff(int* iter) {
+  if (++(*iter) % 256 == 0) {
+    threading::Yield();
+  } else {
+    CPUPause();
+  }
+}
+
+inline uint32_t NextRandom(uint32_t* seed) {
+  uint32_t x = *seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *seed = x;
+}
+
+int GetEnvInt(const char* name, int default_value) {
+  const char* val = getenv(name);
+  return val == nullptr ? default_value : atoi(val);
+}
+
+std::vector<unsigned> ParseCPUList(const char* str) {
+  std::vector<unsigned> cpus;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) cpus.push_back(static_cast<unsigned>(std::stoul(item)));
+  }
+  return cpus;
+}
+
+/*! \brief whether the current thread runs a job of the pool */
+thread_local bool in_parallel_region = false;
+
+/*! \brief Test-and-test-and-set lock, the critical sections it guards are a few instructions. */
+class SpinLock {
+ public:
+  void lock() {
+    int iter = 0;
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      while (locked_.load(std::memory_order_relaxed)) Backoff(&iter);
+    }
+  }
+  void unlock() { locked_.store(false, std::memory_order_release); }
+
+ private:
+  std::atomic<bool> locked_{false};
+};
+
+}  // namespace
+
+/*! \brief The ranges owned by one thread, padded so that two queues never share a cache line. */
+struct ThreadPool::WorkerQueue {
+  SpinLock lock;
+  std::deque<std::pair<int64_t, int64_t>> ranges;
+  char padding[64];
+};
+
+/*!
+ * \brief The reduction slot of one task, written by its owner only.
+ *  Reductions alternate between two buffers: a task can only store its next
+ *  value after every task passed the barrier of the current reduction, that
+ *  is after they all finished reading the previous buffer.
+ */
+struct ThreadPool::ReduceSlot {
+  char data[2][kParallelReduceMaxBytes];
+  /*! \brief number of reductions the owner took part in during the current launch */
+  int num_reduce;
+  char padding[kCacheLineSize - sizeof(int)];
+};
+
+struct ThreadPool::Job {
+  enum Kind { kRange, kLaunch };
+  Kind kind;
+  /*! \brief the epoch the job has been published at */
+  uint64_t epoch{0};
+  // range job
+  const FRange* frange{nullptr};
+  int64_t grain{1};
+  /*! \brief number of indices not executed yet */
+  std::atomic<int64_t> remaining{0};
+  // launch job
+  FCVMParallelLambda flambda{nullptr};
+  void* cdata{nullptr};
+  CVMParallelGroupEnv env{nullptr, 0};
+  std::atomic<int> next_task{0};
+  std::atomic<int> finished_tasks{0};
+  // barrier of a launch job: the last task to arrive resets the count and starts a new generation.
+  alignas(kCacheLineSize) std::atomic<int> barrier_count{0};
+  alignas(kCacheLineSize) std::atomic<uint32_t> barrier_generation{0};
+  // first error, later range chunks are skipped once it is set
+  std::atomic<bool> has_error{false};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  void SetError(std::exception_ptr err) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!error) error = std::move(err);
+    has_error.store(true);
+  }
+};
+
+ThreadPool* ThreadPool::Global() {
+  // never destroyed: workers may still be parked when static destructors run
+  static ThreadPool* pool = new ThreadPool();
+  return pool;
+}
+
+bool ThreadPool::InParallelRegion() { return in_parallel_region; }
+
+ThreadPool::ThreadPool() {
+  spin_count_ = std::max(GetEnvInt("CVM_THREAD_POOL_SPIN_COUNT", kDefaultSpinCount), 0);
+  std::vector<unsigned> cpus;
+  if (const char* affinity = getenv("CVM_THREAD_AFFINITY")) {
+    cpus = ParseCPUList(affinity);
+  } else if (GetEnvInt("CVM_BIND_THREADS", 0) != 0) {
+    cpus = threading::GetAvailableCPUs();
+  }
+  Start(threading::MaxConcurrency(), std::move(cpus));
+}
+
+void ThreadPool::Configure(int num_threads, std::vector<unsigned> cpus) {
+  if (in_parallel_region) {
+    throw Error("Cannot configure the thread pool from inside a parallel region");
+  }
+  std::lock_guard<std::mutex> lock(job_mutex_);
+  Stop();
+  Start(num_threads > 0 ? num_threads : threading::MaxConcurrency(), std::move(cpus));
+}
+
+void ThreadPool::Start(int num_threads, std::vector<unsigned> cpus) {
+  num_workers_ = std::max(num_threads, 1) - 1;
+  cpus_ = std::move(cpus);
+  queues_.clear();
+  for (int i = 0; i <= num_workers_; ++i) {
+    queues_.emplace_back(new WorkerQueue());
+  }
+  static_assert(sizeof(ReduceSlot) % kCacheLineSize == 0, "reduction slots must not share lines");
+  slot_storage_.reset(new char[(num_workers_ + 1) * sizeof(ReduceSlot) + kCacheLineSize]);
+  uintptr_t base = reinterpret_cast<uintptr_t>(slot_storage_.get());
+  slots_ = reinterpret_cast<ReduceSlot*>((base + kCacheLineSize - 1) / kCacheLineSize *
+                                         kCacheLineSize);
+  // no job can be published before Start() returns, so the workers start from this epoch.
+  uint64_t epoch = epoch_.load();
+  workers_.reserve(num_workers_);
+  for (int i = 1; i <= num_workers_; ++i) {
+    workers_.emplace_back([this, i, epoch]() { WorkerLoop(i, epoch); });
+  }
+}
+
+void ThreadPool::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    stop_.store(true);
+  }
+  park_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  stop_.store(false);
+}
+
+bool ThreadPool::WaitForJob(uint64_t* seen) {
+  int iter = 0;
+  for (int i = 0; i < spin_count_; ++i) {
+    if (stop_.load(std::memory_order_relaxed)) return false;
+    if (epoch_.load(std::memory_order_acquire) != *seen) return true;
+    Backoff(&iter);
+  }
+  std::unique_lock<std::mutex> lock(park_mutex_);
+  num_parked_.fetch_add(1);
+  park_cv_.wait(lock, [&]() { return stop_.load() || epoch_.load() != *seen; });
+  num_parked_.fetch_sub(1);
+  return !stop_.load();
+}
+
+void ThreadPool::WorkerLoop(int worker_id, uint64_t seen) {
+  in_parallel_region = true;
+  if (!cpus_.empty()) {
+    // worker i takes cpus[i], cpus[0] is left to the calling thread.
+    threading::SetCurrentThreadAffinity({cpus_[worker_id % cpus_.size()]});
+  }
+  while (WaitForJob(&seen)) {
+    active_.fetch_add(1);
+    Job* job = job_.load();
+    if (job != nullptr) {
+      // the caller waits for active_ to drop to zero before the job goes away.
+      seen = job->epoch;
+      if (job->kind == Job::kRange) {
+        RunRangeJob(worker_id, job);
+      } else {
+        RunLaunchJob(worker_id, job);
+      }
+    } else {
+      seen = epoch_.load();
+    }
+    active_.fetch_sub(1);
+  }
+}
+
+void ThreadPool::RunJob(Job* job) {
+  in_parallel_region = true;
+  job->epoch = epoch_.load() + 1;
+  job_.store(job);
+  epoch_.store(job->epoch);
+  if (num_parked_.load() > 0) {
+    std::lock_guard<std::mutex> lock(park_mutex_);
+    park_cv_.notify_all();
+  }
+  if (job->kind == Job::kRange) {
+    RunRangeJob(0, job);
+  } else {
+    RunLaunchJob(0, job);
+    int iter = 0;
+    while (job->finished_tasks.load(std::memory_order_acquire) < job->env.num_task) {
+      Backoff(&iter);
+    }
+  }
+  job_.store(nullptr);
+  int iter = 0;
+  while (active_.load() != 0) Backoff(&iter);
+  in_parallel_region = false;
+}
+
+bool ThreadPool::PopOrSteal(int worker_id, uint32_t* seed,
+                            std::pair<int64_t, int64_t>* range) {
+  {
+    WorkerQueue* own = queues_[worker_id].get();
+    std::lock_guard<SpinLock> lock(own->lock);
+    if (!own->ranges.empty()) {
+      *range = own->ranges.back();
+      own->ranges.pop_back();
+      return true;
+    }
+  }
+  int num_queues = static_cast<int>(queues_.size());
+  int start = static_cast<int>(NextRandom(seed) % num_queues);
+  for (int i = 0; i < num_queues; ++i) {
+    int victim = (start + i) % num_queues;
+    if (victim == worker_id) continue;
+    WorkerQueue* queue = queues_[victim].get();
+    std::lock_guard<SpinLock> lock(queue->lock);
+    if (!queue->ranges.empty()) {
+      *range = queue->ranges.front();
+      queue->ranges.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::ExecuteRange(int worker_id, Job* job, int64_t begin, int64_t end) {
+  // keep the first half and expose the rest to thieves.
+  while (end - begin > job->grain) {
+    int64_t mid = begin + (end - begin) / 2;
+    WorkerQueue* own = queues_[worker_id].get();
+    std::lock_guard<SpinLock> lock(own->lock);
+    own->ranges.emplace_back(mid, end);
+    end = mid;
+  }
+  if (!job->has_error.load(std::memory_order_relaxed)) {
+    try {
+      (*job->frange)(begin, end);
+    } catch (...) {
+      job->SetError(std::current_exception());
+    }
+  }
+  job->remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+}
+
+void ThreadPool::RunRangeJob(int worker_id, Job* job) {
+  uint32_t seed = 2654435761U * static_cast<uint32_t>(worker_id + 1);
+  std::pair<int64_t, int64_t> range;
+  int iter = 0;
+  while (job->remaining.load(std::memory_order_acquire) > 0) {
+    if (PopOrSteal(worker_id, &seed, &range)) {
+      ExecuteRange(worker_id, job, range.first, range.second);
+      iter = 0;
+    } else {
+      Backoff(&iter);
+    }
+  }
+}
+
+void ThreadPool::RunLaunchJob(int /*worker_id*/, Job* job) {
+  // one task per thread, so that the tasks of a launch run concurrently.
+  int task_id = job->next_task.fetch_add(1);
+  if (task_id >= job->env.num_task) return;
+  try {
+    if (job->flambda(task_id, &job->env, job->cdata) != 0) {
+      job->has_error.store(true);
+    }
+  } catch (...) {
+    job->SetError(std::current_exception());
+  }
+  job->finished_tasks.fetch_add(1, std::memory_order_release);
+}
+
+void ThreadPool::ParallelFor(int64_t begin, int64_t end, int64_t grain, const FRange& f) {
+  if (begin >= end) return;
+  grain = std::max<int64_t>(grain, 1);
+  std::unique_lock<std::mutex> lock(job_mutex_, std::defer_lock);
+  if (end - begin <= grain || num_workers_ == 0 || in_parallel_region || !lock.try_lock()) {
+    for (int64_t b = begin; b < end; b += grain) {
+      f(b, std::min(end, b + grain));
+    }
+    return;
+  }
+
+  Job job;
+  job.kind = Job::kRange;
+  job.frange = &f;
+  job.grain = grain;
+  job.remaining.store(end - begin);
+  // seed every queue with one contiguous share, stealing balances the rest.
+  int64_t num_queues = static_cast<int64_t>(queues_.size());
+  int64_t share = (end - begin + num_queues - 1) / num_queues;
+  for (int64_t i = 0; i < num_queues; ++i) {
+    int64_t b = begin + i * share;
+    int64_t e = std::min(end, b + share);
+    if (b < e) queues_[i]->ranges.emplace_back(b, e);
+  }
+  RunJob(&job);
+  if (job.error) std::rethrow_exception(job.error);
+}
+
+int ThreadPool::Launch(FCVMParallelLambda flambda, void* cdata, int num_task) {
+  std::unique_lock<std::mutex> lock(job_mutex_, std::defer_lock);
+  int num_threads = NumThreads();
+  num_task = num_task <= 0 ? num_threads : std::min(num_task, num_threads);
+  if (num_task == 1 || in_parallel_region || !lock.try_lock()) {
+    CVMParallelGroupEnv env{nullptr, 1};
+    return flambda(0, &env, cdata) == 0 ? 0 : -1;
+  }
+
+  for (int i = 0; i < num_task; ++i) {
+    slots_[i].num_reduce = 0;
+  }
+  Job job;
+  job.kind = Job::kLaunch;
+  job.flambda = flambda;
+  job.cdata = cdata;
+  job.env.sync_handle = &job;
+  job.env.num_task = num_task;
+  RunJob(&job);
+  if (job.error) std::rethrow_exception(job.error);
+  return job.has_error.load() ? -1 : 0;
+}
+
+void ThreadPool::Barrier(int /*task_id*/, CVMParallelGroupEnv* penv) {
+  if (penv->num_task <= 1) return;
+  Job* job = static_cast<Job*>(penv->sync_handle);
+  if (job == nullptr || job_.load() != job || job->kind != Job::kLaunch) {
+    throw Error("CVMBackendParallelBarrier must be called from a task of a parallel launch");
+  }
+  // read the generation before arriving, it can only move on once this task arrived.
+  uint32_t generation = job->barrier_generation.load(std::memory_order_acquire);
+  if (job->barrier_count.fetch_add(1, std::memory_order_acq_rel) + 1 == penv->num_task) {
+    job->barrier_count.store(0, std::memory_order_relaxed);
+    job->barrier_generation.store(generation + 1, std::memory_order_release);
+    return;
+  }
+  int iter = 0;
+  while (job->barrier_generation.load(std::memory_order_acquire) == generation) {
+    Backoff(&iter);
+  }
+}
+
+void ThreadPool::Reduce(int task_id, CVMParallelGroupEnv* penv, const void* value, int nbytes,
+                        FCVMParallelCombine fcombine, void* cdata, void* result) {
+  if (nbytes <= 0 || nbytes > kParallelReduceMaxBytes) {
+    std::ostringstream os;
+    os << "CVMBackendParallelReduce: partial results must be 1 to " << kParallelReduceMaxBytes
+       << " bytes, got " << nbytes;
+    throw Error(os.str());
+  }
+  if (penv->num_task <= 1) {
+    if (result != value) memmove(result, value, nbytes);
+    return;
+  }
+  if (task_id < 0 || task_id >= penv->num_task) {
+    throw Error("CVMBackendParallelReduce: task id out of range");
+  }
+  ReduceSlot& own = slots_[task_id];
+  int buffer = own.num_reduce++ & 1;
+  memcpy(own.data[buffer], value, nbytes);
+  Barrier(task_id, penv);
+  memcpy(result, slots_[0].data[buffer], nbytes);
+  for (int i = 1; i < penv->num_task; ++i) {
+    fcombine(result, slots_[i].data[buffer], cdata);
+  }
+}
+
+namespace threading {
+
+int NumThreads() { return ThreadPool::Global()->NumThreads(); }
+
+}  // namespace threading
+
+CVM_REGISTER_GLOBAL("runtime.config_threadpool")
+    .set_body_typed([](int num_threads, ShapeTuple cpus) {
+      ThreadPool::Global()->Configure(num_threads,
+                                      std::vector<unsigned>(cpus.begin(), cpus.end()));
+    });
+
+CVM_REGISTER_GLOBAL("runtime.NumThreads").set_body_typed([]() {
+  return threading::NumThreads();
+});
+
+}  // namespace runtime
+}  // namespace cvm
+
+using namespace cvm::runtime;
+
+int CVMBackendParallelLaunch(FCVMParallelLambda flambda, void* cdata, int num_task) {
+  API_BEGIN();
+  if (ThreadPool::Global()->Launch(flambda, cdata, num_task) != 0) return -1;
+  API_END();
+}
+
+int CVMBackendParallelBarrier(int task_id, CVMParallelGroupEnv* penv) {
+  API_BEGIN();
+  ThreadPool::Global()->Barrier(task_id, penv);
+  API_END();
+}
+
+int CVMBackendParallelReduce(int task_id, CVMParallelGroupEnv* penv, const void* value,
+                             int nbytes, FCVMParallelCombine fcombine, void* cdata,
+                             void* result) {
+  API_BEGIN();
+  ThreadPool::Global()->Reduce(task_id, penv, value, nbytes, fcombine, cdata, result);
+  API_END();
+}
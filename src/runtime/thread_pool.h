@@ -0,0 +1,125 @@
+//
+// Created by WangJingYu on 2021/7/18.
+//
+
+#ifndef CVM_SRC_RUNTIME_THREAD_POOL_H_
+#define CVM_SRC_RUNTIME_THREAD_POOL_H_
+
+#include <cvm/runtime/c_backend_api.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief The largest partial result of CVMBackendParallelReduce. */
+constexpr int kParallelReduceMaxBytes = 64;
+
+/*!
+ * \brief The runtime owned thread pool.
+ *
+ *  The pool runs one job at a time with its workers plus the calling thread.
+ *  Range jobs are split lazily: every thread owns a deque of ranges, pops the
+ *  newest range of its own deque, keeps halving it down to the grain size and
+ *  pushes the other halves back, idle threads steal the oldest (largest) range
+ *  from a random victim. Launch jobs hand every thread at most one task id so
+ *  the tasks of a launch run concurrently.
+ *
+ *  Idle workers spin for a while (CVM_THREAD_POOL_SPIN_COUNT iterations) and
+ *  then park on a condition variable. Workers can be bound to CPUs with
+ *  CVM_BIND_THREADS=1 (one available CPU per worker) or with an explicit list
+ *  in CVM_THREAD_AFFINITY, e.g. "0,2,4,6".
+ *
+ *  Parallel calls made from inside a job, or while another thread owns the
+ *  pool, run inline on the calling thread instead of oversubscribing cores.
+ */
+class ThreadPool {
+ public:
+  /*! \brief The range function, called with [begin, end). */
+  using FRange = std::function<void(int64_t, int64_t)>;
+
+  /*! \return The process wide pool. */
+  static ThreadPool* Global();
+
+  /*! \return The number of threads of a job, the calling thread included. */
+  int NumThreads() const { return num_workers_ + 1; }
+
+  /*!
+   * \brief Restart the pool with a new configuration.
+   * \param num_threads The number of threads, the calling thread included, 0 uses MaxConcurrency.
+   * \param cpus The CPUs to bind worker i to cpus[i % cpus.size()], empty leaves them unbound.
+   */
+  void Configure(int num_threads, std::vector<unsigned> cpus);
+
+  /*!
+   * \brief Run f over [begin, end) in chunks of at most grain indices.
+   *  The first exception thrown by f is rethrown after the job finished.
+   */
+  void ParallelFor(int64_t begin, int64_t end, int64_t grain, const FRange& f);
+
+  /*!
+   * \brief Run a C parallel lambda, see CVMBackendParallelLaunch.
+   * \return 0 on success, -1 when a task failed.
+   */
+  int Launch(FCVMParallelLambda flambda, void* cdata, int num_task);
+
+  /*! \brief Wait for all tasks of a launch, see CVMBackendParallelBarrier. */
+  void Barrier(int task_id, CVMParallelGroupEnv* penv);
+
+  /*! \brief Deterministic all-reduce over the tasks of a launch, see CVMBackendParallelReduce. */
+  void Reduce(int task_id, CVMParallelGroupEnv* penv, const void* value, int nbytes,
+              FCVMParallelCombine fcombine, void* cdata, void* result);
+
+  /*! \return Whether the calling thread is running inside a job of the pool. */
+  static bool InParallelRegion();
+
+ private:
+  struct Job;
+  struct WorkerQueue;
+  struct ReduceSlot;
+
+  ThreadPool();
+  void Start(int num_threads, std::vector<unsigned> cpus);
+  void Stop();
+  void WorkerLoop(int worker_id, uint64_t seen);
+  bool WaitForJob(uint64_t* seen);
+  /*! \brief Publish a job and work on it with the calling thread until it is done. */
+  void RunJob(Job* job);
+  void RunRangeJob(int worker_id, Job* job);
+  void RunLaunchJob(int worker_id, Job* job);
+  void ExecuteRange(int worker_id, Job* job, int64_t begin, int64_t end);
+  bool PopOrSteal(int worker_id, uint32_t* seed, std::pair<int64_t, int64_t>* range);
+
+  std::atomic<int> num_workers_{0};
+  int spin_count_{0};
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  /*! \brief one reduction slot per thread, cache line aligned inside slot_storage_ */
+  ReduceSlot* slots_{nullptr};
+  std::unique_ptr<char[]> slot_storage_;
+  std::vector<std::thread> workers_;
+  std::vector<unsigned> cpus_;
+  /*! \brief held by the thread that owns the pool for a job */
+  std::mutex job_mutex_;
+  std::atomic<Job*> job_{nullptr};
+  std::atomic<uint64_t> epoch_{0};
+  std::atomic<int> active_{0};
+  std::atomic<int> num_parked_{0};
+  std::atomic<bool> stop_{false};
+  std::mutex park_mutex_;
+  std::condition_variable park_cv_;
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_THREAD_POOL_H_
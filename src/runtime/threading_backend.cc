@@ -0,0 +1,70 @@
+//
+// Created by WangJingYu on 2021/7/14.
+//
+
+#include <cvm/runtime/threading_backend.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+namespace cvm {
+namespace runtime {
+namespace threading {
+
+int MaxConcurrency() {
+  int max_concurrency = 1;
+  const char* val = getenv("CVM_NUM_THREADS");
+  if (val == nullptr) {
+    val = getenv("OMP_NUM_THREADS");
+  }
+  if (val != nullptr) {
+    max_concurrency = atoi(val);
+  } else {
+    max_concurrency = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  return std::max(max_concurrency, 1);
+}
+
+std::vector<unsigned> GetAvailableCPUs() {
+  std::vector<unsigned> cpus;
+#if defined(__linux__)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  if (sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) {
+    for (unsigned i = 0; i < CPU_SETSIZE; ++i) {
+      if (CPU_ISSET(i, &cpuset)) cpus.push_back(i);
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    unsigned n = std::max(1U, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < n; ++i) cpus.push_back(i);
+  }
+  return cpus;
+}
+
+bool SetCurrentThreadAffinity(const std::vector<unsigned>& cpus) {
+#if defined(__linux__)
+  if (cpus.empty()) return false;
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (unsigned cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuset);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0;
+#else
+  return false;
+#endif
+}
+
+void Yield() { std::this_thread::yield(); }
+
+}  // namespace threading
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,150 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include "bytecode.h"
+
+#include <cvm/runtime/logging.h>
+
+namespace cvm {
+namespace runtime {
+namespace vm {
+
+namespace {
+
+struct OpcodeInfo {
+  const char* name;
+  const char* layout;
+};
+
+const OpcodeInfo kOpcodeInfo[] = {
+    {"move", "rr"},
+    {"ret", "r"},
+    {"fatal", ""},
+    {"load_const", "rc"},
+    {"load_consti", "rw"},
+    {"addi", "rrr"},
+    {"subi", "rrr"},
+    {"muli", "rrr"},
+    {"lti", "rrr"},
+    {"eqi", "rrr"},
+    {"if", "rj"},
+    {"goto", "j"},
+    {"invoke", "rfn"},
+    {"invoke_closure", "rrn"},
+    {"invoke_packed", "opn"},
+    {"alloc_tensor", "rdc"},
+    {"alloc_tensor_reg", "rdn"},
+    {"alloc_closure", "rfn"},
+    {"tensor_dim", "rra"},
+    {"alloc_adt", "rin"},
+    {"get_field", "rra"},
+    {"get_tag", "rr"},
+};
+
+static_assert(sizeof(kOpcodeInfo) / sizeof(kOpcodeInfo[0]) ==
+                  static_cast<size_t>(Opcode::kNumOpcodes),
+              "every opcode needs its layout");
+
+Instruction WithList(Opcode op, std::vector<int64_t> operands, const std::vector<RegName>& list) {
+  operands.push_back(static_cast<int64_t>(list.size()));
+  operands.insert(operands.end(), list.begin(), list.end());
+  return Instruction{op, std::move(operands)};
+}
+
+}  // namespace
+
+const char* OperandLayout(Opcode op) {
+  ICHECK(op >= Opcode::kMove && op < Opcode::kNumOpcodes);
+  return kOpcodeInfo[static_cast<int>(op)].layout;
+}
+
+const char* OpcodeName(Opcode op) {
+  ICHECK(op >= Opcode::kMove && op < Opcode::kNumOpcodes);
+  return kOpcodeInfo[static_cast<int>(op)].name;
+}
+
+int EncodedLength(const int32_t* code) {
+  int length = 1;
+  for (const char* p = OperandLayout(static_cast<Opcode>(code[0])); *p != '\0'; ++p) {
+    if (*p == 'w') {
+      length += 2;
+    } else if (*p == 'n') {
+      length += 1 + code[length];
+    } else {
+      length += 1;
+    }
+  }
+  return length;
+}
+
+Instruction Instruction::Move(RegName dst, RegName src) { return {Opcode::kMove, {dst, src}}; }
+
+Instruction Instruction::Ret(RegName result) { return {Opcode::kRet, {result}}; }
+
+Instruction Instruction::Fatal() { return {Opcode::kFatal, {}}; }
+
+Instruction Instruction::LoadConst(RegName dst, int index) {
+  return {Opcode::kLoadConst, {dst, index}};
+}
+
+Instruction Instruction::LoadConsti(RegName dst, int64_t value) {
+  return {Opcode::kLoadConsti, {dst, value}};
+}
+
+Instruction Instruction::BinaryOpi(Opcode op, RegName dst, RegName lhs, RegName rhs) {
+  ICHECK(op >= Opcode::kAddi && op <= Opcode::kEqi) << OpcodeName(op) << " is no integer op";
+  return {op, {dst, lhs, rhs}};
+}
+
+Instruction Instruction::If(RegName cond, int false_offset) {
+  return {Opcode::kIf, {cond, false_offset}};
+}
+
+Instruction Instruction::Goto(int offset) { return {Opcode::kGoto, {offset}}; }
+
+Instruction Instruction::Invoke(RegName dst, int func_index, const std::vector<RegName>& args) {
+  return WithList(Opcode::kInvoke, {dst, func_index}, args);
+}
+
+Instruction Instruction::InvokeClosure(RegName dst, RegName closure,
+                                       const std::vector<RegName>& args) {
+  return WithList(Opcode::kInvokeClosure, {dst, closure}, args);
+}
+
+Instruction Instruction::InvokePacked(RegName dst, int packed_index,
+                                      const std::vector<RegName>& args) {
+  return WithList(Opcode::kInvokePacked, {dst, packed_index}, args);
+}
+
+Instruction Instruction::AllocTensor(RegName dst, DLDataType dtype, int shape_index) {
+  return {Opcode::kAllocTensor, {dst, EncodeDataType(dtype), shape_index}};
+}
+
+Instruction Instruction::AllocTensorReg(RegName dst, DLDataType dtype,
+                                        const std::vector<RegName>& shape) {
+  return WithList(Opcode::kAllocTensorReg, {dst, EncodeDataType(dtype)}, shape);
+}
+
+Instruction Instruction::AllocClosure(RegName dst, int func_index,
+                                      const std::vector<RegName>& captured) {
+  return WithList(Opcode::kAllocClosure, {dst, func_index}, captured);
+}
+
+Instruction Instruction::TensorDim(RegName dst, RegName tensor, int axis) {
+  return {Opcode::kTensorDim, {dst, tensor, axis}};
+}
+
+Instruction Instruction::AllocADT(RegName dst, int32_t tag, const std::vector<RegName>& fields) {
+  return WithList(Opcode::kAllocADT, {dst, tag}, fields);
+}
+
+Instruction Instruction::GetField(RegName dst, RegName adt, int index) {
+  return {Opcode::kGetField, {dst, adt, index}};
+}
+
+Instruction Instruction::GetTag(RegName dst, RegName adt) { return {Opcode::kGetTag, {dst, adt}}; }
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace cvm
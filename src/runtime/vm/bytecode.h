@@ -0,0 +1,151 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file bytecode.h
+ * \brief The instructions of the virtual machine and their encoding.
+ *
+ *  A function is built from Instructions and encoded into a stream of 32 bit words:
+ *  the opcode, then the operands in the order of the Instruction. An operand list
+ *  (the arguments of a call, the captured registers of a closure, the dimensions of a
+ *  tensor) is its length followed by the registers. A 64 bit immediate takes two
+ *  words, low word first. A jump offset is relative to the jumping instruction, in
+ *  instructions when building and in words once encoded.
+ */
+#ifndef CVM_SRC_RUNTIME_VM_BYTECODE_H_
+#define CVM_SRC_RUNTIME_VM_BYTECODE_H_
+
+#include <cvm/runtime/data_type.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+namespace vm {
+
+/*! \brief A register of the frame of a function, the parameters are the first ones. */
+using RegName = int32_t;
+
+/*! \brief The destination of a packed call whose result is dropped. */
+constexpr RegName kNoRegister = -1;
+
+/*! \brief The operations of the virtual machine. */
+enum class Opcode : int32_t {
+  /*! \brief dst = src */
+  kMove = 0,
+  /*! \brief Return the value of a register to the caller. */
+  kRet,
+  /*! \brief Throw an Error. */
+  kFatal,
+  /*! \brief dst = constants[index] */
+  kLoadConst,
+  /*! \brief dst = an integer immediate */
+  kLoadConsti,
+  /*! \brief dst = lhs op rhs, over integer registers */
+  kAddi,
+  kSubi,
+  kMuli,
+  kLti,
+  kEqi,
+  /*! \brief Fall through when the integer register is not 0, jump by the offset otherwise. */
+  kIf,
+  /*! \brief Jump by the offset. */
+  kGoto,
+  /*! \brief dst = functions[index](args...) */
+  kInvoke,
+  /*! \brief dst = closure(args...), the captured values come before args. */
+  kInvokeClosure,
+  /*! \brief dst = packed_funcs[index](args...), the result is dropped for kNoRegister. */
+  kInvokePacked,
+  /*! \brief dst = an empty tensor of the dtype and the ShapeTuple constants[index]. */
+  kAllocTensor,
+  /*! \brief dst = an empty tensor of the dtype and the dimensions in integer registers. */
+  kAllocTensorReg,
+  /*! \brief dst = a closure of functions[index] capturing the values of registers. */
+  kAllocClosure,
+  /*! \brief dst = the dimension of a tensor along an axis. */
+  kTensorDim,
+  /*! \brief dst = an ADT of the tag whose fields are the objects of registers. */
+  kAllocADT,
+  /*! \brief dst = the field of an ADT at an index. */
+  kGetField,
+  /*! \brief dst = the tag of an ADT. */
+  kGetTag,
+  kNumOpcodes,
+};
+
+/*! \brief An instruction before encoding, see the factories for the operands of each. */
+struct Instruction {
+  Opcode op;
+  /*! \brief the operands, an operand list is its length followed by its registers */
+  std::vector<int64_t> operands;
+
+  static Instruction Move(RegName dst, RegName src);
+  static Instruction Ret(RegName result);
+  static Instruction Fatal();
+  static Instruction LoadConst(RegName dst, int index);
+  static Instruction LoadConsti(RegName dst, int64_t value);
+  /*! \param op One of kAddi, kSubi, kMuli, kLti and kEqi. */
+  static Instruction BinaryOpi(Opcode op, RegName dst, RegName lhs, RegName rhs);
+  static Instruction If(RegName cond, int false_offset);
+  static Instruction Goto(int offset);
+  static Instruction Invoke(RegName dst, int func_index, const std::vector<RegName>& args);
+  static Instruction InvokeClosure(RegName dst, RegName closure,
+                                   const std::vector<RegName>& args);
+  static Instruction InvokePacked(RegName dst, int packed_index,
+                                  const std::vector<RegName>& args);
+  static Instruction AllocTensor(RegName dst, DLDataType dtype, int shape_index);
+  static Instruction AllocTensorReg(RegName dst, DLDataType dtype,
+                                    const std::vector<RegName>& shape);
+  static Instruction AllocClosure(RegName dst, int func_index,
+                                  const std::vector<RegName>& captured);
+  static Instruction TensorDim(RegName dst, RegName tensor, int axis);
+  static Instruction AllocADT(RegName dst, int32_t tag, const std::vector<RegName>& fields);
+  static Instruction GetField(RegName dst, RegName adt, int index);
+  static Instruction GetTag(RegName dst, RegName adt);
+};
+
+/*! \brief A function of the virtual machine before encoding. */
+struct VMFunction {
+  std::string name;
+  /*! \brief The parameters, a closure function takes its captured values first. */
+  int num_params{0};
+  /*! \brief The registers of a frame, at least num_params. */
+  int register_file_size{0};
+  std::vector<Instruction> instructions;
+};
+
+/*!
+ * \brief The layout of the operands of an opcode, one character per operand: 'r' a
+ *  register, 'o' a register or kNoRegister, 'j' a jump offset, 'c' a constant index,
+ *  'f' a function index, 'p' a packed function index, 'd' a dtype, 'a' an axis or a
+ *  field index, 'i' a 32 bit immediate, 'w' a 64 bit immediate and 'n' a list of
+ *  registers.
+ */
+const char* OperandLayout(Opcode op);
+
+/*! \return The name of an opcode. */
+const char* OpcodeName(Opcode op);
+
+/*! \return The words of the encoded instruction at code. */
+int EncodedLength(const int32_t* code);
+
+/*! \return The word encoding of a dtype, code | bits << 8 | lanes << 16. */
+inline int32_t EncodeDataType(DLDataType dtype) {
+  return static_cast<int32_t>(dtype.code) | static_cast<int32_t>(dtype.bits) << 8 |
+         static_cast<int32_t>(dtype.lanes) << 16;
+}
+
+inline DLDataType DecodeDataType(int32_t word) {
+  return DLDataType{static_cast<uint8_t>(word & 0xFF), static_cast<uint8_t>((word >> 8) & 0xFF),
+                    static_cast<uint16_t>((word >> 16) & 0xFFFF)};
+}
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_VM_BYTECODE_H_
@@ -0,0 +1,616 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include "vm.h"
+
+#include <cvm/runtime/logging.h>
+#include <cvm/runtime/registry.h>
+
+#include <algorithm>
+#include <iterator>
+
+#if defined(__GNUC__) && !defined(CVM_VM_NO_COMPUTED_GOTO)
+#define CVM_VM_COMPUTED_GOTO 1
+#else
+#define CVM_VM_COMPUTED_GOTO 0
+#endif
+
+namespace cvm {
+namespace runtime {
+namespace vm {
+
+VMClosure::VMClosure(int func_index, std::vector<VMValue> captured) {
+  ObjectPtr<VMClosureObj> n = make_object<VMClosureObj>();
+  n->func_index = func_index;
+  n->captured = std::move(captured);
+  data_ = std::move(n);
+}
+
+int Executable::AddConstant(ObjectRef value) {
+  constants_.push_back(std::move(value));
+  return static_cast<int>(constants_.size()) - 1;
+}
+
+int Executable::AddPackedFunc(const std::string& name) {
+  auto it = packed_func_index_.find(name);
+  if (it != packed_func_index_.end()) return it->second;
+  packed_func_names_.push_back(name);
+  int index = static_cast<int>(packed_func_names_.size()) - 1;
+  packed_func_index_.emplace(name, index);
+  return index;
+}
+
+int Executable::AddFunction(const VMFunction& func) {
+  auto fail = [&func](size_t pc, const std::string& msg) {
+    throw Error("VM: " + func.name + ": instruction " + std::to_string(pc) + ": " + msg);
+  };
+  if (function_index_.count(func.name)) throw Error("VM: duplicate function " + func.name);
+  if (func.num_params < 0 || func.register_file_size < func.num_params) {
+    throw Error("VM: " + func.name + ": " + std::to_string(func.num_params) +
+                " parameters do not fit in " + std::to_string(func.register_file_size) +
+                " registers");
+  }
+  const std::vector<Instruction>& instrs = func.instructions;
+  if (instrs.empty()) throw Error("VM: " + func.name + " has no instructions");
+  Opcode last = instrs.back().op;
+  if (last != Opcode::kRet && last != Opcode::kGoto && last != Opcode::kFatal) {
+    fail(instrs.size() - 1, "the last instruction must be ret, goto or fatal");
+  }
+
+  // the word position of every instruction, for the jumps.
+  std::vector<int64_t> pos(instrs.size() + 1, 0);
+  for (size_t pc = 0; pc < instrs.size(); ++pc) {
+    const Instruction& instr = instrs[pc];
+    if (instr.op < Opcode::kMove || instr.op >= Opcode::kNumOpcodes) fail(pc, "unknown opcode");
+    const std::vector<int64_t>& operands = instr.operands;
+    size_t k = 0;
+    auto next = [&]() {
+      if (k == operands.size()) fail(pc, std::string(OpcodeName(instr.op)) + " lacks operands");
+      return operands[k++];
+    };
+    auto check_register = [&](int64_t reg) {
+      if (reg < 0 || reg >= func.register_file_size) {
+        fail(pc, "register " + std::to_string(reg) + " out of range [0, " +
+                     std::to_string(func.register_file_size) + ")");
+      }
+    };
+    for (const char* p = OperandLayout(instr.op); *p != '\0'; ++p) {
+      int64_t v = next();
+      switch (*p) {
+        case 'r':
+          check_register(v);
+          break;
+        case 'o':
+          if (v != kNoRegister) check_register(v);
+          break;
+        case 'j':
+          if (static_cast<int64_t>(pc) + v < 0 ||
+              static_cast<int64_t>(pc) + v >= static_cast<int64_t>(instrs.size())) {
+            fail(pc, "jump out of the function");
+          }
+          break;
+        case 'c':
+          if (v < 0 || v >= static_cast<int64_t>(constants_.size())) {
+            fail(pc, "constant " + std::to_string(v) + " out of range");
+          }
+          if (instr.op == Opcode::kAllocTensor && !constants_[v].as<ShapeTupleObj>()) {
+            fail(pc, "the shape of alloc_tensor must be a ShapeTuple constant");
+          }
+          break;
+        case 'p':
+          if (v < 0 || v >= static_cast<int64_t>(packed_func_names_.size())) {
+            fail(pc, "packed function " + std::to_string(v) + " out of range");
+          }
+          break;
+        case 'f':
+        case 'a':
+          if (v < 0 || v > INT32_MAX) fail(pc, "negative index " + std::to_string(v));
+          break;
+        case 'i':
+          if (v < INT32_MIN || v > INT32_MAX) {
+            fail(pc, "immediate " + std::to_string(v) + " overflows");
+          }
+          break;
+        case 'n': {
+          if (v < 0 || v > static_cast<int64_t>(operands.size() - k)) {
+            fail(pc, "malformed operand list");
+          }
+          for (int64_t i = 0; i < v; ++i) check_register(next());
+          break;
+        }
+        default:
+          break;
+      }
+    }
+    if (k != operands.size()) fail(pc, std::string(OpcodeName(instr.op)) + " has extra operands");
+    int64_t words = 1 + static_cast<int64_t>(operands.size());
+    if (instr.op == Opcode::kLoadConsti) ++words;
+    pos[pc + 1] = pos[pc] + words;
+  }
+  if (pos.back() > INT32_MAX) throw Error("VM: " + func.name + " is too long");
+
+  Function encoded{func.name, func.num_params, func.register_file_size, {}};
+  encoded.code.reserve(pos.back());
+  for (size_t pc = 0; pc < instrs.size(); ++pc) {
+    const Instruction& instr = instrs[pc];
+    encoded.code.push_back(static_cast<int32_t>(instr.op));
+    size_t k = 0;
+    for (const char* p = OperandLayout(instr.op); *p != '\0'; ++p) {
+      int64_t v = instr.operands[k++];
+      if (*p == 'j') {
+        encoded.code.push_back(static_cast<int32_t>(pos[pc + v] - pos[pc]));
+      } else if (*p == 'w') {
+        uint64_t bits = static_cast<uint64_t>(v);
+        encoded.code.push_back(static_cast<int32_t>(static_cast<uint32_t>(bits)));
+        encoded.code.push_back(static_cast<int32_t>(static_cast<uint32_t>(bits >> 32)));
+      } else if (*p == 'n') {
+        encoded.code.push_back(static_cast<int32_t>(v));
+        for (int64_t i = 0; i < v; ++i) {
+          encoded.code.push_back(static_cast<int32_t>(instr.operands[k++]));
+        }
+      } else {
+        encoded.code.push_back(static_cast<int32_t>(v));
+      }
+    }
+  }
+  functions_.push_back(std::move(encoded));
+  int index = static_cast<int>(functions_.size()) - 1;
+  function_index_.emplace(func.name, index);
+  return index;
+}
+
+int Executable::GetFunctionIndex(const std::string& name) const {
+  auto it = function_index_.find(name);
+  return it != function_index_.end() ? it->second : -1;
+}
+
+namespace {
+
+/*! \brief The register stack allocated at load, in frames of the largest function. */
+constexpr size_t kInitialFrames = 64;
+/*! \brief Calls nested deeper than this throw instead of exhausting the memory. */
+constexpr size_t kMaxCallDepth = 1 << 16;
+
+/*! \brief Integer arithmetic wraps around like the kernels' integer tensors. */
+inline int64_t WrapAdd(int64_t a, int64_t b) {
+  return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+inline int64_t WrapSub(int64_t a, int64_t b) {
+  return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+inline int64_t WrapMul(int64_t a, int64_t b) {
+  return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+
+VMValue FromArg(const CVMArgValue& arg) {
+  switch (arg.type_code()) {
+    case kDLInt:
+      return VMValue::Int(arg.operator int64_t());
+    case kDLFloat:
+      return VMValue::Float(arg.operator double());
+    case kCVMNullptr:
+    case kCVMNDArrayHandle:
+    case kCVMObjectHandle:
+    case kCVMObjectRValueRefArg:
+      return VMValue::Object(arg.AsObjectRef<ObjectRef>());
+    default:
+      throw Error(std::string("VM: unsupported argument of type ") +
+                  ArgTypeCode2Str(arg.type_code()));
+  }
+}
+
+/*! \brief Iterates the objects of a list of registers, ADTs copy them without a buffer. */
+struct RegisterObjectIter {
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = ObjectRef;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const ObjectRef*;
+  using reference = const ObjectRef&;
+
+  const VMValue* reg;
+  const int32_t* name;
+
+  reference operator*() const { return reg[*name].obj; }
+  RegisterObjectIter& operator++() {
+    ++name;
+    return *this;
+  }
+  difference_type operator-(const RegisterObjectIter& other) const { return name - other.name; }
+};
+
+void SetReturn(const VMValue& value, CVMRetValue* rv) {
+  if (value.kind == VMValue::kInt) {
+    *rv = value.i;
+  } else if (value.kind == VMValue::kFloat) {
+    *rv = value.f;
+  } else {
+    *rv = value.obj;
+  }
+}
+
+}  // namespace
+
+VirtualMachine::VirtualMachine(Executable exec, Device dev) : exec_(std::move(exec)), dev_(dev) {
+  const std::vector<Executable::Function>& funcs = exec_.functions();
+  int max_registers = 1;
+  int max_packed_args = 1;
+  for (const Executable::Function& f : funcs) {
+    max_registers = std::max(max_registers, f.register_file_size);
+    for (size_t pc = 0; pc < f.code.size(); pc += EncodedLength(&f.code[pc])) {
+      const int32_t* ip = &f.code[pc];
+      Opcode op = static_cast<Opcode>(ip[0]);
+      if (op == Opcode::kInvoke || op == Opcode::kAllocClosure) {
+        if (ip[2] >= static_cast<int32_t>(funcs.size())) {
+          throw Error("VM: " + f.name + " refers to function " + std::to_string(ip[2]) +
+                      ", there are " + std::to_string(funcs.size()));
+        }
+        const Executable::Function& callee = funcs[ip[2]];
+        if (op == Opcode::kInvoke ? ip[3] != callee.num_params : ip[3] > callee.num_params) {
+          throw Error("VM: " + f.name + " passes " + std::to_string(ip[3]) + " values to " +
+                      callee.name + ", which takes " + std::to_string(callee.num_params));
+        }
+      } else if (op == Opcode::kInvokePacked) {
+        max_packed_args = std::max(max_packed_args, ip[3]);
+      }
+    }
+  }
+  for (const std::string& name : exec_.packed_func_names()) {
+    const PackedFunc* f = Registry::Get(name);
+    if (f == nullptr) throw Error("VM: packed function " + name + " is not registered");
+    packed_funcs_.push_back(*f);
+  }
+  registers_.resize(kInitialFrames * max_registers);
+  frames_.reserve(kInitialFrames);
+  packed_values_.resize(max_packed_args);
+  packed_type_codes_.resize(max_packed_args);
+}
+
+void VirtualMachine::Fail(const std::string& msg) const {
+  std::string where = frames_.empty() ? "" : exec_.functions()[frames_.back().func_index].name;
+  throw Error("VM: " + where + ": " + msg);
+}
+
+VMValue* VirtualMachine::PushFrame(int func_index, const int32_t* return_ip, RegName dst) {
+  size_t base = 0;
+  if (!frames_.empty()) {
+    base = frames_.back().base +
+           exec_.functions()[frames_.back().func_index].register_file_size;
+  }
+  if (frames_.size() == kMaxCallDepth) Fail("calls nested deeper than the call depth limit");
+  size_t end = base + exec_.functions()[func_index].register_file_size;
+  if (end > registers_.size()) registers_.resize(std::max(end, 2 * registers_.size()));
+  frames_.push_back(Frame{func_index, return_ip, base, dst});
+  return registers_.data() + base;
+}
+
+void VirtualMachine::CallPacked(int packed_index, const int32_t* args, int num_args,
+                                VMValue* reg, RegName dst) {
+  CVMValue* values = packed_values_.data();
+  int* type_codes = packed_type_codes_.data();
+  CVMArgsSetter setter(values, type_codes);
+  for (int i = 0; i < num_args; ++i) {
+    const VMValue& arg = reg[args[i]];
+    if (arg.kind == VMValue::kInt) {
+      values[i].v_int64 = arg.i;
+      type_codes[i] = kDLInt;
+    } else if (arg.kind == VMValue::kFloat) {
+      values[i].v_float64 = arg.f;
+      type_codes[i] = kDLFloat;
+    } else {
+      setter(i, arg.obj);
+    }
+  }
+  CVMRetValue rv;
+  packed_funcs_[packed_index].CallPacked(CVMArgs(values, type_codes, num_args), &rv);
+  if (dst == kNoRegister) return;
+  VMValue& out = reg[dst];
+  switch (rv.type_code()) {
+    case kCVMNullptr:
+      out = VMValue::Object(ObjectRef());
+      break;
+    case kDLInt:
+      out.i = rv.operator int64_t();
+      out.kind = VMValue::kInt;
+      break;
+    case kDLFloat:
+      out.f = rv.operator double();
+      out.kind = VMValue::kFloat;
+      break;
+    case kCVMNDArrayHandle:
+    case kCVMObjectHandle:
+      out = VMValue::Object(rv.AsObjectRef<ObjectRef>());
+      break;
+    default:
+      Fail(exec_.packed_func_names()[packed_index] + " returned a value of type " +
+           ArgTypeCode2Str(rv.type_code()));
+  }
+}
+
+VMValue VirtualMachine::Invoke(int func_index, const std::vector<VMValue>& args) {
+  if (func_index < 0 || func_index >= static_cast<int>(exec_.functions().size())) {
+    throw Error("VM: no function " + std::to_string(func_index));
+  }
+  const Executable::Function& func = exec_.functions()[func_index];
+  if (static_cast<int>(args.size()) != func.num_params) {
+    throw Error("VM: " + func.name + " takes " + std::to_string(func.num_params) +
+                " arguments, got " + std::to_string(args.size()));
+  }
+  if (running_) throw Error("VM: " + func.name + " invoked while the machine is running");
+  running_ = true;
+  VMValue* reg = PushFrame(func_index, nullptr, kNoRegister);
+  std::copy(args.begin(), args.end(), reg);
+  try {
+    VMValue result = RunLoop();
+    running_ = false;
+    return result;
+  } catch (...) {
+    // unwind every frame, the registers release their objects.
+    size_t end = frames_.back().base +
+                 exec_.functions()[frames_.back().func_index].register_file_size;
+    for (size_t i = 0; i < end; ++i) registers_[i].obj = ObjectRef();
+    frames_.clear();
+    running_ = false;
+    throw;
+  }
+}
+
+VMValue VirtualMachine::Invoke(const std::string& name, const std::vector<VMValue>& args) {
+  int index = exec_.GetFunctionIndex(name);
+  if (index < 0) throw Error("VM: no function named " + name);
+  return Invoke(index, args);
+}
+
+VMValue VirtualMachine::RunLoop() {
+  const std::vector<Executable::Function>& funcs = exec_.functions();
+  const std::vector<ObjectRef>& constants = exec_.constants();
+  const int32_t* ip = funcs[frames_.back().func_index].code.data();
+  VMValue* reg = registers_.data() + frames_.back().base;
+
+  // Every handler ends by dispatching the instruction at ip: with computed goto it jumps
+  // straight to the next handler, the branch of each handler being predicted on its own.
+#if CVM_VM_COMPUTED_GOTO
+  static void* const kHandlers[] = {
+      &&op_kMove,         &&op_kRet,          &&op_kFatal,        &&op_kLoadConst,
+      &&op_kLoadConsti,   &&op_kAddi,         &&op_kSubi,         &&op_kMuli,
+      &&op_kLti,          &&op_kEqi,          &&op_kIf,           &&op_kGoto,
+      &&op_kInvoke,       &&op_kInvokeClosure, &&op_kInvokePacked, &&op_kAllocTensor,
+      &&op_kAllocTensorReg, &&op_kAllocClosure, &&op_kTensorDim, &&op_kAllocADT,
+      &&op_kGetField,     &&op_kGetTag,
+  };
+  static_assert(sizeof(kHandlers) / sizeof(kHandlers[0]) ==
+                    static_cast<size_t>(Opcode::kNumOpcodes),
+                "every opcode needs its handler");
+#define VM_DISPATCH() goto* kHandlers[*ip]
+#define VM_CASE(op) \
+  case Opcode::op:  \
+  op_##op:
+#else
+#define VM_DISPATCH() continue
+#define VM_CASE(op) case Opcode::op:
+#endif
+
+  for (;;) {
+#if CVM_VM_COMPUTED_GOTO
+    VM_DISPATCH();
+#endif
+    switch (static_cast<Opcode>(*ip)) {
+      VM_CASE(kMove) {
+        reg[ip[1]] = reg[ip[2]];
+        ip += 3;
+        VM_DISPATCH();
+      }
+      VM_CASE(kRet) {
+        VMValue result = std::move(reg[ip[1]]);
+        Frame done = frames_.back();
+        frames_.pop_back();
+        VMValue* end = reg + funcs[done.func_index].register_file_size;
+        for (VMValue* r = reg; r != end; ++r) {
+          if (r->obj.defined()) r->obj = ObjectRef();
+        }
+        if (frames_.empty()) return result;
+        ip = done.return_ip;
+        reg = registers_.data() + frames_.back().base;
+        reg[done.dst] = std::move(result);
+        VM_DISPATCH();
+      }
+      VM_CASE(kFatal) { Fail("fatal instruction"); }
+      VM_CASE(kLoadConst) {
+        reg[ip[1]].kind = VMValue::kObject;
+        reg[ip[1]].obj = constants[ip[2]];
+        ip += 3;
+        VM_DISPATCH();
+      }
+      VM_CASE(kLoadConsti) {
+        uint64_t bits = static_cast<uint64_t>(static_cast<uint32_t>(ip[2])) |
+                        static_cast<uint64_t>(static_cast<uint32_t>(ip[3])) << 32;
+        reg[ip[1]].kind = VMValue::kInt;
+        reg[ip[1]].i = static_cast<int64_t>(bits);
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kAddi) {
+        reg[ip[1]].i = WrapAdd(reg[ip[2]].i, reg[ip[3]].i);
+        reg[ip[1]].kind = VMValue::kInt;
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kSubi) {
+        reg[ip[1]].i = WrapSub(reg[ip[2]].i, reg[ip[3]].i);
+        reg[ip[1]].kind = VMValue::kInt;
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kMuli) {
+        reg[ip[1]].i = WrapMul(reg[ip[2]].i, reg[ip[3]].i);
+        reg[ip[1]].kind = VMValue::kInt;
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kLti) {
+        reg[ip[1]].i = reg[ip[2]].i < reg[ip[3]].i;
+        reg[ip[1]].kind = VMValue::kInt;
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kEqi) {
+        reg[ip[1]].i = reg[ip[2]].i == reg[ip[3]].i;
+        reg[ip[1]].kind = VMValue::kInt;
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kIf) {
+        ip += reg[ip[1]].i != 0 ? 3 : ip[2];
+        VM_DISPATCH();
+      }
+      VM_CASE(kGoto) {
+        ip += ip[1];
+        VM_DISPATCH();
+      }
+      VM_CASE(kInvoke) {
+        int num_args = ip[3];
+        const int32_t* args = ip + 4;
+        size_t caller_base = frames_.back().base;
+        VMValue* callee = PushFrame(ip[2], args + num_args, ip[1]);
+        const VMValue* caller = registers_.data() + caller_base;
+        for (int i = 0; i < num_args; ++i) callee[i] = caller[args[i]];
+        reg = callee;
+        ip = funcs[frames_.back().func_index].code.data();
+        VM_DISPATCH();
+      }
+      VM_CASE(kInvokeClosure) {
+        const VMClosureObj* closure = reg[ip[2]].obj.as<VMClosureObj>();
+        if (closure == nullptr) Fail("invoke_closure on a value that is no closure");
+        int num_args = ip[3];
+        const int32_t* args = ip + 4;
+        int num_captured = static_cast<int>(closure->captured.size());
+        const Executable::Function& target = funcs[closure->func_index];
+        if (num_captured + num_args != target.num_params) {
+          Fail("the closure of " + target.name + " takes " +
+               std::to_string(target.num_params - num_captured) + " arguments, got " +
+               std::to_string(num_args));
+        }
+        size_t caller_base = frames_.back().base;
+        // the caller register keeps the closure alive during the copy.
+        VMValue* callee = PushFrame(closure->func_index, args + num_args, ip[1]);
+        const VMValue* caller = registers_.data() + caller_base;
+        std::copy(closure->captured.begin(), closure->captured.end(), callee);
+        for (int i = 0; i < num_args; ++i) callee[num_captured + i] = caller[args[i]];
+        reg = callee;
+        ip = target.code.data();
+        VM_DISPATCH();
+      }
+      VM_CASE(kInvokePacked) {
+        int num_args = ip[3];
+        CallPacked(ip[2], ip + 4, num_args, reg, ip[1]);
+        ip += 4 + num_args;
+        VM_DISPATCH();
+      }
+      VM_CASE(kAllocTensor) {
+        const ShapeTupleObj* shape = static_cast<const ShapeTupleObj*>(constants[ip[3]].get());
+        reg[ip[1]] = VMValue::Object(
+            NDArray::Empty(std::vector<int64_t>(shape->data, shape->data + shape->size),
+                           DecodeDataType(ip[2]), dev_));
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kAllocTensorReg) {
+        int ndim = ip[3];
+        std::vector<int64_t> shape(ndim);
+        for (int i = 0; i < ndim; ++i) {
+          const VMValue& dim = reg[ip[4 + i]];
+          if (dim.kind != VMValue::kInt || dim.i < 0) {
+            Fail("alloc_tensor_reg needs non-negative integer dimensions");
+          }
+          shape[i] = dim.i;
+        }
+        reg[ip[1]] = VMValue::Object(NDArray::Empty(shape, DecodeDataType(ip[2]), dev_));
+        ip += 4 + ndim;
+        VM_DISPATCH();
+      }
+      VM_CASE(kAllocClosure) {
+        int num_captured = ip[3];
+        std::vector<VMValue> captured;
+        captured.reserve(num_captured);
+        for (int i = 0; i < num_captured; ++i) captured.push_back(reg[ip[4 + i]]);
+        reg[ip[1]] = VMValue::Object(VMClosure(ip[2], std::move(captured)));
+        ip += 4 + num_captured;
+        VM_DISPATCH();
+      }
+      VM_CASE(kTensorDim) {
+        const NDArray::Container* tensor = reg[ip[2]].obj.as<NDArray::Container>();
+        if (tensor == nullptr) Fail("tensor_dim on a value that is no tensor");
+        if (ip[3] >= tensor->dl_tensor.ndim) {
+          Fail("tensor_dim of axis " + std::to_string(ip[3]) + " on a tensor of " +
+               std::to_string(tensor->dl_tensor.ndim) + " dimensions");
+        }
+        reg[ip[1]].i = tensor->dl_tensor.shape[ip[3]];
+        reg[ip[1]].kind = VMValue::kInt;
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kAllocADT) {
+        int num_fields = ip[3];
+        const int32_t* fields = ip + 4;
+        for (int i = 0; i < num_fields; ++i) {
+          if (reg[fields[i]].kind != VMValue::kObject) Fail("the fields of an ADT are objects");
+        }
+        reg[ip[1]] = VMValue::Object(ADT(ip[2], RegisterObjectIter{reg, fields},
+                                         RegisterObjectIter{reg, fields + num_fields}));
+        ip += 4 + num_fields;
+        VM_DISPATCH();
+      }
+      VM_CASE(kGetField) {
+        const ADTObj* adt = reg[ip[2]].obj.as<ADTObj>();
+        if (adt == nullptr) Fail("get_field on a value that is no ADT");
+        if (static_cast<uint32_t>(ip[3]) >= adt->size) {
+          Fail("get_field " + std::to_string(ip[3]) + " of an ADT of " +
+               std::to_string(adt->size) + " fields");
+        }
+        // hold the field before the destination, which may be the ADT, is overwritten.
+        ObjectRef field = (*adt)[ip[3]];
+        reg[ip[1]].kind = VMValue::kObject;
+        reg[ip[1]].obj = std::move(field);
+        ip += 4;
+        VM_DISPATCH();
+      }
+      VM_CASE(kGetTag) {
+        const ADTObj* adt = reg[ip[2]].obj.as<ADTObj>();
+        if (adt == nullptr) Fail("get_tag on a value that is no ADT");
+        reg[ip[1]].i = adt->tag;
+        reg[ip[1]].kind = VMValue::kInt;
+        ip += 3;
+        VM_DISPATCH();
+      }
+      default:
+        Fail("unknown opcode " + std::to_string(*ip));
+    }
+  }
+#undef VM_DISPATCH
+#undef VM_CASE
+}
+
+PackedFunc VirtualMachine::GetFunction(const std::string& name,
+                                       const ObjectPtr<Object>& sptr_to_self) {
+  if (name == "invoke") {
+    return PackedFunc([sptr_to_self, this](CVMArgs args, CVMRetValue* rv) {
+      std::string func_name = args[0];
+      std::vector<VMValue> values;
+      for (int i = 1; i < args.size(); ++i) values.push_back(FromArg(args[i]));
+      SetReturn(this->Invoke(func_name, values), rv);
+    });
+  }
+  int index = exec_.GetFunctionIndex(name);
+  if (index < 0) return PackedFunc();
+  return PackedFunc([sptr_to_self, this, index](CVMArgs args, CVMRetValue* rv) {
+    std::vector<VMValue> values;
+    for (int i = 0; i < args.size(); ++i) values.push_back(FromArg(args[i]));
+    SetReturn(this->Invoke(index, values), rv);
+  });
+}
+
+CVM_REGISTER_OBJECT_TYPE(VMClosureObj);
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace cvm
@@ -0,0 +1,206 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file vm.h
+ * \brief A register based virtual machine for models with control flow and dynamic shapes.
+ *
+ *  An Executable holds the encoded functions, the constants and the names of the packed
+ *  functions the code calls. A VirtualMachine runs it: every call pushes a frame whose
+ *  registers are a window of one register stack, kernels are called by InvokePacked
+ *  on the values of registers, closures capture the values of registers and ADTs
+ *  hold tagged tuples of objects.
+ */
+#ifndef CVM_SRC_RUNTIME_VM_VM_H_
+#define CVM_SRC_RUNTIME_VM_VM_H_
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/module.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/object.h>
+#include <cvm/runtime/packed_func.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bytecode.h"
+
+namespace cvm {
+namespace runtime {
+namespace vm {
+
+/*!
+ * \brief The value of a register: an integer, a float or an object.
+ *
+ *  Integers and floats are kept unboxed so that loop counters and shape arithmetic never
+ *  allocate. An integer instruction leaves the object of its destination, which is
+ *  released when the register is overwritten by an object or the frame returns.
+ */
+struct VMValue {
+  enum Kind : int32_t { kInt = 0, kFloat, kObject };
+
+  Kind kind{kInt};
+  union {
+    int64_t i{0};
+    double f;
+  };
+  ObjectRef obj;
+
+  static VMValue Int(int64_t value) {
+    VMValue v;
+    v.i = value;
+    return v;
+  }
+  static VMValue Float(double value) {
+    VMValue v;
+    v.kind = kFloat;
+    v.f = value;
+    return v;
+  }
+  static VMValue Object(ObjectRef value) {
+    VMValue v;
+    v.kind = kObject;
+    v.obj = std::move(value);
+    return v;
+  }
+};
+
+/*! \brief A function of the executable together with the values it captured. */
+class VMClosureObj : public ClosureObj {
+ public:
+  /*! \brief The function, it takes the captured values before the arguments. */
+  int func_index;
+  std::vector<VMValue> captured;
+
+  static constexpr const uint32_t _type_index = TypeIndex::kDynamic;
+  static constexpr const char* _type_key = "vm.Closure";
+  CVM_DECLARE_FINAL_OBJECT_INFO(VMClosureObj, ClosureObj);
+};
+
+/*! \brief The reference to a VMClosureObj. */
+class VMClosure : public Closure {
+ public:
+  VMClosure(int func_index, std::vector<VMValue> captured);
+  CVM_DEFINE_OBJECT_REF_METHOD(VMClosure, Closure, VMClosureObj);
+};
+
+/*! \brief The code and the data of a program of the virtual machine. */
+class Executable {
+ public:
+  /*! \brief A function encoded into words, see bytecode.h. */
+  struct Function {
+    std::string name;
+    int num_params;
+    int register_file_size;
+    std::vector<int32_t> code;
+  };
+
+  /*! \return The index of a new constant, for LoadConst and AllocTensor. */
+  int AddConstant(ObjectRef value);
+
+  /*! \return The index of a global PackedFunc, for InvokePacked. */
+  int AddPackedFunc(const std::string& name);
+
+  /*!
+   * \brief Verify and encode a function, throws an Error when it is malformed. The
+   *  function indices are checked by the VirtualMachine, a function may call one
+   *  added after it.
+   * \return The index of the function.
+   */
+  int AddFunction(const VMFunction& func);
+
+  /*! \return The index of the function of a name, -1 when there is none. */
+  int GetFunctionIndex(const std::string& name) const;
+
+  const std::vector<Function>& functions() const { return functions_; }
+  const std::vector<ObjectRef>& constants() const { return constants_; }
+  const std::vector<std::string>& packed_func_names() const { return packed_func_names_; }
+
+ private:
+  std::vector<Function> functions_;
+  std::unordered_map<std::string, int> function_index_;
+  std::vector<ObjectRef> constants_;
+  std::vector<std::string> packed_func_names_;
+  std::unordered_map<std::string, int> packed_func_index_;
+};
+
+/*!
+ * \brief Runs the functions of an Executable.
+ *
+ *  The dispatch loop jumps from handler to handler through a table of label addresses
+ *  (computed goto) where the compiler supports it, a switch otherwise. Frames take
+ *  their registers from a register stack allocated up front and grown only by deep
+ *  recursion, a call allocates nothing. InvokePacked fills argument arrays sized at
+ *  load for the widest call.
+ */
+class VirtualMachine : public ModuleNode {
+ public:
+  /*!
+   * \brief Load an executable, throws an Error when a call targets no function or a
+   *  packed function is not registered.
+   * \param exec The executable.
+   * \param dev The device of the tensors of AllocTensor.
+   */
+  explicit VirtualMachine(Executable exec, Device dev = Device{kDLCPU, 0});
+
+  /*!
+   * \brief Run a function. A Fatal instruction, a failed packed call or a malformed
+   *  value throws an Error and unwinds every frame.
+   * \return The value returned by the function.
+   */
+  VMValue Invoke(int func_index, const std::vector<VMValue>& args);
+  VMValue Invoke(const std::string& name, const std::vector<VMValue>& args);
+
+  /*!
+   * \brief Get a function of the executable by name as a PackedFunc taking integers,
+   *  floats, tensors and objects, or "invoke" taking the name of the function first.
+   * \param name The name of the function.
+   * \param sptr_to_self The pointer to this machine, kept alive by the function unless null.
+   * \return The function, nullptr for an unknown name.
+   */
+  PackedFunc GetFunction(const std::string& name, const ObjectPtr<Object>& sptr_to_self) final;
+
+  using ModuleNode::GetFunction;
+
+  const char* type_key() const final { return "VirtualMachine"; }
+
+  const Executable& exec() const { return exec_; }
+
+ private:
+  struct Frame {
+    int func_index;
+    /*! \brief where the caller continues */
+    const int32_t* return_ip;
+    /*! \brief the first register of the frame in the register stack */
+    size_t base;
+    /*! \brief the register of the caller receiving the result */
+    RegName dst;
+  };
+
+  /*! \brief Push the frame of a call whose arguments are set by the caller. */
+  VMValue* PushFrame(int func_index, const int32_t* return_ip, RegName dst);
+  VMValue RunLoop();
+  [[noreturn]] void Fail(const std::string& msg) const;
+  /*! \brief Call a packed function on registers, its result goes to dst unless kNoRegister. */
+  void CallPacked(int packed_index, const int32_t* args, int num_args, VMValue* reg,
+                  RegName dst);
+
+  Executable exec_;
+  Device dev_;
+  std::vector<PackedFunc> packed_funcs_;
+  /*! \brief The register stack, the frames are windows of it. */
+  std::vector<VMValue> registers_;
+  std::vector<Frame> frames_;
+  /*! \brief The arguments of InvokePacked, as wide as the widest call. */
+  std::vector<CVMValue> packed_values_;
+  std::vector<int> packed_type_codes_;
+  bool running_{false};
+};
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_VM_VM_H_
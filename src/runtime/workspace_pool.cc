@@ -0,0 +1,132 @@
+//
+// Created by WangJingYu on 2021/7/16.
+//
+
+#include "workspace_pool.h"
+
+#include <algorithm>
+
+namespace cvm {
+namespace runtime {
+
+/*! \brief Size of the first block of a pool. */
+constexpr size_t kWorkspaceMinBlockSize = 64UL << 10;
+
+// stack-like pool of one device.
+class WorkspacePool::Pool {
+ public:
+  void* Alloc(Device dev, DeviceAPI* device, size_t nbytes) {
+    nbytes = std::max<size_t>(RoundUp(nbytes), kTempAllocaAlignment);
+    if (blocks_.empty() || blocks_.back().top + nbytes > blocks_.back().size) {
+      size_t size = blocks_.empty() ? kWorkspaceMinBlockSize : blocks_.back().size * 2;
+      size = std::max(size, nbytes);
+      char* data =
+          static_cast<char*>(device->AllocDataSpace(dev, size, kTempAllocaAlignment, DLDataType{}));
+      blocks_.push_back(Block{data, size, 0});
+    }
+    Block& block = blocks_.back();
+    Entry e;
+    e.data = block.data + block.top;
+    e.block = blocks_.size() - 1;
+    e.offset = block.top;
+    e.released = false;
+    block.top += nbytes;
+    stack_.push_back(e);
+    return e.data;
+  }
+
+  void Free(Device dev, DeviceAPI* device, void* data) {
+    if (!stack_.empty() && stack_.back().data == data) {
+      Pop();
+      // reclaim entries released out of order that are now on the top.
+      while (!stack_.empty() && stack_.back().released) Pop();
+    } else {
+      auto it = std::find_if(stack_.rbegin(), stack_.rend(),
+                             [data](const Entry& e) { return e.data == data && !e.released; });
+      ICHECK(it != stack_.rend()) << "Cannot find workspace to free";
+      it->released = true;
+    }
+    if (stack_.empty() && blocks_.size() > 1) {
+      // merge the blocks so the next run of the same pattern fits in one.
+      size_t total = 0;
+      for (const Block& block : blocks_) {
+        total += block.size;
+        device->FreeDataSpace(dev, block.data);
+      }
+      blocks_.clear();
+      char* data =
+          static_cast<char*>(device->AllocDataSpace(dev, total, kTempAllocaAlignment, DLDataType{}));
+      blocks_.push_back(Block{data, total, 0});
+    }
+  }
+
+  // Release all resources
+  void Release(Device dev, DeviceAPI* device) {
+    for (const Block& block : blocks_) {
+      device->FreeDataSpace(dev, block.data);
+    }
+    blocks_.clear();
+    stack_.clear();
+  }
+
+ private:
+  /*! \brief A chunk of device memory the workspaces are carved from. */
+  struct Block {
+    char* data;
+    size_t size;
+    size_t top;
+  };
+  /*! \brief A live workspace. */
+  struct Entry {
+    void* data;
+    size_t block;
+    size_t offset;
+    bool released;
+  };
+
+  static size_t RoundUp(size_t nbytes) {
+    return (nbytes + kTempAllocaAlignment - 1) / kTempAllocaAlignment * kTempAllocaAlignment;
+  }
+
+  void Pop() {
+    const Entry& e = stack_.back();
+    blocks_[e.block].top = e.offset;
+    stack_.pop_back();
+  }
+
+  std::vector<Block> blocks_;
+  std::vector<Entry> stack_;
+};
+
+WorkspacePool::WorkspacePool(DLDeviceType device_type, DeviceAPI* device)
+    : device_type_(device_type), device_(device) {}
+
+WorkspacePool::~WorkspacePool() {
+  for (size_t i = 0; i < array_.size(); ++i) {
+    if (array_[i] != nullptr) {
+      Device dev;
+      dev.device_type = device_type_;
+      dev.device_id = static_cast<int>(i);
+      array_[i]->Release(dev, device_);
+      delete array_[i];
+    }
+  }
+}
+
+void* WorkspacePool::AllocWorkspace(Device dev, size_t size) {
+  if (static_cast<size_t>(dev.device_id) >= array_.size()) {
+    array_.resize(dev.device_id + 1, nullptr);
+  }
+  if (array_[dev.device_id] == nullptr) {
+    array_[dev.device_id] = new Pool();
+  }
+  return array_[dev.device_id]->Alloc(dev, device_, size);
+}
+
+void WorkspacePool::FreeWorkspace(Device dev, void* ptr) {
+  ICHECK(static_cast<size_t>(dev.device_id) < array_.size() && array_[dev.device_id] != nullptr);
+  array_[dev.device_id]->Free(dev, device_, ptr);
+}
+
+}  // namespace runtime
+}  // namespace cvm
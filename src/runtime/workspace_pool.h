@@ -0,0 +1,64 @@
+//
+// Created by WangJingYu on 2021/7/16.
+//
+
+#ifndef CVM_SRC_RUNTIME_WORKSPACE_POOL_H_
+#define CVM_SRC_RUNTIME_WORKSPACE_POOL_H_
+
+#include <cvm/runtime/device_api.h>
+
+#include <vector>
+
+namespace cvm {
+namespace runtime {
+
+/*!
+ * \brief A workspace pool to manage temporal workspace of one thread.
+ *
+ *  Workspaces are carved from large blocks like a stack, release in
+ *  reverse order of allocation is O(1) and out of order release is
+ *  deferred until the entries above it are released. Once every workspace
+ *  has been released the blocks are merged into a single one, so a
+ *  repeated allocation pattern stops hitting the device allocator after
+ *  the first run.
+ *
+ * \note This pool is not thread-safe, it is meant to be used as thread local.
+ */
+class CVM_DLL WorkspacePool {
+ public:
+  /*!
+   * \brief Create pool with specific device type and device.
+   * \param device_type The device type.
+   * \param device_api The device API.
+   */
+  WorkspacePool(DLDeviceType device_type, DeviceAPI* device_api);
+  /*! \brief destructor */
+  ~WorkspacePool();
+  /*!
+   * \brief Allocate temporal workspace.
+   * \param dev The device of allocation.
+   * \param size The size to be allocated.
+   */
+  void* AllocWorkspace(Device dev, size_t size);
+  /*!
+   * \brief Free temporal workspace in backend execution.
+   *
+   * \param dev The device of allocation.
+   * \param ptr The pointer to be freed.
+   */
+  void FreeWorkspace(Device dev, void* ptr);
+
+ private:
+  class Pool;
+  /*! \brief pool of device local array */
+  std::vector<Pool*> array_;
+  /*! \brief device type this pool support */
+  DLDeviceType device_type_;
+  /*! \brief The device API */
+  DeviceAPI* device_;
+};
+
+}  // namespace runtime
+}  // namespace cvm
+
+#endif  // CVM_SRC_RUNTIME_WORKSPACE_POOL_H_
@@ -0,0 +1,299 @@
+//
+// Created by WangJingYu on 2021/7/27.
+//
+
+#include "json.h"
+
+#include <cvm/runtime/logging.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace cvm {
+namespace support {
+
+using runtime::Error;
+
+/*! \brief A recursive descent parser over the text of one document. */
+class JSONValue::Parser {
+ public:
+  explicit Parser(const std::string& text) : text_(text) {}
+
+  JSONValue ParseDocument() {
+    JSONValue value = ParseValue(0);
+    SkipSpace();
+    if (pos_ != text_.size()) Fail("unexpected trailing characters");
+    return value;
+  }
+
+ private:
+  /*! \brief Nesting deeper than this is rejected instead of overflowing the stack. */
+  static constexpr int kMaxDepth = 256;
+
+  [[noreturn]] void Fail(const std::string& msg) const {
+    throw Error("JSON: " + msg + " at offset " + std::to_string(pos_));
+  }
+
+  void SkipSpace() {
+    while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' ||
+                                   text_[pos_] == '\n' || text_[pos_] == '\r')) {
+      ++pos_;
+    }
+  }
+
+  char Peek() {
+    SkipSpace();
+    if (pos_ == text_.size()) Fail("unexpected end of input");
+    return text_[pos_];
+  }
+
+  void Expect(char c) {
+    if (Peek() != c) Fail(std::string("expect '") + c + "'");
+    ++pos_;
+  }
+
+  void ExpectWord(const char* word) {
+    for (const char* p = word; *p != '\0'; ++p, ++pos_) {
+      if (pos_ == text_.size() || text_[pos_] != *p) Fail(std::string("expect ") + word);
+    }
+  }
+
+  JSONValue ParseValue(int depth) {
+    if (depth > kMaxDepth) Fail("nesting too deep");
+    JSONValue value;
+    char c = Peek();
+    if (c == '{') {
+      ++pos_;
+      value.type_ = kObject;
+      if (Peek() == '}') {
+        ++pos_;
+        return value;
+      }
+      while (true) {
+        if (Peek() != '"') Fail("expect a member name");
+        std::string key = ParseString();
+        Expect(':');
+        value.object_.emplace_back(std::move(key), ParseValue(depth + 1));
+        if (Peek() == ',') {
+          ++pos_;
+          continue;
+        }
+        Expect('}');
+        return value;
+      }
+    }
+    if (c == '[') {
+      ++pos_;
+      value.type_ = kArray;
+      if (Peek() == ']') {
+        ++pos_;
+        return value;
+      }
+      while (true) {
+        value.array_.push_back(ParseValue(depth + 1));
+        if (Peek() == ',') {
+          ++pos_;
+          continue;
+        }
+        Expect(']');
+        return value;
+      }
+    }
+    if (c == '"') {
+      value.type_ = kString;
+      value.string_ = ParseString();
+    } else if (c == 't' || c == 'f') {
+      ExpectWord(c == 't' ? "true" : "false");
+      value.type_ = kBool;
+      value.bool_ = c == 't';
+    } else if (c == 'n') {
+      ExpectWord("null");
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+      value.type_ = kNumber;
+      value.number_ = ParseNumber();
+    } else {
+      Fail(std::string("unexpected character '") + c + "'");
+    }
+    return value;
+  }
+
+  double ParseNumber() {
+    const char* begin = text_.c_str() + pos_;
+    char* end = nullptr;
+    double v = std::strtod(begin, &end);
+    // strtod also takes hex, inf and nan, JSON numbers start with a digit after the sign.
+    const char* digit = begin + (*begin == '-');
+    if (end == begin || *digit < '0' || *digit > '9' || (digit[0] == '0' && digit[1] == 'x') ||
+        (digit[0] == '0' && digit[1] == 'X')) {
+      Fail("malformed number");
+    }
+    pos_ += end - begin;
+    return v;
+  }
+
+  unsigned ParseHex4() {
+    if (pos_ + 4 > text_.size()) Fail("truncated \\u escape");
+    unsigned code = 0;
+    for (int i = 0; i < 4; ++i, ++pos_) {
+      char h = text_[pos_];
+      code <<= 4;
+      if (h >= '0' && h <= '9') {
+        code |= h - '0';
+      } else if (h >= 'a' && h <= 'f') {
+        code |= h - 'a' + 10;
+      } else if (h >= 'A' && h <= 'F') {
+        code |= h - 'A' + 10;
+      } else {
+        Fail("malformed \\u escape");
+      }
+    }
+    return code;
+  }
+
+  void AppendUTF8(unsigned code, std::string* out) {
+    if (code < 0x80) {
+      out->push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+      out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+      out->push_back(static_cast<char>(0xF0 | (code >> 18)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+  }
+
+  std::string ParseString() {
+    Expect('"');
+    std::string out;
+    while (true) {
+      if (pos_ == text_.size()) Fail("unterminated string");
+      char c = text_[pos_++];
+      if (c == '"') return out;
+      if (static_cast<unsigned char>(c) < 0x20) Fail("control character in string");
+      if (c != '\\') {
+        out.push_back(c);
+        continue;
+      }
+      if (pos_ == text_.size()) Fail("unterminated string");
+      char e = text_[pos_++];
+      switch (e) {
+        case '"':
+        case '\\':
+        case '/':
+          out.push_back(e);
+          break;
+        case 'b':
+          out.push_back('\b');
+          break;
+        case 'f':
+          out.push_back('\f');
+          break;
+        case 'n':
+          out.push_back('\n');
+          break;
+        case 'r':
+          out.push_back('\r');
+          break;
+        case 't':
+          out.push_back('\t');
+          break;
+        case 'u': {
+          unsigned code = ParseHex4();
+          // a surrogate pair encodes a code point above the basic plane.
+          if (code >= 0xD800 && code < 0xDC00 && pos_ + 1 < text_.size() &&
+              text_[pos_] == '\\' && text_[pos_ + 1] == 'u') {
+            pos_ += 2;
+            unsigned low = ParseHex4();
+            if (low < 0xDC00 || low >= 0xE000) Fail("malformed surrogate pair");
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+          AppendUTF8(code, &out);
+          break;
+        }
+        default:
+          Fail(std::string("unknown escape '\\") + e + "'");
+      }
+    }
+  }
+
+  const std::string& text_;
+  size_t pos_{0};
+};
+
+JSONValue JSONValue::Parse(const std::string& text) { return Parser(text).ParseDocument(); }
+
+namespace {
+
+const char* TypeName(JSONValue::Type type) {
+  static const char* names[] = {"null", "bool", "number", "string", "array", "object"};
+  return names[type];
+}
+
+void CheckType(const JSONValue& value, JSONValue::Type expected) {
+  if (value.type() != expected) {
+    throw Error(std::string("JSON: expect ") + TypeName(expected) + ", got " +
+                TypeName(value.type()));
+  }
+}
+
+}  // namespace
+
+bool JSONValue::IsInt() const {
+  return type_ == kNumber && std::trunc(number_) == number_ &&
+         std::fabs(number_) < 9.2233720368547758e18;
+}
+
+bool JSONValue::AsBool() const {
+  CheckType(*this, kBool);
+  return bool_;
+}
+
+double JSONValue::AsNumber() const {
+  CheckType(*this, kNumber);
+  return number_;
+}
+
+int64_t JSONValue::AsInt() const {
+  CheckType(*this, kNumber);
+  if (!IsInt()) throw Error("JSON: expect an integer, got " + std::to_string(number_));
+  return static_cast<int64_t>(number_);
+}
+
+const std::string& JSONValue::AsString() const {
+  CheckType(*this, kString);
+  return string_;
+}
+
+const std::vector<JSONValue>& JSONValue::AsArray() const {
+  CheckType(*this, kArray);
+  return array_;
+}
+
+const std::vector<std::pair<std::string, JSONValue>>& JSONValue::AsObject() const {
+  CheckType(*this, kObject);
+  return object_;
+}
+
+const JSONValue* JSONValue::Find(const std::string& key) const {
+  CheckType(*this, kObject);
+  for (const auto& kv : object_) {
+    if (kv.first == key) return &kv.second;
+  }
+  return nullptr;
+}
+
+const JSONValue& JSONValue::operator[](const std::string& key) const {
+  const JSONValue* value = Find(key);
+  if (value == nullptr) throw Error("JSON: missing member \"" + key + "\"");
+  return *value;
+}
+
+}  // namespace support
+}  // namespace cvm
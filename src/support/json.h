@@ -0,0 +1,72 @@
+//
+// Created by WangJingYu on 2021/7/27.
+//
+
+/*!
+ * \file support/json.h
+ * \brief A small JSON reader for the graphs and configurations the runtime loads.
+ */
+#ifndef CVM_SRC_SUPPORT_JSON_H_
+#define CVM_SRC_SUPPORT_JSON_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cvm {
+namespace support {
+
+/*! \brief A parsed JSON value, the members of an object keep their order. */
+class JSONValue {
+ public:
+  enum Type : int { kNull = 0, kBool, kNumber, kString, kArray, kObject };
+
+  JSONValue() = default;
+
+  /*!
+   * \brief Parse a JSON document, throws an Error with the offset of the first
+   *  malformed character.
+   * \param text The document.
+   * \return The value of the document.
+   */
+  static JSONValue Parse(const std::string& text);
+
+  Type type() const { return type_; }
+  bool IsNull() const { return type_ == kNull; }
+  bool IsBool() const { return type_ == kBool; }
+  bool IsNumber() const { return type_ == kNumber; }
+  bool IsString() const { return type_ == kString; }
+  bool IsArray() const { return type_ == kArray; }
+  bool IsObject() const { return type_ == kObject; }
+  /*! \return Whether the value is a number without fraction that fits int64_t. */
+  bool IsInt() const;
+
+  /*! \brief The accessors throw an Error when the value has another type. */
+  bool AsBool() const;
+  double AsNumber() const;
+  int64_t AsInt() const;
+  const std::string& AsString() const;
+  const std::vector<JSONValue>& AsArray() const;
+  const std::vector<std::pair<std::string, JSONValue>>& AsObject() const;
+
+  /*! \return The member of an object, nullptr when there is none. */
+  const JSONValue* Find(const std::string& key) const;
+  /*! \return The member of an object, throws an Error when there is none. */
+  const JSONValue& operator[](const std::string& key) const;
+
+ private:
+  class Parser;
+
+  Type type_{kNull};
+  bool bool_{false};
+  double number_{0.0};
+  std::string string_;
+  std::vector<JSONValue> array_;
+  std::vector<std::pair<std::string, JSONValue>> object_;
+};
+
+}  // namespace support
+}  // namespace cvm
+
+#endif  // CVM_SRC_SUPPORT_JSON_H_
@@ -0,0 +1,31 @@
+//
+// Created by WangJingYu on 2021/7/14.
+//
+
+#include "parallel_for.h"
+
+#include <algorithm>
+
+#include "../runtime/thread_pool.h"
+
+namespace cvm {
+namespace support {
+
+void parallel_for(int64_t begin, int64_t end, const std::function<void(int64_t)>& f,
+                  int num_threads) {
+  if (begin >= end) return;
+  runtime::ThreadPool* pool = runtime::ThreadPool::Global();
+  if (num_threads <= 0) num_threads = pool->NumThreads();
+  int64_t grain = (end - begin + num_threads - 1) / num_threads;
+  pool->ParallelFor(begin, end, grain, [&f](int64_t chunk_begin, int64_t chunk_end) {
+    for (int64_t i = chunk_begin; i < chunk_end; ++i) f(i);
+  });
+}
+
+void parallel_for(int64_t begin, int64_t end, int64_t grain,
+                  const std::function<void(int64_t, int64_t)>& f) {
+  runtime::ThreadPool::Global()->ParallelFor(begin, end, grain, f);
+}
+
+}  // namespace support
+}  // namespace cvm
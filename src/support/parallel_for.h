@@ -0,0 +1,43 @@
+//
+// Created by WangJingYu on 2021/7/14.
+//
+
+#ifndef CVM_SRC_SUPPORT_PARALLEL_FOR_H_
+#define CVM_SRC_SUPPORT_PARALLEL_FOR_H_
+
+#include <cstdint>
+#include <functional>
+
+namespace cvm {
+namespace support {
+
+/*!
+ * \brief A simple parallel for loop running on the runtime thread pool.
+ *
+ *  [begin, end) is cut into one contiguous block per thread, so neighbouring
+ *  indices run on the same thread. The first exception raised by f is
+ *  re-thrown after all threads finished.
+ *
+ * \param begin The start index of this parallel loop (inclusive).
+ * \param end The end index of this parallel loop (exclusive).
+ * \param f The task function to be executed. Takes an int64_t index as input.
+ * \param num_threads The number of blocks, 0 uses one block per thread of the pool.
+ */
+void parallel_for(int64_t begin, int64_t end, const std::function<void(int64_t)>& f,
+                  int num_threads = 0);
+
+/*!
+ * \brief A parallel for loop over chunks, load balanced by work stealing.
+ *
+ * \param begin The start index of this parallel loop (inclusive).
+ * \param end The end index of this parallel loop (exclusive).
+ * \param grain The largest chunk handed to f.
+ * \param f The task function, called with a chunk [chunk_begin, chunk_end).
+ */
+void parallel_for(int64_t begin, int64_t end, int64_t grain,
+                  const std::function<void(int64_t, int64_t)>& f);
+
+}  // namespace support
+}  // namespace cvm
+
+#endif  // CVM_SRC_SUPPORT_PARALLEL_FOR_H_
@@ -0,0 +1,276 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/ndarray.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../../src/runtime/auto_tuner.h"
+#include "../../src/runtime/kernels/conv2d.h"
+#include "../../src/runtime/kernels/gemm.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+/*! \brief Takes the cost a kernel reports as its seconds, the searches are reproducible. */
+class ReportedCostRunner : public Runner {
+ public:
+  explicit ReportedCostRunner(std::shared_ptr<double> cost) : cost_(cost) {}
+
+  MeasureResult Measure(const std::function<void()>& func) const final {
+    MeasureResult result;
+    func();
+    result.seconds = *cost_;
+    result.num_samples = 1;
+    return result;
+  }
+
+ private:
+  std::shared_ptr<double> cost_;
+};
+
+/*!
+ * \brief A task over x in [0, 6) and y in [0, 6) of cost 1 + |x - 3| + |y - 4|, fastest
+ *  at x = 3, y = 4. Configs with x = 5 do not apply.
+ */
+TuningTask CostTask(std::shared_ptr<double> cost, std::shared_ptr<std::vector<int64_t>> seen) {
+  TuningTask task;
+  task.op = "cost";
+  task.workload = "test";
+  task.space.Define("x", {0, 1, 2, 3, 4, 5});
+  task.space.Define("y", {0, 1, 2, 3, 4, 5});
+  task.instantiate = [cost, seen](const TuningConfig& config) -> std::function<void()> {
+    int64_t x = config.at("x"), y = config.at("y");
+    seen->push_back(x * 6 + y);
+    if (x == 5) return nullptr;
+    return [cost, x, y]() { *cost = 1.0 + std::abs(x - 3) + std::abs(y - 4); };
+  };
+  return task;
+}
+
+std::string TempFile(const std::string& name) {
+  return testing::TempDir() + "auto_tuner_test_" + name;
+}
+
+}  // namespace
+
+TEST(AutoTuner, ConfigSpace) {
+  ConfigSpace space;
+  space.Define("a", {1, 2, 3});
+  space.Define("b", {10, 20});
+  EXPECT_THROW(space.Define("a", {4}), Error);
+  EXPECT_THROW(space.Define("c", {}), Error);
+  ASSERT_EQ(space.size(), 6);
+  std::set<std::string> seen;
+  for (int64_t i = 0; i < space.size(); ++i) {
+    TuningConfig config = space.Get(i);
+    EXPECT_EQ(space.IndexOf(config), i);
+    EXPECT_EQ(ParseConfig(ConfigToString(config)), config);
+    seen.insert(ConfigToString(config));
+  }
+  EXPECT_EQ(seen.size(), 6U);
+  EXPECT_EQ(ConfigToString(space.Get(4)), "a=2,b=20");
+  EXPECT_EQ(space.IndexOf({{"a", 4}, {"b", 10}}), -1);
+  EXPECT_EQ(space.IndexOf({{"a", 1}}), -1);
+
+  // a neighbor differs in one knob by one step.
+  std::mt19937_64 rng(7);
+  for (int i = 0; i < 100; ++i) {
+    int64_t index = static_cast<int64_t>(rng() % 6);
+    TuningConfig from = space.Get(index), to = space.Get(space.Neighbor(index, &rng));
+    int steps = (from["a"] != to["a"]) + (from["b"] != to["b"]);
+    ASSERT_EQ(steps, 1);
+    ASSERT_LE(std::abs(from["a"] - to["a"]), 1);
+  }
+
+  EXPECT_THROW(ParseConfig("a=1,a=2"), Error);
+  EXPECT_THROW(ParseConfig("a=x"), Error);
+  EXPECT_THROW(ParseConfig("=1"), Error);
+  EXPECT_TRUE(ParseConfig("").empty());
+}
+
+TEST(AutoTuner, RobustMean) {
+  int kept = 0;
+  EXPECT_DOUBLE_EQ(RobustMean({1.0, 1.1, 0.9, 1.0, 50.0}, 3.0, &kept), 1.0);
+  EXPECT_EQ(kept, 4);
+  EXPECT_DOUBLE_EQ(RobustMean({2.0, 2.0, 2.0}, 3.0, &kept), 2.0);
+  EXPECT_EQ(kept, 3);
+  EXPECT_DOUBLE_EQ(RobustMean({1.0, 3.0}, 3.0, &kept), 2.0);
+
+  MeasureOptions options;
+  options.repeat = 3;
+  options.min_repeat_ms = 1;
+  int runs = 0;
+  MeasureResult result = LocalRunner(options).Measure([&runs]() { ++runs; });
+  EXPECT_TRUE(result.ok());
+  EXPECT_GT(runs, 3);
+  EXPECT_GT(result.num_samples, 0);
+  result = LocalRunner().Measure([]() { throw Error("broken kernel"); });
+  EXPECT_FALSE(result.ok());
+  EXPECT_EQ(result.error, "broken kernel");
+  EXPECT_TRUE(std::isinf(result.seconds));
+  options.repeat = 0;
+  EXPECT_THROW(LocalRunner{options}, Error);
+}
+
+TEST(AutoTuner, Search) {
+  auto cost = std::make_shared<double>(0);
+  auto seen = std::make_shared<std::vector<int64_t>>();
+  ReportedCostRunner runner(cost);
+  std::vector<std::unique_ptr<Tuner>> tuners;
+  tuners.emplace_back(new GridSearchTuner(CostTask(cost, seen)));
+  tuners.emplace_back(new RandomTuner(CostTask(cost, seen), 1));
+  tuners.emplace_back(new SimulatedAnnealingTuner(CostTask(cost, seen), 2));
+  for (auto& tuner : tuners) {
+    seen->clear();
+    TuningLog log;
+    // the whole space, 30 configs apply.
+    TuningRecord best = tuner->Tune(100, runner, &log);
+    EXPECT_EQ(best.config.at("x"), 3);
+    EXPECT_EQ(best.config.at("y"), 4);
+    EXPECT_EQ(best.seconds, 1.0);
+    EXPECT_EQ(log.records().size(), 30U);
+    EXPECT_EQ(std::set<int64_t>(seen->begin(), seen->end()).size(), 36U);
+    EXPECT_EQ(seen->size(), 36U);
+  }
+
+  // the annealing walks downhill to the fastest config in a part of the space.
+  double annealing = 0, random = 0;
+  for (uint64_t seed = 0; seed < 20; ++seed) {
+    annealing += SimulatedAnnealingTuner(CostTask(cost, seen), seed).Tune(10, runner).seconds;
+    random += RandomTuner(CostTask(cost, seen), seed).Tune(10, runner).seconds;
+  }
+  EXPECT_LT(annealing, random);
+
+  TuningTask failing = CostTask(cost, seen);
+  failing.instantiate = [](const TuningConfig&) { return []() { throw Error("fails"); }; };
+  EXPECT_THROW(RandomTuner(failing).Tune(3, LocalRunner()), Error);
+}
+
+TEST(AutoTuner, Log) {
+  TuningLog log;
+  log.Add({"gemm", "w1", {{"mc", 96}, {"kc", 256}}, 2e-3});
+  log.Add({"gemm", "w1", {{"mc", 48}, {"kc", 128}}, 1e-3});
+  log.Add({"gemm", "w2", {{"mc", 48}, {"kc", 64}}, 5e-4});
+  const std::string file_name = TempFile("log.txt");
+  log.Save(file_name);
+  TuningLog loaded = TuningLog::Load(file_name);
+  ASSERT_EQ(loaded.records().size(), 3U);
+  const TuningRecord* best = loaded.Best("gemm", "w1");
+  ASSERT_NE(best, nullptr);
+  EXPECT_EQ(best->config.at("mc"), 48);
+  EXPECT_NEAR(best->seconds, 1e-3, 1e-9);
+  EXPECT_EQ(loaded.Best("gemm", "w3"), nullptr);
+  EXPECT_EQ(loaded.Best("conv2d", "w1"), nullptr);
+
+  {
+    std::ofstream fs(file_name);
+    fs << "# comment\n\ngemm\tw1\tmc=48\t1e-3\ngemm\tw1\tmc=48\n";
+  }
+  EXPECT_THROW(TuningLog::Load(file_name), Error);
+  std::remove(file_name.c_str());
+  EXPECT_THROW(TuningLog::Load(file_name), Error);
+}
+
+TEST(AutoTuner, GemmDispatch) {
+  const int64_t m = 40, n = 56, k = 72;
+  TuningTask task = GemmTuningTask(m, n, k);
+  EXPECT_EQ(task.workload, GemmWorkloadName(m, n, k));
+  EXPECT_DOUBLE_EQ(task.flops, 2.0 * m * n * k);
+  EXPECT_THROW(GemmTuningTask(4, n, k), Error);
+  MeasureOptions options;
+  options.repeat = 2;
+  TuningLog log;
+  TuningRecord best = RandomTuner(task).Tune(4, LocalRunner(options), &log);
+  EXPECT_EQ(log.records().size(), 4U);
+  EXPECT_GE(task.space.IndexOf(best.config), 0);
+
+  // the smallest blocks, every loop of the product runs several times.
+  TuningConfig config = task.space.Get(0);
+  log.Add({"gemm", task.workload, config, 0.0});
+  DispatchContext::Global()->Apply(log);
+  TuningConfig applied;
+  ASSERT_TRUE(DispatchContext::Global()->Lookup("gemm", task.workload, &applied));
+  EXPECT_EQ(applied, config);
+
+  std::vector<float> a(m * k), b(k * n), c(m * n), expect(m * n, 0.0f);
+  for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<float>(i % 7) - 3;
+  for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<float>(i % 5) - 2;
+  for (int64_t i = 0; i < m; ++i) {
+    for (int64_t p = 0; p < k; ++p) {
+      for (int64_t j = 0; j < n; ++j) expect[i * n + j] += a[i * k + p] * b[p * n + j];
+    }
+  }
+  Sgemm(false, false, m, n, k, 1.0f, a.data(), k, b.data(), n, 0.0f, c.data(), n);
+  for (int64_t i = 0; i < m * n; ++i) ASSERT_FLOAT_EQ(c[i], expect[i]);
+
+  DispatchContext::Global()->Reset();
+  EXPECT_FALSE(DispatchContext::Global()->Lookup("gemm", task.workload, &applied));
+  std::fill(c.begin(), c.end(), 0.0f);
+  Sgemm(false, false, m, n, k, 1.0f, a.data(), k, b.data(), n, 0.0f, c.data(), n);
+  for (int64_t i = 0; i < m * n; ++i) ASSERT_FLOAT_EQ(c[i], expect[i]);
+}
+
+TEST(AutoTuner, Conv2DDispatch) {
+  Conv2DShape shape{1, 32, 32, 32, 32, 3, 3, 0, 0};
+  Conv2DParams params;
+  params.pad_top = params.pad_left = params.pad_bottom = params.pad_right = 1;
+  TuningTask task = Conv2DTuningTask(shape, params);
+  EXPECT_EQ(task.workload, Conv2DWorkloadName(shape, params));
+  // im2col, direct and winograd, and the blocks 1, 2, 4, 8 and 16 of the direct loops.
+  EXPECT_EQ(task.space.size(), 15);
+  EXPECT_EQ(task.instantiate({{"algorithm", 1}, {"in_block", 4}}), nullptr);
+  EXPECT_NE(task.instantiate({{"algorithm", 2}, {"in_block", 4}}), nullptr);
+  MeasureOptions options;
+  options.repeat = 2;
+  TuningLog log;
+  GridSearchTuner(task).Tune(100, LocalRunner(options), &log);
+  EXPECT_EQ(log.records().size(), 7U);
+
+  shape.out_h = shape.out_w = 32;
+  ASSERT_EQ(SelectConv2DAlgorithm(shape, params), Conv2DAlgorithm::kWinograd);
+  const Device cpu{kDLCPU, 0};
+  const DLDataType f32{kDLFloat, 32, 1};
+  NDArray data = NDArray::Empty({1, 32, 32, 32}, f32, cpu);
+  NDArray weight = NDArray::Empty({32, 32, 3, 3}, f32, cpu);
+  NDArray out = NDArray::Empty({1, 32, 32, 32}, f32, cpu);
+  NDArray expect = NDArray::Empty({1, 32, 32, 32}, f32, cpu);
+  float* pdata = static_cast<float*>(data->data);
+  float* pweight = static_cast<float*>(weight->data);
+  for (int64_t i = 0; i < 32 * 1024; ++i) pdata[i] = static_cast<float>(i % 11) / 11;
+  for (int64_t i = 0; i < 32 * 32 * 9; ++i) pweight[i] = static_cast<float>(i % 7) / 7 - 0.5f;
+  Conv2D(data, weight, NDArray(), expect, params, Conv2DAlgorithm::kIm2col);
+
+  TuningLog tuned;
+  tuned.Add({"conv2d", task.workload, {{"algorithm", 2}, {"in_block", 4}}, 0.0});
+  DispatchContext::Global()->Apply(tuned);
+  EXPECT_EQ(SelectConv2DAlgorithm(shape, params), Conv2DAlgorithm::kDirect);
+  Conv2D(data, weight, NDArray(), out, params);
+  const float* pout = static_cast<const float*>(out->data);
+  const float* pexpect = static_cast<const float*>(expect->data);
+  for (int64_t i = 0; i < 32 * 1024; ++i) ASSERT_NEAR(pout[i], pexpect[i], 1e-4);
+
+  // a config that does not apply to the shape is ignored.
+  TuningLog invalid;
+  invalid.Add({"conv2d", task.workload, {{"algorithm", 2}, {"in_block", 3}}, 0.0});
+  DispatchContext::Global()->Apply(invalid);
+  EXPECT_EQ(SelectConv2DAlgorithm(shape, params), Conv2DAlgorithm::kWinograd);
+  DispatchContext::Global()->Reset();
+  EXPECT_EQ(SelectConv2DAlgorithm(shape, params), Conv2DAlgorithm::kWinograd);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,184 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/ndarray.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../src/runtime/batching_server.h"
+
+using namespace cvm::runtime;
+
+namespace {
+
+using Clock = BatchingServer::Clock;
+
+constexpr int64_t kLen = 4;
+
+NDArray Sample(float value, std::vector<int64_t> shape = {kLen}) {
+  NDArray x = NDArray::Empty(shape, DLDataType{kDLFloat, 32, 1}, Device{kDLCPU, 0});
+  for (int64_t i = 0; i < kLen; ++i) static_cast<float*>(x->data)[i] = value + i;
+  return x;
+}
+
+/*! \brief out = 2 * x over [batch, kLen], records the batch sizes and first values. */
+struct Doubler {
+  std::mutex mutex;
+  std::vector<int64_t> batch_sizes;
+  std::vector<float> first_values;
+
+  PackedFunc Func() {
+    return PackedFunc([this](CVMArgs args, CVMRetValue* /*rv*/) {
+      NDArray x = args[0], out = args[1];
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch_sizes.push_back(x->shape[0]);
+        first_values.push_back(static_cast<const float*>(x->data)[0]);
+      }
+      for (int64_t i = 0; i < x->shape[0] * kLen; ++i) {
+        static_cast<float*>(out->data)[i] = 2 * static_cast<const float*>(x->data)[i];
+      }
+    });
+  }
+};
+
+std::vector<SampleSpec> Specs() { return {SampleSpec{{kLen}, DLDataType{kDLFloat, 32, 1}}}; }
+
+void ExpectDoubled(std::future<std::vector<NDArray>>* future, float value) {
+  std::vector<NDArray> out = future->get();
+  ASSERT_EQ(out.size(), 1U);
+  ASSERT_EQ(out[0].Shape(), std::vector<int64_t>{kLen});
+  for (int64_t i = 0; i < kLen; ++i) {
+    EXPECT_EQ(static_cast<const float*>(out[0]->data)[i], 2 * (value + i));
+  }
+}
+
+}  // namespace
+
+TEST(BatchingServer, FullBatches) {
+  Doubler model;
+  BatchingOptions options;
+  options.max_batch_size = 4;
+  options.max_wait_us = 10 * 1000 * 1000;
+  std::vector<std::future<std::vector<NDArray>>> futures;
+  {
+    BatchingServer server(model.Func(), Specs(), Specs(), options);
+    for (int i = 0; i < 8; ++i) futures.push_back(server.Submit({Sample(i * 10.0f)}));
+    for (int i = 0; i < 8; ++i) ExpectDoubled(&futures[i], i * 10.0f);
+    BatchingMetrics metrics = server.Metrics();
+    EXPECT_EQ(metrics.num_requests, 8);
+    EXPECT_EQ(metrics.num_batches, 2);
+    EXPECT_EQ(metrics.batch_size_histogram[4], 2);
+    EXPECT_EQ(metrics.MeanBatchSize(), 4.0);
+    EXPECT_EQ(metrics.num_padding_rows, 0);
+    EXPECT_GT(metrics.QueueDelayQuantileUs(0.99), 0.0);
+  }
+  EXPECT_EQ(model.batch_sizes, (std::vector<int64_t>{4, 4}));
+}
+
+TEST(BatchingServer, MaxWait) {
+  Doubler model;
+  BatchingOptions options;
+  options.max_batch_size = 16;
+  options.max_wait_us = 1000;
+  BatchingServer server(model.Func(), Specs(), Specs(), options);
+  // a sample may keep its batch axis of 1.
+  auto future = server.Submit({Sample(1.0f, {1, kLen})});
+  ASSERT_EQ(future.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+  ExpectDoubled(&future, 1.0f);
+  EXPECT_EQ(server.Metrics().batch_size_histogram[1], 1);
+}
+
+TEST(BatchingServer, Buckets) {
+  Doubler model;
+  BatchingOptions options;
+  options.max_wait_us = 10 * 1000 * 1000;
+  options.batch_buckets = {2, 4};
+  std::vector<std::future<std::vector<NDArray>>> futures;
+  {
+    BatchingServer server(model.Func(), Specs(), Specs(), options);
+    for (int i = 0; i < 3; ++i) futures.push_back(server.Submit({Sample(i)}));
+    // stopping runs the 3 queued requests as a batch padded to 4.
+  }
+  for (int i = 0; i < 3; ++i) ExpectDoubled(&futures[i], i);
+  EXPECT_EQ(model.batch_sizes, std::vector<int64_t>{4});
+  EXPECT_THROW(BatchingServer(model.Func(), Specs(), Specs(), BatchingOptions{8, 0, false, {4, 2}}),
+               Error);
+}
+
+TEST(BatchingServer, Deadlines) {
+  // the first batch blocks the model until released, the queue builds up meanwhile.
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool released = false;
+  Doubler doubler;
+  PackedFunc inner = doubler.Func();
+  PackedFunc model([&](CVMArgs args, CVMRetValue* rv) {
+    inner.CallPacked(args, rv);
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return released; });
+  });
+  BatchingOptions options;
+  options.max_batch_size = 2;
+  options.max_wait_us = 10 * 1000 * 1000;
+  options.deadline_aware = true;
+  BatchingServer server(model, Specs(), Specs(), options);
+
+  auto first = server.Submit({Sample(0)}, Clock::now());
+  auto started = [&]() {
+    std::lock_guard<std::mutex> lock(doubler.mutex);
+    return !doubler.batch_sizes.empty();
+  };
+  while (!started()) std::this_thread::yield();
+  auto a = server.Submit({Sample(1)});
+  auto b = server.Submit({Sample(2)});
+  auto c = server.Submit({Sample(3)}, Clock::now() + std::chrono::milliseconds(1));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    released = true;
+  }
+  cv.notify_all();
+  ExpectDoubled(&first, 0);
+  // the deadline of c dispatches it without waiting 10s, together with the oldest request.
+  ASSERT_EQ(c.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+  ExpectDoubled(&c, 3);
+  ExpectDoubled(&a, 1);
+  {
+    std::lock_guard<std::mutex> lock(doubler.mutex);
+    ASSERT_EQ(doubler.first_values.size(), 2U);
+    EXPECT_EQ(doubler.first_values[1], 3.0f);
+  }
+  EXPECT_EQ(b.wait_for(std::chrono::milliseconds(0)), std::future_status::timeout);
+}
+
+TEST(BatchingServer, Errors) {
+  std::atomic<int> calls{0};
+  PackedFunc failing([&](CVMArgs /*args*/, CVMRetValue* /*rv*/) {
+    if (calls++ == 0) throw Error("model failed");
+  });
+  BatchingOptions options;
+  options.max_wait_us = 0;
+  BatchingServer server(failing, Specs(), Specs(), options);
+  EXPECT_THROW(server.Submit({Sample(0, {kLen + 1})}), Error);
+  EXPECT_THROW(server.Submit({Sample(0), Sample(0)}), Error);
+  EXPECT_THROW(server.Submit({NDArray()}), Error);
+  auto future = server.Submit({Sample(0)});
+  EXPECT_THROW(future.get(), Error);
+  // the server goes on after a failed batch.
+  auto next = server.Submit({Sample(0)});
+  EXPECT_NO_THROW(next.get());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -1,2 +1,74 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
 #include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace cvm::runtime;
+
+TEST(ADT, Construct) {
+  String a("a");
+  ShapeTuple b({1, 2});
+  ADT adt(3, {a, b});
+  EXPECT_EQ(adt->type_index(), static_cast<uint32_t>(TypeIndex::kRuntimeADT));
+  EXPECT_EQ(adt.tag(), 3);
+  ASSERT_EQ(adt.size(), 2U);
+  EXPECT_EQ(adt[0].get(), a.get());
+  EXPECT_EQ(adt[1].get(), b.get());
+  // the fields follow the object in its allocation.
+  EXPECT_EQ(reinterpret_cast<const char*>(adt.begin()),
+            reinterpret_cast<const char*>(adt.get()) + sizeof(ADTObj));
+  std::vector<const Object*> fields;
+  for (const ObjectRef& field : adt) fields.push_back(field.get());
+  EXPECT_EQ(fields, (std::vector<const Object*>{a.get(), b.get()}));
+
+  ADT empty(7, std::vector<ObjectRef>());
+  EXPECT_EQ(empty.tag(), 7);
+  EXPECT_EQ(empty.size(), 0U);
+  EXPECT_EQ(empty.begin(), empty.end());
+
+  Tuple tuple = ADT::Tuple(a, b, String("c"));
+  EXPECT_EQ(tuple.tag(), 0);
+  ASSERT_EQ(tuple.size(), 3U);
+  EXPECT_EQ(tuple[2].as<StringObj>()->size, 1U);
+}
+
+TEST(ADT, ReleasesFields) {
+  String field("field");
+  {
+    ADT adt = ADT::Tuple(field, field);
+    EXPECT_EQ(field.use_count(), 3);
+  }
+  EXPECT_EQ(field.use_count(), 1);
+}
+
+TEST(ADT, FFI) {
+  NDArray x = NDArray::Empty({2}, DLDataType{kDLFloat, 32, 1}, Device{kDLCPU, 0});
+  String s("s");
+  ADT tuple = (*Registry::Get("runtime.Tuple"))(x, s);
+  EXPECT_EQ(tuple.tag(), 0);
+  ADT adt = (*Registry::Get("runtime.ADT"))(5, x);
+  EXPECT_EQ(adt.tag(), 5);
+
+  const PackedFunc* tag = Registry::Get("runtime.GetADTTag");
+  const PackedFunc* size = Registry::Get("runtime.GetADTSize");
+  const PackedFunc* field = Registry::Get("runtime.GetADTFields");
+  EXPECT_EQ((*tag)(adt).operator int(), 5);
+  EXPECT_EQ((*size)(tuple).operator int(), 2);
+  // the fields cross as handles of the same objects, tensors as tensors.
+  NDArray f0 = (*field)(tuple, 0);
+  EXPECT_EQ(f0.get(), x.get());
+  String f1 = (*field)(tuple, 1);
+  EXPECT_EQ(f1.get(), s.get());
+}
 
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
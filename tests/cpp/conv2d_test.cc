@@ -0,0 +1,258 @@
+//
+// Created by WangJingYu on 2021/7/22.
+//
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../../src/runtime/kernels/conv2d.h"
+#include "../../src/runtime/thread_pool.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+
+NDArray RandomArray(std::vector<int64_t> shape, int seed) {
+  NDArray arr = NDArray::Empty(shape, DLDataType{kDLFloat, 32, 1}, cpu);
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  float* data = static_cast<float*>(arr->data);
+  size_t n = GetDataSize(*arr.operator->()) / sizeof(float);
+  for (size_t i = 0; i < n; ++i) data[i] = dist(gen);
+  return arr;
+}
+
+/*! \brief Run f once for every SIMD level this machine supports. */
+template <typename F>
+void ForEachSIMDLevel(F f) {
+  SIMDLevel saved = GetSIMDLevel();
+  for (int level = 0; level <= static_cast<int>(DetectSIMDLevel()); ++level) {
+    SetSIMDLevel(static_cast<SIMDLevel>(level));
+    SCOPED_TRACE(SIMDLevelName(GetSIMDLevel()));
+    f();
+  }
+  SetSIMDLevel(saved);
+}
+
+/*! \brief A double precision NCHW convolution. */
+std::vector<double> ReferenceConv2D(const NDArray& data, const NDArray& weight, const float* bias,
+                                    const Conv2DParams& p, int64_t oh_size, int64_t ow_size) {
+  const int64_t N = data->shape[0], C = data->shape[1], H = data->shape[2], W = data->shape[3];
+  const int64_t O = weight->shape[0], KH = weight->shape[2], KW = weight->shape[3];
+  const int64_t cg = C / p.groups, og = O / p.groups;
+  const float* x = static_cast<const float*>(data->data);
+  const float* w = static_cast<const float*>(weight->data);
+  std::vector<double> out(N * O * oh_size * ow_size);
+  for (int64_t n = 0; n < N; ++n) {
+    for (int64_t o = 0; o < O; ++o) {
+      for (int64_t oh = 0; oh < oh_size; ++oh) {
+        for (int64_t ow = 0; ow < ow_size; ++ow) {
+          double sum = bias != nullptr ? bias[o] : 0.0;
+          for (int64_t c = 0; c < cg; ++c) {
+            for (int64_t r = 0; r < KH; ++r) {
+              for (int64_t s = 0; s < KW; ++s) {
+                int64_t ih = oh * p.stride_h - p.pad_top + r * p.dilation_h;
+                int64_t iw = ow * p.stride_w - p.pad_left + s * p.dilation_w;
+                if (ih < 0 || ih >= H || iw < 0 || iw >= W) continue;
+                int64_t ic = o / og * cg + c;
+                sum += static_cast<double>(x[((n * C + ic) * H + ih) * W + iw]) *
+                       w[((o * cg + c) * KH + r) * KW + s];
+              }
+            }
+          }
+          out[((n * O + o) * oh_size + oh) * ow_size + ow] = sum;
+        }
+      }
+    }
+  }
+  return out;
+}
+
+struct Case {
+  std::vector<int64_t> data;
+  std::vector<int64_t> weight;
+  Conv2DParams params;
+};
+
+Conv2DParams MakeParams(int64_t stride, int64_t pad, int64_t dilation = 1, int64_t groups = 1) {
+  Conv2DParams p;
+  p.stride_h = p.stride_w = stride;
+  p.pad_top = p.pad_left = p.pad_bottom = p.pad_right = pad;
+  p.dilation_h = p.dilation_w = dilation;
+  p.groups = groups;
+  return p;
+}
+
+void CheckConv2D(const Case& c, Conv2DAlgorithm algorithm, bool with_bias) {
+  const Conv2DParams& p = c.params;
+  int64_t oh = (c.data[2] + p.pad_top + p.pad_bottom - p.dilation_h * (c.weight[2] - 1) - 1) /
+                   p.stride_h + 1;
+  int64_t ow = (c.data[3] + p.pad_left + p.pad_right - p.dilation_w * (c.weight[3] - 1) - 1) /
+                   p.stride_w + 1;
+  NDArray data = RandomArray(c.data, 1);
+  NDArray weight = RandomArray(c.weight, 2);
+  NDArray bias = with_bias ? RandomArray({c.weight[0]}, 3) : NDArray();
+  NDArray out = NDArray::Empty({c.data[0], c.weight[0], oh, ow}, data->dtype, cpu);
+  Conv2D(data, weight, bias, out, p, algorithm);
+  std::vector<double> expected = ReferenceConv2D(
+      data, weight, with_bias ? static_cast<const float*>(bias->data) : nullptr, p, oh, ow);
+  const float* po = static_cast<const float*>(out->data);
+  const double tol = 1e-5 * c.weight[1] * c.weight[2] * c.weight[3] + 1e-5;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_NEAR(po[i], expected[i], tol) << "at " << i;
+  }
+}
+
+const std::vector<Case>& Cases() {
+  static const std::vector<Case> cases = {
+      {{1, 3, 11, 13}, {8, 3, 3, 3}, MakeParams(1, 1)},
+      {{2, 16, 9, 10}, {20, 16, 3, 3}, MakeParams(1, 0)},
+      {{1, 32, 14, 14}, {32, 32, 3, 3}, MakeParams(1, 1)},
+      {{1, 5, 17, 15}, {7, 5, 3, 3}, MakeParams(2, 1)},
+      {{2, 24, 8, 8}, {16, 24, 1, 1}, MakeParams(1, 0)},
+      {{1, 8, 12, 11}, {12, 8, 1, 1}, MakeParams(2, 0)},
+      {{1, 3, 23, 23}, {16, 3, 7, 7}, MakeParams(2, 3)},
+      {{1, 6, 13, 13}, {9, 6, 3, 3}, MakeParams(1, 2, 2)},
+  };
+  return cases;
+}
+
+}  // namespace
+
+TEST(Conv2D, AllAlgorithms) {
+  const Conv2DAlgorithm algorithms[] = {Conv2DAlgorithm::kAuto, Conv2DAlgorithm::kIm2col,
+                                        Conv2DAlgorithm::kDirect, Conv2DAlgorithm::kWinograd};
+  ForEachSIMDLevel([&]() {
+    for (const Case& c : Cases()) {
+      Conv2DShape shape{c.data[0],   c.data[1],   c.data[2], c.data[3], c.weight[0],
+                        c.weight[2], c.weight[3], 0,         0};
+      for (Conv2DAlgorithm algorithm : algorithms) {
+        if (!Conv2DSupports(algorithm, shape, c.params)) continue;
+        SCOPED_TRACE(::testing::Message()
+                     << Conv2DAlgorithmName(algorithm) << " data " << c.data[1] << "x"
+                     << c.data[2] << "x" << c.data[3] << " kernel " << c.weight[0] << "x"
+                     << c.weight[2] << "x" << c.weight[3]);
+        CheckConv2D(c, algorithm, true);
+        CheckConv2D(c, algorithm, false);
+      }
+    }
+  });
+}
+
+TEST(Conv2D, GroupsAndPadding) {
+  // depthwise and grouped, asymmetric padding.
+  Conv2DParams depthwise = MakeParams(1, 1, 1, 8);
+  CheckConv2D({{2, 8, 10, 9}, {8, 1, 3, 3}, depthwise}, Conv2DAlgorithm::kAuto, true);
+  Conv2DParams grouped = MakeParams(2, 0, 1, 2);
+  grouped.pad_top = 2;
+  grouped.pad_right = 1;
+  CheckConv2D({{1, 6, 11, 12}, {4, 3, 3, 2}, grouped}, Conv2DAlgorithm::kIm2col, true);
+  Conv2DParams asymmetric = MakeParams(1, 0);
+  asymmetric.pad_left = 2;
+  asymmetric.pad_bottom = 1;
+  for (auto algorithm : {Conv2DAlgorithm::kIm2col, Conv2DAlgorithm::kDirect,
+                         Conv2DAlgorithm::kWinograd}) {
+    CheckConv2D({{1, 4, 7, 6}, {5, 4, 3, 3}, asymmetric}, algorithm, true);
+  }
+}
+
+TEST(Conv2D, Errors) {
+  NDArray data = RandomArray({1, 4, 8, 8}, 1);
+  NDArray weight = RandomArray({4, 2, 3, 3}, 2);
+  NDArray out = NDArray::Empty({1, 4, 6, 6}, data->dtype, cpu);
+  Conv2DParams grouped = MakeParams(1, 0, 1, 2);
+  Conv2D(data, weight, NDArray(), out, grouped);
+  EXPECT_THROW(Conv2D(data, weight, NDArray(), out, grouped, Conv2DAlgorithm::kDirect), Error);
+  EXPECT_THROW(Conv2D(data, weight, NDArray(), out, grouped, Conv2DAlgorithm::kWinograd), Error);
+  // weight channels do not match the groups, wrong output, wrong bias.
+  EXPECT_THROW(Conv2D(data, weight, NDArray(), out, MakeParams(1, 0)), Error);
+  NDArray wrong_out = NDArray::Empty({1, 4, 8, 8}, data->dtype, cpu);
+  EXPECT_THROW(Conv2D(data, weight, NDArray(), wrong_out, grouped), Error);
+  EXPECT_THROW(Conv2D(data, weight, RandomArray({3}, 3), out, grouped), Error);
+  EXPECT_THROW(Conv2D(data, weight, NDArray(), out, MakeParams(0, 0, 1, 2)), Error);
+  NDArray small = RandomArray({1, 4, 2, 2}, 4);
+  EXPECT_THROW(Conv2D(small, weight, NDArray(), out, grouped), Error);
+}
+
+TEST(Conv2D, NCHWc) {
+  // data (1, 2, 9, 9, 8), 32 output channels, 3x3, stride 2, padding 1.
+  const int64_t C = 16, cb = 8, O = 32, H = 9, W = 9;
+  NDArray data = RandomArray({1, C, H, W}, 1);
+  NDArray weight = RandomArray({O, C, 3, 3}, 2);
+  NDArray bias = RandomArray({O}, 3);
+  NDArray data_c = NDArray::Empty({1, C / cb, H, W, cb}, data->dtype, cpu);
+  NDArray weight_c = NDArray::Empty({O / 16, C / cb, 3, 3, cb, 16}, data->dtype, cpu);
+  const float* x = static_cast<const float*>(data->data);
+  const float* w = static_cast<const float*>(weight->data);
+  float* xc = static_cast<float*>(data_c->data);
+  float* wc = static_cast<float*>(weight_c->data);
+  for (int64_t c = 0; c < C; ++c) {
+    for (int64_t i = 0; i < H * W; ++i) xc[(c / cb * H * W + i) * cb + c % cb] = x[c * H * W + i];
+  }
+  for (int64_t o = 0; o < O; ++o) {
+    for (int64_t c = 0; c < C; ++c) {
+      for (int64_t t = 0; t < 9; ++t) {
+        wc[(((o / 16 * (C / cb) + c / cb) * 9 + t) * cb + c % cb) * 16 + o % 16] =
+            w[(o * C + c) * 9 + t];
+      }
+    }
+  }
+  Conv2DParams p = MakeParams(2, 1);
+  std::vector<double> expected =
+      ReferenceConv2D(data, weight, static_cast<const float*>(bias->data), p, 5, 5);
+  NDArray out = NDArray::Empty({1, O / 16, 5, 5, 16}, data->dtype, cpu);
+  const PackedFunc* conv = Registry::Get("kernel.conv2d_nchwc");
+  ASSERT_TRUE(conv != nullptr);
+  ForEachSIMDLevel([&]() {
+    (*conv)(data_c, weight_c, bias, out, ShapeTuple({2, 2}), ShapeTuple({1}), ShapeTuple({1}));
+    const float* po = static_cast<const float*>(out->data);
+    for (int64_t o = 0; o < O; ++o) {
+      for (int64_t i = 0; i < 25; ++i) {
+        ASSERT_NEAR(po[(o / 16 * 25 + i) * 16 + o % 16], expected[o * 25 + i], 1e-4);
+      }
+    }
+  });
+  EXPECT_THROW(Conv2DNCHWc(data_c, weight_c, bias, out, MakeParams(1, 1, 1, 2)), Error);
+}
+
+TEST(Conv2D, ParallelAndRegistry) {
+  const PackedFunc* conv = Registry::Get("kernel.conv2d");
+  ASSERT_TRUE(conv != nullptr);
+  NDArray data = RandomArray({2, 32, 20, 20}, 1);
+  NDArray weight = RandomArray({48, 32, 3, 3}, 2);
+  NDArray bias = RandomArray({48}, 3);
+  Conv2DParams p = MakeParams(1, 1);
+  std::vector<double> expected =
+      ReferenceConv2D(data, weight, static_cast<const float*>(bias->data), p, 20, 20);
+  NDArray out = NDArray::Empty({2, 48, 20, 20}, data->dtype, cpu);
+  for (int threads : {1, 3, 4}) {
+    ThreadPool::Global()->Configure(threads, {});
+    for (const char* algorithm : {"auto", "im2col", "direct", "winograd"}) {
+      SCOPED_TRACE(::testing::Message() << algorithm << " threads " << threads);
+      (*conv)(data, weight, bias, out, ShapeTuple({1}), ShapeTuple({1, 1, 1, 1}),
+              ShapeTuple({1, 1}), 1, String(algorithm));
+      const float* po = static_cast<const float*>(out->data);
+      for (size_t i = 0; i < expected.size(); ++i) ASSERT_NEAR(po[i], expected[i], 1e-4);
+    }
+  }
+  EXPECT_THROW((*conv)(data, weight, bias, out, ShapeTuple({1}), ShapeTuple({1}),
+                       ShapeTuple({1}), 1, String("fft")),
+               Error);
+  Conv2DShape shape{1, 64, 56, 56, 64, 3, 3, 56, 56};
+  EXPECT_EQ(SelectConv2DAlgorithm(shape, p), Conv2DAlgorithm::kWinograd);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
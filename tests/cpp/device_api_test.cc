@@ -0,0 +1,133 @@
+//
+// Created by WangJingYu on 2021/7/16.
+//
+
+#include <cvm/runtime/c_backend_api.h>
+#include <cvm/runtime/device_api.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "../../src/runtime/cpu_stream.h"
+
+using namespace cvm::runtime;
+
+TEST(DeviceAPI, AllocDataSpace) {
+  Device dev{kDLCPU, 0};
+  DeviceAPI* api = DeviceAPI::Get(dev);
+  ASSERT_TRUE(api != nullptr);
+  CVMRetValue exist;
+  api->GetAttr(dev, kExist, &exist);
+  EXPECT_EQ(exist.operator int(), 1);
+  void* ptr = api->AllocDataSpace(dev, 1000, 256, DataType::Float(32));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 256, 0U);
+  memset(ptr, 0, 1000);
+  api->FreeDataSpace(dev, ptr);
+}
+
+TEST(DeviceAPI, Workspace) {
+  Device dev{kDLCPU, 0};
+  DeviceAPI* api = DeviceAPI::Get(dev);
+  void* a = api->AllocWorkspace(dev, 100);
+  void* b = api->AllocWorkspace(dev, 1000);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % kTempAllocaAlignment, 0U);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % kTempAllocaAlignment, 0U);
+  EXPECT_NE(a, b);
+  // out of order release is deferred until b is released.
+  api->FreeWorkspace(dev, a);
+  void* c = api->AllocWorkspace(dev, 100);
+  EXPECT_NE(c, a);
+  api->FreeWorkspace(dev, c);
+  api->FreeWorkspace(dev, b);
+  // the space is reused once everything is released.
+  void* d = api->AllocWorkspace(dev, 100);
+  EXPECT_EQ(d, a);
+
+  // growing past the first block, then the blocks are merged into one.
+  void* big = api->AllocWorkspace(dev, 1UL << 20);
+  memset(big, 0, 1UL << 20);
+  api->FreeWorkspace(dev, big);
+  api->FreeWorkspace(dev, d);
+  void* e = api->AllocWorkspace(dev, 100);
+  void* f = api->AllocWorkspace(dev, 1UL << 20);
+  EXPECT_EQ(static_cast<char*>(f), static_cast<char*>(e) + 128);
+  api->FreeWorkspace(dev, f);
+  api->FreeWorkspace(dev, e);
+
+  // workspaces are thread local.
+  void* g = nullptr;
+  std::thread([&]() {
+    ASSERT_EQ(CVMBackendAllocWorkspace(kDLCPU, 0, 64, kDLFloat, 32, &g), 0);
+    ASSERT_EQ(CVMBackendFreeWorkspace(kDLCPU, 0, g), 0);
+  }).join();
+  void* h = api->AllocWorkspace(dev, 64);
+  EXPECT_NE(g, h);
+  api->FreeWorkspace(dev, h);
+}
+
+TEST(DeviceAPI, StreamOrder) {
+  Device dev{kDLCPU, 0};
+  DeviceAPI* api = DeviceAPI::Get(dev);
+  CVMStreamHandle stream = api->CreateStream(dev);
+  NDArray a = NDArray::Empty({1 << 16}, DataType::Int(32), {kDLCPU, 0});
+  NDArray b = NDArray::Empty({1 << 16}, DataType::Int(32), {kDLCPU, 0});
+  int32_t* pa = static_cast<int32_t*>(a->data);
+  int32_t* pb = static_cast<int32_t*>(b->data);
+  for (int i = 0; i < (1 << 16); ++i) pa[i] = i;
+  std::atomic<bool> release{false};
+  // the copy is queued behind a blocked task, so it must not run yet.
+  CPUStreamEnqueue(stream, [&]() {
+    while (!release) std::this_thread::yield();
+  });
+  NDArray::CopyFromTo(a.operator->(), const_cast<DLTensor*>(b.operator->()), stream);
+  CPUStreamEnqueue(stream, [&]() { pb[0] = -1; });
+  pb[1] = -7;
+  release = true;
+  api->StreamSync(dev, stream);
+  EXPECT_EQ(pb[0], -1);
+  EXPECT_EQ(pb[1], 1);
+  EXPECT_EQ(pb[(1 << 16) - 1], (1 << 16) - 1);
+  api->FreeStream(dev, stream);
+}
+
+TEST(DeviceAPI, StreamEvent) {
+  Device dev{kDLCPU, 0};
+  DeviceAPI* api = DeviceAPI::Get(dev);
+  CVMStreamHandle producer = api->CreateStream(dev);
+  CVMStreamHandle consumer = api->CreateStream(dev);
+  std::atomic<int> value{0};
+  int observed = -1;
+  CPUStreamEnqueue(producer, [&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    value = 42;
+  });
+  ASSERT_EQ(CVMStreamStreamSynchronize(kDLCPU, 0, producer, consumer), 0);
+  CPUStreamEnqueue(consumer, [&]() { observed = value; });
+  ASSERT_EQ(CVMSynchronize(kDLCPU, 0, consumer), 0);
+  EXPECT_EQ(observed, 42);
+  api->FreeStream(dev, producer);
+  api->FreeStream(dev, consumer);
+}
+
+TEST(DeviceAPI, StreamError) {
+  CVMStreamHandle stream;
+  ASSERT_EQ(CVMStreamCreate(kDLCPU, 0, &stream), 0);
+  int ran = 0;
+  CPUStreamEnqueue(stream, []() { throw cvm::Error("task failed"); });
+  CPUStreamEnqueue(stream, [&]() { ran = 1; });
+  EXPECT_NE(CVMSynchronize(kDLCPU, 0, stream), 0);
+  EXPECT_EQ(ran, 1);
+  // the error is reported once.
+  EXPECT_EQ(CVMSynchronize(kDLCPU, 0, stream), 0);
+  ASSERT_EQ(CVMStreamFree(kDLCPU, 0, stream), 0);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,211 @@
+//
+// Created by WangJingYu on 2021/7/19.
+//
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../../src/runtime/kernels/elementwise.h"
+#include "../../src/runtime/thread_pool.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+
+NDArray RandomArray(std::vector<int64_t> shape, float low, float high, int seed) {
+  NDArray arr = NDArray::Empty(shape, DLDataType{kDLFloat, 32, 1}, cpu);
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(low, high);
+  float* data = static_cast<float*>(arr->data);
+  size_t n = GetDataSize(*arr.operator->()) / sizeof(float);
+  for (size_t i = 0; i < n; ++i) data[i] = dist(gen);
+  return arr;
+}
+
+/*! \brief Run f once for every SIMD level this machine supports. */
+template <typename F>
+void ForEachSIMDLevel(F f) {
+  SIMDLevel saved = GetSIMDLevel();
+  for (int level = 0; level <= static_cast<int>(DetectSIMDLevel()); ++level) {
+    SetSIMDLevel(static_cast<SIMDLevel>(level));
+    SCOPED_TRACE(SIMDLevelName(GetSIMDLevel()));
+    f();
+  }
+  SetSIMDLevel(saved);
+}
+
+}  // namespace
+
+TEST(Elementwise, BroadcastShape) {
+  EXPECT_EQ(BroadcastShape({2, 3, 4}, {4}), (std::vector<int64_t>{2, 3, 4}));
+  EXPECT_EQ(BroadcastShape({2, 1, 4}, {3, 1}), (std::vector<int64_t>{2, 3, 4}));
+  EXPECT_EQ(BroadcastShape({}, {5}), (std::vector<int64_t>{5}));
+  EXPECT_THROW(BroadcastShape({2, 3}, {4}), Error);
+}
+
+TEST(Elementwise, BinaryBroadcast) {
+  const std::vector<std::vector<std::vector<int64_t>>> cases = {
+      {{1000}, {1000}},   {{37, 65}, {65}},      {{37, 65}, {37, 1}},
+      {{1}, {7, 9}},      {{4, 1, 33}, {5, 1}},  {{3, 1, 5, 1}, {1, 4, 1, 6}},
+      {{256, 256}, {1}},  {{}, {}},
+  };
+  ForEachSIMDLevel([&]() {
+    for (const auto& shapes : cases) {
+      NDArray a = RandomArray(shapes[0], -4.0f, 4.0f, 1);
+      NDArray b = RandomArray(shapes[1], 0.5f, 4.0f, 2);
+      std::vector<int64_t> out_shape = BroadcastShape(shapes[0], shapes[1]);
+      NDArray out = NDArray::Empty(out_shape, a->dtype, cpu);
+      const float* pa = static_cast<const float*>(a->data);
+      const float* pb = static_cast<const float*>(b->data);
+      const float* po = static_cast<const float*>(out->data);
+      for (int op = 0; op < kNumBinaryOps; ++op) {
+        BinaryElementwise(static_cast<BinaryOpKind>(op), a, b, out);
+        // walk the output with a NumPy style index computation.
+        size_t ndim = out_shape.size();
+        int64_t total = 1;
+        for (int64_t e : out_shape) total *= e;
+        for (int64_t i = 0; i < total; ++i) {
+          int64_t rest = i, ia = 0, ib = 0, sa = 1, sb = 1;
+          for (size_t d = ndim; d != 0; --d) {
+            int64_t index = rest % out_shape[d - 1];
+            rest /= out_shape[d - 1];
+            size_t da = d - 1 - (ndim - shapes[0].size());
+            size_t db = d - 1 - (ndim - shapes[1].size());
+            if (d - 1 >= ndim - shapes[0].size()) {
+              if (shapes[0][da] != 1) ia += index * sa;
+              sa *= shapes[0][da];
+            }
+            if (d - 1 >= ndim - shapes[1].size()) {
+              if (shapes[1][db] != 1) ib += index * sb;
+              sb *= shapes[1][db];
+            }
+          }
+          float x = pa[ia], y = pb[ib];
+          float expected = op == kAdd   ? x + y
+                           : op == kSub ? x - y
+                           : op == kMul ? x * y
+                           : op == kDiv ? x / y
+                                        : std::max(x, y);
+          ASSERT_FLOAT_EQ(po[i], expected) << "op " << op << " at " << i;
+        }
+      }
+    }
+  });
+}
+
+TEST(Elementwise, Unary) {
+  ForEachSIMDLevel([&]() {
+    NDArray x = RandomArray({4099}, -20.0f, 20.0f, 3);
+    float* px = static_cast<float*>(x->data);
+    // special values around the thresholds of the approximations.
+    const float special[] = {0.0f, -0.0f, 1e-8f, -1e-8f, 0.624f, 0.626f, -0.626f,
+                             88.0f, -87.0f, -100.0f, 100.0f};
+    for (size_t i = 0; i < sizeof(special) / sizeof(float); ++i) px[i] = special[i];
+    NDArray out = NDArray::Empty({4099}, x->dtype, cpu);
+    const float* po = static_cast<const float*>(out->data);
+    for (int op = 0; op < kNumUnaryOps; ++op) {
+      UnaryElementwise(static_cast<UnaryOpKind>(op), x, out);
+      for (int64_t i = 0; i < 4099; ++i) {
+        double v = px[i];
+        double expected = op == kRelu      ? std::max(v, 0.0)
+                          : op == kSigmoid ? 1.0 / (1.0 + std::exp(-v))
+                          : op == kTanh    ? std::tanh(v)
+                          : op == kGelu    ? v / 2 * (1.0 + std::erf(v / std::sqrt(2.0)))
+                                           : std::exp(v);
+        double tol = 4e-7 * std::fabs(expected) + 1e-37;
+        // 1 + erf cancels for negative inputs.
+        if (op == kGelu) tol += 3e-7 * std::fabs(v);
+        if (op == kExp && v > 88.0) tol = INFINITY;
+        ASSERT_NEAR(po[i], expected, tol) << "op " << op << " x " << v;
+      }
+    }
+    // in place
+    UnaryElementwise(kRelu, x, x);
+    for (int64_t i = 0; i < 4099; ++i) ASSERT_GE(px[i], 0.0f);
+  });
+}
+
+TEST(Elementwise, OtherDTypes) {
+  NDArray a = NDArray::Empty({3, 4}, DLDataType{kDLInt, 32, 1}, cpu);
+  NDArray b = NDArray::Empty({4}, DLDataType{kDLInt, 32, 1}, cpu);
+  NDArray out = NDArray::Empty({3, 4}, DLDataType{kDLInt, 32, 1}, cpu);
+  int32_t* pa = static_cast<int32_t*>(a->data);
+  int32_t* pb = static_cast<int32_t*>(b->data);
+  int32_t* po = static_cast<int32_t*>(out->data);
+  for (int i = 0; i < 12; ++i) pa[i] = i - 6;
+  for (int i = 0; i < 4; ++i) pb[i] = i + 1;
+  BinaryElementwise(kDiv, a, b, out);
+  for (int i = 0; i < 12; ++i) EXPECT_EQ(po[i], (i - 6) / (i % 4 + 1));
+  UnaryElementwise(kRelu, a, out);
+  for (int i = 0; i < 12; ++i) EXPECT_EQ(po[i], std::max(i - 6, 0));
+  pb[2] = 0;
+  EXPECT_THROW(BinaryElementwise(kDiv, a, b, out), Error);
+  EXPECT_THROW(UnaryElementwise(kExp, a, out), Error);
+
+  NDArray d = NDArray::Empty({5}, DLDataType{kDLFloat, 64, 1}, cpu);
+  double* pd = static_cast<double*>(d->data);
+  for (int i = 0; i < 5; ++i) pd[i] = 0.5 * i;
+  NDArray e = NDArray::Empty({5}, DLDataType{kDLFloat, 64, 1}, cpu);
+  UnaryElementwise(kTanh, d, e);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_DOUBLE_EQ(static_cast<double*>(e->data)[i], std::tanh(0.5 * i));
+  }
+}
+
+TEST(Elementwise, Cast) {
+  ForEachSIMDLevel([&]() {
+    NDArray x = RandomArray({1001}, -1000.0f, 1000.0f, 4);
+    NDArray i32 = NDArray::Empty({1001}, DLDataType{kDLInt, 32, 1}, cpu);
+    NDArray back = NDArray::Empty({1001}, DLDataType{kDLFloat, 32, 1}, cpu);
+    NDArray u8 = NDArray::Empty({1001}, DLDataType{kDLUInt, 8, 1}, cpu);
+    NDArray f64 = NDArray::Empty({1001}, DLDataType{kDLFloat, 64, 1}, cpu);
+    Cast(x, i32);
+    Cast(i32, back);
+    Cast(i32, u8);
+    Cast(x, f64);
+    const float* px = static_cast<const float*>(x->data);
+    for (int i = 0; i < 1001; ++i) {
+      int32_t truncated = static_cast<int32_t>(px[i]);
+      ASSERT_EQ(static_cast<int32_t*>(i32->data)[i], truncated);
+      ASSERT_EQ(static_cast<float*>(back->data)[i], static_cast<float>(truncated));
+      ASSERT_EQ(static_cast<uint8_t*>(u8->data)[i], static_cast<uint8_t>(truncated));
+      ASSERT_EQ(static_cast<double*>(f64->data)[i], static_cast<double>(px[i]));
+    }
+  });
+}
+
+TEST(Elementwise, ParallelAndRegistry) {
+  ThreadPool::Global()->Configure(4, {});
+  NDArray a = RandomArray({3, 100000}, -1.0f, 1.0f, 5);
+  NDArray b = RandomArray({100000}, -1.0f, 1.0f, 6);
+  NDArray out = NDArray::Empty({3, 100000}, a->dtype, cpu);
+  const PackedFunc* add = Registry::Get("kernel.add");
+  ASSERT_TRUE(add != nullptr);
+  (*add)(a, b, out);
+  const float* pa = static_cast<const float*>(a->data);
+  const float* pb = static_cast<const float*>(b->data);
+  const float* po = static_cast<const float*>(out->data);
+  for (int64_t i = 0; i < 300000; ++i) ASSERT_EQ(po[i], pa[i] + pb[i % 100000]);
+
+  NDArray wrong = NDArray::Empty({3, 5}, a->dtype, cpu);
+  EXPECT_THROW((*add)(a, b, wrong), Error);
+  EXPECT_TRUE(Registry::Get("kernel.sigmoid") != nullptr);
+  EXPECT_TRUE(Registry::Get("kernel.cast") != nullptr);
+  String level = (*Registry::Get("kernel.GetSIMDLevel"))();
+  EXPECT_EQ(std::string(level), SIMDLevelName(GetSIMDLevel()));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,147 @@
+//
+// Created by WangJingYu on 2021/7/12.
+//
+
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include "../../src/runtime/file_utils.h"
+
+using namespace cvm::runtime;
+
+namespace {
+
+NDArray MakeArange(std::vector<int64_t> shape, float start) {
+  NDArray arr = NDArray::Empty(shape, DataType::Float(32), {kDLCPU, 0});
+  float* data = static_cast<float*>(arr->data);
+  size_t n = GetDataSize(*arr.operator->()) / sizeof(float);
+  for (size_t i = 0; i < n; ++i) data[i] = start + static_cast<float>(i);
+  return arr;
+}
+
+bool SameContent(const NDArray& a, const NDArray& b) {
+  if (a.Shape() != b.Shape() || a.DataType() != b.DataType()) return false;
+  return memcmp(a->data, b->data, GetDataSize(*a.operator->())) == 0;
+}
+
+std::string TempFile(const std::string& name) {
+  return "/tmp/cvm_" + name + "_" + std::to_string(getpid()) + ".params";
+}
+
+/*! \brief Overwrite the 8 bytes at a file offset. */
+void Patch(const std::string& path, uint64_t offset, uint64_t value) {
+  std::fstream fs(path, std::ios::in | std::ios::out | std::ios::binary);
+  fs.seekp(offset);
+  fs.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}  // namespace
+
+TEST(Params, SaveLoad) {
+  std::string path = TempFile("save_load");
+  Map<String, NDArray> params;
+  params.Set("weight", MakeArange({3, 5, 7}, 1.0f));
+  params.Set("bias", MakeArange({7}, -3.0f));
+  params.Set("scalar", MakeArange({}, 42.0f));
+  SaveParams(path, params, true);
+
+  for (int num_threads : {1, 3}) {
+    Map<String, NDArray> loaded = LoadParams(path, num_threads);
+    ASSERT_EQ(loaded.size(), 3U);
+    for (const auto& kv : params) {
+      ASSERT_EQ(loaded.count(kv.first), 1U);
+      NDArray arr = loaded[kv.first];
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(arr->data) % kAllocAlignment, 0U);
+      EXPECT_TRUE(SameContent(arr, kv.second));
+    }
+  }
+
+  ParamsFileReader reader(path);
+  EXPECT_TRUE(reader.has_checksum());
+  for (const ParamsFileEntry& e : reader.entries()) {
+    EXPECT_EQ(e.offset % kParamsAlignment, 0U);
+  }
+  EXPECT_TRUE(SameContent(reader.Load("bias"), params["bias"]));
+  EXPECT_FALSE(reader.Contains("missing"));
+  EXPECT_THROW(reader.Load("missing"), cvm::Error);
+  remove(path.c_str());
+}
+
+TEST(Params, ChecksumMismatch) {
+  std::string path = TempFile("checksum");
+  Map<String, NDArray> params;
+  params.Set("w", MakeArange({1024}, 0.0f));
+  SaveParams(path, params, true);
+
+  uint64_t offset = ParamsFileReader(path).entries()[0].offset;
+  {
+    std::fstream fs(path, std::ios::in | std::ios::out | std::ios::binary);
+    fs.seekp(offset + 17);
+    fs.put('\x7f');
+  }
+  EXPECT_THROW(LoadParams(path), cvm::Error);
+  EXPECT_NO_THROW(ParamsFileReader(path).LoadAll(1, false));
+  remove(path.c_str());
+}
+
+TEST(Params, Corrupted) {
+  std::string path = TempFile("corrupted");
+  Map<String, NDArray> params;
+  params.Set("w", MakeArange({1024}, 0.0f));
+  // the header, then the entry of w: name_len, name, dtype, ndim, shape, offset, nbytes.
+  const uint64_t num_tensors = 16, name_len = 32, shape = 49, offset = 57, nbytes = 65;
+  const uint64_t kHuge = uint64_t{1} << 62;
+  for (auto patch : std::vector<std::pair<uint64_t, uint64_t>>{
+           {0, __builtin_bswap64(kCVMParamsMagic)},
+           {num_tensors, kHuge},
+           {name_len, kHuge},
+           {shape, 1023},
+           {offset, ~uint64_t{0} - 4095},
+           {nbytes, ~uint64_t{0}}}) {
+    SaveParams(path, params, true);
+    Patch(path, patch.first, patch.second);
+    EXPECT_THROW(ParamsFileReader{path}, cvm::Error) << "patched at " << patch.first;
+  }
+  remove(path.c_str());
+}
+
+TEST(Params, PackedFunc) {
+  std::string path = TempFile("packed");
+  Map<String, NDArray> params;
+  params.Set("a", MakeArange({4, 4}, 0.0f));
+  params.Set("b", MakeArange({2}, 5.0f));
+
+  const PackedFunc* save = Registry::Get("runtime.SaveParams");
+  const PackedFunc* load = Registry::Get("runtime.LoadParams");
+  const PackedFunc* load_lazy = Registry::Get("runtime.LoadParamsLazy");
+  ASSERT_TRUE(save != nullptr && load != nullptr && load_lazy != nullptr);
+  (*save)(path, params, false);
+
+  Map<String, NDArray> loaded = (*load)(path, 0);
+  EXPECT_TRUE(SameContent(loaded["a"], params["a"]));
+  EXPECT_TRUE(SameContent(loaded["b"], params["b"]));
+
+  PackedFunc getter = (*load_lazy)(path);
+  NDArray b = getter("b");
+  EXPECT_TRUE(SameContent(b, params["b"]));
+  remove(path.c_str());
+}
+
+TEST(Params, CRC32C) {
+  // Check value of the Castagnoli polynomial.
+  const char* data = "123456789";
+  EXPECT_EQ(CRC32C(data, 9), 0xE3069283U);
+  EXPECT_EQ(CRC32C(data + 4, 5, CRC32C(data, 4)), 0xE3069283U);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
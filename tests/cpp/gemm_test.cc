@@ -0,0 +1,170 @@
+//
+// Created by WangJingYu on 2021/7/20.
+//
+
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../../src/runtime/kernels/gemm.h"
+#include "../../src/runtime/thread_pool.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+
+std::vector<float> RandomVector(size_t size, int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> v(size);
+  for (float& x : v) x = dist(gen);
+  return v;
+}
+
+/*! \brief Check Sgemm against a double precision loop, with padded leading dimensions. */
+void CheckSgemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k, float alpha,
+                float beta) {
+  SCOPED_TRACE(::testing::Message() << "m " << m << " n " << n << " k " << k << " trans_a "
+                                    << trans_a << " trans_b " << trans_b << " beta " << beta);
+  int64_t lda = (trans_a ? m : k) + 3;
+  int64_t ldb = (trans_b ? k : n) + 1;
+  int64_t ldc = n + 2;
+  std::vector<float> a = RandomVector((trans_a ? k : m) * lda, 1);
+  std::vector<float> b = RandomVector((trans_b ? n : k) * ldb, 2);
+  std::vector<float> c = RandomVector(m * ldc, 3);
+  if (beta == 0.0f) {
+    // never read.
+    for (int64_t i = 0; i < m; ++i) c[i * ldc] = NAN;
+  }
+  std::vector<float> c0 = c;
+  Sgemm(trans_a, trans_b, m, n, k, alpha, a.data(), lda, b.data(), ldb, beta, c.data(), ldc);
+  for (int64_t i = 0; i < m; ++i) {
+    for (int64_t j = 0; j < n; ++j) {
+      double sum = 0.0;
+      for (int64_t p = 0; p < k; ++p) {
+        double x = trans_a ? a[p * lda + i] : a[i * lda + p];
+        double y = trans_b ? b[j * ldb + p] : b[p * ldb + j];
+        sum += x * y;
+      }
+      double expected = alpha * sum + (beta == 0.0f ? 0.0 : beta * c0[i * ldc + j]);
+      ASSERT_NEAR(c[i * ldc + j], expected, 1e-5 * (k + 1)) << "at " << i << ", " << j;
+    }
+    // the padding is untouched.
+    ASSERT_EQ(c[i * ldc + n], c0[i * ldc + n]);
+  }
+}
+
+template <typename F>
+void ForEachSIMDLevel(F f) {
+  SIMDLevel saved = GetSIMDLevel();
+  for (int level = 0; level <= static_cast<int>(DetectSIMDLevel()); ++level) {
+    SetSIMDLevel(static_cast<SIMDLevel>(level));
+    SCOPED_TRACE(SIMDLevelName(GetSIMDLevel()));
+    f();
+  }
+  SetSIMDLevel(saved);
+}
+
+}  // namespace
+
+TEST(Gemm, Shapes) {
+  ThreadPool::Global()->Configure(1, {});
+  const std::vector<std::vector<int64_t>> shapes = {
+      {1, 1, 1},    {1, 100, 37}, {3, 65, 129}, {7, 33, 5},    {8, 64, 64},
+      {13, 31, 17}, {37, 53, 70}, {64, 1, 64},  {100, 97, 300},
+  };
+  ForEachSIMDLevel([&]() {
+    for (const auto& s : shapes) {
+      for (int trans = 0; trans < 4; ++trans) {
+        CheckSgemm(trans & 1, trans & 2, s[0], s[1], s[2], 1.0f, 0.0f);
+      }
+      CheckSgemm(false, false, s[0], s[1], s[2], 0.5f, 2.0f);
+      CheckSgemm(false, true, s[0], s[1], s[2], -1.5f, 1.0f);
+    }
+  });
+}
+
+TEST(Gemm, Blocking) {
+  SIMDLevel level = GetSIMDLevel();
+  GemmBlocking defaults = GetGemmBlocking(level);
+  const GemmKernels* kernels = GetGemmKernels(level);
+  EXPECT_EQ(defaults.mc % kernels->mr, 0);
+  EXPECT_EQ(defaults.nc % kernels->nr, 0);
+  EXPECT_GE(defaults.kc, 64);
+
+  // blocks much smaller than the matrices, every loop of the blocking runs several times.
+  SetGemmBlocking(level, {1, 16, 1});
+  GemmBlocking small = GetGemmBlocking(level);
+  EXPECT_EQ(small.mc, kernels->mr);
+  EXPECT_EQ(small.nc, kernels->nr);
+  for (int threads : {1, 3, 4}) {
+    ThreadPool::Global()->Configure(threads, {});
+    CheckSgemm(false, false, 50, 70, 90, 1.0f, 0.0f);
+    CheckSgemm(true, true, 50, 70, 90, 2.0f, 0.5f);
+  }
+  SetGemmBlocking(level, {0, 0, 0});
+  EXPECT_EQ(GetGemmBlocking(level).kc, defaults.kc);
+  EXPECT_THROW(SetGemmBlocking(level, {-1, 0, 0}), Error);
+}
+
+TEST(Gemm, Parallel) {
+  for (int threads : {2, 4}) {
+    ThreadPool::Global()->Configure(threads, {});
+    CheckSgemm(false, false, 200, 150, 130, 1.0f, 0.0f);
+    CheckSgemm(false, true, 3, 500, 200, 1.0f, 1.0f);
+    CheckSgemm(true, false, 5, 333, 300, 1.0f, 0.0f);
+  }
+}
+
+TEST(Gemm, Degenerate) {
+  std::vector<float> c = {1.0f, 2.0f, 3.0f, 4.0f};
+  float a = 1.0f, b = 1.0f;
+  Sgemm(false, false, 2, 2, 0, 1.0f, &a, 1, &b, 2, 2.0f, c.data(), 2);
+  EXPECT_EQ(c, (std::vector<float>{2.0f, 4.0f, 6.0f, 8.0f}));
+  Sgemm(false, false, 2, 2, 0, 1.0f, &a, 1, &b, 2, 0.0f, c.data(), 2);
+  EXPECT_EQ(c, (std::vector<float>{0.0f, 0.0f, 0.0f, 0.0f}));
+}
+
+TEST(Gemm, Matmul) {
+  ThreadPool::Global()->Configure(2, {});
+  DLDataType f32{kDLFloat, 32, 1};
+  NDArray data = NDArray::Empty({4, 3}, f32, cpu);
+  NDArray weight = NDArray::Empty({2, 3}, f32, cpu);
+  NDArray out = NDArray::Empty({4, 2}, f32, cpu);
+  float* pd = static_cast<float*>(data->data);
+  float* pw = static_cast<float*>(weight->data);
+  for (int i = 0; i < 12; ++i) pd[i] = static_cast<float>(i);
+  for (int i = 0; i < 6; ++i) pw[i] = static_cast<float>(i % 3 == 0 ? 1 : -1);
+  const PackedFunc* dense = Registry::Get("kernel.dense");
+  ASSERT_TRUE(dense != nullptr);
+  (*dense)(data, weight, out);
+  const float* po = static_cast<const float*>(out->data);
+  for (int i = 0; i < 4; ++i) {
+    float expected = pd[i * 3] - pd[i * 3 + 1] - pd[i * 3 + 2];
+    EXPECT_EQ(po[i * 2], expected);
+    EXPECT_EQ(po[i * 2 + 1], expected);
+  }
+
+  const PackedFunc* matmul = Registry::Get("kernel.matmul");
+  ASSERT_TRUE(matmul != nullptr);
+  NDArray square = NDArray::Empty({2, 2}, f32, cpu);
+  (*matmul)(weight, weight, square, false, true);
+  EXPECT_EQ(static_cast<float*>(square->data)[0], 3.0f);
+  EXPECT_THROW((*matmul)(data, weight, out, false, false), Error);
+  EXPECT_THROW((*matmul)(data, data, out, false, true), Error);
+  NDArray ints = NDArray::Empty({4, 3}, DLDataType{kDLInt, 32, 1}, cpu);
+  EXPECT_THROW(Matmul(ints, ints, ints, false, true), Error);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,451 @@
+//
+// Created by WangJingYu on 2021/7/27.
+//
+
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../src/runtime/graph_executor.h"
+#include "../../src/runtime/thread_pool.h"
+#include "../../src/support/json.h"
+
+using namespace cvm::runtime;
+using cvm::support::JSONValue;
+
+namespace {
+
+/*! \brief The operator new calls while counting. */
+std::atomic<int64_t> num_allocs{0};
+std::atomic<bool> counting{false};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  if (counting.load(std::memory_order_relaxed)) num_allocs.fetch_add(1);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+const DLDataType kFloat32{kDLFloat, 32, 1};
+
+/*! \brief out = x + 1, an op without allocations. */
+CVM_REGISTER_GLOBAL("test.graph.add_one").set_body_typed([](NDArray x, NDArray out) {
+  const float* px = static_cast<const float*>(x->data);
+  float* po = static_cast<float*>(out->data);
+  int64_t n = GetDataSize(*x.operator->()) / sizeof(float);
+  for (int64_t i = 0; i < n; ++i) po[i] = px[i] + 1.0f;
+});
+
+NDArray Filled(std::vector<int64_t> shape, float start, float step) {
+  NDArray arr = NDArray::Empty(shape, kFloat32, cpu);
+  float* data = static_cast<float*>(arr->data);
+  size_t n = GetDataSize(*arr.operator->()) / sizeof(float);
+  for (size_t i = 0; i < n; ++i) data[i] = start + step * i;
+  return arr;
+}
+
+/*! \brief Whether the last test.graph.record_region ran inside a parallel region. */
+std::atomic<bool> recorded_in_region{false};
+
+/*! \brief out = x + 1, recording whether it runs inside a parallel region. */
+CVM_REGISTER_GLOBAL("test.graph.record_region").set_body_typed([](NDArray x, NDArray out) {
+  recorded_in_region = ThreadPool::InParallelRegion();
+  const float* px = static_cast<const float*>(x->data);
+  float* po = static_cast<float*>(out->data);
+  int64_t n = GetDataSize(*x.operator->()) / sizeof(float);
+  for (int64_t i = 0; i < n; ++i) po[i] = px[i] + 1.0f;
+});
+
+/*! \brief Whether test.graph.maybe_throw throws. */
+std::atomic<bool> throw_error{false};
+
+CVM_REGISTER_GLOBAL("test.graph.maybe_throw").set_body_typed([](NDArray /*x*/, NDArray /*out*/) {
+  if (throw_error) throw Error("test.graph.maybe_throw");
+});
+
+/*! \brief A node of a graph written by GraphJSON. */
+struct TestNode {
+  std::string op;
+  std::vector<int> inputs;
+  std::vector<int64_t> shape;
+  std::string attrs;
+};
+
+std::string GraphJSON(const std::vector<TestNode>& nodes, const std::vector<int>& heads) {
+  auto list = [](const std::vector<int64_t>& values) {
+    std::string s = "[";
+    for (size_t i = 0; i < values.size(); ++i) s += (i ? ", " : "") + std::to_string(values[i]);
+    return s + "]";
+  };
+  std::string json = "{\"nodes\": [";
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const TestNode& node = nodes[i];
+    json += std::string(i ? ", " : "") + "{\"op\": \"" + node.op + "\", \"name\": \"n" +
+            std::to_string(i) + "\", \"shape\": " + list(node.shape) + ", \"inputs\": " +
+            list(std::vector<int64_t>(node.inputs.begin(), node.inputs.end()));
+    if (!node.attrs.empty()) json += ", \"attrs\": " + node.attrs;
+    json += "}";
+  }
+  return json + "], \"heads\": " + list(std::vector<int64_t>(heads.begin(), heads.end())) + "}";
+}
+
+/*!
+ * \brief num_branches branches of dense, gelu, dense, softmax from x [rows, 64],
+ *  summed by a chain of adds.
+ */
+std::vector<TestNode> WideGraph(int num_branches, int64_t rows) {
+  std::vector<TestNode> nodes = {{"null", {}, {rows, 64}, ""}};
+  std::vector<int> ends;
+  for (int b = 0; b < num_branches; ++b) {
+    int w0 = static_cast<int>(nodes.size());
+    nodes.push_back({"null", {}, {64, 64}, ""});
+    nodes.push_back({"null", {}, {64, 64}, ""});
+    nodes.push_back({"kernel.dense", {0, w0}, {rows, 64}, ""});
+    nodes.push_back({"kernel.gelu", {w0 + 2}, {rows, 64}, ""});
+    nodes.push_back({"kernel.dense", {w0 + 3, w0 + 1}, {rows, 64}, ""});
+    nodes.push_back({"kernel.softmax", {w0 + 4}, {rows, 64}, ""});
+    ends.push_back(w0 + 5);
+  }
+  int sum = ends[0];
+  for (size_t b = 1; b < ends.size(); ++b) {
+    nodes.push_back({"kernel.add", {sum, ends[b]}, {rows, 64}, ""});
+    sum = static_cast<int>(nodes.size()) - 1;
+  }
+  return nodes;
+}
+
+/*! \brief Run a graph with random inputs and return its outputs. */
+std::vector<std::vector<float>> RunGraph(const std::string& json, ExecutionPolicy policy,
+                                         int repeats) {
+  GraphExecutor exec(json, cpu, policy);
+  std::mt19937 gen(7);
+  std::normal_distribution<float> dist(0.0f, 0.5f);
+  for (int i = 0; i < exec.NumInputs(); ++i) {
+    NDArray input = exec.GetInput(i);
+    float* data = static_cast<float*>(input->data);
+    size_t n = GetDataSize(*input.operator->()) / sizeof(float);
+    for (size_t j = 0; j < n; ++j) data[j] = dist(gen);
+  }
+  std::vector<std::vector<float>> outputs(exec.NumOutputs());
+  for (int r = 0; r < repeats; ++r) {
+    exec.Run();
+    for (int i = 0; i < exec.NumOutputs(); ++i) {
+      NDArray out = exec.GetOutput(i);
+      const float* data = static_cast<const float*>(out->data);
+      std::vector<float> values(data, data + GetDataSize(*out.operator->()) / sizeof(float));
+      if (r > 0) {
+        EXPECT_EQ(values, outputs[i]) << "run " << r << " output " << i;
+      }
+      outputs[i] = std::move(values);
+    }
+  }
+  return outputs;
+}
+
+/*! \brief A graph of n add_one nodes after the input x of shape [len]. */
+std::string ChainGraph(int n, int64_t len) {
+  std::string shape = "[" + std::to_string(len) + "]";
+  std::string json = R"({"nodes": [{"op": "null", "name": "x", "shape": )" + shape + "}";
+  for (int i = 1; i <= n; ++i) {
+    json += R"(, {"op": "test.graph.add_one", "inputs": [)" + std::to_string(i - 1) +
+            R"(], "shape": )" + shape + "}";
+  }
+  return json + R"(], "heads": [)" + std::to_string(n) + "]}";
+}
+
+}  // namespace
+
+TEST(JSON, Parse) {
+  JSONValue v = JSONValue::Parse(R"( {"a": [1, -2.5e1, true, null], "b": {"c": "x\"\u00e9\n"},
+                                      "d": [], "e": {}} )");
+  ASSERT_TRUE(v.IsObject());
+  const std::vector<JSONValue>& a = v["a"].AsArray();
+  ASSERT_EQ(a.size(), 4U);
+  EXPECT_EQ(a[0].AsInt(), 1);
+  EXPECT_EQ(a[1].AsNumber(), -25.0);
+  EXPECT_TRUE(a[1].IsInt());
+  EXPECT_TRUE(a[2].AsBool());
+  EXPECT_TRUE(a[3].IsNull());
+  EXPECT_EQ(v["b"]["c"].AsString(), "x\"\xc3\xa9\n");
+  EXPECT_TRUE(v["d"].AsArray().empty());
+  EXPECT_TRUE(v["e"].AsObject().empty());
+  EXPECT_EQ(v.Find("f"), nullptr);
+  EXPECT_EQ(JSONValue::Parse("\"\\ud83d\\ude00\"").AsString(), "\xf0\x9f\x98\x80");
+
+  EXPECT_THROW(v["f"], Error);
+  EXPECT_THROW(v["a"].AsString(), Error);
+  EXPECT_THROW(JSONValue::Parse("0.5").AsInt(), Error);
+  for (const char* bad : {"", "[1,]", "{\"a\" 1}", "[1] 2", "nul", "\"a", "0x10", "[.5]",
+                          "{\"a\": [}", "\"\\q\""}) {
+    EXPECT_THROW(JSONValue::Parse(bad), Error) << bad;
+  }
+  EXPECT_THROW(JSONValue::Parse(std::string(1000, '[')), Error);
+}
+
+TEST(GraphExecutor, Run) {
+  // r = relu(x + w), y = r * x, r is read by y and is an output too.
+  const char* json = R"({
+    "nodes": [
+      {"op": "null", "name": "x", "shape": [2, 8]},
+      {"op": "null", "name": "w", "shape": [8], "dtype": "float32"},
+      {"op": "kernel.add", "name": "a", "inputs": [0, 1], "shape": [2, 8]},
+      {"op": "kernel.relu", "name": "r", "inputs": [2], "shape": [2, 8]},
+      {"op": "kernel.multiply", "name": "y", "inputs": [3, 0], "shape": [2, 8]}
+    ],
+    "heads": [4, 3]
+  })";
+  GraphExecutor exec(json, cpu);
+  ASSERT_EQ(exec.NumInputs(), 2);
+  ASSERT_EQ(exec.NumOutputs(), 2);
+  EXPECT_EQ(exec.NumOpNodes(), 3);
+  EXPECT_EQ(exec.GetInputIndex("w"), 1);
+  EXPECT_EQ(exec.GetInputIndex("a"), -1);
+
+  for (float offset : {-4.0f, 2.0f}) {
+    NDArray x = Filled({2, 8}, offset, 0.5f);
+    NDArray w = Filled({8}, -1.0f, 0.25f);
+    exec.SetInput(0, x);
+    exec.SetInput(1, w);
+    exec.Run();
+    // the inputs keep their values over runs.
+    exec.Run();
+    const float* px = static_cast<const float*>(x->data);
+    const float* pw = static_cast<const float*>(w->data);
+    const float* py = static_cast<const float*>(exec.GetOutput(0)->data);
+    const float* pr = static_cast<const float*>(exec.GetOutput(1)->data);
+    for (int i = 0; i < 16; ++i) {
+      float r = std::max(px[i] + pw[i % 8], 0.0f);
+      ASSERT_EQ(pr[i], r) << i;
+      ASSERT_EQ(py[i], r * px[i]) << i;
+    }
+  }
+}
+
+TEST(GraphExecutor, Attrs) {
+  // sum over axis 1 with keepdims, then NCHW to NHWC.
+  const char* json = R"({
+    "nodes": [
+      {"op": "null", "name": "x", "shape": [1, 3, 2, 4]},
+      {"op": "kernel.sum", "inputs": [0], "shape": [1, 1, 2, 4], "attrs": [[1], true, false]},
+      {"op": "kernel.layout_transform", "inputs": [0], "shape": [1, 2, 4, 3],
+       "attrs": ["NCHW", "NHWC"]}
+    ],
+    "heads": [1, 2]
+  })";
+  GraphExecutor exec(json, cpu);
+  NDArray x = Filled({1, 3, 2, 4}, 0.0f, 1.0f);
+  exec.SetInput(0, x);
+  exec.Run();
+  const float* sum = static_cast<const float*>(exec.GetOutput(0)->data);
+  const float* nhwc = static_cast<const float*>(exec.GetOutput(1)->data);
+  for (int hw = 0; hw < 8; ++hw) {
+    EXPECT_EQ(sum[hw], hw + (8 + hw) + (16 + hw));
+    for (int c = 0; c < 3; ++c) EXPECT_EQ(nhwc[hw * 3 + c], c * 8 + hw);
+  }
+}
+
+TEST(GraphExecutor, PlannedStorage) {
+  const int n = 20;
+  const int64_t len = 1024;
+  GraphExecutor exec(ChainGraph(n, len), cpu);
+  // a chain needs two buffers, whatever its length.
+  EXPECT_LE(exec.ArenaBytes(), 2 * len * sizeof(float) + 2 * kAllocAlignment);
+  exec.SetInput(0, Filled({len}, 0.0f, 1.0f));
+  exec.Run();
+  const float* out = static_cast<const float*>(exec.GetOutput(0)->data);
+  for (int64_t i = 0; i < len; ++i) ASSERT_EQ(out[i], i + n);
+}
+
+TEST(GraphExecutor, RunWithoutAllocations) {
+  GraphExecutor exec(ChainGraph(50, 16), cpu);
+  exec.SetInput(0, Filled({16}, 0.0f, 1.0f));
+  exec.Run();
+  num_allocs = 0;
+  counting = true;
+  for (int i = 0; i < 10; ++i) exec.Run();
+  counting = false;
+  EXPECT_EQ(num_allocs.load(), 0);
+}
+
+TEST(GraphExecutor, PackedFuncInterface) {
+  const PackedFunc* create = Registry::Get("runtime.GraphExecutorCreate");
+  const PackedFunc* get_function = Registry::Get("runtime.GraphExecutorGetFunction");
+  ASSERT_TRUE(create != nullptr && get_function != nullptr);
+  PackedFunc set_input, run, get_output, get_num_outputs, get_input_index;
+  {
+    // the functions keep the executor alive.
+    ObjectRef exec = (*create)(ChainGraph(3, 4), static_cast<int>(kDLCPU), 0);
+    set_input = (*get_function)(exec, "set_input");
+    run = (*get_function)(exec, "run");
+    get_output = (*get_function)(exec, "get_output");
+    get_num_outputs = (*get_function)(exec, "get_num_outputs");
+    get_input_index = (*get_function)(exec, "get_input_index");
+    PackedFunc unknown = (*get_function)(exec, "unknown");
+    EXPECT_TRUE(unknown == nullptr);
+  }
+  EXPECT_EQ(static_cast<int>(get_num_outputs()), 1);
+  EXPECT_EQ(static_cast<int>(get_input_index("x")), 0);
+  set_input("x", Filled({4}, 1.0f, 0.0f));
+  run();
+  NDArray out = get_output(0);
+  EXPECT_EQ(static_cast<const float*>(out->data)[3], 4.0f);
+  set_input(0, Filled({4}, 5.0f, 0.0f));
+  run();
+  EXPECT_EQ(static_cast<const float*>(out->data)[0], 8.0f);
+  EXPECT_THROW(set_input("y", Filled({4}, 1.0f, 0.0f)), Error);
+}
+
+TEST(GraphExecutor, Errors) {
+  auto load = [](const std::string& json) { GraphExecutor exec(json, cpu); };
+  const std::string x = R"({"op": "null", "name": "x", "shape": [4]})";
+  EXPECT_THROW(load("{\"nodes\": ["), Error);
+  EXPECT_THROW(load(R"({"nodes": [)" + x + "]}"), Error);
+  EXPECT_THROW(load(R"({"nodes": [)" + x + R"(, {"op": "test.graph.none", "inputs": [0],
+                    "shape": [4]}], "heads": [1]})"),
+               Error);
+  EXPECT_THROW(load(R"({"nodes": [)" + x + R"(, {"op": "test.graph.add_one", "inputs": [1],
+                    "shape": [4]}], "heads": [1]})"),
+               Error);
+  EXPECT_THROW(load(R"({"nodes": [)" + x + ", " + x + R"(], "heads": [0]})"), Error);
+  EXPECT_THROW(load(R"({"nodes": [)" + x + R"(], "heads": [2]})"), Error);
+  EXPECT_THROW(load(R"({"nodes": [{"op": "null", "name": "x", "shape": [-1]}], "heads": [0]})"),
+               Error);
+
+  GraphExecutor exec(ChainGraph(2, 4), cpu);
+  EXPECT_THROW(exec.SetInput(0, Filled({5}, 0.0f, 1.0f)), Error);
+  EXPECT_THROW(exec.SetInput(1, Filled({4}, 0.0f, 1.0f)), Error);
+  EXPECT_THROW(exec.GetOutput(1), Error);
+}
+
+TEST(GraphExecutor, InterOpMatchesSequential) {
+  // a wide graph and two towers of four layers joined at the end.
+  std::vector<TestNode> towers = {{"null", {}, {16, 64}, ""}};
+  std::vector<int> tops;
+  for (int t = 0; t < 2; ++t) {
+    int prev = 0;
+    for (int layer = 0; layer < 4; ++layer) {
+      int w = static_cast<int>(towers.size());
+      towers.push_back({"null", {}, {64, 64}, ""});
+      towers.push_back({"kernel.dense", {prev, w}, {16, 64}, ""});
+      towers.push_back({"kernel.relu", {w + 1}, {16, 64}, ""});
+      prev = w + 2;
+    }
+    int gamma = static_cast<int>(towers.size());
+    towers.push_back({"null", {}, {64}, ""});
+    towers.push_back({"null", {}, {64}, ""});
+    towers.push_back({"kernel.layer_norm", {prev, gamma, gamma + 1}, {16, 64}, "[1e-5]"});
+    tops.push_back(gamma + 2);
+  }
+  towers.push_back({"kernel.multiply", {tops[0], tops[1]}, {16, 64}, ""});
+  int last = static_cast<int>(towers.size()) - 1;
+  const std::vector<std::string> graphs = {GraphJSON(WideGraph(8, 32), {55}),
+                                           GraphJSON(towers, {last, tops[0]})};
+
+  ThreadPool::Global()->Configure(1, {});
+  std::vector<std::vector<std::vector<float>>> expected;
+  for (const std::string& json : graphs) {
+    expected.push_back(RunGraph(json, ExecutionPolicy::kSequential, 1));
+  }
+  ThreadPool::Global()->Configure(4, {});
+  for (size_t g = 0; g < graphs.size(); ++g) {
+    EXPECT_TRUE(GraphExecutor(graphs[g], cpu).UsesInterOp());
+    for (ExecutionPolicy policy :
+         {ExecutionPolicy::kSequential, ExecutionPolicy::kInterOp, ExecutionPolicy::kAuto}) {
+      SCOPED_TRACE(static_cast<int>(policy));
+      EXPECT_EQ(RunGraph(graphs[g], policy, 20), expected[g]) << "graph " << g;
+    }
+  }
+  ThreadPool::Global()->Configure(1, {});
+}
+
+TEST(GraphExecutor, InterOpPolicy) {
+  // a chain stays sequential under kAuto and keeps the sequential plan.
+  GraphExecutor chain(ChainGraph(10, 64), cpu);
+  EXPECT_FALSE(chain.UsesInterOp());
+  EXPECT_EQ(chain.Parallelism(), 1.0);
+  GraphExecutor forced(ChainGraph(10, 64), cpu, ExecutionPolicy::kInterOp);
+  EXPECT_TRUE(forced.UsesInterOp());
+
+  // three branches of 2, 1 and 1 nodes: 4 nodes over a critical path of 2.
+  std::vector<TestNode> nodes = {{"null", {}, {64}, ""},
+                                 {"test.graph.add_one", {0}, {64}, ""},
+                                 {"test.graph.add_one", {1}, {64}, ""},
+                                 {"test.graph.add_one", {0}, {64}, ""},
+                                 {"test.graph.add_one", {0}, {64}, ""}};
+  GraphExecutor wide(GraphJSON(nodes, {2, 3, 4}), cpu);
+  EXPECT_TRUE(wide.UsesInterOp());
+  EXPECT_DOUBLE_EQ(wide.Parallelism(), 2.0);
+  // the outputs of independent nodes never share memory.
+  EXPECT_GE(wide.ArenaBytes(), 3 * 64 * sizeof(float));
+
+  // between two wide parts, a costly node alone runs with all the threads.
+  const int64_t big = 1 << 17;
+  nodes = {{"null", {}, {big}, ""},
+           {"test.graph.add_one", {0}, {big}, ""},
+           {"test.graph.add_one", {0}, {big}, ""},
+           {"kernel.add", {1, 2}, {big}, ""},
+           {"test.graph.record_region", {3}, {big}, ""},
+           {"test.graph.add_one", {4}, {big}, ""},
+           {"test.graph.add_one", {4}, {big}, ""},
+           {"test.graph.add_one", {4}, {big}, ""}};
+  ThreadPool::Global()->Configure(4, {});
+  for (ExecutionPolicy policy : {ExecutionPolicy::kAuto, ExecutionPolicy::kInterOp}) {
+    GraphExecutor exec(GraphJSON(nodes, {5, 6, 7}), cpu, policy);
+    ASSERT_TRUE(exec.UsesInterOp());
+    exec.SetInput(0, Filled({big}, 0.0f, 1.0f));
+    exec.Run();
+    EXPECT_EQ(recorded_in_region.load(), policy == ExecutionPolicy::kInterOp);
+    const float* out = static_cast<const float*>(exec.GetOutput(1)->data);
+    for (int64_t i = 0; i < big; i += 4097) ASSERT_EQ(out[i], 2.0f * i + 4.0f) << i;
+  }
+  ThreadPool::Global()->Configure(1, {});
+}
+
+TEST(GraphExecutor, InterOpErrorsAndAllocations) {
+  std::vector<TestNode> nodes = {{"null", {}, {16}, ""}};
+  for (int b = 0; b < 6; ++b) {
+    nodes.push_back({"test.graph.add_one", {0}, {16}, ""});
+    nodes.push_back({b == 3 ? "test.graph.maybe_throw" : "test.graph.add_one",
+                     {static_cast<int>(nodes.size()) - 1}, {16}, ""});
+  }
+  std::vector<int> heads = {2, 4, 6, 8, 10, 12};
+  ThreadPool::Global()->Configure(4, {});
+  GraphExecutor exec(GraphJSON(nodes, heads), cpu);
+  ASSERT_TRUE(exec.UsesInterOp());
+  exec.SetInput(0, Filled({16}, 0.0f, 1.0f));
+  throw_error = true;
+  EXPECT_THROW(exec.Run(), Error);
+  throw_error = false;
+  exec.Run();
+  EXPECT_EQ(static_cast<const float*>(exec.GetOutput(5)->data)[15], 17.0f);
+
+  num_allocs = 0;
+  counting = true;
+  for (int i = 0; i < 10; ++i) exec.Run();
+  counting = false;
+  EXPECT_EQ(num_allocs.load(), 0);
+  ThreadPool::Global()->Configure(1, {});
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
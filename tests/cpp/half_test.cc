@@ -0,0 +1,294 @@
+//
+// Created by WangJingYu on 2021/7/23.
+//
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../../src/runtime/kernels/elementwise.h"
+#include "../../src/runtime/kernels/gemm.h"
+#include "../../src/runtime/thread_pool.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+const DLDataType kFloat16{kDLFloat, 16, 1};
+const DLDataType kBFloat16{kDLBfloat, 16, 1};
+const DLDataType kFloat32{kDLFloat, 32, 1};
+
+/*! \brief Run f once for every SIMD level this machine supports. */
+template <typename F>
+void ForEachSIMDLevel(F f) {
+  SIMDLevel saved = GetSIMDLevel();
+  for (int level = 0; level <= static_cast<int>(DetectSIMDLevel()); ++level) {
+    SetSIMDLevel(static_cast<SIMDLevel>(level));
+    SCOPED_TRACE(SIMDLevelName(GetSIMDLevel()));
+    f();
+  }
+  SetSIMDLevel(saved);
+}
+
+uint32_t Bits(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+float FromBits(uint32_t bits) {
+  float x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+/*! \brief Round a finite double to p significant bits and exponents down to min_exp. */
+double RoundToPrecision(double a, int p, int min_exp) {
+  int e;
+  std::frexp(a, &e);
+  double ulp = std::ldexp(1.0, std::max(e - 1, min_exp) - (p - 1));
+  return std::nearbyint(a / ulp) * ulp;
+}
+
+/*! \brief float16 bits of x, by rounding in double precision. */
+uint16_t RefFloat16(float x) {
+  uint16_t sign = std::signbit(x) ? 0x8000 : 0;
+  double a = std::fabs(static_cast<double>(x));
+  if (std::isnan(x)) return 0x7e00;
+  double r = RoundToPrecision(a, 11, -14);
+  if (r >= 65536.0) return sign | 0x7c00;
+  if (r < std::ldexp(1.0, -14)) return sign | static_cast<uint16_t>(r * std::ldexp(1.0, 24));
+  int e;
+  double m = std::frexp(r, &e);  // r = m * 2^e, m in [0.5, 1)
+  return sign | static_cast<uint16_t>((e + 14) << 10) |
+         static_cast<uint16_t>(m * 2048.0 - 1024.0);
+}
+
+/*! \brief bfloat16 bits of x, by rounding in double precision. */
+uint16_t RefBFloat16(float x) {
+  if (std::isnan(x)) return 0x7fc0;
+  double r = RoundToPrecision(std::fabs(static_cast<double>(x)), 8, -126);
+  float f = static_cast<float>(std::signbit(x) ? -r : r);
+  return static_cast<uint16_t>(Bits(f) >> 16);
+}
+
+float Float16Value(uint16_t h) {
+  int e = (h >> 10) & 0x1f, m = h & 0x3ff;
+  double v = e == 0 ? std::ldexp(m, -24) : e == 31 ? (m ? NAN : INFINITY)
+                                                   : std::ldexp(1024 + m, e - 25);
+  return static_cast<float>((h & 0x8000) ? -v : v);
+}
+
+std::vector<float> TestValues() {
+  std::vector<float> values = {0.0f,     -0.0f,     1.0f,       -1.0f,    65504.0f, 65519.0f,
+                               65520.0f, -65520.0f, 1e-8f,      6.1e-5f,  5.96e-8f, 2.98e-8f,
+                               2.99e-8f, INFINITY,  -INFINITY,  NAN,      FLT_MAX,  FLT_MIN,
+                               1e-40f,   -3e-39f,   1.00048828f, 1.00146484f};
+  // halfway cases of both formats.
+  values.push_back(FromBits(0x3f808000));
+  values.push_back(FromBits(0x3f818000));
+  values.push_back(FromBits(0x3f801000));
+  values.push_back(FromBits(0x3f803000));
+  values.push_back(FromBits(0x7f7fffff));
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<uint32_t> bits;
+  while (values.size() < 20011) values.push_back(FromBits(bits(gen)));
+  return values;
+}
+
+NDArray FloatArray(const std::vector<float>& values, std::vector<int64_t> shape) {
+  NDArray arr = NDArray::Empty(shape, kFloat32, cpu);
+  std::copy(values.begin(), values.end(), static_cast<float*>(arr->data));
+  return arr;
+}
+
+std::vector<float> RandomValues(size_t n, int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+  std::vector<float> v(n);
+  for (float& x : v) x = dist(gen);
+  return v;
+}
+
+/*! \brief The values of a float32 array rounded to a 16-bit type, as a float32 array. */
+std::vector<float> Rounded(const std::vector<float>& values, DLDataType dtype) {
+  std::vector<float> out(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    out[i] = dtype.code == kDLBfloat ? FromBits(static_cast<uint32_t>(RefBFloat16(values[i]))
+                                                << 16)
+                                     : Float16Value(RefFloat16(values[i]));
+  }
+  return out;
+}
+
+NDArray HalfArray(const std::vector<float>& values, std::vector<int64_t> shape, DLDataType dtype) {
+  NDArray arr = NDArray::Empty(shape, dtype, cpu);
+  Cast(FloatArray(values, shape), arr);
+  return arr;
+}
+
+}  // namespace
+
+TEST(Half, Conversions) {
+  const std::vector<float> values = TestValues();
+  const int64_t n = static_cast<int64_t>(values.size());
+  std::vector<uint16_t> half(n);
+  std::vector<float> back(n);
+  ForEachSIMDLevel([&]() {
+    const HalfKernels* kernels = GetHalfKernels(GetSIMDLevel());
+    // AVX-512 BF16 flushes subnormals to zero.
+    const bool flush = GetSIMDLevel() == SIMDLevel::kAVX512 && HasAVX512BF16();
+    kernels->float_to_float16(values.data(), half.data(), n);
+    for (int64_t i = 0; i < n; ++i) {
+      uint16_t expected = RefFloat16(values[i]);
+      if (std::isnan(values[i])) {
+        ASSERT_EQ(half[i] & 0x7e00, 0x7e00) << values[i];
+      } else {
+        ASSERT_EQ(half[i], expected) << values[i];
+      }
+    }
+    kernels->float_to_bfloat16(values.data(), half.data(), n);
+    for (int64_t i = 0; i < n; ++i) {
+      uint16_t expected = RefBFloat16(values[i]);
+      if (std::isnan(values[i])) {
+        ASSERT_EQ(half[i] & 0x7fc0, 0x7fc0) << values[i];
+      } else if (flush && std::fabs(values[i]) < FLT_MIN) {
+        ASSERT_EQ(half[i] & 0x7fff, 0) << values[i];
+      } else {
+        ASSERT_EQ(half[i], expected) << values[i];
+      }
+    }
+    // every 16-bit pattern widens exactly.
+    std::vector<uint16_t> all(65536);
+    for (int i = 0; i < 65536; ++i) all[i] = static_cast<uint16_t>(i);
+    std::vector<float> wide(65536);
+    kernels->float16_to_float(all.data(), wide.data(), 65536);
+    for (int i = 0; i < 65536; ++i) {
+      float expected = Float16Value(all[i]);
+      if (std::isnan(expected)) {
+        ASSERT_TRUE(std::isnan(wide[i])) << i;
+      } else {
+        ASSERT_EQ(Bits(wide[i]), Bits(expected)) << i;
+      }
+    }
+    kernels->bfloat16_to_float(all.data(), wide.data(), 65536);
+    for (int i = 0; i < 65536; ++i) ASSERT_EQ(Bits(wide[i]), static_cast<uint32_t>(i) << 16);
+  });
+}
+
+TEST(Half, CastAndElementwise) {
+  ThreadPool::Global()->Configure(3, {});
+  const std::vector<float> x = RandomValues(50001, 1);
+  const std::vector<float> y = RandomValues(7, 2);
+  const PackedFunc* cast = Registry::Get("kernel.cast");
+  ASSERT_TRUE(cast != nullptr);
+  ForEachSIMDLevel([&]() {
+    for (DLDataType dtype : {kFloat16, kBFloat16}) {
+      SCOPED_TRACE(dtype.code == kDLBfloat ? "bfloat16" : "float16");
+      std::vector<float> rx = Rounded(x, dtype), ry = Rounded(y, dtype);
+      NDArray hx = NDArray::Empty({50001}, dtype, cpu);
+      (*cast)(FloatArray(x, {50001}), hx);
+      // 16-bit to float32, int32 and back.
+      NDArray fx = NDArray::Empty({50001}, kFloat32, cpu);
+      NDArray ix = NDArray::Empty({50001}, DLDataType{kDLInt, 32, 1}, cpu);
+      Cast(hx, fx);
+      Cast(hx, ix);
+      for (int64_t i = 0; i < 50001; ++i) {
+        ASSERT_EQ(static_cast<float*>(fx->data)[i], rx[i]);
+        ASSERT_EQ(static_cast<int32_t*>(ix->data)[i], static_cast<int32_t>(rx[i]));
+      }
+      NDArray other = NDArray::Empty({50001}, dtype.code == kDLBfloat ? kFloat16 : kBFloat16, cpu);
+      Cast(hx, other);
+      Cast(other, fx);
+      std::vector<float> twice = Rounded(rx, other->dtype);
+      for (int64_t i = 0; i < 50001; ++i) ASSERT_EQ(static_cast<float*>(fx->data)[i], twice[i]);
+
+      // (7143, 7) * (7), in float32 on the widened values, rounded once.
+      NDArray a = HalfArray(x, {7143, 7}, dtype);
+      NDArray b = HalfArray(y, {7}, dtype);
+      NDArray out = NDArray::Empty({7143, 7}, dtype, cpu);
+      BinaryElementwise(kMul, a, b, out);
+      Cast(out, fx.CreateView({7143, 7}, kFloat32));
+      std::vector<float> product(50001);
+      for (int64_t i = 0; i < 50001; ++i) product[i] = rx[i] * ry[i % 7];
+      std::vector<float> expected = Rounded(product, dtype);
+      for (int64_t i = 0; i < 50001; ++i) ASSERT_EQ(static_cast<float*>(fx->data)[i], expected[i]);
+
+      UnaryElementwise(kTanh, a, out);
+      Cast(out, fx.CreateView({7143, 7}, kFloat32));
+      for (int64_t i = 0; i < 50001; ++i) {
+        // one rounding to 16 bits on top of the float32 kernel.
+        float tol = dtype.code == kDLBfloat ? 8e-3f : 1e-3f;
+        ASSERT_NEAR(static_cast<float*>(fx->data)[i], std::tanh(rx[i]), tol);
+      }
+    }
+  });
+  NDArray h = NDArray::Empty({4}, kFloat16, cpu);
+  NDArray i8 = NDArray::Empty({4}, DLDataType{kDLInt, 8, 1}, cpu);
+  EXPECT_THROW(BinaryElementwise(kAdd, h, i8, h), Error);
+}
+
+TEST(Half, Matmul) {
+  const std::vector<std::vector<int64_t>> shapes = {{1, 300, 200}, {5, 33, 70}, {64, 96, 130},
+                                                    {200, 150, 600}};
+  ForEachSIMDLevel([&]() {
+    for (DLDataType dtype : {kFloat16, kBFloat16}) {
+      for (const auto& shape : shapes) {
+        const int64_t m = shape[0], n = shape[1], k = shape[2];
+        for (int trans = 0; trans < 4; ++trans) {
+          const bool trans_a = trans & 1, trans_b = trans & 2;
+          SCOPED_TRACE(::testing::Message() << (dtype.code == kDLBfloat ? "bfloat16" : "float16")
+                                            << " m " << m << " n " << n << " k " << k
+                                            << " trans_a " << trans_a << " trans_b " << trans_b);
+          std::vector<float> va = RandomValues(m * k, 3), vb = RandomValues(k * n, 4);
+          std::vector<int64_t> sa = {m, k}, sb = {k, n};
+          if (trans_a) std::swap(sa[0], sa[1]);
+          if (trans_b) std::swap(sb[0], sb[1]);
+          NDArray a = HalfArray(va, sa, dtype), b = HalfArray(vb, sb, dtype);
+          std::vector<float> ra = Rounded(va, dtype), rb = Rounded(vb, dtype);
+          NDArray out = NDArray::Empty({m, n}, kFloat32, cpu);
+          NDArray narrow = NDArray::Empty({m, n}, dtype, cpu);
+          NDArray widened = NDArray::Empty({m, n}, kFloat32, cpu);
+          Matmul(a, b, out, trans_a, trans_b);
+          Matmul(a, b, narrow, trans_a, trans_b);
+          Cast(narrow, widened);
+          const float* po = static_cast<const float*>(out->data);
+          const float* pw = static_cast<const float*>(widened->data);
+          for (int64_t i = 0; i < m; ++i) {
+            for (int64_t j = 0; j < n; ++j) {
+              double sum = 0.0;
+              for (int64_t p = 0; p < k; ++p) {
+                double x = trans_a ? ra[p * m + i] : ra[i * k + p];
+                double y = trans_b ? rb[j * k + p] : rb[p * n + j];
+                sum += x * y;
+              }
+              ASSERT_NEAR(po[i * n + j], sum, 1e-5 * k);
+              ASSERT_NEAR(pw[i * n + j], sum, (dtype.code == kDLBfloat ? 8e-3 : 1e-3) *
+                                                  std::fabs(sum) + 1e-5 * k);
+            }
+          }
+        }
+      }
+    }
+  });
+  NDArray a = NDArray::Empty({2, 3}, kFloat16, cpu);
+  NDArray b = NDArray::Empty({3, 2}, kBFloat16, cpu);
+  NDArray out = NDArray::Empty({2, 2}, kFloat32, cpu);
+  EXPECT_THROW(Matmul(a, b, out), Error);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
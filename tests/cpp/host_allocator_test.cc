@@ -0,0 +1,67 @@
+//
+// Created by WangJingYu on 2021/7/15.
+//
+
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "../../src/runtime/host_allocator.h"
+
+using namespace cvm::runtime;
+
+TEST(HostAllocator, HugePageMode) {
+  HugePageConfig config;
+  config.enabled = true;
+  config.threshold = 8UL << 20;
+  SetHugePageConfig(1, config);
+  Device dev{kDLCPU, 1};
+
+  HugePageStats before = GetHugePageStats();
+  // below the threshold: a normal heap allocation.
+  void* small = HostAllocDataSpace(dev, 1UL << 20, kAllocAlignment);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(small) % kAllocAlignment, 0U);
+  EXPECT_EQ(HugePageBackedBytes(small), 0U);
+  EXPECT_EQ(GetHugePageStats().num_huge_allocs, before.num_huge_allocs);
+  HostFreeDataSpace(small);
+
+  size_t nbytes = (16UL << 20) + 100;
+  void* large = HostAllocDataSpace(dev, nbytes, kAllocAlignment);
+  memset(large, 1, nbytes);
+  HugePageStats after = GetHugePageStats();
+  EXPECT_EQ(after.num_huge_allocs, before.num_huge_allocs + 1);
+  EXPECT_EQ(after.bytes_requested, before.bytes_requested + nbytes);
+  if (after.num_fallbacks == before.num_fallbacks) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % kHugePageSize, 0U);
+    EXPECT_LE(HugePageBackedBytes(large), 18UL << 20);
+  }
+  HostFreeDataSpace(large);
+  EXPECT_EQ(HugePageBackedBytes(large), 0U);
+}
+
+TEST(HostAllocator, NDArray) {
+  const PackedFunc* set_huge_page = Registry::Get("runtime.SetHugePage");
+  const PackedFunc* stats = Registry::Get("runtime.HugePageStats");
+  ASSERT_TRUE(set_huge_page != nullptr && stats != nullptr);
+  (*set_huge_page)(2, true, 0);
+  int64_t num_allocs = (*stats)("num_huge_allocs");
+  {
+    NDArray arr = NDArray::Empty({1024, 1024, 4}, DataType::Float(32), {kDLCPU, 2});
+    memset(arr->data, 0, 16UL << 20);
+    EXPECT_EQ((*stats)("num_huge_allocs").operator int64_t(), num_allocs + 1);
+    // views share the region and do not release it.
+    NDArray view = arr.CreateView({16}, DataType::Float(32));
+    arr.reset();
+    static_cast<float*>(view->data)[0] = 1.0f;
+  }
+  // the default device is untouched.
+  NDArray arr = NDArray::Empty({1024, 1024, 4}, DataType::Float(32), {kDLCPU, 0});
+  EXPECT_EQ((*stats)("num_huge_allocs").operator int64_t(), num_allocs + 1);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,156 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../../src/runtime/alloc_counter.h"
+#include "../../src/runtime/inference_session.h"
+
+using namespace cvm::runtime;
+
+namespace {
+
+/*! \brief The operator new calls of every thread while counting. */
+std::atomic<int64_t> num_allocs{0};
+std::atomic<bool> counting{false};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  if (counting.load(std::memory_order_relaxed)) num_allocs.fetch_add(1);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+const DLDataType kFloat32{kDLFloat, 32, 1};
+
+/*! \brief out = x + 1. */
+CVM_REGISTER_GLOBAL("test.session.add_one").set_body_typed([](NDArray x, NDArray out) {
+  const float* px = static_cast<const float*>(x->data);
+  float* po = static_cast<float*>(out->data);
+  int64_t n = GetDataSize(*x.operator->()) / sizeof(float);
+  for (int64_t i = 0; i < n; ++i) po[i] = px[i] + 1.0f;
+});
+
+/*! \brief out = x, through a temporary buffer allocated on every call. */
+CVM_REGISTER_GLOBAL("test.session.allocating").set_body_typed([](NDArray x, NDArray out) {
+  int64_t n = GetDataSize(*x.operator->()) / sizeof(float);
+  std::vector<float> tmp(static_cast<const float*>(x->data),
+                         static_cast<const float*>(x->data) + n);
+  std::copy(tmp.begin(), tmp.end(), static_cast<float*>(out->data));
+});
+
+/*! \brief x -> op -> ... -> op, num_ops nodes of [len] with the last one as the output. */
+Module ChainExecutor(int num_ops, int64_t len, const std::string& op = "test.session.add_one") {
+  std::string shape = "[" + std::to_string(len) + "]";
+  std::string json = "{\"nodes\": [{\"op\": \"null\", \"name\": \"x\", \"shape\": " + shape + "}";
+  for (int i = 0; i < num_ops; ++i) {
+    json += ", {\"op\": \"" + op + "\", \"inputs\": [" + std::to_string(i) +
+            "], \"shape\": " + shape + "}";
+  }
+  json += "], \"heads\": [" + std::to_string(num_ops) + "]}";
+  return Module(make_object<GraphExecutor>(json, cpu));
+}
+
+}  // namespace
+
+TEST(InferenceSession, BoundBuffers) {
+  const int64_t len = 64;
+  std::vector<float> input(len), output(len, 0.0f);
+  InferenceSession session(ChainExecutor(10, len));
+  session.BindInput(0, input.data());
+  session.BindOutput(0, output.data());
+  for (int r = 0; r < 3; ++r) {
+    for (int64_t i = 0; i < len; ++i) input[i] = r * 100.0f + i;
+    session.Run();
+    for (int64_t i = 0; i < len; ++i) ASSERT_EQ(output[i], r * 100.0f + i + 10);
+  }
+  EXPECT_EQ(session.executor()->GetOutput(0)->data, output.data());
+  EXPECT_EQ(session.num_runs(), 3);
+
+  // the tensors of the caller work as well, SetInput writes the bound input.
+  NDArray x = NDArray::Empty({len}, kFloat32, cpu);
+  NDArray y = NDArray::Empty({len}, kFloat32, cpu);
+  session.BindInput("x", x);
+  session.BindOutput(0, y);
+  std::vector<float> ones(len, 1.0f);
+  NDArray src = NDArray::Empty({len}, kFloat32, cpu);
+  src.CopyFromBytes(ones.data(), len * sizeof(float));
+  session.executor()->SetInput(0, src);
+  session.Run();
+  EXPECT_EQ(static_cast<const float*>(x->data)[len - 1], 1.0f);
+  EXPECT_EQ(static_cast<const float*>(y->data)[len - 1], 11.0f);
+}
+
+TEST(InferenceSession, RunWithoutAllocations) {
+  const int64_t len = 256;
+  std::vector<float> input(len, 0.0f), output(len);
+  InferenceSession session(ChainExecutor(50, len));
+  session.BindInput(0, input.data());
+  session.BindOutput(0, output.data());
+  session.Run();
+  num_allocs = 0;
+  AllocationCounter counter;
+  counting = true;
+  for (int i = 0; i < 100; ++i) session.Run();
+  counting = false;
+  EXPECT_EQ(num_allocs.load(), 0);
+  EXPECT_EQ(counter.count(), 0);
+  EXPECT_EQ(output[0], 50.0f);
+}
+
+TEST(InferenceSession, AllocatingOp) {
+  if (!AllocationHookEnabled()) GTEST_SKIP() << "allocations are counted with USE_ALLOC_HOOK";
+  const int64_t len = 16;
+  std::vector<float> input(len, 1.0f), output(len);
+  InferenceSession session(ChainExecutor(2, len, "test.session.allocating"));
+  session.BindInput(0, input.data());
+  session.BindOutput(0, output.data());
+  EXPECT_NO_THROW(session.Run());
+  EXPECT_THROW(session.Run(), Error);
+}
+
+TEST(InferenceSession, Errors) {
+  EXPECT_THROW(InferenceSession{Module()}, Error);
+  const int64_t len = 8;
+  InferenceSession session(ChainExecutor(2, len));
+  EXPECT_THROW(session.BindInput(0, NDArray::Empty({len + 1}, kFloat32, cpu)), Error);
+  EXPECT_THROW(session.BindInput(0, NDArray::Empty({len}, DLDataType{kDLInt, 32, 1}, cpu)),
+               Error);
+  EXPECT_THROW(session.BindInput(0, NDArray::Empty({2 * len}, kFloat32, cpu).CreateView(
+                                        {len}, kFloat32, len * sizeof(float))),
+               Error);
+  EXPECT_THROW(session.BindInput("y", NDArray::Empty({len}, kFloat32, cpu)), Error);
+  EXPECT_THROW(session.BindInput(1, NDArray::Empty({len}, kFloat32, cpu)), Error);
+  EXPECT_THROW(session.BindOutput(0, static_cast<void*>(nullptr)), Error);
+
+  // an output that is the input of the graph.
+  std::string json =
+      "{\"nodes\": [{\"op\": \"null\", \"name\": \"x\", \"shape\": [4]}], \"heads\": [0]}";
+  InferenceSession identity(Module(make_object<GraphExecutor>(json, cpu)));
+  EXPECT_THROW(identity.BindOutput(0, NDArray::Empty({4}, kFloat32, cpu)), Error);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,221 @@
+//
+// Created by WangJingYu on 2021/7/25.
+//
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "../../src/runtime/kernels/layout.h"
+#include "../../src/runtime/layout_pass.h"
+#include "../../src/runtime/thread_pool.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+
+NDArray RandomArray(std::vector<int64_t> shape, DLDataType dtype, int seed) {
+  NDArray arr = NDArray::Empty(shape, dtype, cpu);
+  std::mt19937 gen(seed);
+  uint8_t* data = static_cast<uint8_t*>(arr->data);
+  size_t n = GetDataSize(*arr.operator->());
+  for (size_t i = 0; i < n; ++i) data[i] = static_cast<uint8_t>(gen());
+  return arr;
+}
+
+template <typename F>
+void ForEachSIMDLevel(F f) {
+  SIMDLevel saved = GetSIMDLevel();
+  for (int level = 0; level <= static_cast<int>(DetectSIMDLevel()); ++level) {
+    SetSIMDLevel(static_cast<SIMDLevel>(level));
+    SCOPED_TRACE(SIMDLevelName(GetSIMDLevel()));
+    f();
+  }
+  SetSIMDLevel(saved);
+}
+
+/*! \brief The primal coordinates of an index of a tensor of some layout and shape. */
+std::vector<int64_t> PrimalCoords(const Layout& layout, const std::vector<int64_t>& shape,
+                                  int64_t flat) {
+  std::vector<int64_t> coords(26, 0);
+  for (size_t i = shape.size(); i-- > 0;) {
+    int64_t index = flat % shape[i];
+    flat /= shape[i];
+    char axis = layout[i];
+    if (Layout::IsPrimal(axis)) {
+      coords[axis - 'A'] += index * std::max<int64_t>(1, layout.FactorOf(axis));
+    } else {
+      coords[axis - 'a'] += index;
+    }
+  }
+  return coords;
+}
+
+/*! \brief Compare out with x element by element through the primal coordinates. */
+void CheckTransform(const NDArray& x, const std::string& src, const NDArray& out,
+                    const std::string& dst) {
+  Layout ls(src), ld(dst);
+  std::vector<int64_t> xs = x.Shape(), os = out.Shape();
+  size_t elem = x->dtype.bits / 8;
+  int64_t nx = GetDataSize(*x.operator->()) / elem, no = GetDataSize(*out.operator->()) / elem;
+  // the position of every primal coordinate tuple in x.
+  std::map<std::vector<int64_t>, int64_t> position;
+  for (int64_t i = 0; i < nx; ++i) position[PrimalCoords(ls, xs, i)] = i;
+  for (int64_t i = 0; i < no; ++i) {
+    std::vector<int64_t> coords = PrimalCoords(ld, os, i);
+    auto it = position.find(coords);
+    const uint8_t* po = static_cast<const uint8_t*>(out->data) + i * elem;
+    std::vector<uint8_t> expected(elem, 0);
+    if (it != position.end()) {
+      std::memcpy(expected.data(), static_cast<const uint8_t*>(x->data) + it->second * elem, elem);
+    }
+    ASSERT_EQ(std::memcmp(po, expected.data(), elem), 0) << src << " to " << dst << " at " << i;
+  }
+}
+
+void RunTransform(const std::vector<int64_t>& shape, const std::string& src,
+                  const std::string& dst, DLDataType dtype) {
+  SCOPED_TRACE(src + " to " + dst);
+  NDArray x = RandomArray(shape, dtype, 1);
+  NDArray out = NDArray::Empty(LayoutTransformShape(shape, Layout(src), Layout(dst)), dtype, cpu);
+  LayoutTransform(x, Layout(src), Layout(dst), out);
+  CheckTransform(x, src, out, dst);
+}
+
+}  // namespace
+
+TEST(Layout, Parse) {
+  Layout layout("NCHW16c");
+  EXPECT_EQ(layout.ndim(), 5U);
+  EXPECT_EQ(layout[4], 'c');
+  EXPECT_EQ(layout.factor(4), 16);
+  EXPECT_EQ(layout.factor(1), 0);
+  EXPECT_EQ(layout.FactorOf('C'), 16);
+  EXPECT_EQ(layout.FactorOf('H'), 0);
+  EXPECT_EQ(layout.IndexOf('W'), 3);
+  EXPECT_EQ(layout.IndexOf('D'), -1);
+  EXPECT_EQ(layout.PrimalAxes(), "NCHW");
+  EXPECT_EQ(Layout("OIHW8i4o").factor(5), 4);
+  EXPECT_FALSE(Layout().defined());
+  EXPECT_TRUE(LayoutConvertible(Layout("NCHW"), Layout("NHWC4c")));
+  EXPECT_FALSE(LayoutConvertible(Layout("NCHW"), Layout("NCW")));
+  for (const char* bad : {"NCHW16", "NCHWc", "NCHW0c", "NC16HW", "NCHWN", "NCHW4c8c", "NCHW4d",
+                          "NC-HW"}) {
+    EXPECT_THROW(Layout{bad}, Error) << bad;
+  }
+}
+
+TEST(Layout, TransformShape) {
+  EXPECT_EQ(LayoutTransformShape({2, 64, 7, 9}, Layout("NCHW"), Layout("NHWC")),
+            (std::vector<int64_t>{2, 7, 9, 64}));
+  EXPECT_EQ(LayoutTransformShape({2, 3, 7, 9}, Layout("NCHW"), Layout("NCHW16c")),
+            (std::vector<int64_t>{2, 1, 7, 9, 16}));
+  EXPECT_EQ(LayoutTransformShape({2, 4, 7, 9, 8}, Layout("NCHW8c"), Layout("NHWC")),
+            (std::vector<int64_t>{2, 7, 9, 32}));
+  EXPECT_THROW(LayoutTransformShape({2, 4, 7, 9, 4}, Layout("NCHW8c"), Layout("NHWC")), Error);
+  EXPECT_THROW(LayoutTransformShape({2, 4, 7}, Layout("NCHW"), Layout("NHWC")), Error);
+  EXPECT_THROW(LayoutTransformShape({2, 4, 7}, Layout("NCW"), Layout("NHWC")), Error);
+}
+
+TEST(Layout, Transform) {
+  const DLDataType f32{kDLFloat, 32, 1};
+  ForEachSIMDLevel([&]() {
+    RunTransform({2, 37, 5, 11}, "NCHW", "NHWC", f32);
+    RunTransform({2, 5, 11, 37}, "NHWC", "NCHW", f32);
+    RunTransform({2, 32, 9, 13}, "NCHW", "NCHW16c", f32);
+    RunTransform({2, 2, 9, 13, 16}, "NCHW16c", "NCHW", f32);
+    RunTransform({2, 9, 13, 48}, "NHWC", "NCHW16c", f32);
+    RunTransform({2, 3, 9, 13, 16}, "NCHW16c", "NHWC", f32);
+    RunTransform({2, 4, 9, 13, 8}, "NCHW8c", "NCHW16c", f32);
+    RunTransform({2, 2, 9, 13, 16}, "NCHW16c", "NCHW4c", f32);
+    RunTransform({64, 32, 3, 3}, "OIHW", "OIHW8i16o", f32);
+    // padded
+    RunTransform({2, 3, 9, 13}, "NCHW", "NCHW16c", f32);
+    RunTransform({2, 20, 5, 6}, "NCHW", "NCHW8c", f32);
+    RunTransform({2, 3, 5, 6, 4}, "NCHW4c", "NCHW8c", f32);
+    RunTransform({1, 6, 5, 6}, "NCHW", "NCHW4c", f32);
+  });
+  RunTransform({3, 17, 4, 5}, "NCHW", "NHWC", DLDataType{kDLInt, 8, 1});
+  RunTransform({3, 17, 4, 5}, "NCHW", "NCHW8c", DLDataType{kDLBfloat, 16, 1});
+  RunTransform({3, 16, 4, 5}, "NCHW", "NHWC", DLDataType{kDLFloat, 64, 1});
+  RunTransform({3, 4, 5}, "CHW", "CHW", DLDataType{kDLFloat, 32, 1});
+
+  // the padding is dropped on the way back.
+  const Layout nchw("NCHW"), blocked("NCHW16c");
+  NDArray x = RandomArray({2, 3, 9, 13}, f32, 2);
+  NDArray padded = NDArray::Empty({2, 1, 9, 13, 16}, f32, cpu);
+  NDArray back = NDArray::Empty({2, 3, 9, 13}, f32, cpu);
+  LayoutTransform(x, nchw, blocked, padded);
+  LayoutTransform(padded, blocked, nchw, back);
+  EXPECT_EQ(std::memcmp(x->data, back->data, GetDataSize(*x.operator->())), 0);
+  NDArray wrong = NDArray::Empty({2, 17, 9, 13}, f32, cpu);
+  EXPECT_THROW(LayoutTransform(padded, blocked, nchw, wrong), Error);
+  NDArray ints = NDArray::Empty({2, 3, 9, 13}, DLDataType{kDLInt, 32, 1}, cpu);
+  EXPECT_THROW(LayoutTransform(ints, nchw, nchw, back), Error);
+}
+
+TEST(Layout, ParallelAndRegistry) {
+  ThreadPool::Global()->Configure(3, {});
+  const DLDataType f32{kDLFloat, 32, 1};
+  RunTransform({4, 64, 28, 28}, "NCHW", "NHWC", f32);
+  RunTransform({4, 28, 28, 64}, "NHWC", "NCHW16c", f32);
+  RunTransform({4, 4, 28, 28, 16}, "NCHW16c", "NCHW", f32);
+  RunTransform({4, 3, 28, 28}, "NCHW", "NCHW16c", f32);
+
+  const PackedFunc* f = Registry::Get("kernel.layout_transform");
+  ASSERT_TRUE(f != nullptr);
+  NDArray x = RandomArray({1, 32, 4, 4}, f32, 3);
+  NDArray out = NDArray::Empty({1, 4, 4, 4, 8}, f32, cpu);
+  (*f)(x, out, String("NCHW"), String("NCHW8c"));
+  CheckTransform(x, "NCHW", out, "NCHW8c");
+  EXPECT_THROW((*f)(x, out, String("NCHW"), String("NHWC")), Error);
+}
+
+TEST(Layout, InsertTransforms) {
+  // input (NCHW) -> conv (NCHW16c) -> relu -> add(relu, input) -> pool (NHWC), conv2 (NCHW16c)
+  std::vector<LayoutNode> nodes = {
+      {"", {}, {}, "NCHW"},
+      {"kernel.conv2d_nchwc", {0}, {"NCHW16c"}, "NCHW16c"},
+      {"kernel.relu", {1}, {}, ""},
+      {"kernel.add", {2, 0}, {"NCHW", "NCHW"}, ""},
+      {"kernel.pool", {3}, {"NHWC"}, "NHWC"},
+      {"kernel.conv2d_nchwc", {0}, {"NCHW16c"}, "NCHW16c"},
+  };
+  std::vector<int> node_map;
+  std::vector<LayoutNode> result = InsertLayoutTransforms(nodes, &node_map);
+  ASSERT_EQ(result.size(), 9U);
+  EXPECT_EQ(node_map, (std::vector<int>{0, 2, 3, 5, 7, 8}));
+  // the transform of the input into NCHW16c is shared by both convolutions.
+  EXPECT_EQ(result[1].op, kLayoutTransformOp);
+  EXPECT_EQ(result[1].inputs, (std::vector<int>{0}));
+  EXPECT_EQ(result[1].input_layouts, (std::vector<std::string>{"NCHW"}));
+  EXPECT_EQ(result[1].layout, "NCHW16c");
+  EXPECT_EQ(result[2].inputs, (std::vector<int>{1}));
+  EXPECT_EQ(result[8].inputs, (std::vector<int>{1}));
+  // relu takes the layout of its input.
+  EXPECT_EQ(result[3].layout, "NCHW16c");
+  EXPECT_EQ(result[4].op, kLayoutTransformOp);
+  EXPECT_EQ(result[4].layout, "NCHW");
+  EXPECT_EQ(result[5].inputs, (std::vector<int>{4, 0}));
+  EXPECT_EQ(result[5].layout, "NCHW");
+  EXPECT_EQ(result[6].layout, "NHWC");
+  EXPECT_EQ(result[7].inputs, (std::vector<int>{6}));
+
+  nodes.push_back({"kernel.dense", {0}, {"NC"}, "NC"});
+  EXPECT_THROW(InsertLayoutTransforms(nodes, &node_map), Error);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
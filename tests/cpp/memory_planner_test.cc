@@ -0,0 +1,160 @@
+//
+// Created by WangJingYu on 2021/7/17.
+//
+
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "../../src/runtime/memory_planner.h"
+
+using namespace cvm::runtime;
+
+namespace {
+
+/*! \brief Stem plus residual blocks: conv-relu-conv-add-relu, downsampling every few blocks. */
+std::vector<PlannerNode> ResNetLikeChain(int num_stages, int blocks_per_stage) {
+  std::vector<PlannerNode> nodes;
+  DLDataType f32 = DataType::Float(32);
+  nodes.push_back({{1, 64, 56, 56}, f32, {}});
+  int64_t channels = 64, size = 56;
+  for (int stage = 0; stage < num_stages; ++stage) {
+    for (int block = 0; block < blocks_per_stage; ++block) {
+      int identity = static_cast<int>(nodes.size()) - 1;
+      if (stage > 0 && block == 0) {
+        channels *= 2;
+        size /= 2;
+        nodes.push_back({{1, channels, size, size}, f32, {identity}});  // projection
+        identity = static_cast<int>(nodes.size()) - 1;
+      }
+      std::vector<int64_t> shape = {1, channels, size, size};
+      nodes.push_back({shape, f32, {identity}});
+      nodes.push_back({shape, f32, {static_cast<int>(nodes.size()) - 1}});
+      nodes.push_back({shape, f32, {static_cast<int>(nodes.size()) - 1}});
+      nodes.push_back({shape, f32, {static_cast<int>(nodes.size()) - 1, identity}});
+      nodes.push_back({shape, f32, {static_cast<int>(nodes.size()) - 1}});
+    }
+  }
+  return nodes;
+}
+
+void CheckNoLiveOverlap(const std::vector<TensorLifetime>& tensors, const MemoryPlan& plan) {
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    EXPECT_LE(plan.offsets[i] + tensors[i].nbytes, plan.arena_bytes);
+    for (size_t j = i + 1; j < tensors.size(); ++j) {
+      bool live_together = tensors[i].first_use <= tensors[j].last_use &&
+                           tensors[j].first_use <= tensors[i].last_use;
+      bool disjoint = plan.offsets[i] + tensors[i].nbytes <= plan.offsets[j] ||
+                      plan.offsets[j] + tensors[j].nbytes <= plan.offsets[i];
+      ASSERT_TRUE(!live_together || disjoint) << "tensors " << i << " and " << j << " overlap";
+    }
+  }
+}
+
+}  // namespace
+
+TEST(MemoryPlanner, ResNetLikeChain) {
+  std::vector<PlannerNode> nodes = ResNetLikeChain(4, 3);
+  int output = static_cast<int>(nodes.size()) - 1;
+  std::vector<TensorLifetime> tensors = ComputeLifetimes(nodes, {output});
+  MemoryPlan plan = PlanMemory(tensors);
+  CheckNoLiveOverlap(tensors, plan);
+  EXPECT_EQ(plan.num_naive_allocs, nodes.size());
+  EXPECT_LE(plan.naive_peak_bytes, plan.arena_bytes * 2);
+  EXPECT_LE(plan.arena_bytes, plan.naive_peak_bytes);
+  EXPECT_LT(plan.arena_bytes * 5, plan.naive_bytes);
+
+  std::vector<NDArray> views = AllocatePlannedTensors(plan, nodes, {kDLCPU, 0});
+  ASSERT_EQ(views.size(), nodes.size());
+  for (size_t i = 0; i < views.size(); ++i) {
+    EXPECT_EQ(views[i].Shape(), nodes[i].shape);
+    EXPECT_EQ(views[i]->byte_offset, plan.offsets[i]);
+  }
+  // the views keep the arena alive.
+  NDArray last = views.back();
+  views.clear();
+  static_cast<float*>(last->data)[last->byte_offset / sizeof(float)] = 1.0f;
+}
+
+TEST(MemoryPlanner, FillsGaps) {
+  // a and c are alive at different times and reuse the same space, b sits next to both.
+  std::vector<TensorLifetime> tensors = {{1000, 0, 1}, {100, 0, 3}, {500, 2, 3}};
+  MemoryPlan plan = PlanMemory(tensors, 64);
+  CheckNoLiveOverlap(tensors, plan);
+  EXPECT_EQ(plan.arena_bytes, 1024U + 128U);
+  EXPECT_EQ(plan.offsets[0], plan.offsets[2]);
+  EXPECT_EQ(plan.naive_bytes, 1024U + 128U + 512U);
+}
+
+TEST(MemoryPlanner, Concurrent) {
+  // two branches of three nodes from x, joined by the last node.
+  DLDataType f32 = DataType::Float(32);
+  std::vector<int64_t> shape = {256};
+  std::vector<PlannerNode> nodes = {{shape, f32, {}},  {shape, f32, {0}}, {shape, f32, {1}},
+                                    {shape, f32, {2}}, {shape, f32, {0}}, {shape, f32, {4}},
+                                    {shape, f32, {5}}, {shape, f32, {3, 6}}};
+  std::vector<PlannerNode> resnet = ResNetLikeChain(2, 2);
+  for (const std::vector<PlannerNode>* graph : {&nodes, &resnet}) {
+    const size_t n = graph->size();
+    std::vector<int> outputs = {static_cast<int>(n) - 1};
+    MemoryPlan plan = PlanConcurrentMemory(*graph, outputs);
+    std::vector<TensorLifetime> tensors = ComputeLifetimes(*graph, outputs);
+    // after[i][j]: node j runs after node i in every order.
+    std::vector<std::vector<bool>> after(n, std::vector<bool>(n, false));
+    for (size_t j = 0; j < n; ++j) {
+      for (int i : (*graph)[j].inputs) {
+        after[i][j] = true;
+        for (size_t k = 0; k < n; ++k) {
+          if (after[k][i]) after[k][j] = true;
+        }
+      }
+    }
+    // tensors sharing memory: the later producer runs after every reader of the other, which
+    // is no output.
+    for (size_t a = 0; a < n; ++a) {
+      for (size_t b = a + 1; b < n; ++b) {
+        bool disjoint = plan.offsets[a] + tensors[a].nbytes <= plan.offsets[b] ||
+                        plan.offsets[b] + tensors[b].nbytes <= plan.offsets[a];
+        if (disjoint) continue;
+        ASSERT_NE(static_cast<int>(a), outputs[0]);
+        for (size_t r = a + 1; r < n; ++r) {
+          const std::vector<int>& inputs = (*graph)[r].inputs;
+          if (std::find(inputs.begin(), inputs.end(), static_cast<int>(a)) == inputs.end()) {
+            continue;
+          }
+          ASSERT_TRUE(after[r][b]) << "tensors " << a << " and " << b << " overlap";
+        }
+      }
+    }
+    EXPECT_GE(plan.arena_bytes, PlanMemory(tensors).arena_bytes);
+    EXPECT_LT(plan.arena_bytes, plan.naive_bytes);
+  }
+  // the sequential plan reuses the first branch for the second one, this plan cannot.
+  MemoryPlan plan = PlanConcurrentMemory(nodes, {7});
+  EXPECT_GT(plan.arena_bytes, PlanMemory(ComputeLifetimes(nodes, {7})).arena_bytes);
+}
+
+TEST(MemoryPlanner, PackedFunc) {
+  const PackedFunc* plan_memory = Registry::Get("runtime.PlanMemory");
+  ASSERT_TRUE(plan_memory != nullptr);
+  Array<ShapeTuple> shapes = {ShapeTuple({4, 4}), ShapeTuple({4, 4}), ShapeTuple({4, 4})};
+  Array<String> dtypes = {"float32", "float32", "float32"};
+  Array<ShapeTuple> inputs = {ShapeTuple(), ShapeTuple({0}), ShapeTuple({1})};
+  Array<ShapeTuple> ret = (*plan_memory)(shapes, dtypes, inputs, ShapeTuple({2}));
+  ASSERT_EQ(ret.size(), 2U);
+  ShapeTuple offsets = ret[0];
+  ShapeTuple stats = ret[1];
+  ASSERT_EQ(offsets.size(), 3U);
+  // node 0 is dead once node 1 has run, so node 2 can take its place.
+  EXPECT_EQ(offsets[0], offsets[2]);
+  EXPECT_EQ(stats[0], 128);
+  EXPECT_EQ(stats[1], 192);
+  EXPECT_EQ(stats[3], 3);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
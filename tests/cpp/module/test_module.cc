@@ -0,0 +1,47 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+/*!
+ * \file test_module.cc
+ * \brief A shared library of CVMBackendPackedCFunc functions loaded by module_test.
+ */
+#include <cvm/runtime/c_backend_api.h>
+#include <cvm/runtime/c_runtime_api.h>
+
+extern "C" {
+
+CVM_DLL void* __cvm_module_ctx = nullptr;
+
+// add_one(x) = x + 1
+CVM_DLL int add_one(CVMValue* args, int* type_codes, int num_args, CVMValue* out_ret_value,
+                    int* out_ret_tcode, void* resource_handle) {
+  if (num_args != 1 || type_codes[0] != kDLInt) {
+    CVMAPISetLastError("add_one: expect one integer");
+    return -1;
+  }
+  out_ret_value->v_int64 = args[0].v_int64 + 1;
+  *out_ret_tcode = kDLInt;
+  return 0;
+}
+
+// call_env(name, x) = the function name of the environment of the module, called on x.
+CVM_DLL int call_env(CVMValue* args, int* type_codes, int num_args, CVMValue* out_ret_value,
+                     int* out_ret_tcode, void* resource_handle) {
+  if (num_args != 2 || type_codes[0] != kCVMStr) {
+    CVMAPISetLastError("call_env: expect a name and an argument");
+    return -1;
+  }
+  CVMFunctionHandle f;
+  if (CVMBackendGetFuncFromEnv(__cvm_module_ctx, args[0].v_str, &f) != 0) return -1;
+  return CVMFuncCall(f, args + 1, type_codes + 1, 1, out_ret_value, out_ret_tcode);
+}
+
+// fail() always fails.
+CVM_DLL int fail(CVMValue* args, int* type_codes, int num_args, CVMValue* out_ret_value,
+                 int* out_ret_tcode, void* resource_handle) {
+  CVMAPISetLastError("fail: failed on purpose");
+  return -1;
+}
+
+}  // extern "C"
@@ -0,0 +1,198 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/c_backend_api.h>
+#include <cvm/runtime/module.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace cvm::runtime;
+
+#ifndef CVM_TEST_MODULE_PATH
+#define CVM_TEST_MODULE_PATH "libcvm_test_module.so"
+#endif
+
+namespace {
+
+/*! \brief A module of one function returning its value, counting its lookups. */
+class ConstModule : public ModuleNode {
+ public:
+  ConstModule(std::string name, int value) : name_(std::move(name)), value_(value) {}
+
+  const char* type_key() const final { return "const"; }
+
+  PackedFunc GetFunction(const std::string& name, const ObjectPtr<Object>& /*sptr_to_self*/) final {
+    ++num_lookups;
+    if (name != name_) return PackedFunc();
+    int value = value_;
+    return PackedFunc([value](CVMArgs /*args*/, CVMRetValue* rv) { *rv = value; });
+  }
+
+  using ModuleNode::GetFunction;
+
+  int num_lookups{0};
+
+ private:
+  std::string name_;
+  int value_;
+};
+
+Module Const(const std::string& name, int value) {
+  return Module(make_object<ConstModule>(name, value));
+}
+
+int ConstLookups(const Module& mod) {
+  return static_cast<ConstModule*>(mod.operator->())->num_lookups;
+}
+
+int SysAddTwo(CVMValue* args, int* /*type_codes*/, int /*num_args*/, CVMValue* out_ret_value,
+              int* out_ret_tcode, void* /*resource_handle*/) {
+  out_ret_value->v_int64 = args[0].v_int64 + 2;
+  *out_ret_tcode = kDLInt;
+  return 0;
+}
+
+CVM_REGISTER_GLOBAL("test.module.square").set_body_typed([](int x) { return x * x; });
+
+/*! \brief A loader of the format "const", a module of the format it was given. */
+CVM_REGISTER_GLOBAL("runtime.module.loadfile_const")
+    .set_body_typed([](std::string /*file_name*/, std::string format) {
+      return Const(format, 1);
+    });
+
+}  // namespace
+
+TEST(Module, LoadFromFile) {
+  Module mod = Module::LoadFromFile(CVM_TEST_MODULE_PATH);
+  EXPECT_STREQ(mod->type_key(), "library");
+  PackedFunc add_one = mod.GetFunction("add_one");
+  ASSERT_NE(add_one, nullptr);
+  EXPECT_EQ(add_one(41).operator int(), 42);
+  EXPECT_EQ(mod.GetFunction("missing"), nullptr);
+  PackedFunc fail = mod.GetFunction("fail");
+  try {
+    fail();
+    FAIL() << "expect an Error";
+  } catch (const Error& e) {
+    EXPECT_NE(std::string(e.what()).find("failed on purpose"), std::string::npos);
+  }
+  EXPECT_THROW(Module::LoadFromFile("/nonexistent/lib.so"), Error);
+  EXPECT_THROW(Module::LoadFromFile("lib.unknown"), Error);
+  EXPECT_THROW(Module::LoadFromFile("noextension"), Error);
+  // the loader gets the format deduced from the extension.
+  EXPECT_NE(Module::LoadFromFile("weights.const").GetFunction("const"), nullptr);
+}
+
+TEST(Module, FunctionsKeepTheModuleAlive) {
+  PackedFunc add_one;
+  {
+    Module mod = Module::LoadFromFile(CVM_TEST_MODULE_PATH);
+    add_one = mod.GetFunction("add_one");
+  }
+  EXPECT_EQ(add_one(1).operator int(), 2);
+}
+
+TEST(Module, CachedLookups) {
+  Module mod = Const("answer", 42);
+  const PackedFunc* f = mod->GetFunctionCached("answer");
+  ASSERT_NE(f, nullptr);
+  EXPECT_EQ(mod->GetFunctionCached("answer"), f);
+  EXPECT_EQ(mod.GetFunction("answer")().operator int(), 42);
+  // misses are cached too.
+  EXPECT_EQ(mod->GetFunctionCached("missing"), nullptr);
+  EXPECT_EQ(mod.GetFunction("missing"), nullptr);
+  EXPECT_EQ(ConstLookups(mod), 2);
+}
+
+TEST(Module, Imports) {
+  Module lib = Module::LoadFromFile(CVM_TEST_MODULE_PATH);
+  Module answer = Const("answer", 42);
+  lib.Import(answer);
+  ASSERT_EQ(lib->imports().size(), 1U);
+  EXPECT_EQ(lib.GetFunction("answer"), nullptr);
+  EXPECT_EQ(lib.GetFunction("answer", true)().operator int(), 42);
+  EXPECT_EQ(lib.GetFunction("answer", true)().operator int(), 42);
+  EXPECT_EQ(ConstLookups(answer), 1);
+
+  // the code of the library finds the imports, then the registry.
+  PackedFunc call_env = lib.GetFunction("call_env");
+  EXPECT_EQ(call_env("answer", 0).operator int(), 42);
+  EXPECT_EQ(call_env("test.module.square", 7).operator int(), 49);
+  EXPECT_THROW(call_env("missing", 0), Error);
+
+  // a miss resolves once a module having the function is imported.
+  EXPECT_EQ(lib.GetFunction("late", true), nullptr);
+  EXPECT_THROW(call_env("late", 0), Error);
+  lib.Import(Const("late", 7));
+  EXPECT_EQ(lib.GetFunction("late", true)().operator int(), 7);
+  EXPECT_EQ(call_env("late", 0).operator int(), 7);
+}
+
+TEST(Module, ImportCycle) {
+  Module a = Const("a", 1), b = Const("b", 2), c = Const("c", 3);
+  a.Import(b);
+  b.Import(c);
+  EXPECT_THROW(c.Import(a), Error);
+  EXPECT_THROW(a.Import(a), Error);
+  EXPECT_THROW(a.Import(Module()), Error);
+  // a diamond is no cycle.
+  a.Import(c);
+  EXPECT_EQ(a.GetFunction("c", true)().operator int(), 3);
+}
+
+TEST(Module, SystemLib) {
+  CVMSystemLibEntry table[] = {{"sys_add_two", reinterpret_cast<void*>(SysAddTwo)}};
+  ASSERT_EQ(CVMBackendRegisterSystemLibTable(table, 1), 0);
+  // registering a symbol again with the same address is allowed.
+  ASSERT_EQ(CVMBackendRegisterSystemLibSymbol("sys_add_two", reinterpret_cast<void*>(SysAddTwo)),
+            0);
+  int dummy = 0;
+  EXPECT_NE(CVMBackendRegisterSystemLibSymbol("sys_add_two", &dummy), 0);
+
+  Module sys = Module::SystemLib();
+  EXPECT_EQ(sys.get(), Module::SystemLib().get());
+  EXPECT_EQ(sys.GetFunction("sys_add_two")(1).operator int(), 3);
+  Module from_registry = (*Registry::Get("runtime.SystemLib"))();
+  EXPECT_EQ(from_registry.get(), sys.get());
+}
+
+TEST(Module, CAPI) {
+  CVMModuleHandle mod;
+  ASSERT_EQ(CVMModLoadFromFile(CVM_TEST_MODULE_PATH, "", &mod), 0);
+  CVMFunctionHandle f;
+  ASSERT_EQ(CVMModGetFunction(mod, "add_one", 0, &f), 0);
+  ASSERT_NE(f, nullptr);
+  ASSERT_EQ(CVMModFree(mod), 0);
+
+  CVMValue arg, ret;
+  arg.v_int64 = 9;
+  int arg_code = kDLInt, ret_code;
+  ASSERT_EQ(CVMFuncCall(f, &arg, &arg_code, 1, &ret, &ret_code), 0);
+  EXPECT_EQ(ret_code, kDLInt);
+  EXPECT_EQ(ret.v_int64, 10);
+  ASSERT_EQ(CVMFuncFree(f), 0);
+
+  EXPECT_NE(CVMModLoadFromFile("/nonexistent/lib.so", "", &mod), 0);
+  EXPECT_NE(std::string(CVMGetLastError()).find("/nonexistent/lib.so"), std::string::npos);
+}
+
+TEST(Module, FFI) {
+  Module mod = (*Registry::Get("runtime.ModuleLoadFromFile"))(CVM_TEST_MODULE_PATH, "so");
+  Module answer = Const("answer", 42);
+  (*Registry::Get("runtime.ModuleImport"))(mod, answer);
+  EXPECT_EQ((*Registry::Get("runtime.ModuleGetTypeKey"))(mod).operator std::string(), "library");
+  EXPECT_EQ((*Registry::Get("runtime.ModuleNumImports"))(mod).operator int(), 1);
+  Module imported = (*Registry::Get("runtime.ModuleGetImport"))(mod, 0);
+  EXPECT_EQ(imported.get(), answer.get());
+  PackedFunc f = (*Registry::Get("runtime.ModuleGetFunction"))(mod, "answer", true);
+  EXPECT_EQ(f().operator int(), 42);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+//
+// Created by WangJingYu on 2021/7/14.
+//
+
+#include <cvm/runtime/c_runtime_api.h>
+#include <cvm/runtime/ndarray.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace cvm::runtime;
+
+namespace {
+
+NDArray MakeArange(std::vector<int64_t> shape, DLDataType dtype = DataType::Float(32)) {
+  NDArray arr = NDArray::Empty(shape, dtype, {kDLCPU, 0});
+  size_t elem_bytes = (dtype.bits * dtype.lanes + 7) / 8;
+  size_t n = GetDataSize(*arr.operator->()) / elem_bytes;
+  char* data = static_cast<char*>(arr->data);
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t v = i;
+    for (size_t b = 0; b < elem_bytes; b += sizeof(v)) {
+      memcpy(data + i * elem_bytes + b, &v, std::min(sizeof(v), elem_bytes - b));
+    }
+  }
+  return arr;
+}
+
+/*! \brief A DLTensor viewing arr with its axes permuted. */
+struct PermutedView {
+  PermutedView(const NDArray& arr, std::vector<int> axes) {
+    const DLTensor* t = arr.operator->();
+    std::vector<int64_t> compact(t->ndim, 1);
+    for (int i = t->ndim - 2; i >= 0; --i) compact[i] = compact[i + 1] * t->shape[i + 1];
+    for (int axis : axes) {
+      shape.push_back(t->shape[axis]);
+      strides.push_back(compact[axis]);
+    }
+    tensor = *t;
+    tensor.shape = shape.data();
+    tensor.strides = strides.data();
+  }
+  std::vector<int64_t> shape;
+  std::vector<int64_t> strides;
+  DLTensor tensor;
+};
+
+}  // namespace
+
+TEST(NDArray, CopyContiguous) {
+  // large enough to be split across threads and use streaming stores.
+  NDArray a = MakeArange({5, 1 << 20}, DataType::Int(32));
+  NDArray b = NDArray::Empty({5, 1 << 20}, DataType::Int(32), {kDLCPU, 0});
+  b.CopyFrom(a);
+  EXPECT_EQ(memcmp(a->data, b->data, GetDataSize(*a.operator->())), 0);
+
+  NDArray c = a.CopyTo(Device{kDLCPU, 0});
+  EXPECT_EQ(memcmp(a->data, c->data, GetDataSize(*a.operator->())), 0);
+
+  std::vector<int32_t> bytes(5 << 20);
+  a.CopyToBytes(bytes.data(), bytes.size() * sizeof(int32_t));
+  EXPECT_EQ(bytes[12345], 12345);
+}
+
+TEST(NDArray, CopyTranspose2D) {
+  for (DLDataType dtype : {DataType::Int(8), DataType::Float(16), DataType::Float(32),
+                           DataType::Float(64), DataType::Float(32, 4)}) {
+    NDArray a = MakeArange({67, 45}, dtype);
+    PermutedView view(a, {1, 0});
+    NDArray b = NDArray::Empty({45, 67}, dtype, {kDLCPU, 0});
+    b.CopyFrom(&view.tensor);
+    size_t elem_bytes = (dtype.bits * dtype.lanes + 7) / 8;
+    const char* pa = static_cast<const char*>(a->data);
+    const char* pb = static_cast<const char*>(b->data);
+    for (int i = 0; i < 67; ++i) {
+      for (int j = 0; j < 45; ++j) {
+        ASSERT_EQ(memcmp(pb + (j * 67 + i) * elem_bytes, pa + (i * 45 + j) * elem_bytes,
+                         elem_bytes),
+                  0);
+      }
+    }
+  }
+}
+
+TEST(NDArray, CopyTranspose4D) {
+  // NCHW -> NHWC
+  NDArray a = MakeArange({2, 35, 9, 11});
+  PermutedView view(a, {0, 2, 3, 1});
+  NDArray b = NDArray::Empty({2, 9, 11, 35}, DataType::Float(32), {kDLCPU, 0});
+  NDArray::CopyFromTo(&view.tensor, const_cast<DLTensor*>(b.operator->()));
+  const uint32_t* pa = static_cast<const uint32_t*>(a->data);
+  const uint32_t* pb = static_cast<const uint32_t*>(b->data);
+  for (int n = 0; n < 2; ++n)
+    for (int c = 0; c < 35; ++c)
+      for (int h = 0; h < 9; ++h)
+        for (int w = 0; w < 11; ++w)
+          ASSERT_EQ(pb[((n * 9 + h) * 11 + w) * 35 + c], pa[((n * 35 + c) * 9 + h) * 11 + w]);
+
+  // back again, now the destination is the strided side.
+  NDArray c = NDArray::Empty({2, 35, 9, 11}, DataType::Float(32), {kDLCPU, 0});
+  PermutedView out(c, {0, 2, 3, 1});
+  b.CopyTo(&out.tensor);
+  EXPECT_EQ(memcmp(a->data, c->data, GetDataSize(*a.operator->())), 0);
+}
+
+TEST(NDArray, CopySlice) {
+  NDArray a = MakeArange({8, 10, 12});
+  // a[2:6, :, 3:9]
+  std::vector<int64_t> shape = {4, 10, 6};
+  std::vector<int64_t> strides = {120, 12, 1};
+  DLTensor slice = *a.operator->();
+  slice.shape = shape.data();
+  slice.strides = strides.data();
+  slice.byte_offset = (2 * 120 + 3) * sizeof(float);
+  NDArray b = NDArray::Empty(shape, DataType::Float(32), {kDLCPU, 0});
+  ASSERT_EQ(CVMArrayCopyFromTo(&slice, const_cast<DLTensor*>(b.operator->()), nullptr), 0);
+  const uint32_t* pa = static_cast<const uint32_t*>(a->data);
+  const uint32_t* pb = static_cast<const uint32_t*>(b->data);
+  for (int i = 0; i < 4; ++i)
+    for (int j = 0; j < 10; ++j)
+      for (int k = 0; k < 6; ++k)
+        ASSERT_EQ(pb[(i * 10 + j) * 6 + k], pa[((i + 2) * 10 + j) * 12 + k + 3]);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
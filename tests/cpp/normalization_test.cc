@@ -0,0 +1,233 @@
+//
+// Created by WangJingYu on 2021/7/26.
+//
+
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../../src/runtime/kernels/elementwise.h"
+#include "../../src/runtime/kernels/normalization.h"
+#include "../../src/runtime/thread_pool.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+const DLDataType kFloat32{kDLFloat, 32, 1};
+const DLDataType kBFloat16{kDLBfloat, 16, 1};
+
+NDArray RandomArray(std::vector<int64_t> shape, float mean, float stddev, int seed) {
+  NDArray arr = NDArray::Empty(shape, kFloat32, cpu);
+  std::mt19937 gen(seed);
+  std::normal_distribution<float> dist(mean, stddev);
+  float* data = static_cast<float*>(arr->data);
+  size_t n = GetDataSize(*arr.operator->()) / sizeof(float);
+  for (size_t i = 0; i < n; ++i) data[i] = dist(gen);
+  return arr;
+}
+
+template <typename F>
+void ForEachSIMDLevel(F f) {
+  SIMDLevel saved = GetSIMDLevel();
+  for (int level = 0; level <= static_cast<int>(DetectSIMDLevel()); ++level) {
+    SetSIMDLevel(static_cast<SIMDLevel>(level));
+    SCOPED_TRACE(SIMDLevelName(GetSIMDLevel()));
+    f();
+  }
+  SetSIMDLevel(saved);
+}
+
+/*! \brief Softmax of the rows of n elements, in double. */
+std::vector<double> RefSoftmax(const float* x, int64_t num_elems, int64_t n) {
+  std::vector<double> out(num_elems);
+  for (int64_t r = 0; r < num_elems; r += n) {
+    double max = x[r];
+    for (int64_t i = 1; i < n; ++i) max = std::max(max, static_cast<double>(x[r + i]));
+    double sum = 0.0;
+    for (int64_t i = 0; i < n; ++i) sum += out[r + i] = std::exp(x[r + i] - max);
+    for (int64_t i = 0; i < n; ++i) out[r + i] /= sum;
+  }
+  return out;
+}
+
+/*! \brief Layer normalization of the rows of n elements, in double. */
+std::vector<double> RefLayerNorm(const float* x, const float* gamma, const float* beta,
+                                 double eps, int64_t num_elems, int64_t n) {
+  std::vector<double> out(num_elems);
+  for (int64_t r = 0; r < num_elems; r += n) {
+    double mean = 0.0, var = 0.0;
+    for (int64_t i = 0; i < n; ++i) mean += x[r + i];
+    mean /= n;
+    for (int64_t i = 0; i < n; ++i) var += (x[r + i] - mean) * (x[r + i] - mean);
+    var /= n;
+    for (int64_t i = 0; i < n; ++i) {
+      out[r + i] = (x[r + i] - mean) / std::sqrt(var + eps) * gamma[i] + beta[i];
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(Normalization, Softmax) {
+  ForEachSIMDLevel([&]() {
+    for (int64_t n : {1, 3, 16, 17, 128, 129, 1000}) {
+      SCOPED_TRACE(n);
+      NDArray x = RandomArray({3, n}, 0.0f, 8.0f, static_cast<int>(n));
+      float* px = static_cast<float*>(x->data);
+      // one row far from 0, the result does not depend on the offset.
+      for (int64_t i = 2 * n; i < 3 * n; ++i) px[i] += 1000.0f;
+      NDArray out = NDArray::Empty({3, n}, kFloat32, cpu);
+      Softmax(x, out);
+      std::vector<double> expected = RefSoftmax(px, 3 * n, n);
+      const float* po = static_cast<const float*>(out->data);
+      // x - max rounds to float, the relative error grows with it.
+      for (int64_t i = 0; i < 3 * n; ++i) {
+        ASSERT_NEAR(po[i], expected[i], 5e-6 * expected[i] + 1e-37) << i;
+      }
+      // in place
+      Softmax(x, x);
+      ASSERT_EQ(memcmp(px, po, 3 * n * sizeof(float)), 0);
+    }
+  });
+}
+
+TEST(Normalization, SoftmaxSpecialValues) {
+  ForEachSIMDLevel([&]() {
+    NDArray x = RandomArray({2, 100}, 0.0f, 1.0f, 1);
+    float* px = static_cast<float*>(x->data);
+    // masked positions of attention, and a NaN.
+    for (int i = 0; i < 100; i += 3) px[i] = -INFINITY;
+    px[100 + 57] = NAN;
+    NDArray out = NDArray::Empty({2, 100}, kFloat32, cpu);
+    Softmax(x, out);
+    const float* po = static_cast<const float*>(out->data);
+    double sum = 0.0;
+    for (int i = 0; i < 100; ++i) {
+      if (i % 3 == 0) {
+        ASSERT_LT(po[i], 1e-37f);
+      }
+      sum += po[i];
+    }
+    EXPECT_NEAR(sum, 1.0, 1e-6);
+    for (int i = 100; i < 200; ++i) ASSERT_TRUE(std::isnan(po[i])) << i;
+  });
+}
+
+TEST(Normalization, LayerNorm) {
+  ForEachSIMDLevel([&]() {
+    for (int64_t n : {1, 5, 32, 33, 768, 1001}) {
+      SCOPED_TRACE(n);
+      NDArray x = RandomArray({4, n}, 0.0f, 2.0f, static_cast<int>(n));
+      NDArray gamma = RandomArray({n}, 1.0f, 0.5f, 2);
+      NDArray beta = RandomArray({n}, 0.0f, 0.5f, 3);
+      float* px = static_cast<float*>(x->data);
+      // rows far from 0, the naive E[x^2] - E[x]^2 would lose all the digits of the variance.
+      for (int64_t i = 2 * n; i < 4 * n; ++i) px[i] += 1e4f;
+      NDArray out = NDArray::Empty({4, n}, kFloat32, cpu);
+      LayerNorm(x, gamma, beta, 1e-5, out);
+      std::vector<double> expected =
+          RefLayerNorm(px, static_cast<float*>(gamma->data), static_cast<float*>(beta->data),
+                       1e-5, 4 * n, n);
+      const float* po = static_cast<const float*>(out->data);
+      for (int64_t i = 0; i < 4 * n; ++i) {
+        ASSERT_NEAR(po[i], expected[i], 2e-5) << i;
+      }
+    }
+  });
+}
+
+TEST(Normalization, BFloat16) {
+  ForEachSIMDLevel([&]() {
+    NDArray x = RandomArray({8, 200}, 0.0f, 3.0f, 4);
+    NDArray gamma = RandomArray({200}, 1.0f, 0.5f, 5);
+    NDArray beta = RandomArray({200}, 0.0f, 0.5f, 6);
+    NDArray x16 = NDArray::Empty({8, 200}, kBFloat16, cpu);
+    NDArray gamma16 = NDArray::Empty({200}, kBFloat16, cpu);
+    NDArray beta16 = NDArray::Empty({200}, kBFloat16, cpu);
+    Cast(x, x16);
+    Cast(gamma, gamma16);
+    Cast(beta, beta16);
+    // the float32 reference runs on the rounded inputs.
+    Cast(x16, x);
+    Cast(gamma16, gamma);
+    Cast(beta16, beta);
+    NDArray out16 = NDArray::Empty({8, 200}, kBFloat16, cpu);
+    NDArray out = NDArray::Empty({8, 200}, kFloat32, cpu);
+    NDArray expected = NDArray::Empty({8, 200}, kFloat32, cpu);
+    const float* po = static_cast<const float*>(out->data);
+    const float* pe = static_cast<const float*>(expected->data);
+
+    Softmax(x16, out16);
+    Cast(out16, out);
+    Softmax(x, expected);
+    for (int i = 0; i < 1600; ++i) ASSERT_NEAR(po[i], pe[i], 4e-3 * pe[i]) << i;
+
+    // bfloat16 and float32 parameters
+    for (const NDArray& params : {gamma16, gamma}) {
+      const NDArray& shift = params->dtype.bits == 16 ? beta16 : beta;
+      LayerNorm(x16, params, shift, 1e-5, out16);
+      Cast(out16, out);
+      LayerNorm(x, gamma, beta, 1e-5, expected);
+      for (int i = 0; i < 1600; ++i) ASSERT_NEAR(po[i], pe[i], 4e-3 * std::fabs(pe[i]) + 1e-6);
+    }
+  });
+}
+
+TEST(Normalization, Errors) {
+  NDArray x = RandomArray({4, 8}, 0.0f, 1.0f, 7);
+  NDArray gamma = RandomArray({8}, 1.0f, 0.1f, 8);
+  NDArray out = NDArray::Empty({4, 8}, kFloat32, cpu);
+  EXPECT_THROW(Softmax(x, NDArray::Empty({4, 9}, kFloat32, cpu)), Error);
+  EXPECT_THROW(Softmax(x, NDArray::Empty({4, 8}, kBFloat16, cpu)), Error);
+  EXPECT_THROW(Softmax(NDArray::Empty({4, 8}, DLDataType{kDLInt, 32, 1}, cpu),
+                       NDArray::Empty({4, 8}, DLDataType{kDLInt, 32, 1}, cpu)),
+               Error);
+  EXPECT_THROW(LayerNorm(x, RandomArray({4}, 1.0f, 0.1f, 9), gamma, 1e-5, out), Error);
+  EXPECT_THROW(LayerNorm(x, NDArray::Empty({8}, kBFloat16, cpu),
+                         NDArray::Empty({8}, kBFloat16, cpu), 1e-5, out),
+               Error);
+  // empty rows
+  NDArray empty = NDArray::Empty({4, 0}, kFloat32, cpu);
+  Softmax(empty, empty);
+}
+
+TEST(Normalization, ParallelAndRegistry) {
+  NDArray x = RandomArray({256, 768}, 0.5f, 2.0f, 10);
+  NDArray gamma = RandomArray({768}, 1.0f, 0.5f, 11);
+  NDArray beta = RandomArray({768}, 0.0f, 0.5f, 12);
+  NDArray serial = NDArray::Empty({256, 768}, kFloat32, cpu);
+  NDArray parallel = NDArray::Empty({256, 768}, kFloat32, cpu);
+  const size_t nbytes = 256 * 768 * sizeof(float);
+
+  ThreadPool::Global()->Configure(1, {});
+  LayerNorm(x, gamma, beta, 1e-12, serial);
+  ThreadPool::Global()->Configure(4, {});
+  const PackedFunc* layer_norm = Registry::Get("kernel.layer_norm");
+  ASSERT_TRUE(layer_norm != nullptr);
+  (*layer_norm)(x, gamma, beta, parallel, 1e-12);
+  EXPECT_EQ(memcmp(serial->data, parallel->data, nbytes), 0);
+
+  ThreadPool::Global()->Configure(1, {});
+  Softmax(x, serial);
+  ThreadPool::Global()->Configure(4, {});
+  const PackedFunc* softmax = Registry::Get("kernel.softmax");
+  ASSERT_TRUE(softmax != nullptr);
+  (*softmax)(x, parallel);
+  EXPECT_EQ(memcmp(serial->data, parallel->data, nbytes), 0);
+  EXPECT_TRUE(Registry::Get("kernel.gelu") != nullptr);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,197 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../src/runtime/kernels/conv2d.h"
+#include "../../src/runtime/op_strategy.h"
+
+using namespace cvm::runtime;
+
+namespace {
+
+/*! \brief A workload of one extent, the plan is the name of the implementation and n. */
+struct Plan {
+  std::string impl;
+  int64_t n;
+  /*! \brief Shared by the plans of a Counted, its use count tells the plans alive. */
+  std::shared_ptr<const int> token;
+};
+
+using TestStrategy = OpStrategy<int64_t, Plan>;
+
+/*! \brief Makes implementations planning their name and n, counts the plans made. */
+struct Counted {
+  std::atomic<int> num_plans{0};
+  std::shared_ptr<const int> token{std::make_shared<const int>(0)};
+
+  TestStrategy::Implementation Impl(const std::string& name, int priority,
+                                    std::function<bool(const int64_t&)> condition) {
+    return {name, priority, std::move(condition), [this, name](const int64_t& n) {
+              ++num_plans;
+              return Plan{name, n, token};
+            }};
+  }
+};
+
+DispatchKey Key(int64_t n) {
+  DispatchKey key;
+  key.Add(n);
+  return key;
+}
+
+}  // namespace
+
+TEST(OpStrategy, Select) {
+  Counted counted;
+  TestStrategy strategy("test", {counted.Impl("any", 1, nullptr),
+                                 counted.Impl("even", 2, [](int64_t n) { return n % 2 == 0; }),
+                                 counted.Impl("small", 3, [](int64_t n) { return n < 100; }),
+                                 counted.Impl("tie", 3, [](int64_t n) { return n < 50; })});
+  EXPECT_EQ(strategy.Select(7).plan.impl, "small");
+  EXPECT_EQ(strategy.Select(200).plan.impl, "even");
+  EXPECT_EQ(strategy.Select(201).plan.impl, "any");
+  EXPECT_EQ(strategy.Select(201).impl->name, "any");
+
+  TestStrategy none("none", {counted.Impl("even", 1, [](int64_t n) { return n % 2 == 0; })});
+  EXPECT_THROW(none.Select(1), Error);
+  EXPECT_THROW(none.Dispatch(Key(1), 1), Error);
+  EXPECT_EQ(none.size(), 0U);
+}
+
+TEST(OpStrategy, Cache) {
+  Counted counted;
+  TestStrategy strategy("test", {counted.Impl("any", 1, nullptr),
+                                 counted.Impl("even", 2, [](int64_t n) { return n % 2 == 0; })},
+                        1000);
+  // enough keys to grow the table a few times.
+  for (int round = 0; round < 3; ++round) {
+    for (int64_t n = 0; n < 500; ++n) {
+      TestStrategy::Selection s = strategy.Dispatch(Key(n), n);
+      ASSERT_EQ(s.plan.n, n);
+      ASSERT_EQ(s.plan.impl, n % 2 == 0 ? "even" : "any");
+    }
+  }
+  EXPECT_EQ(counted.num_plans.load(), 500);
+  EXPECT_EQ(strategy.size(), 500U);
+
+  strategy.Clear();
+  EXPECT_EQ(strategy.size(), 0U);
+  strategy.Dispatch(Key(3), 3);
+  EXPECT_EQ(counted.num_plans.load(), 501);
+
+  // past max_entries and for long keys, every dispatch selects again.
+  TestStrategy bounded("bounded", {counted.Impl("any", 1, nullptr)}, 2);
+  for (int64_t n = 0; n < 4; ++n) bounded.Dispatch(Key(n), n);
+  bounded.Dispatch(Key(3), 3);
+  EXPECT_EQ(bounded.size(), 2U);
+  EXPECT_EQ(counted.num_plans.load(), 501 + 5);
+  DispatchKey long_key;
+  for (int i = 0; i <= DispatchKey::kMaxWords; ++i) long_key.Add(int64_t{1});
+  EXPECT_TRUE(long_key.overflowed());
+  EXPECT_EQ(bounded.Dispatch(long_key, 9).plan.n, 9);
+}
+
+TEST(OpStrategy, DispatchKey) {
+  DLDataType f32{kDLFloat, 32, 1}, i32{kDLInt, 32, 1};
+  int64_t shape[] = {2, 3};
+  DLTensor a{nullptr, {kDLCPU, 0}, 2, f32, shape, nullptr, 0};
+  DLTensor b = a;
+  b.dtype = i32;
+  DispatchKey ka, kb, ka2;
+  ka.Add(a);
+  kb.Add(b);
+  ka2.Add(a);
+  EXPECT_TRUE(ka == ka2);
+  EXPECT_EQ(ka.Hash(), ka2.Hash());
+  EXPECT_FALSE(ka == kb);
+  // the words are not confused with the length of the key.
+  DispatchKey k0, k00;
+  k0.Add(int64_t{0});
+  k00.Add(int64_t{0});
+  k00.Add(int64_t{0});
+  EXPECT_FALSE(k0 == k00);
+}
+
+TEST(OpStrategy, ConcurrentDispatch) {
+  Counted counted;
+  TestStrategy strategy("test", {counted.Impl("any", 1, nullptr)});
+  const int num_keys = 300;
+  std::atomic<bool> mismatch{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int round = 0; round < 20; ++round) {
+        for (int64_t i = 0; i < num_keys; ++i) {
+          int64_t n = (i * (t + 1) * 7) % num_keys;
+          if (strategy.Dispatch(Key(n), n).plan.n != n) mismatch = true;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_FALSE(mismatch.load());
+  EXPECT_EQ(strategy.size(), static_cast<size_t>(num_keys));
+  EXPECT_EQ(counted.num_plans.load(), num_keys);
+}
+
+TEST(OpStrategy, Reclaim) {
+  Counted counted;
+  TestStrategy strategy("test", {counted.Impl("any", 1, nullptr)});
+  for (int round = 0; round < 50; ++round) {
+    // enough keys to grow the table, then drop them.
+    for (int64_t n = 0; n < 100; ++n) strategy.Dispatch(Key(n), n);
+    strategy.Clear();
+  }
+  // without a lookup running, the replaced entries are freed at once.
+  EXPECT_EQ(counted.token.use_count(), 1);
+  strategy.Dispatch(Key(1), 1);
+  EXPECT_EQ(counted.token.use_count(), 2);
+
+  // with lookups running, they are freed by the last one out or the next writer.
+  std::atomic<bool> stop{false}, mismatch{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 3; ++t) {
+    threads.emplace_back([&]() {
+      for (int64_t i = 0; !stop.load(); i = (i + 1) % 200) {
+        if (strategy.Dispatch(Key(i), i).plan.n != i) mismatch = true;
+      }
+    });
+  }
+  for (int round = 0; round < 200; ++round) {
+    strategy.Clear();
+    std::this_thread::yield();
+  }
+  stop = true;
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_FALSE(mismatch.load());
+  strategy.Clear();
+  EXPECT_EQ(counted.token.use_count(), 1);
+}
+
+TEST(OpStrategy, Conv2DSelection) {
+  using namespace cvm::runtime::kernels;
+  Conv2DShape shape{1, 32, 56, 56, 32, 3, 3, 56, 56};
+  Conv2DParams params;
+  params.pad_top = params.pad_left = params.pad_bottom = params.pad_right = 1;
+  EXPECT_EQ(SelectConv2DAlgorithm(shape, params), Conv2DAlgorithm::kWinograd);
+  shape.in_channels = 3;
+  EXPECT_EQ(SelectConv2DAlgorithm(shape, params), Conv2DAlgorithm::kDirect);
+  params.groups = 3;
+  shape.out_channels = 3;
+  EXPECT_EQ(SelectConv2DAlgorithm(shape, params), Conv2DAlgorithm::kIm2col);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
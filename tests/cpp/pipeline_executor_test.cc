@@ -0,0 +1,283 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../../src/runtime/pipeline_executor.h"
+#include "../../src/runtime/ring_buffer.h"
+
+using namespace cvm::runtime;
+
+namespace {
+
+ObjectRef Int(int64_t value) { return ShapeTuple({value}); }
+
+int64_t Value(const ObjectRef& obj) { return obj.as<ShapeTupleObj>()->data[0]; }
+
+/*! \brief A stage mapping a ShapeTuple {x} to {f(x)}. */
+template <typename F>
+StageConfig Stage(const char* name, F f, int num_threads = 1, size_t queue_capacity = 4) {
+  StageConfig stage;
+  stage.name = name;
+  stage.func = PackedFunc([f](CVMArgs args, CVMRetValue* rv) {
+    ObjectRef x = args[0];
+    *rv = Int(f(Value(x)));
+  });
+  stage.num_threads = num_threads;
+  stage.queue_capacity = queue_capacity;
+  return stage;
+}
+
+/*! \brief Push 0..n-1 from num_producers threads and pop everything from num_consumers. */
+template <typename Ring>
+void StressRing(int num_producers, int num_consumers, int n) {
+  BlockingQueue<int64_t, Ring> queue(8);
+  std::atomic<int64_t> sum{0}, count{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < num_producers; ++p) {
+    threads.emplace_back([&, p]() {
+      for (int64_t i = p; i < n; i += num_producers) {
+        int64_t v = i;
+        ASSERT_TRUE(queue.Push(std::move(v)));
+      }
+    });
+  }
+  for (int c = 0; c < num_consumers; ++c) {
+    threads.emplace_back([&]() {
+      int64_t v;
+      int64_t last = -1;
+      while (queue.Pop(&v)) {
+        // a single producer delivers in order.
+        if (num_producers == 1 && num_consumers == 1) {
+          EXPECT_GT(v, last);
+        }
+        last = v;
+        sum += v;
+        count += 1;
+      }
+    });
+  }
+  for (int p = 0; p < num_producers; ++p) threads[p].join();
+  queue.Close();
+  for (size_t t = num_producers; t < threads.size(); ++t) threads[t].join();
+  EXPECT_EQ(count.load(), n);
+  EXPECT_EQ(sum.load(), static_cast<int64_t>(n) * (n - 1) / 2);
+}
+
+}  // namespace
+
+TEST(RingBuffer, Bounded) {
+  SPSCRing<int> spsc(3);
+  MPMCRing<int> mpmc(3);
+  EXPECT_EQ(spsc.capacity(), 4U);
+  EXPECT_EQ(mpmc.capacity(), 4U);
+  for (int i = 0; i < 4; ++i) {
+    int a = i, b = i;
+    EXPECT_TRUE(spsc.TryPush(std::move(a)));
+    EXPECT_TRUE(mpmc.TryPush(std::move(b)));
+  }
+  int full = 9;
+  EXPECT_FALSE(spsc.TryPush(std::move(full)));
+  EXPECT_FALSE(mpmc.TryPush(std::move(full)));
+  for (int i = 0; i < 4; ++i) {
+    int a, b;
+    ASSERT_TRUE(spsc.TryPop(&a));
+    ASSERT_TRUE(mpmc.TryPop(&b));
+    EXPECT_EQ(a, i);
+    EXPECT_EQ(b, i);
+  }
+  int empty;
+  EXPECT_FALSE(spsc.TryPop(&empty));
+  EXPECT_FALSE(mpmc.TryPop(&empty));
+}
+
+TEST(RingBuffer, HeapAlignment) {
+  // the indices are on lines of their own only when the ring itself is aligned.
+  for (int i = 0; i < 16; ++i) {
+    std::unique_ptr<SPSCRing<int>> spsc(new SPSCRing<int>(4));
+    std::unique_ptr<BlockingQueue<int, MPMCRing<int>>> queue(
+        new BlockingQueue<int, MPMCRing<int>>(4));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(spsc.get()) % kCacheLineSize, 0U);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(queue.get()) % kCacheLineSize, 0U);
+  }
+}
+
+TEST(RingBuffer, Concurrent) {
+  StressRing<SPSCRing<int64_t>>(1, 1, 100000);
+  StressRing<MPMCRing<int64_t>>(1, 1, 100000);
+  StressRing<MPMCRing<int64_t>>(4, 3, 100000);
+}
+
+TEST(RingBuffer, Closed) {
+  BlockingQueue<int, SPSCRing<int>> queue(4);
+  int v = 1;
+  ASSERT_TRUE(queue.Push(std::move(v)));
+  queue.Close();
+  // pushes fail even with room left, the values pushed before still come out.
+  v = 2;
+  EXPECT_FALSE(queue.Push(std::move(v)));
+  EXPECT_FALSE(queue.TryPush(std::move(v)));
+  ASSERT_TRUE(queue.Pop(&v));
+  EXPECT_EQ(v, 1);
+  EXPECT_FALSE(queue.Pop(&v));
+}
+
+TEST(RingBuffer, ReleasesPoppedValues) {
+  SPSCRing<ObjectRef> ring(2);
+  ObjectRef x = Int(1);
+  ObjectRef copy = x;
+  ring.TryPush(std::move(copy));
+  EXPECT_EQ(x.use_count(), 2);
+  ObjectRef out;
+  ring.TryPop(&out);
+  out = ObjectRef();
+  EXPECT_EQ(x.use_count(), 1);
+}
+
+TEST(PipelineExecutor, InOrder) {
+  PipelineExecutor pipeline({Stage("add", [](int64_t x) { return x + 1; }),
+                             Stage("mul", [](int64_t x) { return x * 3; }),
+                             Stage("sub", [](int64_t x) { return x - 2; })},
+                            4);
+  const int n = 1000;
+  std::thread producer([&]() {
+    for (int i = 0; i < n; ++i) pipeline.Push(Int(i));
+  });
+  for (int i = 0; i < n; ++i) {
+    ObjectRef out;
+    ASSERT_TRUE(pipeline.Pop(&out));
+    EXPECT_EQ(Value(out), (i + 1) * 3 - 2);
+  }
+  producer.join();
+  pipeline.Drain();
+  ObjectRef out;
+  EXPECT_FALSE(pipeline.Pop(&out));
+  EXPECT_THROW(pipeline.Push(Int(0)), Error);
+
+  PipelineStats stats = pipeline.Stats();
+  EXPECT_EQ(stats.num_outputs, n);
+  ASSERT_EQ(stats.stages.size(), 3U);
+  for (const StageStats& stage : stats.stages) {
+    EXPECT_EQ(stage.num_items, n);
+    EXPECT_GE(stage.utilization, 0.0);
+    EXPECT_LE(stage.utilization, 1.0);
+  }
+  EXPECT_GT(stats.LatencyQuantileUs(0.99), 0.0);
+}
+
+TEST(PipelineExecutor, DrainAndBackpressure) {
+  std::atomic<int> processed{0};
+  PipelineExecutor pipeline({Stage("count",
+                                   [&](int64_t x) {
+                                     ++processed;
+                                     return x;
+                                   },
+                                   2, 2)},
+                            2);
+  // nothing pops: the output, the stage threads and the input fill up, then TryPush fails
+  // for good. At most 2 outputs, 2 items in the stage and 2 inputs are in flight.
+  int pushed = 0;
+  for (int i = 0; i < 1000; ++i) {
+    if (pipeline.TryPush(Int(pushed))) {
+      ++pushed;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  EXPECT_GE(pushed, 2);
+  EXPECT_LE(pushed, 2 + 2 + 2);
+  EXPECT_LE(processed.load(), pushed);
+  std::vector<ObjectRef> rest;
+  pipeline.Drain(&rest);
+  EXPECT_EQ(static_cast<int>(rest.size()), pushed);
+  std::vector<int64_t> values;
+  for (const ObjectRef& x : rest) values.push_back(Value(x));
+  std::sort(values.begin(), values.end());
+  for (int i = 0; i < pushed; ++i) EXPECT_EQ(values[i], i);
+}
+
+TEST(PipelineExecutor, PushRacingDrain) {
+  for (int round = 0; round < 20; ++round) {
+    PipelineExecutor pipeline({Stage("id", [](int64_t x) { return x; })}, 1024);
+    std::atomic<int> pushed{0};
+    std::thread pusher([&]() {
+      try {
+        while (true) {
+          pipeline.Push(Int(pushed.load()));
+          ++pushed;
+        }
+      } catch (const Error&) {
+        // pushes after Drain fail.
+      }
+    });
+    while (pushed.load() < round) std::this_thread::yield();
+    std::vector<ObjectRef> rest;
+    pipeline.Drain(&rest);
+    pusher.join();
+    // every push that returned came out of the pipeline.
+    EXPECT_EQ(static_cast<int>(rest.size()), pushed.load());
+  }
+}
+
+TEST(PipelineExecutor, Filter) {
+  StageConfig odd;
+  odd.name = "odd";
+  odd.func = PackedFunc([](CVMArgs args, CVMRetValue* rv) {
+    ObjectRef x = args[0];
+    if (Value(x) % 2 == 1) *rv = x;
+  });
+  PipelineExecutor pipeline({odd, Stage("neg", [](int64_t x) { return -x; }, 3)});
+  for (int i = 0; i < 10; ++i) pipeline.Push(Int(i));
+  std::vector<ObjectRef> rest;
+  pipeline.Drain(&rest);
+  std::vector<int64_t> values;
+  for (const ObjectRef& x : rest) values.push_back(Value(x));
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ(values, (std::vector<int64_t>{-9, -7, -5, -3, -1}));
+  EXPECT_EQ(pipeline.Stats().stages[0].num_items, 10);
+}
+
+TEST(PipelineExecutor, Errors) {
+  EXPECT_THROW(PipelineExecutor({}), Error);
+  EXPECT_THROW(PipelineExecutor({StageConfig()}), Error);
+  PipelineExecutor pipeline({Stage("id", [](int64_t x) { return x; }),
+                             Stage("fail", [](int64_t x) -> int64_t {
+                               if (x == 3) throw Error("stage failed");
+                               return x;
+                             })});
+  for (int i = 0; i < 3; ++i) pipeline.Push(Int(i));
+  for (int i = 0; i < 3; ++i) {
+    ObjectRef out;
+    ASSERT_TRUE(pipeline.Pop(&out));
+    EXPECT_EQ(Value(out), i);
+  }
+  pipeline.Push(Int(3));
+  ObjectRef out;
+  EXPECT_THROW(pipeline.Pop(&out), Error);
+  EXPECT_THROW(pipeline.Push(Int(4)), Error);
+  EXPECT_THROW(pipeline.Drain(), Error);
+
+  // an exception of any type fails the pipeline, the destructor does not rethrow it.
+  PipelineExecutor other({Stage("throw", [](int64_t x) -> int64_t {
+    if (x == 1) throw 1;
+    return x;
+  })});
+  other.Push(Int(1));
+  EXPECT_ANY_THROW(other.Pop(&out));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
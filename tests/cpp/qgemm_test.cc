@@ -0,0 +1,159 @@
+//
+// Created by WangJingYu on 2021/7/21.
+//
+
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "../../src/runtime/kernels/qgemm.h"
+#include "../../src/runtime/thread_pool.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+
+std::vector<int8_t> RandomInt8(size_t size, int low, int high, int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> dist(low, high);
+  std::vector<int8_t> v(size);
+  for (int8_t& x : v) x = static_cast<int8_t>(dist(gen));
+  return v;
+}
+
+/*! \brief The reference of the epilogue, with the rounding of the kernels. */
+int8_t Requantize(int32_t acc, float scale, int32_t zero_point, bool relu) {
+  float f = std::min(std::max(static_cast<float>(acc) * scale, -512.0f), 512.0f);
+  int32_t q = static_cast<int32_t>(std::nearbyint(f)) + zero_point;
+  return static_cast<int8_t>(std::min(std::max(q, relu ? zero_point : -128), 127));
+}
+
+/*! \brief Check QGemm against plain loops, the results must match exactly. */
+void CheckQGemm(int64_t m, int64_t n, int64_t k, int weight_low, bool transposed,
+                SIMDLevel level) {
+  SCOPED_TRACE(::testing::Message() << "m " << m << " n " << n << " k " << k << " level "
+                                    << SIMDLevelName(level) << " transposed " << transposed);
+  int64_t lda = k + 5;
+  std::vector<int8_t> a = RandomInt8(m * lda, -128, 127, 1);
+  std::vector<int8_t> w = RandomInt8(n * k, weight_low, 127, 2);
+  std::vector<int32_t> bias(n);
+  std::vector<float> scale(n);
+  for (int64_t j = 0; j < n; ++j) {
+    bias[j] = static_cast<int32_t>(j * 37 % 2001) - 1000;
+    scale[j] = 1.0f / (256.0f + 61.0f * j);
+  }
+  std::vector<int8_t> wt(k * n);
+  for (int64_t j = 0; j < n; ++j) {
+    for (int64_t p = 0; p < k; ++p) wt[p * n + j] = w[j * k + p];
+  }
+  QGemmPackedB packed = transposed ? QGemmPackedB(wt.data(), n, n, k, true, level)
+                                   : QGemmPackedB(w.data(), k, n, k, false, level);
+
+  for (int relu = 0; relu < 2; ++relu) {
+    QGemmParams params;
+    params.a_zero_point = 3;
+    params.bias = bias.data();
+    params.scale = scale.data();
+    params.c_zero_point = -5;
+    params.relu = relu;
+    int64_t ldc = n + 3;
+    std::vector<int8_t> c(m * ldc, 99);
+    std::vector<int32_t> c32(m * ldc, 99);
+    QGemm(m, a.data(), lda, packed, params, c.data(), ldc);
+    QGemm(m, a.data(), lda, packed, params, c32.data(), ldc);
+    for (int64_t i = 0; i < m; ++i) {
+      for (int64_t j = 0; j < n; ++j) {
+        int32_t acc = bias[j];
+        for (int64_t p = 0; p < k; ++p) acc += (a[i * lda + p] - 3) * w[j * k + p];
+        ASSERT_EQ(c[i * ldc + j], Requantize(acc, scale[j], -5, relu)) << i << ", " << j;
+        ASSERT_EQ(c32[i * ldc + j], relu ? std::max(acc, 0) : acc) << i << ", " << j;
+      }
+      ASSERT_EQ(c[i * ldc + n], 99);
+      ASSERT_EQ(c32[i * ldc + n], 99);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(QGemm, Levels) {
+  ThreadPool::Global()->Configure(1, {});
+  const std::vector<std::vector<int64_t>> shapes = {
+      {1, 1, 1}, {1, 100, 37}, {5, 33, 64}, {12, 32, 4}, {13, 47, 130}, {40, 70, 257},
+  };
+  for (int level = 0; level <= static_cast<int>(DetectSIMDLevel()); ++level) {
+    for (const auto& s : shapes) {
+      CheckQGemm(s[0], s[1], s[2], -127, false, static_cast<SIMDLevel>(level));
+      CheckQGemm(s[0], s[1], s[2], -128, false, static_cast<SIMDLevel>(level));
+    }
+    CheckQGemm(17, 40, 51, -127, true, static_cast<SIMDLevel>(level));
+  }
+  if (DetectSIMDLevel() >= SIMDLevel::kAVX2) {
+    std::vector<int8_t> w(64, -128);
+    EXPECT_EQ(QGemmPackedB(w.data(), 8, 8, 8, false, SIMDLevel::kAVX2).kernels(),
+              GetQGemmKernelsScalar());
+  }
+}
+
+TEST(QGemm, Parallel) {
+  for (int threads : {2, 4}) {
+    ThreadPool::Global()->Configure(threads, {});
+    CheckQGemm(100, 200, 96, -127, false, GetSIMDLevel());
+    CheckQGemm(2, 500, 1000, -127, false, GetSIMDLevel());
+  }
+}
+
+TEST(QGemm, QuantizedDense) {
+  ThreadPool::Global()->Configure(2, {});
+  NDArray data = NDArray::Empty({2, 3}, DLDataType{kDLInt, 8, 1}, cpu);
+  NDArray weight = NDArray::Empty({2, 3}, DLDataType{kDLInt, 8, 1}, cpu);
+  NDArray bias = NDArray::Empty({2}, DLDataType{kDLInt, 32, 1}, cpu);
+  NDArray scale = NDArray::Empty({2}, DLDataType{kDLFloat, 32, 1}, cpu);
+  NDArray out8 = NDArray::Empty({2, 2}, DLDataType{kDLInt, 8, 1}, cpu);
+  NDArray out32 = NDArray::Empty({2, 2}, DLDataType{kDLInt, 32, 1}, cpu);
+  const int8_t d[] = {1, 2, 3, -4, -5, -6};
+  const int8_t wv[] = {10, 20, 30, -1, -1, -1};
+  for (int i = 0; i < 6; ++i) {
+    static_cast<int8_t*>(data->data)[i] = d[i];
+    static_cast<int8_t*>(weight->data)[i] = wv[i];
+  }
+  static_cast<int32_t*>(bias->data)[0] = 4;
+  static_cast<int32_t*>(bias->data)[1] = 0;
+  static_cast<float*>(scale->data)[0] = 0.5f;
+  static_cast<float*>(scale->data)[1] = 2.0f;
+
+  const PackedFunc* dense = Registry::Get("kernel.quantized_dense");
+  ASSERT_TRUE(dense != nullptr);
+  (*dense)(data, weight, NDArray(), NDArray(), out32, 0, 0, false);
+  const int32_t* p32 = static_cast<const int32_t*>(out32->data);
+  EXPECT_EQ(p32[0], 140);
+  EXPECT_EQ(p32[1], -6);
+  EXPECT_EQ(p32[2], -320);
+  EXPECT_EQ(p32[3], 15);
+
+  (*dense)(data, weight, bias, scale, out8, 0, 1, true);
+  const int8_t* p8 = static_cast<const int8_t*>(out8->data);
+  EXPECT_EQ(p8[0], 73);   // (140 + 4) / 2 + 1
+  EXPECT_EQ(p8[1], 1);    // -12 + 1 clamped at the zero point
+  EXPECT_EQ(p8[2], 1);    // -158 + 1 clamped at the zero point
+  EXPECT_EQ(p8[3], 31);   // 30 + 1
+
+  EXPECT_THROW((*dense)(data, weight, bias, scale, out32, 0, 0, false), Error);
+  EXPECT_THROW((*dense)(data, data, NDArray(), NDArray(), out8, 0, 0, false), Error);
+  EXPECT_THROW((*dense)(data, weight, scale, scale, out8, 0, 0, false), Error);
+  EXPECT_THROW((*dense)(data, weight, bias, scale, out8, 200, 0, false), Error);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
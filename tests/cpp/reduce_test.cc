@@ -0,0 +1,270 @@
+//
+// Created by WangJingYu on 2021/7/24.
+//
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../../src/runtime/kernels/reduce.h"
+#include "../../src/runtime/thread_pool.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::kernels;
+
+namespace {
+
+const Device cpu{kDLCPU, 0};
+const DLDataType f32{kDLFloat, 32, 1};
+const DLDataType i64{kDLInt, 64, 1};
+
+NDArray RandomArray(std::vector<int64_t> shape, float low, float high, int seed) {
+  NDArray arr = NDArray::Empty(shape, f32, cpu);
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(low, high);
+  float* data = static_cast<float*>(arr->data);
+  size_t n = GetDataSize(*arr.operator->()) / sizeof(float);
+  for (size_t i = 0; i < n; ++i) data[i] = dist(gen);
+  return arr;
+}
+
+template <typename F>
+void ForEachSIMDLevel(F f) {
+  SIMDLevel saved = GetSIMDLevel();
+  for (int level = 0; level <= static_cast<int>(DetectSIMDLevel()); ++level) {
+    SetSIMDLevel(static_cast<SIMDLevel>(level));
+    SCOPED_TRACE(SIMDLevelName(GetSIMDLevel()));
+    f();
+  }
+  SetSIMDLevel(saved);
+}
+
+/*! \brief The reduction in double, index by index, the first maximum for argmax. */
+std::vector<double> Reference(ReduceOpKind op, const NDArray& x, const std::vector<int64_t>& axes) {
+  std::vector<int64_t> shape = x.Shape();
+  size_t ndim = shape.size();
+  std::vector<bool> reduced(ndim, axes.empty());
+  for (int64_t axis : axes) reduced[axis < 0 ? axis + ndim : axis] = true;
+  std::vector<int64_t> out_shape = ReduceShape(shape, axes, true);
+  int64_t num_out = 1, num_elems = 1;
+  for (int64_t e : out_shape) num_out *= e;
+  for (int64_t e : shape) num_elems *= e;
+  std::vector<double> acc(num_out, op == kReduceMax ? -INFINITY : 0.0);
+  std::vector<double> best(num_out, -INFINITY);
+  std::vector<int64_t> count(num_out, 0);
+  const float* px = static_cast<const float*>(x->data);
+  for (int64_t i = 0; i < num_elems; ++i) {
+    int64_t rest = i, o = 0, stride = 1, r = 0, r_stride = 1;
+    for (size_t d = ndim; d != 0; --d) {
+      int64_t index = rest % shape[d - 1];
+      rest /= shape[d - 1];
+      if (!reduced[d - 1]) o += index * stride;
+      if (reduced[d - 1]) r += index * r_stride, r_stride *= shape[d - 1];
+      stride *= out_shape[d - 1];
+    }
+    double v = px[i];
+    ++count[o];
+    switch (op) {
+      case kReduceMax:
+        acc[o] = std::isnan(acc[o]) || std::isnan(v) ? NAN : std::max(acc[o], v);
+        break;
+      case kReduceMin:
+        acc[o] = count[o] == 1                           ? v
+                 : std::isnan(acc[o]) || std::isnan(v) ? NAN
+                                                       : std::min(acc[o], v);
+        break;
+      case kReduceArgMax:
+        if (count[o] == 1 || (!std::isnan(best[o]) && (v > best[o] || std::isnan(v)))) {
+          best[o] = v;
+          acc[o] = axes.empty() ? i : r;
+        }
+        break;
+      case kReduceNorm2:
+        acc[o] += v * v;
+        break;
+      default:
+        acc[o] += v;
+    }
+  }
+  for (int64_t o = 0; o < num_out; ++o) {
+    if (op == kReduceMean) acc[o] /= count[o];
+    if (op == kReduceNorm2) acc[o] = std::sqrt(acc[o]);
+  }
+  return acc;
+}
+
+void CheckReduce(ReduceOpKind op, const NDArray& x, const std::vector<int64_t>& axes,
+                 bool keepdims, SumMethod method, double rtol) {
+  std::vector<int64_t> out_shape = ReduceShape(x.Shape(), axes, keepdims);
+  NDArray out = NDArray::Empty(out_shape, op == kReduceArgMax ? i64 : f32, cpu);
+  Reduce(op, x, axes, keepdims, out, method);
+  std::vector<double> expected = Reference(op, x, axes);
+  ASSERT_EQ(expected.size(), GetDataSize(*out.operator->()) / (op == kReduceArgMax ? 8 : 4));
+  for (size_t i = 0; i < expected.size(); ++i) {
+    if (op == kReduceArgMax) {
+      ASSERT_EQ(static_cast<int64_t*>(out->data)[i], static_cast<int64_t>(expected[i]))
+          << ReduceOpName(op) << " at " << i;
+    } else {
+      double value = static_cast<float*>(out->data)[i];
+      if (std::isnan(expected[i])) {
+        ASSERT_TRUE(std::isnan(value)) << ReduceOpName(op) << " at " << i;
+      } else {
+        ASSERT_NEAR(value, expected[i], rtol * std::fabs(expected[i]) + 1e-6)
+            << ReduceOpName(op) << " at " << i;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(Reduce, ReduceShape) {
+  EXPECT_EQ(ReduceShape({2, 3, 4}, {1}, false), (std::vector<int64_t>{2, 4}));
+  EXPECT_EQ(ReduceShape({2, 3, 4}, {-1, 0}, true), (std::vector<int64_t>{1, 3, 1}));
+  EXPECT_EQ(ReduceShape({2, 3, 4}, {}, false), (std::vector<int64_t>{}));
+  EXPECT_THROW(ReduceShape({2, 3}, {2}, false), Error);
+  EXPECT_THROW(ReduceShape({2, 3}, {1, -1}, false), Error);
+}
+
+TEST(Reduce, Axes) {
+  const std::vector<std::pair<std::vector<int64_t>, std::vector<int64_t>>> cases = {
+      {{100003}, {}},         {{37, 65}, {1}},         {{37, 65}, {0}},
+      {{4, 1, 33, 5}, {0, 2}}, {{3, 5, 7, 9}, {1, 3}}, {{2, 3, 4, 5}, {0, 1, 2, 3}},
+      {{6, 2050}, {0}},       {{3, 1, 5}, {1}},        {{40000, 3}, {0}},
+      {{5}, {0}},
+  };
+  ForEachSIMDLevel([&]() {
+    for (const auto& c : cases) {
+      NDArray x = RandomArray(c.first, -4.0f, 4.0f, 1);
+      for (int op = 0; op < kNumReduceOps; ++op) {
+        if (op == kReduceArgMax && c.second.size() > 1) continue;
+        for (bool keepdims : {false, true}) {
+          SCOPED_TRACE(ReduceOpName(static_cast<ReduceOpKind>(op)));
+          CheckReduce(static_cast<ReduceOpKind>(op), x, c.second, keepdims, SumMethod::kPairwise,
+                      1e-5);
+          CheckReduce(static_cast<ReduceOpKind>(op), x, c.second, keepdims, SumMethod::kKahan,
+                      1e-5);
+        }
+      }
+    }
+    NDArray x = RandomArray({3, 40000}, -4.0f, 4.0f, 2);
+    CheckReduce(kReduceArgMax, x, {}, false, SumMethod::kPairwise, 0);
+    CheckReduce(kReduceArgMax, x, {-1}, true, SumMethod::kPairwise, 0);
+  });
+}
+
+TEST(Reduce, Accuracy) {
+  // 2^22 values close to 1, a running float sum would drift by far more than these bounds.
+  const int64_t n = 1 << 22;
+  NDArray x = RandomArray({n}, -1.0f, 1.0f, 3);
+  float* px = static_cast<float*>(x->data);
+  double expected = 0.0;
+  for (int64_t i = 0; i < n; ++i) {
+    px[i] = 1.0f + 1e-4f * px[i];
+    expected += px[i];
+  }
+  NDArray out = NDArray::Empty({}, f32, cpu);
+  ForEachSIMDLevel([&]() {
+    Reduce(kReduceSum, x, {}, false, out, SumMethod::kPairwise);
+    EXPECT_NEAR(static_cast<float*>(out->data)[0], expected, expected * 1e-6);
+    Reduce(kReduceSum, x, {}, false, out, SumMethod::kKahan);
+    EXPECT_NEAR(static_cast<float*>(out->data)[0], expected, expected * 1e-7);
+  });
+}
+
+TEST(Reduce, NaN) {
+  ForEachSIMDLevel([&]() {
+    NDArray x = RandomArray({7, 300}, -4.0f, 4.0f, 4);
+    float* px = static_cast<float*>(x->data);
+    px[3 * 300 + 150] = NAN;
+    px[3 * 300 + 250] = NAN;
+    px[5 * 300] = NAN;
+    px[6 * 300 + 299] = NAN;
+    for (ReduceOpKind op : {kReduceMax, kReduceMin, kReduceArgMax, kReduceSum}) {
+      CheckReduce(op, x, {1}, false, SumMethod::kPairwise, 1e-5);
+      CheckReduce(op, x, {0}, false, SumMethod::kPairwise, 1e-5);
+    }
+    CheckReduce(kReduceArgMax, x, {}, false, SumMethod::kPairwise, 0);
+    // ties give the first index.
+    std::fill(px, px + 7 * 300, 1.0f);
+    CheckReduce(kReduceArgMax, x, {1}, false, SumMethod::kPairwise, 0);
+    CheckReduce(kReduceArgMax, x, {0}, false, SumMethod::kPairwise, 0);
+  });
+}
+
+TEST(Reduce, Deterministic) {
+  NDArray x = RandomArray({3, 70001}, -1.0f, 1.0f, 5);
+  NDArray y = RandomArray({257, 3, 129}, -1.0f, 1.0f, 6);
+  const std::vector<std::pair<NDArray, std::vector<int64_t>>> cases = {
+      {x, {}}, {x, {1}}, {x, {0}}, {y, {0, 2}}, {y, {0}}};
+  std::vector<std::vector<float>> results[2];
+  int threads[2] = {1, 3};
+  for (int t = 0; t < 2; ++t) {
+    ThreadPool::Global()->Configure(threads[t], {});
+    for (const auto& c : cases) {
+      for (ReduceOpKind op : {kReduceSum, kReduceNorm2, kReduceMax}) {
+        for (SumMethod method : {SumMethod::kPairwise, SumMethod::kKahan}) {
+          NDArray out = NDArray::Empty(ReduceShape(c.first.Shape(), c.second, false), f32, cpu);
+          Reduce(op, c.first, c.second, false, out, method);
+          const float* po = static_cast<const float*>(out->data);
+          results[t].emplace_back(po, po + GetDataSize(*out.operator->()) / sizeof(float));
+        }
+      }
+    }
+  }
+  ASSERT_EQ(results[0].size(), results[1].size());
+  for (size_t i = 0; i < results[0].size(); ++i) {
+    ASSERT_EQ(results[0][i].size(), results[1][i].size());
+    EXPECT_EQ(memcmp(results[0][i].data(), results[1][i].data(), results[0][i].size() * 4), 0)
+        << "case " << i;
+  }
+}
+
+TEST(Reduce, EmptyAndErrors) {
+  NDArray empty = NDArray::Empty({3, 0}, f32, cpu);
+  NDArray out = NDArray::Empty({3}, f32, cpu);
+  Reduce(kReduceSum, empty, {1}, false, out);
+  EXPECT_EQ(static_cast<float*>(out->data)[2], 0.0f);
+  Reduce(kReduceMean, empty, {1}, false, out);
+  EXPECT_TRUE(std::isnan(static_cast<float*>(out->data)[0]));
+  EXPECT_THROW(Reduce(kReduceMax, empty, {1}, false, out), Error);
+
+  NDArray x = RandomArray({3, 4}, -1.0f, 1.0f, 7);
+  EXPECT_THROW(Reduce(kReduceSum, x, {0}, false, out), Error);
+  EXPECT_THROW(Reduce(kReduceSum, x, {2}, false, out), Error);
+  EXPECT_THROW(Reduce(kReduceArgMax, x, {1}, false, out), Error);
+  NDArray index = NDArray::Empty({}, i64, cpu);
+  EXPECT_THROW(Reduce(kReduceArgMax, x, {0, 1}, false, index), Error);
+  NDArray ints = NDArray::Empty({3, 4}, DLDataType{kDLInt, 32, 1}, cpu);
+  EXPECT_THROW(Reduce(kReduceSum, ints, {1}, false, out), Error);
+}
+
+TEST(Reduce, Registry) {
+  ThreadPool::Global()->Configure(2, {});
+  NDArray x = RandomArray({4, 5, 6}, -1.0f, 1.0f, 8);
+  NDArray out = NDArray::Empty({4, 1, 6}, f32, cpu);
+  const PackedFunc* sum = Registry::Get("kernel.sum");
+  ASSERT_TRUE(sum != nullptr);
+  (*sum)(x, out, ShapeTuple({1}), true, true);
+  std::vector<double> expected = Reference(kReduceSum, x, {1});
+  for (int i = 0; i < 24; ++i) EXPECT_NEAR(static_cast<float*>(out->data)[i], expected[i], 1e-5);
+  NDArray index = NDArray::Empty({4, 6}, i64, cpu);
+  (*Registry::Get("kernel.argmax"))(x, index, ShapeTuple({-2}), false);
+  expected = Reference(kReduceArgMax, x, {1});
+  for (int i = 0; i < 24; ++i) EXPECT_EQ(static_cast<int64_t*>(index->data)[i], expected[i]);
+  for (const char* name : {"kernel.mean", "kernel.max", "kernel.min", "kernel.norm"}) {
+    EXPECT_TRUE(Registry::Get(name) != nullptr) << name;
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,270 @@
+//
+// Created by WangJingYu on 2021/7/18.
+//
+
+#include <cvm/runtime/c_backend_api.h>
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/registry.h>
+#include <cvm/runtime/threading_backend.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../../src/runtime/thread_pool.h"
+#include "../../src/support/parallel_for.h"
+
+using namespace cvm::runtime;
+
+TEST(ThreadPool, ParallelForCoversRange) {
+  ThreadPool::Global()->Configure(4, {});
+  EXPECT_EQ(threading::NumThreads(), 4);
+  const int64_t begin = 3, end = 10003, grain = 7;
+  std::vector<std::atomic<int>> hits(end);
+  std::atomic<bool> chunk_too_large{false};
+  cvm::support::parallel_for(begin, end, grain, [&](int64_t b, int64_t e) {
+    if (e - b > grain) chunk_too_large = true;
+    for (int64_t i = b; i < e; ++i) hits[i]++;
+  });
+  EXPECT_FALSE(chunk_too_large);
+  for (int64_t i = 0; i < end; ++i) {
+    ASSERT_EQ(hits[i].load(), i < begin ? 0 : 1) << i;
+  }
+
+  std::atomic<int64_t> sum{0};
+  cvm::support::parallel_for(0, 1000, [&](int64_t i) { sum += i; });
+  EXPECT_EQ(sum.load(), 999 * 1000 / 2);
+}
+
+TEST(ThreadPool, Exception) {
+  ThreadPool::Global()->Configure(4, {});
+  EXPECT_THROW(cvm::support::parallel_for(0, 1000, 10,
+                                          [](int64_t b, int64_t e) {
+                                            if (b <= 500 && 500 < e) {
+                                              throw std::runtime_error("task failed");
+                                            }
+                                          }),
+               std::runtime_error);
+  // the pool is still usable.
+  std::atomic<int64_t> count{0};
+  cvm::support::parallel_for(0, 1000, 10, [&](int64_t b, int64_t e) { count += e - b; });
+  EXPECT_EQ(count.load(), 1000);
+}
+
+TEST(ThreadPool, NestedRunsInline) {
+  ThreadPool::Global()->Configure(4, {});
+  EXPECT_FALSE(ThreadPool::InParallelRegion());
+  std::atomic<int64_t> count{0};
+  std::atomic<bool> inline_inner{true};
+  cvm::support::parallel_for(0, 8, 1, [&](int64_t, int64_t) {
+    EXPECT_TRUE(ThreadPool::InParallelRegion());
+    std::thread::id self = std::this_thread::get_id();
+    cvm::support::parallel_for(0, 100, 1, [&](int64_t b, int64_t e) {
+      if (std::this_thread::get_id() != self) inline_inner = false;
+      count += e - b;
+    });
+  });
+  EXPECT_TRUE(inline_inner);
+  EXPECT_EQ(count.load(), 800);
+  EXPECT_FALSE(ThreadPool::InParallelRegion());
+}
+
+namespace {
+
+struct LaunchData {
+  std::atomic<int> arrived{0};
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::set<int> task_ids;
+  int num_task{0};
+};
+
+int ConcurrentTask(int task_id, CVMParallelGroupEnv* penv, void* cdata) {
+  auto* data = static_cast<LaunchData*>(cdata);
+  {
+    std::lock_guard<std::mutex> lock(data->mutex);
+    data->threads.insert(std::this_thread::get_id());
+    data->task_ids.insert(task_id);
+    data->num_task = penv->num_task;
+  }
+  // every task waits for all the others, this only returns if they run concurrently.
+  data->arrived++;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (data->arrived.load() < penv->num_task) {
+    if (std::chrono::steady_clock::now() > deadline) return -1;
+    std::this_thread::yield();
+  }
+  return 0;
+}
+
+int FailingTask(int task_id, CVMParallelGroupEnv* /*penv*/, void* /*cdata*/) {
+  return task_id == 1;
+}
+
+}  // namespace
+
+TEST(ThreadPool, ParallelLaunch) {
+  ThreadPool::Global()->Configure(4, {});
+  {
+    LaunchData data;
+    ASSERT_EQ(CVMBackendParallelLaunch(ConcurrentTask, &data, 3), 0);
+    EXPECT_EQ(data.num_task, 3);
+    EXPECT_EQ(data.task_ids, (std::set<int>{0, 1, 2}));
+    EXPECT_EQ(data.threads.size(), 3U);
+  }
+  {
+    // 0 and oversized requests use every thread of the pool.
+    LaunchData data;
+    ASSERT_EQ(CVMBackendParallelLaunch(ConcurrentTask, &data, 0), 0);
+    EXPECT_EQ(data.num_task, 4);
+    LaunchData clamped;
+    ASSERT_EQ(CVMBackendParallelLaunch(ConcurrentTask, &clamped, 64), 0);
+    EXPECT_EQ(clamped.num_task, 4);
+    EXPECT_EQ(clamped.threads.size(), 4U);
+  }
+  EXPECT_EQ(CVMBackendParallelLaunch(FailingTask, nullptr, 4), -1);
+
+  // a launch from inside a parallel region runs inline with a single task.
+  std::atomic<int> inner_tasks{0};
+  cvm::support::parallel_for(0, 4, 1, [&](int64_t, int64_t) {
+    LaunchData data;
+    EXPECT_EQ(CVMBackendParallelLaunch(ConcurrentTask, &data, 4), 0);
+    inner_tasks += data.num_task;
+  });
+  EXPECT_EQ(inner_tasks.load(), 4);
+}
+
+namespace {
+
+struct PhaseData {
+  std::vector<int64_t> stage;
+  std::atomic<bool> ok{true};
+};
+
+// phase 1 writes one value per task, phase 2 reads the values of all tasks.
+int PhasedTask(int task_id, CVMParallelGroupEnv* penv, void* cdata) {
+  auto* data = static_cast<PhaseData*>(cdata);
+  for (int round = 0; round < 50; ++round) {
+    data->stage[task_id] = round * 100 + task_id;
+    if (CVMBackendParallelBarrier(task_id, penv) != 0) return -1;
+    int64_t sum = 0;
+    for (int i = 0; i < penv->num_task; ++i) sum += data->stage[i];
+    if (sum != round * 100 * penv->num_task + penv->num_task * (penv->num_task - 1) / 2) {
+      data->ok = false;
+    }
+    if (CVMBackendParallelBarrier(task_id, penv) != 0) return -1;
+  }
+  return 0;
+}
+
+void AddFloat(void* acc, const void* value, void*) {
+  *static_cast<float*>(acc) += *static_cast<const float*>(value);
+}
+
+struct ReduceData {
+  std::vector<float> results;
+  int num_task{0};
+};
+
+int ReduceTask(int task_id, CVMParallelGroupEnv* penv, void* cdata) {
+  auto* data = static_cast<ReduceData*>(cdata);
+  data->num_task = penv->num_task;
+  float total = 0.0f;
+  for (int round = 0; round < 20; ++round) {
+    // partial sums of very different magnitude, the order of the combine matters.
+    float value = task_id % 2 == 0 ? 1e8f : 1.0f + task_id;
+    float result = 0.0f;
+    if (CVMBackendParallelReduce(task_id, penv, &value, sizeof(float), AddFloat, nullptr,
+                                 &result) != 0) {
+      return -1;
+    }
+    total += result;
+  }
+  data->results[task_id] = total;
+  return 0;
+}
+
+}  // namespace
+
+TEST(ThreadPool, ParallelBarrier) {
+  ThreadPool::Global()->Configure(4, {});
+  PhaseData data;
+  data.stage.resize(4);
+  ASSERT_EQ(CVMBackendParallelLaunch(PhasedTask, &data, 4), 0);
+  EXPECT_TRUE(data.ok);
+
+  // a single task never waits.
+  CVMParallelGroupEnv env{nullptr, 1};
+  EXPECT_EQ(CVMBackendParallelBarrier(0, &env), 0);
+  // a barrier outside of a launch is an error.
+  env.num_task = 4;
+  EXPECT_EQ(CVMBackendParallelBarrier(0, &env), -1);
+}
+
+TEST(ThreadPool, ParallelReduce) {
+  ThreadPool::Global()->Configure(4, {});
+  ReduceData first, second;
+  first.results.resize(4);
+  second.results.resize(4);
+  ASSERT_EQ(CVMBackendParallelLaunch(ReduceTask, &first, 4), 0);
+  ASSERT_EQ(CVMBackendParallelLaunch(ReduceTask, &second, 4), 0);
+  ASSERT_EQ(first.num_task, 4);
+  // combined in task id order: every task and every run sees the same bits.
+  float expected = 0.0f;
+  for (int round = 0; round < 20; ++round) {
+    float sum = 1e8f;
+    sum += 2.0f;
+    sum += 1e8f;
+    sum += 4.0f;
+    expected += sum;
+  }
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(first.results[i], expected);
+    EXPECT_EQ(second.results[i], expected);
+  }
+
+  float value = 3.0f, result = 0.0f;
+  CVMParallelGroupEnv env{nullptr, 1};
+  EXPECT_EQ(CVMBackendParallelReduce(0, &env, &value, sizeof(float), AddFloat, nullptr, &result),
+            0);
+  EXPECT_EQ(result, 3.0f);
+  char large[128] = {0};
+  EXPECT_EQ(CVMBackendParallelReduce(0, &env, large, sizeof(large), AddFloat, nullptr, large), -1);
+}
+
+TEST(ThreadPool, Configure) {
+  const PackedFunc* config = Registry::Get("runtime.config_threadpool");
+  const PackedFunc* num_threads = Registry::Get("runtime.NumThreads");
+  ASSERT_TRUE(config != nullptr && num_threads != nullptr);
+  (*config)(2, ShapeTuple(std::vector<int64_t>{}));
+  EXPECT_EQ(static_cast<int>((*num_threads)()), 2);
+
+  // bound workers still run jobs.
+  std::vector<unsigned> cpus = threading::GetAvailableCPUs();
+  ASSERT_FALSE(cpus.empty());
+  (*config)(3, ShapeTuple(std::vector<int64_t>(cpus.begin(), cpus.end())));
+  EXPECT_EQ(threading::NumThreads(), 3);
+  std::atomic<int64_t> count{0};
+  cvm::support::parallel_for(0, 300, 1, [&](int64_t b, int64_t e) { count += e - b; });
+  EXPECT_EQ(count.load(), 300);
+  LaunchData data;
+  EXPECT_EQ(CVMBackendParallelLaunch(ConcurrentTask, &data, 0), 0);
+  EXPECT_EQ(data.threads.size(), 3U);
+
+  (*config)(1, ShapeTuple(std::vector<int64_t>{}));
+  EXPECT_EQ(threading::NumThreads(), 1);
+  count = 0;
+  cvm::support::parallel_for(0, 300, 1, [&](int64_t b, int64_t e) { count += e - b; });
+  EXPECT_EQ(count.load(), 300);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
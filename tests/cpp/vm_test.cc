@@ -0,0 +1,396 @@
+//
+// Created by WangJingYu on 2021/7/28.
+//
+
+#include <cvm/runtime/container.h>
+#include <cvm/runtime/ndarray.h>
+#include <cvm/runtime/registry.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../../src/runtime/vm/vm.h"
+
+using namespace cvm::runtime;
+using namespace cvm::runtime::vm;
+
+namespace {
+
+constexpr DLDataType kFloat32{kDLFloat, 32, 1};
+
+CVM_REGISTER_GLOBAL("test.vm.scale").set_body_typed([](int64_t a, double b) { return a * b; });
+
+CVM_REGISTER_GLOBAL("test.vm.throw").set_body_typed([](int64_t a) {
+  if (a != 0) throw Error("test.vm.throw: thrown");
+  return a;
+});
+
+/*! \brief sum(n) = 0 + 1 + ... + n - 1, by a loop. */
+VMFunction SumFunction() {
+  return VMFunction{"sum",
+                    1,
+                    5,
+                    {
+                        Instruction::LoadConsti(1, 0),                   // i = 0
+                        Instruction::LoadConsti(2, 0),                   // acc = 0
+                        Instruction::LoadConsti(3, 1),                   // one = 1
+                        Instruction::BinaryOpi(Opcode::kLti, 4, 1, 0),  // loop: c = i < n
+                        Instruction::If(4, 4),                           // if !c goto end
+                        Instruction::BinaryOpi(Opcode::kAddi, 2, 2, 1),  // acc += i
+                        Instruction::BinaryOpi(Opcode::kAddi, 1, 1, 3),  // i += 1
+                        Instruction::Goto(-4),                           // goto loop
+                        Instruction::Ret(2),                             // end: return acc
+                    }};
+}
+
+/*! \brief fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2), fib being the function 0. */
+VMFunction FibFunction() {
+  return VMFunction{"fib",
+                    1,
+                    7,
+                    {
+                        Instruction::LoadConsti(1, 2),
+                        Instruction::BinaryOpi(Opcode::kLti, 2, 0, 1),
+                        Instruction::If(2, 2),
+                        Instruction::Ret(0),
+                        Instruction::LoadConsti(3, 1),
+                        Instruction::BinaryOpi(Opcode::kSubi, 6, 0, 3),
+                        Instruction::Invoke(4, 0, {6}),
+                        Instruction::BinaryOpi(Opcode::kSubi, 6, 6, 3),
+                        Instruction::Invoke(5, 0, {6}),
+                        Instruction::BinaryOpi(Opcode::kAddi, 4, 4, 5),
+                        Instruction::Ret(4),
+                    }};
+}
+
+NDArray Filled(std::vector<int64_t> shape, float start) {
+  NDArray a = NDArray::Empty(shape, kFloat32, Device{kDLCPU, 0});
+  float* data = static_cast<float*>(a->data);
+  int64_t n = 1;
+  for (int64_t d : shape) n *= d;
+  for (int64_t i = 0; i < n; ++i) data[i] = start + static_cast<float>(i);
+  return a;
+}
+
+/*! \brief The tensor held by a value returned by the machine. */
+NDArray AsTensor(const VMValue& value) {
+  EXPECT_EQ(value.kind, VMValue::kObject);
+  EXPECT_NE(value.obj.as<NDArray::Container>(), nullptr);
+  return NDArray(GetObjectPtr<Object>(const_cast<Object*>(value.obj.get())));
+}
+
+}  // namespace
+
+TEST(VM, Loop) {
+  Executable exec;
+  exec.AddFunction(SumFunction());
+  // 9 instructions in 31 words: ops of 1 to 4 words, the 64 bit immediates take two.
+  EXPECT_EQ(exec.functions()[0].code.size(), 31U);
+  VirtualMachine vm(exec);
+  EXPECT_EQ(vm.Invoke("sum", {VMValue::Int(100)}).i, 4950);
+  EXPECT_EQ(vm.Invoke("sum", {VMValue::Int(0)}).i, 0);
+  VMValue big = vm.Invoke("sum", {VMValue::Int(100000)});
+  EXPECT_EQ(big.kind, VMValue::kInt);
+  EXPECT_EQ(big.i, int64_t{100000} * 99999 / 2);
+}
+
+TEST(VM, LoadConstiWideImmediates) {
+  for (int64_t value : {int64_t{-1}, int64_t{1} << 40, INT64_MIN, INT64_MAX}) {
+    Executable exec;
+    exec.AddFunction(VMFunction{"f", 0, 1, {Instruction::LoadConsti(0, value),
+                                            Instruction::Ret(0)}});
+    VirtualMachine vm(exec);
+    EXPECT_EQ(vm.Invoke("f", {}).i, value);
+  }
+}
+
+TEST(VM, Recursion) {
+  Executable exec;
+  exec.AddFunction(FibFunction());
+  VirtualMachine vm(exec);
+  EXPECT_EQ(vm.Invoke("fib", {VMValue::Int(20)}).i, 6765);
+
+  // count(n) = n == 0 ? 0 : 1 + count(n - 1) nests deeper than the initial register stack.
+  Executable deep;
+  deep.AddFunction(VMFunction{"count",
+                              1,
+                              4,
+                              {
+                                  Instruction::LoadConsti(1, 0),
+                                  Instruction::BinaryOpi(Opcode::kEqi, 2, 0, 1),
+                                  Instruction::If(2, 2),
+                                  Instruction::Ret(1),
+                                  Instruction::LoadConsti(3, 1),
+                                  Instruction::BinaryOpi(Opcode::kSubi, 1, 0, 3),
+                                  Instruction::Invoke(1, 0, {1}),
+                                  Instruction::BinaryOpi(Opcode::kAddi, 1, 1, 3),
+                                  Instruction::Ret(1),
+                              }});
+  VirtualMachine deep_vm(deep);
+  EXPECT_EQ(deep_vm.Invoke("count", {VMValue::Int(10000)}).i, 10000);
+  try {
+    deep_vm.Invoke("count", {VMValue::Int(1 << 20)});
+    FAIL() << "expect the call depth limit";
+  } catch (const Error& e) {
+    EXPECT_NE(std::string(e.what()).find("call depth"), std::string::npos) << e.what();
+  }
+  EXPECT_EQ(deep_vm.Invoke("count", {VMValue::Int(3)}).i, 3);
+}
+
+TEST(VM, Closure) {
+  Executable exec;
+  // add(k, x) = x + k, the closure captures k.
+  int add = exec.AddFunction(VMFunction{
+      "add", 2, 3, {Instruction::BinaryOpi(Opcode::kAddi, 2, 1, 0), Instruction::Ret(2)}});
+  int make_adder = exec.AddFunction(VMFunction{
+      "make_adder", 1, 2, {Instruction::AllocClosure(1, add, {0}), Instruction::Ret(1)}});
+  exec.AddFunction(VMFunction{"apply",
+                              2,
+                              4,
+                              {
+                                  Instruction::Invoke(2, make_adder, {0}),
+                                  Instruction::InvokeClosure(3, 2, {1}),
+                                  Instruction::Ret(3),
+                              }});
+  VirtualMachine vm(exec);
+  EXPECT_EQ(vm.Invoke("apply", {VMValue::Int(10), VMValue::Int(32)}).i, 42);
+
+  VMValue closure = vm.Invoke("make_adder", {VMValue::Int(5)});
+  ASSERT_EQ(closure.kind, VMValue::kObject);
+  const VMClosureObj* node = closure.obj.as<VMClosureObj>();
+  ASSERT_NE(node, nullptr);
+  EXPECT_NE(closure.obj.as<ClosureObj>(), nullptr);
+  EXPECT_EQ(node->func_index, add);
+  ASSERT_EQ(node->captured.size(), 1U);
+  EXPECT_EQ(node->captured[0].i, 5);
+}
+
+TEST(VM, ADT) {
+  Executable exec;
+  int a = exec.AddConstant(String("a"));
+  int b = exec.AddConstant(String("b"));
+  // pair() = (tag 4: a, b); swap(p) = (tag of p: p[1], p[0]); tag(p) = tag of p.
+  exec.AddFunction(VMFunction{"pair",
+                              0,
+                              3,
+                              {
+                                  Instruction::LoadConst(0, a),
+                                  Instruction::LoadConst(1, b),
+                                  Instruction::AllocADT(2, 4, {0, 1}),
+                                  Instruction::Ret(2),
+                              }});
+  exec.AddFunction(VMFunction{"swap",
+                              1,
+                              3,
+                              {
+                                  Instruction::GetField(1, 0, 1),
+                                  Instruction::GetField(2, 0, 0),
+                                  Instruction::AllocADT(0, 4, {1, 2}),
+                                  Instruction::Ret(0),
+                              }});
+  exec.AddFunction(
+      VMFunction{"first", 1, 1, {Instruction::GetField(0, 0, 0), Instruction::Ret(0)}});
+  exec.AddFunction(VMFunction{"tag", 1, 2, {Instruction::GetTag(1, 0), Instruction::Ret(1)}});
+  exec.AddFunction(
+      VMFunction{"third", 1, 2, {Instruction::GetField(1, 0, 2), Instruction::Ret(1)}});
+  exec.AddFunction(VMFunction{"int_field",
+                              0,
+                              2,
+                              {Instruction::LoadConsti(0, 1), Instruction::AllocADT(1, 0, {0}),
+                               Instruction::Ret(1)}});
+  VirtualMachine vm(exec);
+
+  VMValue pair = vm.Invoke("pair", {});
+  const ADTObj* node = pair.obj.as<ADTObj>();
+  ASSERT_NE(node, nullptr);
+  ADT adt(GetObjectPtr<Object>(const_cast<ADTObj*>(node)));
+  EXPECT_EQ(adt.tag(), 4);
+  ASSERT_EQ(adt.size(), 2U);
+  EXPECT_EQ(adt[0].get(), exec.constants()[a].get());
+
+  ADT swapped(GetObjectPtr<Object>(
+      const_cast<Object*>(vm.Invoke("swap", {VMValue::Object(adt)}).obj.get())));
+  EXPECT_EQ(swapped[0].get(), adt[1].get());
+  EXPECT_EQ(swapped[1].get(), adt[0].get());
+  // the destination of get_field may be the ADT itself.
+  EXPECT_EQ(vm.Invoke("first", {VMValue::Object(adt)}).obj.get(), adt[0].get());
+  EXPECT_EQ(vm.Invoke("tag", {VMValue::Object(adt)}).i, 4);
+
+  auto expect_error = [&vm](const std::string& func, VMValue arg, const std::string& what) {
+    try {
+      vm.Invoke(func, func == "int_field" ? std::vector<VMValue>() : std::vector<VMValue>{arg});
+      FAIL() << "expect an error containing " << what;
+    } catch (const Error& e) {
+      EXPECT_NE(std::string(e.what()).find(what), std::string::npos) << e.what();
+    }
+  };
+  expect_error("third", VMValue::Object(adt), "get_field 2 of an ADT of 2 fields");
+  expect_error("tag", VMValue::Int(1), "no ADT");
+  expect_error("int_field", VMValue(), "the fields of an ADT are objects");
+}
+
+TEST(VM, InvokePackedDynamicShape) {
+  Executable exec;
+  int relu = exec.AddPackedFunc("kernel.relu");
+  // relu(x) allocates its output by the dimensions of x at run time.
+  exec.AddFunction(VMFunction{"relu",
+                              1,
+                              4,
+                              {
+                                  Instruction::TensorDim(1, 0, 0),
+                                  Instruction::TensorDim(2, 0, 1),
+                                  Instruction::AllocTensorReg(3, kFloat32, {1, 2}),
+                                  Instruction::InvokePacked(kNoRegister, relu, {0, 3}),
+                                  Instruction::Ret(3),
+                              }});
+  int add = exec.AddPackedFunc("kernel.add");
+  int shape = exec.AddConstant(ShapeTuple({2, 3}));
+  int bias = exec.AddConstant(Filled({2, 3}, 1));
+  exec.AddFunction(VMFunction{"add_bias",
+                              1,
+                              3,
+                              {
+                                  Instruction::LoadConst(1, bias),
+                                  Instruction::AllocTensor(2, kFloat32, shape),
+                                  Instruction::InvokePacked(kNoRegister, add, {0, 1, 2}),
+                                  Instruction::Ret(2),
+                              }});
+  int scale = exec.AddPackedFunc("test.vm.scale");
+  exec.AddFunction(VMFunction{
+      "scale", 2, 3, {Instruction::InvokePacked(2, scale, {0, 1}), Instruction::Ret(2)}});
+  VirtualMachine vm(exec);
+
+  for (int64_t rows : {1, 3, 7}) {
+    NDArray x = Filled({rows, 5}, -8);
+    VMValue out = vm.Invoke("relu", {VMValue::Object(x)});
+    NDArray y = AsTensor(out);
+    ASSERT_EQ(y->ndim, 2);
+    EXPECT_EQ(y->shape[0], rows);
+    EXPECT_EQ(y->shape[1], 5);
+    for (int64_t i = 0; i < rows * 5; ++i) {
+      EXPECT_EQ(static_cast<float*>(y->data)[i], std::max(-8.0f + i, 0.0f));
+    }
+  }
+
+  NDArray sum = AsTensor(vm.Invoke("add_bias", {VMValue::Object(Filled({2, 3}, 10))}));
+  for (int i = 0; i < 6; ++i) EXPECT_EQ(static_cast<float*>(sum->data)[i], 11.0f + 2 * i);
+
+  VMValue scaled = vm.Invoke("scale", {VMValue::Int(3), VMValue::Float(0.5)});
+  EXPECT_EQ(scaled.kind, VMValue::kFloat);
+  EXPECT_EQ(scaled.f, 1.5);
+}
+
+TEST(VM, PackedFuncInterface) {
+  Executable exec;
+  exec.AddFunction(SumFunction());
+  exec.AddFunction(VMFunction{"identity", 1, 1, {Instruction::Ret(0)}});
+  ObjectPtr<VirtualMachine> vm = make_object<VirtualMachine>(exec);
+  PackedFunc sum = vm->GetFunction("sum", vm);
+  ASSERT_NE(sum, nullptr);
+  EXPECT_EQ(sum(10).operator int64_t(), 45);
+  PackedFunc invoke = vm->GetFunction("invoke", vm);
+  EXPECT_EQ(invoke("sum", 5).operator int64_t(), 10);
+  EXPECT_EQ(invoke("identity", 2.5).operator double(), 2.5);
+  NDArray x = Filled({4}, 0);
+  NDArray same = invoke("identity", x);
+  EXPECT_EQ(same.get(), x.get());
+  EXPECT_EQ(vm->GetFunction("missing", vm), nullptr);
+}
+
+TEST(VM, Errors) {
+  auto expect_error = [](auto f, const std::string& what) {
+    try {
+      f();
+      FAIL() << "expect an error containing " << what;
+    } catch (const Error& e) {
+      EXPECT_NE(std::string(e.what()).find(what), std::string::npos) << e.what();
+    }
+  };
+  // malformed functions are rejected when added.
+  expect_error(
+      [] {
+        Executable exec;
+        exec.AddFunction(VMFunction{"f", 0, 1, {Instruction::Ret(1)}});
+      },
+      "register 1 out of range");
+  expect_error(
+      [] {
+        Executable exec;
+        exec.AddFunction(VMFunction{"f", 0, 1, {Instruction::Goto(2), Instruction::Ret(0)}});
+      },
+      "jump out of the function");
+  expect_error(
+      [] {
+        Executable exec;
+        exec.AddFunction(VMFunction{"f", 0, 1, {Instruction::LoadConsti(0, 1)}});
+      },
+      "the last instruction");
+  expect_error(
+      [] {
+        Executable exec;
+        int c = exec.AddConstant(String("x"));
+        exec.AddFunction(VMFunction{
+            "f", 0, 1, {Instruction::AllocTensor(0, kFloat32, c), Instruction::Ret(0)}});
+      },
+      "ShapeTuple");
+  // calls are checked at load.
+  expect_error(
+      [] {
+        Executable exec;
+        exec.AddFunction(
+            VMFunction{"f", 0, 1, {Instruction::Invoke(0, 3, {}), Instruction::Ret(0)}});
+        VirtualMachine vm(exec);
+      },
+      "refers to function 3");
+  expect_error(
+      [] {
+        Executable exec;
+        exec.AddFunction(SumFunction());
+        exec.AddFunction(
+            VMFunction{"f", 0, 1, {Instruction::Invoke(0, 0, {}), Instruction::Ret(0)}});
+        VirtualMachine vm(exec);
+      },
+      "passes 0 values to sum");
+  expect_error(
+      [] {
+        Executable exec;
+        exec.AddPackedFunc("test.vm.not_registered");
+        VirtualMachine vm(exec);
+      },
+      "test.vm.not_registered is not registered");
+
+  // run time errors unwind every frame and leave the machine usable.
+  Executable exec;
+  int thrower = exec.AddPackedFunc("test.vm.throw");
+  int callee = exec.AddFunction(VMFunction{
+      "callee", 1, 2, {Instruction::InvokePacked(1, thrower, {0}), Instruction::Ret(1)}});
+  int shape = exec.AddConstant(ShapeTuple({4}));
+  exec.AddFunction(VMFunction{"caller",
+                              1,
+                              3,
+                              {
+                                  Instruction::AllocTensor(1, kFloat32, shape),
+                                  Instruction::Invoke(2, callee, {0}),
+                                  Instruction::Ret(2),
+                              }});
+  exec.AddFunction(VMFunction{"fatal", 0, 1, {Instruction::Fatal()}});
+  exec.AddFunction(VMFunction{"not_closure",
+                              0,
+                              1,
+                              {Instruction::LoadConsti(0, 1), Instruction::InvokeClosure(0, 0, {}),
+                               Instruction::Ret(0)}});
+  VirtualMachine vm(exec);
+  expect_error([&] { vm.Invoke("caller", {VMValue::Int(1)}); }, "test.vm.throw: thrown");
+  EXPECT_EQ(vm.Invoke("caller", {VMValue::Int(0)}).i, 0);
+  expect_error([&] { vm.Invoke("fatal", {}); }, "fatal: fatal instruction");
+  expect_error([&] { vm.Invoke("not_closure", {}); }, "no closure");
+  expect_error([&] { vm.Invoke("caller", {}); }, "takes 1 arguments");
+  expect_error([&] { vm.Invoke("missing", {}); }, "no function named missing");
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}